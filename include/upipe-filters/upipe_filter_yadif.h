@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe motion-adaptive deinterlace filter
+ *
+ * For each interlaced picture, the lines of the first field are kept and
+ * the lines of the second field are interpolated, using the previous and
+ * next pictures to detect motion (the algorithm of yadif). Static areas
+ * thus keep their full vertical resolution, while moving areas are
+ * interpolated spatially along edges.
+ *
+ * The pipe holds one picture, which is output when the next one arrives,
+ * or when the pipe is released. Progressive pictures are passed through.
+ * The processing of a picture may be spread over several threads with
+ * @ref upipe_filter_yadif_set_threads.
+ */
+
+#ifndef _UPIPE_FILTERS_UPIPE_FILTER_YADIF_H_
+/** @hidden */
+#define _UPIPE_FILTERS_UPIPE_FILTER_YADIF_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+
+#define UPIPE_FILTER_YADIF_SIGNATURE UBASE_FOURCC('y','a','d','f')
+
+/** @This extends upipe_command with specific commands for yadif pipes. */
+enum upipe_filter_yadif_command {
+    UPIPE_FILTER_YADIF_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the number of threads (unsigned int *) */
+    UPIPE_FILTER_YADIF_GET_THREADS,
+    /** sets the number of threads (unsigned int) */
+    UPIPE_FILTER_YADIF_SET_THREADS,
+};
+
+/** @This returns the management structure for all yadif pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_filter_yadif_mgr_alloc(void);
+
+/** @This returns the number of threads processing a picture.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static inline int upipe_filter_yadif_get_threads(struct upipe *upipe,
+                                                 unsigned int *threads_p)
+{
+    return upipe_control(upipe, UPIPE_FILTER_YADIF_GET_THREADS,
+                         UPIPE_FILTER_YADIF_SIGNATURE, threads_p);
+}
+
+/** @This sets the number of threads processing a picture, including the
+ * thread of the pipe. The default is 1.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads
+ * @return an error code
+ */
+static inline int upipe_filter_yadif_set_threads(struct upipe *upipe,
+                                                 unsigned int threads)
+{
+    return upipe_control(upipe, UPIPE_FILTER_YADIF_SET_THREADS,
+                         UPIPE_FILTER_YADIF_SIGNATURE, threads);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
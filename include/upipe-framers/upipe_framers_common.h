@@ -31,7 +31,11 @@ extern "C" {
 
 #include <upipe/ubuf_block_stream.h>
 
-/** @This scans for an MPEG-style 3-octet start code in a linear buffer.
+/** @This scans for an MPEG-style 3-octet start code in a linear buffer,
+ * using the fastest implementation supported by the CPU.
+ *
+ * The state carries the last four octets over buffer boundaries, so that
+ * a start code split between two calls is found by the second one.
  *
  * @param p linear buffer
  * @param end end of linear buffer
@@ -42,6 +46,58 @@ const uint8_t *upipe_framers_mpeg_scan(const uint8_t *restrict p,
                                        const uint8_t *end,
                                        uint32_t *restrict state);
 
+/** @This scans for an MPEG-style 3-octet start code in a linear buffer,
+ * without vector instructions.
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @param state state of the algorithm
+ * @return pointer to start code, or end if not found
+ */
+const uint8_t *upipe_framers_mpeg_scan_c(const uint8_t *restrict p,
+                                         const uint8_t *end,
+                                         uint32_t *restrict state);
+
+#if defined(__i386__) || defined(__x86_64__)
+/** @This scans for an MPEG-style 3-octet start code in a linear buffer,
+ * using SSE2 instructions (the CPU must support them).
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @param state state of the algorithm
+ * @return pointer to start code, or end if not found
+ */
+const uint8_t *upipe_framers_mpeg_scan_sse2(const uint8_t *restrict p,
+                                            const uint8_t *end,
+                                            uint32_t *restrict state);
+
+/** @This scans for an MPEG-style 3-octet start code in a linear buffer,
+ * using AVX2 instructions (the CPU must support them).
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @param state state of the algorithm
+ * @return pointer to start code, or end if not found
+ */
+const uint8_t *upipe_framers_mpeg_scan_avx2(const uint8_t *restrict p,
+                                            const uint8_t *end,
+                                            uint32_t *restrict state);
+#endif
+
+#if defined(__aarch64__)
+/** @This scans for an MPEG-style 3-octet start code in a linear buffer,
+ * using NEON instructions.
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @param state state of the algorithm
+ * @return pointer to start code, or end if not found
+ */
+const uint8_t *upipe_framers_mpeg_scan_neon(const uint8_t *restrict p,
+                                            const uint8_t *end,
+                                            uint32_t *restrict state);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -35,6 +35,7 @@ extern "C" {
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <assert.h>
 
 /** @hidden */
 enum uref_h26x_encaps;
@@ -87,6 +88,194 @@ uint32_t upipe_h26xf_stream_ue(struct ubuf_block_stream *s);
  */
 int32_t upipe_h26xf_stream_se(struct ubuf_block_stream *s);
 
+/** number of octets of a NAL unit unescaped at once by the bit reader */
+#define UPIPE_H26XF_BITS_CHUNK 64
+
+/** @This reads bits from a NAL unit. Escape words are removed from chunks
+ * of the NAL unit copied to a linear buffer, from which bits are read
+ * through a 64-bit cache. Reading past the end of the NAL unit returns
+ * zeros. */
+struct upipe_h26xf_bits {
+    /** octet stream of the NAL unit */
+    struct ubuf_block_stream s;
+    /** positions of the 0s in the previous two octets */
+    uint8_t zeros;
+    /** next unescaped octet */
+    const uint8_t *ptr;
+    /** end of unescaped octets */
+    const uint8_t *end;
+    /** bits cache, most significant bit first */
+    uint64_t cache;
+    /** number of bits in the cache */
+    unsigned int left;
+    /** unescaped octets, with room for a 64-bit load past the end */
+    uint8_t scratch[UPIPE_H26XF_BITS_CHUNK + 8];
+};
+
+/** @This removes escape words from a linear buffer.
+ *
+ * @param dst destination buffer, of at least size octets
+ * @param src source buffer
+ * @param size number of octets in the source buffer
+ * @param zeros_p positions of the 0s in the previous two octets, updated on
+ * execution (0 at the start of a NAL unit)
+ * @return number of octets written to the destination buffer
+ */
+size_t upipe_h26xf_unescape(uint8_t *restrict dst, const uint8_t *restrict src,
+                            size_t size, uint8_t *restrict zeros_p);
+
+/** @This removes escape words from a linear buffer, using C code.
+ *
+ * @param dst destination buffer, of at least size octets
+ * @param src source buffer
+ * @param size number of octets in the source buffer
+ * @param zeros_p positions of the 0s in the previous two octets, updated on
+ * execution
+ * @return number of octets written to the destination buffer
+ */
+size_t upipe_h26xf_unescape_c(uint8_t *restrict dst,
+                              const uint8_t *restrict src, size_t size,
+                              uint8_t *restrict zeros_p);
+
+#if defined(__i386__) || defined(__x86_64__)
+/** @This removes escape words from a linear buffer, using SSE2
+ * instructions.
+ *
+ * @param dst destination buffer, of at least size octets
+ * @param src source buffer
+ * @param size number of octets in the source buffer
+ * @param zeros_p positions of the 0s in the previous two octets, updated on
+ * execution
+ * @return number of octets written to the destination buffer
+ */
+size_t upipe_h26xf_unescape_sse2(uint8_t *restrict dst,
+                                 const uint8_t *restrict src, size_t size,
+                                 uint8_t *restrict zeros_p);
+#endif
+
+#if defined(__aarch64__)
+/** @This removes escape words from a linear buffer, using NEON
+ * instructions.
+ *
+ * @param dst destination buffer, of at least size octets
+ * @param src source buffer
+ * @param size number of octets in the source buffer
+ * @param zeros_p positions of the 0s in the previous two octets, updated on
+ * execution
+ * @return number of octets written to the destination buffer
+ */
+size_t upipe_h26xf_unescape_neon(uint8_t *restrict dst,
+                                 const uint8_t *restrict src, size_t size,
+                                 uint8_t *restrict zeros_p);
+#endif
+
+/** @This initializes a bit reader on a NAL unit.
+ *
+ * @param b bit reader
+ * @param ubuf block ubuf containing the NAL unit
+ * @param offset offset of the first octet to read in the ubuf
+ * @return an error code
+ */
+int upipe_h26xf_bits_init(struct upipe_h26xf_bits *b, struct ubuf *ubuf,
+                          int offset);
+
+/** @This cleans up a bit reader.
+ *
+ * @param b bit reader
+ * @return an error code
+ */
+static inline int upipe_h26xf_bits_clean(struct upipe_h26xf_bits *b)
+{
+    return ubuf_block_stream_clean(&b->s);
+}
+
+/** @internal @This fills the bits cache with at least 57 bits.
+ *
+ * @param b bit reader
+ */
+void upipe_h26xf_bits_refill(struct upipe_h26xf_bits *b);
+
+/** @This returns the given number of bits without consuming them.
+ *
+ * @param b bit reader
+ * @param nb number of bits, up to 32
+ * @return bits read
+ */
+static inline uint32_t upipe_h26xf_bits_show(struct upipe_h26xf_bits *b,
+                                             unsigned int nb)
+{
+    assert(nb <= 32);
+    if (unlikely(b->left < nb))
+        upipe_h26xf_bits_refill(b);
+    return nb ? b->cache >> (64 - nb) : 0;
+}
+
+/** @This discards the given number of bits.
+ *
+ * @param b bit reader
+ * @param nb number of bits, up to 32
+ */
+static inline void upipe_h26xf_bits_skip(struct upipe_h26xf_bits *b,
+                                         unsigned int nb)
+{
+    assert(nb <= 32);
+    if (unlikely(b->left < nb))
+        upipe_h26xf_bits_refill(b);
+    b->cache <<= nb;
+    b->left -= nb;
+}
+
+/** @This reads the given number of bits.
+ *
+ * @param b bit reader
+ * @param nb number of bits, up to 32
+ * @return bits read
+ */
+static inline uint32_t upipe_h26xf_bits_read(struct upipe_h26xf_bits *b,
+                                             unsigned int nb)
+{
+    uint32_t v = upipe_h26xf_bits_show(b, nb);
+    upipe_h26xf_bits_skip(b, nb);
+    return v;
+}
+
+/** @This reads an unsigned exp-golomb code.
+ *
+ * @param b bit reader
+ * @return code read
+ */
+static inline uint32_t upipe_h26xf_bits_ue(struct upipe_h26xf_bits *b)
+{
+    if (unlikely(b->left < 32))
+        upipe_h26xf_bits_refill(b);
+    unsigned int lz = __builtin_clzll(b->cache | 1);
+    if (unlikely(lz >= 32)) {
+        /* invalid code */
+        upipe_h26xf_bits_skip(b, 32);
+        return UINT32_MAX;
+    }
+    unsigned int len = 2 * lz + 1;
+    if (unlikely(len > b->left)) {
+        upipe_h26xf_bits_skip(b, lz);
+        return upipe_h26xf_bits_read(b, lz + 1) - 1;
+    }
+    uint32_t v = b->cache >> (64 - len);
+    b->cache <<= len;
+    b->left -= len;
+    return v - 1;
+}
+
+/** @This reads a signed exp-golomb code.
+ *
+ * @param b bit reader
+ * @return code read
+ */
+static inline int32_t upipe_h26xf_bits_se(struct upipe_h26xf_bits *b)
+{
+    uint32_t v = upipe_h26xf_bits_ue(b);
+    return (v & 1) ? (v + 1) / 2 : -(v / 2);
+}
+
 /** @This allocates a ubuf containing an annex B header.
  *
  * @param ubuf_mgr pointer to ubuf manager
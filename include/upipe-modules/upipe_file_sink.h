@@ -69,6 +69,10 @@ enum upipe_fsink_command {
     UPIPE_FSINK_SET_SYNC_PERIOD,
     /** gets fdatasync period (uint64_t *) */
     UPIPE_FSINK_GET_SYNC_PERIOD,
+    /** sets the size of preallocated chunks (uint64_t) */
+    UPIPE_FSINK_SET_PREALLOC,
+    /** gets the size of preallocated chunks (uint64_t *) */
+    UPIPE_FSINK_GET_PREALLOC,
 
     /** outer pipes commands begin here */
     UPIPE_FSINK_CONTROL_LOCAL = UPIPE_CONTROL_LOCAL + 0x1000
@@ -162,6 +166,38 @@ static inline int upipe_fsink_set_sync_period(struct upipe *upipe,
                          UPIPE_FSINK_SIGNATURE, sync_period);
 }
 
+/** @This returns the size of preallocated chunks.
+ *
+ * @param upipe description structure of the pipe
+ * @param prealloc_p filled in with the size of chunks, in octets
+ * @return an error code
+ */
+static inline int upipe_fsink_get_prealloc(struct upipe *upipe,
+                                           uint64_t *prealloc_p)
+{
+    return upipe_control(upipe, UPIPE_FSINK_GET_PREALLOC,
+                         UPIPE_FSINK_SIGNATURE, prealloc_p);
+}
+
+/** @This sets the size of preallocated chunks. When the data written
+ * reaches the end of the reserved space, the next chunk is allocated
+ * without changing the size of the file, so that long-running recordings
+ * are not fragmented. The file is truncated to the written size when it
+ * is closed. Only files opened by the pipe with @ref upipe_fsink_set_path
+ * are preallocated; descriptors given with @ref upipe_fsink_set_fd are left
+ * untouched. 0 (the default) disables preallocation.
+ *
+ * @param upipe description structure of the pipe
+ * @param prealloc size of chunks, in octets
+ * @return an error code
+ */
+static inline int upipe_fsink_set_prealloc(struct upipe *upipe,
+                                           uint64_t prealloc)
+{
+    return upipe_control(upipe, UPIPE_FSINK_SET_PREALLOC,
+                         UPIPE_FSINK_SIGNATURE, prealloc);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -38,6 +38,45 @@ extern "C" {
 
 #define UPIPE_FSRC_SIGNATURE UBASE_FOURCC('f','s','r','c')
 
+/** @This extends upipe_command with specific commands for file source. */
+enum upipe_fsrc_command {
+    UPIPE_FSRC_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the size of mapped windows (uint64_t *) */
+    UPIPE_FSRC_GET_MMAP,
+    /** sets the size of mapped windows, 0 to disable (uint64_t) */
+    UPIPE_FSRC_SET_MMAP,
+};
+
+/** @This returns the size of the file windows mapped in memory.
+ *
+ * @param upipe description structure of the pipe
+ * @param window_p filled in with the size of windows, or 0 if disabled
+ * @return an error code
+ */
+static inline int upipe_fsrc_get_mmap(struct upipe *upipe, uint64_t *window_p)
+{
+    return upipe_control(upipe, UPIPE_FSRC_GET_MMAP, UPIPE_FSRC_SIGNATURE,
+                         window_p);
+}
+
+/** @This sets the size of the file windows mapped in memory. If not 0, and
+ * if the file is a regular file, the pipe maps windows of the file and
+ * outputs blocks pointing directly to the mapping, instead of copying the
+ * data with read(). The next window is prefetched with a readahead hint.
+ * This requires a block ubuf manager able to wrap external memory; otherwise
+ * the pipe falls back to read().
+ *
+ * @param upipe description structure of the pipe
+ * @param window size of windows, in octets, or 0 to disable
+ * @return an error code
+ */
+static inline int upipe_fsrc_set_mmap(struct upipe *upipe, uint64_t window)
+{
+    return upipe_control(upipe, UPIPE_FSRC_SET_MMAP, UPIPE_FSRC_SIGNATURE,
+                         window);
+}
+
 /** @This returns the management structure for all file sources.
  *
  * @return pointer to manager
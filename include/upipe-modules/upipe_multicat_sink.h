@@ -27,6 +27,13 @@
  * @short Upipe module - multicat file sink
  * This sink module owns an embedded file sink and changes its path
  * depending on the uref cr_sys attribute.
+ *
+ * When used as an archive, a second multicat sink records the cr_sys of
+ * each packet in an auxiliary file (see @ref upipe_genaux_mgr_alloc).
+ * The auxiliary file is a dense time to offset index of the data file
+ * with the same index, which the multicat source bisects to seek. The
+ * fsink commands, such as @ref upipe_fsink_set_prealloc, are kept across
+ * file rotations.
  */
 
 #ifndef _UPIPE_MODULES_UPIPE_MULTICAT_SINK_H_
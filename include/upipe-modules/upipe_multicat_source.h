@@ -25,6 +25,13 @@
 
 /** @file
  * @short Upipe module - multicat file source
+ *
+ * The source reads the segments written by two multicat sinks, one for the
+ * data and one for the aux files (see @ref upipe_multicat_sink_mgr_alloc).
+ * Setting the position bisects the aux file of the segment containing the
+ * requested date, and reading starts from there. Packets are read by
+ * batches of msrc.batch packets, and the next batch is prefetched by the
+ * kernel.
  */
 
 #ifndef _UPIPE_MODULES_UPIPE_MULTICAT_SOURCE_H_
@@ -44,10 +51,13 @@ UREF_ATTR_STRING(msrc_flow, data, "msrc.data", data suffix)
 UREF_ATTR_STRING(msrc_flow, aux, "msrc.aux", aux suffix)
 UREF_ATTR_UNSIGNED(msrc_flow, rotate, "msrc.rotate", rotate interval)
 UREF_ATTR_UNSIGNED(msrc_flow, offset, "msrc.offset", rotate offset)
+UREF_ATTR_UNSIGNED(msrc_flow, batch, "msrc.batch", packets per read)
 
 #define UPIPE_MSRC_SIGNATURE UBASE_FOURCC('m','s','r','c')
 #define UPIPE_MSRC_DEF_ROTATE UINT64_C(97200000000)
 #define UPIPE_MSRC_DEF_OFFSET UINT64_C(0)
+/** default number of packets read at once */
+#define UPIPE_MSRC_DEF_BATCH UINT64_C(64)
 
 /** @This returns the management structure for msrc pipes.
  *
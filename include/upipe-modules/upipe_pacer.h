@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe module releasing buffers at their exact system date
+ *
+ * The pacer blocks its thread until cr_sys (plus the latency of the flow)
+ * of each incoming buffer, using nanosleep() for most of the wait and a
+ * busy loop on the uclock for the last part, and then outputs the buffer.
+ * It is designed to run alone in a dedicated thread, typically in a
+ * worker sink (@ref upipe_wsink_alloc) between a live TS mux and a udp
+ * sink, so that event loop timer jitter does not show up as PCR jitter.
+ *
+ * The difference between the actual release date and the requested date
+ * is recorded in a histogram which can be retrieved with
+ * @ref upipe_pacer_get_stats.
+ */
+
+#ifndef _UPIPE_MODULES_UPIPE_PACER_H_
+/** @hidden */
+#define _UPIPE_MODULES_UPIPE_PACER_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+
+#include <stdint.h>
+
+#define UPIPE_PACER_SIGNATURE UBASE_FOURCC('p','a','c','r')
+
+/** number of bins in the jitter histogram */
+#define UPIPE_PACER_HISTOGRAM_SIZE 16
+
+/** @This is the set of statistics gathered by a pacer pipe. */
+struct upipe_pacer_stats {
+    /** number of released buffers */
+    uint32_t packets;
+    /** number of buffers received after their release date */
+    uint32_t late;
+    /** maximum jitter, in 27 MHz ticks */
+    uint32_t max_jitter;
+    /** jitter histogram: bin 0 counts jitters below 1 us, bin n counts
+     * jitters between 2^(n-1) and 2^n us, and the last bin counts all
+     * higher jitters */
+    uint32_t histogram[UPIPE_PACER_HISTOGRAM_SIZE];
+};
+
+/** @This extends upipe_command with specific commands for pacer pipes. */
+enum upipe_pacer_command {
+    UPIPE_PACER_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the current busy-wait duration (uint64_t *) */
+    UPIPE_PACER_GET_SPIN,
+    /** sets the busy-wait duration (uint64_t) */
+    UPIPE_PACER_SET_SPIN,
+    /** returns the jitter statistics (struct upipe_pacer_stats *) */
+    UPIPE_PACER_GET_STATS,
+    /** resets the jitter statistics (void) */
+    UPIPE_PACER_RESET_STATS,
+};
+
+/** @This returns the management structure for all pacer pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_pacer_mgr_alloc(void);
+
+/** @This returns the duration of the busy loop preceding a release date.
+ *
+ * @param upipe description structure of the pipe
+ * @param spin_p filled in with the duration in 27 MHz ticks
+ * @return an error code
+ */
+static inline int upipe_pacer_get_spin(struct upipe *upipe, uint64_t *spin_p)
+{
+    return upipe_control(upipe, UPIPE_PACER_GET_SPIN, UPIPE_PACER_SIGNATURE,
+                         spin_p);
+}
+
+/** @This sets the duration of the busy loop preceding a release date.
+ * Before that, the thread sleeps. A longer busy loop reduces jitter at the
+ * expense of CPU time.
+ *
+ * @param upipe description structure of the pipe
+ * @param spin duration in 27 MHz ticks
+ * @return an error code
+ */
+static inline int upipe_pacer_set_spin(struct upipe *upipe, uint64_t spin)
+{
+    return upipe_control(upipe, UPIPE_PACER_SET_SPIN, UPIPE_PACER_SIGNATURE,
+                         spin);
+}
+
+/** @This returns the jitter statistics. The counters are updated
+ * atomically, so this may also be called from another thread than the
+ * one running the pacer.
+ *
+ * @param upipe description structure of the pipe
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+static inline int upipe_pacer_get_stats(struct upipe *upipe,
+                                        struct upipe_pacer_stats *stats)
+{
+    return upipe_control(upipe, UPIPE_PACER_GET_STATS, UPIPE_PACER_SIGNATURE,
+                         stats);
+}
+
+/** @This resets the jitter statistics.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static inline int upipe_pacer_reset_stats(struct upipe *upipe)
+{
+    return upipe_control(upipe, UPIPE_PACER_RESET_STATS,
+                         UPIPE_PACER_SIGNATURE);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -28,7 +28,8 @@
  *
  * Note that the allocator requires an additional parameter:
  * @table 2
- * @item queue_length @item maximum length of the queue (<= 255)
+ * @item queue_length @item maximum length of the queue
+ * (<= @ref UQUEUE_MAX_LENGTH)
  * @end table
  *
  * Also note that this module is exceptional in that upipe_release() may be
@@ -49,6 +50,9 @@ extern "C" {
 #include <assert.h>
 
 #define UPIPE_QSRC_SIGNATURE UBASE_FOURCC('q','s','r','c')
+/** @This is the signature used to allocate a queue source with a
+ * single-producer single-consumer queue (see @ref uqueue_init_spsc). */
+#define UPIPE_QSRC_SPSC_SIGNATURE UBASE_FOURCC('q','s','r','s')
 
 /** @This extends upipe_command with specific commands for queue source. */
 enum upipe_qsrc_command {
@@ -100,6 +104,9 @@ static inline int upipe_qsrc_get_length(struct upipe *upipe,
 /** @hidden */
 #define ARGS , queue_length
 UPIPE_HELPER_ALLOC(qsrc, UPIPE_QSRC_SIGNATURE)
+/* upipe_qsrc_spsc_alloc() allocates a queue source whose queue may only be
+ * fed by a single queue sink, running in a single thread */
+UPIPE_HELPER_ALLOC(qsrc_spsc, UPIPE_QSRC_SPSC_SIGNATURE)
 #undef ARGS
 #undef ARGS_DECL
 
@@ -39,6 +39,25 @@ extern "C" {
 #define UPIPE_RTPR_SIGNATURE UBASE_FOURCC('r','t','p','r')
 #define UPIPE_RTPR_INPUT_SIGNATURE UBASE_FOURCC('r','t','p','i')
 
+/** default number of packets in the reorder window */
+#define UPIPE_RTPR_DEFAULT_WINDOW 8192
+
+/** @This is the set of statistics gathered by an rtpr pipe. */
+struct upipe_rtpr_stats {
+    /** number of seqnums never received */
+    uint64_t lost;
+    /** number of duplicate packets dropped */
+    uint64_t duplicates;
+    /** number of packets received after their seqnum was output */
+    uint64_t late;
+    /** number of packets received out of order */
+    uint64_t reordered;
+    /** number of packets output early because the window was full */
+    uint64_t overflows;
+    /** maximum distance between an out of order packet and the highest
+     * seqnum received */
+    uint64_t max_reorder;
+};
 
 /** @This extends upipe_command with specific commands for delay pipes. */
 enum upipe_rtpr_command {
@@ -47,7 +66,15 @@ enum upipe_rtpr_command {
     /** returns the current reorder delay being set into urefs (uint64_t **) */
     UPIPE_RTPR_GET_DELAY,
     /** sets the reorder delay to set into urefs (uint64_t *) */
-    UPIPE_RTPR_SET_DELAY
+    UPIPE_RTPR_SET_DELAY,
+    /** returns the size of the reorder window (unsigned int *) */
+    UPIPE_RTPR_GET_WINDOW,
+    /** sets the size of the reorder window (unsigned int) */
+    UPIPE_RTPR_SET_WINDOW,
+    /** returns the reorder statistics (struct upipe_rtpr_stats *) */
+    UPIPE_RTPR_GET_STATS,
+    /** resets the reorder statistics (void) */
+    UPIPE_RTPR_RESET_STATS
 };
 
 /** @This returns the management structure for rtpr pipes.
@@ -80,6 +107,59 @@ static inline int upipe_rtpr_set_delay(struct upipe *upipe, uint64_t delay)
                          UPIPE_RTPR_SIGNATURE, delay);
 }
 
+/** @This returns the size of the reorder window.
+ *
+ * @param upipe description structure of the pipe
+ * @param window_p filled with the number of packets
+ * @return an error code
+ */
+static inline int upipe_rtpr_get_window(struct upipe *upipe,
+                                        unsigned int *window_p)
+{
+    return upipe_control(upipe, UPIPE_RTPR_GET_WINDOW,
+                         UPIPE_RTPR_SIGNATURE, window_p);
+}
+
+/** @This sets the size of the reorder window, that is the maximum distance
+ * between the next seqnum to output and the highest seqnum received.
+ * Packets beyond the window push older packets out before their date.
+ * Pending packets are output immediately.
+ *
+ * @param upipe description structure of the pipe
+ * @param window number of packets, power of 2 between 64 and 32768
+ * @return an error code
+ */
+static inline int upipe_rtpr_set_window(struct upipe *upipe,
+                                        unsigned int window)
+{
+    return upipe_control(upipe, UPIPE_RTPR_SET_WINDOW,
+                         UPIPE_RTPR_SIGNATURE, window);
+}
+
+/** @This returns the reorder statistics.
+ *
+ * @param upipe description structure of the pipe
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+static inline int upipe_rtpr_get_stats(struct upipe *upipe,
+                                       struct upipe_rtpr_stats *stats)
+{
+    return upipe_control(upipe, UPIPE_RTPR_GET_STATS,
+                         UPIPE_RTPR_SIGNATURE, stats);
+}
+
+/** @This resets the reorder statistics.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static inline int upipe_rtpr_reset_stats(struct upipe *upipe)
+{
+    return upipe_control(upipe, UPIPE_RTPR_RESET_STATS,
+                         UPIPE_RTPR_SIGNATURE);
+}
+
 #ifdef __cplusplus
 }
 #endif
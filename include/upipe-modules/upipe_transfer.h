@@ -94,10 +94,26 @@ enum upipe_xfer_mgr_command {
  * @param mutex mutual exclusion primitives to access the event loop, or NULL
  * @return pointer to manager
  */
-struct upipe_mgr *upipe_xfer_mgr_alloc(uint8_t queue_length,
+struct upipe_mgr *upipe_xfer_mgr_alloc(uint32_t queue_length,
                                        uint16_t msg_pool_depth,
                                        struct umutex *mutex);
 
+/** @This returns a management structure for xfer pipes, like
+ * @ref upipe_xfer_mgr_alloc, but with single-producer single-consumer
+ * internal queues, which are cheaper to cross. In that case the manager and
+ * all xfer pipes allocated from it must be allocated, controlled and released
+ * from a single thread, and the remote pipes must only throw events from the
+ * thread running the remote upump manager.
+ *
+ * @param queue_length maximum length of the internal queues
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param mutex mutual exclusion primitives to access the event loop, or NULL
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_xfer_mgr_alloc_spsc(uint32_t queue_length,
+                                            uint16_t msg_pool_depth,
+                                            struct umutex *mutex);
+
 /** @This attaches a upipe_xfer_mgr to a given event loop. The xfer manager
  * will call upump_alloc_XXX and upump_start, so it must be done in a context
  * where it is possible, which generally means that this command is done in
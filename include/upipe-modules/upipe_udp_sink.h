@@ -51,6 +51,12 @@ enum upipe_udpsink_command {
     UPIPE_UDPSINK_SET_FD,
     /** set remote address (const struct sockaddr *, socklen_t) **/
     UPIPE_UDPSINK_SET_PEER,
+    /** get the batch window (uint64_t *) **/
+    UPIPE_UDPSINK_GET_WINDOW,
+    /** set the batch window (uint64_t) **/
+    UPIPE_UDPSINK_SET_WINDOW,
+    /** set the clock used for kernel pacing (int) **/
+    UPIPE_UDPSINK_SET_TXTIME,
 };
 
 /** @This returns the management structure for all udp sinks.
@@ -96,6 +102,51 @@ static inline int upipe_udpsink_set_peer(struct upipe *upipe,
     return upipe_control(upipe, UPIPE_UDPSINK_SET_PEER, UPIPE_UDPSINK_SIGNATURE,
             addr, addrlen);
 }
+
+/** @This returns the batch window.
+ *
+ * @param upipe description structure of the pipe
+ * @param window_p filled in with the window in units of the 27 MHz clock
+ * @return an error code
+ */
+static inline int upipe_udpsink_get_window(struct upipe *upipe,
+                                           uint64_t *window_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_GET_WINDOW,
+                         UPIPE_UDPSINK_SIGNATURE, window_p);
+}
+
+/** @This sets the batch window. When it is not 0, the pipe sends held
+ * buffers whose deadlines are less than window ahead of the current time
+ * together with a single sendmmsg() call, so that they may leave up to
+ * window early. The default is 0 (one system call per buffer).
+ *
+ * @param upipe description structure of the pipe
+ * @param window window in units of the 27 MHz clock, 0 to disable
+ * @return an error code
+ */
+static inline int upipe_udpsink_set_window(struct upipe *upipe,
+                                           uint64_t window)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_SET_WINDOW,
+                         UPIPE_UDPSINK_SIGNATURE, window);
+}
+
+/** @This enables kernel pacing in batched mode. Each datagram then carries
+ * its deadline in a SCM_TXTIME control message, so that the kernel (for
+ * instance the ETF queueing discipline) releases it at the exact time
+ * instead of when the batch is sent.
+ *
+ * @param upipe description structure of the pipe
+ * @param clockid clock of the SO_TXTIME socket option (typically CLOCK_TAI),
+ * or -1 to disable
+ * @return an error code
+ */
+static inline int upipe_udpsink_set_txtime(struct upipe *upipe, int clockid)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_SET_TXTIME,
+                         UPIPE_UDPSINK_SIGNATURE, clockid);
+}
 #ifdef __cplusplus
 }
 #endif
@@ -47,6 +47,13 @@ enum upipe_udpsrc_command {
     UPIPE_UDPSRC_GET_FD,
     /** set socket fd (int) **/
     UPIPE_UDPSRC_SET_FD,
+    /** get the number of datagrams received per wakeup (unsigned int *) */
+    UPIPE_UDPSRC_GET_BATCH,
+    /** set the number of datagrams received per wakeup (unsigned int) */
+    UPIPE_UDPSRC_SET_BATCH,
+    /** set the memory allocator of the completion mode
+     * (struct umem_mgr *) */
+    UPIPE_UDPSRC_SET_UMEM_MGR,
 };
 
 /** @This extends uprobe_throw with specific events . */
@@ -81,6 +88,52 @@ static inline int upipe_udpsrc_set_fd(struct upipe *upipe, int fd)
                          fd);
 }
 
+/** @This returns the number of datagrams received per wakeup.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch_p filled in with the number of datagrams
+ * @return an error code
+ */
+static inline int upipe_udpsrc_get_batch(struct upipe *upipe,
+                                         unsigned int *batch_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_GET_BATCH,
+                         UPIPE_UDPSRC_SIGNATURE, batch_p);
+}
+
+/** @This sets the number of datagrams received per wakeup. If greater than 1,
+ * the pipe preallocates as many buffers and drains the socket with a single
+ * recvmmsg() call; each datagram is still output in its own uref, and is
+ * dated with the kernel reception timestamp when available. The default is 1.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch number of datagrams, 1 to disable batched mode
+ * @return an error code
+ */
+static inline int upipe_udpsrc_set_batch(struct upipe *upipe,
+                                         unsigned int batch)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_SET_BATCH,
+                         UPIPE_UDPSRC_SIGNATURE, batch);
+}
+
+/** @This sets the memory allocator of the completion mode. If the upump
+ * manager implements @ref UPUMP_TYPE_FD_RECV (for instance the io_uring
+ * manager), datagrams are then received by the event loop itself into
+ * buffers of this allocator, without a syscall per datagram, and output
+ * without copy. Otherwise the pipe falls back to the readiness-based modes.
+ *
+ * @param upipe description structure of the pipe
+ * @param umem_mgr memory allocator, or NULL to disable the completion mode
+ * @return an error code
+ */
+static inline int upipe_udpsrc_set_umem_mgr(struct upipe *upipe,
+                                            struct umem_mgr *umem_mgr)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_SET_UMEM_MGR,
+                         UPIPE_UDPSRC_SIGNATURE, umem_mgr);
+}
+
 /** @This returns the management structure for all udp socket sources.
  *
  * @return pointer to manager
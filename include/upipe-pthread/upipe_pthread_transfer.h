@@ -61,7 +61,7 @@ struct umutex;
  * @param attr pthread attributes
  * @return pointer to xfer manager
  */
-struct upipe_mgr *upipe_pthread_xfer_mgr_alloc(uint8_t queue_length,
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc(uint32_t queue_length,
         uint16_t msg_pool_depth, struct uprobe *uprobe_pthread_upump_mgr,
         upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
         uint16_t upump_blocker_pool_depth, struct umutex *mutex,
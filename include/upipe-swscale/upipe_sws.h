@@ -45,7 +45,11 @@ enum upipe_sws_command {
     /** set flags (int) */
     UPIPE_SWS_SET_FLAGS,
     /** get flags (int *) */
-    UPIPE_SWS_GET_FLAGS
+    UPIPE_SWS_GET_FLAGS,
+    /** set the number of slices converted in parallel (unsigned int) */
+    UPIPE_SWS_SET_THREADS,
+    /** get the number of slices converted in parallel (unsigned int *) */
+    UPIPE_SWS_GET_THREADS
 };
 
 /** @This gets the swscale flags.
@@ -72,6 +76,35 @@ static inline bool upipe_sws_set_flags(struct upipe *upipe, int flags)
                          flags);
 }
 
+/** @This returns the number of slices converted in parallel.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static inline int upipe_sws_get_threads(struct upipe *upipe,
+                                        unsigned int *threads_p)
+{
+    return upipe_control(upipe, UPIPE_SWS_GET_THREADS, UPIPE_SWS_SIGNATURE,
+                         threads_p);
+}
+
+/** @This sets the number of threads converting a picture, including the
+ * thread of the pipe. The output picture is split into as many horizontal
+ * slices, each converted by its own swscale context directly into the
+ * output buffer. The default is 1. This requires libswscale 6.1 or later.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads
+ * @return an error code
+ */
+static inline int upipe_sws_set_threads(struct upipe *upipe,
+                                        unsigned int threads)
+{
+    return upipe_control(upipe, UPIPE_SWS_SET_THREADS, UPIPE_SWS_SIGNATURE,
+                         threads);
+}
+
 /** @This returns the management structure for sws pipes.
  *
  * @return pointer to manager
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe swscale module producing several renditions in one pass
+ *
+ * A ladder pipe has one output subpipe per rendition, allocated with
+ * @ref upipe_flow_alloc_sub and a flow definition giving the picture
+ * format and size of the rendition, as for @ref upipe_sws_mgr_alloc.
+ *
+ * For each incoming picture, the renditions are computed from the largest
+ * to the smallest. Each rendition is scaled from the smallest picture
+ * already available (the source or a larger rendition) that is at least
+ * as large in both dimensions, so that for a 1080 to 720 to 360 ladder
+ * the source is only read once, and the 360 rendition is scaled from the
+ * 720 one, which is still hot in the cache.
+ */
+
+#ifndef _UPIPE_SWSCALE_UPIPE_SWS_LADDER_H_
+/** @hidden */
+#define _UPIPE_SWSCALE_UPIPE_SWS_LADDER_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+
+#define UPIPE_SWS_LADDER_SIGNATURE UBASE_FOURCC('s','w','s','l')
+#define UPIPE_SWS_LADDER_OUTPUT_SIGNATURE UBASE_FOURCC('s','w','s','o')
+
+/** @This returns the management structure for all sws ladder pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_sws_ladder_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short CRC32 of MPEG-2 PSI sections
+ *
+ * The CRC32 defined in ISO/IEC 13818-1 annex A (polynomial 0x04C11DB7,
+ * not reflected, initial value 0xFFFFFFFF, no final xor) protects all PSI
+ * and SI sections. The default implementation processes eight octets at
+ * a time with lookup tables, and the CPU-specific ones fold 64 octets at
+ * a time with carry-less multiplications.
+ */
+
+#ifndef _UPIPE_TS_UPIPE_TS_CRC_H_
+/** @hidden */
+#define _UPIPE_TS_UPIPE_TS_CRC_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/** initial value of the CRC of a PSI section */
+#define UPIPE_TS_CRC_INIT UINT32_C(0xffffffff)
+
+/** @This updates a CRC32 with the given octets, using the fastest
+ * implementation supported by the CPU.
+ *
+ * @param crc CRC of the previous octets, or @ref UPIPE_TS_CRC_INIT
+ * @param p octets to add
+ * @param size number of octets
+ * @return updated CRC
+ */
+uint32_t upipe_ts_crc32(uint32_t crc, const uint8_t *p, size_t size);
+
+/** @This updates a CRC32 with the given octets, using lookup tables.
+ *
+ * @param crc CRC of the previous octets, or @ref UPIPE_TS_CRC_INIT
+ * @param p octets to add
+ * @param size number of octets
+ * @return updated CRC
+ */
+uint32_t upipe_ts_crc32_c(uint32_t crc, const uint8_t *p, size_t size);
+
+#if defined(__i386__) || defined(__x86_64__)
+/** @This updates a CRC32 with the given octets, using PCLMULQDQ and SSSE3
+ * instructions (the CPU must support them).
+ *
+ * @param crc CRC of the previous octets, or @ref UPIPE_TS_CRC_INIT
+ * @param p octets to add
+ * @param size number of octets
+ * @return updated CRC
+ */
+uint32_t upipe_ts_crc32_pclmul(uint32_t crc, const uint8_t *p, size_t size);
+#endif
+
+#if defined(__aarch64__)
+/** @This updates a CRC32 with the given octets, using PMULL instructions
+ * (the CPU must support them).
+ *
+ * @param crc CRC of the previous octets, or @ref UPIPE_TS_CRC_INIT
+ * @param p octets to add
+ * @param size number of octets
+ * @return updated CRC
+ */
+uint32_t upipe_ts_crc32_pmull(uint32_t crc, const uint8_t *p, size_t size);
+#endif
+
+/** @This computes the CRC of a PSI section and writes it at the end of the
+ * section. It replaces bitstream's psi_set_crc.
+ *
+ * @param section PSI section, with a valid length field
+ */
+void upipe_ts_psi_set_crc(uint8_t *section);
+
+/** @This checks the CRC at the end of a PSI section. It replaces
+ * bitstream's psi_check_crc.
+ *
+ * @param section PSI section, with a valid length field
+ * @return false if the CRC is invalid
+ */
+bool upipe_ts_psi_check_crc(const uint8_t *section);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -122,6 +122,12 @@ enum upipe_ts_demux_mgr_command {
 
     UPIPE_TS_DEMUX_MGR_GET_SET_MGR(autof, AUTOF)
 #undef UPIPE_TS_DEMUX_MGR_GET_SET_MGR
+
+    /** returns the number of worker pipelines (unsigned int *) */
+    UPIPE_TS_DEMUX_MGR_GET_WORKERS,
+    /** sets the worker pipelines (unsigned int, struct upipe_mgr **,
+     * struct uprobe *, unsigned int) */
+    UPIPE_TS_DEMUX_MGR_SET_WORKERS,
 };
 
 /** @hidden */
@@ -176,6 +182,49 @@ UPIPE_TS_DEMUX_MGR_GET_SET_MGR2(ts_scte35d, TS_SCTE35D)
 UPIPE_TS_DEMUX_MGR_GET_SET_MGR2(autof, AUTOF)
 #undef UPIPE_TS_DEMUX_MGR_GET_SET_MGR2
 
+/** @This returns the number of worker pipelines used to run the framers.
+ *
+ * @param mgr pointer to manager
+ * @param nb_workers_p filled in with the number of workers
+ * @return an error code
+ */
+static inline int upipe_ts_demux_mgr_get_workers(struct upipe_mgr *mgr,
+                                                 unsigned int *nb_workers_p)
+{
+    return upipe_mgr_control(mgr, UPIPE_TS_DEMUX_MGR_GET_WORKERS,
+                             UPIPE_TS_DEMUX_SIGNATURE, nb_workers_p);
+}
+
+/** @This sets a pool of worker pipelines used to run the framers of the
+ * elementary streams in other threads. Each worker is a wlin manager
+ * (see @ref upipe_wlin_mgr_alloc), typically built on top of a pthread
+ * xfer manager. Programs are assigned to workers in a round-robin fashion,
+ * so all the framers of a program run in the same thread.
+ *
+ * Only the framers are transferred: PSI tables, PCR and timestamp handling
+ * stay in the thread of the demux, so flow definitions and clock references
+ * are still thrown in order. The autof manager must be set for workers to
+ * be used. This may only be called before any pipe has been allocated.
+ *
+ * @param mgr pointer to manager
+ * @param nb_workers number of workers, or 0 to disable them
+ * @param worker_mgrs array of nb_workers wlin managers
+ * @param uprobe_worker probe hierarchy for the pipes running in the workers
+ * (must be thread-safe)
+ * @param queue_length length of the queues to and from the workers
+ * @return an error code
+ */
+static inline int upipe_ts_demux_mgr_set_workers(struct upipe_mgr *mgr,
+                                                 unsigned int nb_workers,
+                                                 struct upipe_mgr **worker_mgrs,
+                                                 struct uprobe *uprobe_worker,
+                                                 unsigned int queue_length)
+{
+    return upipe_mgr_control(mgr, UPIPE_TS_DEMUX_MGR_SET_WORKERS,
+                             UPIPE_TS_DEMUX_SIGNATURE, nb_workers,
+                             worker_mgrs, uprobe_worker, queue_length);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -158,6 +158,10 @@ enum upipe_ts_mux_command {
     /** prepares the next access unit/section for the given date
      * (uint64_t, uint64_t) */
     UPIPE_TS_MUX_PREPARE,
+    /** returns true if output packets are contiguous (bool *) */
+    UPIPE_TS_MUX_GET_CONTIGUOUS,
+    /** sets whether output packets are contiguous (int) */
+    UPIPE_TS_MUX_SET_CONTIGUOUS,
 
     /** ts_encaps commands begin here */
     UPIPE_TS_MUX_ENCAPS = UPIPE_CONTROL_LOCAL + 0x1000,
@@ -712,6 +716,40 @@ static inline int upipe_ts_mux_prepare(struct upipe *upipe, uint64_t cr_sys,
                                UPIPE_TS_MUX_SIGNATURE, cr_sys, latency);
 }
 
+/** @This returns whether output packets are written in a single contiguous
+ * buffer.
+ *
+ * @param upipe description structure of the pipe
+ * @param contiguous_p filled in with true if contiguous mode is enabled
+ * @return an error code
+ */
+static inline int upipe_ts_mux_get_contiguous(struct upipe *upipe,
+                                              bool *contiguous_p)
+{
+    return upipe_control(upipe, UPIPE_TS_MUX_GET_CONTIGUOUS,
+                         UPIPE_TS_MUX_SIGNATURE, contiguous_p);
+}
+
+/** @This sets whether output packets are written in a single contiguous
+ * buffer. In contiguous mode, each output uref carries one block of output
+ * size octets allocated from the ubuf manager, and the TS headers and
+ * payloads are copied into it, instead of chaining one small segment per
+ * header, payload and padding. This avoids per-packet allocations and lets
+ * sinks send each uref with a single iovec. This may only be called
+ * between two output urefs, and in contiguous mode the output size may
+ * only be changed between two output urefs too.
+ *
+ * @param upipe description structure of the pipe
+ * @param contiguous true to enable contiguous mode
+ * @return an error code
+ */
+static inline int upipe_ts_mux_set_contiguous(struct upipe *upipe,
+                                              bool contiguous)
+{
+    return upipe_control(upipe, UPIPE_TS_MUX_SET_CONTIGUOUS,
+                         UPIPE_TS_MUX_SIGNATURE, contiguous ? 1 : 0);
+}
+
 /** @This returns a description string for local commands.
  *
  * @param cmd control command
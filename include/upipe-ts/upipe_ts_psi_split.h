@@ -34,12 +34,86 @@ extern "C" {
 #define UPIPE_TS_PSI_SPLIT_SIGNATURE UBASE_FOURCC('t','s','p','Y')
 #define UPIPE_TS_PSI_SPLIT_OUTPUT_SIGNATURE UBASE_FOURCC('t','s','p','Z')
 
+/** @This extends upipe_command with specific commands for ts_psi_split. */
+enum upipe_ts_psi_split_command {
+    UPIPE_TS_PSI_SPLIT_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the section counters (uint64_t *, uint64_t *) */
+    UPIPE_TS_PSI_SPLIT_GET_STATS
+};
+
+/** @This extends upipe_command with specific commands for ts_psi_split
+ * outputs. */
+enum upipe_ts_psi_split_output_command {
+    UPIPE_TS_PSI_SPLIT_OUTPUT_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns whether repeated sections are dropped (int *) */
+    UPIPE_TS_PSI_SPLIT_OUTPUT_GET_CACHE,
+    /** sets whether repeated sections are dropped (int) */
+    UPIPE_TS_PSI_SPLIT_OUTPUT_SET_CACHE
+};
+
 /** @This returns the management structure for all ts_psi_split pipes.
  *
  * @return pointer to manager
  */
 struct upipe_mgr *upipe_ts_psi_split_mgr_alloc(void);
 
+/** @This returns the number of sections received by the pipe, and the
+ * number of times a section was not forwarded to an output because the
+ * output had already received it.
+ *
+ * @param upipe description structure of the pipe
+ * @param sections_p filled in with the number of received sections
+ * @param unchanged_p filled in with the number of dropped repetitions
+ * @return an error code
+ */
+static inline int upipe_ts_psi_split_get_stats(struct upipe *upipe,
+                                               uint64_t *sections_p,
+                                               uint64_t *unchanged_p)
+{
+    return upipe_control(upipe, UPIPE_TS_PSI_SPLIT_GET_STATS,
+                         UPIPE_TS_PSI_SPLIT_SIGNATURE, sections_p,
+                         unchanged_p);
+}
+
+/** @This returns whether repeated sections are dropped by an output.
+ *
+ * @param upipe description structure of the output subpipe
+ * @param cache_p filled in with true if repeated sections are dropped
+ * @return an error code
+ */
+static inline int upipe_ts_psi_split_output_get_cache(struct upipe *upipe,
+                                                      int *cache_p)
+{
+    return upipe_control(upipe, UPIPE_TS_PSI_SPLIT_OUTPUT_GET_CACHE,
+                         UPIPE_TS_PSI_SPLIT_OUTPUT_SIGNATURE, cache_p);
+}
+
+/** @This sets whether repeated sections are dropped by an output.
+ *
+ * When enabled, the output keeps the table id, table id extension,
+ * version, section number and CRC of the sections with a valid CRC it
+ * has forwarded, and drops the identical sections that follow, before
+ * they reach the decoder. A repeated section is still forwarded now and
+ * then, in case the decoder rejected its table. When a section changes,
+ * all sections are forwarded again until the new table is complete. This
+ * is only suitable for decoders that ignore repetitions of a table they
+ * already have (NIT, SDT, EIT), not for the PAT and PMT decoders which
+ * signal random access points.
+ *
+ * @param upipe description structure of the output subpipe
+ * @param cache true to drop repeated sections
+ * @return an error code
+ */
+static inline int upipe_ts_psi_split_output_set_cache(struct upipe *upipe,
+                                                      bool cache)
+{
+    return upipe_control(upipe, UPIPE_TS_PSI_SPLIT_OUTPUT_SET_CACHE,
+                         UPIPE_TS_PSI_SPLIT_OUTPUT_SIGNATURE,
+                         cache ? 1 : 0);
+}
+
 #ifdef __cplusplus
 }
 #endif
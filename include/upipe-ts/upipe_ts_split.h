@@ -45,6 +45,49 @@ enum uprobe_ts_split_event {
     UPROBE_TS_SPLIT_DEL_PID
 };
 
+/** @This extends upipe_command with specific commands for ts split. */
+enum upipe_ts_split_command {
+    UPIPE_TS_SPLIT_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns true if packets are aggregated per PID (bool *) */
+    UPIPE_TS_SPLIT_GET_AGGREGATE,
+    /** sets whether packets are aggregated per PID (bool) */
+    UPIPE_TS_SPLIT_SET_AGGREGATE
+};
+
+/** @This returns whether the packets of a multi-packet block are aggregated
+ * per PID.
+ *
+ * @param upipe description structure of the pipe
+ * @param aggregate_p filled in with true if packets are aggregated
+ * @return an error code
+ */
+static inline int upipe_ts_split_get_aggregate(struct upipe *upipe,
+                                               bool *aggregate_p)
+{
+    return upipe_control(upipe, UPIPE_TS_SPLIT_GET_AGGREGATE,
+                         UPIPE_TS_SPLIT_SIGNATURE, aggregate_p);
+}
+
+/** @This sets whether the packets of a multi-packet block are aggregated per
+ * PID. The pipe accepts blocks containing several TS packets (for instance
+ * straight from a file or UDP source); by default every packet is sliced out
+ * and output in its own uref. In aggregate mode, all the packets of a PID in
+ * an input block are output in a single uref, which outputs must be able to
+ * handle; a PID added while a block is being output then only gets the
+ * packets of the next blocks.
+ *
+ * @param upipe description structure of the pipe
+ * @param aggregate true to aggregate packets per PID
+ * @return an error code
+ */
+static inline int upipe_ts_split_set_aggregate(struct upipe *upipe,
+                                               bool aggregate)
+{
+    return upipe_control(upipe, UPIPE_TS_SPLIT_SET_AGGREGATE,
+                         UPIPE_TS_SPLIT_SIGNATURE, aggregate ? 1 : 0);
+}
+
 /** @This returns the management structure for all ts_split pipes.
  *
  * @return pointer to manager
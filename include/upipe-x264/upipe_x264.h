@@ -40,6 +40,40 @@ extern "C" {
 
 #define UPIPE_X264_SIGNATURE UBASE_FOURCC('x','2','6','4')
 
+/** @This extends @ref uprobe_event with specific x264 events. */
+enum uprobe_x264_event {
+    UPROBE_X264_SENTINEL = UPROBE_LOCAL,
+
+    /** a frame was output, with the time elapsed since the input of its
+     * picture in units of a 27 MHz clock, if a uclock is attached
+     * (uint64_t) */
+    UPROBE_X264_LATENCY,
+};
+
+/** @This converts @ref uprobe_x264_event to a string.
+ *
+ * @param event event to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_x264_event_str(int event)
+{
+    switch ((enum uprobe_x264_event)event) {
+    UBASE_CASE_TO_STR(UPROBE_X264_LATENCY);
+    case UPROBE_X264_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This is a list of presets trading latency for throughput. */
+enum upipe_x264_latency_preset {
+    /** sliced threads, no lookahead and no B frames */
+    UPIPE_X264_LATENCY_PRESET_LOW,
+    /** sliced threads and a short rate control lookahead */
+    UPIPE_X264_LATENCY_PRESET_BALANCED,
+    /** frame threads and automatic threaded lookahead */
+    UPIPE_X264_LATENCY_PRESET_THROUGHPUT,
+};
+
 /** @This extends upipe_command with specific commands for x264. */
 enum upipe_x264_command {
     UPIPE_X264_SENTINEL = UPIPE_CONTROL_LOCAL,
@@ -63,7 +97,27 @@ enum upipe_x264_command {
     UPIPE_X264_SET_SC_LATENCY,
 
     /** set slice type enforcement mode (int) */
-    UPIPE_X264_SET_SLICE_TYPE_ENFORCE
+    UPIPE_X264_SET_SLICE_TYPE_ENFORCE,
+
+    /** apply a latency preset (int) */
+    UPIPE_X264_SET_LATENCY_PRESET,
+
+    /** set sliced threads mode (int) */
+    UPIPE_X264_SET_SLICED_THREADS,
+
+    /** set the number of frames of threaded lookahead (int) */
+    UPIPE_X264_SET_SYNC_LOOKAHEAD,
+
+    /** set the VBV maximum rate and buffer size (uint64_t, uint64_t) */
+    UPIPE_X264_SET_VBV,
+
+    /** returns the length of the queue of the encoding thread
+     * (unsigned int *) */
+    UPIPE_X264_GET_THREADED,
+
+    /** encodes in a dedicated thread with a queue of the given length
+     * (unsigned int) */
+    UPIPE_X264_SET_THREADED
 };
 
 /** @This reconfigures encoder with updated parameters.
@@ -151,6 +205,105 @@ static inline int upipe_x264_set_slice_type_enforce(struct upipe *upipe,
                          UPIPE_X264_SIGNATURE, enforce ? 1 : 0);
 }
 
+/** @This applies a latency preset on top of the current parameters. It is
+ * typically called after @ref upipe_x264_set_default_preset, and before
+ * the first picture, since the threading and lookahead parameters cannot
+ * be reconfigured once the encoder is open.
+ *
+ * @param upipe description structure of the pipe
+ * @param preset latency preset
+ * @return an error code
+ */
+static inline int upipe_x264_set_latency_preset(struct upipe *upipe,
+        enum upipe_x264_latency_preset preset)
+{
+    return upipe_control(upipe, UPIPE_X264_SET_LATENCY_PRESET,
+                         UPIPE_X264_SIGNATURE, (int)preset);
+}
+
+/** @This sets the sliced threads mode. Sliced threads encode each picture
+ * with several threads, which does not add latency, while frame threads
+ * encode several pictures in parallel, which adds one frame of latency per
+ * thread. This must be called before the first picture.
+ *
+ * @param upipe description structure of the pipe
+ * @param sliced true for sliced threads, false for frame threads
+ * @return an error code
+ */
+static inline int upipe_x264_set_sliced_threads(struct upipe *upipe,
+                                                bool sliced)
+{
+    return upipe_control(upipe, UPIPE_X264_SET_SLICED_THREADS,
+                         UPIPE_X264_SIGNATURE, sliced ? 1 : 0);
+}
+
+/** @This sets the number of frames buffered by the threaded lookahead.
+ * This must be called before the first picture.
+ *
+ * @param upipe description structure of the pipe
+ * @param frames number of frames, 0 to disable threaded lookahead, or -1
+ * to let x264 choose
+ * @return an error code
+ */
+static inline int upipe_x264_set_sync_lookahead(struct upipe *upipe,
+                                                int frames)
+{
+    return upipe_control(upipe, UPIPE_X264_SET_SYNC_LOOKAHEAD,
+                         UPIPE_X264_SIGNATURE, frames);
+}
+
+/** @This sets the VBV parameters. upipe_x264_reconfigure must be called to
+ * apply changes on an open encoder.
+ *
+ * @param upipe description structure of the pipe
+ * @param octetrate maximum octet rate, or 0 to disable VBV
+ * @param buffer_size size of the VBV buffer in octets
+ * @return an error code
+ */
+static inline int upipe_x264_set_vbv(struct upipe *upipe, uint64_t octetrate,
+                                     uint64_t buffer_size)
+{
+    return upipe_control(upipe, UPIPE_X264_SET_VBV, UPIPE_X264_SIGNATURE,
+                         octetrate, buffer_size);
+}
+
+/** @This returns the length of the queue of the encoding thread.
+ *
+ * @param upipe description structure of the pipe
+ * @param queue_length_p filled in with the length, or 0 if pictures are
+ * encoded in the thread of the pipe
+ * @return an error code
+ */
+static inline int upipe_x264_get_threaded(struct upipe *upipe,
+                                          unsigned int *queue_length_p)
+{
+    return upipe_control(upipe, UPIPE_X264_GET_THREADED, UPIPE_X264_SIGNATURE,
+                         queue_length_p);
+}
+
+/** @This moves the calls to x264 to a dedicated thread, so that encoding
+ * does not block the event loop of the pipe. Incoming pictures are queued
+ * to the thread; when the queue is full, the input of the pipe is blocked.
+ * Encoded frames are sent back and output from the event loop, which
+ * requires a upump manager. The latency announced in the flow definition
+ * grows by the length of the queue.
+ *
+ * x264 logs and errors are then thrown from the encoding thread, so the
+ * probe hierarchy must be thread-safe. Speedcontrol is not available in
+ * this mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param queue_length maximum number of pictures waiting for the encoding
+ * thread, or 0 to encode in the thread of the pipe (default)
+ * @return an error code
+ */
+static inline int upipe_x264_set_threaded(struct upipe *upipe,
+                                          unsigned int queue_length)
+{
+    return upipe_control(upipe, UPIPE_X264_SET_THREADED, UPIPE_X264_SIGNATURE,
+                         queue_length);
+}
+
 /** @This returns the management structure for x264 pipes.
  *
  * @return pointer to manager
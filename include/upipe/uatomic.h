@@ -49,13 +49,27 @@ extern "C" {
  * Preferred method: gcc atomic operations
  */
 
-/** @This defines an atomic 32-bits unsigned integer. ARM platforms do not
- * support larger atomic operations. */
+/** @This defines an atomic 32-bits unsigned integer. */
 typedef volatile uint32_t uatomic_uint32_t;
 
 /** @This defines an atomic pointer. */
 typedef void * volatile uatomic_ptr_t;
 
+#ifdef __ATOMIC_ACQUIRE
+/** @hidden */
+#define UATOMIC_STORE_RELEASE(obj, value)                                   \
+    __atomic_store_n(obj, value, __ATOMIC_RELEASE)
+/** @hidden */
+#define UATOMIC_LOAD_ACQUIRE(obj) __atomic_load_n(obj, __ATOMIC_ACQUIRE)
+#else
+/** @hidden */
+#define UATOMIC_STORE_RELEASE(obj, value)                                   \
+    do { __sync_synchronize(); *(obj) = (value); } while (0)
+/** @hidden */
+#define UATOMIC_LOAD_ACQUIRE(obj)                                           \
+    ({ __typeof__(*(obj)) _v = *(obj); __sync_synchronize(); _v; })
+#endif
+
 /** @This defines a set of functions to manipulate atomic variables. */
 #define UATOMIC_TEMPLATE(type, ctype, atomictype)                           \
 /** @This initializes a uatomic variable. It must be executed before any    \
@@ -89,6 +103,29 @@ static inline ctype type##_load(atomictype *obj)                            \
     __sync_synchronize();                                                   \
     return *obj;                                                            \
 }                                                                           \
+/** @This sets the value of the uatomic variable, with release semantics:  \
+ * memory accesses before this call may not be reordered after it. Unlike  \
+ * @ref uatomic_store, it does not order the store with later loads.        \
+ *                                                                          \
+ * @param obj pointer to a uatomic variable                                 \
+ * @param value value to set                                                \
+ */                                                                         \
+static inline void type##_store_release(atomictype *obj, ctype value)       \
+{                                                                           \
+    UATOMIC_STORE_RELEASE(obj, value);                                      \
+}                                                                           \
+/** @This returns the value of the uatomic variable, with acquire           \
+ * semantics: memory accesses after this call may not be reordered before   \
+ * it. Unlike @ref uatomic_load, it does not order the load with earlier    \
+ * stores.                                                                  \
+ *                                                                          \
+ * @param obj pointer to a uatomic variable                                 \
+ * @return the value                                                        \
+ */                                                                         \
+static inline ctype type##_load_acquire(atomictype *obj)                    \
+{                                                                           \
+    return UATOMIC_LOAD_ACQUIRE(obj);                                       \
+}                                                                           \
 /** @This atomically replaces the uatomic variable, if it contains an       \
  * expected value, with a desired value.                                    \
  *                                                                          \
@@ -116,7 +153,172 @@ static inline void type##_clean(atomictype *obj)                            \
 }
 UATOMIC_TEMPLATE(uatomic, uint32_t, uatomic_uint32_t)
 UATOMIC_TEMPLATE(uatomic_ptr, void *, uatomic_ptr_t)
+
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8) && defined(__ATOMIC_ACQUIRE)
+/** @This defines an atomic 64-bits unsigned integer. */
+typedef volatile uint64_t uatomic_uint64_t __attribute__((aligned(8)));
+
+/*
+ * Plain 64-bits accesses are split in two on 32-bits platforms (i686,
+ * ARMv7), so loads and stores also use atomic builtins.
+ */
+
+/** @This initializes a uatomic variable. It must be executed before any
+ * other uatomic call. It is not thread-safe.
+ *
+ * @param obj pointer to a uatomic variable
+ * @param value initial value
+ */
+static inline void uatomic64_init(uatomic_uint64_t *obj, uint64_t value)
+{
+    __atomic_store_n(obj, value, __ATOMIC_SEQ_CST);
+}
+
+/** @This sets the value of the uatomic variable.
+ *
+ * @param obj pointer to a uatomic variable
+ * @param value value to set
+ */
+static inline void uatomic64_store(uatomic_uint64_t *obj, uint64_t value)
+{
+    __atomic_store_n(obj, value, __ATOMIC_SEQ_CST);
+}
+
+/** @This returns the value of the uatomic variable.
+ *
+ * @param obj pointer to a uatomic variable
+ * @return the value
+ */
+static inline uint64_t uatomic64_load(uatomic_uint64_t *obj)
+{
+    return __atomic_load_n(obj, __ATOMIC_SEQ_CST);
+}
+
+/** @This sets the value of the uatomic variable, with release semantics.
+ *
+ * @param obj pointer to a uatomic variable
+ * @param value value to set
+ */
+static inline void uatomic64_store_release(uatomic_uint64_t *obj,
+                                           uint64_t value)
+{
+    __atomic_store_n(obj, value, __ATOMIC_RELEASE);
+}
+
+/** @This returns the value of the uatomic variable, with acquire
+ * semantics.
+ *
+ * @param obj pointer to a uatomic variable
+ * @return the value
+ */
+static inline uint64_t uatomic64_load_acquire(uatomic_uint64_t *obj)
+{
+    return __atomic_load_n(obj, __ATOMIC_ACQUIRE);
+}
+
+/** @This atomically replaces the uatomic variable, if it contains an
+ * expected value, with a desired value.
+ *
+ * @param obj pointer to a uatomic variable
+ * @param expected reference to expected value, overwritten with actual
+ * value if it fails
+ * @param desired desired value
+ * @return false if the exchange failed
+ */
+static inline bool uatomic64_compare_exchange(uatomic_uint64_t *obj,
+                                              uint64_t *expected,
+                                              uint64_t desired)
+{
+    return __atomic_compare_exchange_n(obj, expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/** @This cleans up the uatomic variable.
+ *
+ * @param obj pointer to a uatomic variable
+ */
+static inline void uatomic64_clean(uatomic_uint64_t *obj)
+{
+}
+
+#else /* mkdoc:skip */
+/*
+ * Some platforms (ARMv5, i386) only support 32-bits atomic operations,
+ * so protect 64-bits values with a spinlock.
+ */
+typedef struct uatomic_uint64_t {
+    uatomic_uint32_t lock;
+    uint64_t value;
+} uatomic_uint64_t;
+
+static inline void uatomic64_lock(uatomic_uint64_t *obj)
+{
+    while (unlikely(!__sync_bool_compare_and_swap(&obj->lock, 0, 1)));
+}
+
+static inline void uatomic64_unlock(uatomic_uint64_t *obj)
+{
+    __sync_lock_release(&obj->lock);
+}
+
+static inline void uatomic64_init(uatomic_uint64_t *obj, uint64_t value)
+{
+    obj->lock = 0;
+    obj->value = value;
+    __sync_synchronize();
+}
+
+static inline void uatomic64_store(uatomic_uint64_t *obj, uint64_t value)
+{
+    uatomic64_lock(obj);
+    obj->value = value;
+    uatomic64_unlock(obj);
+    __sync_synchronize();
+}
+
+static inline uint64_t uatomic64_load(uatomic_uint64_t *obj)
+{
+    uint64_t ret;
+    uatomic64_lock(obj);
+    ret = obj->value;
+    uatomic64_unlock(obj);
+    return ret;
+}
+
+static inline void uatomic64_store_release(uatomic_uint64_t *obj,
+                                           uint64_t value)
+{
+    uatomic64_store(obj, value);
+}
+
+static inline uint64_t uatomic64_load_acquire(uatomic_uint64_t *obj)
+{
+    return uatomic64_load(obj);
+}
+
+static inline bool uatomic64_compare_exchange(uatomic_uint64_t *obj,
+                                              uint64_t *expected,
+                                              uint64_t desired)
+{
+    bool ret;
+    uatomic64_lock(obj);
+    ret = obj->value == *expected;
+    if (likely(ret))
+        obj->value = desired;
+    else
+        *expected = obj->value;
+    uatomic64_unlock(obj);
+    return ret;
+}
+
+static inline void uatomic64_clean(uatomic_uint64_t *obj)
+{
+}
+#endif
+
 #undef UATOMIC_TEMPLATE
+#undef UATOMIC_STORE_RELEASE
+#undef UATOMIC_LOAD_ACQUIRE
 
 /** @This increments a uatomic variable.
  *
@@ -176,6 +378,14 @@ static inline ctype type##_load(atomictype *obj)                            \
     sem_post(&obj->lock);                                                   \
     return ret;                                                             \
 }                                                                           \
+static inline void type##_store_release(atomictype *obj, ctype value)       \
+{                                                                           \
+    type##_store(obj, value);                                               \
+}                                                                           \
+static inline ctype type##_load_acquire(atomictype *obj)                    \
+{                                                                           \
+    return type##_load(obj);                                                \
+}                                                                           \
 static inline bool type##_compare_exchange(atomictype *obj,                 \
                                            ctype *expected, ctype desired)  \
 {                                                                           \
@@ -195,6 +405,7 @@ static inline void type##_clean(atomictype *obj)                            \
 }
 UATOMIC_TEMPLATE(uatomic, uint32_t, uatomic_uint32_t)
 UATOMIC_TEMPLATE(uatomic_ptr, void *, uatomic_ptr_t)
+UATOMIC_TEMPLATE(uatomic64, uint64_t, uatomic_uint64_t)
 #undef UATOMIC_TEMPLATE
 
 static inline uint32_t uatomic_fetch_add(uatomic_uint32_t *obj,
@@ -42,11 +42,15 @@ extern "C" {
 
 /** @hidden */
 struct umem_mgr;
+/** @hidden */
+struct umem;
 
 /** @This is the signature to use to allocate from an ubuf_pic plane. */
 #define UBUF_BLOCK_MEM_ALLOC_FROM_PIC UBASE_FOURCC('m','e','m','p')
 /** @This is the signature to use to allocate from an ubuf_sound plane. */
 #define UBUF_BLOCK_MEM_ALLOC_FROM_SOUND UBASE_FOURCC('m','e','m','s')
+/** @This is the signature to use to allocate from an existing umem. */
+#define UBUF_BLOCK_MEM_ALLOC_FROM_UMEM UBASE_FOURCC('m','e','m','u')
 
 /** @This returns a new ubuf from the block mem allocator, using a chroma of
  * a ubuf pic mem.
@@ -76,6 +80,24 @@ static inline struct ubuf *ubuf_block_mem_alloc_from_sound(struct ubuf_mgr *mgr,
     return ubuf_alloc(mgr, UBUF_BLOCK_MEM_ALLOC_FROM_SOUND, ubuf_sound, channel);
 }
 
+/** @This returns a new ubuf from the block mem allocator, using an existing
+ * umem buffer. In case of success, the ubuf takes ownership of the umem, which
+ * is freed with @ref umem_free when the last reference is released. This
+ * allows to wrap memory not allocated by the umem manager of the allocator
+ * (for instance a file mapping) without copying it.
+ *
+ * @param mgr management structure for this ubuf type
+ * @param umem umem structure to take ownership of
+ * @param offset offset of the block in the umem buffer, in octets
+ * @param size size of the block, in octets
+ * @return pointer to ubuf or NULL in case of failure
+ */
+static inline struct ubuf *ubuf_block_mem_alloc_from_umem(struct ubuf_mgr *mgr,
+        struct umem *umem, int offset, int size)
+{
+    return ubuf_alloc(mgr, UBUF_BLOCK_MEM_ALLOC_FROM_UMEM, umem, offset, size);
+}
+
 /** @This allocates a new instance of the ubuf manager for block formats
  * using umem.
  *
@@ -324,6 +324,45 @@ static inline int ubuf_pic_resize(struct ubuf *ubuf, int hskip, int vskip,
                         new_hsize, new_vsize);
 }
 
+/** @This parses the name of a plane holding a single component, such
+ * as "y8", "a8", "u10l" or "y16b", and returns the size of its samples.
+ * Samples of more than 8 bits are stored in 16 bits, in the order given by
+ * the "l" (little endian) or "b" (big endian) suffix.
+ *
+ * @param chroma chroma type
+ * @param depth_p filled in with the number of significant bits per sample
+ * @param big_endian_p filled in with true if 16-bit samples are stored in
+ * big endian order (may be NULL)
+ * @return an error code, UBASE_ERR_INVALID for planes of packed
+ * components such as "u8y8v8y8" or "r8g8b8"
+ */
+static inline int ubuf_pic_chroma_depth(const char *chroma,
+                                        unsigned int *depth_p,
+                                        bool *big_endian_p)
+{
+    const char *p = chroma;
+    if (*p < 'a' || *p > 'z')
+        return UBASE_ERR_INVALID;
+    while (*p >= 'a' && *p <= 'z')
+        p++;
+    unsigned int depth = 0;
+    while (*p >= '0' && *p <= '9')
+        depth = depth * 10 + *p++ - '0';
+    if (depth == 8 && !*p) {
+        if (big_endian_p != NULL)
+            *big_endian_p = false;
+    } else if (depth > 8 && depth <= 16 && (*p == 'l' || *p == 'b') &&
+               !p[1]) {
+        if (big_endian_p != NULL)
+            *big_endian_p = *p == 'b';
+    } else
+        return UBASE_ERR_INVALID;
+
+    if (depth_p != NULL)
+        *depth_p = depth;
+    return UBASE_ERR_NONE;
+}
+
 /** @This blits a picture ubuf to another ubuf.
  *
  * @param dest destination ubuf
@@ -341,115 +380,22 @@ static inline int ubuf_pic_resize(struct ubuf *ubuf, int hskip, int vskip,
  * @param alpha alpha multiplier
  * @param threshold alpha blending method
  *    0 means ignore alpha
- *    255 means blends src and dest together using alpha levels (slow)
+ *    255 means blends src and dest together using alpha levels
  *    Any value in between means using the src pixels if and only if
  *      their alpha value is more than this value
  * @return an error code
+ *
+ * Planes of 8-bit components are blended octet by octet. Planes whose
+ * chroma declares a depth of 9 to 16 bits (such as "y10l" or "u16b") are
+ * blended sample by sample, the alpha plane being sampled once per sample.
+ * The inner loops use SSE2 or AVX2 when the CPU supports them.
  */
-static inline int ubuf_pic_blit_alpha(struct ubuf *dest, struct ubuf *src,
-                                int dest_hoffset, int dest_voffset,
-                                int src_hoffset, int src_voffset,
-                                int extract_hsize, int extract_vsize,
-                                const uint8_t *alpha_plane, int alpha_stride,
-                                const uint8_t alpha, const uint8_t threshold)
-{
-    if (alpha_plane == NULL && alpha < threshold)
-        return UBASE_ERR_NONE; /* nothing to do */
-
-    uint8_t src_macropixel;
-    UBASE_RETURN(ubuf_pic_size(src, NULL, NULL, &src_macropixel))
-    uint8_t dest_macropixel;
-    UBASE_RETURN(ubuf_pic_size(dest, NULL, NULL, &dest_macropixel))
-    if (unlikely(dest_macropixel != src_macropixel))
-        return UBASE_ERR_INVALID;
-
-    const char *chroma = NULL;
-    while (ubase_check(ubuf_pic_plane_iterate(dest, &chroma)) &&
-           chroma != NULL) {
-        size_t src_stride;
-        uint8_t src_hsub, src_vsub, src_macropixel_size;
-        UBASE_RETURN(ubuf_pic_plane_size(src, chroma, &src_stride,
-                    &src_hsub, &src_vsub, &src_macropixel_size))
-
-        size_t dest_stride;
-        uint8_t dest_hsub, dest_vsub, dest_macropixel_size;
-        UBASE_RETURN(ubuf_pic_plane_size(dest, chroma,
-                     &dest_stride, &dest_hsub, &dest_vsub,
-                     &dest_macropixel_size))
-
-        if (unlikely(src_hsub != dest_hsub || src_vsub != dest_vsub ||
-                     src_macropixel_size != dest_macropixel_size))
-            return UBASE_ERR_INVALID;
-
-        uint8_t *dest_buffer;
-        const uint8_t *src_buffer;
-        UBASE_RETURN(ubuf_pic_plane_write(dest, chroma,
-                    dest_hoffset, dest_voffset,
-                    extract_hsize, extract_vsize, &dest_buffer))
-        int err = ubuf_pic_plane_read(src, chroma, src_hoffset, src_voffset,
-                                      extract_hsize, extract_vsize,
-                                      &src_buffer);
-        if (unlikely(!ubase_check(err))) {
-            ubuf_pic_plane_unmap(dest, chroma,
-                                 dest_hoffset, dest_voffset,
-                                 extract_hsize, extract_vsize);
-            return err;
-        }
-
-        int plane_hsize = extract_hsize / src_hsub / src_macropixel *
-                          src_macropixel_size;
-        int plane_vsize = extract_vsize / src_vsub;
-
-        for (int i = 0; i < plane_vsize; i++) {
-            if ((!alpha_plane && alpha == 0xff) || threshold == 0) {
-                memcpy(dest_buffer, src_buffer, plane_hsize);
-            } else if (!alpha_plane) {
-                for (int j = 0; j < plane_hsize; j++) {
-                    dest_buffer[j] = (dest_buffer[j] * (0xff - alpha) + src_buffer[j] * alpha) / 0xff;
-                }
-            } else if (threshold != 0xff) {
-                /* This is an on/off blending
-                 * if alpha is over the threshold, we use the subpicture pixel.
-                 */
-                if (alpha == 0xff) {
-                    for (int j = 0; j < plane_hsize; j++) {
-                        const uint8_t a = alpha_plane[alpha_stride * (i * src_vsub) + j * src_hsub];
-                        if (a > threshold) dest_buffer[j] = src_buffer[j];
-                    }
-                } else {
-                    for (int j = 0; j < plane_hsize; j++) {
-                        const uint8_t a = (uint16_t)alpha_plane[alpha_stride * (i * src_vsub) + j * src_hsub] * (uint16_t)alpha / 0xff;
-                        if (a > threshold) dest_buffer[j] = src_buffer[j];
-                    }
-                }
-            } else {
-                /* smooth and slow blending */
-                if (alpha == 0xff) {
-                    for (int j = 0; j < plane_hsize; j++) {
-                        const uint8_t a = alpha_plane[alpha_stride * (i * src_vsub) + j * src_hsub];
-                        dest_buffer[j] = (dest_buffer[j] * (0xff - a) + src_buffer[j] * a) / 0xff;
-                    }
-                } else {
-                    for (int j = 0; j < plane_hsize; j++) {
-                        const uint8_t a = (uint16_t)alpha_plane[alpha_stride * (i * src_vsub) + j * src_hsub] * (uint16_t)alpha / 0xff;
-                        dest_buffer[j] = (dest_buffer[j] * (0xff - a) + src_buffer[j] * a) / 0xff;
-                    }
-                }
-            }
-            dest_buffer += dest_stride;
-            src_buffer += src_stride;
-        }
-
-        err = ubuf_pic_plane_unmap(dest, chroma,
-                                   dest_hoffset, dest_voffset,
-                                   extract_hsize, extract_vsize);
-        UBASE_RETURN(ubuf_pic_plane_unmap(src, chroma,
-                                          src_hoffset, src_voffset,
-                                          extract_hsize, extract_vsize))
-        UBASE_RETURN(err)
-    }
-    return UBASE_ERR_NONE;
-}
+int ubuf_pic_blit_alpha(struct ubuf *dest, struct ubuf *src,
+                        int dest_hoffset, int dest_voffset,
+                        int src_hoffset, int src_voffset,
+                        int extract_hsize, int extract_vsize,
+                        const uint8_t *alpha_plane, int alpha_stride,
+                        const uint8_t alpha, const uint8_t threshold);
 
 /** @This blits a picture ubuf to another ubuf.
  *
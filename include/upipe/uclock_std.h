@@ -39,7 +39,10 @@ extern "C" {
 /** flags for the creation of a uclock structure */
 enum uclock_std_flags {
     /** force using a real-time clock even if a monotonic clock is available */
-    UCLOCK_FLAG_REALTIME = 0x1
+    UCLOCK_FLAG_REALTIME = 0x1,
+    /** use a raw monotonic clock, not subject to NTP frequency adjustments,
+     * if available (ignored with @ref UCLOCK_FLAG_REALTIME) */
+    UCLOCK_FLAG_MONOTONIC_RAW = 0x2
 };
 
 /** @This allocates a new uclock structure.
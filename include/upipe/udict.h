@@ -168,6 +168,9 @@ enum udict_command {
     /** name a shorthand attribute (enum udict_type, const char **,
      * enum udict_type *) */
     UDICT_NAME,
+    /** duplicate a given udict, sharing the attributes with it until one of
+     * them is modified (struct udict **) */
+    UDICT_DUP_SHARED,
 
     /** non-standard commands implemented by a module type can start from
      * there (first arg = signature) */
@@ -279,6 +282,25 @@ static inline struct udict *udict_dup(struct udict *udict)
     return dup_udict;
 }
 
+/** @This duplicates a given udict without copying the attributes. They are
+ * shared with the original udict, in a read-only fashion, until one of the
+ * udicts is modified. Udict managers that do not support sharing perform a
+ * normal copy.
+ *
+ * @param udict pointer to udict
+ * @return duplicated udict
+ */
+static inline struct udict *udict_dup_shared(struct udict *udict)
+{
+    struct udict *dup_udict;
+    int err = udict_control(udict, UDICT_DUP_SHARED, &dup_udict);
+    if (err == UBASE_ERR_UNHANDLED)
+        return udict_dup(udict);
+    if (unlikely(!ubase_check(err)))
+        return NULL;
+    return dup_udict;
+}
+
 /** @This finds an attribute of the given name and type and returns
  * the name and type of the next attribute.
  *
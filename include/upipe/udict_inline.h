@@ -53,6 +53,21 @@ struct udict_mgr *udict_inline_mgr_alloc(unsigned int udict_pool_depth,
                                          struct umem_mgr *umem_mgr,
                                          int min_size, int extra_size);
 
+/** @This allocates a new instance of the inline udict manager, whose udicts
+ * maintain an index of their attributes to speed up lookups.
+ *
+ * @param udict_pool_depth maximum number of udict structures in the pool
+ * @param umem_mgr memory allocator to use for buffers
+ * @param min_size minimum allocated space for the udict (if set to -1, a
+ * default sensible value is used)
+ * @param extra_size extra space added when the udict needs to be resized
+ * (if set to -1, a default sensible value is used)
+ * @return pointer to manager, or NULL in case of error
+ */
+struct udict_mgr *udict_inline_mgr_alloc_indexed(unsigned int udict_pool_depth,
+                                                 struct umem_mgr *umem_mgr,
+                                                 int min_size, int extra_size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -37,14 +37,32 @@ extern "C" {
 #include <upipe/ubase.h>
 #include <upipe/uring.h>
 
-/** @This is the implementation of first-in first-out data structure. */
+/** @This is the maximum number of elements in a ufifo. */
+#define UFIFO_MAX_LENGTH (UINT32_C(1) << 31)
+
+/** @This is the implementation of first-in first-out data structure.
+ *
+ * Opaques are stored in the elements of a uring, and the indexes of the
+ * elements carrying an opaque are queued in an array of slots, indexed by
+ * the position in the queue modulo the (power of 2) size of the array.
+ * Each slot is a 64-bit word made of the position it expects (32 bits) and
+ * the queued index (32 bits, URING_INDEX_NULL if the slot is free), so that
+ * both push and pop are done in one compare-and-swap on the slot, without
+ * ABA problem until the positions wrap around (2^32 operations).
+ */
 struct ufifo {
     /** ring structure */
     struct uring uring;
-    /** uring FIFO of elements carrying a uchain */
-    uring_fifo fifo_carrier;
-    /** uring LIFO of elements not carrying a uchain */
+    /** uring LIFO of elements not carrying an opaque */
     uring_lifo lifo_empty;
+    /** position of the next element to pop */
+    uatomic_uint32_t head;
+    /** position of the next element to push */
+    uatomic_uint32_t tail;
+    /** number of slots minus 1 */
+    uint32_t mask;
+    /** array of slots */
+    uatomic_uint64_t *slots;
 };
 
 /** @This returns the required size of extra data space for ufifo.
@@ -52,20 +70,112 @@ struct ufifo {
  * @param length maximum number of elements in the FIFO
  * @return size in octets to allocate
  */
-#define ufifo_sizeof(length) uring_sizeof(length)
+#define ufifo_sizeof(length)                                                \
+    ((2 * (size_t)(length) + 1) * sizeof(uatomic_uint64_t) +                \
+     uring_sizeof(length))
+
+/** @internal @This builds the value of a slot.
+ *
+ * @param pos position expected by the slot
+ * @param index index of the queued element, or URING_INDEX_NULL
+ * @return slot value
+ */
+static inline uint64_t ufifo_slot(uint32_t pos, uring_index index)
+{
+    return ((uint64_t)pos << 32) | index;
+}
 
 /** @This initializes a ufifo.
  *
  * @param ufifo pointer to a ufifo structure
- * @param length maximum number of elements in the FIFO (max 255)
+ * @param length maximum number of elements in the FIFO (max
+ * @ref UFIFO_MAX_LENGTH)
  * @param extra mandatory extra space allocated by the caller, with the size
  * returned by @ref #ufifo_sizeof
  */
-static inline void ufifo_init(struct ufifo *ufifo, uint8_t length, void *extra)
+static inline void ufifo_init(struct ufifo *ufifo, uint32_t length, void *extra)
 {
+    assert(length <= UFIFO_MAX_LENGTH);
+    uint32_t nb_slots = 1;
+    while (nb_slots < length)
+        nb_slots <<= 1;
+
+    ufifo->slots = (uatomic_uint64_t *)extra;
+    for (uint32_t i = 0; i < nb_slots; i++)
+        uatomic64_init(&ufifo->slots[i], ufifo_slot(i, URING_INDEX_NULL));
+    ufifo->mask = nb_slots - 1;
+    uatomic_init(&ufifo->head, 0);
+    uatomic_init(&ufifo->tail, 0);
+
     uring_lifo_init(&ufifo->uring, &ufifo->lifo_empty,
-                    uring_init(&ufifo->uring, length, extra));
-    uring_fifo_init(&ufifo->uring, &ufifo->fifo_carrier);
+                    uring_init(&ufifo->uring, length,
+                               (uint8_t *)extra + (2 * (size_t)length + 1) *
+                                                  sizeof(uatomic_uint64_t)));
+}
+
+/** @internal @This queues the index of an element.
+ *
+ * @param ufifo pointer to a ufifo structure
+ * @param index index of the element in the ring
+ */
+static inline void ufifo_push_index(struct ufifo *ufifo, uring_index index)
+{
+    for ( ; ; ) {
+        uint32_t tail = uatomic_load(&ufifo->tail);
+        uatomic_uint64_t *slot = &ufifo->slots[tail & ufifo->mask];
+        uint64_t val = uatomic64_load(slot);
+        uint32_t pos = val >> 32;
+
+        if (pos == tail) {
+            if ((uring_index)val == URING_INDEX_NULL) {
+                if (likely(uatomic64_compare_exchange(slot, &val,
+                                ufifo_slot(tail, index)))) {
+                    uatomic_compare_exchange(&ufifo->tail, &tail, tail + 1);
+                    return;
+                }
+            } else {
+                /* another thread pushed there, help it */
+                uatomic_compare_exchange(&ufifo->tail, &tail, tail + 1);
+            }
+        } else if (pos == tail + ufifo->mask + 1) {
+            /* another thread pushed there and it was already popped */
+            uatomic_compare_exchange(&ufifo->tail, &tail, tail + 1);
+        }
+        /* otherwise our view of the tail is outdated: retry; the slot
+         * cannot still be used by a previous position because the uring
+         * holds no more elements than there are slots */
+    }
+}
+
+/** @internal @This dequeues the index of an element.
+ *
+ * @param ufifo pointer to a ufifo structure
+ * @return index of the first element, or URING_INDEX_NULL if the FIFO
+ * is empty
+ */
+static inline uring_index ufifo_pop_index(struct ufifo *ufifo)
+{
+    for ( ; ; ) {
+        uint32_t head = uatomic_load(&ufifo->head);
+        uatomic_uint64_t *slot = &ufifo->slots[head & ufifo->mask];
+        uint64_t val = uatomic64_load(slot);
+        uint32_t pos = val >> 32;
+
+        if (pos == head) {
+            uring_index index = (uring_index)val;
+            if (index == URING_INDEX_NULL)
+                return URING_INDEX_NULL;
+            if (likely(uatomic64_compare_exchange(slot, &val,
+                            ufifo_slot(head + ufifo->mask + 1,
+                                       URING_INDEX_NULL)))) {
+                uatomic_compare_exchange(&ufifo->head, &head, head + 1);
+                return index;
+            }
+        } else if (pos == head + ufifo->mask + 1) {
+            /* another thread popped there, help it */
+            uatomic_compare_exchange(&ufifo->head, &head, head + 1);
+        }
+    }
 }
 
 /** @This pushes a new element.
@@ -82,7 +192,7 @@ static inline bool ufifo_push(struct ufifo *ufifo, void *opaque)
     if (index == URING_INDEX_NULL)
         return false;
     uring_elem_set(&ufifo->uring, index, opaque);
-    uring_fifo_push(&ufifo->uring, &ufifo->fifo_carrier, index);
+    ufifo_push_index(ufifo, index);
     return true;
 }
 
@@ -94,7 +204,7 @@ static inline bool ufifo_push(struct ufifo *ufifo, void *opaque)
 static inline void *ufifo_pop_internal(struct ufifo *ufifo)
 {
     void *opaque;
-    uring_index index = uring_fifo_pop(&ufifo->uring, &ufifo->fifo_carrier);
+    uring_index index = ufifo_pop_index(ufifo);
     if (index == URING_INDEX_NULL)
         return NULL;
     opaque = uring_elem_get(&ufifo->uring, index);
@@ -119,7 +229,10 @@ static inline void *ufifo_pop_internal(struct ufifo *ufifo)
 static inline void ufifo_clean(struct ufifo *ufifo)
 {
     uring_lifo_clean(&ufifo->uring, &ufifo->lifo_empty);
-    uring_fifo_clean(&ufifo->uring, &ufifo->fifo_carrier);
+    for (uint32_t i = 0; i <= ufifo->mask; i++)
+        uatomic64_clean(&ufifo->slots[i]);
+    uatomic_clean(&ufifo->head);
+    uatomic_clean(&ufifo->tail);
 }
 
 #ifdef __cplusplus
@@ -61,7 +61,7 @@ struct ulifo {
  * @param extra mandatory extra space allocated by the caller, with the size
  * returned by @ref #ulifo_sizeof
  */
-static inline void ulifo_init(struct ulifo *ulifo, uint16_t length, void *extra)
+static inline void ulifo_init(struct ulifo *ulifo, uint32_t length, void *extra)
 {
     uring_lifo_init(&ulifo->uring, &ulifo->lifo_empty,
                     uring_init(&ulifo->uring, length, extra));
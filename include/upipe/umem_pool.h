@@ -39,6 +39,18 @@ extern "C" {
 
 #include <upipe/umem.h>
 
+/** @This holds the statistics of a pool of a cached umem pool manager. */
+struct umem_pool_stats {
+    /** allocations served by a per-thread cache */
+    uint64_t cache_hits;
+    /** allocations served by the shared pool */
+    uint64_t pool_hits;
+    /** allocations that had to be served by malloc() */
+    uint64_t misses;
+    /** releases that had to be served by free() */
+    uint64_t overflows;
+};
+
 /** @This allocates a new instance of the umem pool manager allocating buffers
  * from application memory, using pools in power of 2's.
  *
@@ -52,6 +64,45 @@ extern "C" {
  */
 struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...);
 
+/** @This allocates a new instance of the umem pool manager allocating buffers
+ * from application memory, using pools in power of 2's, and per-thread
+ * caches in front of the pools.
+ *
+ * Each thread keeps up to twice magazine_size buffers of each size, so that
+ * most allocations and releases do not touch the shared pools. The caches
+ * exchange magazine_size buffers at once with the shared pools when they
+ * run empty or full. When a thread exits, its cache is released to the
+ * shared pools. The manager must not be used concurrently with its release.
+ *
+ * If the platform does not support threads, this is identical to
+ * @ref umem_pool_mgr_alloc.
+ *
+ * @param pool0_size size (in octets) of the smallest allocatable buffer; it
+ * must be a power of 2
+ * @param magazine_size number of buffers exchanged at once between the
+ * per-thread caches and the pools
+ * @param nb_pools number of buffer pools to maintain, with sizes in power of
+ * 2's increments, followed, for each pool, by the maximum number of buffers
+ * to keep in the pool (unsigned int); larger buffers will be directly managed
+ * with malloc() and free()
+ * @return pointer to manager, or NULL in case of error
+ */
+struct umem_mgr *umem_pool_mgr_alloc_cached(size_t pool0_size,
+                                            unsigned int magazine_size,
+                                            size_t nb_pools, ...);
+
+/** @This returns the statistics of a pool of a manager allocated with
+ * @ref umem_pool_mgr_alloc_cached. Statistics of running threads are
+ * read without synchronization and may be slightly off.
+ *
+ * @param mgr pointer to umem manager
+ * @param pool index of the pool (0 for buffers of pool0_size)
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+int umem_pool_mgr_get_stats(struct umem_mgr *mgr, unsigned int pool,
+                            struct umem_pool_stats *stats);
+
 
 /** @This allocates a new instance of the umem pool manager allocating buffers
  * from application memory, using pools in power of 2's, with a simpler API.
@@ -74,7 +74,7 @@ struct upool {
  * returned by @ref #upool_sizeof
  */
 static inline void upool_init(struct upool *upool, struct urefcount *refcount,
-                              uint16_t length, void *extra,
+                              uint32_t length, void *extra,
                               upool_alloc_cb alloc_cb, upool_free_cb free_cb)
 {
     upool->refcount = refcount;
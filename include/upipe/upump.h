@@ -37,11 +37,13 @@ extern "C" {
 #include <upipe/ubase.h>
 #include <upipe/urefcount.h>
 #include <upipe/ulist.h>
+#include <upipe/umem.h>
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdarg.h>
 #include <assert.h>
+#include <sys/types.h>
 
 /** @hidden */
 struct upump_mgr;
@@ -51,6 +53,10 @@ struct upump;
 struct upump_blocker;
 /** @hidden */
 struct umutex;
+/** @hidden */
+struct iovec;
+/** @hidden */
+struct sockaddr;
 
 /** @This defines the standard types of pumps. */
 enum upump_type {
@@ -67,6 +73,14 @@ enum upump_type {
     UPUMP_TYPE_FD_WRITE,
     /** event triggers on a UNIX signal (argument = int) */
     UPUMP_TYPE_SIGNAL,
+    /** event triggers on data received from a file descriptor into a buffer
+     * owned by the pump (arguments = int, struct umem_mgr *, unsigned int,
+     * unsigned int) - optional, see @ref upump_alloc_fd_recv */
+    UPUMP_TYPE_FD_RECV,
+    /** event triggers on the completion of data sent to a file descriptor
+     * (arguments = int, unsigned int) - optional, see
+     * @ref upump_alloc_fd_send */
+    UPUMP_TYPE_FD_SEND,
     /* TODO: Windows objects */
 
     /** non-standard types implemented by a upump handler can start
@@ -90,6 +104,12 @@ enum upump_command {
     UPUMP_ALLOC_BLOCKER,
     /** frees a blocker (struct upump_blocker *) */
     UPUMP_FREE_BLOCKER,
+    /** gets the data received by a recv pump (struct upump_recv *) */
+    UPUMP_GET_RECV,
+    /** submits data to a send pump (const struct iovec *, int, void *) */
+    UPUMP_SEND,
+    /** gets the completed request of a send pump (void **, ssize_t *) */
+    UPUMP_GET_SENT,
 
     /** non-standard commands implemented by a upump handler can start
      * from there (first arg = signature) */
@@ -125,6 +145,25 @@ struct upump {
 
 UBASE_FROM_TO(upump, uchain, uchain, uchain)
 
+/** @This describes data received by a pump of type
+ * @ref UPUMP_TYPE_FD_RECV. */
+struct upump_recv {
+    /** buffer holding the data, which belongs to the caller afterwards */
+    struct umem umem;
+    /** offset of the data in the buffer */
+    size_t offset;
+    /** size of the data, 0 at the end of the stream, or a negative errno */
+    ssize_t size;
+    /** source address of a datagram (pointing inside the buffer), or NULL */
+    const struct sockaddr *addr;
+    /** size of the source address */
+    unsigned int addrlen;
+    /** ancillary data of a datagram (pointing inside the buffer), or NULL */
+    const void *control;
+    /** size of the ancillary data */
+    size_t controllen;
+};
+
 /** @This defines standard commands which upump managers may implement. */
 enum upump_mgr_command {
     /** run the event loop (struct umutex *) */
@@ -286,6 +325,64 @@ static inline struct upump *upump_alloc_signal(struct upump_mgr *mgr,
     return upump_alloc(mgr, cb, opaque, refcount, UPUMP_TYPE_SIGNAL, signal);
 }
 
+/** @This allocates and initializes a pump receiving data from a file
+ * descriptor. Instead of signaling that the file descriptor is readable, the
+ * event loop itself receives the data (one datagram for a socket) into a
+ * buffer allocated by the pump, and the pump triggers once per buffer, which
+ * is retrieved with @ref upump_get_recv.
+ *
+ * This type is optional; managers which do not implement it return NULL, and
+ * the caller is then expected to fall back to @ref upump_alloc_fd_read.
+ *
+ * @param mgr management structure for this event loop
+ * @param cb function to call when the pump triggers
+ * @param opaque pointer to the module's internal structure
+ * @param refcount pointer to urefcount structure to increment during callback,
+ * or NULL
+ * @param fd file descriptor to receive from
+ * @param umem_mgr memory allocator for the buffers
+ * @param size maximum size of the data of a buffer
+ * @param nb_buffers number of buffers the kernel may fill in advance
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static inline struct upump *upump_alloc_fd_recv(struct upump_mgr *mgr,
+                                                upump_cb cb, void *opaque,
+                                                struct urefcount *refcount,
+                                                int fd,
+                                                struct umem_mgr *umem_mgr,
+                                                unsigned int size,
+                                                unsigned int nb_buffers)
+{
+    return upump_alloc(mgr, cb, opaque, refcount, UPUMP_TYPE_FD_RECV, fd,
+                       umem_mgr, size, nb_buffers);
+}
+
+/** @This allocates and initializes a pump sending data to a file descriptor.
+ * Data is submitted with @ref upump_send and written by the event loop
+ * itself, in submission order; the pump triggers once per completed request,
+ * which is retrieved with @ref upump_get_sent.
+ *
+ * This type is optional; managers which do not implement it return NULL, and
+ * the caller is then expected to fall back to @ref upump_alloc_fd_write.
+ *
+ * @param mgr management structure for this event loop
+ * @param cb function to call when the pump triggers
+ * @param opaque pointer to the module's internal structure
+ * @param refcount pointer to urefcount structure to increment during callback,
+ * or NULL
+ * @param fd file descriptor to send to
+ * @param depth maximum number of requests pending at a given time
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static inline struct upump *upump_alloc_fd_send(struct upump_mgr *mgr,
+                                                upump_cb cb, void *opaque,
+                                                struct urefcount *refcount,
+                                                int fd, unsigned int depth)
+{
+    return upump_alloc(mgr, cb, opaque, refcount, UPUMP_TYPE_FD_SEND, fd,
+                       depth);
+}
+
 /** @internal @This sends a control command to the pump. Note that all control
  * commands must be executed from the same thread - no reentrancy or locking
  * is required from the pump. Also note that all arguments are owned by the
@@ -382,6 +479,56 @@ static inline void upump_set_status(struct upump *upump, bool status)
     upump_control(upump, UPUMP_SET_STATUS, i);
 }
 
+/** @This gets the data received by a pump of type @ref UPUMP_TYPE_FD_RECV.
+ * It may only be called from the callback of the pump, and only once; the
+ * buffer then belongs to the caller, who must release it with
+ * @ref umem_free. A buffer which is not retrieved is freed after the
+ * callback.
+ *
+ * @param upump description structure of the pump
+ * @param recv filled in with the description of the data
+ * @return an error code
+ */
+static inline int upump_get_recv(struct upump *upump, struct upump_recv *recv)
+{
+    return upump_control(upump, UPUMP_GET_RECV, recv);
+}
+
+/** @This submits data to a pump of type @ref UPUMP_TYPE_FD_SEND. The iovec
+ * array and the data it points to must remain valid until the completion of
+ * the request is reported by @ref upump_get_sent. Requests are submitted
+ * while the pump is started; requests not completed when the pump is freed
+ * are discarded without notification.
+ *
+ * @param upump description structure of the pump
+ * @param iov array of buffers to send as a whole (one datagram for a socket)
+ * @param iovcnt number of items in the array
+ * @param opaque opaque returned by @ref upump_get_sent
+ * @return an error code, including @ref UBASE_ERR_BUSY if the maximum number
+ * of pending requests is reached
+ */
+static inline int upump_send(struct upump *upump, const struct iovec *iov,
+                             int iovcnt, void *opaque)
+{
+    return upump_control(upump, UPUMP_SEND, iov, iovcnt, opaque);
+}
+
+/** @This gets the completed request of a pump of type
+ * @ref UPUMP_TYPE_FD_SEND. It may only be called from the callback of the
+ * pump.
+ *
+ * @param upump description structure of the pump
+ * @param opaque_p filled in with the opaque passed to @ref upump_send
+ * @param result_p filled in with the number of octets sent, or a negative
+ * errno
+ * @return an error code
+ */
+static inline int upump_get_sent(struct upump *upump, void **opaque_p,
+                                 ssize_t *result_p)
+{
+    return upump_control(upump, UPUMP_GET_SENT, opaque_p, result_p);
+}
+
 /** @This gets the opaque structure with a cast.
  *
  * @param upump description structure of the pump
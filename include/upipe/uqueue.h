@@ -44,6 +44,17 @@ extern "C" {
 #include <stdint.h>
 #include <assert.h>
 
+/** @hidden */
+#define UQUEUE_CACHE_LINE 64
+
+/** @This is the maximum number of elements in a uqueue. */
+#define UQUEUE_MAX_LENGTH UFIFO_MAX_LENGTH
+
+/** minimum number of polls of an empty SPSC queue before sleeping */
+#define UQUEUE_SPIN_MIN 16
+/** maximum number of polls of an empty SPSC queue before sleeping */
+#define UQUEUE_SPIN_MAX 256
+
 /** @This is the implementation of a queue. */
 struct uqueue {
     /** FIFO */
@@ -56,6 +67,40 @@ struct uqueue {
     struct ueventfd event_push;
     /** ueventfd triggered when data can be popped */
     struct ueventfd event_pop;
+
+    /** true if the queue has a single producer and a single consumer */
+    bool spsc;
+    /** number of slots of the SPSC ring (length + 1) */
+    uint32_t spsc_size;
+    /** slots of the SPSC ring, in the extra space */
+    void **spsc_slots;
+
+    /** @hidden */
+    uint8_t padding_producer[UQUEUE_CACHE_LINE];
+    /** index of the next slot to write, written by the producer */
+    uatomic_uint32_t spsc_tail;
+    /** copy of spsc_tail owned by the producer */
+    uint32_t spsc_tail_local;
+    /** last value of spsc_head seen by the producer */
+    uint32_t spsc_head_cache;
+    /** set by the producer before it sleeps on event_push */
+    uatomic_uint32_t spsc_push_waiting;
+
+    /** @hidden */
+    uint8_t padding_consumer[UQUEUE_CACHE_LINE];
+    /** index of the next slot to read, written by the consumer */
+    uatomic_uint32_t spsc_head;
+    /** copy of spsc_head owned by the consumer */
+    uint32_t spsc_head_local;
+    /** last value of spsc_tail seen by the consumer */
+    uint32_t spsc_tail_cache;
+    /** set by the consumer before it sleeps on event_pop */
+    uatomic_uint32_t spsc_pop_waiting;
+    /** number of polls of an empty queue before sleeping */
+    uint32_t spsc_spin;
+
+    /** @hidden */
+    uint8_t padding_end[UQUEUE_CACHE_LINE];
 };
 
 /** @This returns the required size of extra data space for uqueue.
@@ -63,17 +108,20 @@ struct uqueue {
  * @param length maximum number of elements in the queue
  * @return size in octets to allocate
  */
-#define uqueue_sizeof(length) ufifo_sizeof(length)
+#define uqueue_sizeof(length)                                               \
+    (ufifo_sizeof(length) > ((size_t)(length) + 1) * sizeof(void *) ?       \
+     ufifo_sizeof(length) : ((size_t)(length) + 1) * sizeof(void *))
 
 /** @This initializes a uqueue.
  *
  * @param uqueue pointer to a uqueue structure
- * @param length maximum number of elements in the queue
+ * @param length maximum number of elements in the queue (max
+ * @ref UQUEUE_MAX_LENGTH)
  * @param extra mandatory extra space allocated by the caller, with the size
- * returned by @ref #ufifo_sizeof
+ * returned by @ref #uqueue_sizeof
  * @return false in case of failure
  */
-static inline bool uqueue_init(struct uqueue *uqueue, uint8_t length,
+static inline bool uqueue_init(struct uqueue *uqueue, uint32_t length,
                                void *extra)
 {
     if (unlikely(!ueventfd_init(&uqueue->event_push, true)))
@@ -86,6 +134,46 @@ static inline bool uqueue_init(struct uqueue *uqueue, uint8_t length,
     ufifo_init(&uqueue->fifo, length, extra);
     uatomic_init(&uqueue->counter, 0);
     uqueue->length = length;
+    uqueue->spsc = false;
+    return true;
+}
+
+/** @This initializes a uqueue which is only pushed from a single thread
+ * and only popped from a single (other) thread. In that case push and pop
+ * don't need any atomic read-modify-write operation, the producer and
+ * consumer indexes live on different cache lines, and the consumer polls
+ * an empty queue for a little while before sleeping on its event, which
+ * avoids most eventfd system calls on a busy link.
+ *
+ * Several threads may however allocate watchers on the queue, and
+ * @ref uqueue_length may be called from any thread.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param length maximum number of elements in the queue (max
+ * @ref UQUEUE_MAX_LENGTH)
+ * @param extra mandatory extra space allocated by the caller, with the size
+ * returned by @ref #uqueue_sizeof
+ * @return false in case of failure
+ */
+static inline bool uqueue_init_spsc(struct uqueue *uqueue, uint32_t length,
+                                    void *extra)
+{
+    if (unlikely(!uqueue_init(uqueue, length, extra)))
+        return false;
+
+    uqueue->spsc = true;
+    uqueue->spsc_size = length + 1;
+    uqueue->spsc_slots = (void **)extra;
+    uatomic_init(&uqueue->spsc_tail, 0);
+    uqueue->spsc_tail_local = 0;
+    uqueue->spsc_head_cache = 0;
+    uatomic_init(&uqueue->spsc_push_waiting, 0);
+    uatomic_init(&uqueue->spsc_head, 0);
+    uqueue->spsc_head_local = 0;
+    uqueue->spsc_tail_cache = 0;
+    /* event_pop is initially not readable, so the consumer is asleep */
+    uatomic_init(&uqueue->spsc_pop_waiting, 1);
+    uqueue->spsc_spin = UQUEUE_SPIN_MIN;
     return true;
 }
 
@@ -127,6 +215,148 @@ static inline struct upump *uqueue_upump_alloc_pop(struct uqueue *uqueue,
                                 refcount);
 }
 
+/** @internal @This pauses the CPU in a busy loop. */
+static inline void uqueue_cpu_relax(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__("pause" ::: "memory");
+#elif defined(__aarch64__) || (defined(__arm__) && __ARM_ARCH >= 7)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/** @internal @This wakes up the other side of an SPSC queue if it
+ * announced that it was going to sleep.
+ *
+ * @param waiting pointer to the waiting flag of the other side
+ * @param event event the other side is sleeping on
+ */
+static inline void uqueue_spsc_wake(uatomic_uint32_t *waiting,
+                                    struct ueventfd *event)
+{
+    /* uatomic_load orders this load after the preceding index store */
+    if (unlikely(uatomic_load(waiting))) {
+        uint32_t expected = 1;
+        if (uatomic_compare_exchange(waiting, &expected, 0))
+            ueventfd_write(event);
+    }
+}
+
+/** @internal @This pushes an element into an SPSC queue.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param element pointer to element to push
+ * @return false if the queue is full and the element couldn't be queued
+ */
+static inline bool uqueue_spsc_push(struct uqueue *uqueue, void *element)
+{
+    uint32_t tail = uqueue->spsc_tail_local;
+    uint32_t next = tail + 1 == uqueue->spsc_size ? 0 : tail + 1;
+
+    if (unlikely(next == uqueue->spsc_head_cache)) {
+        uqueue->spsc_head_cache = uatomic_load_acquire(&uqueue->spsc_head);
+        if (unlikely(next == uqueue->spsc_head_cache)) {
+            /* signal that we are full */
+            uatomic_store(&uqueue->spsc_push_waiting, 1);
+            ueventfd_read(&uqueue->event_push);
+
+            /* double-check */
+            uqueue->spsc_head_cache = uatomic_load_acquire(&uqueue->spsc_head);
+            if (likely(next == uqueue->spsc_head_cache))
+                return false;
+
+            /* signal that we're alright again */
+            uatomic_store(&uqueue->spsc_push_waiting, 0);
+            ueventfd_write(&uqueue->event_push);
+        }
+    }
+
+    uqueue->spsc_slots[tail] = element;
+    uqueue->spsc_tail_local = next;
+    uatomic_store_release(&uqueue->spsc_tail, next);
+    uqueue_spsc_wake(&uqueue->spsc_pop_waiting, &uqueue->event_pop);
+    return true;
+}
+
+/** @internal @This returns the number of elements ready to be popped from
+ * an SPSC queue, polling for a little while and then preparing to sleep if
+ * it is empty.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @return number of elements ready to be popped
+ */
+static inline uint32_t uqueue_spsc_available(struct uqueue *uqueue)
+{
+    uint32_t head = uqueue->spsc_head_local;
+    uint32_t tail = uqueue->spsc_tail_cache;
+    if (likely(tail == head)) {
+        tail = uatomic_load_acquire(&uqueue->spsc_tail);
+        if (unlikely(tail == head)) {
+            /* spin, adapting the duration to how often it is useful */
+            uint32_t i;
+            for (i = 0; i < uqueue->spsc_spin; i++) {
+                uqueue_cpu_relax();
+                tail = uatomic_load_acquire(&uqueue->spsc_tail);
+                if (tail != head)
+                    break;
+            }
+            if (tail != head) {
+                if (uqueue->spsc_spin < UQUEUE_SPIN_MAX)
+                    uqueue->spsc_spin *= 2;
+            } else {
+                if (uqueue->spsc_spin > UQUEUE_SPIN_MIN)
+                    uqueue->spsc_spin /= 2;
+
+                /* signal that we starve */
+                uatomic_store(&uqueue->spsc_pop_waiting, 1);
+                ueventfd_read(&uqueue->event_pop);
+
+                /* double-check */
+                tail = uatomic_load_acquire(&uqueue->spsc_tail);
+                if (likely(tail == head))
+                    return 0;
+
+                /* signal that we're alright again */
+                uatomic_store(&uqueue->spsc_pop_waiting, 0);
+                ueventfd_write(&uqueue->event_pop);
+            }
+        }
+        uqueue->spsc_tail_cache = tail;
+    }
+    return tail >= head ? tail - head : tail + uqueue->spsc_size - head;
+}
+
+/** @internal @This pops elements from an SPSC queue.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param elements array filled in with the popped elements
+ * @param max maximum number of elements to pop
+ * @return number of popped elements
+ */
+static inline unsigned int uqueue_spsc_pop(struct uqueue *uqueue,
+                                           void **elements, unsigned int max)
+{
+    uint32_t available = uqueue_spsc_available(uqueue);
+    if (unlikely(!available))
+        return 0;
+    if (available > max)
+        available = max;
+
+    uint32_t head = uqueue->spsc_head_local;
+    uint32_t i;
+    for (i = 0; i < available; i++) {
+        elements[i] = uqueue->spsc_slots[head];
+        if (++head == uqueue->spsc_size)
+            head = 0;
+    }
+    uqueue->spsc_head_local = head;
+    uatomic_store_release(&uqueue->spsc_head, head);
+    uqueue_spsc_wake(&uqueue->spsc_push_waiting, &uqueue->event_push);
+    return available;
+}
+
 /** @This pushes an element into the queue.
  *
  * @param uqueue pointer to a uqueue structure
@@ -135,6 +365,9 @@ static inline struct upump *uqueue_upump_alloc_pop(struct uqueue *uqueue,
  */
 static inline bool uqueue_push(struct uqueue *uqueue, void *element)
 {
+    if (uqueue->spsc)
+        return uqueue_spsc_push(uqueue, element);
+
     if (unlikely(!ufifo_push(&uqueue->fifo, element))) {
         /* signal that we are full */
         ueventfd_read(&uqueue->event_push);
@@ -159,6 +392,13 @@ static inline bool uqueue_push(struct uqueue *uqueue, void *element)
  */
 static inline void *uqueue_pop_internal(struct uqueue *uqueue)
 {
+    if (uqueue->spsc) {
+        void *element;
+        if (unlikely(!uqueue_spsc_pop(uqueue, &element, 1)))
+            return NULL;
+        return element;
+    }
+
     void *element = ufifo_pop(&uqueue->fifo, void *);
     if (unlikely(element == NULL)) {
         /* signal that we starve */
@@ -186,12 +426,40 @@ static inline void *uqueue_pop_internal(struct uqueue *uqueue)
  */
 #define uqueue_pop(uqueue, type) (type)uqueue_pop_internal(uqueue)
 
+/** @This pops several elements from the queue at once. On an SPSC queue
+ * this only publishes the new consumer index once for the whole batch.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param elements array filled in with the popped elements
+ * @param max maximum number of elements to pop
+ * @return number of popped elements, 0 if the queue is empty
+ */
+static inline unsigned int uqueue_pop_batch(struct uqueue *uqueue,
+                                            void **elements, unsigned int max)
+{
+    if (uqueue->spsc)
+        return uqueue_spsc_pop(uqueue, elements, max);
+
+    unsigned int i;
+    for (i = 0; i < max; i++) {
+        elements[i] = uqueue_pop_internal(uqueue);
+        if (elements[i] == NULL)
+            break;
+    }
+    return i;
+}
+
 /** @This returns the number of elements in the queue.
  *
  * @param uqueue pointer to a uqueue structure
  */
 static inline unsigned int uqueue_length(struct uqueue *uqueue)
 {
+    if (uqueue->spsc) {
+        uint32_t head = uatomic_load(&uqueue->spsc_head);
+        uint32_t tail = uatomic_load(&uqueue->spsc_tail);
+        return tail >= head ? tail - head : tail + uqueue->spsc_size - head;
+    }
     return uatomic_load(&uqueue->counter);
 }
 
@@ -202,6 +470,12 @@ static inline unsigned int uqueue_length(struct uqueue *uqueue)
  */
 static inline void uqueue_clean(struct uqueue *uqueue)
 {
+    if (uqueue->spsc) {
+        uatomic_clean(&uqueue->spsc_tail);
+        uatomic_clean(&uqueue->spsc_push_waiting);
+        uatomic_clean(&uqueue->spsc_head);
+        uatomic_clean(&uqueue->spsc_pop_waiting);
+    }
     uatomic_clean(&uqueue->counter);
     ufifo_clean(&uqueue->fifo);
     ueventfd_clean(&uqueue->event_push);
@@ -257,9 +257,10 @@ static inline struct uref *uref_sibling_alloc_control(struct uref *uref)
 /** @internal @This duplicates a uref without duplicating the ubuf.
  *
  * @param uref source structure to duplicate
+ * @param shared true if the attributes may be shared with the source
  * @return duplicated uref or NULL in case of allocation failure
  */
-static inline struct uref *uref_dup_inner(struct uref *uref)
+static inline struct uref *_uref_dup_inner(struct uref *uref, bool shared)
 {
     assert(uref != NULL);
     struct uref *new_uref = uref->mgr->uref_alloc(uref->mgr);
@@ -268,7 +269,8 @@ static inline struct uref *uref_dup_inner(struct uref *uref)
 
     new_uref->ubuf = NULL;
     if (uref->udict != NULL) {
-        new_uref->udict = udict_dup(uref->udict);
+        new_uref->udict = shared ? udict_dup_shared(uref->udict) :
+                                   udict_dup(uref->udict);
         if (unlikely(new_uref->udict == NULL)) {
             uref_free(new_uref);
             return NULL;
@@ -288,14 +290,25 @@ static inline struct uref *uref_dup_inner(struct uref *uref)
     return new_uref;
 }
 
-/** @This duplicates a uref.
+/** @internal @This duplicates a uref without duplicating the ubuf.
  *
  * @param uref source structure to duplicate
  * @return duplicated uref or NULL in case of allocation failure
  */
-static inline struct uref *uref_dup(struct uref *uref)
+static inline struct uref *uref_dup_inner(struct uref *uref)
 {
-    struct uref *new_uref = uref_dup_inner(uref);
+    return _uref_dup_inner(uref, false);
+}
+
+/** @internal @This duplicates a uref.
+ *
+ * @param uref source structure to duplicate
+ * @param shared true if the attributes may be shared with the source
+ * @return duplicated uref or NULL in case of allocation failure
+ */
+static inline struct uref *_uref_dup(struct uref *uref, bool shared)
+{
+    struct uref *new_uref = _uref_dup_inner(uref, shared);
     if (unlikely(new_uref == NULL))
         return NULL;
 
@@ -309,6 +322,29 @@ static inline struct uref *uref_dup(struct uref *uref)
     return new_uref;
 }
 
+/** @This duplicates a uref.
+ *
+ * @param uref source structure to duplicate
+ * @return duplicated uref or NULL in case of allocation failure
+ */
+static inline struct uref *uref_dup(struct uref *uref)
+{
+    return _uref_dup(uref, false);
+}
+
+/** @This duplicates a uref, sharing its attributes with the source until
+ * one of them modifies them (see @ref udict_dup_shared). This is cheaper
+ * than @ref uref_dup when the attributes of the duplicate are rarely
+ * changed, for instance when a flow is sent to several outputs.
+ *
+ * @param uref source structure to duplicate
+ * @return duplicated uref or NULL in case of allocation failure
+ */
+static inline struct uref *uref_dup_shared(struct uref *uref)
+{
+    return _uref_dup(uref, true);
+}
+
 /** @This attaches a ubuf to a given uref. The ubuf pointer may no longer be
  * used by the module afterwards.
  *
@@ -43,15 +43,21 @@ extern "C" {
 #include <assert.h>
 
 /** @This defines the position of an element in the uring array. */
-typedef uint16_t uring_index;
+typedef uint32_t uring_index;
 
 /** @This represents a NULL index position. */
 #define URING_INDEX_NULL 0
 
+/** @This is the maximum number of elements in a ring used as a LIFO. */
+#define URING_LIFO_MAX_LENGTH UINT32_MAX
+
+/** @This is the maximum number of elements in a ring used as a FIFO. */
+#define URING_FIFO_MAX_LENGTH ((UINT32_C(1) << 24) - 1)
+
 /** @This defines an element in the ring. */
 struct uring_elem {
     /** tag incremented at each use */
-    uint16_t tag;
+    uint32_t tag;
     /** index of the next element */
     uring_index next;
     /** pointer to opaque structure */
@@ -61,7 +67,7 @@ struct uring_elem {
 /** @This defines a ring of elements. */
 struct uring {
     /** number of elements in the ring */
-    uint16_t length;
+    uint32_t length;
     /** array of elements */
     struct uring_elem *elems;
 };
@@ -71,7 +77,7 @@ struct uring {
  * @param length number of elements in the ring
  * @return size in octets to allocate
  */
-#define uring_sizeof(length) (length * sizeof(struct uring_elem))
+#define uring_sizeof(length) ((size_t)(length) * sizeof(struct uring_elem))
 
 /** @internal @This returns a pointer to an element from an index.
  *
@@ -117,16 +123,16 @@ static inline void *uring_elem_get(struct uring *uring, uring_index index)
  * problem in concurrent operations. The bit-field definition is:
  * @table 2
  * @item bits @item description
- * @item 16 @item tag
- * @item 16 @item index
+ * @item 32 @item tag
+ * @item 32 @item index
  * @end table
  */
-typedef uint32_t uring_lifo_val;
+typedef uint64_t uring_lifo_val;
 
 /** @This defines an atomic structure describing a LIFO, based on @ref
  * uring_lifo_val.
  */
-typedef uatomic_uint32_t uring_lifo;
+typedef uatomic_uint64_t uring_lifo;
 
 /** @This represents a NULL LIFO descriptor. */
 #define URING_LIFO_NULL 0
@@ -142,7 +148,7 @@ static inline uring_index uring_lifo_to_index(struct uring *uring,
     if (unlikely(lifo == URING_LIFO_NULL))
         return URING_INDEX_NULL;
 
-    uring_index index = lifo & UINT16_MAX;
+    uring_index index = lifo & UINT32_MAX;
     assert(index <= uring->length);
     return index;
 }
@@ -162,7 +168,7 @@ static inline uring_lifo_val uring_lifo_from_index(struct uring *uring,
         return URING_LIFO_NULL;
 
     assert(index <= uring->length);
-    uring_lifo_val lifo = ((uring_lifo_val)uring->elems[index - 1].tag << 16) |
+    uring_lifo_val lifo = ((uring_lifo_val)uring->elems[index - 1].tag << 32) |
                           (uring_lifo_val)index;
     return lifo;
 }
@@ -176,7 +182,7 @@ static inline uring_lifo_val uring_lifo_from_index(struct uring *uring,
 static inline void uring_lifo_init(struct uring *uring, uring_lifo *lifo_p,
                                    uring_lifo_val lifo)
 {
-    uatomic_init(lifo_p, lifo);
+    uatomic64_init(lifo_p, lifo);
 }
 
 /** @This cleans up a LIFO.
@@ -186,7 +192,7 @@ static inline void uring_lifo_init(struct uring *uring, uring_lifo *lifo_p,
  */
 static inline void uring_lifo_clean(struct uring *uring, uring_lifo *lifo_p)
 {
-    uatomic_clean(lifo_p);
+    uatomic64_clean(lifo_p);
 }
 
 /** @This pops an element from a LIFO.
@@ -198,7 +204,7 @@ static inline void uring_lifo_clean(struct uring *uring, uring_lifo *lifo_p)
 static inline uring_index uring_lifo_pop(struct uring *uring,
                                          uring_lifo *lifo_p)
 {
-    uring_lifo_val old_lifo = uatomic_load(lifo_p);
+    uring_lifo_val old_lifo = uatomic64_load(lifo_p);
     uring_lifo_val new_lifo;
     uring_index index;
 
@@ -209,7 +215,8 @@ static inline uring_index uring_lifo_pop(struct uring *uring,
         index = uring_lifo_to_index(uring, old_lifo);
         struct uring_elem *elem = uring_elem_from_index(uring, index);
         new_lifo = uring_lifo_from_index(uring, elem->next);
-    } while (unlikely(!uatomic_compare_exchange(lifo_p, &old_lifo, new_lifo)));
+    } while (unlikely(!uatomic64_compare_exchange(lifo_p, &old_lifo,
+                                                 new_lifo)));
 
     return index;
 }
@@ -225,11 +232,12 @@ static inline void uring_lifo_push(struct uring *uring, uring_lifo *lifo_p,
 {
     struct uring_elem *elem = uring_elem_from_index(uring, index);
     uring_lifo_val new_lifo = uring_lifo_from_index(uring, index);
-    uring_lifo_val old_lifo = uatomic_load(lifo_p);
+    uring_lifo_val old_lifo = uatomic64_load(lifo_p);
 
     do {
         elem->next = uring_lifo_to_index(uring, old_lifo);
-    } while (unlikely(!uatomic_compare_exchange(lifo_p, &old_lifo, new_lifo)));
+    } while (unlikely(!uatomic64_compare_exchange(lifo_p, &old_lifo,
+                                                 new_lifo)));
 }
 
 /** @This defines a multiplexed structure from two element indexes
@@ -237,17 +245,17 @@ static inline void uring_lifo_push(struct uring *uring, uring_lifo *lifo_p,
  * @table 2
  * @item bits @item description
  * @item 8 @item tail tag
- * @item 8 @item tail index
+ * @item 24 @item tail index
  * @item 8 @item head tag
- * @item 8 @item head index
+ * @item 24 @item head index
  * @end table
  */
-typedef uint32_t uring_fifo_val;
+typedef uint64_t uring_fifo_val;
 
 /** @This defines an atomic structure describing a FIFO, based on @ref
  * uring_fifo_val.
  */
-typedef uatomic_uint32_t uring_fifo;
+typedef uatomic_uint64_t uring_fifo;
 
 /** @This represents a (NULL, NULL) FIFO descriptor. */
 #define URING_FIFO_NULL 0
@@ -261,13 +269,14 @@ static inline void uring_fifo_set_tail(struct uring *uring,
                                        uring_fifo_val *fifo_p,
                                        uring_index index)
 {
-    *fifo_p &= UINT16_MAX;
+    *fifo_p &= UINT32_MAX;
     if (unlikely(index == URING_INDEX_NULL))
         return;
 
     assert(index <= uring->length);
-    *fifo_p |= ((uring_fifo_val)uring->elems[index - 1].tag & 0xff) << 24;
-    *fifo_p |= (uring_fifo_val)index << 16;
+    assert(index <= URING_FIFO_MAX_LENGTH);
+    *fifo_p |= ((uring_fifo_val)uring->elems[index - 1].tag & 0xff) << 56;
+    *fifo_p |= (uring_fifo_val)index << 32;
 }
 
 /** @internal @This sets the index of the head element of a FIFO descriptor.
@@ -279,12 +288,13 @@ static inline void uring_fifo_set_head(struct uring *uring,
                                        uring_fifo_val *fifo_p,
                                        uring_index index)
 {
-    *fifo_p &= (uring_fifo_val)UINT16_MAX << 16;
+    *fifo_p &= (uring_fifo_val)UINT32_MAX << 32;
     if (unlikely(index == URING_INDEX_NULL))
         return;
 
     assert(index <= uring->length);
-    *fifo_p |= ((uring_fifo_val)uring->elems[index - 1].tag & 0xff) << 8;
+    assert(index <= URING_FIFO_MAX_LENGTH);
+    *fifo_p |= ((uring_fifo_val)uring->elems[index - 1].tag & 0xff) << 24;
     *fifo_p |= (uring_fifo_val)index;
 }
 
@@ -296,7 +306,7 @@ static inline void uring_fifo_set_head(struct uring *uring,
 static inline uring_index uring_fifo_get_tail(struct uring *uring,
                                               uring_fifo_val fifo)
 {
-    uring_index index = (fifo >> 16) & UINT8_MAX;
+    uring_index index = (fifo >> 32) & URING_FIFO_MAX_LENGTH;
     assert(index <= uring->length);
     return index;
 }
@@ -309,7 +319,7 @@ static inline uring_index uring_fifo_get_tail(struct uring *uring,
 static inline uring_index uring_fifo_get_head(struct uring *uring,
                                               uring_fifo_val fifo)
 {
-    uring_index index = fifo & UINT8_MAX;
+    uring_index index = fifo & URING_FIFO_MAX_LENGTH;
     assert(index <= uring->length);
     return index;
 }
@@ -350,7 +360,7 @@ static inline uring_index uring_fifo_find(struct uring *uring,
 static inline uring_index uring_fifo_pop(struct uring *uring,
                                          uring_fifo *fifo_p)
 {
-    uring_fifo_val old_fifo = uatomic_load(fifo_p);
+    uring_fifo_val old_fifo = uatomic64_load(fifo_p);
 
     for ( ; ; ) {
         if (old_fifo == URING_FIFO_NULL)
@@ -361,8 +371,8 @@ static inline uring_index uring_fifo_pop(struct uring *uring,
 
         if (head == tail) {
             /* one-element FIFO */
-            if (likely(uatomic_compare_exchange(fifo_p, &old_fifo,
-                                                URING_FIFO_NULL)))
+            if (likely(uatomic64_compare_exchange(fifo_p, &old_fifo,
+                                                  URING_FIFO_NULL)))
                 return head;
 
         } else {
@@ -372,14 +382,14 @@ static inline uring_index uring_fifo_pop(struct uring *uring,
             if (prev == URING_INDEX_NULL) {
                 /* The search failed: the FIFO was modified by another
                  * thread. */
-                old_fifo = uatomic_load(fifo_p);
+                old_fifo = uatomic64_load(fifo_p);
                 continue;
             }
 
             for ( ; ; ) {
                 uring_fifo_set_head(uring, &new_fifo, prev);
-                if (likely(uatomic_compare_exchange(fifo_p, &old_fifo,
-                                                    new_fifo)))
+                if (likely(uatomic64_compare_exchange(fifo_p, &old_fifo,
+                                                      new_fifo)))
                     return head;
 
                 new_fifo = old_fifo;
@@ -402,7 +412,7 @@ static inline void uring_fifo_push(struct uring *uring, uring_fifo *fifo_p,
                                    uring_index index)
 {
     struct uring_elem *elem = uring_elem_from_index(uring, index);
-    uring_fifo_val old_fifo = uatomic_load(fifo_p);
+    uring_fifo_val old_fifo = uatomic64_load(fifo_p);
     uring_fifo_val new_fifo;
 
     do {
@@ -412,7 +422,8 @@ static inline void uring_fifo_push(struct uring *uring, uring_fifo *fifo_p,
         if (tail == URING_INDEX_NULL)
             uring_fifo_set_head(uring, &new_fifo, index);
         uring_fifo_set_tail(uring, &new_fifo, index);
-    } while (unlikely(!uatomic_compare_exchange(fifo_p, &old_fifo, new_fifo)));
+    } while (unlikely(!uatomic64_compare_exchange(fifo_p, &old_fifo,
+                                                 new_fifo)));
 }
 
 /** @This initializes a FIFO.
@@ -422,7 +433,7 @@ static inline void uring_fifo_push(struct uring *uring, uring_fifo *fifo_p,
  */
 static inline void uring_fifo_init(struct uring *uring, uring_fifo *fifo_p)
 {
-    uatomic_init(fifo_p, URING_FIFO_NULL);
+    uatomic64_init(fifo_p, URING_FIFO_NULL);
 }
 
 /** @This cleans up a FIFO.
@@ -432,7 +443,7 @@ static inline void uring_fifo_init(struct uring *uring, uring_fifo *fifo_p)
  */
 static inline void uring_fifo_clean(struct uring *uring, uring_fifo *fifo_p)
 {
-    uatomic_clean(fifo_p);
+    uatomic64_clean(fifo_p);
 }
 
 /** @This initializes a ring. By default all elements are chained, and the
@@ -445,7 +456,7 @@ static inline void uring_fifo_clean(struct uring *uring, uring_fifo *fifo_p)
  * @return uring LIFO descriptor of the first element, for use in @ref
  * uring_lifo_init
  */
-static inline uring_lifo_val uring_init(struct uring *uring, uint16_t length,
+static inline uring_lifo_val uring_init(struct uring *uring, uint32_t length,
                                         void *extra)
 {
     assert(extra != NULL);
@@ -454,7 +465,7 @@ static inline uring_lifo_val uring_init(struct uring *uring, uint16_t length,
     if (length == 0)
         return URING_LIFO_NULL;
     /* indexes start at 1 */
-    for (uint16_t i = 1; i < length; i++) {
+    for (uint32_t i = 1; i < length; i++) {
         uring->elems[i - 1].tag = 0;
         uring->elems[i - 1].next = i + 1;
         uring->elems[i - 1].opaque = NULL;
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe pool of threads processing slices of a job in parallel
+ * This is used by pipes which spread the processing of a picture over
+ * several cores, each thread working on a range of lines. The pipe's own
+ * thread takes part in the work and waits for all slices to complete, so
+ * that from the point of view of the pipe the job is synchronous.
+ */
+
+#ifndef _UPIPE_USLICE_H_
+/** @hidden */
+#define _UPIPE_USLICE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+
+/** @This is the prototype of the function processing a slice.
+ *
+ * @param opaque opaque passed to @ref uslice_pool_run
+ * @param slice index of the slice to process
+ * @param nb_slices total number of slices
+ */
+typedef void (*uslice_cb)(void *opaque, unsigned int slice,
+                          unsigned int nb_slices);
+
+/** @hidden */
+struct uslice_pool;
+
+/** @This allocates a pool of threads.
+ *
+ * @param nb_threads number of threads to run in addition to the calling
+ * thread; 0 is valid and processes all slices in the calling thread, as
+ * does any pool when POSIX threads are not available
+ * @return pointer to the pool, or NULL in case of error
+ */
+struct uslice_pool *uslice_pool_alloc(unsigned int nb_threads);
+
+/** @This returns the number of threads of the pool, including the calling
+ * thread. This is the recommended minimum number of slices.
+ *
+ * @param pool pointer to the pool
+ * @return number of threads
+ */
+unsigned int uslice_pool_threads(struct uslice_pool *pool);
+
+/** @This processes nb_slices slices, in the calling thread and the
+ * threads of the pool, and returns when all of them are done. It must not
+ * be called concurrently on the same pool.
+ *
+ * @param pool pointer to the pool, or NULL to process all slices in the
+ * calling thread
+ * @param nb_slices number of slices
+ * @param cb function processing a slice
+ * @param opaque opaque passed to cb
+ */
+void uslice_pool_run(struct uslice_pool *pool, unsigned int nb_slices,
+                     uslice_cb cb, void *opaque);
+
+/** @This stops the threads and frees the pool.
+ *
+ * @param pool pointer to the pool (may be NULL)
+ */
+void uslice_pool_free(struct uslice_pool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short declarations for a Upipe main loop using Linux io_uring
+ *
+ * In addition to the standard pump types, this manager implements the
+ * completion-based types @ref UPUMP_TYPE_FD_RECV (multishot receive into a
+ * ring of buffers provided to the kernel, allocated from a umem manager)
+ * and @ref UPUMP_TYPE_FD_SEND (ordered sends submitted without a syscall
+ * each). All submissions and completions of an iteration of the event loop
+ * are exchanged with the kernel in a single io_uring_enter() call.
+ */
+
+#ifndef _UPUMP_URING_UPUMP_URING_H_
+/** @hidden */
+#define _UPUMP_URING_UPUMP_URING_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upump.h>
+
+#define UPUMP_URING_SIGNATURE UBASE_FOURCC('u','r','n','g')
+
+/** @This allocates and initializes a upump_mgr structure bound to a new
+ * io_uring instance. It fails if the kernel does not support io_uring or
+ * lacks the required features (Linux 5.19 or later).
+ *
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @return pointer to the wrapped upump_mgr structure, or NULL in case of
+ * failure
+ */
+struct upump_mgr *upump_uring_mgr_alloc(uint16_t upump_pool_depth,
+                                        uint16_t upump_blocker_pool_depth);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
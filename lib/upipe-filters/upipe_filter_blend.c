@@ -47,10 +47,15 @@
 #include <upipe-filters/upipe_filter_blend.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
 #include <stdint.h>
 #include <stdio.h>
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 /** @hidden */
 static bool upipe_filter_blend_handle(struct upipe *upipe, struct uref *uref,
                                       struct upump **upump_p);
@@ -88,6 +93,13 @@ struct upipe_filter_blend {
     /** list of blockers (used during udeal) */
     struct uchain blockers;
 
+    /** merges two lines of octets */
+    void (*merge8)(uint8_t *dest, const uint8_t *s1, const uint8_t *s2,
+                   size_t bytes);
+    /** merges two lines of 16-bit samples */
+    void (*merge16)(uint16_t *dest, const uint16_t *s1, const uint16_t *s2,
+                    size_t samples);
+
     /** public structure */
     struct upipe upipe;
 };
@@ -102,6 +114,108 @@ UPIPE_HELPER_UBUF_MGR(upipe_filter_blend, ubuf_mgr, flow_format,
                       upipe_filter_blend_unregister_output_request)
 UPIPE_HELPER_INPUT(upipe_filter_blend, urefs, nb_urefs, max_urefs, blockers, upipe_filter_blend_handle)
 
+/** @internal @This computes the per-pixel mean of two lines
+ * Code from VLC.
+ * - modules/video_filter/deinterlace/merge.c
+ *
+ * @param dest dest line
+ * @param s1 first source line
+ * @param s2 second source line
+ * @param bytes length in bytes
+ */
+static void upipe_filter_merge8bit(uint8_t *dest, const uint8_t *s1,
+                                   const uint8_t *s2, size_t bytes)
+{
+    for( ; bytes > 0; bytes-- )
+        *dest++ = ( *s1++ + *s2++ ) >> 1;
+}
+
+/** @internal @This computes the per-sample mean of two lines of 16-bit
+ * samples.
+ *
+ * @param dest dest line
+ * @param s1 first source line
+ * @param s2 second source line
+ * @param samples length in samples
+ */
+static void upipe_filter_merge16bit(uint16_t *dest, const uint16_t *s1,
+                                    const uint16_t *s2, size_t samples)
+{
+    for ( ; samples > 0; samples--)
+        *dest++ = ((uint32_t)*s1++ + *s2++) >> 1;
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+/* pavgb and pavgw round up, so the carry of (a ^ b) & 1 is subtracted to
+ * get the truncated mean of the C code */
+
+/** @internal @This computes the mean of two lines with SSE2. */
+__attribute__((target("sse2")))
+static void upipe_filter_merge8bit_sse2(uint8_t *dest, const uint8_t *s1,
+                                        const uint8_t *s2, size_t bytes)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    for ( ; bytes >= 16; bytes -= 16, dest += 16, s1 += 16, s2 += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)s1);
+        __m128i b = _mm_loadu_si128((const __m128i *)s2);
+        __m128i c = _mm_and_si128(_mm_xor_si128(a, b), one);
+        _mm_storeu_si128((__m128i *)dest,
+                         _mm_sub_epi8(_mm_avg_epu8(a, b), c));
+    }
+    upipe_filter_merge8bit(dest, s1, s2, bytes);
+}
+
+/** @internal @This computes the mean of two lines with AVX2. */
+__attribute__((target("avx2")))
+static void upipe_filter_merge8bit_avx2(uint8_t *dest, const uint8_t *s1,
+                                        const uint8_t *s2, size_t bytes)
+{
+    const __m256i one = _mm256_set1_epi8(1);
+    for ( ; bytes >= 32; bytes -= 32, dest += 32, s1 += 32, s2 += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)s1);
+        __m256i b = _mm256_loadu_si256((const __m256i *)s2);
+        __m256i c = _mm256_and_si256(_mm256_xor_si256(a, b), one);
+        _mm256_storeu_si256((__m256i *)dest,
+                            _mm256_sub_epi8(_mm256_avg_epu8(a, b), c));
+    }
+    upipe_filter_merge8bit_sse2(dest, s1, s2, bytes);
+}
+
+/** @internal @This computes the mean of two lines of 16-bit samples with
+ * SSE2. */
+__attribute__((target("sse2")))
+static void upipe_filter_merge16bit_sse2(uint16_t *dest, const uint16_t *s1,
+                                         const uint16_t *s2, size_t samples)
+{
+    const __m128i one = _mm_set1_epi16(1);
+    for ( ; samples >= 8; samples -= 8, dest += 8, s1 += 8, s2 += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)s1);
+        __m128i b = _mm_loadu_si128((const __m128i *)s2);
+        __m128i c = _mm_and_si128(_mm_xor_si128(a, b), one);
+        _mm_storeu_si128((__m128i *)dest,
+                         _mm_sub_epi16(_mm_avg_epu16(a, b), c));
+    }
+    upipe_filter_merge16bit(dest, s1, s2, samples);
+}
+
+/** @internal @This computes the mean of two lines of 16-bit samples with
+ * AVX2. */
+__attribute__((target("avx2")))
+static void upipe_filter_merge16bit_avx2(uint16_t *dest, const uint16_t *s1,
+                                         const uint16_t *s2, size_t samples)
+{
+    const __m256i one = _mm256_set1_epi16(1);
+    for ( ; samples >= 16; samples -= 16, dest += 16, s1 += 16, s2 += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)s1);
+        __m256i b = _mm256_loadu_si256((const __m256i *)s2);
+        __m256i c = _mm256_and_si256(_mm256_xor_si256(a, b), one);
+        _mm256_storeu_si256((__m256i *)dest,
+                            _mm256_sub_epi16(_mm256_avg_epu16(a, b), c));
+    }
+    upipe_filter_merge16bit_sse2(dest, s1, s2, samples);
+}
+#endif
+
 /** @internal @This allocates a filter pipe.
  *
  * @param mgr common management structure
@@ -119,58 +233,64 @@ static struct upipe *upipe_filter_blend_alloc(struct upipe_mgr *mgr,
     if (unlikely(upipe == NULL))
         return NULL;
 
+    struct upipe_filter_blend *upipe_filter_blend =
+        upipe_filter_blend_from_upipe(upipe);
     upipe_filter_blend_init_urefcount(upipe);
     upipe_filter_blend_init_ubuf_mgr(upipe);
     upipe_filter_blend_init_output(upipe);
     upipe_filter_blend_init_input(upipe);
-    upipe_throw_ready(upipe);
-    return upipe;
-}
 
-/** @internal @This computes the per-pixel mean of two lines
- * Code from VLC.
- * - modules/video_filter/deinterlace/merge.c
- *
- * @param _dest dest line
- * @param _s1 first source line
- * @param _s2 second source line
- * @param bytes length in bytes
- */
-static void upipe_filter_merge8bit( void *_dest, const void *_s1,
-                       const void *_s2, size_t bytes )
-{
-    uint8_t *dest = _dest;
-    const uint8_t *s1 = _s1;
-    const uint8_t *s2 = _s2;
+    upipe_filter_blend->merge8 = upipe_filter_merge8bit;
+    upipe_filter_blend->merge16 = upipe_filter_merge16bit;
+#if defined(__i386__) || defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2")) {
+        upipe_filter_blend->merge8 = upipe_filter_merge8bit_avx2;
+        upipe_filter_blend->merge16 = upipe_filter_merge16bit_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        upipe_filter_blend->merge8 = upipe_filter_merge8bit_sse2;
+        upipe_filter_blend->merge16 = upipe_filter_merge16bit_sse2;
+    }
+#endif
 
-    for( ; bytes > 0; bytes-- )
-        *dest++ = ( *s1++ + *s2++ ) >> 1;
+    upipe_throw_ready(upipe);
+    return upipe;
 }
 
 /** @internal @This processes a picture plane
  * Adapted from VLC.
  * - modules/video_filter/deinterlace/algo_basic.c 
  *
+ * @param upipe description structure of the pipe
  * @param in input buffer
  * @param out output buffer
  * @param stride_in stride length of input buffer
  * @param stride_out stride length of output buffer
  * @param height picture height
+ * @param wide true if the plane has 16-bit samples in native order
  */
-static void upipe_filter_blend_plane(const uint8_t *in, uint8_t *out,
+static void upipe_filter_blend_plane(struct upipe *upipe,
+                                     const uint8_t *in, uint8_t *out,
                                      size_t stride_in, size_t stride_out,
-                                     size_t height)
+                                     size_t height, bool wide)
 {
+    struct upipe_filter_blend *upipe_filter_blend =
+        upipe_filter_blend_from_upipe(upipe);
     uint8_t *out_end = out + stride_out * height;
+    size_t bytes = (stride_in < stride_out) ? stride_in : stride_out;
 
     // Copy first line
-    memcpy(out, in, stride_in);
+    memcpy(out, in, bytes);
     out += stride_out;
 
     // Compute mean value for remaining lines
     while (out < out_end) {
-        upipe_filter_merge8bit(out, in, in+stride_in,
-           (stride_in < stride_out) ? stride_in : stride_out);
+        if (wide)
+            upipe_filter_blend->merge16((uint16_t *)out,
+                                        (const uint16_t *)in,
+                                        (const uint16_t *)(in + stride_in),
+                                        bytes / 2);
+        else
+            upipe_filter_blend->merge8(out, in, in + stride_in, bytes);
 
         out += stride_out;
         in += stride_in;
@@ -229,11 +349,26 @@ static bool upipe_filter_blend_handle(struct upipe *upipe, struct uref *uref,
             upipe_err_va(upipe, "Could not read dest chroma %s", chroma);
             goto error;
         }
+        unsigned int depth = 8;
+        bool big_endian = false;
+        ubuf_pic_chroma_depth(chroma, &depth, &big_endian);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        bool swap = !big_endian;
+#else
+        bool swap = big_endian;
+#endif
+        if (unlikely(depth > 8 && swap)) {
+            upipe_err_va(upipe, "unsupported byte order for chroma %s",
+                         chroma);
+            goto error;
+        }
+
         uref_pic_plane_read(uref, chroma, 0, 0, -1, -1, &in);
         ubuf_pic_plane_write(ubuf_deint, chroma, 0, 0, -1, -1, &out);
 
         // process plane
-        upipe_filter_blend_plane(in, out, stride_in, stride_out, (size_t) height/vsub);
+        upipe_filter_blend_plane(upipe, in, out, stride_in, stride_out,
+                                 (size_t) height/vsub, depth > 8);
 
         // unmap all
         uref_pic_plane_unmap(uref, chroma, 0, 0, -1, -1);
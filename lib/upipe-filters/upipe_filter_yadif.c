@@ -0,0 +1,824 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe motion-adaptive deinterlace filter
+ *
+ * The interpolation follows the yadif algorithm (Michael Niedermayer):
+ * a missing sample is predicted spatially along the best of three edge
+ * directions, and the prediction is clamped around the temporal mean of
+ * the neighbouring fields by an amount depending on the detected motion.
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/uprobe.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_pic.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_pic.h>
+#include <upipe/uslice.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_ubuf_mgr.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_input.h>
+#include <upipe-filters/upipe_filter_yadif.h>
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+
+/** maximum number of planes of a picture */
+#define YADIF_MAX_PLANES 4
+
+/** @hidden */
+static bool upipe_filter_yadif_handle(struct upipe *upipe, struct uref *uref,
+                                      struct upump **upump_p);
+/** @hidden */
+static int upipe_filter_yadif_check(struct upipe *upipe,
+                                    struct uref *flow_format);
+
+/** @internal @This is the private context of a yadif pipe. */
+struct upipe_filter_yadif {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** ubuf manager */
+    struct ubuf_mgr *ubuf_mgr;
+    /** flow format packet */
+    struct uref *flow_format;
+    /** ubuf manager request */
+    struct urequest ubuf_mgr_request;
+
+    /** output pipe */
+    struct upipe *output;
+    /** flow_definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** temporary uref storage (used during urequest) */
+    struct uchain urefs;
+    /** nb urefs in storage */
+    unsigned int nb_urefs;
+    /** max urefs in storage */
+    unsigned int max_urefs;
+    /** list of blockers (used during udeal) */
+    struct uchain blockers;
+
+    /** previous picture */
+    struct uref *prev;
+    /** picture waiting for the next one */
+    struct uref *cur;
+
+    /** number of threads */
+    unsigned int threads;
+    /** pool of threads, or NULL */
+    struct uslice_pool *pool;
+
+    /** public structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_filter_yadif, upipe, UPIPE_FILTER_YADIF_SIGNATURE);
+UPIPE_HELPER_UREFCOUNT(upipe_filter_yadif, urefcount, upipe_filter_yadif_free)
+UPIPE_HELPER_VOID(upipe_filter_yadif)
+UPIPE_HELPER_OUTPUT(upipe_filter_yadif, output, flow_def, output_state,
+                    request_list)
+UPIPE_HELPER_UBUF_MGR(upipe_filter_yadif, ubuf_mgr, flow_format,
+                      ubuf_mgr_request, upipe_filter_yadif_check,
+                      upipe_filter_yadif_register_output_request,
+                      upipe_filter_yadif_unregister_output_request)
+UPIPE_HELPER_INPUT(upipe_filter_yadif, urefs, nb_urefs, max_urefs, blockers,
+                   upipe_filter_yadif_handle)
+
+/** @internal @This describes a plane of the pictures being processed. */
+struct upipe_filter_yadif_plane {
+    /** buffers of the previous, current and next pictures */
+    const uint8_t *in[3];
+    /** strides of the previous, current and next pictures */
+    size_t in_stride[3];
+    /** output buffer */
+    uint8_t *out;
+    /** stride of the output buffer */
+    size_t out_stride;
+    /** number of samples per line */
+    size_t width;
+    /** number of lines */
+    size_t height;
+    /** true if the samples are 16 bits wide */
+    bool wide;
+};
+
+/** @internal @This describes a picture being processed. */
+struct upipe_filter_yadif_job {
+    /** planes */
+    struct upipe_filter_yadif_plane planes[YADIF_MAX_PLANES];
+    /** number of planes */
+    unsigned int nb_planes;
+    /** parity of the interpolated lines */
+    unsigned int parity;
+};
+
+/** @internal @This reads a sample of a line.
+ *
+ * @param line pointer to the line
+ * @param x index of the sample
+ * @param wide true if the samples are 16 bits wide
+ * @return value of the sample
+ */
+static inline int upipe_filter_yadif_get(const void *line, ptrdiff_t x,
+                                         bool wide)
+{
+    return wide ? ((const uint16_t *)line)[x] : ((const uint8_t *)line)[x];
+}
+
+/** @internal @This returns the absolute difference between two samples. */
+static inline int upipe_filter_yadif_diff(int a, int b)
+{
+    return a > b ? a - b : b - a;
+}
+
+/** @internal @This returns the smallest of two values. */
+static inline int upipe_filter_yadif_min(int a, int b)
+{
+    return a < b ? a : b;
+}
+
+/** @internal @This returns the largest of two values. */
+static inline int upipe_filter_yadif_max(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+/** @internal @This returns how badly the lines above and below a missing
+ * sample match along a direction, that is the line above shifted by dir
+ * samples against the line below shifted by -dir samples, over three
+ * consecutive samples.
+ *
+ * @param up line above the missing sample
+ * @param down line below the missing sample
+ * @param x index of the missing sample
+ * @param dir horizontal direction
+ * @param wide true if the samples are 16 bits wide
+ * @return cost of the direction
+ */
+static inline int upipe_filter_yadif_edge_cost(const void *up,
+                                               const void *down,
+                                               size_t x, int dir,
+                                               bool wide)
+{
+    int cost = 0;
+    for (int k = -1; k <= 1; k++)
+        cost += upipe_filter_yadif_diff(
+                upipe_filter_yadif_get(up, (ptrdiff_t)x + k + dir, wide),
+                upipe_filter_yadif_get(down, (ptrdiff_t)x + k - dir, wide));
+    return cost;
+}
+
+/** @internal @This predicts a missing sample from the lines above and below
+ * it, averaging along the direction which best follows the edges.
+ *
+ * @param up line above the missing sample
+ * @param down line below the missing sample
+ * @param x index of the missing sample
+ * @param width number of samples per line
+ * @param wide true if the samples are 16 bits wide
+ * @return spatial prediction
+ */
+static inline int upipe_filter_yadif_spatial(const void *up,
+                                             const void *down,
+                                             size_t x, size_t width,
+                                             bool wide)
+{
+    int pred = (upipe_filter_yadif_get(up, x, wide) +
+                upipe_filter_yadif_get(down, x, wide)) >> 1;
+    /* the diagonals need three samples on each side */
+    if (x < 3 || x + 3 >= width)
+        return pred;
+
+    /* the vertical direction wins ties */
+    int best = upipe_filter_yadif_edge_cost(up, down, x, 0, wide) - 1;
+    for (int side = -1; side <= 1; side += 2) {
+        /* a steeper angle is only tried if the shallower one matched */
+        for (int dir = side; dir == side || dir == 2 * side; dir += side) {
+            int cost = upipe_filter_yadif_edge_cost(up, down, x, dir, wide);
+            if (cost >= best)
+                break;
+            best = cost;
+            pred = (upipe_filter_yadif_get(up, (ptrdiff_t)x + dir, wide) +
+                    upipe_filter_yadif_get(down, (ptrdiff_t)x - dir,
+                                           wide)) >> 1;
+        }
+    }
+    return pred;
+}
+
+/** @internal @This interpolates a missing line.
+ *
+ * p and c hold the lines y - 2 to y + 2 of the previous and current
+ * pictures (the lines y +/- 2 may be NULL at the edges), n the lines
+ * y - 1 and y + 1 of the next picture. The temporal neighbours of the
+ * missing field are the previous and current pictures.
+ *
+ * @param dst output line
+ * @param p lines of the previous picture
+ * @param c lines of the current picture
+ * @param n lines of the next picture
+ * @param width number of samples per line
+ * @param wide true if the samples are 16 bits wide
+ */
+static inline void upipe_filter_yadif_line(void *dst,
+                                           const void *const p[5],
+                                           const void *const c[5],
+                                           const void *const n[2],
+                                           size_t width, bool wide)
+{
+    for (size_t x = 0; x < width; x++) {
+        int above = upipe_filter_yadif_get(c[1], x, wide);
+        int below = upipe_filter_yadif_get(c[3], x, wide);
+        int prev = upipe_filter_yadif_get(p[2], x, wide);
+        int cur = upipe_filter_yadif_get(c[2], x, wide);
+        int temporal = (prev + cur) >> 1;
+
+        /* motion at the sample, and around it in both directions of time */
+        int motion = upipe_filter_yadif_diff(prev, cur) >> 1;
+        motion = upipe_filter_yadif_max(motion,
+                (upipe_filter_yadif_diff(
+                    upipe_filter_yadif_get(p[1], x, wide), above) +
+                 upipe_filter_yadif_diff(
+                    upipe_filter_yadif_get(p[3], x, wide), below)) >> 1);
+        motion = upipe_filter_yadif_max(motion,
+                (upipe_filter_yadif_diff(
+                    upipe_filter_yadif_get(n[0], x, wide), above) +
+                 upipe_filter_yadif_diff(
+                    upipe_filter_yadif_get(n[1], x, wide), below)) >> 1);
+
+        if (p[0] != NULL && p[4] != NULL) {
+            /* allow more deviation where the temporal prediction does not
+             * follow the vertical profile of the missing field */
+            int two_up = (upipe_filter_yadif_get(p[0], x, wide) +
+                          upipe_filter_yadif_get(c[0], x, wide)) >> 1;
+            int two_down = (upipe_filter_yadif_get(p[4], x, wide) +
+                            upipe_filter_yadif_get(c[4], x, wide)) >> 1;
+            int hi = upipe_filter_yadif_max(
+                    upipe_filter_yadif_max(temporal - below, temporal - above),
+                    upipe_filter_yadif_min(two_up - above, two_down - below));
+            int lo = upipe_filter_yadif_min(
+                    upipe_filter_yadif_min(temporal - below, temporal - above),
+                    upipe_filter_yadif_max(two_up - above, two_down - below));
+            motion = upipe_filter_yadif_max(motion,
+                                            upipe_filter_yadif_max(lo, -hi));
+        }
+
+        /* keep the spatial prediction within the motion around the
+         * temporal one */
+        int pred = upipe_filter_yadif_spatial(c[1], c[3], x, width, wide);
+        pred = upipe_filter_yadif_min(pred, temporal + motion);
+        pred = upipe_filter_yadif_max(pred, temporal - motion);
+        if (wide)
+            ((uint16_t *)dst)[x] = pred;
+        else
+            ((uint8_t *)dst)[x] = pred;
+    }
+}
+
+/** @internal @This interpolates a missing line of 8 bits samples. */
+static void upipe_filter_yadif_line8(void *dst, const void *const p[5],
+                                     const void *const c[5],
+                                     const void *const n[2], size_t width)
+{
+    upipe_filter_yadif_line(dst, p, c, n, width, false);
+}
+
+/** @internal @This interpolates a missing line of 16 bits samples. */
+static void upipe_filter_yadif_line16(void *dst, const void *const p[5],
+                                      const void *const c[5],
+                                      const void *const n[2], size_t width)
+{
+    upipe_filter_yadif_line(dst, p, c, n, width, true);
+}
+
+/** @internal @This processes a slice of all planes.
+ *
+ * @param opaque pointer to the job
+ * @param slice index of the slice
+ * @param nb_slices number of slices
+ */
+static void upipe_filter_yadif_slice(void *opaque, unsigned int slice,
+                                     unsigned int nb_slices)
+{
+    const struct upipe_filter_yadif_job *job = opaque;
+
+    for (unsigned int i = 0; i < job->nb_planes; i++) {
+        const struct upipe_filter_yadif_plane *plane = &job->planes[i];
+        size_t h = plane->height;
+        size_t start = h * slice / nb_slices;
+        size_t end = h * (slice + 1) / nb_slices;
+        size_t sample = plane->wide ? 2 : 1;
+
+        for (size_t y = start; y < end; y++) {
+            uint8_t *out = plane->out + y * plane->out_stride;
+            const uint8_t *cur = plane->in[1] + y * plane->in_stride[1];
+            if ((y & 1) != job->parity || h < 2) {
+                memcpy(out, cur, plane->width * sample);
+                continue;
+            }
+
+            /* lines of the other field, mirrored at the edges */
+            ssize_t up = y ? y - 1 : y + 1;
+            ssize_t down = y + 1 < h ? y + 1 : y - 1;
+            ssize_t lines[5] = { (ssize_t)y - 2, up, y, down, y + 2 };
+            const void *p[5], *c[5], *n[2];
+            for (int k = 0; k < 5; k++) {
+                if (lines[k] < 0 || lines[k] >= h) {
+                    p[k] = c[k] = NULL;
+                    continue;
+                }
+                p[k] = plane->in[0] + lines[k] * plane->in_stride[0];
+                c[k] = plane->in[1] + lines[k] * plane->in_stride[1];
+            }
+            n[0] = plane->in[2] + up * plane->in_stride[2];
+            n[1] = plane->in[2] + down * plane->in_stride[2];
+
+            if (plane->wide)
+                upipe_filter_yadif_line16(out, p, c, n, plane->width);
+            else
+                upipe_filter_yadif_line8(out, p, c, n, plane->width);
+        }
+    }
+}
+
+/** @internal @This deinterlaces a picture and outputs it.
+ *
+ * @param upipe description structure of the pipe
+ * @param prev previous picture
+ * @param cur picture to deinterlace
+ * @param next next picture
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_filter_yadif_work(struct upipe *upipe, struct uref *prev,
+                                    struct uref *cur, struct uref *next,
+                                    struct upump **upump_p)
+{
+    struct upipe_filter_yadif *upipe_filter_yadif =
+        upipe_filter_yadif_from_upipe(upipe);
+    struct uref *uref = uref_dup(cur);
+    if (unlikely(uref == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    if (ubase_check(uref_pic_get_progressive(cur))) {
+        upipe_filter_yadif_output(upipe, uref, upump_p);
+        return;
+    }
+
+    size_t width = 0, height = 0;
+    uint8_t macropixel;
+    struct uref *frames[3] = { prev, cur, next };
+    for (int i = 0; i < 3; i++) {
+        size_t w, h;
+        if (unlikely(!ubase_check(uref_pic_size(frames[i], &w, &h,
+                                                &macropixel)) ||
+                     (i && (w != width || h != height)))) {
+            upipe_warn(upipe, "picture size changed, not deinterlacing");
+            upipe_filter_yadif_output(upipe, uref, upump_p);
+            return;
+        }
+        width = w;
+        height = h;
+    }
+
+    struct ubuf *ubuf = ubuf_pic_alloc(upipe_filter_yadif->ubuf_mgr,
+                                       width, height);
+    if (unlikely(ubuf == NULL)) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    struct upipe_filter_yadif_job job;
+    job.nb_planes = 0;
+    /* the first field is kept */
+    job.parity = ubase_check(uref_pic_get_tff(cur)) ? 1 : 0;
+
+    int err = UBASE_ERR_NONE;
+    const char *chroma = NULL;
+    while (ubase_check(uref_pic_plane_iterate(cur, &chroma)) && chroma) {
+        struct upipe_filter_yadif_plane *plane = &job.planes[job.nb_planes];
+        uint8_t hsub, vsub, macropixel_size;
+        unsigned int depth;
+        if (unlikely(job.nb_planes >= YADIF_MAX_PLANES ||
+                     !ubase_check(ubuf_pic_chroma_depth(chroma, &depth,
+                                                        NULL)) ||
+                     !ubase_check(uref_pic_plane_size(cur, chroma, NULL,
+                             &hsub, &vsub, &macropixel_size)))) {
+            err = UBASE_ERR_INVALID;
+            break;
+        }
+
+        bool mapped[3] = { false, false, false };
+        for (int i = 0; i < 3; i++) {
+            err = uref_pic_plane_size(frames[i], chroma, &plane->in_stride[i],
+                                      NULL, NULL, NULL);
+            if (ubase_check(err))
+                err = uref_pic_plane_read(frames[i], chroma, 0, 0, -1, -1,
+                                          &plane->in[i]);
+            if (!ubase_check(err))
+                break;
+            mapped[i] = true;
+        }
+        if (ubase_check(err))
+            err = ubuf_pic_plane_size(ubuf, chroma, &plane->out_stride,
+                                      NULL, NULL, NULL);
+        if (ubase_check(err))
+            err = ubuf_pic_plane_write(ubuf, chroma, 0, 0, -1, -1,
+                                       &plane->out);
+        if (!ubase_check(err)) {
+            for (int i = 0; i < 3; i++)
+                if (mapped[i])
+                    uref_pic_plane_unmap(frames[i], chroma, 0, 0, -1, -1);
+            break;
+        }
+
+        plane->wide = depth > 8;
+        plane->width = width / hsub / macropixel * macropixel_size /
+                       (plane->wide ? 2 : 1);
+        plane->height = height / vsub;
+        job.nb_planes++;
+    }
+
+    if (ubase_check(err))
+        uslice_pool_run(upipe_filter_yadif->pool,
+                        2 * uslice_pool_threads(upipe_filter_yadif->pool),
+                        upipe_filter_yadif_slice, &job);
+
+    /* unmap in the same order as the planes were mapped */
+    chroma = NULL;
+    for (unsigned int i = 0; i < job.nb_planes; i++) {
+        uref_pic_plane_iterate(cur, &chroma);
+        for (int j = 0; j < 3; j++)
+            uref_pic_plane_unmap(frames[j], chroma, 0, 0, -1, -1);
+        ubuf_pic_plane_unmap(ubuf, chroma, 0, 0, -1, -1);
+    }
+
+    if (unlikely(!ubase_check(err))) {
+        upipe_warn(upipe, "unable to deinterlace picture");
+        ubuf_free(ubuf);
+        uref_free(uref);
+        upipe_throw_error(upipe, err);
+        return;
+    }
+
+    uref_attach_ubuf(uref, ubuf);
+    uref_pic_set_progressive(uref);
+    uref_pic_delete_tff(uref);
+    upipe_filter_yadif_output(upipe, uref, upump_p);
+}
+
+/** @internal @This outputs the held picture, using it as its own next
+ * picture.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_filter_yadif_drain(struct upipe *upipe,
+                                     struct upump **upump_p)
+{
+    struct upipe_filter_yadif *upipe_filter_yadif =
+        upipe_filter_yadif_from_upipe(upipe);
+    struct uref *cur = upipe_filter_yadif->cur;
+    struct uref *prev = upipe_filter_yadif->prev;
+    upipe_filter_yadif->cur = upipe_filter_yadif->prev = NULL;
+    if (cur != NULL && upipe_filter_yadif->ubuf_mgr != NULL)
+        upipe_filter_yadif_work(upipe, prev != NULL ? prev : cur, cur, cur,
+                                upump_p);
+    uref_free(prev);
+    uref_free(cur);
+}
+
+/** @internal @This allocates a yadif pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_filter_yadif_alloc(struct upipe_mgr *mgr,
+                                              struct uprobe *uprobe,
+                                              uint32_t signature,
+                                              va_list args)
+{
+    struct upipe *upipe = upipe_filter_yadif_alloc_void(mgr, uprobe,
+                                                        signature, args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_filter_yadif *upipe_filter_yadif =
+        upipe_filter_yadif_from_upipe(upipe);
+    upipe_filter_yadif_init_urefcount(upipe);
+    upipe_filter_yadif_init_ubuf_mgr(upipe);
+    upipe_filter_yadif_init_output(upipe);
+    upipe_filter_yadif_init_input(upipe);
+    upipe_filter_yadif->prev = NULL;
+    upipe_filter_yadif->cur = NULL;
+    upipe_filter_yadif->threads = 1;
+    upipe_filter_yadif->pool = NULL;
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This handles input.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to upump structure
+ * @return false if the input must be held
+ */
+static bool upipe_filter_yadif_handle(struct upipe *upipe, struct uref *uref,
+                                      struct upump **upump_p)
+{
+    struct upipe_filter_yadif *upipe_filter_yadif =
+        upipe_filter_yadif_from_upipe(upipe);
+    const char *def;
+    if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+        upipe_filter_yadif_drain(upipe, upump_p);
+        upipe_filter_yadif_store_flow_def(upipe, NULL);
+        upipe_filter_yadif_require_ubuf_mgr(upipe, uref);
+        return true;
+    }
+
+    if (upipe_filter_yadif->flow_def == NULL)
+        return false;
+
+    if (upipe_filter_yadif->cur != NULL) {
+        struct uref *prev = upipe_filter_yadif->prev;
+        upipe_filter_yadif_work(upipe, prev != NULL ? prev : 
+                                upipe_filter_yadif->cur,
+                                upipe_filter_yadif->cur, uref, upump_p);
+        uref_free(prev);
+    }
+    upipe_filter_yadif->prev = upipe_filter_yadif->cur;
+    upipe_filter_yadif->cur = uref;
+    return true;
+}
+
+/** @internal @This inputs data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_filter_yadif_input(struct upipe *upipe, struct uref *uref,
+                                     struct upump **upump_p)
+{
+    if (!upipe_filter_yadif_check_input(upipe)) {
+        upipe_filter_yadif_hold_input(upipe, uref);
+        upipe_filter_yadif_block_input(upipe, upump_p);
+    } else if (!upipe_filter_yadif_handle(upipe, uref, upump_p)) {
+        upipe_filter_yadif_hold_input(upipe, uref);
+        upipe_filter_yadif_block_input(upipe, upump_p);
+        /* Increment upipe refcount to avoid disappearing before all packets
+         * have been sent. */
+        upipe_use(upipe);
+    }
+}
+
+/** @internal @This checks if the input may start.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_format amended flow format
+ * @return an error code
+ */
+static int upipe_filter_yadif_check(struct upipe *upipe,
+                                    struct uref *flow_format)
+{
+    struct upipe_filter_yadif *upipe_filter_yadif =
+        upipe_filter_yadif_from_upipe(upipe);
+    if (flow_format != NULL)
+        upipe_filter_yadif_store_flow_def(upipe, flow_format);
+
+    if (upipe_filter_yadif->flow_def == NULL)
+        return UBASE_ERR_NONE;
+
+    bool was_buffered = !upipe_filter_yadif_check_input(upipe);
+    upipe_filter_yadif_output_input(upipe);
+    upipe_filter_yadif_unblock_input(upipe);
+    if (was_buffered && upipe_filter_yadif_check_input(upipe)) {
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_filter_yadif_input. */
+        upipe_release(upipe);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_filter_yadif_set_flow_def(struct upipe *upipe,
+                                           struct uref *flow_def)
+{
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_flow_match_def(flow_def, "pic."))
+
+    uint8_t planes;
+    UBASE_RETURN(uref_pic_flow_get_planes(flow_def, &planes))
+    if (unlikely(planes > YADIF_MAX_PLANES))
+        return UBASE_ERR_INVALID;
+    for (uint8_t plane = 0; plane < planes; plane++) {
+        const char *chroma;
+        unsigned int depth;
+        bool big_endian;
+        UBASE_RETURN(uref_pic_flow_get_chroma(flow_def, &chroma, plane))
+        /* only planar formats in native byte order are supported */
+        if (!ubase_check(ubuf_pic_chroma_depth(chroma, &depth,
+                                               &big_endian))) {
+            upipe_err_va(upipe, "unsupported chroma %s", chroma);
+            return UBASE_ERR_INVALID;
+        }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        big_endian = !big_endian;
+#endif
+        if (depth > 8 && big_endian) {
+            upipe_err_va(upipe, "unsupported byte order for chroma %s",
+                         chroma);
+            return UBASE_ERR_INVALID;
+        }
+    }
+
+    struct uref *flow_def_dup;
+    if (unlikely((flow_def_dup = uref_dup(flow_def)) == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+    UBASE_RETURN(uref_pic_set_progressive(flow_def_dup))
+    upipe_input(upipe, flow_def_dup, NULL);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the number of threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the pipe thread
+ * @return an error code
+ */
+static int _upipe_filter_yadif_set_threads(struct upipe *upipe,
+                                          unsigned int threads)
+{
+    struct upipe_filter_yadif *upipe_filter_yadif =
+        upipe_filter_yadif_from_upipe(upipe);
+    if (!threads)
+        return UBASE_ERR_INVALID;
+    if (threads == upipe_filter_yadif->threads)
+        return UBASE_ERR_NONE;
+
+    struct uslice_pool *pool = NULL;
+    if (threads > 1) {
+        pool = uslice_pool_alloc(threads - 1);
+        if (unlikely(pool == NULL)) {
+            upipe_err_va(upipe, "unable to start %u threads", threads);
+            return UBASE_ERR_EXTERNAL;
+        }
+    }
+    uslice_pool_free(upipe_filter_yadif->pool);
+    upipe_filter_yadif->pool = pool;
+    upipe_filter_yadif->threads = threads;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on the pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_filter_yadif_control(struct upipe *upipe,
+                                      int command, va_list args)
+{
+    struct upipe_filter_yadif *upipe_filter_yadif =
+        upipe_filter_yadif_from_upipe(upipe);
+
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR ||
+                request->type == UREQUEST_FLOW_FORMAT)
+                return upipe_throw_provide_request(upipe, request);
+            return upipe_filter_yadif_alloc_output_proxy(upipe, request);
+        }
+        case UPIPE_UNREGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR ||
+                request->type == UREQUEST_FLOW_FORMAT)
+                return UBASE_ERR_NONE;
+            return upipe_filter_yadif_free_output_proxy(upipe, request);
+        }
+        case UPIPE_GET_FLOW_DEF: {
+            struct uref **p = va_arg(args, struct uref **);
+            return upipe_filter_yadif_get_flow_def(upipe, p);
+        }
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_filter_yadif_set_flow_def(upipe, flow_def);
+        }
+        case UPIPE_GET_OUTPUT: {
+            struct upipe **p = va_arg(args, struct upipe **);
+            return upipe_filter_yadif_get_output(upipe, p);
+        }
+        case UPIPE_SET_OUTPUT: {
+            struct upipe *output = va_arg(args, struct upipe *);
+            return upipe_filter_yadif_set_output(upipe, output);
+        }
+        case UPIPE_FLUSH:
+            upipe_filter_yadif_drain(upipe, NULL);
+            return UBASE_ERR_NONE;
+
+        case UPIPE_FILTER_YADIF_GET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FILTER_YADIF_SIGNATURE)
+            unsigned int *p = va_arg(args, unsigned int *);
+            *p = upipe_filter_yadif->threads;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_FILTER_YADIF_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FILTER_YADIF_SIGNATURE)
+            unsigned int threads = va_arg(args, unsigned int);
+            return _upipe_filter_yadif_set_threads(upipe, threads);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_filter_yadif_free(struct upipe *upipe)
+{
+    struct upipe_filter_yadif *upipe_filter_yadif =
+        upipe_filter_yadif_from_upipe(upipe);
+
+    upipe_filter_yadif_drain(upipe, NULL);
+    upipe_throw_dead(upipe);
+
+    uslice_pool_free(upipe_filter_yadif->pool);
+    upipe_filter_yadif_clean_input(upipe);
+    upipe_filter_yadif_clean_ubuf_mgr(upipe);
+    upipe_filter_yadif_clean_output(upipe);
+    upipe_filter_yadif_clean_urefcount(upipe);
+    upipe_filter_yadif_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_filter_yadif_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_FILTER_YADIF_SIGNATURE,
+
+    .upipe_alloc = upipe_filter_yadif_alloc,
+    .upipe_input = upipe_filter_yadif_input,
+    .upipe_control = upipe_filter_yadif_control
+};
+
+/** @This returns the management structure for yadif pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_filter_yadif_mgr_alloc(void)
+{
+    return &upipe_filter_yadif_mgr;
+}
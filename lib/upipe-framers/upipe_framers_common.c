@@ -28,17 +28,39 @@
 
 #include <upipe-framers/upipe_framers_common.h>
 
-/** @This scans for an MPEG-style 3-octet start code in a linear buffer.
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/** @internal @This is the type of the vector routines looking for the first
+ * 00 00 01 sequence.
+ *
+ * @param p pointer to the first candidate position, plus 3
+ * @param end end of linear buffer
+ * @return pointer to the found sequence plus 3, or to the first position
+ * that was not checked plus 3
+ */
+typedef const uint8_t *(*upipe_framers_mpeg_find)(const uint8_t *p,
+                                                  const uint8_t *end);
+
+/** @This scans for an MPEG-style 3-octet start code in a linear buffer,
+ * using a vector routine to skip over large portions without start code.
  *
  * @param p linear buffer
  * @param end end of linear buffer
  * @param state state of the algorithm
+ * @param find vector routine, or NULL
  * @return pointer to start code, or end if not found
  */
 /* Code from libav/libavcodec/mpegvideo.c, published under LGPL 2.1+ */
-const uint8_t *upipe_framers_mpeg_scan(const uint8_t *restrict p,
-                                       const uint8_t *end,
-                                       uint32_t *restrict state)
+static inline __attribute__((always_inline)) const uint8_t *
+    upipe_framers_mpeg_scan_tmpl(const uint8_t *restrict p,
+                                 const uint8_t *end,
+                                 uint32_t *restrict state,
+                                 upipe_framers_mpeg_find find)
 {
     int i;
     for (i = 0; i < 3; i++) {
@@ -48,6 +70,9 @@ const uint8_t *upipe_framers_mpeg_scan(const uint8_t *restrict p,
             return p;
     }
 
+    if (find != NULL)
+        p = find(p, end);
+
     while (p < end) {
         if      (p[-1] > 1      ) p += 3;
         else if (p[-2]          ) p += 2;
@@ -66,3 +91,203 @@ const uint8_t *upipe_framers_mpeg_scan(const uint8_t *restrict p,
 }
 /* End code */
 
+/** @This scans for an MPEG-style 3-octet start code in a linear buffer,
+ * without vector instructions.
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @param state state of the algorithm
+ * @return pointer to start code, or end if not found
+ */
+const uint8_t *upipe_framers_mpeg_scan_c(const uint8_t *restrict p,
+                                         const uint8_t *end,
+                                         uint32_t *restrict state)
+{
+    return upipe_framers_mpeg_scan_tmpl(p, end, state, NULL);
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+/** @internal @This looks for the first 00 00 01 sequence, 16 octets at a
+ * time.
+ *
+ * @param p pointer to the first candidate position, plus 3
+ * @param end end of linear buffer
+ * @return pointer to the found sequence plus 3, or to the first position
+ * that was not checked plus 3
+ */
+__attribute__((target("sse2")))
+static const uint8_t *upipe_framers_mpeg_find_sse2(const uint8_t *p,
+                                                   const uint8_t *end)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    p -= 3;
+    while (end - p >= 16 + 3) {
+        __m128i a = _mm_loadu_si128((const __m128i *)p);
+        __m128i b = _mm_loadu_si128((const __m128i *)(p + 1));
+        __m128i c = _mm_loadu_si128((const __m128i *)(p + 2));
+        __m128i m = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(a, zero),
+                                                _mm_cmpeq_epi8(b, zero)),
+                                  _mm_cmpeq_epi8(c, one));
+        unsigned int mask = _mm_movemask_epi8(m);
+        if (mask)
+            return p + __builtin_ctz(mask) + 3;
+        p += 16;
+    }
+    return p + 3;
+}
+
+/** @internal @This looks for the first 00 00 01 sequence, 32 octets at a
+ * time.
+ *
+ * @param p pointer to the first candidate position, plus 3
+ * @param end end of linear buffer
+ * @return pointer to the found sequence plus 3, or to the first position
+ * that was not checked plus 3
+ */
+__attribute__((target("avx2")))
+static const uint8_t *upipe_framers_mpeg_find_avx2(const uint8_t *p,
+                                                   const uint8_t *end)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    p -= 3;
+    while (end - p >= 32 + 3) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)p);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p + 1));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(p + 2));
+        __m256i m = _mm256_and_si256(_mm256_and_si256(
+                    _mm256_cmpeq_epi8(a, zero), _mm256_cmpeq_epi8(b, zero)),
+                _mm256_cmpeq_epi8(c, one));
+        unsigned int mask = _mm256_movemask_epi8(m);
+        if (mask)
+            return p + __builtin_ctz(mask) + 3;
+        p += 32;
+    }
+    return upipe_framers_mpeg_find_sse2(p + 3, end);
+}
+
+/** @This scans for an MPEG-style 3-octet start code in a linear buffer,
+ * using SSE2 instructions.
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @param state state of the algorithm
+ * @return pointer to start code, or end if not found
+ */
+__attribute__((target("sse2")))
+const uint8_t *upipe_framers_mpeg_scan_sse2(const uint8_t *restrict p,
+                                            const uint8_t *end,
+                                            uint32_t *restrict state)
+{
+    return upipe_framers_mpeg_scan_tmpl(p, end, state,
+                                        upipe_framers_mpeg_find_sse2);
+}
+
+/** @This scans for an MPEG-style 3-octet start code in a linear buffer,
+ * using AVX2 instructions.
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @param state state of the algorithm
+ * @return pointer to start code, or end if not found
+ */
+__attribute__((target("avx2")))
+const uint8_t *upipe_framers_mpeg_scan_avx2(const uint8_t *restrict p,
+                                            const uint8_t *end,
+                                            uint32_t *restrict state)
+{
+    return upipe_framers_mpeg_scan_tmpl(p, end, state,
+                                        upipe_framers_mpeg_find_avx2);
+}
+#endif
+
+#if defined(__aarch64__)
+/** @internal @This looks for the first 00 00 01 sequence, 16 octets at a
+ * time.
+ *
+ * @param p pointer to the first candidate position, plus 3
+ * @param end end of linear buffer
+ * @return pointer to the found sequence plus 3, or to the first position
+ * that was not checked plus 3
+ */
+static const uint8_t *upipe_framers_mpeg_find_neon(const uint8_t *p,
+                                                   const uint8_t *end)
+{
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t one = vdupq_n_u8(1);
+    p -= 3;
+    while (end - p >= 16 + 3) {
+        uint8x16_t m = vandq_u8(vandq_u8(vceqq_u8(vld1q_u8(p), zero),
+                                         vceqq_u8(vld1q_u8(p + 1), zero)),
+                                vceqq_u8(vld1q_u8(p + 2), one));
+        /* 4 bits per octet */
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+                    vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+        if (mask)
+            return p + __builtin_ctzll(mask) / 4 + 3;
+        p += 16;
+    }
+    return p + 3;
+}
+
+/** @This scans for an MPEG-style 3-octet start code in a linear buffer,
+ * using NEON instructions.
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @param state state of the algorithm
+ * @return pointer to start code, or end if not found
+ */
+const uint8_t *upipe_framers_mpeg_scan_neon(const uint8_t *restrict p,
+                                            const uint8_t *end,
+                                            uint32_t *restrict state)
+{
+    return upipe_framers_mpeg_scan_tmpl(p, end, state,
+                                        upipe_framers_mpeg_find_neon);
+}
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+/** @internal @This is the type of the scan implementations. */
+typedef const uint8_t *(*upipe_framers_mpeg_scan_func)(
+        const uint8_t *restrict, const uint8_t *, uint32_t *restrict);
+
+/** @internal @This is the implementation selected for the CPU, or NULL
+ * until the first scan. */
+static upipe_framers_mpeg_scan_func upipe_framers_mpeg_scan_impl = NULL;
+#endif
+
+/** @This scans for an MPEG-style 3-octet start code in a linear buffer,
+ * using the fastest implementation supported by the CPU.
+ *
+ * @param p linear buffer
+ * @param end end of linear buffer
+ * @param state state of the algorithm
+ * @return pointer to start code, or end if not found
+ */
+const uint8_t *upipe_framers_mpeg_scan(const uint8_t *restrict p,
+                                       const uint8_t *end,
+                                       uint32_t *restrict state)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    upipe_framers_mpeg_scan_func scan =
+        __atomic_load_n(&upipe_framers_mpeg_scan_impl, __ATOMIC_RELAXED);
+    if (unlikely(scan == NULL)) {
+        /* concurrent first calls all store the same value */
+        if (__builtin_cpu_supports("avx2"))
+            scan = upipe_framers_mpeg_scan_avx2;
+        else if (__builtin_cpu_supports("sse2"))
+            scan = upipe_framers_mpeg_scan_sse2;
+        else
+            scan = upipe_framers_mpeg_scan_c;
+        __atomic_store_n(&upipe_framers_mpeg_scan_impl, scan,
+                         __ATOMIC_RELAXED);
+    }
+    return scan(p, end, state);
+#elif defined(__aarch64__)
+    return upipe_framers_mpeg_scan_neon(p, end, state);
+#else
+    return upipe_framers_mpeg_scan_c(p, end, state);
+#endif
+}
@@ -367,16 +367,15 @@ static struct upipe *upipe_h264f_alloc(struct upipe_mgr *mgr,
 
 /** @internal @This parses scaling matrices.
  *
- * @param s ubuf block stream
+ * @param s h26x bit reader
  */
-static void upipe_h264f_stream_parse_scaling(struct ubuf_block_stream *s,
+static void upipe_h264f_stream_parse_scaling(struct upipe_h26xf_bits *s,
                                              int nb_lists)
 {
     int i, j;
     for (i = 0; i < nb_lists; i++) {
-        upipe_h26xf_stream_fill_bits(s, 1);
-        bool seq_scaling_list = ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool seq_scaling_list = upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (!seq_scaling_list)
             continue;
 
@@ -384,7 +383,7 @@ static void upipe_h264f_stream_parse_scaling(struct ubuf_block_stream *s,
         int32_t last_scale = 8, next_scale = 8;
         for (j = 0; j < scaling_list_size; j++) {
             if (next_scale != 0)
-                next_scale = (last_scale + upipe_h26xf_stream_se(s) + 256) %
+                next_scale = (last_scale + upipe_h26xf_bits_se(s) + 256) %
                              256;
             last_scale = (next_scale == 0) ? last_scale : next_scale;
         }
@@ -394,56 +393,52 @@ static void upipe_h264f_stream_parse_scaling(struct ubuf_block_stream *s,
 /** @internal @This parses hrd parameters.
  *
  * @param upipe description structure of the pipe
- * @param s ubuf block stream
+ * @param s h26x bit reader
  * @param octetrate_p filled in with the octet rate
  * @param cpb_size_p filled in with the CPB buffer size
  * @return UBASE_ERR_NONE if the hrd parameters were parsed successfully
  */
 static int upipe_h264f_stream_parse_hrd(struct upipe *upipe,
-                                        struct ubuf_block_stream *s,
+                                        struct upipe_h26xf_bits *s,
                                         uint64_t *octetrate_p,
                                         uint64_t *cpb_size_p)
 {
     struct upipe_h264f *upipe_h264f = upipe_h264f_from_upipe(upipe);
-    uint32_t cpb_cnt = upipe_h26xf_stream_ue(s) + 1;
+    uint32_t cpb_cnt = upipe_h26xf_bits_ue(s) + 1;
     if (!cpb_cnt || cpb_cnt > 32) {
         upipe_warn_va(upipe, "invalid cpb_cnt %"PRIu32, cpb_cnt);
         return UBASE_ERR_INVALID;
     }
-    upipe_h26xf_stream_fill_bits(s, 8);
-    uint8_t bitrate_scale = ubuf_block_stream_show_bits(s, 4);
-    ubuf_block_stream_skip_bits(s, 4);
-    uint8_t cpb_size_scale = ubuf_block_stream_show_bits(s, 4);
-    ubuf_block_stream_skip_bits(s, 4);
+    uint8_t bitrate_scale = upipe_h26xf_bits_show(s, 4);
+    upipe_h26xf_bits_skip(s, 4);
+    uint8_t cpb_size_scale = upipe_h26xf_bits_show(s, 4);
+    upipe_h26xf_bits_skip(s, 4);
 
     /* Use first value to deduce bitrate and cpb size */
     *octetrate_p =
-        (((uint64_t)upipe_h26xf_stream_ue(s) + 1) << (6 + bitrate_scale)) / 8;
+        (((uint64_t)upipe_h26xf_bits_ue(s) + 1) << (6 + bitrate_scale)) / 8;
     *cpb_size_p =
-        (((uint64_t)upipe_h26xf_stream_ue(s) + 1) << (4 + cpb_size_scale)) / 8;
-    upipe_h26xf_stream_fill_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1); /* cbr_flag */
+        (((uint64_t)upipe_h26xf_bits_ue(s) + 1) << (4 + cpb_size_scale)) / 8;
+    upipe_h26xf_bits_skip(s, 1); /* cbr_flag */
     cpb_cnt--;
 
     /* Next values dropped, if present */
     while (cpb_cnt) {
-        upipe_h26xf_stream_ue(s);
-        upipe_h26xf_stream_ue(s);
-        upipe_h26xf_stream_fill_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        upipe_h26xf_bits_ue(s);
+        upipe_h26xf_bits_ue(s);
+        upipe_h26xf_bits_skip(s, 1);
         cpb_cnt--;
     }
 
-    upipe_h26xf_stream_fill_bits(s, 20);
     upipe_h264f->initial_cpb_removal_delay_length =
-        ubuf_block_stream_show_bits(s, 5) + 1;
-    ubuf_block_stream_skip_bits(s, 5);
+        upipe_h26xf_bits_show(s, 5) + 1;
+    upipe_h26xf_bits_skip(s, 5);
     upipe_h264f->cpb_removal_delay_length =
-        ubuf_block_stream_show_bits(s, 5) + 1;
-    ubuf_block_stream_skip_bits(s, 5);
+        upipe_h26xf_bits_show(s, 5) + 1;
+    upipe_h26xf_bits_skip(s, 5);
     upipe_h264f->dpb_output_delay_length =
-        ubuf_block_stream_show_bits(s, 5) + 1;
-    ubuf_block_stream_skip_bits(s, 10);
+        upipe_h26xf_bits_show(s, 5) + 1;
+    upipe_h26xf_bits_skip(s, 10);
 
     return UBASE_ERR_NONE;
 }
@@ -471,27 +466,25 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
     UBASE_FATAL(upipe, uref_h26x_flow_set_encaps(flow_def,
                 upipe_h264f->encaps_input))
 
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    if (!ubase_check(ubuf_block_stream_init(s, upipe_h264f->sps[sps_id], 1))) {
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    if (!ubase_check(upipe_h26xf_bits_init(s, upipe_h264f->sps[sps_id], 1))) {
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return false;
     }
 
-    upipe_h26xf_stream_fill_bits(s, 24);
-    uint8_t profile = upipe_h264f->profile = ubuf_block_stream_show_bits(s, 8);
-    ubuf_block_stream_skip_bits(s, 8);
+    uint8_t profile = upipe_h264f->profile = upipe_h26xf_bits_show(s, 8);
+    upipe_h26xf_bits_skip(s, 8);
     UBASE_FATAL(upipe, uref_h264_flow_set_profile(flow_def, profile))
 
     uint8_t profile_compatibility = upipe_h264f->profile_compatibility =
-        ubuf_block_stream_show_bits(s, 8);
-    ubuf_block_stream_skip_bits(s, 8);
+        upipe_h26xf_bits_show(s, 8);
+    upipe_h26xf_bits_skip(s, 8);
     UBASE_FATAL(upipe, uref_h264_flow_set_profile_compatibility(flow_def,
                 profile_compatibility))
 
-    uint8_t level = ubuf_block_stream_show_bits(s, 8);
-    ubuf_block_stream_skip_bits(s, 8);
+    uint8_t level = upipe_h26xf_bits_show(s, 8);
+    upipe_h26xf_bits_skip(s, 8);
     UBASE_FATAL(upipe, uref_h264_flow_set_level(flow_def, level))
 
     uint64_t max_octetrate, max_bs;
@@ -555,7 +548,7 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
     UBASE_FATAL(upipe, uref_block_flow_set_max_octetrate(flow_def, max_octetrate))
     UBASE_FATAL(upipe, uref_block_flow_set_max_buffer_size(flow_def, max_bs))
 
-    upipe_h26xf_stream_ue(s); /* sps_id */
+    upipe_h26xf_bits_ue(s); /* sps_id */
     uint32_t chroma_idc = 1;
     uint8_t luma_depth = 8, chroma_depth = 8;
     upipe_h264f->separate_colour_plane = false;
@@ -563,22 +556,20 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
         profile ==  44 || profile ==  83 || profile ==  86 || profile == 118 ||
         profile == 128)
     {
-        chroma_idc = upipe_h26xf_stream_ue(s);
+        chroma_idc = upipe_h26xf_bits_ue(s);
         if (chroma_idc == H264SPS_CHROMA_444) {
-            upipe_h26xf_stream_fill_bits(s, 1);
             upipe_h264f->separate_colour_plane =
-                !!ubuf_block_stream_show_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
+                !!upipe_h26xf_bits_show(s, 1);
+            upipe_h26xf_bits_skip(s, 1);
         }
-        luma_depth += upipe_h26xf_stream_ue(s);
+        luma_depth += upipe_h26xf_bits_ue(s);
         if (!upipe_h264f->separate_colour_plane)
-            chroma_depth += upipe_h26xf_stream_ue(s);
+            chroma_depth += upipe_h26xf_bits_ue(s);
         else
             chroma_depth = luma_depth;
-        upipe_h26xf_stream_fill_bits(s, 2);
-        ubuf_block_stream_skip_bits(s, 1); /* qpprime_y_zero_transform_etc. */
-        bool seq_scaling_matrix = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        upipe_h26xf_bits_skip(s, 1); /* qpprime_y_zero_transform_etc. */
+        bool seq_scaling_matrix = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
 
         if (seq_scaling_matrix)
             upipe_h264f_stream_parse_scaling(s,
@@ -619,7 +610,7 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
             default:
                 upipe_err_va(upipe, "invalid chroma format %"PRIu32,
                              chroma_idc);
-                ubuf_block_stream_clean(s);
+                upipe_h26xf_bits_clean(s);
                 uref_free(flow_def);
                 return false;
         }
@@ -639,77 +630,74 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
     }
 
     /* Skip i_log2_max_frame_num */
-    upipe_h264f->log2_max_frame_num = 4 + upipe_h26xf_stream_ue(s);
+    upipe_h264f->log2_max_frame_num = 4 + upipe_h26xf_bits_ue(s);
     if (upipe_h264f->log2_max_frame_num > 16) {
         upipe_err_va(upipe, "invalid log2_max_frame_num %"PRIu32,
                      upipe_h264f->log2_max_frame_num);
         upipe_h264f->log2_max_frame_num = 0;
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         uref_free(flow_def);
         return false;
     }
 
-    upipe_h264f->poc_type = upipe_h26xf_stream_ue(s);
+    upipe_h264f->poc_type = upipe_h26xf_bits_ue(s);
     if (!upipe_h264f->poc_type) {
-        upipe_h264f->log2_max_poc_lsb = 4 + upipe_h26xf_stream_ue(s);
+        upipe_h264f->log2_max_poc_lsb = 4 + upipe_h26xf_bits_ue(s);
         if (upipe_h264f->log2_max_poc_lsb > 16) {
             upipe_err_va(upipe, "invalid log2_max_poc_lsb %"PRIu32,
                          upipe_h264f->log2_max_poc_lsb);
             upipe_h264f->log2_max_poc_lsb = 0;
-            ubuf_block_stream_clean(s);
+            upipe_h26xf_bits_clean(s);
             uref_free(flow_def);
             return false;
         }
 
     } else if (upipe_h264f->poc_type == 1) {
-        upipe_h26xf_stream_fill_bits(s, 1);
         upipe_h264f->delta_poc_always_zero =
-            !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
-        upipe_h26xf_stream_se(s); /* offset_for_non_ref_pic */
-        upipe_h26xf_stream_se(s); /* offset_for_top_to_bottom_field */
-        uint32_t cycle = upipe_h26xf_stream_ue(s);
+            !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
+        upipe_h26xf_bits_se(s); /* offset_for_non_ref_pic */
+        upipe_h26xf_bits_se(s); /* offset_for_top_to_bottom_field */
+        uint32_t cycle = upipe_h26xf_bits_ue(s);
         if (cycle > 256) {
             upipe_err_va(upipe, "invalid num_ref_frames_in_poc_cycle %"PRIu32,
                          cycle);
-            ubuf_block_stream_clean(s);
+            upipe_h26xf_bits_clean(s);
             uref_free(flow_def);
             return false;
         }
         while (cycle > 0) {
-            upipe_h26xf_stream_se(s); /* offset_for_ref_frame[i] */
+            upipe_h26xf_bits_se(s); /* offset_for_ref_frame[i] */
             cycle--;
         }
     }
 
-    upipe_h26xf_stream_ue(s); /* max_num_ref_frames */
-    upipe_h26xf_stream_fill_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1); /* gaps_in_frame_num_value_allowed */
+    upipe_h26xf_bits_ue(s); /* max_num_ref_frames */
+    upipe_h26xf_bits_skip(s, 1); /* gaps_in_frame_num_value_allowed */
 
-    uint64_t mb_width = upipe_h26xf_stream_ue(s) + 1;
+    uint64_t mb_width = upipe_h26xf_bits_ue(s) + 1;
     uint64_t hsize = mb_width * 16;
 
-    uint64_t map_height = upipe_h26xf_stream_ue(s) + 1;
-    upipe_h26xf_stream_fill_bits(s, 4);
-    upipe_h264f->frame_mbs_only = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    uint64_t map_height = upipe_h26xf_bits_ue(s) + 1;
+    upipe_h264f->frame_mbs_only = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
     uint64_t vsize;
     if (!upipe_h264f->frame_mbs_only) {
         vsize = map_height * 16 * 2;
-        ubuf_block_stream_skip_bits(s, 1); /* mb_adaptive_frame_field */
+        upipe_h26xf_bits_skip(s, 1); /* mb_adaptive_frame_field */
     } else {
         UBASE_FATAL(upipe, uref_pic_set_progressive(flow_def))
         vsize = map_height * 16;
     }
-    ubuf_block_stream_skip_bits(s, 1); /* direct8x8_inference */
+    upipe_h26xf_bits_skip(s, 1); /* direct8x8_inference */
 
-    bool frame_cropping = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1); /* direct8x8_inference */
+    bool frame_cropping = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1); /* direct8x8_inference */
     if (frame_cropping) {
-        uint32_t crop_left = upipe_h26xf_stream_ue(s);
-        uint32_t crop_right = upipe_h26xf_stream_ue(s);
-        uint32_t crop_top = upipe_h26xf_stream_ue(s);
-        uint32_t crop_bottom = upipe_h26xf_stream_ue(s);
+        uint32_t crop_left = upipe_h26xf_bits_ue(s);
+        uint32_t crop_right = upipe_h26xf_bits_ue(s);
+        uint32_t crop_top = upipe_h26xf_bits_ue(s);
+        uint32_t crop_bottom = upipe_h26xf_bits_ue(s);
         uint8_t chroma_array_type = 0;
         if (!upipe_h264f->separate_colour_plane)
             chroma_array_type = chroma_idc;
@@ -727,9 +715,8 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
     UBASE_FATAL(upipe, uref_pic_flow_set_hsize(flow_def, hsize))
     UBASE_FATAL(upipe, uref_pic_flow_set_vsize(flow_def, vsize))
 
-    upipe_h26xf_stream_fill_bits(s, 1);
-    bool vui = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    bool vui = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
     uint8_t video_format = 5;
     bool full_range = false;
     uint8_t colour_primaries = 2;
@@ -737,90 +724,78 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
     uint8_t matrix_coefficients = 2;
 
     if (vui) {
-        upipe_h26xf_stream_fill_bits(s, 1);
-        bool ar_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool ar_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (ar_present) {
-            upipe_h26xf_stream_fill_bits(s, 8);
-            uint8_t ar_idc = ubuf_block_stream_show_bits(s, 8);
-            ubuf_block_stream_skip_bits(s, 8);
+            uint8_t ar_idc = upipe_h26xf_bits_show(s, 8);
+            upipe_h26xf_bits_skip(s, 8);
             if (ar_idc > 0 &&
                 ar_idc < sizeof(upipe_h26xf_sar_from_idc) / sizeof(struct urational)) {
                 UBASE_FATAL(upipe, uref_pic_flow_set_sar(flow_def,
                             upipe_h26xf_sar_from_idc[ar_idc]));
             } else if (ar_idc == H264VUI_AR_EXTENDED) {
                 struct urational sar;
-                upipe_h26xf_stream_fill_bits(s, 16);
-                sar.num = ubuf_block_stream_show_bits(s, 16);
-                ubuf_block_stream_skip_bits(s, 16);
-                upipe_h26xf_stream_fill_bits(s, 16);
-                sar.den = ubuf_block_stream_show_bits(s, 16);
-                ubuf_block_stream_skip_bits(s, 16);
+                sar.num = upipe_h26xf_bits_show(s, 16);
+                upipe_h26xf_bits_skip(s, 16);
+                sar.den = upipe_h26xf_bits_show(s, 16);
+                upipe_h26xf_bits_skip(s, 16);
                 urational_simplify(&sar);
                 UBASE_FATAL(upipe, uref_pic_flow_set_sar(flow_def, sar))
             } else
                 upipe_warn_va(upipe, "unknown aspect ratio idc %"PRIu8, ar_idc);
         }
 
-        upipe_h26xf_stream_fill_bits(s, 3);
-        bool overscan_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool overscan_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (overscan_present) {
             UBASE_FATAL(upipe, uref_pic_flow_set_overscan(flow_def,
-                        !!ubuf_block_stream_show_bits(s, 1)))
-            ubuf_block_stream_skip_bits(s, 1);
+                        !!upipe_h26xf_bits_show(s, 1)))
+            upipe_h26xf_bits_skip(s, 1);
         }
 
-        bool video_signal_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool video_signal_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (video_signal_present) {
-            upipe_h26xf_stream_fill_bits(s, 5);
-            video_format = ubuf_block_stream_show_bits(s, 3);
-            ubuf_block_stream_skip_bits(s, 3);
-            full_range = !!ubuf_block_stream_show_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
-            bool colour_present = !!ubuf_block_stream_show_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
+            video_format = upipe_h26xf_bits_show(s, 3);
+            upipe_h26xf_bits_skip(s, 3);
+            full_range = !!upipe_h26xf_bits_show(s, 1);
+            upipe_h26xf_bits_skip(s, 1);
+            bool colour_present = !!upipe_h26xf_bits_show(s, 1);
+            upipe_h26xf_bits_skip(s, 1);
             if (colour_present) {
-                upipe_h26xf_stream_fill_bits(s, 24);
-                colour_primaries = ubuf_block_stream_show_bits(s, 8);
-                ubuf_block_stream_skip_bits(s, 8);
-                transfer_characteristics = ubuf_block_stream_show_bits(s, 8);
-                ubuf_block_stream_skip_bits(s, 8);
-                matrix_coefficients = ubuf_block_stream_show_bits(s, 8);
-                ubuf_block_stream_skip_bits(s, 8);
+                colour_primaries = upipe_h26xf_bits_show(s, 8);
+                upipe_h26xf_bits_skip(s, 8);
+                transfer_characteristics = upipe_h26xf_bits_show(s, 8);
+                upipe_h26xf_bits_skip(s, 8);
+                matrix_coefficients = upipe_h26xf_bits_show(s, 8);
+                upipe_h26xf_bits_skip(s, 8);
             }
         }
 
-        upipe_h26xf_stream_fill_bits(s, 1);
-        bool chroma_loc_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool chroma_loc_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (chroma_loc_present) {
-            upipe_h26xf_stream_ue(s);
-            upipe_h26xf_stream_ue(s);
+            upipe_h26xf_bits_ue(s);
+            upipe_h26xf_bits_ue(s);
         }
 
-        upipe_h26xf_stream_fill_bits(s, 1);
-        bool timing_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool timing_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (timing_present) {
-            upipe_h26xf_stream_fill_bits(s, 24);
             uint32_t num_units_in_ticks =
-                ubuf_block_stream_show_bits(s, 24) << 8;
-            ubuf_block_stream_skip_bits(s, 24);
+                upipe_h26xf_bits_show(s, 24) << 8;
+            upipe_h26xf_bits_skip(s, 24);
 
-            upipe_h26xf_stream_fill_bits(s, 24);
-            num_units_in_ticks |= ubuf_block_stream_show_bits(s, 8);
-            ubuf_block_stream_skip_bits(s, 8);
-            uint32_t time_scale = ubuf_block_stream_show_bits(s, 16) << 16;
-            ubuf_block_stream_skip_bits(s, 16);
+            num_units_in_ticks |= upipe_h26xf_bits_show(s, 8);
+            upipe_h26xf_bits_skip(s, 8);
+            uint32_t time_scale = upipe_h26xf_bits_show(s, 16) << 16;
+            upipe_h26xf_bits_skip(s, 16);
 
-            upipe_h26xf_stream_fill_bits(s, 17);
-            time_scale |= ubuf_block_stream_show_bits(s, 16);
-            ubuf_block_stream_skip_bits(s, 16);
+            time_scale |= upipe_h26xf_bits_show(s, 16);
+            upipe_h26xf_bits_skip(s, 16);
 
-            bool fixed_frame_rate = ubuf_block_stream_show_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
+            bool fixed_frame_rate = upipe_h26xf_bits_show(s, 1);
+            upipe_h26xf_bits_skip(s, 1);
 
             if (time_scale && num_units_in_ticks) {
                 struct urational frame_rate = {
@@ -844,13 +819,12 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
         }
 
         uint64_t octetrate, cpb_size;
-        upipe_h26xf_stream_fill_bits(s, 1);
-        bool nal_hrd_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool nal_hrd_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (nal_hrd_present) {
             if (!ubase_check(upipe_h264f_stream_parse_hrd(upipe, s, &octetrate,
                                                           &cpb_size))) {
-                ubuf_block_stream_clean(s);
+                upipe_h26xf_bits_clean(s);
                 uref_free(flow_def);
                 return false;
             }
@@ -859,13 +833,12 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
             upipe_h264f->octet_rate = octetrate;
         }
 
-        upipe_h26xf_stream_fill_bits(s, 1);
-        bool vcl_hrd_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool vcl_hrd_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (vcl_hrd_present) {
             if (!ubase_check(upipe_h264f_stream_parse_hrd(upipe, s, &octetrate,
                                                           &cpb_size))) {
-                ubuf_block_stream_clean(s);
+                upipe_h26xf_bits_clean(s);
                 uref_free(flow_def);
                 return false;
             }
@@ -874,29 +847,26 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
         }
 
         if (nal_hrd_present || vcl_hrd_present) {
-            upipe_h26xf_stream_fill_bits(s, 1);
-            if (!!ubuf_block_stream_show_bits(s, 1))
+            if (!!upipe_h26xf_bits_show(s, 1))
                 UBASE_FATAL(upipe, uref_flow_set_lowdelay(flow_def))
-            ubuf_block_stream_skip_bits(s, 1);
+            upipe_h26xf_bits_skip(s, 1);
             upipe_h264f->hrd = true;
         } else
             upipe_h264f->hrd = false;
 
-        upipe_h26xf_stream_fill_bits(s, 2);
-        upipe_h264f->pic_struct_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
-        bool bitstream_restriction = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        upipe_h264f->pic_struct_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
+        bool bitstream_restriction = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
 
         if (bitstream_restriction) {
-            upipe_h26xf_stream_fill_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
-            upipe_h26xf_stream_ue(s);
-            upipe_h26xf_stream_ue(s);
-            upipe_h26xf_stream_ue(s);
-            upipe_h26xf_stream_ue(s);
-            upipe_h26xf_stream_ue(s);
-            upipe_h264f->max_dec_frame_buffering = upipe_h26xf_stream_ue(s);
+            upipe_h26xf_bits_skip(s, 1);
+            upipe_h26xf_bits_ue(s);
+            upipe_h26xf_bits_ue(s);
+            upipe_h26xf_bits_ue(s);
+            upipe_h26xf_bits_ue(s);
+            upipe_h26xf_bits_ue(s);
+            upipe_h264f->max_dec_frame_buffering = upipe_h26xf_bits_ue(s);
         }
     } else {
         upipe_h264f->duration = 0;
@@ -1052,7 +1022,7 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
     }
 
     upipe_h264f->active_sps = sps_id;
-    ubuf_block_stream_clean(s);
+    upipe_h26xf_bits_clean(s);
 
     upipe_h264f_store_flow_def(upipe, NULL);
     uref_free(upipe_h264f->flow_def_requested);
@@ -1077,34 +1047,32 @@ static bool upipe_h264f_activate_pps(struct upipe *upipe, uint32_t pps_id)
     if (unlikely(upipe_h264f->pps[pps_id] == NULL))
         return false;
 
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    if (!ubase_check(ubuf_block_stream_init(s, upipe_h264f->pps[pps_id], 1))) {
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    if (!ubase_check(upipe_h26xf_bits_init(s, upipe_h264f->pps[pps_id], 1))) {
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return false;
     }
 
-    upipe_h26xf_stream_ue(s); /* pps_id */
-    uint32_t sps_id = upipe_h26xf_stream_ue(s);
+    upipe_h26xf_bits_ue(s); /* pps_id */
+    uint32_t sps_id = upipe_h26xf_bits_ue(s);
     if (unlikely(sps_id >= H264SPS_ID_MAX)) {
         upipe_warn_va(upipe, "invalid SPS %"PRIu32, sps_id);
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return false;
     }
 
     if (!upipe_h264f_activate_sps(upipe, sps_id)) {
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return false;
     }
 
-    upipe_h26xf_stream_fill_bits(s, 2);
-    ubuf_block_stream_skip_bits(s, 1);
-    upipe_h264f->bf_poc = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
+    upipe_h264f->bf_poc = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
 
     upipe_h264f->active_pps = pps_id;
-    ubuf_block_stream_clean(s);
+    upipe_h26xf_bits_clean(s);
     return true;
 }
 
@@ -1126,16 +1094,15 @@ static int upipe_h264f_handle_sps(struct upipe *upipe, struct ubuf *ubuf,
     if (unlikely(ubuf == NULL))
         return UBASE_ERR_ALLOC;
 
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    if (!ubase_check(ubuf_block_stream_init(s, ubuf,
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    if (!ubase_check(upipe_h26xf_bits_init(s, ubuf,
                                             H264SPS_HEADER_SIZE - 3))) {
         ubuf_free(ubuf);
         return UBASE_ERR_INVALID;
     }
-    uint32_t sps_id = upipe_h26xf_stream_ue(s);
-    ubuf_block_stream_clean(s);
+    uint32_t sps_id = upipe_h26xf_bits_ue(s);
+    upipe_h26xf_bits_clean(s);
 
     if (unlikely(sps_id >= H264SPS_ID_MAX)) {
         upipe_warn_va(upipe, "invalid SPS %"PRIu32, sps_id);
@@ -1169,15 +1136,14 @@ static int upipe_h264f_handle_sps_ext(struct upipe *upipe, struct ubuf *ubuf,
     if (unlikely(ubuf == NULL))
         return UBASE_ERR_ALLOC;
 
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    if (!ubase_check(ubuf_block_stream_init(s, ubuf, 1))) {
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    if (!ubase_check(upipe_h26xf_bits_init(s, ubuf, 1))) {
         ubuf_free(ubuf);
         return UBASE_ERR_INVALID;
     }
-    uint32_t sps_id = upipe_h26xf_stream_ue(s);
-    ubuf_block_stream_clean(s);
+    uint32_t sps_id = upipe_h26xf_bits_ue(s);
+    upipe_h26xf_bits_clean(s);
 
     if (unlikely(sps_id >= H264SPS_ID_MAX)) {
         upipe_warn_va(upipe, "invalid SPS extension %"PRIu32, sps_id);
@@ -1212,15 +1178,14 @@ static int upipe_h264f_handle_pps(struct upipe *upipe, struct ubuf *ubuf,
     if (unlikely(ubuf == NULL))
         return UBASE_ERR_ALLOC;
 
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    if (!ubase_check(ubuf_block_stream_init(s, ubuf, 1))) {
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    if (!ubase_check(upipe_h26xf_bits_init(s, ubuf, 1))) {
         ubuf_free(ubuf);
         return UBASE_ERR_INVALID;
     }
-    uint32_t pps_id = upipe_h26xf_stream_ue(s);
-    ubuf_block_stream_clean(s);
+    uint32_t pps_id = upipe_h26xf_bits_ue(s);
+    upipe_h26xf_bits_clean(s);
 
     if (unlikely(pps_id >= H264PPS_ID_MAX)) {
         upipe_warn_va(upipe, "invalid PPS %"PRIu32, pps_id);
@@ -1244,13 +1209,13 @@ static int upipe_h264f_handle_pps(struct upipe *upipe, struct ubuf *ubuf,
  * buffering period.
  *
  * @param upipe description structure of the pipe
- * @param s block stream parsing structure
+ * @param s h26x bit reader
  * @return an error code
  */
 static int upipe_h264f_handle_sei_buffering_period(struct upipe *upipe,
-                                                   struct ubuf_block_stream *s)
+                                                   struct upipe_h26xf_bits *s)
 {
-    uint32_t sps_id = upipe_h26xf_stream_ue(s);
+    uint32_t sps_id = upipe_h26xf_bits_ue(s);
     if (unlikely(sps_id >= H264SPS_ID_MAX)) {
         upipe_warn_va(upipe, "invalid SPS %"PRIu32" in SEI", sps_id);
         return UBASE_ERR_INVALID;
@@ -1265,11 +1230,11 @@ static int upipe_h264f_handle_sei_buffering_period(struct upipe *upipe,
  * picture timing.
  *
  * @param upipe description structure of the pipe
- * @param s block stream parsing structure
+ * @param s h26x bit reader
  * @return an error code
  */
 static int upipe_h264f_handle_sei_pic_timing(struct upipe *upipe,
-                                             struct ubuf_block_stream *s)
+                                             struct upipe_h26xf_bits *s)
 {
     struct upipe_h264f *upipe_h264f = upipe_h264f_from_upipe(upipe);
     if (unlikely(upipe_h264f->active_sps == -1)) {
@@ -1281,35 +1246,30 @@ static int upipe_h264f_handle_sei_pic_timing(struct upipe *upipe,
         size_t cpb_removal_delay_length =
             upipe_h264f->cpb_removal_delay_length;
         while (cpb_removal_delay_length > 24) {
-            upipe_h26xf_stream_fill_bits(s, 24);
-            ubuf_block_stream_skip_bits(s, 24);
+            upipe_h26xf_bits_skip(s, 24);
             cpb_removal_delay_length -= 24;
         }
-        upipe_h26xf_stream_fill_bits(s, cpb_removal_delay_length);
-        ubuf_block_stream_skip_bits(s, cpb_removal_delay_length);
+        upipe_h26xf_bits_skip(s, cpb_removal_delay_length);
 
         size_t dpb_output_delay_length =
             upipe_h264f->dpb_output_delay_length;
         uint64_t dpb_output_delay = 0;
         while (dpb_output_delay_length > 24) {
             dpb_output_delay <<= 24;
-            upipe_h26xf_stream_fill_bits(s, 24);
-            dpb_output_delay |= ubuf_block_stream_show_bits(s, 24);
-            ubuf_block_stream_skip_bits(s, 24);
+            dpb_output_delay |= upipe_h26xf_bits_show(s, 24);
+            upipe_h26xf_bits_skip(s, 24);
             dpb_output_delay_length -= 24;
         }
         dpb_output_delay <<= dpb_output_delay_length;
-        upipe_h26xf_stream_fill_bits(s, dpb_output_delay_length);
         dpb_output_delay |=
-            ubuf_block_stream_show_bits(s, dpb_output_delay_length);
-        ubuf_block_stream_skip_bits(s, dpb_output_delay_length);
+            upipe_h26xf_bits_show(s, dpb_output_delay_length);
+        upipe_h26xf_bits_skip(s, dpb_output_delay_length);
         upipe_h264f->dpb_output_delay = dpb_output_delay;
     }
 
     if (upipe_h264f->pic_struct_present) {
-        upipe_h26xf_stream_fill_bits(s, 4);
-        upipe_h264f->pic_struct = ubuf_block_stream_show_bits(s, 4);
-        ubuf_block_stream_skip_bits(s, 4);
+        upipe_h264f->pic_struct = upipe_h26xf_bits_show(s, 4);
+        upipe_h26xf_bits_skip(s, 4);
     }
     return UBASE_ERR_NONE;
 }
@@ -1332,17 +1292,15 @@ static int upipe_h264f_handle_sei(struct upipe *upipe, struct ubuf *ubuf,
     if (type != H264SEI_BUFFERING_PERIOD && type != H264SEI_PIC_TIMING)
         return UBASE_ERR_NONE;
 
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    UBASE_RETURN(ubuf_block_stream_init(s, ubuf, offset + 2))
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    UBASE_RETURN(upipe_h26xf_bits_init(s, ubuf, offset + 2))
 
     /* size field */
     uint8_t octet;
     do {
-        upipe_h26xf_stream_fill_bits(s, 8);
-        octet = ubuf_block_stream_show_bits(s, 8);
-        ubuf_block_stream_skip_bits(s, 8);
+        octet = upipe_h26xf_bits_show(s, 8);
+        upipe_h26xf_bits_skip(s, 8);
     } while (octet == UINT8_MAX);
 
     int err = UBASE_ERR_NONE;
@@ -1357,7 +1315,7 @@ static int upipe_h264f_handle_sei(struct upipe *upipe, struct ubuf *ubuf,
             break;
     }
 
-    ubuf_block_stream_clean(s);
+    upipe_h26xf_bits_clean(s);
     return err;
 }
 
@@ -1376,61 +1334,57 @@ static int upipe_h264f_handle_slice(struct upipe *upipe, struct ubuf *ubuf,
                                     bool *au_slice_p)
 {
     struct upipe_h264f *upipe_h264f = upipe_h264f_from_upipe(upipe);
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    if (unlikely(!ubase_check(ubuf_block_stream_init(s, ubuf, offset + 1))))
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    if (unlikely(!ubase_check(upipe_h26xf_bits_init(s, ubuf, offset + 1))))
         return UBASE_ERR_INVALID;
 
-    upipe_h26xf_stream_ue(s); /* first_mb_in_slice */
-    uint32_t slice_type = upipe_h26xf_stream_ue(s);
-    uint32_t pps_id = upipe_h26xf_stream_ue(s);
+    upipe_h26xf_bits_ue(s); /* first_mb_in_slice */
+    uint32_t slice_type = upipe_h26xf_bits_ue(s);
+    uint32_t pps_id = upipe_h26xf_bits_ue(s);
     if (unlikely(pps_id >= H264PPS_ID_MAX)) {
         upipe_warn_va(upipe, "invalid PPS %"PRIu32" in slice", pps_id);
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return UBASE_ERR_INVALID;
     }
 
     if (*au_slice_p && pps_id != upipe_h264f->active_pps) {
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return UBASE_ERR_BUSY;
     }
 
     if (unlikely(!upipe_h264f_activate_pps(upipe, pps_id))) {
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return UBASE_ERR_INVALID;
     }
 
     if (upipe_h264f->separate_colour_plane) {
-        upipe_h26xf_stream_fill_bits(s, 2);
-        ubuf_block_stream_skip_bits(s, 2);
+        upipe_h26xf_bits_skip(s, 2);
     }
-    upipe_h26xf_stream_fill_bits(s, upipe_h264f->log2_max_frame_num);
-    uint32_t frame_num = ubuf_block_stream_show_bits(s,
+    uint32_t frame_num = upipe_h26xf_bits_show(s,
             upipe_h264f->log2_max_frame_num);
-    ubuf_block_stream_skip_bits(s, upipe_h264f->log2_max_frame_num);
+    upipe_h26xf_bits_skip(s, upipe_h264f->log2_max_frame_num);
     bool field_pic = false;
     bool bf = false;
     if (!upipe_h264f->frame_mbs_only) {
-        upipe_h26xf_stream_fill_bits(s, 2);
-        field_pic = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        field_pic = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (field_pic) {
-            bf = !!ubuf_block_stream_show_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
+            bf = !!upipe_h26xf_bits_show(s, 1);
+            upipe_h26xf_bits_skip(s, 1);
         }
     }
 
     uint32_t idr_pic_id = upipe_h264f->idr_pic_id;
     if (h264nalst_get_type(nal) == H264NAL_TYPE_IDR)
-        idr_pic_id = upipe_h26xf_stream_ue(s);
+        idr_pic_id = upipe_h26xf_bits_ue(s);
 
     if (*au_slice_p &&
         (frame_num != upipe_h264f->frame_num ||
          field_pic != upipe_h264f->field_pic ||
          bf != upipe_h264f->bf ||
          idr_pic_id != upipe_h264f->idr_pic_id)) {
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return UBASE_ERR_BUSY;
     }
     upipe_h264f->frame_num = frame_num;
@@ -1440,18 +1394,17 @@ static int upipe_h264f_handle_slice(struct upipe *upipe, struct ubuf *ubuf,
     upipe_h264f->idr_pic_id = idr_pic_id;
 
     if (upipe_h264f->poc_type == 0) {
-        upipe_h26xf_stream_fill_bits(s, upipe_h264f->log2_max_poc_lsb);
-        uint32_t poc_lsb = ubuf_block_stream_show_bits(s,
+        uint32_t poc_lsb = upipe_h26xf_bits_show(s,
                 upipe_h264f->log2_max_poc_lsb);
-        ubuf_block_stream_skip_bits(s, upipe_h264f->log2_max_poc_lsb);
+        upipe_h26xf_bits_skip(s, upipe_h264f->log2_max_poc_lsb);
         int32_t delta_poc_bottom = 0;
         if (upipe_h264f->bf_poc && !field_pic)
-            delta_poc_bottom = upipe_h26xf_stream_se(s);
+            delta_poc_bottom = upipe_h26xf_bits_se(s);
 
         if (*au_slice_p &&
             (poc_lsb != upipe_h264f->poc_lsb ||
              delta_poc_bottom != upipe_h264f->delta_poc_bottom)) {
-            ubuf_block_stream_clean(s);
+            upipe_h26xf_bits_clean(s);
             return UBASE_ERR_BUSY;
         }
         upipe_h264f->poc_lsb = poc_lsb;
@@ -1459,15 +1412,15 @@ static int upipe_h264f_handle_slice(struct upipe *upipe, struct ubuf *ubuf,
 
     } else if (upipe_h264f->poc_type == 1 &&
                !upipe_h264f->delta_poc_always_zero) {
-        int32_t delta_poc0 = upipe_h26xf_stream_se(s);
+        int32_t delta_poc0 = upipe_h26xf_bits_se(s);
         int32_t delta_poc1 = 0;
         if (upipe_h264f->bf_poc && !field_pic)
-            delta_poc1 = upipe_h26xf_stream_se(s);
+            delta_poc1 = upipe_h26xf_bits_se(s);
 
         if (*au_slice_p &&
             (delta_poc0 != upipe_h264f->delta_poc0 ||
              delta_poc1 != upipe_h264f->delta_poc1)) {
-            ubuf_block_stream_clean(s);
+            upipe_h26xf_bits_clean(s);
             return UBASE_ERR_BUSY;
         }
         upipe_h264f->delta_poc0 = delta_poc0;
@@ -353,7 +353,7 @@ static struct upipe *upipe_h265f_alloc(struct upipe_mgr *mgr,
 /** @internal @This parses profile tier level structure.
  *
  * @param upipe description structure of the pipe
- * @param s ubuf block stream
+ * @param s h26x bit reader
  * @param max_subl_1 maxNumSubLayersMinus1 structure
  * @param profile_space_p filled in with the profile space
  * @param tier_p filled in with the tier flag
@@ -365,7 +365,7 @@ static struct upipe *upipe_h265f_alloc(struct upipe_mgr *mgr,
  * @param constraint_indicator_p filled in with the constraint indicator field
  */
 static void upipe_h265f_stream_parse_ptl(struct upipe *upipe,
-                                         struct ubuf_block_stream *s,
+                                         struct upipe_h26xf_bits *s,
                                          uint8_t max_subl_1,
                                          uint8_t *profile_space_p,
                                          bool *tier_p,
@@ -377,58 +377,51 @@ static void upipe_h265f_stream_parse_ptl(struct upipe *upipe,
                                          uint64_t *constraint_indicator_p)
 {
     struct upipe_h265f *upipe_h265f = upipe_h265f_from_upipe(upipe);
-    upipe_h26xf_stream_fill_bits(s, 8);
-    uint8_t profile_space = ubuf_block_stream_show_bits(s, 2);
-    ubuf_block_stream_skip_bits(s, 2);
+    uint8_t profile_space = upipe_h26xf_bits_show(s, 2);
+    upipe_h26xf_bits_skip(s, 2);
     if (profile_space_p != NULL)
         *profile_space_p = profile_space;
 
-    bool tier = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    bool tier = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
     if (tier_p != NULL)
         *tier_p = tier;
 
-    uint8_t profile_idc = ubuf_block_stream_show_bits(s, 5);
-    ubuf_block_stream_skip_bits(s, 5);
+    uint8_t profile_idc = upipe_h26xf_bits_show(s, 5);
+    upipe_h26xf_bits_skip(s, 5);
     if (profile_idc_p != NULL)
         *profile_idc_p = profile_idc;
 
-    upipe_h26xf_stream_fill_bits(s, 16);
     uint64_t profile_compatibility =
-        (uint64_t)ubuf_block_stream_show_bits(s, 16) << 16;
-    ubuf_block_stream_skip_bits(s, 16);
-    upipe_h26xf_stream_fill_bits(s, 16);
+        (uint64_t)upipe_h26xf_bits_show(s, 16) << 16;
+    upipe_h26xf_bits_skip(s, 16);
     profile_compatibility |=
-        (uint64_t)ubuf_block_stream_show_bits(s, 16);
-    ubuf_block_stream_skip_bits(s, 16);
+        (uint64_t)upipe_h26xf_bits_show(s, 16);
+    upipe_h26xf_bits_skip(s, 16);
     if (profile_compatibility_p != NULL)
         *profile_compatibility_p = profile_compatibility;
 
-    upipe_h26xf_stream_fill_bits(s, 16);
     uint64_t constraint_indicator =
-        (uint64_t)ubuf_block_stream_show_bits(s, 16) << 32;
-    bool general_progressive = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
-    bool general_interlaced = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 15);
+        (uint64_t)upipe_h26xf_bits_show(s, 16) << 32;
+    bool general_progressive = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
+    bool general_interlaced = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 15);
     if (general_progressive_p != NULL)
         *general_progressive_p = general_progressive;
     if (general_interlaced_p != NULL)
         *general_interlaced_p = general_interlaced;
-    upipe_h26xf_stream_fill_bits(s, 16);
     constraint_indicator |=
-        (uint64_t)ubuf_block_stream_show_bits(s, 16) << 16;
-    ubuf_block_stream_skip_bits(s, 16);
-    upipe_h26xf_stream_fill_bits(s, 16);
+        (uint64_t)upipe_h26xf_bits_show(s, 16) << 16;
+    upipe_h26xf_bits_skip(s, 16);
     constraint_indicator |=
-        (uint64_t)ubuf_block_stream_show_bits(s, 16);
-    ubuf_block_stream_skip_bits(s, 16);
+        (uint64_t)upipe_h26xf_bits_show(s, 16);
+    upipe_h26xf_bits_skip(s, 16);
     if (constraint_indicator_p != NULL)
         *constraint_indicator_p = constraint_indicator;
 
-    upipe_h26xf_stream_fill_bits(s, 8);
-    uint8_t level_idc = ubuf_block_stream_show_bits(s, 8);
-    ubuf_block_stream_skip_bits(s, 8);
+    uint8_t level_idc = upipe_h26xf_bits_show(s, 8);
+    upipe_h26xf_bits_skip(s, 8);
     if (level_idc_p != NULL)
         *level_idc_p = level_idc;
 
@@ -436,28 +429,24 @@ static void upipe_h265f_stream_parse_ptl(struct upipe *upipe,
     bool subl_profile_present[max_subl_1];
     bool subl_level_present[max_subl_1];
     for (int i = 0; i < max_subl_1; i++) {
-        upipe_h26xf_stream_fill_bits(s, 2);
-        subl_profile_present[i] = ubuf_block_stream_show_bits(s, 1);
-        subl_level_present[i] = ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 2);
+        subl_profile_present[i] = upipe_h26xf_bits_show(s, 1);
+        subl_level_present[i] = upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 2);
     }
     if (max_subl_1) {
         for (int i = max_subl_1; i < 8; i++) {
-            upipe_h26xf_stream_fill_bits(s, 2);
-            ubuf_block_stream_skip_bits(s, 2);
+            upipe_h26xf_bits_skip(s, 2);
         }
     }
 
     for (int i = 0; i < max_subl_1; i++) {
         if (subl_profile_present[i]) {
             for (int i = 0; i < H265PTL_PROFILE_SIZE; i++) {
-                upipe_h26xf_stream_fill_bits(s, 8);
-                ubuf_block_stream_skip_bits(s, 8);
+                upipe_h26xf_bits_skip(s, 8);
             }
         }
         if (subl_level_present[i]) {
-            upipe_h26xf_stream_fill_bits(s, 8);
-            ubuf_block_stream_skip_bits(s, 8);
+            upipe_h26xf_bits_skip(s, 8);
         }
     }
 }
@@ -465,73 +454,65 @@ static void upipe_h265f_stream_parse_ptl(struct upipe *upipe,
 /** @internal @This parses hrd parameters.
  *
  * @param upipe description structure of the pipe
- * @param s ubuf block stream
+ * @param s h26x bit reader
  * @param octetrate_p filled in with the octet rate
  * @param cpb_size_p filled in with the CPB buffer size
  * @return UBASE_ERR_NONE if the hrd parameters were parsed successfully
  */
 static int upipe_h265f_stream_parse_hrd(struct upipe *upipe,
-                                        struct ubuf_block_stream *s,
+                                        struct upipe_h26xf_bits *s,
                                         uint64_t *octetrate_p,
                                         uint64_t *cpb_size_p)
 {
     struct upipe_h265f *upipe_h265f = upipe_h265f_from_upipe(upipe);
-    upipe_h26xf_stream_fill_bits(s, 2);
-    bool nal_hrd_present = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
-    bool vcl_hrd_present = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    bool nal_hrd_present = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
+    bool vcl_hrd_present = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
 
     uint8_t bitrate_scale = 0, cpb_size_scale = 0;
     if (nal_hrd_present || vcl_hrd_present) {
-        upipe_h26xf_stream_fill_bits(s, 8);
-        bool sub_pic_hrd = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool sub_pic_hrd = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (sub_pic_hrd) {
-            upipe_h26xf_stream_fill_bits(s, 19);
-            ubuf_block_stream_skip_bits(s, 19);
+            upipe_h26xf_bits_skip(s, 19);
         }
 
-        upipe_h26xf_stream_fill_bits(s, 8);
-        bitrate_scale = ubuf_block_stream_show_bits(s, 4);
-        ubuf_block_stream_skip_bits(s, 4);
-        cpb_size_scale = ubuf_block_stream_show_bits(s, 4);
-        ubuf_block_stream_skip_bits(s, 4);
+        bitrate_scale = upipe_h26xf_bits_show(s, 4);
+        upipe_h26xf_bits_skip(s, 4);
+        cpb_size_scale = upipe_h26xf_bits_show(s, 4);
+        upipe_h26xf_bits_skip(s, 4);
         if (sub_pic_hrd) {
-            upipe_h26xf_stream_fill_bits(s, 4);
-            ubuf_block_stream_skip_bits(s, 4); /* cpb_size_du_scale */
+            upipe_h26xf_bits_skip(s, 4); /* cpb_size_du_scale */
         }
         /* initial_cpb_removal_delay_length_minus1,
          * au_cpb_removal_delay_length_minus1,
          * dpb_output_delay_length_minus1 */
-        upipe_h26xf_stream_fill_bits(s, 15);
-        ubuf_block_stream_skip_bits(s, 15);
+        upipe_h26xf_bits_skip(s, 15);
     }
 
-    upipe_h26xf_stream_fill_bits(s, 8);
-    bool fixed_pic_rate = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    bool fixed_pic_rate = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
     bool fixed_pic_rate_within_cvs = true;
     if (!fixed_pic_rate) {
-        fixed_pic_rate_within_cvs = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        fixed_pic_rate_within_cvs = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
     } 
     bool low_delay = false;
     if (fixed_pic_rate_within_cvs)
-        upipe_h26xf_stream_ue(s); /* elemental_duration_in_tc_minus1 */
+        upipe_h26xf_bits_ue(s); /* elemental_duration_in_tc_minus1 */
     else {
-        upipe_h26xf_stream_fill_bits(s, 1);
-        low_delay = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        low_delay = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
     }
     if (!low_delay)
-        upipe_h26xf_stream_ue(s); /* cpb_cnt_minus1 */
+        upipe_h26xf_bits_ue(s); /* cpb_cnt_minus1 */
 
     /* Use first value to deduce bitrate and cpb size */
     *octetrate_p =
-        (((uint64_t)upipe_h26xf_stream_ue(s) + 1) << (6 + bitrate_scale)) / 8;
+        (((uint64_t)upipe_h26xf_bits_ue(s) + 1) << (6 + bitrate_scale)) / 8;
     *cpb_size_p =
-        (((uint64_t)upipe_h26xf_stream_ue(s) + 1) << (4 + cpb_size_scale)) / 8;
+        (((uint64_t)upipe_h26xf_bits_ue(s) + 1) << (4 + cpb_size_scale)) / 8;
 
     /* incomplete parsing */
     return UBASE_ERR_NONE;
@@ -539,27 +520,26 @@ static int upipe_h265f_stream_parse_hrd(struct upipe *upipe,
 
 /** @internal @This parses scaling lists.
  *
- * @param s ubuf block stream
+ * @param s h26x bit reader
  */
-static void upipe_h265f_stream_parse_scaling(struct ubuf_block_stream *s)
+static void upipe_h265f_stream_parse_scaling(struct upipe_h26xf_bits *s)
 {
     for (int size_id = 0; size_id < 4; size_id++) {
         for (int matrix_id = 0; matrix_id < (size_id == 3 ? 2 : 6);
              matrix_id++) {
-            upipe_h26xf_stream_fill_bits(s, 1);
-            bool pred_mode = ubuf_block_stream_show_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
+            bool pred_mode = upipe_h26xf_bits_show(s, 1);
+            upipe_h26xf_bits_skip(s, 1);
             if (!pred_mode)
-                upipe_h26xf_stream_ue(s); /* pred_matrix_id_delta */
+                upipe_h26xf_bits_ue(s); /* pred_matrix_id_delta */
             else {
                 if (size_id > 1)
-                    upipe_h26xf_stream_se(s); /* dc_coef */
+                    upipe_h26xf_bits_se(s); /* dc_coef */
 
                 int coef_num = 1 << (4 + (size_id << 1));
                 if (coef_num > 64)
                     coef_num = 64;
                 for (int i = 0; i < coef_num; i++)
-                    upipe_h26xf_stream_se(s); /* delta_coef */
+                    upipe_h26xf_bits_se(s); /* delta_coef */
             }
         }
     }
@@ -567,7 +547,7 @@ static void upipe_h265f_stream_parse_scaling(struct ubuf_block_stream *s)
 
 /** @internal @This parses a short-term ref pic set.
  *
- * @param s ubuf block stream
+ * @param s h26x bit reader
  * @param idx set index
  * @param max max short term ref pic sets
  * @param max_dec_pic_buffering_1 sps_max_dec_pic_buffering_minux1[sps_max_sub_layers_minus1]
@@ -575,49 +555,44 @@ static void upipe_h265f_stream_parse_scaling(struct ubuf_block_stream *s)
  * @return false in case of error
  */
 static bool
-upipe_h265f_stream_parse_short_term_ref_pic_set(struct ubuf_block_stream *s,
+upipe_h265f_stream_parse_short_term_ref_pic_set(struct upipe_h26xf_bits *s,
         int idx, uint32_t max, uint32_t max_dec_pic_buffering_1,
         uint32_t num_delta_pocs[])
 {
     bool prediction_flag = false;
     if (idx) {
-        upipe_h26xf_stream_fill_bits(s, 1);
-        prediction_flag = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        prediction_flag = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
     }
 
     if (prediction_flag) {
         uint32_t delta_idx = 1;
         if (idx == max)
-            delta_idx = upipe_h26xf_stream_ue(s) + 1;
-        upipe_h26xf_stream_fill_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
-        upipe_h26xf_stream_ue(s);
+            delta_idx = upipe_h26xf_bits_ue(s) + 1;
+        upipe_h26xf_bits_skip(s, 1);
+        upipe_h26xf_bits_ue(s);
         int ref_idx = delta_idx > idx ? 0 : delta_idx;
         for (int i = 0; i < num_delta_pocs[ref_idx]; i++) {
-            upipe_h26xf_stream_fill_bits(s, 2);
-            bool used_by_curr_pic = !!ubuf_block_stream_show_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
+            bool used_by_curr_pic = !!upipe_h26xf_bits_show(s, 1);
+            upipe_h26xf_bits_skip(s, 1);
             if (used_by_curr_pic)
-                ubuf_block_stream_skip_bits(s, 1);
+                upipe_h26xf_bits_skip(s, 1);
         }
     } else {
-        uint32_t num_negative_pics = upipe_h26xf_stream_ue(s);
+        uint32_t num_negative_pics = upipe_h26xf_bits_ue(s);
         if (num_negative_pics > max_dec_pic_buffering_1)
             return false;
-        uint32_t num_positive_pics = upipe_h26xf_stream_ue(s);
+        uint32_t num_positive_pics = upipe_h26xf_bits_ue(s);
         if (num_positive_pics > max_dec_pic_buffering_1 - num_negative_pics)
             return false;
         num_delta_pocs[idx] = num_negative_pics + num_positive_pics;
         for (int i = 0; i < num_negative_pics; i++) {
-            upipe_h26xf_stream_ue(s);
-            upipe_h26xf_stream_fill_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
+            upipe_h26xf_bits_ue(s);
+            upipe_h26xf_bits_skip(s, 1);
         }
         for (int i = 0; i < num_positive_pics; i++) {
-            upipe_h26xf_stream_ue(s);
-            upipe_h26xf_stream_fill_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
+            upipe_h26xf_bits_ue(s);
+            upipe_h26xf_bits_skip(s, 1);
         }
     }
     return true;
@@ -639,20 +614,17 @@ static bool upipe_h265f_activate_vps(struct upipe *upipe, uint32_t vps_id)
         return false;
     }
 
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    if (!ubase_check(ubuf_block_stream_init(s, upipe_h265f->vps[vps_id], 2))) {
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    if (!ubase_check(upipe_h26xf_bits_init(s, upipe_h265f->vps[vps_id], 2))) {
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return false;
     }
 
-    upipe_h26xf_stream_fill_bits(s, 16);
-    ubuf_block_stream_skip_bits(s, 12);
-    uint8_t max_subl_1 = ubuf_block_stream_show_bits(s, 3);
-    ubuf_block_stream_skip_bits(s, 4);
-    upipe_h26xf_stream_fill_bits(s, 16);
-    ubuf_block_stream_skip_bits(s, 16);
+    upipe_h26xf_bits_skip(s, 12);
+    uint8_t max_subl_1 = upipe_h26xf_bits_show(s, 3);
+    upipe_h26xf_bits_skip(s, 4);
+    upipe_h26xf_bits_skip(s, 16);
 
     bool tier, general_progressive, general_interlaced;
     uint8_t profile_space, profile_idc, level_idc;
@@ -673,7 +645,7 @@ static bool upipe_h265f_activate_vps(struct upipe *upipe, uint32_t vps_id)
     upipe_h265f->constraint_indicator = constraint_indicator;
 
     upipe_h265f->active_vps = vps_id;
-    ubuf_block_stream_clean(s);
+    upipe_h26xf_bits_clean(s);
     return true;
 }
 
@@ -702,22 +674,20 @@ static bool upipe_h265f_activate_sps(struct upipe *upipe, uint32_t sps_id)
     UBASE_FATAL(upipe, uref_h26x_flow_set_encaps(flow_def,
                 upipe_h265f->encaps_input))
 
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    if (!ubase_check(ubuf_block_stream_init(s, upipe_h265f->sps[sps_id], 2))) {
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    if (!ubase_check(upipe_h26xf_bits_init(s, upipe_h265f->sps[sps_id], 2))) {
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return false;
     }
 
-    upipe_h26xf_stream_fill_bits(s, 8);
-    uint8_t vps_id = ubuf_block_stream_show_bits(s, 4);
-    ubuf_block_stream_skip_bits(s, 4);
-    uint8_t max_subl_1 = ubuf_block_stream_show_bits(s, 3);
-    ubuf_block_stream_skip_bits(s, 4);
+    uint8_t vps_id = upipe_h26xf_bits_show(s, 4);
+    upipe_h26xf_bits_skip(s, 4);
+    uint8_t max_subl_1 = upipe_h26xf_bits_show(s, 3);
+    upipe_h26xf_bits_skip(s, 4);
 
     if (!upipe_h265f_activate_vps(upipe, vps_id)) {
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return false;
     }
 
@@ -785,81 +755,73 @@ static bool upipe_h265f_activate_sps(struct upipe *upipe, uint32_t sps_id)
 
     upipe_h265f_stream_parse_ptl(upipe, s, max_subl_1, NULL, NULL, NULL,
                                  NULL, NULL, NULL, NULL, NULL);
-    upipe_h26xf_stream_ue(s); /* sps_id */
-    uint32_t chroma_idc = upipe_h265f->chroma_idc = upipe_h26xf_stream_ue(s);
+    upipe_h26xf_bits_ue(s); /* sps_id */
+    uint32_t chroma_idc = upipe_h265f->chroma_idc = upipe_h26xf_bits_ue(s);
     if (chroma_idc == 3) {
-        upipe_h26xf_stream_fill_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1); /* separate_colour_plane */
+        upipe_h26xf_bits_skip(s, 1); /* separate_colour_plane */
     }
 
-    uint32_t hsize = upipe_h26xf_stream_ue(s);
-    uint32_t vsize = upipe_h26xf_stream_ue(s);
+    uint32_t hsize = upipe_h26xf_bits_ue(s);
+    uint32_t vsize = upipe_h26xf_bits_ue(s);
 
-    upipe_h26xf_stream_fill_bits(s, 1);
-    bool conformance_window = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    bool conformance_window = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
     if (conformance_window) {
-        upipe_h26xf_stream_ue(s); /* left offset */
-        upipe_h26xf_stream_ue(s); /* right offset */
-        upipe_h26xf_stream_ue(s); /* top offset */
-        upipe_h26xf_stream_ue(s); /* bottom offset */
+        upipe_h26xf_bits_ue(s); /* left offset */
+        upipe_h26xf_bits_ue(s); /* right offset */
+        upipe_h26xf_bits_ue(s); /* top offset */
+        upipe_h26xf_bits_ue(s); /* bottom offset */
     }
 
-    uint32_t junk1 = upipe_h26xf_stream_ue(s); /* bit_depth_luma */
-    uint32_t junk2 = upipe_h26xf_stream_ue(s); /* bit_depth_chroma */
+    uint32_t junk1 = upipe_h26xf_bits_ue(s); /* bit_depth_luma */
+    uint32_t junk2 = upipe_h26xf_bits_ue(s); /* bit_depth_chroma */
 
-    uint32_t log2_max_pic_order_cnt = upipe_h26xf_stream_ue(s) + 4;
+    uint32_t log2_max_pic_order_cnt = upipe_h26xf_bits_ue(s) + 4;
     if (log2_max_pic_order_cnt > 16) {
         upipe_err_va(upipe, "invalid SPS (max_pic_order_cnt %"PRIu32")",
                      log2_max_pic_order_cnt);
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return false;
     }
 
-    upipe_h26xf_stream_fill_bits(s, 1);
-    bool subl_ordering = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    bool subl_ordering = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
     uint32_t max_dec_pic_buffering_1 = 0;
     for (int i = (subl_ordering ? 0 : max_subl_1); i <= max_subl_1; i++) {
         /* select the last one */
-        max_dec_pic_buffering_1 = upipe_h26xf_stream_ue(s);
-        upipe_h26xf_stream_ue(s); /* max_num_reorder_pics */
-        upipe_h26xf_stream_ue(s); /* max_latency_increase */
+        max_dec_pic_buffering_1 = upipe_h26xf_bits_ue(s);
+        upipe_h26xf_bits_ue(s); /* max_num_reorder_pics */
+        upipe_h26xf_bits_ue(s); /* max_latency_increase */
     }
 
-    upipe_h26xf_stream_ue(s); /* min_luma_coding_block_size */
-    upipe_h26xf_stream_ue(s); /* diff_max_min_luma_coding_block_size */
-    upipe_h26xf_stream_ue(s); /* min_transport_block_size */
-    upipe_h26xf_stream_ue(s); /* diff_max_min_transport_block_size */
-    upipe_h26xf_stream_ue(s); /* max_transform_hierarchy_depth_inter */
-    upipe_h26xf_stream_ue(s); /* max_transform_hierarchy_depth_intra */
+    upipe_h26xf_bits_ue(s); /* min_luma_coding_block_size */
+    upipe_h26xf_bits_ue(s); /* diff_max_min_luma_coding_block_size */
+    upipe_h26xf_bits_ue(s); /* min_transport_block_size */
+    upipe_h26xf_bits_ue(s); /* diff_max_min_transport_block_size */
+    upipe_h26xf_bits_ue(s); /* max_transform_hierarchy_depth_inter */
+    upipe_h26xf_bits_ue(s); /* max_transform_hierarchy_depth_intra */
 
-    upipe_h26xf_stream_fill_bits(s, 1);
-    bool scaling_list = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    bool scaling_list = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
     if (scaling_list) {
-        upipe_h26xf_stream_fill_bits(s, 1);
-        bool scaling_list_data = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool scaling_list_data = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
 
         if (scaling_list_data)
             upipe_h265f_stream_parse_scaling(s);
     }
 
-    upipe_h26xf_stream_fill_bits(s, 3);
-    ubuf_block_stream_skip_bits(s, 2);
-    bool pcm_enabled = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    upipe_h26xf_bits_skip(s, 2);
+    bool pcm_enabled = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
     if (pcm_enabled) {
-        upipe_h26xf_stream_fill_bits(s, 8);
-        ubuf_block_stream_skip_bits(s, 8);
-        upipe_h26xf_stream_ue(s);
-        upipe_h26xf_stream_ue(s);
-        upipe_h26xf_stream_fill_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        upipe_h26xf_bits_skip(s, 8);
+        upipe_h26xf_bits_ue(s);
+        upipe_h26xf_bits_ue(s);
+        upipe_h26xf_bits_skip(s, 1);
     }
 
-    uint32_t max_short_term_ref_pic_sets = upipe_h26xf_stream_ue(s);
+    uint32_t max_short_term_ref_pic_sets = upipe_h26xf_bits_ue(s);
     uint32_t num_delta_pocs[max_short_term_ref_pic_sets];
     memset(num_delta_pocs, 0, sizeof(num_delta_pocs));
     for (int i = 0; i < max_short_term_ref_pic_sets; i++) {
@@ -867,26 +829,23 @@ static bool upipe_h265f_activate_sps(struct upipe *upipe, uint32_t sps_id)
                 max_short_term_ref_pic_sets, max_dec_pic_buffering_1,
                 num_delta_pocs)) {
             upipe_err(upipe, "invalid SPS (short_term_ref_pic_sets)");
-            ubuf_block_stream_clean(s);
+            upipe_h26xf_bits_clean(s);
             return false; 
         }
     }
 
-    upipe_h26xf_stream_fill_bits(s, 1);
-    bool long_term_ref_pics = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    bool long_term_ref_pics = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
     if (long_term_ref_pics) {
-        uint32_t num_long_term_ref_pics = upipe_h26xf_stream_ue(s);
+        uint32_t num_long_term_ref_pics = upipe_h26xf_bits_ue(s);
         for (int i = 0; i < num_long_term_ref_pics; i++) {
-            upipe_h26xf_stream_fill_bits(s, log2_max_pic_order_cnt + 1);
-            ubuf_block_stream_skip_bits(s, log2_max_pic_order_cnt + 1);
+            upipe_h26xf_bits_skip(s, log2_max_pic_order_cnt + 1);
         }
     }
 
-    upipe_h26xf_stream_fill_bits(s, 3);
-    ubuf_block_stream_skip_bits(s, 2);
-    bool vui = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    upipe_h26xf_bits_skip(s, 2);
+    bool vui = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
 
     bool field_seq_flag = false;
     uint8_t video_format = 5;
@@ -900,13 +859,11 @@ static bool upipe_h265f_activate_sps(struct upipe *upipe, uint32_t sps_id)
     uint64_t cpb_size = upipe_h265f->cpb_size;
 
     if (vui) {
-        upipe_h26xf_stream_fill_bits(s, 1);
-        bool ar_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool ar_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (ar_present) {
-            upipe_h26xf_stream_fill_bits(s, 8);
-            uint8_t ar_idc = ubuf_block_stream_show_bits(s, 8);
-            ubuf_block_stream_skip_bits(s, 8);
+            uint8_t ar_idc = upipe_h26xf_bits_show(s, 8);
+            upipe_h26xf_bits_skip(s, 8);
             if (ar_idc > 0 &&
                 ar_idc < sizeof(upipe_h26xf_sar_from_idc) /
                          sizeof(struct urational)) {
@@ -914,103 +871,92 @@ static bool upipe_h265f_activate_sps(struct upipe *upipe, uint32_t sps_id)
                             upipe_h26xf_sar_from_idc[ar_idc]));
             } else if (ar_idc == H265VUI_AR_EXTENDED) {
                 struct urational sar;
-                upipe_h26xf_stream_fill_bits(s, 16);
-                sar.num = ubuf_block_stream_show_bits(s, 16);
-                ubuf_block_stream_skip_bits(s, 16);
-                upipe_h26xf_stream_fill_bits(s, 16);
-                sar.den = ubuf_block_stream_show_bits(s, 16);
-                ubuf_block_stream_skip_bits(s, 16);
+                sar.num = upipe_h26xf_bits_show(s, 16);
+                upipe_h26xf_bits_skip(s, 16);
+                sar.den = upipe_h26xf_bits_show(s, 16);
+                upipe_h26xf_bits_skip(s, 16);
                 urational_simplify(&sar);
                 UBASE_FATAL(upipe, uref_pic_flow_set_sar(flow_def, sar))
             } else
                 upipe_warn_va(upipe, "unknown aspect ratio idc %"PRIu8, ar_idc);
         }
 
-        upipe_h26xf_stream_fill_bits(s, 3);
-        bool overscan_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool overscan_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (overscan_present) {
             UBASE_FATAL(upipe, uref_pic_flow_set_overscan(flow_def,
-                        !!ubuf_block_stream_show_bits(s, 1)))
-            ubuf_block_stream_skip_bits(s, 1);
+                        !!upipe_h26xf_bits_show(s, 1)))
+            upipe_h26xf_bits_skip(s, 1);
         }
 
-        bool video_signal_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool video_signal_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (video_signal_present) {
-            upipe_h26xf_stream_fill_bits(s, 5);
-            video_format = ubuf_block_stream_show_bits(s, 3);
-            ubuf_block_stream_skip_bits(s, 3);
-            full_range = !!ubuf_block_stream_show_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
-            bool colour_present = !!ubuf_block_stream_show_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
+            video_format = upipe_h26xf_bits_show(s, 3);
+            upipe_h26xf_bits_skip(s, 3);
+            full_range = !!upipe_h26xf_bits_show(s, 1);
+            upipe_h26xf_bits_skip(s, 1);
+            bool colour_present = !!upipe_h26xf_bits_show(s, 1);
+            upipe_h26xf_bits_skip(s, 1);
             if (colour_present) {
-                upipe_h26xf_stream_fill_bits(s, 24);
-                colour_primaries = ubuf_block_stream_show_bits(s, 8);
-                ubuf_block_stream_skip_bits(s, 8);
-                transfer_characteristics = ubuf_block_stream_show_bits(s, 8);
-                ubuf_block_stream_skip_bits(s, 8);
-                matrix_coefficients = ubuf_block_stream_show_bits(s, 8);
-                ubuf_block_stream_skip_bits(s, 8);
+                colour_primaries = upipe_h26xf_bits_show(s, 8);
+                upipe_h26xf_bits_skip(s, 8);
+                transfer_characteristics = upipe_h26xf_bits_show(s, 8);
+                upipe_h26xf_bits_skip(s, 8);
+                matrix_coefficients = upipe_h26xf_bits_show(s, 8);
+                upipe_h26xf_bits_skip(s, 8);
             }
         }
 
-        upipe_h26xf_stream_fill_bits(s, 1);
-        bool chroma_loc_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool chroma_loc_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (chroma_loc_present) {
-            upipe_h26xf_stream_ue(s); /* top_field */
-            upipe_h26xf_stream_ue(s); /* bottom_field */
+            upipe_h26xf_bits_ue(s); /* top_field */
+            upipe_h26xf_bits_ue(s); /* bottom_field */
         }
 
-        upipe_h26xf_stream_fill_bits(s, 4);
-        ubuf_block_stream_skip_bits(s, 1);
-        field_seq_flag = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
-        upipe_h265f->frame_field_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
-        bool default_display_window = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
+        field_seq_flag = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
+        upipe_h265f->frame_field_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
+        bool default_display_window = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
 
         if (default_display_window) {
-            upipe_h26xf_stream_ue(s); /* left */
-            upipe_h26xf_stream_ue(s); /* right */
-            upipe_h26xf_stream_ue(s); /* top */
-            upipe_h26xf_stream_ue(s); /* bottom */
+            upipe_h26xf_bits_ue(s); /* left */
+            upipe_h26xf_bits_ue(s); /* right */
+            upipe_h26xf_bits_ue(s); /* top */
+            upipe_h26xf_bits_ue(s); /* bottom */
         }
 
-        upipe_h26xf_stream_fill_bits(s, 1);
-        bool timing_present = !!ubuf_block_stream_show_bits(s, 1);
-        ubuf_block_stream_skip_bits(s, 1);
+        bool timing_present = !!upipe_h26xf_bits_show(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
         if (timing_present) {
-            upipe_h26xf_stream_fill_bits(s, 24);
             uint32_t num_units_in_ticks =
-                ubuf_block_stream_show_bits(s, 24) << 8;
-            ubuf_block_stream_skip_bits(s, 24);
-            upipe_h26xf_stream_fill_bits(s, 24);
-            num_units_in_ticks |= ubuf_block_stream_show_bits(s, 8);
-            ubuf_block_stream_skip_bits(s, 8);
-            time_scale = ubuf_block_stream_show_bits(s, 16) << 16;
-            ubuf_block_stream_skip_bits(s, 16);
-
-            upipe_h26xf_stream_fill_bits(s, 17);
-            time_scale |= ubuf_block_stream_show_bits(s, 16);
-            ubuf_block_stream_skip_bits(s, 16);
-            bool poc_proportional_to_timing = ubuf_block_stream_show_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
+                upipe_h26xf_bits_show(s, 24) << 8;
+            upipe_h26xf_bits_skip(s, 24);
+            num_units_in_ticks |= upipe_h26xf_bits_show(s, 8);
+            upipe_h26xf_bits_skip(s, 8);
+            time_scale = upipe_h26xf_bits_show(s, 16) << 16;
+            upipe_h26xf_bits_skip(s, 16);
+
+            time_scale |= upipe_h26xf_bits_show(s, 16);
+            upipe_h26xf_bits_skip(s, 16);
+            bool poc_proportional_to_timing = upipe_h26xf_bits_show(s, 1);
+            upipe_h26xf_bits_skip(s, 1);
             if (poc_proportional_to_timing) {
-                uint32_t num_ticks_poc_diff = upipe_h26xf_stream_ue(s) + 1;
+                uint32_t num_ticks_poc_diff = upipe_h26xf_bits_ue(s) + 1;
                 frame_rate.num = time_scale;
                 frame_rate.den = num_units_in_ticks * num_ticks_poc_diff;
             }
 
-            bool hrd_present = ubuf_block_stream_show_bits(s, 1);
-            ubuf_block_stream_skip_bits(s, 1);
+            bool hrd_present = upipe_h26xf_bits_show(s, 1);
+            upipe_h26xf_bits_skip(s, 1);
             if (hrd_present) {
                 if (!ubase_check(upipe_h265f_stream_parse_hrd(upipe, s,
                                  &octet_rate, &cpb_size))) {
-                    ubuf_block_stream_clean(s);
+                    upipe_h26xf_bits_clean(s);
                     return false;
                 }
             }
@@ -1193,7 +1139,7 @@ static bool upipe_h265f_activate_sps(struct upipe *upipe, uint32_t sps_id)
     }
 
     upipe_h265f->active_sps = sps_id;
-    ubuf_block_stream_clean(s);
+    upipe_h26xf_bits_clean(s);
 
     upipe_h265f_store_flow_def(upipe, NULL);
     uref_free(upipe_h265f->flow_def_requested);
@@ -1220,35 +1166,33 @@ static bool upipe_h265f_activate_pps(struct upipe *upipe, uint32_t pps_id)
         return false;
     }
 
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    if (!ubase_check(ubuf_block_stream_init(s, upipe_h265f->pps[pps_id], 2))) {
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    if (!ubase_check(upipe_h26xf_bits_init(s, upipe_h265f->pps[pps_id], 2))) {
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return false;
     }
 
-    upipe_h26xf_stream_ue(s); /* pps_id */
-    uint32_t sps_id = upipe_h26xf_stream_ue(s);
+    upipe_h26xf_bits_ue(s); /* pps_id */
+    uint32_t sps_id = upipe_h26xf_bits_ue(s);
     if (unlikely(sps_id >= H265SPS_ID_MAX)) {
         upipe_warn_va(upipe, "invalid SPS %"PRIu32, sps_id);
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return false;
     }
 
     if (!upipe_h265f_activate_sps(upipe, sps_id)) {
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return false;
     }
 
-    upipe_h26xf_stream_fill_bits(s, 8);
-    ubuf_block_stream_skip_bits(s, 2);
+    upipe_h26xf_bits_skip(s, 2);
     upipe_h265f->num_extra_slice_header_bits =
-        ubuf_block_stream_show_bits(s, 3);
-    ubuf_block_stream_skip_bits(s, 3);
+        upipe_h26xf_bits_show(s, 3);
+    upipe_h26xf_bits_skip(s, 3);
 
     upipe_h265f->active_pps = pps_id;
-    ubuf_block_stream_clean(s);
+    upipe_h26xf_bits_clean(s);
     return true;
 }
 
@@ -1305,24 +1249,22 @@ static int upipe_h265f_handle_sps(struct upipe *upipe, struct ubuf *ubuf,
     if (unlikely(ubuf == NULL))
         return UBASE_ERR_ALLOC;
 
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    if (!ubase_check(ubuf_block_stream_init(s, ubuf, 2))) {
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    if (!ubase_check(upipe_h26xf_bits_init(s, ubuf, 2))) {
         ubuf_free(ubuf);
         return UBASE_ERR_INVALID;
     }
 
-    upipe_h26xf_stream_fill_bits(s, 8);
-    ubuf_block_stream_skip_bits(s, 4); /* vps_id */
-    uint8_t max_subl_1 = ubuf_block_stream_show_bits(s, 3);
-    ubuf_block_stream_skip_bits(s, 4); /* temporal_id_nesting_flag */
+    upipe_h26xf_bits_skip(s, 4); /* vps_id */
+    uint8_t max_subl_1 = upipe_h26xf_bits_show(s, 3);
+    upipe_h26xf_bits_skip(s, 4); /* temporal_id_nesting_flag */
 
     upipe_h265f_stream_parse_ptl(upipe, s, max_subl_1, NULL, NULL, NULL,
                                  NULL, NULL, NULL, NULL, NULL);
 
-    uint32_t sps_id = upipe_h26xf_stream_ue(s);
-    ubuf_block_stream_clean(s);
+    uint32_t sps_id = upipe_h26xf_bits_ue(s);
+    upipe_h26xf_bits_clean(s);
 
     if (unlikely(sps_id >= H265SPS_ID_MAX)) {
         upipe_warn_va(upipe, "invalid SPS %"PRIu32, sps_id);
@@ -1360,15 +1302,14 @@ static int upipe_h265f_handle_pps(struct upipe *upipe, struct ubuf *ubuf,
     if (unlikely(ubuf == NULL))
         return UBASE_ERR_ALLOC;
 
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    if (!ubase_check(ubuf_block_stream_init(s, ubuf, 2))) {
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    if (!ubase_check(upipe_h26xf_bits_init(s, ubuf, 2))) {
         ubuf_free(ubuf);
         return UBASE_ERR_INVALID;
     }
-    uint32_t pps_id = upipe_h26xf_stream_ue(s);
-    ubuf_block_stream_clean(s);
+    uint32_t pps_id = upipe_h26xf_bits_ue(s);
+    upipe_h26xf_bits_clean(s);
 
     if (unlikely(pps_id >= H265PPS_ID_MAX)) {
         upipe_warn_va(upipe, "invalid PPS %"PRIu32, pps_id);
@@ -1392,13 +1333,13 @@ static int upipe_h265f_handle_pps(struct upipe *upipe, struct ubuf *ubuf,
  * buffering period.
  *
  * @param upipe description structure of the pipe
- * @param s block stream parsing structure
+ * @param s h26x bit reader
  * @return an error code
  */
 static int upipe_h265f_handle_sei_buffering_period(struct upipe *upipe,
-                                                   struct ubuf_block_stream *s)
+                                                   struct upipe_h26xf_bits *s)
 {
-    uint32_t sps_id = upipe_h26xf_stream_ue(s);
+    uint32_t sps_id = upipe_h26xf_bits_ue(s);
     if (unlikely(sps_id >= H265SPS_ID_MAX)) {
         upipe_warn_va(upipe, "invalid SPS %"PRIu32" in SEI", sps_id);
         return UBASE_ERR_INVALID;
@@ -1413,11 +1354,11 @@ static int upipe_h265f_handle_sei_buffering_period(struct upipe *upipe,
  * picture timing.
  *
  * @param upipe description structure of the pipe
- * @param s block stream parsing structure
+ * @param s h26x bit reader
  * @return an error code
  */
 static int upipe_h265f_handle_sei_pic_timing(struct upipe *upipe,
-                                             struct ubuf_block_stream *s)
+                                             struct upipe_h26xf_bits *s)
 {
     struct upipe_h265f *upipe_h265f = upipe_h265f_from_upipe(upipe);
     if (unlikely(upipe_h265f->active_sps == -1)) {
@@ -1426,9 +1367,8 @@ static int upipe_h265f_handle_sei_pic_timing(struct upipe *upipe,
     }
 
     if (upipe_h265f->frame_field_present) {
-        upipe_h26xf_stream_fill_bits(s, 4);
-        upipe_h265f->pic_struct = ubuf_block_stream_show_bits(s, 4);
-        ubuf_block_stream_skip_bits(s, 4);
+        upipe_h265f->pic_struct = upipe_h26xf_bits_show(s, 4);
+        upipe_h26xf_bits_skip(s, 4);
     }
     return UBASE_ERR_NONE;
 }
@@ -1451,17 +1391,15 @@ static int upipe_h265f_handle_sei(struct upipe *upipe, struct ubuf *ubuf,
     if (type != H265SEI_BUFFERING_PERIOD && type != H265SEI_PIC_TIMING)
         return UBASE_ERR_NONE;
 
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    UBASE_RETURN(ubuf_block_stream_init(s, ubuf, offset + 3))
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    UBASE_RETURN(upipe_h26xf_bits_init(s, ubuf, offset + 3))
 
     /* size field */
     uint8_t octet;
     do {
-        upipe_h26xf_stream_fill_bits(s, 8);
-        octet = ubuf_block_stream_show_bits(s, 8);
-        ubuf_block_stream_skip_bits(s, 8);
+        octet = upipe_h26xf_bits_show(s, 8);
+        upipe_h26xf_bits_skip(s, 8);
     } while (octet == UINT8_MAX);
 
     int err = UBASE_ERR_NONE;
@@ -1476,7 +1414,7 @@ static int upipe_h265f_handle_sei(struct upipe *upipe, struct ubuf *ubuf,
             break;
     }
 
-    ubuf_block_stream_clean(s);
+    upipe_h26xf_bits_clean(s);
     return err;
 }
 
@@ -1495,45 +1433,42 @@ static int upipe_h265f_handle_slice(struct upipe *upipe, struct ubuf *ubuf,
                                     bool *au_slice_p)
 {
     struct upipe_h265f *upipe_h265f = upipe_h265f_from_upipe(upipe);
-    struct upipe_h26xf_stream f;
-    upipe_h26xf_stream_init(&f);
-    struct ubuf_block_stream *s = &f.s;
-    if (unlikely(!ubase_check(ubuf_block_stream_init(s, ubuf, offset + 2))))
+    struct upipe_h26xf_bits bits;
+    struct upipe_h26xf_bits *s = &bits;
+    if (unlikely(!ubase_check(upipe_h26xf_bits_init(s, ubuf, offset + 2))))
         return UBASE_ERR_INVALID;
 
-    upipe_h26xf_stream_fill_bits(s, 2);
-    bool first_slice_in_pic = !!ubuf_block_stream_show_bits(s, 1);
-    ubuf_block_stream_skip_bits(s, 1);
+    bool first_slice_in_pic = !!upipe_h26xf_bits_show(s, 1);
+    upipe_h26xf_bits_skip(s, 1);
     if (*au_slice_p && first_slice_in_pic) {
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return UBASE_ERR_BUSY;
     }
 
     uint8_t last_nal_type = h265nalst_get_type(nal);
     if (last_nal_type >= H265NAL_TYPE_BLA_W_LP &&
         last_nal_type <= H265NAL_TYPE_IRAP_VCL23)
-        ubuf_block_stream_skip_bits(s, 1);
+        upipe_h26xf_bits_skip(s, 1);
 
-    uint32_t pps_id = upipe_h26xf_stream_ue(s);
+    uint32_t pps_id = upipe_h26xf_bits_ue(s);
     if (unlikely(pps_id >= H265PPS_ID_MAX)) {
         upipe_warn_va(upipe, "invalid PPS %"PRIu32" in slice", pps_id);
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return UBASE_ERR_INVALID;
     }
     if (*au_slice_p && pps_id != upipe_h265f->active_pps) {
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return UBASE_ERR_BUSY;
     }
     if (unlikely(!upipe_h265f_activate_pps(upipe, pps_id))) {
-        ubuf_block_stream_clean(s);
+        upipe_h26xf_bits_clean(s);
         return UBASE_ERR_INVALID;
     }
 
     if (first_slice_in_pic) {
-        upipe_h26xf_stream_fill_bits(s, 8);
-        ubuf_block_stream_skip_bits(s,
+        upipe_h26xf_bits_skip(s,
                 upipe_h265f->num_extra_slice_header_bits);
-        upipe_h265f->slice_type = upipe_h26xf_stream_ue(s);
+        upipe_h265f->slice_type = upipe_h26xf_bits_ue(s);
     }
 
     *au_slice_p = true;
@@ -33,8 +33,16 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <inttypes.h>
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 /** @This translates the h26x aspect_ratio_idc to urational */
 const struct urational upipe_h26xf_sar_from_idc[17] = {
     { .num = 1, .den = 1 }, /* unspecified - treat as square */
@@ -136,6 +144,302 @@ int32_t upipe_h26xf_stream_se(struct ubuf_block_stream *s)
     return (v & 1) ? (v + 1) / 2 : -(v / 2);
 }
 
+/** @internal @This is the type of the vector routines looking for the
+ * first escape word.
+ *
+ * @param p pointer to the first candidate position, at least 2 octets after
+ * the start of the buffer
+ * @param end end of linear buffer
+ * @return pointer to the 03 octet of the found escape word, or to the first
+ * position that was not checked
+ */
+typedef const uint8_t *(*upipe_h26xf_unescape_find)(const uint8_t *p,
+                                                    const uint8_t *end);
+
+/** @This removes escape words from a linear buffer, using a vector routine
+ * to copy large portions without escape words.
+ *
+ * @param dst destination buffer, of at least size octets
+ * @param src source buffer
+ * @param size number of octets in the source buffer
+ * @param zeros_p positions of the 0s in the previous two octets, updated on
+ * execution
+ * @param find vector routine, or NULL
+ * @return number of octets written to the destination buffer
+ */
+static inline __attribute__((always_inline)) size_t
+    upipe_h26xf_unescape_tmpl(uint8_t *restrict dst,
+                              const uint8_t *restrict src, size_t size,
+                              uint8_t *restrict zeros_p,
+                              upipe_h26xf_unescape_find find)
+{
+    const uint8_t *p = src, *end = src + size;
+    uint8_t *d = dst;
+    uint8_t zeros = *zeros_p;
+
+    while (p < end) {
+        /* the first two octets depend on the previous buffer */
+        if (find != NULL && p >= src + 2) {
+            const uint8_t *q = find(p, end);
+            if (q > p) {
+                memcpy(d, p, q - p);
+                d += q - p;
+                p = q;
+                zeros = (!p[-2] << 1) | !p[-1];
+                if (p >= end)
+                    break;
+            }
+        }
+
+        uint8_t octet = *p++;
+        bool escape = octet == 3 && zeros == 3;
+        zeros = ((zeros << 1) | !octet) & 3;
+        if (likely(!escape))
+            *d++ = octet;
+    }
+
+    *zeros_p = zeros;
+    return d - dst;
+}
+
+/** @This removes escape words from a linear buffer, using C code.
+ *
+ * @param dst destination buffer, of at least size octets
+ * @param src source buffer
+ * @param size number of octets in the source buffer
+ * @param zeros_p positions of the 0s in the previous two octets, updated on
+ * execution
+ * @return number of octets written to the destination buffer
+ */
+size_t upipe_h26xf_unescape_c(uint8_t *restrict dst,
+                              const uint8_t *restrict src, size_t size,
+                              uint8_t *restrict zeros_p)
+{
+    return upipe_h26xf_unescape_tmpl(dst, src, size, zeros_p, NULL);
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+/** @internal @This looks for the first escape word, 16 octets at a time.
+ *
+ * @param p pointer to the first candidate position, at least 2 octets after
+ * the start of the buffer
+ * @param end end of linear buffer
+ * @return pointer to the 03 octet of the found escape word, or to the first
+ * position that was not checked
+ */
+__attribute__((target("sse2")))
+static const uint8_t *upipe_h26xf_unescape_find_sse2(const uint8_t *p,
+                                                     const uint8_t *end)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i three = _mm_set1_epi8(3);
+    while (end - p >= 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p - 2));
+        __m128i b = _mm_loadu_si128((const __m128i *)(p - 1));
+        __m128i c = _mm_loadu_si128((const __m128i *)p);
+        __m128i m = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(a, zero),
+                                                _mm_cmpeq_epi8(b, zero)),
+                                  _mm_cmpeq_epi8(c, three));
+        unsigned int mask = _mm_movemask_epi8(m);
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return p;
+}
+
+/** @This removes escape words from a linear buffer, using SSE2
+ * instructions.
+ *
+ * @param dst destination buffer, of at least size octets
+ * @param src source buffer
+ * @param size number of octets in the source buffer
+ * @param zeros_p positions of the 0s in the previous two octets, updated on
+ * execution
+ * @return number of octets written to the destination buffer
+ */
+__attribute__((target("sse2")))
+size_t upipe_h26xf_unescape_sse2(uint8_t *restrict dst,
+                                 const uint8_t *restrict src, size_t size,
+                                 uint8_t *restrict zeros_p)
+{
+    return upipe_h26xf_unescape_tmpl(dst, src, size, zeros_p,
+                                     upipe_h26xf_unescape_find_sse2);
+}
+#endif
+
+#if defined(__aarch64__)
+/** @internal @This looks for the first escape word, 16 octets at a time.
+ *
+ * @param p pointer to the first candidate position, at least 2 octets after
+ * the start of the buffer
+ * @param end end of linear buffer
+ * @return pointer to the 03 octet of the found escape word, or to the first
+ * position that was not checked
+ */
+static const uint8_t *upipe_h26xf_unescape_find_neon(const uint8_t *p,
+                                                     const uint8_t *end)
+{
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t three = vdupq_n_u8(3);
+    while (end - p >= 16) {
+        uint8x16_t m = vandq_u8(vandq_u8(vceqq_u8(vld1q_u8(p - 2), zero),
+                                         vceqq_u8(vld1q_u8(p - 1), zero)),
+                                vceqq_u8(vld1q_u8(p), three));
+        /* 4 bits per octet */
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+                    vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+        if (mask)
+            return p + __builtin_ctzll(mask) / 4;
+        p += 16;
+    }
+    return p;
+}
+
+/** @This removes escape words from a linear buffer, using NEON
+ * instructions.
+ *
+ * @param dst destination buffer, of at least size octets
+ * @param src source buffer
+ * @param size number of octets in the source buffer
+ * @param zeros_p positions of the 0s in the previous two octets, updated on
+ * execution
+ * @return number of octets written to the destination buffer
+ */
+size_t upipe_h26xf_unescape_neon(uint8_t *restrict dst,
+                                 const uint8_t *restrict src, size_t size,
+                                 uint8_t *restrict zeros_p)
+{
+    return upipe_h26xf_unescape_tmpl(dst, src, size, zeros_p,
+                                     upipe_h26xf_unescape_find_neon);
+}
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+/** @internal @This is the type of the unescape implementations. */
+typedef size_t (*upipe_h26xf_unescape_func)(uint8_t *restrict,
+                                            const uint8_t *restrict, size_t,
+                                            uint8_t *restrict);
+
+/** @internal @This is the implementation selected for the CPU, or NULL
+ * until the first call. */
+static upipe_h26xf_unescape_func upipe_h26xf_unescape_impl = NULL;
+#endif
+
+/** @This removes escape words from a linear buffer, using the fastest
+ * implementation supported by the CPU.
+ *
+ * @param dst destination buffer, of at least size octets
+ * @param src source buffer
+ * @param size number of octets in the source buffer
+ * @param zeros_p positions of the 0s in the previous two octets, updated on
+ * execution (0 at the start of a NAL unit)
+ * @return number of octets written to the destination buffer
+ */
+size_t upipe_h26xf_unescape(uint8_t *restrict dst, const uint8_t *restrict src,
+                            size_t size, uint8_t *restrict zeros_p)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    upipe_h26xf_unescape_func unescape =
+        __atomic_load_n(&upipe_h26xf_unescape_impl, __ATOMIC_RELAXED);
+    if (unlikely(unescape == NULL)) {
+        /* concurrent first calls all store the same value */
+        if (__builtin_cpu_supports("sse2"))
+            unescape = upipe_h26xf_unescape_sse2;
+        else
+            unescape = upipe_h26xf_unescape_c;
+        __atomic_store_n(&upipe_h26xf_unescape_impl, unescape,
+                         __ATOMIC_RELAXED);
+    }
+    return unescape(dst, src, size, zeros_p);
+#elif defined(__aarch64__)
+    return upipe_h26xf_unescape_neon(dst, src, size, zeros_p);
+#else
+    return upipe_h26xf_unescape_c(dst, src, size, zeros_p);
+#endif
+}
+
+/** @This initializes a bit reader on a NAL unit.
+ *
+ * @param b bit reader
+ * @param ubuf block ubuf containing the NAL unit
+ * @param offset offset of the first octet to read in the ubuf
+ * @return an error code
+ */
+int upipe_h26xf_bits_init(struct upipe_h26xf_bits *b, struct ubuf *ubuf,
+                          int offset)
+{
+    UBASE_RETURN(ubuf_block_stream_init(&b->s, ubuf, offset))
+    b->zeros = 0;
+    b->ptr = b->end = b->scratch;
+    b->cache = 0;
+    b->left = 0;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This unescapes the next chunk of the NAL unit to the scratch
+ * buffer.
+ *
+ * @param b bit reader
+ * @return false at the end of the NAL unit
+ */
+static bool upipe_h26xf_bits_unescape(struct upipe_h26xf_bits *b)
+{
+    struct ubuf_block_stream *s = &b->s;
+    uint8_t *d = b->scratch;
+    uint8_t *d_end = b->scratch + UPIPE_H26XF_BITS_CHUNK;
+
+    while (d < d_end) {
+        if (unlikely(s->buffer >= s->end)) {
+            /* next segment of the ubuf */
+            uint8_t octet;
+            if (!ubase_check(ubuf_block_stream_get(s, &octet)))
+                break;
+            d += upipe_h26xf_unescape(d, &octet, 1, &b->zeros);
+            continue;
+        }
+        size_t size = s->end - s->buffer;
+        if (size > d_end - d)
+            size = d_end - d;
+        d += upipe_h26xf_unescape(d, s->buffer, size, &b->zeros);
+        s->buffer += size;
+    }
+
+    memset(d, 0, 8);
+    b->ptr = b->scratch;
+    b->end = d;
+    return d > b->scratch;
+}
+
+/** @internal @This fills the bits cache with at least 57 bits.
+ *
+ * @param b bit reader
+ */
+void upipe_h26xf_bits_refill(struct upipe_h26xf_bits *b)
+{
+    while (b->left <= 56) {
+        if (likely(b->end - b->ptr >= 8)) {
+            const uint8_t *p = b->ptr;
+            uint64_t v = ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) |
+                         ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+                         ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+                         ((uint64_t)p[6] << 8) | p[7];
+            unsigned int n = (64 - b->left) / 8;
+            b->cache |= v >> b->left;
+            b->ptr += n;
+            b->left += n * 8;
+            return;
+        }
+        if (b->ptr >= b->end && !upipe_h26xf_bits_unescape(b)) {
+            /* past the end of the NAL unit */
+            b->left = 64;
+            return;
+        }
+        b->cache |= (uint64_t)*b->ptr++ << (56 - b->left);
+        b->left += 8;
+    }
+}
+
 /** @This allocates a ubuf containing an annex B header.
  *
  * @param ubuf_mgr pointer to ubuf manager
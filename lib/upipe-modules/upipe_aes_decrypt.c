@@ -35,8 +35,34 @@
 #include <upipe/uref_block.h>
 #include <upipe/urefcount.h>
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__linux__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#endif
+
 #define EXPECTED_FLOW_DEF       "block.aes."
 
+struct upipe_aes_decrypt;
+
+/** @internal @This is the type of the functions decrypting consecutive AES
+ * blocks in CBC mode.
+ *
+ * @param upipe_aes_decrypt private context holding the keys and the
+ * initialization vector, which is updated
+ * @param in blocks to decrypt
+ * @param out decrypted blocks (may be equal to in)
+ * @param nb_blocks number of 16 octets blocks
+ */
+typedef void (*upipe_aes_decrypt_cbc)(
+        struct upipe_aes_decrypt *upipe_aes_decrypt,
+        const uint8_t *in, uint8_t *out, size_t nb_blocks);
+
 /** @internal @This is the private context of an aes pipe. */
 struct upipe_aes_decrypt {
     /** pipe public structure */
@@ -78,8 +104,12 @@ struct upipe_aes_decrypt {
     bool restart;
     /** store round keys */
     uint8_t round_keys[11][4][4];
+    /** store round keys of the equivalent inverse cipher */
+    uint8_t dec_keys[11][16];
     /** store initialization vector */
     uint8_t iv[16];
+    /** CBC decryption function */
+    upipe_aes_decrypt_cbc cbc_decrypt;
 };
 
 static int upipe_aes_decrypt_check(struct upipe *upipe, struct uref *uref);
@@ -369,20 +399,165 @@ static inline void aes_xor_iv(uint8_t state[4][4],
             state[i][j] ^= iv[i * 4 + j];
 }
 
-/** @internal @This decrypts an AES block.
+/** @internal @This generates the round keys of the equivalent inverse
+ * cipher, as used by the hardware instructions.
  *
- * @param buffer the block to decrypt inplace
  * @param round_keys the generated round keys
- * @param iv the initialization vector
+ * @param dec_keys filled in with the round keys in decryption order
+ */
+static void aes_dec_key_expansion(uint8_t round_keys[11][4][4],
+                                  uint8_t dec_keys[11][16])
+{
+    memcpy(dec_keys[0], round_keys[10], sizeof (dec_keys[0]));
+    for (unsigned i = 1; i < 10; i++) {
+        uint8_t tmp[4][4];
+        memcpy(tmp, round_keys[10 - i], sizeof (tmp));
+        aes_inv_mix_columns(tmp);
+        memcpy(dec_keys[i], tmp, sizeof (dec_keys[i]));
+    }
+    memcpy(dec_keys[10], round_keys[0], sizeof (dec_keys[10]));
+}
+
+/** @internal @This decrypts consecutive AES blocks in CBC mode, one at a
+ * time.
+ *
+ * @param upipe_aes_decrypt private context
+ * @param in blocks to decrypt
+ * @param out decrypted blocks (may be equal to in)
+ * @param nb_blocks number of blocks
  */
-static inline void aes_cbc_decrypt(uint8_t buffer[16],
-                                   uint8_t round_keys[11][4][4],
-                                   const uint8_t iv[16])
+static void aes_cbc_decrypt_c(struct upipe_aes_decrypt *upipe_aes_decrypt,
+                              const uint8_t *in, uint8_t *out,
+                              size_t nb_blocks)
 {
-    aes_inv_cipher((uint8_t (*)[])buffer, round_keys);
-    aes_xor_iv((uint8_t (*)[])buffer, iv);
+    for (; nb_blocks; nb_blocks--, in += 16, out += 16) {
+        uint8_t state[4][4];
+        memcpy(state, in, sizeof (state));
+        aes_inv_cipher(state, upipe_aes_decrypt->round_keys);
+        aes_xor_iv(state, upipe_aes_decrypt->iv);
+        memcpy(upipe_aes_decrypt->iv, in, sizeof (upipe_aes_decrypt->iv));
+        memcpy(out, state, sizeof (state));
+    }
 }
 
+#if defined(__i386__) || defined(__x86_64__)
+/** number of blocks decrypted in parallel by the AES-NI routine */
+#define AES_NI_LANES 8
+
+/** @internal @This decrypts consecutive AES blocks in CBC mode, using
+ * AES-NI instructions. As CBC decryption does not depend on the previous
+ * plaintext, several blocks go through the pipeline of the AES unit at
+ * the same time.
+ *
+ * @param upipe_aes_decrypt private context
+ * @param in blocks to decrypt
+ * @param out decrypted blocks (may be equal to in)
+ * @param nb_blocks number of blocks
+ */
+__attribute__((target("sse2,aes")))
+static void aes_cbc_decrypt_aesni(struct upipe_aes_decrypt *upipe_aes_decrypt,
+                                  const uint8_t *in, uint8_t *out,
+                                  size_t nb_blocks)
+{
+    __m128i keys[11];
+    for (unsigned i = 0; i < 11; i++)
+        keys[i] = _mm_loadu_si128(
+                (const __m128i *)upipe_aes_decrypt->dec_keys[i]);
+    __m128i iv = _mm_loadu_si128((const __m128i *)upipe_aes_decrypt->iv);
+
+    while (nb_blocks >= AES_NI_LANES) {
+        __m128i c[AES_NI_LANES], b[AES_NI_LANES];
+        for (unsigned j = 0; j < AES_NI_LANES; j++) {
+            c[j] = _mm_loadu_si128((const __m128i *)in + j);
+            b[j] = _mm_xor_si128(c[j], keys[0]);
+        }
+        for (unsigned i = 1; i < 10; i++)
+            for (unsigned j = 0; j < AES_NI_LANES; j++)
+                b[j] = _mm_aesdec_si128(b[j], keys[i]);
+        for (unsigned j = 0; j < AES_NI_LANES; j++)
+            b[j] = _mm_aesdeclast_si128(b[j], keys[10]);
+
+        _mm_storeu_si128((__m128i *)out, _mm_xor_si128(b[0], iv));
+        for (unsigned j = 1; j < AES_NI_LANES; j++)
+            _mm_storeu_si128((__m128i *)out + j,
+                             _mm_xor_si128(b[j], c[j - 1]));
+        iv = c[AES_NI_LANES - 1];
+        in += AES_NI_LANES * 16;
+        out += AES_NI_LANES * 16;
+        nb_blocks -= AES_NI_LANES;
+    }
+
+    for (; nb_blocks; nb_blocks--, in += 16, out += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)in);
+        __m128i b = _mm_xor_si128(c, keys[0]);
+        for (unsigned i = 1; i < 10; i++)
+            b = _mm_aesdec_si128(b, keys[i]);
+        b = _mm_aesdeclast_si128(b, keys[10]);
+        _mm_storeu_si128((__m128i *)out, _mm_xor_si128(b, iv));
+        iv = c;
+    }
+
+    _mm_storeu_si128((__m128i *)upipe_aes_decrypt->iv, iv);
+}
+#endif
+
+#if defined(__aarch64__) && defined(__linux__)
+/** number of blocks decrypted in parallel by the ARMv8 routine */
+#define AES_ARMV8_LANES 4
+
+/** @internal @This decrypts consecutive AES blocks in CBC mode, using
+ * the ARMv8 Cryptography Extensions.
+ *
+ * @param upipe_aes_decrypt private context
+ * @param in blocks to decrypt
+ * @param out decrypted blocks (may be equal to in)
+ * @param nb_blocks number of blocks
+ */
+__attribute__((target("+crypto")))
+static void aes_cbc_decrypt_armv8(struct upipe_aes_decrypt *upipe_aes_decrypt,
+                                  const uint8_t *in, uint8_t *out,
+                                  size_t nb_blocks)
+{
+    uint8x16_t keys[11];
+    for (unsigned i = 0; i < 11; i++)
+        keys[i] = vld1q_u8(upipe_aes_decrypt->dec_keys[i]);
+    uint8x16_t iv = vld1q_u8(upipe_aes_decrypt->iv);
+
+    /* AESD adds the round key before the inverse rounds, so the keys are
+     * shifted by one compared to AES-NI, and the last one is a plain xor. */
+    while (nb_blocks >= AES_ARMV8_LANES) {
+        uint8x16_t c[AES_ARMV8_LANES], b[AES_ARMV8_LANES];
+        for (unsigned j = 0; j < AES_ARMV8_LANES; j++)
+            b[j] = c[j] = vld1q_u8(in + j * 16);
+        for (unsigned i = 0; i < 9; i++)
+            for (unsigned j = 0; j < AES_ARMV8_LANES; j++)
+                b[j] = vaesimcq_u8(vaesdq_u8(b[j], keys[i]));
+        for (unsigned j = 0; j < AES_ARMV8_LANES; j++)
+            b[j] = veorq_u8(vaesdq_u8(b[j], keys[9]), keys[10]);
+
+        vst1q_u8(out, veorq_u8(b[0], iv));
+        for (unsigned j = 1; j < AES_ARMV8_LANES; j++)
+            vst1q_u8(out + j * 16, veorq_u8(b[j], c[j - 1]));
+        iv = c[AES_ARMV8_LANES - 1];
+        in += AES_ARMV8_LANES * 16;
+        out += AES_ARMV8_LANES * 16;
+        nb_blocks -= AES_ARMV8_LANES;
+    }
+
+    for (; nb_blocks; nb_blocks--, in += 16, out += 16) {
+        uint8x16_t c = vld1q_u8(in);
+        uint8x16_t b = c;
+        for (unsigned i = 0; i < 9; i++)
+            b = vaesimcq_u8(vaesdq_u8(b, keys[i]));
+        b = veorq_u8(vaesdq_u8(b, keys[9]), keys[10]);
+        vst1q_u8(out, veorq_u8(b, iv));
+        iv = c;
+    }
+
+    vst1q_u8(upipe_aes_decrypt->iv, iv);
+}
+#endif
+
 /** @internal @This allocates an aes decryption pipe.
  *
  * @param mgr reference to the aes decryption pipe manager.
@@ -412,6 +587,15 @@ static struct upipe *upipe_aes_decrypt_alloc(struct upipe_mgr *mgr,
     upipe_aes_decrypt->input_flow_def = NULL;
     upipe_aes_decrypt->restart = true;
 
+    upipe_aes_decrypt->cbc_decrypt = aes_cbc_decrypt_c;
+#if defined(__i386__) || defined(__x86_64__)
+    if (__builtin_cpu_supports("aes"))
+        upipe_aes_decrypt->cbc_decrypt = aes_cbc_decrypt_aesni;
+#elif defined(__aarch64__) && defined(__linux__)
+    if (getauxval(AT_HWCAP) & HWCAP_AES)
+        upipe_aes_decrypt->cbc_decrypt = aes_cbc_decrypt_armv8;
+#endif
+
     upipe_throw_ready(upipe);
 
     return upipe;
@@ -456,7 +640,7 @@ static int upipe_aes_decrypt_restart(struct upipe *upipe)
     }
     if (unlikely(key_size != 16)) {
         upipe_warn(upipe, "invalid aes key");
-        return ret;
+        return UBASE_ERR_INVALID;
     }
 
     const uint8_t *iv;
@@ -468,10 +652,77 @@ static int upipe_aes_decrypt_restart(struct upipe *upipe)
     }
     if (unlikely(iv_size != 16)) {
         upipe_warn(upipe, "invalid aes initialization vector");
-        return ret;
+        return UBASE_ERR_INVALID;
     }
 
     aes_key_expansion(key, upipe_aes_decrypt->round_keys);
+    aes_dec_key_expansion(upipe_aes_decrypt->round_keys,
+                          upipe_aes_decrypt->dec_keys);
+    memcpy(upipe_aes_decrypt->iv, iv, sizeof (upipe_aes_decrypt->iv));
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This decrypts the blocks of a uref into a new ubuf. The
+ * input segments are processed in place, only the blocks spanning two
+ * segments are gathered first.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref carrying the encrypted blocks
+ * @param size size of the uref, multiple of 16
+ * @return an error code
+ */
+static int upipe_aes_decrypt_uref(struct upipe *upipe, struct uref *uref,
+                                  size_t size)
+{
+    struct upipe_aes_decrypt *upipe_aes_decrypt =
+        upipe_aes_decrypt_from_upipe(upipe);
+
+    struct ubuf *ubuf = ubuf_block_alloc(upipe_aes_decrypt->ubuf_mgr, size);
+    UBASE_ALLOC_RETURN(ubuf);
+
+    int wsize = -1;
+    uint8_t *wbuf;
+    int ret = ubuf_block_write(ubuf, 0, &wsize, &wbuf);
+    if (unlikely(!ubase_check(ret) || wsize != size)) {
+        if (ubase_check(ret))
+            ubuf_block_unmap(ubuf, 0);
+        ubuf_free(ubuf);
+        return UBASE_ERR_INVALID;
+    }
+
+    size_t offset = 0;
+    while (offset < size) {
+        int rsize = size - offset;
+        const uint8_t *rbuf;
+        ret = uref_block_read(uref, offset, &rsize, &rbuf);
+        if (unlikely(!ubase_check(ret)))
+            break;
+
+        size_t nb_blocks = rsize / 16;
+        if (nb_blocks) {
+            upipe_aes_decrypt->cbc_decrypt(upipe_aes_decrypt, rbuf,
+                                           wbuf + offset, nb_blocks);
+            uref_block_unmap(uref, offset);
+            offset += nb_blocks * 16;
+            continue;
+        }
+        uref_block_unmap(uref, offset);
+
+        uint8_t block[16];
+        ret = uref_block_extract(uref, offset, sizeof (block), block);
+        if (unlikely(!ubase_check(ret)))
+            break;
+        upipe_aes_decrypt->cbc_decrypt(upipe_aes_decrypt, block,
+                                       wbuf + offset, 1);
+        offset += sizeof (block);
+    }
+
+    ubuf_block_unmap(ubuf, 0);
+    if (unlikely(!ubase_check(ret))) {
+        ubuf_free(ubuf);
+        return ret;
+    }
+    uref_attach_ubuf(uref, ubuf);
     return UBASE_ERR_NONE;
 }
 
@@ -496,46 +747,27 @@ static void upipe_aes_decrypt_worker(struct upipe *upipe,
 
     size_t block_size;
     ubase_assert(uref_block_size(upipe_aes_decrypt->next_uref, &block_size));
-    for (size_t size = block_size; size >= 16; size -= 16) {
-        int ret;
-
-        struct uref *uref = upipe_aes_decrypt_extract_uref_stream(upipe, 16);
+    block_size -= block_size % 16;
+    while (block_size) {
+        /* output one uref per input uref, so that attributes are kept */
+        size_t size = upipe_aes_decrypt->next_uref_size;
+        size += (16 - size % 16) % 16;
+        if (size > block_size)
+            size = block_size;
+
+        struct uref *uref = upipe_aes_decrypt_extract_uref_stream(upipe, size);
         if (unlikely(!uref)) {
-            upipe_throw_fatal(upipe, UBASE_ERR_INVALID);
-            return;
-        }
-
-        uint8_t iv[16];
-        ret = uref_block_extract(uref, 0, 16, iv);
-        if (unlikely(!ubase_check(ret))) {
-            uref_free(uref);
-            upipe_throw_fatal(upipe, UBASE_ERR_INVALID);
-            return;
-        }
-
-        struct ubuf *ubuf =
-            ubuf_block_alloc(upipe_aes_decrypt->ubuf_mgr, 16);
-        if (unlikely(!ubuf)) {
-            uref_free(uref);
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             return;
         }
-        uref_attach_ubuf(uref, ubuf);
 
-        int wsize = 16;
-        uint8_t *wbuf;
-        ret = uref_block_write(uref, 0, &wsize, &wbuf);
-        if (unlikely(!ubase_check(ret)) || wsize != 16) {
+        int ret = upipe_aes_decrypt_uref(upipe, uref, size);
+        if (unlikely(!ubase_check(ret))) {
             uref_free(uref);
-            upipe_throw_fatal(upipe, UBASE_ERR_INVALID);
+            upipe_throw_fatal(upipe, ret);
             return;
         }
-        memcpy(wbuf, iv, wsize);
-        aes_cbc_decrypt(wbuf,
-                        upipe_aes_decrypt->round_keys,
-                        upipe_aes_decrypt->iv);
-        ubase_assert(uref_block_unmap(uref, 0));
-        memcpy(upipe_aes_decrypt->iv, iv, sizeof (upipe_aes_decrypt->iv));
+        block_size -= size;
         upipe_aes_decrypt_output(upipe, uref, upump_p);
     }
 }
@@ -252,7 +252,8 @@ static void upipe_dup_input(struct upipe *upipe, struct uref *uref,
                                     uref, upump_p);
             uref = NULL;
         } else {
-            struct uref *new_uref = uref_dup(uref);
+            /* the attributes are only copied if an output changes them */
+            struct uref *new_uref = uref_dup_shared(uref);
             if (unlikely(new_uref == NULL)) {
                 uref_free(uref);
                 upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
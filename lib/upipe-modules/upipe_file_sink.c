@@ -29,6 +29,8 @@
  * @short Upipe sink module for files
  */
 
+#define _GNU_SOURCE
+
 #include <upipe/ubase.h>
 #include <upipe/ulist.h>
 #include <upipe/uprobe.h>
@@ -97,6 +99,12 @@ struct upipe_fsink {
     char *path;
     /** sync period */
     uint64_t sync_period;
+    /** size of preallocated chunks, or 0 */
+    uint64_t prealloc;
+    /** current write position */
+    uint64_t pos;
+    /** end of the preallocated space, or UINT64_MAX if not preallocated */
+    uint64_t prealloc_end;
 
     /** temporary uref storage */
     struct uchain urefs;
@@ -147,6 +155,9 @@ static struct upipe *upipe_fsink_alloc(struct upipe_mgr *mgr,
     upipe_fsink->fd = -1;
     upipe_fsink->path = NULL;
     upipe_fsink->sync_period = 0;
+    upipe_fsink->prealloc = 0;
+    upipe_fsink->pos = 0;
+    upipe_fsink->prealloc_end = 0;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -174,6 +185,51 @@ static void upipe_fsink_poll(struct upipe *upipe)
     }
 }
 
+/** @internal @This reserves disk space beyond the current position if the
+ * next write would go past the preallocated space. The size of the file is
+ * not changed.
+ *
+ * @param upipe description structure of the pipe
+ * @param size size of the next write
+ */
+static void upipe_fsink_prealloc(struct upipe *upipe, size_t size)
+{
+    struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+    if (likely(!upipe_fsink->prealloc ||
+               upipe_fsink->pos + size <= upipe_fsink->prealloc_end))
+        return;
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    uint64_t end = upipe_fsink->pos + size + upipe_fsink->prealloc - 1;
+    end -= end % upipe_fsink->prealloc;
+    if (unlikely(fallocate(upipe_fsink->fd, FALLOC_FL_KEEP_SIZE,
+                           upipe_fsink->prealloc_end,
+                           end - upipe_fsink->prealloc_end) == -1)) {
+        upipe_warn_va(upipe, "can't preallocate %s (%m)", upipe_fsink->path);
+        upipe_fsink->prealloc_end = UINT64_MAX;
+        return;
+    }
+    upipe_fsink->prealloc_end = end;
+#endif
+}
+
+/** @internal @This releases the preallocated space beyond the end of the
+ * file, and closes it.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_fsink_close(struct upipe *upipe)
+{
+    struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+    if (likely(upipe_fsink->path != NULL))
+        upipe_notice_va(upipe, "closing file %s", upipe_fsink->path);
+    if (upipe_fsink->prealloc_end != UINT64_MAX &&
+        upipe_fsink->prealloc_end > upipe_fsink->pos &&
+        unlikely(ftruncate(upipe_fsink->fd, upipe_fsink->pos) == -1))
+        upipe_warn_va(upipe, "can't release preallocated space (%m)");
+    ubase_clean_fd(&upipe_fsink->fd);
+}
+
 /** @internal @This outputs data to the file sink.
  *
  * @param upipe description structure of the pipe
@@ -238,6 +294,13 @@ write_buffer:
             break;
         }
 
+        if (upipe_fsink->prealloc) {
+            size_t size = 0;
+            for (int i = 0; i < iovec_count; i++)
+                size += iovecs[i].iov_len;
+            upipe_fsink_prealloc(upipe, size);
+        }
+
         ssize_t ret = writev(upipe_fsink->fd, iovecs, iovec_count);
         uref_block_iovec_unmap(uref, 0, -1, iovecs);
 
@@ -268,6 +331,7 @@ write_buffer:
             return true;
         }
 
+        upipe_fsink->pos += ret;
         size_t uref_size;
         if (ubase_check(uref_block_size(uref, &uref_size)) &&
             uref_size == ret) {
@@ -394,11 +458,8 @@ static int _upipe_fsink_set_path(struct upipe *upipe, const char *path,
 {
     struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
 
-    if (unlikely(upipe_fsink->fd != -1)) {
-        if (likely(upipe_fsink->path != NULL))
-            upipe_notice_va(upipe, "closing file %s", upipe_fsink->path);
-        ubase_clean_fd(&upipe_fsink->fd);
-    }
+    if (unlikely(upipe_fsink->fd != -1))
+        upipe_fsink_close(upipe);
     ubase_clean_str(&upipe_fsink->path);
     upipe_fsink_set_upump(upipe, NULL);
     upipe_fsink_set_upump_sync(upipe, NULL);
@@ -439,18 +500,23 @@ static int _upipe_fsink_set_path(struct upipe *upipe, const char *path,
         upipe_err_va(upipe, "can't open file %s (%s)", path, mode_desc);
         return UBASE_ERR_EXTERNAL;
     }
+    upipe_fsink->pos = 0;
     switch (mode) {
         /* O_APPEND seeks on each write, so use this instead */
-        case UPIPE_FSINK_APPEND:
-            if (unlikely(lseek(upipe_fsink->fd, 0, SEEK_END) == -1)) {
+        case UPIPE_FSINK_APPEND: {
+            off_t pos = lseek(upipe_fsink->fd, 0, SEEK_END);
+            if (unlikely(pos == -1)) {
                 upipe_err_va(upipe, "can't append to file %s (%s)", path, mode_desc);
                 ubase_clean_fd(&upipe_fsink->fd);
                 return UBASE_ERR_EXTERNAL;
             }
+            upipe_fsink->pos = pos;
             break;
+        }
         default:
             break;
     }
+    upipe_fsink->prealloc_end = upipe_fsink->pos;
 
     upipe_fsink->path = strdup(path);
     if (unlikely(upipe_fsink->path == NULL)) {
@@ -478,11 +544,8 @@ static int _upipe_fsink_set_fd(struct upipe *upipe, int fd,
 {
     struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
 
-    if (unlikely(upipe_fsink->fd != -1)) {
-        if (likely(upipe_fsink->path != NULL))
-            upipe_notice_va(upipe, "closing file %s", upipe_fsink->path);
-        ubase_clean_fd(&upipe_fsink->fd);
-    }
+    if (unlikely(upipe_fsink->fd != -1))
+        upipe_fsink_close(upipe);
     ubase_clean_str(&upipe_fsink->path);
     upipe_fsink_set_upump(upipe, NULL);
     upipe_fsink_set_upump_sync(upipe, NULL);
@@ -525,6 +588,10 @@ static int _upipe_fsink_set_fd(struct upipe *upipe, int fd,
         default:
             break;
     }
+    /* descriptors of the caller are neither preallocated nor truncated */
+    off_t pos = lseek(upipe_fsink->fd, 0, SEEK_CUR);
+    upipe_fsink->pos = pos == -1 ? 0 : pos;
+    upipe_fsink->prealloc_end = UINT64_MAX;
 
     if (!upipe_fsink_check_input(upipe))
         /* Use again the pipe that we previously released. */
@@ -575,6 +642,36 @@ static int _upipe_fsink_get_sync_period(struct upipe *upipe, uint64_t *p)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the size of preallocated chunks.
+ *
+ * @param upipe description structure of the pipe
+ * @param prealloc size of chunks, or 0 to disable preallocation
+ * @return an error code
+ */
+static int _upipe_fsink_set_prealloc(struct upipe *upipe, uint64_t prealloc)
+{
+    struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+#ifndef FALLOC_FL_KEEP_SIZE
+    if (prealloc)
+        return UBASE_ERR_UNHANDLED;
+#endif
+    upipe_fsink->prealloc = prealloc;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This returns the size of preallocated chunks.
+ *
+ * @param upipe description structure of the pipe
+ * @param p filled in with the size of chunks
+ * @return an error code
+ */
+static int _upipe_fsink_get_prealloc(struct upipe *upipe, uint64_t *p)
+{
+    struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+    *p = upipe_fsink->prealloc;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a file sink pipe.
  *
  * @param upipe description structure of the pipe
@@ -648,6 +745,16 @@ static int  _upipe_fsink_control(struct upipe *upipe, int command, va_list args)
             uint64_t *p = va_arg(args, uint64_t *);
             return _upipe_fsink_get_sync_period(upipe, p);
         }
+        case UPIPE_FSINK_SET_PREALLOC: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSINK_SIGNATURE)
+            uint64_t prealloc = va_arg(args, uint64_t);
+            return _upipe_fsink_set_prealloc(upipe, prealloc);
+        }
+        case UPIPE_FSINK_GET_PREALLOC: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSINK_SIGNATURE)
+            uint64_t *p = va_arg(args, uint64_t *);
+            return _upipe_fsink_get_prealloc(upipe, p);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -697,11 +804,8 @@ static int upipe_fsink_control(struct upipe *upipe, int command, va_list args)
 static void upipe_fsink_free(struct upipe *upipe)
 {
     struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
-    if (likely(upipe_fsink->fd != -1)) {
-        if (likely(upipe_fsink->path != NULL))
-            upipe_notice_va(upipe, "closing file %s", upipe_fsink->path);
-        close(upipe_fsink->fd);
-    }
+    if (likely(upipe_fsink->fd != -1))
+        upipe_fsink_close(upipe);
     upipe_throw_dead(upipe);
 
     free(upipe_fsink->path);
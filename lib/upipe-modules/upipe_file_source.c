@@ -39,6 +39,9 @@
 #include <upipe/uref_clock.h>
 #include <upipe/upump.h>
 #include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/umem.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
@@ -62,6 +65,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <limits.h>
 #include <errno.h>
 #include <assert.h>
 
@@ -123,6 +128,15 @@ struct upipe_fsrc {
     /** length to read */
     uint64_t length;
 
+    /** size of mapped windows, or 0 to use read() */
+    uint64_t mmap_size;
+    /** block pointing to the current mapped window, or NULL */
+    struct ubuf *mmap_ubuf;
+    /** offset of the current mapped window in the file */
+    uint64_t mmap_offset;
+    /** reading position in the file while a window is mapped */
+    uint64_t mmap_position;
+
     /** public upipe structure */
     struct upipe upipe;
     /** guard for upump */
@@ -177,6 +191,10 @@ static struct upipe *upipe_fsrc_alloc(struct upipe_mgr *mgr,
     upipe_fsrc->uri = NULL;
     upipe_fsrc->fd = -1;
     upipe_fsrc->length = (uint64_t)-1;
+    upipe_fsrc->mmap_size = 0;
+    upipe_fsrc->mmap_ubuf = NULL;
+    upipe_fsrc->mmap_offset = 0;
+    upipe_fsrc->mmap_position = 0;
     upipe_fsrc->safe = false;
     upipe_throw_ready(upipe);
     return upipe;
@@ -205,6 +223,168 @@ static int upipe_fsrc_get_uri(struct upipe *upipe, const char **path_p)
     return uref_uri_get_path(upipe_fsrc->uri, path_p);
 }
 
+/** @internal @This refuses to allocate memory, as mapped windows are only
+ * wrapped.
+ *
+ * @param mgr pointer to umem manager
+ * @param umem caller-allocated structure
+ * @param size requested size of the umem
+ * @return false
+ */
+static bool upipe_fsrc_umem_alloc(struct umem_mgr *mgr, struct umem *umem,
+                                  size_t size)
+{
+    return false;
+}
+
+/** @internal @This refuses to resize a mapped window.
+ *
+ * @param umem pointer to umem
+ * @param new_size new requested size of the umem
+ * @return false
+ */
+static bool upipe_fsrc_umem_realloc(struct umem *umem, size_t new_size)
+{
+    return false;
+}
+
+/** @internal @This unmaps a window of the file, once the last block pointing
+ * to it has been released.
+ *
+ * @param umem pointer to umem
+ */
+static void upipe_fsrc_umem_free(struct umem *umem)
+{
+    munmap(umem->buffer, umem->real_size);
+}
+
+/** @internal memory manager of mapped windows */
+static struct umem_mgr upipe_fsrc_umem_mgr = {
+    .refcount = NULL,
+    .umem_alloc = upipe_fsrc_umem_alloc,
+    .umem_realloc = upipe_fsrc_umem_realloc,
+    .umem_free = upipe_fsrc_umem_free,
+    .umem_mgr_vacuum = NULL
+};
+
+/** @internal @This releases the current mapped window, and moves the file
+ * descriptor to the reading position.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_fsrc_unmap(struct upipe *upipe)
+{
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    if (upipe_fsrc->mmap_ubuf == NULL)
+        return;
+
+    ubuf_free(upipe_fsrc->mmap_ubuf);
+    upipe_fsrc->mmap_ubuf = NULL;
+    if (upipe_fsrc->fd != -1)
+        lseek(upipe_fsrc->fd, upipe_fsrc->mmap_position, SEEK_SET);
+}
+
+/** @internal @This maps the window of the file starting at the reading
+ * position, and hints the kernel to read the next window ahead.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_fsrc_map(struct upipe *upipe)
+{
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    upipe_fsrc_unmap(upipe);
+
+    off_t position = lseek(upipe_fsrc->fd, 0, SEEK_CUR);
+    struct stat st;
+    if (unlikely(position == (off_t)-1 ||
+                 fstat(upipe_fsrc->fd, &st) == -1))
+        return UBASE_ERR_EXTERNAL;
+    if (position >= st.st_size)
+        /* let read() handle the end of file */
+        return UBASE_ERR_UNHANDLED;
+
+    uint64_t offset = position - position % sysconf(_SC_PAGESIZE);
+    uint64_t size = st.st_size - offset;
+    if (size > upipe_fsrc->mmap_size)
+        size = upipe_fsrc->mmap_size;
+
+    void *buffer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                        upipe_fsrc->fd, offset);
+    if (unlikely(buffer == MAP_FAILED)) {
+        upipe_warn_va(upipe, "can't map file, falling back to read (%m)");
+        upipe_fsrc->mmap_size = 0;
+        return UBASE_ERR_EXTERNAL;
+    }
+    madvise(buffer, size, MADV_SEQUENTIAL);
+    madvise(buffer, size, MADV_WILLNEED);
+    posix_fadvise(upipe_fsrc->fd, offset + size, upipe_fsrc->mmap_size,
+                  POSIX_FADV_WILLNEED);
+
+    struct umem umem;
+    umem.mgr = &upipe_fsrc_umem_mgr;
+    umem.buffer = buffer;
+    umem.size = umem.real_size = size;
+    struct ubuf *ubuf = ubuf_block_mem_alloc_from_umem(upipe_fsrc->ubuf_mgr,
+                                                       &umem, 0, size);
+    if (unlikely(ubuf == NULL)) {
+        munmap(buffer, size);
+        upipe_warn(upipe, "ubuf manager can't wrap mapped windows, "
+                   "falling back to read");
+        upipe_fsrc->mmap_size = 0;
+        return UBASE_ERR_ALLOC;
+    }
+
+    upipe_fsrc->mmap_ubuf = ubuf;
+    upipe_fsrc->mmap_offset = offset;
+    upipe_fsrc->mmap_position = position;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This outputs a block pointing to the mapped window, mapping
+ * the next window if needed.
+ *
+ * @param upipe description structure of the pipe
+ * @param systime current system time, if in live mode
+ * @return false if the data must be read with read() instead
+ */
+static bool upipe_fsrc_output_mmap(struct upipe *upipe, uint64_t systime)
+{
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    size_t window_size = 0;
+    if (upipe_fsrc->mmap_ubuf != NULL)
+        ubuf_block_size(upipe_fsrc->mmap_ubuf, &window_size);
+    if (upipe_fsrc->mmap_position >= upipe_fsrc->mmap_offset + window_size) {
+        if (!ubase_check(upipe_fsrc_map(upipe)))
+            return false;
+        ubuf_block_size(upipe_fsrc->mmap_ubuf, &window_size);
+    }
+
+    int offset = upipe_fsrc->mmap_position - upipe_fsrc->mmap_offset;
+    int size = upipe_fsrc->output_size;
+    if (size > window_size - offset)
+        size = window_size - offset;
+
+    struct uref *uref = uref_alloc(upipe_fsrc->uref_mgr);
+    struct ubuf *ubuf = ubuf_block_splice(upipe_fsrc->mmap_ubuf, offset, size);
+    if (unlikely(uref == NULL || ubuf == NULL)) {
+        if (ubuf != NULL)
+            ubuf_free(ubuf);
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return true;
+    }
+    uref_attach_ubuf(uref, ubuf);
+
+    upipe_fsrc->mmap_position += size;
+    if (upipe_fsrc->length != (uint64_t)-1)
+        upipe_fsrc->length -= size;
+    if (upipe_fsrc->uclock != NULL)
+        uref_clock_set_cr_sys(uref, systime);
+    upipe_fsrc_output(upipe, uref, &upipe_fsrc->upump);
+    return true;
+}
+
 /** @internal @This reads data from the source and outputs it.
  * It is called either when the idler triggers (permanent storage mode) or
  * when data is available on the file descriptor (live stream mode).
@@ -224,6 +404,7 @@ static void upipe_fsrc_worker(struct upump *upump)
         if (ubase_check(upipe_fsrc_get_uri(upipe, &path)))
             path = "(none)";
         upipe_notice_va(upipe, "end of range %s", path);
+        upipe_fsrc_unmap(upipe);
         upipe_fsrc_set_upump_safe(upipe, NULL);
         ubase_clean_fd(&upipe_fsrc->fd);
         upipe_throw_source_end(upipe);
@@ -237,6 +418,12 @@ static void upipe_fsrc_worker(struct upump *upump)
             return;
     }
 
+    if (upipe_fsrc->mmap_size && upipe_fsrc->regular_file) {
+        if (upipe_fsrc_output_mmap(upipe, systime))
+            return;
+        upipe_fsrc_unmap(upipe);
+    }
+
     struct uref *uref = uref_block_alloc(upipe_fsrc->uref_mgr,
                                          upipe_fsrc->ubuf_mgr,
                                          upipe_fsrc->output_size);
@@ -421,6 +608,7 @@ static void upipe_fsrc_close(struct upipe *upipe)
 {
     struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
 
+    upipe_fsrc_unmap(upipe);
     if (unlikely(upipe_fsrc->fd != -1)) {
         const char *path;
         if (!ubase_check(upipe_fsrc_get_uri(upipe, &path)))
@@ -514,6 +702,10 @@ static int _upipe_fsrc_get_position(struct upipe *upipe,
     assert(position_p != NULL);
     if (unlikely(upipe_fsrc->fd == -1))
         return UBASE_ERR_UNHANDLED;
+    if (upipe_fsrc->mmap_ubuf != NULL) {
+        *position_p = upipe_fsrc->mmap_position;
+        return UBASE_ERR_NONE;
+    }
     off_t position = lseek(upipe_fsrc->fd, 0, SEEK_CUR);
     if (unlikely(position == (off_t)-1))
         return UBASE_ERR_EXTERNAL;
@@ -532,6 +724,7 @@ static int _upipe_fsrc_set_position(struct upipe *upipe, uint64_t position)
     struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
     if (unlikely(upipe_fsrc->fd == -1))
         return UBASE_ERR_UNHANDLED;
+    upipe_fsrc_unmap(upipe);
     return lseek(upipe_fsrc->fd, position, SEEK_SET) != (off_t)-1 ?
         UBASE_ERR_NONE : UBASE_ERR_EXTERNAL;
 }
@@ -588,6 +781,24 @@ static int _upipe_fsrc_get_range(struct upipe *upipe,
     return _upipe_fsrc_get_length(upipe, length_p);
 }
 
+/** @internal @This sets the size of the file windows mapped in memory.
+ *
+ * @param upipe description structure of the pipe
+ * @param window size of windows, in octets, or 0 to use read()
+ * @return an error code
+ */
+static int _upipe_fsrc_set_mmap(struct upipe *upipe, uint64_t window)
+{
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    uint64_t page = sysconf(_SC_PAGESIZE);
+    if (window > INT_MAX - page)
+        return UBASE_ERR_INVALID;
+    upipe_fsrc_unmap(upipe);
+    /* windows must start and end on page boundaries */
+    upipe_fsrc->mmap_size = (window + page - 1) / page * page;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a file source pipe.
  *
  * @param upipe description structure of the pipe
@@ -661,6 +872,18 @@ static int _upipe_fsrc_control(struct upipe *upipe, int command, va_list args)
             return _upipe_fsrc_get_range(upipe, offset_p, length_p);
         }
 
+        case UPIPE_FSRC_GET_MMAP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSRC_SIGNATURE)
+            uint64_t *window_p = va_arg(args, uint64_t *);
+            *window_p = upipe_fsrc_from_upipe(upipe)->mmap_size;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_FSRC_SET_MMAP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSRC_SIGNATURE)
+            uint64_t window = va_arg(args, uint64_t);
+            return _upipe_fsrc_set_mmap(upipe, window);
+        }
+
         default:
             return UBASE_ERR_UNHANDLED;
     }
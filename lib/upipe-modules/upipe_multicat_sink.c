@@ -88,6 +88,8 @@ struct upipe_multicat_sink {
     enum upipe_fsink_mode mode;
     /** sync period */
     uint64_t sync_period;
+    /** size of preallocated chunks */
+    uint64_t prealloc;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -119,6 +121,9 @@ static bool _upipe_multicat_sink_change_file(struct upipe *upipe, int64_t idx)
     if (upipe_multicat_sink->sync_period)
         upipe_fsink_set_sync_period(upipe_multicat_sink->fsink,
                                     upipe_multicat_sink->sync_period);
+    if (upipe_multicat_sink->prealloc)
+        upipe_fsink_set_prealloc(upipe_multicat_sink->fsink,
+                                 upipe_multicat_sink->prealloc);
     return true;
 }
 
@@ -388,8 +393,8 @@ static int upipe_multicat_sink_control(struct upipe *upipe,
             uint64_t sync_period = va_arg(args, uint64_t);
             upipe_multicat_sink->sync_period = sync_period;
             if (upipe_multicat_sink->fsink != NULL)
-                return upipe_control_va(upipe_multicat_sink->fsink,
-                                        command, args);
+                return upipe_fsink_set_sync_period(upipe_multicat_sink->fsink,
+                                          sync_period);
             return UBASE_ERR_NONE;
         }
         case UPIPE_FSINK_GET_SYNC_PERIOD: {
@@ -398,6 +403,21 @@ static int upipe_multicat_sink_control(struct upipe *upipe,
             *p = upipe_multicat_sink->sync_period;
             return UBASE_ERR_NONE;
         }
+        case UPIPE_FSINK_SET_PREALLOC: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSINK_SIGNATURE)
+            uint64_t prealloc = va_arg(args, uint64_t);
+            upipe_multicat_sink->prealloc = prealloc;
+            if (upipe_multicat_sink->fsink != NULL)
+                return upipe_fsink_set_prealloc(upipe_multicat_sink->fsink,
+                                          prealloc);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_FSINK_GET_PREALLOC: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSINK_SIGNATURE)
+            uint64_t *p = va_arg(args, uint64_t *);
+            *p = upipe_multicat_sink->prealloc;
+            return UBASE_ERR_NONE;
+        }
         default:
             if (upipe_multicat_sink->fsink != NULL)
                 return upipe_control_va(upipe_multicat_sink->fsink,
@@ -437,6 +457,7 @@ static struct upipe *upipe_multicat_sink_alloc(struct upipe_mgr *mgr,
     upipe_multicat_sink->rotate_offset = UPIPE_MULTICAT_SINK_DEF_ROTATE_OFFSET;
     upipe_multicat_sink->mode = UPIPE_FSINK_APPEND;
     upipe_multicat_sink->sync_period = 0;
+    upipe_multicat_sink->prealloc = 0;
     upipe_multicat_sink->flow_def = NULL;
     upipe_throw_ready(upipe);
     return upipe;
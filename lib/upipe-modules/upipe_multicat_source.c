@@ -28,6 +28,8 @@
  * @short Upipe module - multicat file source
  */
 
+#define _GNU_SOURCE
+
 #include <upipe/ubase.h>
 #include <upipe/uprobe.h>
 #include <upipe/uref_clock.h>
@@ -52,6 +54,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <string.h>
 #include <unistd.h>
@@ -118,6 +121,17 @@ struct upipe_msrc {
     /** number of missing segments */
     unsigned long missing;
 
+    /** maximum number of packets read at once */
+    uint64_t batch;
+    /** aux entries of the packets of the current batch */
+    uint8_t *batch_aux;
+    /** packets of the current batch */
+    struct uref *batch_uref;
+    /** number of packets in the current batch */
+    unsigned int batch_nb;
+    /** index of the next packet to output in the current batch */
+    unsigned int batch_idx;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -191,10 +205,26 @@ static struct upipe *upipe_msrc_alloc(struct upipe_mgr *mgr,
     upipe_msrc->fileidx = -1;
     upipe_msrc->pos = UINT64_MAX;
     upipe_msrc->missing = 0;
+    upipe_msrc->batch = 0;
+    upipe_msrc->batch_aux = NULL;
+    upipe_msrc->batch_uref = NULL;
+    upipe_msrc->batch_nb = upipe_msrc->batch_idx = 0;
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This drops the packets of the current batch.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_msrc_flush_batch(struct upipe *upipe)
+{
+    struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+    uref_free(upipe_msrc->batch_uref);
+    upipe_msrc->batch_uref = NULL;
+    upipe_msrc->batch_nb = upipe_msrc->batch_idx = 0;
+}
+
 /** @internal @This skips the current segment in case of error.
  *
  * @param upipe description structure of the pipe
@@ -222,6 +252,7 @@ static int upipe_msrc_setup(struct upipe *upipe)
     UBASE_RETURN(uref_msrc_flow_get_data(upipe_msrc->flow_def_input, &data))
     UBASE_RETURN(uref_msrc_flow_get_aux(upipe_msrc->flow_def_input, &aux))
 
+    upipe_msrc_flush_batch(upipe);
     if (upipe_msrc->fd != -1)
         ubase_clean_fd(&upipe_msrc->fd);
     if (upipe_msrc->aux_file != NULL) {
@@ -240,6 +271,9 @@ static int upipe_msrc_setup(struct upipe *upipe)
         /* try next file anyway */
         return upipe_msrc_skip(upipe);
     }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(upipe_msrc->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
 
     char aux_file[strlen(path) + strlen(aux) +
                   sizeof("18446744073709551615")];
@@ -333,22 +367,25 @@ static int upipe_msrc_start(struct upipe *upipe)
     return UBASE_ERR_NONE;
 }
 
-/** @internal @This reads data from the source and outputs it.
+/** @internal @This reads the next batch of packets, with their aux
+ * entries.
  *
  * @param upipe description structure of the pipe
  * @return an error code
  */
-static int upipe_msrc_handle(struct upipe *upipe)
+static int upipe_msrc_read_batch(struct upipe *upipe)
 {
     struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
-    uint8_t aux[8];
-    if (fread(aux, 8, 1, upipe_msrc->aux_file) != 1)
+    upipe_msrc_flush_batch(upipe);
+
+    size_t nb = fread(upipe_msrc->batch_aux, 8, upipe_msrc->batch,
+                      upipe_msrc->aux_file);
+    if (!nb)
         return upipe_msrc_skip(upipe);
-    uint64_t cr_sys = upipe_msrc_ntoh64(aux);
 
+    size_t size = nb * upipe_msrc->output_size;
     struct uref *uref = uref_block_alloc(upipe_msrc->uref_mgr,
-                                         upipe_msrc->ubuf_mgr,
-                                         upipe_msrc->output_size);
+                                         upipe_msrc->ubuf_mgr, size);
     if (unlikely(uref == NULL)) {
         return UBASE_ERR_ALLOC;
     }
@@ -360,34 +397,88 @@ static int upipe_msrc_handle(struct upipe *upipe)
         uref_free(uref);
         return UBASE_ERR_ALLOC;
     }
-    assert(output_size == upipe_msrc->output_size);
+    assert(output_size == size);
 
-    ssize_t ret = read(upipe_msrc->fd, buffer, upipe_msrc->output_size);
+    ssize_t ret = read(upipe_msrc->fd, buffer, size);
     uref_block_unmap(uref, 0);
 
-    if (unlikely(ret == -1)) {
+    if (unlikely(ret <= 0)) {
         uref_free(uref);
-        switch (errno) {
-            case EINTR:
-            case EAGAIN:
+        if (ret == -1) {
+            switch (errno) {
+                case EINTR:
+                case EAGAIN:
 #if EAGAIN != EWOULDBLOCK
-            case EWOULDBLOCK:
+                case EWOULDBLOCK:
 #endif
-                /* not an issue, try again later */
-                return UBASE_ERR_NONE;
-            case EBADF:
-            case EINVAL:
-            case EIO:
-            default:
-                break;
+                    /* not an issue, try again later */
+                    fseeko(upipe_msrc->aux_file, -8 * (off_t)nb, SEEK_CUR);
+                    return UBASE_ERR_NONE;
+                case EBADF:
+                case EINVAL:
+                case EIO:
+                default:
+                    break;
+            }
         }
 
         upipe_warn_va(upipe, "premature end of segment %"PRIu64,
                       upipe_msrc->fileidx);
         return upipe_msrc_skip(upipe);
     }
-    if (unlikely(ret != upipe_msrc->output_size))
+
+    if (unlikely(ret != size)) {
         uref_block_resize(uref, 0, ret);
+        /* give back the aux entries of the packets that were not read */
+        size_t read_nb = (ret + upipe_msrc->output_size - 1) /
+                         upipe_msrc->output_size;
+        fseeko(upipe_msrc->aux_file, -8 * (off_t)(nb - read_nb), SEEK_CUR);
+        nb = read_nb;
+    }
+#ifdef POSIX_FADV_WILLNEED
+    else {
+        /* start reading the next batch in the background */
+        off_t pos = lseek(upipe_msrc->fd, 0, SEEK_CUR);
+        if (pos != -1)
+            posix_fadvise(upipe_msrc->fd, pos, size, POSIX_FADV_WILLNEED);
+    }
+#endif
+
+    upipe_msrc->batch_uref = uref;
+    upipe_msrc->batch_nb = nb;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This outputs the next packet, reading a new batch from the
+ * source if needed.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_msrc_handle(struct upipe *upipe)
+{
+    struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+    if (upipe_msrc->batch_idx >= upipe_msrc->batch_nb) {
+        UBASE_RETURN(upipe_msrc_read_batch(upipe))
+        if (upipe_msrc->batch_uref == NULL)
+            return UBASE_ERR_NONE;
+    }
+
+    unsigned int idx = upipe_msrc->batch_idx++;
+    uint64_t cr_sys = upipe_msrc_ntoh64(upipe_msrc->batch_aux + 8 * idx);
+    struct uref *uref;
+    if (upipe_msrc->batch_nb == 1) {
+        uref = upipe_msrc->batch_uref;
+        upipe_msrc->batch_uref = NULL;
+    } else {
+        size_t size;
+        UBASE_RETURN(uref_block_size(upipe_msrc->batch_uref, &size))
+        size_t offset = idx * upipe_msrc->output_size;
+        uref = uref_block_splice(upipe_msrc->batch_uref, offset,
+                                 size - offset < upipe_msrc->output_size ?
+                                 size - offset : upipe_msrc->output_size);
+        UBASE_ALLOC_RETURN(uref)
+    }
     uref_clock_set_cr_sys(uref, cr_sys);
 
     upipe_msrc->missing = 0;
@@ -449,6 +540,7 @@ static void upipe_msrc_close(struct upipe *upipe)
 {
     struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
 
+    upipe_msrc_flush_batch(upipe);
     if (upipe_msrc->fd != -1)
         ubase_clean_fd(&upipe_msrc->fd);
     if (upipe_msrc->aux_file != NULL) {
@@ -537,8 +629,16 @@ static int upipe_msrc_set_flow_def(struct upipe *upipe, struct uref *flow_def)
         !ubase_check(uref_msrc_flow_get_data(flow_def, &data)) ||
         !ubase_check(uref_msrc_flow_get_aux(flow_def, &aux)))
         return UBASE_ERR_INVALID;
+    uint64_t batch = UPIPE_MSRC_DEF_BATCH;
+    uref_msrc_flow_get_batch(flow_def, &batch);
+    if (!batch || batch > UINT_MAX / 8)
+        return UBASE_ERR_INVALID;
 
     upipe_msrc_close(upipe);
+    uint8_t *batch_aux = realloc(upipe_msrc->batch_aux, 8 * batch);
+    UBASE_ALLOC_RETURN(batch_aux)
+    upipe_msrc->batch_aux = batch_aux;
+    upipe_msrc->batch = batch;
     ubuf_mgr_release(upipe_msrc->ubuf_mgr);
     upipe_msrc->ubuf_mgr = NULL;
     uref_free(upipe_msrc->flow_def_input);
@@ -671,6 +771,7 @@ static void upipe_msrc_free(struct upipe *upipe)
 
     struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
     uref_free(upipe_msrc->flow_def_input);
+    free(upipe_msrc->batch_aux);
     upipe_msrc_clean_output_size(upipe);
     upipe_msrc_clean_upump(upipe);
     upipe_msrc_clean_upump_mgr(upipe);
@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe module releasing buffers at their exact system date
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/uatomic.h>
+#include <upipe/uprobe.h>
+#include <upipe/uclock.h>
+#include <upipe/uref.h>
+#include <upipe/uref_clock.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_uclock.h>
+#include <upipe-modules/upipe_pacer.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <time.h>
+#include <errno.h>
+
+/** default duration of the busy loop preceding a release date (100 us) */
+#define SPIN_DEFAULT (UCLOCK_FREQ / 10000)
+/** number of 27 MHz ticks in one microsecond */
+#define TICKS_PER_US (UCLOCK_FREQ / 1000000)
+
+/** @internal @This is the private context of a pacer pipe. */
+struct upipe_pacer {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** pipe acting as output */
+    struct upipe *output;
+    /** output flow definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** uclock structure */
+    struct uclock *uclock;
+    /** uclock request */
+    struct urequest uclock_request;
+
+    /** latency of the flow */
+    uint64_t latency;
+    /** duration of the busy loop */
+    uint64_t spin;
+
+    /** number of released buffers */
+    uatomic_uint32_t packets;
+    /** number of buffers received late */
+    uatomic_uint32_t late;
+    /** maximum jitter */
+    uatomic_uint32_t max_jitter;
+    /** jitter histogram */
+    uatomic_uint32_t histogram[UPIPE_PACER_HISTOGRAM_SIZE];
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_pacer, upipe, UPIPE_PACER_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_pacer, urefcount, upipe_pacer_free)
+UPIPE_HELPER_VOID(upipe_pacer)
+UPIPE_HELPER_OUTPUT(upipe_pacer, output, flow_def, output_state, request_list)
+UPIPE_HELPER_UCLOCK(upipe_pacer, uclock, uclock_request, NULL,
+                    upipe_pacer_register_output_request,
+                    upipe_pacer_unregister_output_request)
+
+/** @internal @This allocates a pacer pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_pacer_alloc(struct upipe_mgr *mgr,
+                                       struct uprobe *uprobe,
+                                       uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_pacer_alloc_void(mgr, uprobe, signature,
+                                                 args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_pacer *upipe_pacer = upipe_pacer_from_upipe(upipe);
+    upipe_pacer_init_urefcount(upipe);
+    upipe_pacer_init_output(upipe);
+    upipe_pacer_init_uclock(upipe);
+    upipe_pacer->latency = 0;
+    upipe_pacer->spin = SPIN_DEFAULT;
+    uatomic_init(&upipe_pacer->packets, 0);
+    uatomic_init(&upipe_pacer->late, 0);
+    uatomic_init(&upipe_pacer->max_jitter, 0);
+    for (unsigned int i = 0; i < UPIPE_PACER_HISTOGRAM_SIZE; i++)
+        uatomic_init(&upipe_pacer->histogram[i], 0);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This records the jitter of a released buffer.
+ *
+ * @param upipe description structure of the pipe
+ * @param jitter difference between the release date and the requested date
+ */
+static void upipe_pacer_record(struct upipe *upipe, uint64_t jitter)
+{
+    struct upipe_pacer *upipe_pacer = upipe_pacer_from_upipe(upipe);
+    uatomic_fetch_add(&upipe_pacer->packets, 1);
+
+    if (jitter > UINT32_MAX)
+        jitter = UINT32_MAX;
+    uint32_t max_jitter = uatomic_load(&upipe_pacer->max_jitter);
+    if (jitter > max_jitter)
+        uatomic_store(&upipe_pacer->max_jitter, jitter);
+
+    uint64_t us = jitter / TICKS_PER_US;
+    unsigned int bin = 0;
+    while (us && bin < UPIPE_PACER_HISTOGRAM_SIZE - 1) {
+        us >>= 1;
+        bin++;
+    }
+    uatomic_fetch_add(&upipe_pacer->histogram[bin], 1);
+}
+
+/** @internal @This blocks the thread until the given date.
+ *
+ * @param upipe description structure of the pipe
+ * @param date date to wait for
+ * @return the current date
+ */
+static uint64_t upipe_pacer_wait(struct upipe *upipe, uint64_t date)
+{
+    struct upipe_pacer *upipe_pacer = upipe_pacer_from_upipe(upipe);
+    uint64_t now = uclock_now(upipe_pacer->uclock);
+
+    while (now + upipe_pacer->spin < date) {
+        uint64_t wait = date - upipe_pacer->spin - now;
+        struct timespec ts;
+        ts.tv_sec = wait / UCLOCK_FREQ;
+        ts.tv_nsec = (wait % UCLOCK_FREQ) * UINT64_C(1000000000) /
+                     UCLOCK_FREQ;
+        if (nanosleep(&ts, NULL) == -1 && errno != EINTR)
+            break;
+        now = uclock_now(upipe_pacer->uclock);
+    }
+
+    while (now < date)
+        now = uclock_now(upipe_pacer->uclock);
+    return now;
+}
+
+/** @internal @This receives data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_pacer_input(struct upipe *upipe, struct uref *uref,
+                              struct upump **upump_p)
+{
+    struct upipe_pacer *upipe_pacer = upipe_pacer_from_upipe(upipe);
+    uint64_t cr_sys;
+    if (unlikely(upipe_pacer->uclock == NULL ||
+                 !ubase_check(uref_clock_get_cr_sys(uref, &cr_sys)))) {
+        upipe_pacer_output(upipe, uref, upump_p);
+        return;
+    }
+
+    uint64_t date = cr_sys + upipe_pacer->latency;
+    uint64_t now = uclock_now(upipe_pacer->uclock);
+    if (unlikely(now > date)) {
+        uatomic_fetch_add(&upipe_pacer->late, 1);
+        upipe_verbose_va(upipe, "late buffer by %"PRIu64" us",
+                         (now - date) / TICKS_PER_US);
+    } else
+        now = upipe_pacer_wait(upipe, date);
+
+    upipe_pacer_record(upipe, now - date);
+    upipe_pacer_output(upipe, uref, upump_p);
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_pacer_set_flow_def(struct upipe *upipe, struct uref *flow_def)
+{
+    struct upipe_pacer *upipe_pacer = upipe_pacer_from_upipe(upipe);
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    struct uref *flow_def_dup;
+    if ((flow_def_dup = uref_dup(flow_def)) == NULL)
+        return UBASE_ERR_ALLOC;
+    upipe_pacer->latency = 0;
+    uref_clock_get_latency(flow_def, &upipe_pacer->latency);
+    upipe_pacer_store_flow_def(upipe, flow_def_dup);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This returns the jitter statistics.
+ *
+ * @param upipe description structure of the pipe
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+static int _upipe_pacer_get_stats(struct upipe *upipe,
+                                  struct upipe_pacer_stats *stats)
+{
+    struct upipe_pacer *upipe_pacer = upipe_pacer_from_upipe(upipe);
+    stats->packets = uatomic_load(&upipe_pacer->packets);
+    stats->late = uatomic_load(&upipe_pacer->late);
+    stats->max_jitter = uatomic_load(&upipe_pacer->max_jitter);
+    for (unsigned int i = 0; i < UPIPE_PACER_HISTOGRAM_SIZE; i++)
+        stats->histogram[i] = uatomic_load(&upipe_pacer->histogram[i]);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This resets the jitter statistics.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int _upipe_pacer_reset_stats(struct upipe *upipe)
+{
+    struct upipe_pacer *upipe_pacer = upipe_pacer_from_upipe(upipe);
+    uatomic_store(&upipe_pacer->packets, 0);
+    uatomic_store(&upipe_pacer->late, 0);
+    uatomic_store(&upipe_pacer->max_jitter, 0);
+    for (unsigned int i = 0; i < UPIPE_PACER_HISTOGRAM_SIZE; i++)
+        uatomic_store(&upipe_pacer->histogram[i], 0);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a pacer pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_pacer_control(struct upipe *upipe, int command, va_list args)
+{
+    struct upipe_pacer *upipe_pacer = upipe_pacer_from_upipe(upipe);
+
+    switch (command) {
+        case UPIPE_ATTACH_UCLOCK:
+            upipe_pacer_require_uclock(upipe);
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            return upipe_pacer_alloc_output_proxy(upipe, request);
+        }
+        case UPIPE_UNREGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            return upipe_pacer_free_output_proxy(upipe, request);
+        }
+        case UPIPE_GET_FLOW_DEF: {
+            struct uref **p = va_arg(args, struct uref **);
+            return upipe_pacer_get_flow_def(upipe, p);
+        }
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_pacer_set_flow_def(upipe, flow_def);
+        }
+        case UPIPE_GET_OUTPUT: {
+            struct upipe **p = va_arg(args, struct upipe **);
+            return upipe_pacer_get_output(upipe, p);
+        }
+        case UPIPE_SET_OUTPUT: {
+            struct upipe *output = va_arg(args, struct upipe *);
+            return upipe_pacer_set_output(upipe, output);
+        }
+
+        case UPIPE_PACER_GET_SPIN: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_PACER_SIGNATURE)
+            uint64_t *spin_p = va_arg(args, uint64_t *);
+            *spin_p = upipe_pacer->spin;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_PACER_SET_SPIN: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_PACER_SIGNATURE)
+            upipe_pacer->spin = va_arg(args, uint64_t);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_PACER_GET_STATS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_PACER_SIGNATURE)
+            struct upipe_pacer_stats *stats =
+                va_arg(args, struct upipe_pacer_stats *);
+            return _upipe_pacer_get_stats(upipe, stats);
+        }
+        case UPIPE_PACER_RESET_STATS:
+            UBASE_SIGNATURE_CHECK(args, UPIPE_PACER_SIGNATURE)
+            return _upipe_pacer_reset_stats(upipe);
+
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_pacer_free(struct upipe *upipe)
+{
+    struct upipe_pacer *upipe_pacer = upipe_pacer_from_upipe(upipe);
+    upipe_throw_dead(upipe);
+
+    uatomic_clean(&upipe_pacer->packets);
+    uatomic_clean(&upipe_pacer->late);
+    uatomic_clean(&upipe_pacer->max_jitter);
+    for (unsigned int i = 0; i < UPIPE_PACER_HISTOGRAM_SIZE; i++)
+        uatomic_clean(&upipe_pacer->histogram[i]);
+    upipe_pacer_clean_uclock(upipe);
+    upipe_pacer_clean_output(upipe);
+    upipe_pacer_clean_urefcount(upipe);
+    upipe_pacer_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_pacer_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_PACER_SIGNATURE,
+
+    .upipe_alloc = upipe_pacer_alloc,
+    .upipe_input = upipe_pacer_input,
+    .upipe_control = upipe_pacer_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for all pacer pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_pacer_mgr_alloc(void)
+{
+    return &upipe_pacer_mgr;
+}
@@ -28,9 +28,15 @@
  *
  * Note that the allocator requires an additional parameter:
  * @table 2
- * @item queue_length @item maximum length of the queue (<= 255)
+ * @item queue_length @item maximum length of the queue
+ * (<= @ref UQUEUE_MAX_LENGTH)
  * @end table
  *
+ * When allocated with @ref upipe_qsrc_spsc_alloc, the queue of urefs is a
+ * single-producer single-consumer queue, which is cheaper but requires that
+ * only one queue sink, in one thread, pushes into it. The out-of-band queues
+ * are always multi-producer.
+ *
  * Also note that this module is exceptional in that upipe_release() may be
  * called from another thread. The release function is thread-safe.
  */
@@ -108,10 +114,12 @@ static struct upipe *_upipe_qsrc_alloc(struct upipe_mgr *mgr,
                                        struct uprobe *uprobe,
                                        uint32_t signature, va_list args)
 {
-    if (signature != UPIPE_QSRC_SIGNATURE)
+    if (signature != UPIPE_QSRC_SIGNATURE &&
+        signature != UPIPE_QSRC_SPSC_SIGNATURE)
         goto upipe_qsrc_alloc_err;
+    bool spsc = signature == UPIPE_QSRC_SPSC_SIGNATURE;
     unsigned int length = va_arg(args, unsigned int);
-    if (!length || length > UINT8_MAX)
+    if (!length || length > UQUEUE_MAX_LENGTH)
         goto upipe_qsrc_alloc_err;
 
     struct upipe_qsrc *upipe_qsrc = malloc(sizeof(struct upipe_qsrc) +
@@ -122,8 +130,11 @@ static struct upipe *_upipe_qsrc_alloc(struct upipe_mgr *mgr,
 
     struct upipe *upipe = upipe_qsrc_to_upipe(upipe_qsrc);
     upipe_init(upipe, mgr, uprobe);
-    if (unlikely(!uqueue_init(&upipe_queue(upipe)->uqueue, length,
-                              upipe_qsrc->uqueue_extra) ||
+    if (unlikely(!(spsc ?
+                   uqueue_init_spsc(&upipe_queue(upipe)->uqueue, length,
+                                    upipe_qsrc->uqueue_extra) :
+                   uqueue_init(&upipe_queue(upipe)->uqueue, length,
+                               upipe_qsrc->uqueue_extra)) ||
                  !uqueue_init(&upipe_queue(upipe)->downstream_oob, OOB_QUEUES,
                               upipe_qsrc->uqueue_extra +
                               uqueue_sizeof(length)) ||
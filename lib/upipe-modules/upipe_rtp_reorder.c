@@ -102,11 +102,25 @@ struct upipe_rtpr {
     /** manager to create subs */
     struct upipe_mgr sub_mgr;
 
-    struct uchain queue;
+    /** reorder ring, indexed by seqnum modulo the window */
+    struct uref **ring;
+    /** bitmap of the occupied slots of the ring */
+    uint64_t *ring_map;
+    /** size of the ring (power of 2, multiple of 64) */
+    unsigned int window;
+    /** number of packets in the ring */
+    unsigned int nb_urefs;
+    /** seqnum of the next packet to output */
+    uint16_t first_seqnum;
+    /** highest seqnum received */
+    uint16_t max_seqnum;
 
     uint64_t last_sent_seqnum;
     uint64_t num_consecutive_late;
 
+    /** statistics */
+    struct upipe_rtpr_stats stats;
+
     /** delay to set */
     uint64_t delay;
 
@@ -268,6 +282,67 @@ static int upipe_rtpr_sub_control(struct upipe *upipe,
     }
 }
 
+/** @internal @This returns the slot of the first packet in the ring,
+ * starting from the slot of first_seqnum. The ring must not be empty.
+ *
+ * @param upipe description structure of the pipe
+ * @return slot of the first packet
+ */
+static unsigned int upipe_rtpr_first_slot(struct upipe *upipe)
+{
+    struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
+    unsigned int nb_words = rtpr->window / 64;
+    unsigned int slot = rtpr->first_seqnum & (rtpr->window - 1);
+    unsigned int word = slot / 64;
+    uint64_t bits = rtpr->ring_map[word] & (UINT64_MAX << (slot % 64));
+
+    assert(rtpr->nb_urefs);
+    /* the last iteration rereads the starting word for the wrapped bits */
+    for (unsigned int i = 0; i <= nb_words; i++) {
+        if (bits)
+            return word * 64 + __builtin_ctzll(bits);
+        word = (word + 1) % nb_words;
+        bits = rtpr->ring_map[word];
+    }
+    assert(0);
+    return slot;
+}
+
+/** @internal @This removes the first packet from the ring, and updates the
+ * loss counter.
+ *
+ * @param upipe description structure of the pipe
+ * @return the removed packet
+ */
+static struct uref *upipe_rtpr_pop(struct upipe *upipe)
+{
+    struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
+    unsigned int slot = upipe_rtpr_first_slot(upipe);
+    uint16_t seqnum = rtpr->first_seqnum +
+        ((slot - rtpr->first_seqnum) & (rtpr->window - 1));
+    struct uref *uref = rtpr->ring[slot];
+
+    rtpr->ring[slot] = NULL;
+    rtpr->ring_map[slot / 64] &= ~(UINT64_C(1) << (slot % 64));
+    rtpr->nb_urefs--;
+    rtpr->stats.lost += (uint16_t)(seqnum - rtpr->first_seqnum);
+    rtpr->last_sent_seqnum = seqnum;
+    rtpr->first_seqnum = seqnum + 1;
+    return uref;
+}
+
+/** @internal @This outputs all packets of the ring, regardless of their
+ * dates.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rtpr_flush(struct upipe *upipe)
+{
+    struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
+    while (rtpr->nb_urefs)
+        upipe_rtpr_output(upipe, upipe_rtpr_pop(upipe), NULL);
+}
+
 static void upipe_rtpr_timer(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
@@ -275,31 +350,20 @@ static void upipe_rtpr_timer(struct upump *upump)
     uint64_t now = uclock_now(rtpr->uclock);
     uint64_t date_sys;
     int type;
-    struct uchain *uchain, *uchain_tmp;
-    struct uref *uref;
 
-    ulist_delete_foreach(&rtpr->queue, uchain, uchain_tmp) {
-        uref = uref_from_uchain(uchain);
+    while (rtpr->nb_urefs) {
+        struct uref *uref = rtpr->ring[upipe_rtpr_first_slot(upipe)];
         uref_clock_get_date_sys(uref, &date_sys, &type);
-        uint64_t seqnum = 0;
-        uref_attr_get_priv(uref, &seqnum);
-
-        if (now >= date_sys || date_sys == UINT64_MAX) {
-            ulist_delete(uchain);
-            upipe_rtpr_output(upipe, uref, NULL);
-            rtpr->last_sent_seqnum = seqnum;
-        }
-        else {
+        if (now < date_sys && date_sys != UINT64_MAX)
             break;
-        }
+
+        upipe_rtpr_output(upipe, upipe_rtpr_pop(upipe), NULL);
     }
 }
 
 static void upipe_rtpr_list_add(struct upipe *upipe, struct uref *uref)
 {
     struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
-    int dup = 0, ooo = 0;
-    struct uchain *uchain, *uchain_tmp;
 
     uint8_t rtp_buffer[RTP_HEADER_SIZE];
     const uint8_t *rtp_header = uref_block_peek(uref, 0, RTP_HEADER_SIZE,
@@ -311,13 +375,13 @@ static void upipe_rtpr_list_add(struct upipe *upipe, struct uref *uref)
         return;
     }
     uint16_t new_seqnum = rtp_get_seqnum(rtp_header);
-    uref_attr_set_priv(uref, new_seqnum);
     uref_block_peek_unmap(uref, 0, rtp_buffer, rtp_header);
 
     /* Drop late packets */
     if (rtpr->last_sent_seqnum != UINT64_MAX &&
         (seq_num_lt(new_seqnum, rtpr->last_sent_seqnum) || new_seqnum == rtpr->last_sent_seqnum)) {
         uref_free(uref);
+        rtpr->stats.late++;
         rtpr->num_consecutive_late++;
 
         /* Assume new stream if too many consecutive late packets */
@@ -329,46 +393,57 @@ static void upipe_rtpr_list_add(struct upipe *upipe, struct uref *uref)
 
     rtpr->num_consecutive_late = 0;
 
-    /* Remove date_sys for any late packets */
-    ulist_delete_foreach_reverse(&rtpr->queue, uchain, uchain_tmp) {
-        struct uref *cur_uref = uref_from_uchain(uchain);
-        uint64_t seqnum = 0;
-        uref_attr_get_priv(cur_uref, &seqnum);
-
-        if (seq_num_lt(new_seqnum, seqnum)) {
-            if (ulist_is_first(&rtpr->queue, uchain)) {
-                uref_clock_delete_date_sys(uref);
-                ulist_insert(uchain->prev, uchain, uref_to_uchain(uref));
-                ooo = 1;
-                break;
-            }
-            else {
-                struct uref *prev_uref = uref_from_uchain(uchain->prev);
-                uint64_t prev_seqnum = 0;
-                uref_attr_get_priv(prev_uref, &prev_seqnum);
-                if (!seq_num_lt(new_seqnum, prev_seqnum) && !(new_seqnum == prev_seqnum)) {
-                    uref_clock_delete_date_sys(uref);
-                    ulist_insert(uchain->prev, uchain, uref_to_uchain(uref));
-                    ooo = 1;
-                    break;
-                }
+    if (rtpr->last_sent_seqnum == UINT64_MAX) {
+        if (!rtpr->nb_urefs)
+            rtpr->first_seqnum = rtpr->max_seqnum = new_seqnum;
+        else if (seq_num_lt(new_seqnum, rtpr->first_seqnum)) {
+            if ((uint16_t)(rtpr->max_seqnum - new_seqnum) >= rtpr->window) {
+                /* New stream */
+                upipe_rtpr_flush(upipe);
+                rtpr->last_sent_seqnum = UINT64_MAX;
+                rtpr->max_seqnum = new_seqnum;
             }
+            rtpr->first_seqnum = new_seqnum;
         }
-        /* Duplicate packet */
-        else if (new_seqnum == seqnum) {
-            dup = 1;
-            uref_free(uref);
+    }
+
+    /* Make room if the packet is beyond the window */
+    while ((uint16_t)(new_seqnum - rtpr->first_seqnum) >= rtpr->window) {
+        if (!rtpr->nb_urefs) {
+            uint16_t skipped = new_seqnum - rtpr->first_seqnum -
+                               rtpr->window + 1;
+            rtpr->stats.lost += skipped;
+            rtpr->first_seqnum += skipped;
+            rtpr->last_sent_seqnum = (uint16_t)(rtpr->first_seqnum - 1);
             break;
         }
-        else
-            break;
+        rtpr->stats.overflows++;
+        upipe_rtpr_output(upipe, upipe_rtpr_pop(upipe), NULL);
     }
 
+    unsigned int slot = new_seqnum & (rtpr->window - 1);
+    uint64_t mask = UINT64_C(1) << (slot % 64);
 
-    /* Add to end if normal packet */
-    if (!dup && !ooo) {
-        ulist_add(&rtpr->queue, uref_to_uchain(uref));
+    /* Duplicate packet */
+    if (rtpr->ring_map[slot / 64] & mask) {
+        rtpr->stats.duplicates++;
+        uref_free(uref);
+        return;
     }
+
+    /* Remove date_sys for out of order packets */
+    if (rtpr->nb_urefs && seq_num_lt(new_seqnum, rtpr->max_seqnum)) {
+        uint16_t depth = rtpr->max_seqnum - new_seqnum;
+        if (depth > rtpr->stats.max_reorder)
+            rtpr->stats.max_reorder = depth;
+        rtpr->stats.reordered++;
+        uref_clock_delete_date_sys(uref);
+    } else
+        rtpr->max_seqnum = new_seqnum;
+
+    rtpr->ring[slot] = uref;
+    rtpr->ring_map[slot / 64] |= mask;
+    rtpr->nb_urefs++;
 }
 
 /** @internal @This receives data.
@@ -423,9 +498,11 @@ static void upipe_rtpr_sub_free(struct upipe *upipe)
 
     upipe_throw_dead(upipe);
 
+    uref_free(upipe_rtpr_sub->flow_def);
     upipe_rtpr_sub_clean_input(upipe);
     upipe_rtpr_sub_clean_sub(upipe);
     upipe_rtpr_sub_clean_urefcount(upipe);
+    upipe_rtpr_sub_free_void(upipe);
 }
 
 /** @internal @This initializes the output manager for an rtpr sub pipe.
@@ -445,17 +522,46 @@ static void upipe_rtpr_init_sub_mgr(struct upipe *upipe)
     sub_mgr->upipe_mgr_control = NULL;
 }
 
+/** @internal @This frees the packets of the ring and the ring.
+ *
+ * @param upipe description structure of the pipe
+ */
 static void upipe_rtpr_clean_queue(struct upipe *upipe)
 {
     struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
-    struct uchain *uchain, *uchain_tmp;
-    struct uref *uref;
 
-    ulist_delete_foreach(&rtpr->queue, uchain, uchain_tmp) {
-        uref = uref_from_uchain(uchain);
-        ulist_delete(uchain);
-        uref_free(uref);
+    for (unsigned int i = 0; i < rtpr->window; i++)
+        uref_free(rtpr->ring[i]);
+    free(rtpr->ring);
+    free(rtpr->ring_map);
+    rtpr->ring = NULL;
+    rtpr->ring_map = NULL;
+    rtpr->nb_urefs = 0;
+}
+
+/** @internal @This allocates the ring for the given window. The ring
+ * must be empty, and is left untouched in case of failure.
+ *
+ * @param upipe description structure of the pipe
+ * @param window size of the window, power of 2 between 64 and 32768
+ * @return an error code
+ */
+static int upipe_rtpr_init_queue(struct upipe *upipe, unsigned int window)
+{
+    struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
+
+    struct uref **ring = calloc(window, sizeof (struct uref *));
+    uint64_t *ring_map = calloc(window / 64, sizeof (uint64_t));
+    if (unlikely(ring == NULL || ring_map == NULL)) {
+        free(ring);
+        free(ring_map);
+        return UBASE_ERR_ALLOC;
     }
+    rtpr->ring = ring;
+    rtpr->ring_map = ring_map;
+    rtpr->window = window;
+    rtpr->nb_urefs = 0;
+    return UBASE_ERR_NONE;
 }
 
 /** @internal @This allocates a rtpr pipe.
@@ -475,6 +581,12 @@ static struct upipe *upipe_rtpr_alloc(struct upipe_mgr *mgr,
         return NULL;
 
     struct upipe_rtpr *upipe_rtpr = upipe_rtpr_from_upipe(upipe);
+    if (unlikely(!ubase_check(upipe_rtpr_init_queue(upipe,
+                        UPIPE_RTPR_DEFAULT_WINDOW)))) {
+        upipe_rtpr_free_void(upipe);
+        return NULL;
+    }
+
     upipe_rtpr_init_urefcount(upipe);
 
     urefcount_init(upipe_rtpr_to_urefcount_real(upipe_rtpr),
@@ -489,8 +601,8 @@ static struct upipe *upipe_rtpr_alloc(struct upipe_mgr *mgr,
 
     upipe_rtpr->flow_def_input = NULL;
 
-    ulist_init(&upipe_rtpr->queue);
-
+    upipe_rtpr->first_seqnum = upipe_rtpr->max_seqnum = 0;
+    memset(&upipe_rtpr->stats, 0, sizeof (upipe_rtpr->stats));
     upipe_rtpr->last_sent_seqnum = UINT64_MAX;
     upipe_rtpr->num_consecutive_late = 0;
     upipe_rtpr->delay = UCLOCK_FREQ/10;
@@ -553,6 +665,58 @@ static int _upipe_rtpr_set_delay(struct upipe *upipe, uint64_t delay)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This returns the size of the reorder window.
+ *
+ * @param upipe description structure of the pipe
+ * @param window_p filled with the number of packets
+ * @return an error code
+ */
+static int _upipe_rtpr_get_window(struct upipe *upipe,
+                                  unsigned int *window_p)
+{
+    struct upipe_rtpr *upipe_rtpr = upipe_rtpr_from_upipe(upipe);
+    *window_p = upipe_rtpr->window;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the size of the reorder window. Pending packets
+ * are output immediately.
+ *
+ * @param upipe description structure of the pipe
+ * @param window number of packets, power of 2 between 64 and 32768
+ * @return an error code
+ */
+static int _upipe_rtpr_set_window(struct upipe *upipe, unsigned int window)
+{
+    struct upipe_rtpr *upipe_rtpr = upipe_rtpr_from_upipe(upipe);
+    if (window < 64 || window > 32768 || (window & (window - 1)))
+        return UBASE_ERR_INVALID;
+    if (window == upipe_rtpr->window)
+        return UBASE_ERR_NONE;
+
+    upipe_rtpr_flush(upipe);
+    struct uref **ring = upipe_rtpr->ring;
+    uint64_t *ring_map = upipe_rtpr->ring_map;
+    UBASE_RETURN(upipe_rtpr_init_queue(upipe, window))
+    free(ring);
+    free(ring_map);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This returns the reorder statistics.
+ *
+ * @param upipe description structure of the pipe
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+static int _upipe_rtpr_get_stats(struct upipe *upipe,
+                                 struct upipe_rtpr_stats *stats)
+{
+    struct upipe_rtpr *upipe_rtpr = upipe_rtpr_from_upipe(upipe);
+    *stats = upipe_rtpr->stats;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a rtpr pipe.
  *
  * @param upipe description structure of the pipe
@@ -614,6 +778,28 @@ static int upipe_rtpr_control(struct upipe *upipe, int command, va_list args)
             uint64_t delay = va_arg(args, uint64_t);
             return _upipe_rtpr_set_delay(upipe, delay);
         }
+        case UPIPE_RTPR_GET_WINDOW: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTPR_SIGNATURE)
+            unsigned int *window_p = va_arg(args, unsigned int *);
+            return _upipe_rtpr_get_window(upipe, window_p);
+        }
+        case UPIPE_RTPR_SET_WINDOW: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTPR_SIGNATURE)
+            unsigned int window = va_arg(args, unsigned int);
+            return _upipe_rtpr_set_window(upipe, window);
+        }
+        case UPIPE_RTPR_GET_STATS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTPR_SIGNATURE)
+            struct upipe_rtpr_stats *stats =
+                va_arg(args, struct upipe_rtpr_stats *);
+            return _upipe_rtpr_get_stats(upipe, stats);
+        }
+        case UPIPE_RTPR_RESET_STATS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTPR_SIGNATURE)
+            struct upipe_rtpr *upipe_rtpr = upipe_rtpr_from_upipe(upipe);
+            memset(&upipe_rtpr->stats, 0, sizeof (upipe_rtpr->stats));
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -649,8 +835,6 @@ static void upipe_rtpr_free(struct urefcount *urefcount_real)
 
     upipe_rtpr_clean_uclock(upipe);
     upipe_rtpr_clean_sub_inputs(upipe);
-    if (upipe_rtpr->flow_def != NULL)
-        uref_free(upipe_rtpr->flow_def);
     urefcount_clean(urefcount_real);
 
     upipe_rtpr_clean_upump(upipe);
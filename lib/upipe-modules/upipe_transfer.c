@@ -69,7 +69,9 @@ struct upipe_xfer_mgr {
     /** remote upump_mgr */
     struct upump_mgr *upump_mgr;
     /** queue length */
-    uint8_t queue_length;
+    uint32_t queue_length;
+    /** true if the queues are single-producer single-consumer */
+    bool spsc;
     /** queue of messages */
     struct uqueue uqueue;
     /** pool of @ref upipe_xfer_msg */
@@ -335,8 +337,12 @@ static struct upipe *_upipe_xfer_alloc(struct upipe_mgr *mgr,
     if (unlikely(upipe_xfer == NULL))
         goto upipe_xfer_alloc_err2;
 
-    if (unlikely(!uqueue_init(&upipe_xfer->uqueue, xfer_mgr->queue_length,
-                              upipe_xfer->extra))) {
+    if (unlikely(!(xfer_mgr->spsc ?
+                   uqueue_init_spsc(&upipe_xfer->uqueue,
+                                    xfer_mgr->queue_length,
+                                    upipe_xfer->extra) :
+                   uqueue_init(&upipe_xfer->uqueue, xfer_mgr->queue_length,
+                               upipe_xfer->extra)))) {
         free(upipe_xfer);
         goto upipe_xfer_alloc_err2;
     }
@@ -705,19 +711,19 @@ static int upipe_xfer_mgr_control(struct upipe_mgr *mgr,
     }
 }
 
-/** @This returns a management structure for xfer pipes. You would need one
- * management structure per target event loop (upump manager). The management
- * structure can be allocated in any thread, but must be attached in the
- * same thread as the one running the upump manager.
+/** @internal @This returns a management structure for xfer pipes.
  *
  * @param queue_length maximum length of the internal queues
  * @param msg_pool_depth maximum number of messages in the pool
  * @param mutex mutual exclusion primitives to access the event loop, or NULL
+ * @param spsc true if the internal queues are single-producer
+ * single-consumer
  * @return pointer to manager
  */
-struct upipe_mgr *upipe_xfer_mgr_alloc(uint8_t queue_length,
-                                       uint16_t msg_pool_depth,
-                                       struct umutex *mutex)
+static struct upipe_mgr *_upipe_xfer_mgr_alloc(uint32_t queue_length,
+                                               uint16_t msg_pool_depth,
+                                               struct umutex *mutex,
+                                               bool spsc)
 {
     assert(queue_length);
     struct upipe_xfer_mgr *xfer_mgr = malloc(sizeof(struct upipe_xfer_mgr) +
@@ -727,8 +733,11 @@ struct upipe_mgr *upipe_xfer_mgr_alloc(uint8_t queue_length,
         return NULL;
 
     memset(xfer_mgr, 0, sizeof(*xfer_mgr));
-    if (unlikely(!uqueue_init(&xfer_mgr->uqueue, queue_length,
-                              xfer_mgr->extra))) {
+    if (unlikely(!(spsc ?
+                   uqueue_init_spsc(&xfer_mgr->uqueue, queue_length,
+                                    xfer_mgr->extra) :
+                   uqueue_init(&xfer_mgr->uqueue, queue_length,
+                               xfer_mgr->extra)))) {
         free(xfer_mgr);
         return NULL;
     }
@@ -736,6 +745,7 @@ struct upipe_mgr *upipe_xfer_mgr_alloc(uint8_t queue_length,
     xfer_mgr->upump = NULL;
     xfer_mgr->upump_mgr = NULL;
     xfer_mgr->queue_length = queue_length;
+    xfer_mgr->spsc = spsc;
     ulifo_init(&xfer_mgr->msg_pool, msg_pool_depth,
                xfer_mgr->extra + uqueue_sizeof(queue_length));
 
@@ -750,3 +760,35 @@ struct upipe_mgr *upipe_xfer_mgr_alloc(uint8_t queue_length,
     mgr->upipe_mgr_control = upipe_xfer_mgr_control;
     return mgr;
 }
+
+/** @This returns a management structure for xfer pipes. You would need one
+ * management structure per target event loop (upump manager). The management
+ * structure can be allocated in any thread, but must be attached in the
+ * same thread as the one running the upump manager.
+ *
+ * @param queue_length maximum length of the internal queues
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param mutex mutual exclusion primitives to access the event loop, or NULL
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_xfer_mgr_alloc(uint32_t queue_length,
+                                       uint16_t msg_pool_depth,
+                                       struct umutex *mutex)
+{
+    return _upipe_xfer_mgr_alloc(queue_length, msg_pool_depth, mutex, false);
+}
+
+/** @This returns a management structure for xfer pipes, using
+ * single-producer single-consumer queues (see @ref uqueue_init_spsc).
+ *
+ * @param queue_length maximum length of the internal queues
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param mutex mutual exclusion primitives to access the event loop, or NULL
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_xfer_mgr_alloc_spsc(uint32_t queue_length,
+                                            uint16_t msg_pool_depth,
+                                            struct umutex *mutex)
+{
+    return _upipe_xfer_mgr_alloc(queue_length, msg_pool_depth, mutex, true);
+}
@@ -28,6 +28,9 @@
  * @short Upipe sink module for udp
  */
 
+#define _GNU_SOURCE
+
+#include <upipe/config.h>
 #include <upipe/ubase.h>
 #include <upipe/ulist.h>
 #include <upipe/uprobe.h>
@@ -59,8 +62,13 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <assert.h>
+#include <time.h>
+#if defined(SO_TXTIME) && defined(__linux__)
+#include <linux/net_tstamp.h>
+#endif
 
 /** tolerance for late packets */
 #define SYSTIME_TOLERANCE UCLOCK_FREQ
@@ -71,6 +79,8 @@
 
 #define UDP_DEFAULT_TTL 0
 #define UDP_DEFAULT_PORT 1234
+/** maximum number of datagrams sent in a single call in batched mode */
+#define UDP_MAX_BATCH 64
 
 /** @hidden */
 static void upipe_udpsink_watcher(struct upump *upump);
@@ -118,6 +128,11 @@ struct upipe_udpsink {
     /** destination for not-connected socket (size) */
     socklen_t addrlen;
 
+    /** window of deadlines sent together in batched mode, 0 if disabled */
+    uint64_t window;
+    /** clock used for kernel pacing in batched mode, or -1 */
+    int txtime_clockid;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -158,6 +173,8 @@ static struct upipe *upipe_udpsink_alloc(struct upipe_mgr *mgr,
     upipe_udpsink->uri = NULL;
     upipe_udpsink->raw = false;
     upipe_udpsink->addrlen = 0;
+    upipe_udpsink->window = 0;
+    upipe_udpsink->txtime_clockid = -1;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -185,6 +202,176 @@ static void upipe_udpsink_poll(struct upipe *upipe)
     }
 }
 
+#ifdef UPIPE_HAVE_SENDMMSG
+/** @internal @This outputs the given uref, along with the following held
+ * urefs whose deadlines fall within the batch window, with a single
+ * sendmmsg() call.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param now current system time, or UINT64_MAX in non-live mode
+ * @param systime deadline of the uref, or UINT64_MAX if not dated
+ * @return true if the uref was processed
+ */
+static bool upipe_udpsink_output_batch(struct upipe *upipe, struct uref *uref,
+                                       uint64_t now, uint64_t systime)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    struct uref *urefs[UDP_MAX_BATCH];
+    uint64_t systimes[UDP_MAX_BATCH];
+    int iovec_counts[UDP_MAX_BATCH];
+    unsigned int nb = 0;
+    unsigned int total = 0;
+
+    urefs[0] = uref;
+    systimes[0] = systime;
+    for ( ; ; ) {
+        size_t payload_len;
+        int iovec_count = -1;
+        if (likely(ubase_check(uref_block_size(urefs[nb], &payload_len))))
+            iovec_count = uref_block_iovec_count(urefs[nb], 0, -1);
+        if (unlikely(iovec_count <= 0)) {
+            if (iovec_count == -1)
+                upipe_warn(upipe, "cannot read ubuf buffer");
+            uref_free(urefs[nb]);
+            if (nb == 0)
+                return true;
+        } else {
+            iovec_counts[nb++] = iovec_count;
+            total += iovec_count + (upipe_udpsink->raw ? 1 : 0);
+        }
+        if (nb >= UDP_MAX_BATCH)
+            break;
+
+        /* look ahead in the held urefs */
+        struct uref *next = upipe_udpsink_pop_input(upipe);
+        if (next == NULL)
+            break;
+
+        const char *def;
+        uint64_t next_systime = UINT64_MAX;
+        if (unlikely(ubase_check(uref_flow_get_def(next, &def))) ||
+            (now != UINT64_MAX &&
+             ubase_check(uref_clock_get_cr_sys(next, &next_systime)) &&
+             (next_systime += upipe_udpsink->latency) >
+                now + upipe_udpsink->window)) {
+            upipe_udpsink_unshift_input(upipe, next);
+            break;
+        }
+        urefs[nb] = next;
+        systimes[nb] = next_systime;
+    }
+    if (unlikely(nb == 0))
+        return true;
+
+    struct iovec iovecs[total];
+    struct mmsghdr msgs[nb];
+    union {
+        struct cmsghdr align;
+        uint8_t buf[CMSG_SPACE(sizeof(uint64_t))];
+    } controls[upipe_udpsink->txtime_clockid != -1 ? nb : 1];
+    /* each datagram carries its own length in its raw header */
+    uint8_t raw_headers[upipe_udpsink->raw ? nb : 1][RAW_HEADER_SIZE];
+    uint64_t txnow = 0;
+    if (upipe_udpsink->txtime_clockid != -1) {
+        struct timespec ts;
+        clock_gettime(upipe_udpsink->txtime_clockid, &ts);
+        txnow = ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+    }
+
+    struct iovec *iovec = iovecs;
+    unsigned int i;
+    for (i = 0; i < nb; i++) {
+        struct msghdr *msghdr = &msgs[i].msg_hdr;
+        memset(msghdr, 0, sizeof(*msghdr));
+        msghdr->msg_name = upipe_udpsink->addrlen ? &upipe_udpsink->addr : NULL;
+        msghdr->msg_namelen = upipe_udpsink->addrlen;
+        msghdr->msg_iov = iovec;
+        msghdr->msg_iovlen = iovec_counts[i];
+
+        if (upipe_udpsink->raw) {
+            size_t payload_len = 0;
+            uref_block_size(urefs[i], &payload_len);
+            memcpy(raw_headers[i], upipe_udpsink->raw_header, RAW_HEADER_SIZE);
+            udp_raw_set_len(raw_headers[i], payload_len);
+            iovec->iov_base = raw_headers[i];
+            iovec->iov_len = RAW_HEADER_SIZE;
+            iovec++;
+            msghdr->msg_iovlen++;
+        }
+
+        if (unlikely(!ubase_check(uref_block_iovec_read(urefs[i], 0, -1,
+                                                        iovec)))) {
+            upipe_warn(upipe, "cannot read ubuf buffer");
+            iovec_counts[i] = 0;
+            msghdr->msg_iovlen = 0;
+        }
+        iovec += iovec_counts[i];
+
+#if defined(SO_TXTIME)
+        if (upipe_udpsink->txtime_clockid != -1) {
+            uint64_t txtime = txnow;
+            if (systimes[i] != UINT64_MAX && now != UINT64_MAX &&
+                systimes[i] > now)
+                txtime += (systimes[i] - now) * UINT64_C(1000) /
+                          (UCLOCK_FREQ / UINT64_C(1000000));
+            msghdr->msg_control = controls[i].buf;
+            msghdr->msg_controllen = sizeof(controls[i].buf);
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(msghdr);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_TXTIME;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+            memcpy(CMSG_DATA(cmsg), &txtime, sizeof(uint64_t));
+        }
+#endif
+        msgs[i].msg_len = 0;
+    }
+
+    unsigned int sent = 0;
+    bool blocked = false;
+    while (sent < nb) {
+        int ret = sendmmsg(upipe_udpsink->fd, msgs + sent, nb - sent, 0);
+        if (likely(ret > 0)) {
+            sent += ret;
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            blocked = true;
+            break;
+        }
+        /* Errors at this point come from ICMP messages such as
+         * "port unreachable", and we do not want to kill the application
+         * with transient errors, so skip the offending datagram. */
+        sent++;
+    }
+
+    iovec = iovecs;
+    for (i = 0; i < nb; i++) {
+        if (upipe_udpsink->raw)
+            iovec++;
+        if (iovec_counts[i])
+            uref_block_iovec_unmap(urefs[i], 0, -1, iovec);
+        iovec += iovec_counts[i];
+        if (i < sent)
+            uref_free(urefs[i]);
+    }
+
+    if (likely(!blocked))
+        return true;
+
+    /* put back the urefs that could not be sent, keeping their order */
+    for (i = nb - 1; i > sent; i--)
+        upipe_udpsink_unshift_input(upipe, urefs[i]);
+    upipe_udpsink_poll(upipe);
+    if (sent == 0)
+        return false;
+    upipe_udpsink_unshift_input(upipe, urefs[sent]);
+    return true;
+}
+#endif
+
 /** @internal @This outputs data to the udp sink.
  *
  * @param upipe description structure of the pipe
@@ -212,16 +399,18 @@ static bool upipe_udpsink_output(struct upipe *upipe, struct uref *uref,
         return true;
     }
 
+    uint64_t now = UINT64_MAX;
+    uint64_t systime = UINT64_MAX;
     if (likely(upipe_udpsink->uclock == NULL))
         goto write_buffer;
 
-    uint64_t systime = 0;
     if (unlikely(!ubase_check(uref_clock_get_cr_sys(uref, &systime)))) {
         upipe_warn(upipe, "received non-dated buffer");
+        systime = UINT64_MAX;
         goto write_buffer;
     }
 
-    uint64_t now = uclock_now(upipe_udpsink->uclock);
+    now = uclock_now(upipe_udpsink->uclock);
     systime += upipe_udpsink->latency;
     if (unlikely(now < systime)) {
         upipe_udpsink_check_upump_mgr(upipe);
@@ -246,6 +435,11 @@ static bool upipe_udpsink_output(struct upipe *upipe, struct uref *uref,
                       upipe_udpsink->latency / (UCLOCK_FREQ / 1000));
 
 write_buffer:
+#ifdef UPIPE_HAVE_SENDMMSG
+    if (upipe_udpsink->window)
+        return upipe_udpsink_output_batch(upipe, uref, now, systime);
+#endif
+
     for ( ; ; ) {
         size_t payload_len = 0;
         if (unlikely(!ubase_check(uref_block_size(uref, &payload_len)))) {
@@ -386,6 +580,70 @@ static int upipe_udpsink_set_flow_def(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This applies the kernel pacing configuration to the socket.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_udpsink_apply_txtime(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    if (upipe_udpsink->fd == -1 || upipe_udpsink->txtime_clockid == -1)
+        return UBASE_ERR_NONE;
+
+#if defined(SO_TXTIME) && defined(__linux__)
+    struct sock_txtime txtime = {
+        .clockid = upipe_udpsink->txtime_clockid,
+        .flags = 0,
+    };
+    if (unlikely(setsockopt(upipe_udpsink->fd, SOL_SOCKET, SO_TXTIME,
+                            &txtime, sizeof(txtime)) == -1)) {
+        upipe_err_va(upipe, "unable to enable kernel pacing (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+    return UBASE_ERR_NONE;
+#else
+    upipe_err(upipe, "kernel pacing is not supported on this system");
+    return UBASE_ERR_UNHANDLED;
+#endif
+}
+
+/** @internal @This sets the window of deadlines of the datagrams sent
+ * together in batched mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param window window in units of the 27 MHz clock, 0 to disable
+ * @return an error code
+ */
+static int _upipe_udpsink_set_window(struct upipe *upipe, uint64_t window)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+#ifndef UPIPE_HAVE_SENDMMSG
+    if (window) {
+        upipe_warn(upipe, "batched mode is not supported on this system");
+        return UBASE_ERR_UNHANDLED;
+    }
+#endif
+    upipe_udpsink->window = window;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the clock used for kernel pacing in batched mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param clockid clock of the txtime socket option, or -1 to disable
+ * @return an error code
+ */
+static int _upipe_udpsink_set_txtime(struct upipe *upipe, int clockid)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    upipe_udpsink->txtime_clockid = clockid;
+    int err = upipe_udpsink_apply_txtime(upipe);
+    if (unlikely(!ubase_check(err)))
+        upipe_udpsink->txtime_clockid = -1;
+    return err;
+}
+
 /** @internal @This returns the uri of the currently opened socket.
  *
  * @param upipe description structure of the pipe
@@ -447,6 +705,8 @@ static int _upipe_udpsink_set_uri(struct upipe *upipe, const char *uri)
         /* Use again the pipe that we previously released. */
         upipe_use(upipe);
     upipe_notice_va(upipe, "opening uri %s", upipe_udpsink->uri);
+    if (unlikely(!ubase_check(upipe_udpsink_apply_txtime(upipe))))
+        upipe_udpsink->txtime_clockid = -1;
     return UBASE_ERR_NONE;
 }
 
@@ -535,6 +795,22 @@ static int _upipe_udpsink_control(struct upipe *upipe,
             memcpy(&upipe_udpsink->addr, s, upipe_udpsink->addrlen);
             return UBASE_ERR_NONE;
         }
+        case UPIPE_UDPSINK_GET_WINDOW: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            uint64_t *window_p = va_arg(args, uint64_t *);
+            *window_p = upipe_udpsink->window;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSINK_SET_WINDOW: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            uint64_t window = va_arg(args, uint64_t);
+            return _upipe_udpsink_set_window(upipe, window);
+        }
+        case UPIPE_UDPSINK_SET_TXTIME: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            int clockid = va_arg(args, int);
+            return _upipe_udpsink_set_txtime(upipe, clockid);
+        }
         case UPIPE_FLUSH:
             return upipe_udpsink_flush(upipe);
         default:
@@ -28,15 +28,21 @@
  * @short Upipe source module for udp sockets
  */
 
+#define _GNU_SOURCE
+
+#include <upipe/config.h>
 #include <upipe/ubase.h>
 #include <upipe/uprobe.h>
 #include <upipe/uclock.h>
+#include <upipe/ulist.h>
 #include <upipe/uref.h>
 #include <upipe/uref_block.h>
 #include <upipe/uref_block_flow.h>
 #include <upipe/uref_clock.h>
 #include <upipe/upump.h>
 #include <upipe/ubuf.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/umem.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
@@ -64,9 +70,15 @@
 #include <errno.h>
 #include <assert.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
 
 /** default size of buffers when unspecified */
 #define UBUF_DEFAULT_SIZE       4096
+/** maximum number of datagrams received per wakeup in batched mode */
+#define UDP_MAX_BATCH           1024
+/** number of buffers provided to the event loop in completion mode */
+#define UDP_RECV_BUFFERS        256
 
 #define UDP_DEFAULT_TTL 0
 #define UDP_DEFAULT_PORT 1234
@@ -74,6 +86,23 @@
 /** @hidden */
 static int upipe_udpsrc_check(struct upipe *upipe, struct uref *flow_format);
 
+#ifdef UPIPE_HAVE_RECVMMSG
+/** @internal @This is a preallocated datagram slot of the batched mode. */
+struct upipe_udpsrc_slot {
+    /** preallocated buffer, or NULL if it was output */
+    struct uref *uref;
+    /** mapped buffer */
+    struct iovec iovec;
+    /** source address */
+    struct sockaddr_storage addr;
+    /** ancillary data */
+    union {
+        struct cmsghdr align;
+        uint8_t buf[CMSG_SPACE(sizeof(struct timespec))];
+    } control;
+};
+#endif
+
 /** @internal @This is the private context of a udp socket source pipe. */
 struct upipe_udpsrc {
     /** refcount management structure */
@@ -122,6 +151,19 @@ struct upipe_udpsrc {
     /** source address (size) */
     socklen_t addrlen;
 
+    /** number of datagrams received per wakeup */
+    unsigned int batch;
+    /** memory allocator of the completion mode, or NULL */
+    struct umem_mgr *umem_mgr;
+#ifdef UPIPE_HAVE_RECVMMSG
+    /** datagram slots of the batched mode */
+    struct upipe_udpsrc_slot *slots;
+    /** message headers of the batched mode */
+    struct mmsghdr *msgs;
+    /** true if the kernel timestamps datagrams */
+    bool timestamps;
+#endif
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -172,6 +214,13 @@ static struct upipe *upipe_udpsrc_alloc(struct upipe_mgr *mgr,
     upipe_udpsrc->fd = -1;
     upipe_udpsrc->uri = NULL;
     upipe_udpsrc->addrlen = 0;
+    upipe_udpsrc->batch = 1;
+    upipe_udpsrc->umem_mgr = NULL;
+#ifdef UPIPE_HAVE_RECVMMSG
+    upipe_udpsrc->slots = NULL;
+    upipe_udpsrc->msgs = NULL;
+    upipe_udpsrc->timestamps = false;
+#endif
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -259,6 +308,344 @@ static void upipe_udpsrc_worker(struct upump *upump)
     upipe_udpsrc_output(upipe, uref, &upipe_udpsrc->upump);
 }
 
+#ifdef UPIPE_HAVE_RECVMMSG
+/** @internal @This releases the datagram slots of the batched mode.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsrc_clean_slots(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (upipe_udpsrc->slots != NULL) {
+        for (unsigned int i = 0; i < upipe_udpsrc->batch; i++)
+            if (upipe_udpsrc->slots[i].uref != NULL)
+                uref_free(upipe_udpsrc->slots[i].uref);
+    }
+    free(upipe_udpsrc->slots);
+    free(upipe_udpsrc->msgs);
+    upipe_udpsrc->slots = NULL;
+    upipe_udpsrc->msgs = NULL;
+}
+
+/** @internal @This enables kernel timestamping on the socket.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsrc_enable_timestamps(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    int on = 1;
+    upipe_udpsrc->timestamps = setsockopt(upipe_udpsrc->fd, SOL_SOCKET,
+                                          SO_TIMESTAMPNS,
+                                          &on, sizeof(on)) == 0;
+    if (!upipe_udpsrc->timestamps)
+        upipe_warn_va(upipe, "unable to enable kernel timestamps (%m)");
+}
+
+/** @internal @This allocates the datagram slots of the batched mode, and
+ * enables kernel timestamping on the socket.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_udpsrc_alloc_slots(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (upipe_udpsrc->slots == NULL) {
+        upipe_udpsrc->slots = calloc(upipe_udpsrc->batch,
+                                     sizeof(struct upipe_udpsrc_slot));
+        upipe_udpsrc->msgs = calloc(upipe_udpsrc->batch,
+                                    sizeof(struct mmsghdr));
+        if (unlikely(upipe_udpsrc->slots == NULL ||
+                     upipe_udpsrc->msgs == NULL)) {
+            upipe_udpsrc_clean_slots(upipe);
+            return UBASE_ERR_ALLOC;
+        }
+    }
+
+    upipe_udpsrc_enable_timestamps(upipe);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This returns the system time at which a datagram was received
+ * by the kernel.
+ *
+ * @param upipe description structure of the pipe
+ * @param msg message header of the datagram
+ * @param systime system time of the wakeup
+ * @param real Epoch-based real time of the wakeup, or UINT64_MAX
+ * @return system time of the datagram
+ */
+static uint64_t upipe_udpsrc_msg_systime(struct upipe *upipe,
+                                         struct msghdr *msg,
+                                         uint64_t systime, uint64_t real)
+{
+    if (real == UINT64_MAX)
+        return systime;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET ||
+            cmsg->cmsg_type != SCM_TIMESTAMPNS)
+            continue;
+
+        struct timespec ts;
+        memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+        uint64_t kernel = ts.tv_sec * UCLOCK_FREQ +
+                          ts.tv_nsec * UCLOCK_FREQ / UINT64_C(1000000000);
+        if (unlikely(kernel > real || real - kernel > systime))
+            return systime;
+        return systime - (real - kernel);
+    }
+    return systime;
+}
+
+/** @internal @This reads a batch of datagrams from the socket and outputs
+ * them, one uref per datagram. It is called when data is available on the
+ * udp socket descriptor, in batched mode.
+ *
+ * @param upump description structure of the read watcher
+ */
+static void upipe_udpsrc_worker_batch(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    struct upipe_udpsrc_slot *slots = upipe_udpsrc->slots;
+    unsigned int batch = upipe_udpsrc->batch;
+    uint64_t systime = 0; /* to keep gcc quiet */
+    uint64_t real = UINT64_MAX;
+    unsigned int i;
+
+    for (i = 0; i < batch; i++) {
+        if (slots[i].uref != NULL)
+            continue;
+        slots[i].uref = uref_block_alloc(upipe_udpsrc->uref_mgr,
+                                         upipe_udpsrc->ubuf_mgr,
+                                         upipe_udpsrc->output_size);
+        if (unlikely(slots[i].uref == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+    }
+
+    for (i = 0; i < batch; i++) {
+        struct upipe_udpsrc_slot *slot = &slots[i];
+        struct msghdr *msg = &upipe_udpsrc->msgs[i].msg_hdr;
+        uint8_t *buffer;
+        int output_size = -1;
+        if (unlikely(!ubase_check(uref_block_write(slot->uref, 0,
+                                                   &output_size,
+                                                   &buffer)))) {
+            while (i-- > 0)
+                uref_block_unmap(slots[i].uref, 0);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        assert(output_size == upipe_udpsrc->output_size);
+
+        slot->iovec.iov_base = buffer;
+        slot->iovec.iov_len = output_size;
+        msg->msg_name = &slot->addr;
+        msg->msg_namelen = sizeof(slot->addr);
+        msg->msg_iov = &slot->iovec;
+        msg->msg_iovlen = 1;
+        msg->msg_control = slot->control.buf;
+        msg->msg_controllen = sizeof(slot->control.buf);
+        msg->msg_flags = 0;
+    }
+
+    int ret = recvmmsg(upipe_udpsrc->fd, upipe_udpsrc->msgs, batch,
+                       MSG_DONTWAIT, NULL);
+    for (i = 0; i < batch; i++)
+        uref_block_unmap(slots[i].uref, 0);
+
+    if (unlikely(ret == -1)) {
+        switch (errno) {
+            case EINTR:
+            case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+            case EWOULDBLOCK:
+#endif
+                /* not an issue, try again later */
+                return;
+            case EBADF:
+            case EINVAL:
+            case EIO:
+            default:
+                break;
+        }
+        upipe_err_va(upipe, "read error from %s (%m)", upipe_udpsrc->uri);
+        upipe_udpsrc_set_upump(upipe, NULL);
+        upipe_throw_source_end(upipe);
+        return;
+    }
+
+    if (unlikely(upipe_udpsrc->uclock != NULL)) {
+        systime = uclock_now(upipe_udpsrc->uclock);
+        if (upipe_udpsrc->timestamps)
+            real = uclock_to_real(upipe_udpsrc->uclock, systime);
+    }
+
+    /* detach the received datagrams first, as outputting may change the
+     * configuration of the pipe */
+    struct uchain urefs;
+    ulist_init(&urefs);
+    bool end = false;
+    for (i = 0; i < ret; i++) {
+        struct upipe_udpsrc_slot *slot = &slots[i];
+        struct msghdr *msg = &upipe_udpsrc->msgs[i].msg_hdr;
+        struct uref *uref = slot->uref;
+        unsigned int len = upipe_udpsrc->msgs[i].msg_len;
+
+        if (msg->msg_namelen != upipe_udpsrc->addrlen ||
+            memcmp(&slot->addr, &upipe_udpsrc->addr, msg->msg_namelen)) {
+            socklen_t addrlen = msg->msg_namelen;
+            upipe_throw(upipe, UPROBE_UDPSRC_NEW_PEER, UPIPE_UDPSRC_SIGNATURE,
+                        &slot->addr, &addrlen);
+            upipe_udpsrc->addrlen = addrlen;
+            memcpy(&upipe_udpsrc->addr, &slot->addr, addrlen);
+        }
+
+        if (unlikely(len == 0)) {
+            if (likely(upipe_udpsrc->uclock == NULL)) {
+                end = true;
+                break;
+            }
+            continue;
+        }
+
+        slot->uref = NULL;
+        if (unlikely(upipe_udpsrc->uclock != NULL))
+            uref_clock_set_cr_sys(uref,
+                    upipe_udpsrc_msg_systime(upipe, msg, systime, real));
+        if (unlikely(len != upipe_udpsrc->output_size))
+            uref_block_resize(uref, 0, len);
+        ulist_add(&urefs, uref_to_uchain(uref));
+    }
+
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&urefs)) != NULL) {
+        struct uref *uref = uref_from_uchain(uchain);
+        if (unlikely(upipe_udpsrc->upump == NULL)) {
+            /* the socket was closed in the meantime */
+            uref_free(uref);
+            continue;
+        }
+        upipe_udpsrc_output(upipe, uref, &upipe_udpsrc->upump);
+    }
+
+    if (unlikely(end && upipe_udpsrc->upump != NULL)) {
+        upipe_notice_va(upipe, "end of udp socket %s", upipe_udpsrc->uri);
+        upipe_udpsrc_set_upump(upipe, NULL);
+        upipe_throw_source_end(upipe);
+    }
+}
+#endif
+
+/** @internal @This outputs a datagram received by the event loop itself, in
+ * completion mode.
+ *
+ * @param upump description structure of the recv pump
+ */
+static void upipe_udpsrc_worker_recv(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    uint64_t systime = 0; /* to keep gcc quiet */
+    uint64_t real = UINT64_MAX;
+    if (unlikely(upipe_udpsrc->uclock != NULL)) {
+        systime = uclock_now(upipe_udpsrc->uclock);
+#ifdef UPIPE_HAVE_RECVMMSG
+        if (upipe_udpsrc->timestamps)
+            real = uclock_to_real(upipe_udpsrc->uclock, systime);
+#endif
+    }
+
+    struct upump_recv recv;
+    if (unlikely(!ubase_check(upump_get_recv(upump, &recv))))
+        return;
+
+    if (unlikely(recv.size < 0)) {
+        if (recv.umem.mgr != NULL)
+            umem_free(&recv.umem);
+        errno = -recv.size;
+        upipe_err_va(upipe, "read error from %s (%m)", upipe_udpsrc->uri);
+        upipe_udpsrc_set_upump(upipe, NULL);
+        upipe_throw_source_end(upipe);
+        return;
+    }
+
+#ifdef UPIPE_HAVE_RECVMMSG
+    /* the ancillary data lives in the buffer, which may be freed below */
+    if (real != UINT64_MAX && recv.control != NULL) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = (void *)recv.control;
+        msg.msg_controllen = recv.controllen;
+        systime = upipe_udpsrc_msg_systime(upipe, &msg, systime, real);
+    }
+#endif
+
+    if (recv.addr != NULL && (recv.addrlen != upipe_udpsrc->addrlen ||
+                              memcmp(recv.addr, &upipe_udpsrc->addr,
+                                     recv.addrlen))) {
+        struct sockaddr_storage addr;
+        socklen_t addrlen = recv.addrlen;
+        memcpy(&addr, recv.addr, addrlen);
+        upipe_throw(upipe, UPROBE_UDPSRC_NEW_PEER, UPIPE_UDPSRC_SIGNATURE,
+                &addr, &addrlen);
+        upipe_udpsrc->addrlen = addrlen;
+        memcpy(&upipe_udpsrc->addr, &addr, addrlen);
+    }
+
+    if (unlikely(recv.size == 0)) {
+        umem_free(&recv.umem);
+        if (likely(upipe_udpsrc->uclock == NULL)) {
+            upipe_notice_va(upipe, "end of udp socket %s", upipe_udpsrc->uri);
+            upipe_udpsrc_set_upump(upipe, NULL);
+            upipe_throw_source_end(upipe);
+        }
+        return;
+    }
+
+    struct ubuf *ubuf = ubuf_block_mem_alloc_from_umem(upipe_udpsrc->ubuf_mgr,
+                                                       &recv.umem, recv.offset,
+                                                       recv.size);
+    if (likely(ubuf != NULL))
+        recv.umem.mgr = NULL;
+    else {
+        /* not a block mem manager, copy the datagram */
+        uint8_t *buffer;
+        int size = -1;
+        ubuf = ubuf_block_alloc(upipe_udpsrc->ubuf_mgr, recv.size);
+        if (ubuf != NULL &&
+            ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer))) {
+            memcpy(buffer, umem_buffer(&recv.umem) + recv.offset, size);
+            ubuf_block_unmap(ubuf, 0);
+        } else if (ubuf != NULL) {
+            ubuf_free(ubuf);
+            ubuf = NULL;
+        }
+        umem_free(&recv.umem);
+    }
+
+    struct uref *uref = NULL;
+    if (likely(ubuf != NULL)) {
+        uref = uref_alloc(upipe_udpsrc->uref_mgr);
+        if (unlikely(uref == NULL))
+            ubuf_free(ubuf);
+    }
+    if (unlikely(uref == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    uref_attach_ubuf(uref, ubuf);
+
+    if (unlikely(upipe_udpsrc->uclock != NULL))
+        uref_clock_set_cr_sys(uref, systime);
+    upipe_udpsrc_output(upipe, uref, &upipe_udpsrc->upump);
+}
+
 /** @internal @This checks if the pump may be allocated.
  *
  * @param upipe description structure of the pipe
@@ -297,10 +684,41 @@ static int upipe_udpsrc_check(struct upipe *upipe, struct uref *flow_format)
             != NULL)
         return UBASE_ERR_NONE;
 
+    if (upipe_udpsrc->fd != -1 && upipe_udpsrc->upump == NULL &&
+        upipe_udpsrc->umem_mgr != NULL) {
+        /* not all upump managers implement completion-based pumps */
+        struct upump *upump;
+        upump = upump_alloc_fd_recv(upipe_udpsrc->upump_mgr,
+                                    upipe_udpsrc_worker_recv, upipe,
+                                    upipe->refcount, upipe_udpsrc->fd,
+                                    upipe_udpsrc->umem_mgr,
+                                    upipe_udpsrc->output_size,
+                                    UDP_RECV_BUFFERS);
+        if (upump != NULL) {
+#ifdef UPIPE_HAVE_RECVMMSG
+            upipe_udpsrc_enable_timestamps(upipe);
+#endif
+            upipe_udpsrc_set_upump(upipe, upump);
+            upump_start(upump);
+        }
+    }
+
     if (upipe_udpsrc->fd != -1 && upipe_udpsrc->upump == NULL) {
+        upump_cb worker = upipe_udpsrc_worker;
+#ifdef UPIPE_HAVE_RECVMMSG
+        if (upipe_udpsrc->batch > 1) {
+            int err = upipe_udpsrc_alloc_slots(upipe);
+            if (unlikely(!ubase_check(err))) {
+                upipe_throw_fatal(upipe, err);
+                return err;
+            }
+            worker = upipe_udpsrc_worker_batch;
+        }
+#endif
+
         struct upump *upump;
         upump = upump_alloc_fd_read(upipe_udpsrc->upump_mgr,
-                                    upipe_udpsrc_worker, upipe, upipe->refcount,
+                                    worker, upipe, upipe->refcount,
                                     upipe_udpsrc->fd);
         if (unlikely(upump == NULL)) {
             upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
@@ -366,6 +784,33 @@ static int upipe_udpsrc_set_uri(struct upipe *upipe, const char *uri)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the number of datagrams received per wakeup.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch number of datagrams, 1 to disable batched mode
+ * @return an error code
+ */
+static int _upipe_udpsrc_set_batch(struct upipe *upipe, unsigned int batch)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (unlikely(batch == 0 || batch > UDP_MAX_BATCH))
+        return UBASE_ERR_INVALID;
+#ifndef UPIPE_HAVE_RECVMMSG
+    if (batch > 1) {
+        upipe_warn(upipe, "batched mode is not supported on this system");
+        return UBASE_ERR_UNHANDLED;
+    }
+#else
+    if (batch == upipe_udpsrc->batch)
+        return UBASE_ERR_NONE;
+
+    upipe_udpsrc_set_upump(upipe, NULL);
+    upipe_udpsrc_clean_slots(upipe);
+#endif
+    upipe_udpsrc->batch = batch;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a udp socket source pipe.
  *
  * @param upipe description structure of the pipe
@@ -406,6 +851,10 @@ static int _upipe_udpsrc_control(struct upipe *upipe,
         }
         case UPIPE_SET_OUTPUT_SIZE: {
             unsigned int output_size = va_arg(args, unsigned int);
+#ifdef UPIPE_HAVE_RECVMMSG
+            upipe_udpsrc_set_upump(upipe, NULL);
+            upipe_udpsrc_clean_slots(upipe);
+#endif
             return upipe_udpsrc_set_output_size(upipe, output_size);
         }
 
@@ -429,6 +878,25 @@ static int _upipe_udpsrc_control(struct upipe *upipe,
             upipe_udpsrc->fd = va_arg(args, int );
             return UBASE_ERR_NONE;
         }
+        case UPIPE_UDPSRC_GET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            unsigned int *batch_p = va_arg(args, unsigned int *);
+            *batch_p = upipe_udpsrc->batch;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSRC_SET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            unsigned int batch = va_arg(args, unsigned int);
+            return _upipe_udpsrc_set_batch(upipe, batch);
+        }
+        case UPIPE_UDPSRC_SET_UMEM_MGR: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            struct umem_mgr *umem_mgr = va_arg(args, struct umem_mgr *);
+            upipe_udpsrc_set_upump(upipe, NULL);
+            umem_mgr_release(upipe_udpsrc->umem_mgr);
+            upipe_udpsrc->umem_mgr = umem_mgr_use(umem_mgr);
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -466,6 +934,10 @@ static void upipe_udpsrc_free(struct upipe *upipe)
     upipe_throw_dead(upipe);
 
     free(upipe_udpsrc->uri);
+#ifdef UPIPE_HAVE_RECVMMSG
+    upipe_udpsrc_clean_slots(upipe);
+#endif
+    umem_mgr_release(upipe_udpsrc->umem_mgr);
     upipe_udpsrc_clean_output_size(upipe);
     upipe_udpsrc_clean_uclock(upipe);
     upipe_udpsrc_clean_upump(upipe);
@@ -227,7 +227,8 @@ static struct upipe *_upipe_wlin_alloc(struct upipe_mgr *mgr,
     struct upipe *out_qsrc = upipe_qsrc_alloc(wlin_mgr->qsrc_mgr,
             uprobe_pfx_alloc(uprobe_use(&upipe_wlin->out_qsrc_probe),
                              UPROBE_LOG_VERBOSE, "out_qsrc"),
-            out_queue_length > UINT8_MAX ? UINT8_MAX : out_queue_length);
+            out_queue_length > UQUEUE_MAX_LENGTH ?
+            UQUEUE_MAX_LENGTH : out_queue_length);
     if (unlikely(out_qsrc == NULL))
         goto upipe_wlin_alloc_err3;
 
@@ -239,8 +240,9 @@ static struct upipe *_upipe_wlin_alloc(struct upipe_mgr *mgr,
         upipe_release(out_qsrc);
         goto upipe_wlin_alloc_err3;
     }
-    if (out_queue_length > UINT8_MAX)
-        upipe_set_max_length(out_qsink, out_queue_length - UINT8_MAX);
+    if (out_queue_length > UQUEUE_MAX_LENGTH)
+        upipe_set_max_length(out_qsink,
+                             out_queue_length - UQUEUE_MAX_LENGTH);
 
     upipe_attach_upump_mgr(out_qsrc);
     ulist_add(&upipe_wlin->upump_mgr_pipes, upipe_to_uchain(out_qsrc));
@@ -292,7 +294,8 @@ static struct upipe *_upipe_wlin_alloc(struct upipe_mgr *mgr,
             uprobe_pfx_alloc(
                 uprobe_use(&upipe_wlin->in_qsrc_probe),
                 UPROBE_LOG_VERBOSE, "in_qsrc"),
-            in_queue_length > UINT8_MAX ? UINT8_MAX : in_queue_length);
+            in_queue_length > UQUEUE_MAX_LENGTH ?
+            UQUEUE_MAX_LENGTH : in_queue_length);
     if (unlikely(in_qsrc == NULL))
         goto upipe_wlin_alloc_err4;
     uprobe_release(uprobe_remote);
@@ -306,9 +309,9 @@ static struct upipe *_upipe_wlin_alloc(struct upipe_mgr *mgr,
         goto upipe_wlin_alloc_err4;
     }
     upipe_wlin_store_bin_input(upipe, in_qsink);
-    if (in_queue_length > UINT8_MAX)
+    if (in_queue_length > UQUEUE_MAX_LENGTH)
         upipe_set_max_length(upipe_wlin->in_qsink,
-                                  in_queue_length - UINT8_MAX);
+                                  in_queue_length - UQUEUE_MAX_LENGTH);
 
     struct upipe *in_qsrc_xfer = upipe_xfer_alloc(wlin_mgr->xfer_mgr,
             uprobe_pfx_alloc(uprobe_use(&upipe_wlin->proxy_probe),
@@ -236,7 +236,8 @@ static struct upipe *_upipe_wsink_alloc(struct upipe_mgr *mgr,
             uprobe_pfx_alloc(
                 uprobe_use(&upipe_wsink->in_qsrc_probe),
                 UPROBE_LOG_VERBOSE, "in_qsrc"),
-            queue_length > UINT8_MAX ? UINT8_MAX : queue_length);
+            queue_length > UQUEUE_MAX_LENGTH ?
+            UQUEUE_MAX_LENGTH : queue_length);
     if (unlikely(in_qsrc == NULL))
         goto upipe_wsink_alloc_err3;
 
@@ -247,8 +248,9 @@ static struct upipe *_upipe_wsink_alloc(struct upipe_mgr *mgr,
     if (unlikely(in_qsink == NULL))
         goto upipe_wsink_alloc_err3;
     upipe_wsink_store_bin_input(upipe, in_qsink);
-    if (queue_length > UINT8_MAX)
-        upipe_set_max_length(upipe_wsink->in_qsink, queue_length - UINT8_MAX);
+    if (queue_length > UQUEUE_MAX_LENGTH)
+        upipe_set_max_length(upipe_wsink->in_qsink,
+                             queue_length - UQUEUE_MAX_LENGTH);
 
     struct upipe *in_qsrc_xfer = upipe_xfer_alloc(wsink_mgr->xfer_mgr,
             uprobe_pfx_alloc(uprobe_use(&upipe_wsink->proxy_probe),
@@ -194,7 +194,8 @@ static struct upipe *_upipe_wsrc_alloc(struct upipe_mgr *mgr,
     struct upipe *out_qsrc = upipe_qsrc_alloc(wsrc_mgr->qsrc_mgr,
             uprobe_pfx_alloc(uprobe_use(&upipe_wsrc->qsrc_probe),
                              UPROBE_LOG_VERBOSE, "out_qsrc"),
-            queue_length > UINT8_MAX ? UINT8_MAX : queue_length);
+            queue_length > UQUEUE_MAX_LENGTH ?
+            UQUEUE_MAX_LENGTH : queue_length);
     if (unlikely(out_qsrc == NULL))
         goto upipe_wsrc_alloc_err3;
 
@@ -206,8 +207,8 @@ static struct upipe *_upipe_wsrc_alloc(struct upipe_mgr *mgr,
         upipe_release(out_qsrc);
         goto upipe_wsrc_alloc_err3;
     }
-    if (queue_length > UINT8_MAX)
-        upipe_set_max_length(out_qsink, queue_length - UINT8_MAX);
+    if (queue_length > UQUEUE_MAX_LENGTH)
+        upipe_set_max_length(out_qsink, queue_length - UQUEUE_MAX_LENGTH);
 
     upipe_attach_upump_mgr(out_qsrc);
     ulist_add(&upipe_wsrc->upump_mgr_pipes, upipe_to_uchain(out_qsrc));
@@ -37,6 +37,8 @@
 #include <upipe/upipe.h>
 #include <upipe/uref_flow.h>
 #include <upipe/uref_dump.h>
+#include <upipe/uatomic.h>
+#include <upipe/uslice.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
 #include <upipe/upipe_helper_flow.h>
@@ -57,8 +59,14 @@
 #include <assert.h>
 
 #include <libavutil/opt.h>
+#include <libavutil/frame.h>
 #include <libswscale/swscale.h>
 
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+/** @hidden sws_receive_slice() allows to convert arbitrary output slices */
+#define UPIPE_SWS_SLICES
+#endif
+
 /** @hidden */
 static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
                              struct upump **upump_p);
@@ -103,6 +111,12 @@ struct upipe_sws {
     int flags;
     /** swscale image conversion context [0] for progressive, [1,2] interlaced */
     struct SwsContext *convert_ctx[3];
+    /** number of slices converted in parallel */
+    unsigned int threads;
+    /** pool of threads, or NULL */
+    struct uslice_pool *pool;
+    /** conversion contexts of slices 1 to threads - 1 */
+    struct SwsContext *(*slice_ctx)[3];
     /** input pixel format */
     enum AVPixelFormat input_pix_fmt;
     /** requested output pixel format */
@@ -163,6 +177,260 @@ static int upipe_sws_convert_color(struct upipe *upipe, struct uref *flow_def)
     return colorspace;
 }
 
+/** @internal @This updates a set of conversion contexts for the given
+ * picture sizes.
+ *
+ * @param upipe description structure of the pipe
+ * @param ctx contexts to update, [0] for progressive, [1,2] interlaced
+ * @param input_hsize horizontal size of the input picture
+ * @param input_vsize vertical size of the input picture
+ * @param output_hsize horizontal size of the output picture
+ * @param output_vsize vertical size of the output picture
+ * @return an error code
+ */
+static int upipe_sws_update_ctx(struct upipe *upipe, struct SwsContext *ctx[3],
+                                size_t input_hsize, size_t input_vsize,
+                                uint64_t output_hsize, uint64_t output_vsize)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    for (int i = 0; i < 3; i++) {
+        ctx[i] = sws_getCachedContext(ctx[i],
+                    input_hsize, input_vsize >> !!i, upipe_sws->input_pix_fmt,
+                    output_hsize, output_vsize >> !!i,
+                    upipe_sws->output_pix_fmt,
+                    upipe_sws->flags, NULL, NULL, NULL);
+
+        if (unlikely(ctx[i] == NULL)) {
+            upipe_err(upipe, "sws_getContext failed");
+            return UBASE_ERR_EXTERNAL;
+        }
+
+        if (upipe_sws->colorspace_invalid)
+            continue;
+
+        int in_full, out_full, brightness, contrast, saturation;
+        const int *inv_table, *table;
+
+        if (unlikely(sws_getColorspaceDetails(ctx[i],
+                        (int **)&inv_table, &in_full, (int **)&table, &out_full,
+                        &brightness, &contrast, &saturation) < 0)) {
+            upipe_warn(upipe, "unable to set color space data");
+            upipe_sws->colorspace_invalid = true;
+            continue;
+        }
+
+        if (upipe_sws->input_colorspace != -1)
+            inv_table = sws_getCoefficients(upipe_sws->input_colorspace);
+        if (upipe_sws->input_color_range != -1)
+            in_full = upipe_sws->input_color_range;
+        if (upipe_sws->output_colorspace != -1)
+            table = sws_getCoefficients(upipe_sws->output_colorspace);
+        if (upipe_sws->output_color_range != -1)
+            out_full = upipe_sws->output_color_range;
+
+        if (unlikely(sws_setColorspaceDetails(ctx[i],
+                        inv_table, in_full, table, out_full,
+                        brightness, contrast, saturation) < 0)) {
+            upipe_warn(upipe, "unable to set color space data");
+            upipe_sws->colorspace_invalid = true;
+        }
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the vertical chroma positions of a set of
+ * conversion contexts.
+ *
+ * @param upipe description structure of the pipe
+ * @param ctx contexts to set, [0] for progressive, [1,2] interlaced
+ */
+static void upipe_sws_set_chr_pos(struct upipe *upipe,
+                                  struct SwsContext *ctx[3])
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    if (upipe_sws->input_pix_fmt == AV_PIX_FMT_YUV420P) {
+        av_opt_set_int(ctx[0], "src_v_chr_pos", 128, 0);
+        av_opt_set_int(ctx[1], "src_v_chr_pos", 64, 0);
+        av_opt_set_int(ctx[2], "src_v_chr_pos", 192, 0);
+    }
+
+    if (upipe_sws->output_pix_fmt == AV_PIX_FMT_YUV420P) {
+        av_opt_set_int(ctx[0], "dst_v_chr_pos", 128, 0);
+        av_opt_set_int(ctx[1], "dst_v_chr_pos", 64, 0);
+        av_opt_set_int(ctx[2], "dst_v_chr_pos", 192, 0);
+    }
+}
+
+#ifdef UPIPE_SWS_SLICES
+/** @This describes a picture being converted in slices. */
+struct upipe_sws_job {
+    /** pointer to the pipe */
+    struct upipe_sws *upipe_sws;
+    /** number of fields (1 for progressive pictures) */
+    unsigned int nb_fields;
+    /** input frame of each field */
+    AVFrame *src[2];
+    /** output frame of each field */
+    AVFrame *dst[2];
+    /** number of slices which failed */
+    uatomic_uint32_t errors;
+};
+
+/** @internal @This is called when the last reference to a wrapped plane
+ * is released. The plane belongs to a ubuf, so there is nothing to do.
+ *
+ * @param opaque unused
+ * @param data pointer to the plane
+ */
+static void upipe_sws_wrap_free(void *opaque, uint8_t *data)
+{
+}
+
+/** @internal @This wraps mapped planes into an AVFrame, without copying.
+ *
+ * @param planes pointers to the planes
+ * @param strides strides of the planes
+ * @param hsize horizontal size of the picture
+ * @param vsize vertical size of the picture
+ * @param pix_fmt pixel format of the picture
+ * @return pointer to the frame, or NULL in case of allocation error
+ */
+static AVFrame *upipe_sws_wrap(uint8_t *const *planes, const int *strides,
+                               int hsize, int vsize,
+                               enum AVPixelFormat pix_fmt)
+{
+    AVFrame *frame = av_frame_alloc();
+    if (unlikely(frame == NULL))
+        return NULL;
+
+    /* a buffer is needed for sws_frame_start() not to copy the planes */
+    frame->buf[0] = av_buffer_create(planes[0], (size_t)strides[0] * vsize,
+                                     upipe_sws_wrap_free, NULL, 0);
+    if (unlikely(frame->buf[0] == NULL)) {
+        av_frame_free(&frame);
+        return NULL;
+    }
+    for (int i = 0; i < UPIPE_AV_MAX_PLANES && planes[i] != NULL; i++) {
+        frame->data[i] = planes[i];
+        frame->linesize[i] = strides[i];
+    }
+    frame->width = hsize;
+    frame->height = vsize;
+    frame->format = pix_fmt;
+    return frame;
+}
+
+/** @internal @This converts a slice of the output picture. Each slice uses
+ * its own set of conversion contexts.
+ *
+ * @param opaque pointer to the job
+ * @param slice index of the slice
+ * @param nb_slices number of slices
+ */
+static void upipe_sws_work(void *opaque, unsigned int slice,
+                           unsigned int nb_slices)
+{
+    struct upipe_sws_job *job = opaque;
+    struct upipe_sws *upipe_sws = job->upipe_sws;
+    struct SwsContext **ctx = slice ? upipe_sws->slice_ctx[slice - 1] :
+                                      upipe_sws->convert_ctx;
+
+    for (unsigned int field = 0; field < job->nb_fields; field++) {
+        struct SwsContext *c = ctx[job->nb_fields == 1 ? 0 : 1 + field];
+        AVFrame *dst = job->dst[field];
+        /* slices must start on a chroma line */
+        unsigned int align = sws_receive_slice_alignment(c);
+        unsigned int start = dst->height * slice / nb_slices / align * align;
+        unsigned int end = slice + 1 == nb_slices ? dst->height :
+            dst->height * (slice + 1) / nb_slices / align * align;
+        if (end <= start)
+            continue;
+
+        if (unlikely(sws_frame_start(c, dst, job->src[field]) < 0 ||
+                     sws_send_slice(c, 0, job->src[field]->height) < 0 ||
+                     sws_receive_slice(c, start, end - start) < 0))
+            uatomic_fetch_add(&job->errors, 1);
+        sws_frame_end(c);
+    }
+}
+#endif
+
+/** @internal @This converts a picture in slices, on the thread pool.
+ *
+ * @param upipe description structure of the pipe
+ * @param progressive true if the picture is progressive
+ * @param input_planes mapped input planes
+ * @param input_strides strides of the input planes
+ * @param input_hsize horizontal size of the input picture
+ * @param input_vsize vertical size of the input picture
+ * @param output_planes mapped output planes
+ * @param output_strides strides of the output planes
+ * @param output_hsize horizontal size of the output picture
+ * @param output_vsize vertical size of the output picture
+ * @return a positive value on success, 0 or a negative value otherwise
+ */
+static int upipe_sws_scale_slices(struct upipe *upipe, bool progressive,
+                                  const uint8_t **input_planes,
+                                  const int *input_strides,
+                                  size_t input_hsize, size_t input_vsize,
+                                  uint8_t **output_planes,
+                                  const int *output_strides,
+                                  uint64_t output_hsize, uint64_t output_vsize)
+{
+#ifdef UPIPE_SWS_SLICES
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    struct upipe_sws_job job;
+    job.upipe_sws = upipe_sws;
+    job.nb_fields = progressive ? 1 : 2;
+    job.src[0] = job.src[1] = job.dst[0] = job.dst[1] = NULL;
+    uatomic_init(&job.errors, 0);
+
+    int ret = 1;
+    for (unsigned int field = 0; field < job.nb_fields; field++) {
+        uint8_t *src_planes[UPIPE_AV_MAX_PLANES + 1];
+        uint8_t *dst_planes[UPIPE_AV_MAX_PLANES + 1];
+        for (int i = 0; i < UPIPE_AV_MAX_PLANES; i++) {
+            src_planes[i] = input_planes[i] == NULL ? NULL :
+                (uint8_t *)input_planes[i] + field * (input_strides[i] >> 1);
+            dst_planes[i] = output_planes[i] == NULL ? NULL :
+                output_planes[i] + field * (output_strides[i] >> 1);
+        }
+        src_planes[UPIPE_AV_MAX_PLANES] = dst_planes[UPIPE_AV_MAX_PLANES] =
+            NULL;
+        /* the first field gets the extra line of odd pictures, as in the
+         * unsliced path */
+        job.src[field] = upipe_sws_wrap(src_planes, input_strides,
+                                        input_hsize,
+                                        progressive ? input_vsize :
+                                        (input_vsize + !field) / 2,
+                                        upipe_sws->input_pix_fmt);
+        job.dst[field] = upipe_sws_wrap(dst_planes, output_strides,
+                                        output_hsize,
+                                        output_vsize >> !progressive,
+                                        upipe_sws->output_pix_fmt);
+        if (unlikely(job.src[field] == NULL || job.dst[field] == NULL)) {
+            ret = 0;
+            goto upipe_sws_scale_slices_err;
+        }
+    }
+
+    uslice_pool_run(upipe_sws->pool, upipe_sws->threads, upipe_sws_work,
+                    &job);
+    if (uatomic_load(&job.errors))
+        ret = 0;
+
+upipe_sws_scale_slices_err:
+    for (unsigned int field = 0; field < job.nb_fields; field++) {
+        av_frame_free(&job.src[field]);
+        av_frame_free(&job.dst[field]);
+    }
+    uatomic_clean(&job.errors);
+    return ret;
+#else
+    return 0;
+#endif
+}
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -205,55 +473,27 @@ static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
         output_vsize = input_vsize;
     }
 
-    int i;
-    for (i = 0; i < 3; i++) {
-        upipe_sws->convert_ctx[i] = sws_getCachedContext(upipe_sws->convert_ctx[i],
-                    input_hsize, input_vsize >> !!i, upipe_sws->input_pix_fmt,
-                    output_hsize, output_vsize >> !!i, upipe_sws->output_pix_fmt,
-                    upipe_sws->flags, NULL, NULL, NULL);
-
-        if (unlikely(upipe_sws->convert_ctx[i] == NULL)) {
-            upipe_err(upipe, "sws_getContext failed");
+    if (unlikely(!ubase_check(upipe_sws_update_ctx(upipe,
+                        upipe_sws->convert_ctx, input_hsize, input_vsize,
+                        output_hsize, output_vsize)))) {
+        uref_free(uref);
+        return true;
+    }
+    for (unsigned int j = 1; j < upipe_sws->threads; j++)
+        if (unlikely(!ubase_check(upipe_sws_update_ctx(upipe,
+                            upipe_sws->slice_ctx[j - 1],
+                            input_hsize, input_vsize,
+                            output_hsize, output_vsize)))) {
             uref_free(uref);
             return true;
         }
 
-        if (upipe_sws->colorspace_invalid)
-            continue;
-
-        int in_full, out_full, brightness, contrast, saturation;
-        const int *inv_table, *table;
-
-        if (unlikely(sws_getColorspaceDetails(upipe_sws->convert_ctx[i],
-                        (int **)&inv_table, &in_full, (int **)&table, &out_full,
-                        &brightness, &contrast, &saturation) < 0)) {
-            upipe_warn(upipe, "unable to set color space data");
-            upipe_sws->colorspace_invalid = true;
-            continue;
-        }
-
-        if (upipe_sws->input_colorspace != -1)
-            inv_table = sws_getCoefficients(upipe_sws->input_colorspace);
-        if (upipe_sws->input_color_range != -1)
-            in_full = upipe_sws->input_color_range;
-        if (upipe_sws->output_colorspace != -1)
-            table = sws_getCoefficients(upipe_sws->output_colorspace);
-        if (upipe_sws->output_color_range != -1)
-            out_full = upipe_sws->output_color_range;
-
-        if (unlikely(sws_setColorspaceDetails(upipe_sws->convert_ctx[i],
-                        inv_table, in_full, table, out_full,
-                        brightness, contrast, saturation) < 0)) {
-            upipe_warn(upipe, "unable to set color space data");
-            upipe_sws->colorspace_invalid = true;
-        }
-    }
-
     upipe_verbose_va(upipe, "%s -> %s",
         av_get_pix_fmt_name(upipe_sws->input_pix_fmt),
         av_get_pix_fmt_name(upipe_sws->output_pix_fmt));
 
     /* map input */
+    int i;
     const uint8_t *input_planes[UPIPE_AV_MAX_PLANES + 1];
     int input_strides[UPIPE_AV_MAX_PLANES + 1];
     for (i = 0; i < UPIPE_AV_MAX_PLANES &&
@@ -323,7 +563,14 @@ static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
 
     /* fire ! */
     int ret = 0, ret2 = 1;
-    if (progressive) {
+    if (upipe_sws->threads > 1) {
+        ret = upipe_sws_scale_slices(upipe, progressive,
+                                     input_planes, input_strides,
+                                     input_hsize, input_vsize,
+                                     output_planes, output_strides,
+                                     output_hsize, output_vsize);
+    }
+    else if (progressive) {
         ret = sws_scale(upipe_sws->convert_ctx[0],
                         input_planes, input_strides, 0, input_vsize,
                         output_planes, output_strides);
@@ -517,17 +764,9 @@ static int upipe_sws_set_flow_def(struct upipe *upipe, struct uref *flow_def)
         }
     }
 
-    if (upipe_sws->input_pix_fmt == AV_PIX_FMT_YUV420P) {
-        av_opt_set_int(upipe_sws->convert_ctx[0], "src_v_chr_pos", 128, 0);
-        av_opt_set_int(upipe_sws->convert_ctx[1], "src_v_chr_pos", 64, 0);
-        av_opt_set_int(upipe_sws->convert_ctx[2], "src_v_chr_pos", 192, 0);
-    }
-
-    if (upipe_sws->output_pix_fmt == AV_PIX_FMT_YUV420P) {
-        av_opt_set_int(upipe_sws->convert_ctx[0], "dst_v_chr_pos", 128, 0);
-        av_opt_set_int(upipe_sws->convert_ctx[1], "dst_v_chr_pos", 64, 0);
-        av_opt_set_int(upipe_sws->convert_ctx[2], "dst_v_chr_pos", 192, 0);
-    }
+    upipe_sws_set_chr_pos(upipe, upipe_sws->convert_ctx);
+    for (unsigned int j = 1; j < upipe_sws->threads; j++)
+        upipe_sws_set_chr_pos(upipe, upipe_sws->slice_ctx[j - 1]);
     upipe_sws->colorspace_invalid = false;
 
     upipe_input(upipe, flow_def, NULL);
@@ -561,6 +800,74 @@ static int _upipe_sws_set_flags(struct upipe *upipe, int flags)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This frees the conversion contexts of the slices.
+ *
+ * @param slice_ctx array of contexts
+ * @param nb number of elements of the array
+ */
+static void upipe_sws_free_slice_ctx(struct SwsContext *(*slice_ctx)[3],
+                                     unsigned int nb)
+{
+    if (slice_ctx == NULL)
+        return;
+    for (unsigned int j = 0; j < nb; j++)
+        for (int i = 0; i < 3; i++)
+            if (likely(slice_ctx[j][i]))
+                sws_freeContext(slice_ctx[j][i]);
+    free(slice_ctx);
+}
+
+/** @internal @This sets the number of threads converting a picture.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the pipe thread
+ * @return an error code
+ */
+static int _upipe_sws_set_threads(struct upipe *upipe, unsigned int threads)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    if (!threads)
+        return UBASE_ERR_INVALID;
+    if (threads == upipe_sws->threads)
+        return UBASE_ERR_NONE;
+#ifndef UPIPE_SWS_SLICES
+    if (threads > 1) {
+        upipe_warn(upipe, "sliced conversion requires libswscale 6.1");
+        return UBASE_ERR_UNHANDLED;
+    }
+#endif
+
+    struct uslice_pool *pool = NULL;
+    struct SwsContext *(*slice_ctx)[3] = NULL;
+    if (threads > 1) {
+        slice_ctx = calloc(threads - 1, sizeof(*slice_ctx));
+        UBASE_ALLOC_RETURN(slice_ctx);
+        for (unsigned int j = 0; j < threads - 1; j++)
+            for (int i = 0; i < 3; i++)
+                if (unlikely((slice_ctx[j][i] = sws_alloc_context()) == NULL)) {
+                    upipe_sws_free_slice_ctx(slice_ctx, threads - 1);
+                    return UBASE_ERR_ALLOC;
+                }
+
+        pool = uslice_pool_alloc(threads - 1);
+        if (unlikely(pool == NULL)) {
+            upipe_err_va(upipe, "unable to start %u threads", threads);
+            upipe_sws_free_slice_ctx(slice_ctx, threads - 1);
+            return UBASE_ERR_EXTERNAL;
+        }
+        for (unsigned int j = 0; j < threads - 1; j++)
+            upipe_sws_set_chr_pos(upipe, slice_ctx[j]);
+    }
+
+    uslice_pool_free(upipe_sws->pool);
+    upipe_sws_free_slice_ctx(upipe_sws->slice_ctx, upipe_sws->threads - 1);
+    upipe_sws->pool = pool;
+    upipe_sws->slice_ctx = slice_ctx;
+    upipe_sws->threads = threads;
+    upipe_dbg_va(upipe, "converting with %u threads", threads);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a file source pipe, and
  * checks the status of the pipe afterwards.
  *
@@ -616,6 +923,17 @@ static int upipe_sws_control(struct upipe *upipe, int command, va_list args)
             int flags = va_arg(args, int);
             return _upipe_sws_set_flags(upipe, flags);
         }
+        case UPIPE_SWS_GET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SWS_SIGNATURE)
+            unsigned int *threads_p = va_arg(args, unsigned int *);
+            *threads_p = upipe_sws_from_upipe(upipe)->threads;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_SWS_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SWS_SIGNATURE)
+            unsigned int threads = va_arg(args, unsigned int);
+            return _upipe_sws_set_threads(upipe, threads);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -655,6 +973,10 @@ static struct upipe *upipe_sws_alloc(struct upipe_mgr *mgr,
     upipe_sws_init_flow_def(upipe);
     upipe_sws_init_input(upipe);
     upipe_sws->colorspace_invalid = false;
+    upipe_sws->input_pix_fmt = AV_PIX_FMT_NONE;
+    upipe_sws->threads = 1;
+    upipe_sws->pool = NULL;
+    upipe_sws->slice_ctx = NULL;
 
     memset(upipe_sws->convert_ctx, 0, sizeof(upipe_sws->convert_ctx));
     for (int i = 0; i < 3; i++) {
@@ -698,6 +1020,8 @@ static void upipe_sws_free(struct upipe *upipe)
             sws_freeContext(upipe_sws->convert_ctx[i]);
         upipe_sws->convert_ctx[i] = NULL;
     }
+    uslice_pool_free(upipe_sws->pool);
+    upipe_sws_free_slice_ctx(upipe_sws->slice_ctx, upipe_sws->threads - 1);
 
     upipe_throw_dead(upipe);
     upipe_sws_clean_input(upipe);
@@ -0,0 +1,922 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe swscale module producing several renditions in one pass
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/uprobe.h>
+#include <upipe/uref.h>
+#include <upipe/ubuf.h>
+#include <upipe/upipe.h>
+#include <upipe/uref_attr.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_pic.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/uref_dump.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_flow.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_subpipe.h>
+#include <upipe/upipe_helper_ubuf_mgr.h>
+#include <upipe-swscale/upipe_sws_ladder.h>
+#include <upipe-av/upipe_av_pixfmt.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+
+/** default swscale flags */
+#define UPIPE_SWS_LADDER_FLAGS \
+    (SWS_FULL_CHR_H_INP | SWS_ACCURATE_RND | SWS_LANCZOS)
+
+/** @This describes a mapped picture. */
+struct upipe_sws_ladder_pic {
+    /** pixel format */
+    enum AVPixelFormat pix_fmt;
+    /** horizontal size */
+    size_t hsize;
+    /** vertical size */
+    size_t vsize;
+    /** color space, or -1 */
+    int colorspace;
+    /** color range, or -1 */
+    int color_range;
+    /** mapped planes */
+    uint8_t *planes[UPIPE_AV_MAX_PLANES + 1];
+    /** strides of the planes (doubled for interlaced pictures) */
+    int strides[UPIPE_AV_MAX_PLANES + 1];
+};
+
+/** @internal @This is the private context of a ladder pipe. */
+struct upipe_sws_ladder {
+    /** real refcount management structure */
+    struct urefcount urefcount_real;
+    /** refcount management structure exported to the public structure */
+    struct urefcount urefcount;
+
+    /** list of output subpipes */
+    struct uchain outputs;
+    /** input flow definition packet */
+    struct uref *flow_def;
+    /** input pixel format */
+    enum AVPixelFormat input_pix_fmt;
+    /** input chroma map */
+    const char *input_chroma_map[UPIPE_AV_MAX_PLANES];
+    /** input color space */
+    int input_colorspace;
+    /** input color range */
+    int input_color_range;
+
+    /** manager to create output subpipes */
+    struct upipe_mgr sub_mgr;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_sws_ladder, upipe, UPIPE_SWS_LADDER_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_sws_ladder, urefcount, upipe_sws_ladder_no_input)
+UPIPE_HELPER_VOID(upipe_sws_ladder)
+
+UBASE_FROM_TO(upipe_sws_ladder, urefcount, urefcount_real, urefcount_real)
+
+/** @hidden */
+static void upipe_sws_ladder_free(struct urefcount *urefcount_real);
+
+/** @internal @This is the private context of a rendition of a ladder pipe. */
+struct upipe_sws_ladder_sub {
+    /** refcount management structure */
+    struct urefcount urefcount;
+    /** structure for double-linked lists */
+    struct uchain uchain;
+
+    /** pipe acting as output */
+    struct upipe *output;
+    /** flow definition packet */
+    struct uref *flow_def;
+    /** attributes / parameters from application */
+    struct uref *flow_def_params;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** ubuf manager */
+    struct ubuf_mgr *ubuf_mgr;
+    /** flow format packet */
+    struct uref *flow_format;
+    /** ubuf manager request */
+    struct urequest ubuf_mgr_request;
+
+    /** swscale image conversion context [0] for progressive, [1,2]
+     * interlaced */
+    struct SwsContext *convert_ctx[3];
+    /** true if the we already tried to set the colorspace, but failed at it */
+    bool colorspace_invalid;
+    /** output pixel format */
+    enum AVPixelFormat output_pix_fmt;
+    /** output chroma map */
+    const char *output_chroma_map[UPIPE_AV_MAX_PLANES];
+    /** output horizontal size */
+    uint64_t hsize;
+    /** output vertical size */
+    uint64_t vsize;
+    /** output color space, or -1 */
+    int output_colorspace;
+    /** output color range, or -1 */
+    int output_color_range;
+
+    /** true if the rendition of the current picture has been processed */
+    bool done;
+    /** rendition of the current picture, or NULL */
+    struct ubuf *ubuf;
+    /** mapped rendition of the current picture */
+    struct upipe_sws_ladder_pic pic;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+/** @hidden */
+static int upipe_sws_ladder_sub_check(struct upipe *upipe,
+                                      struct uref *flow_format);
+/** @hidden */
+static void upipe_sws_ladder_sub_build_flow_def(struct upipe *upipe);
+
+UPIPE_HELPER_UPIPE(upipe_sws_ladder_sub, upipe,
+                   UPIPE_SWS_LADDER_OUTPUT_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_sws_ladder_sub, urefcount,
+                       upipe_sws_ladder_sub_free)
+UPIPE_HELPER_OUTPUT(upipe_sws_ladder_sub, output, flow_def, output_state,
+                    request_list)
+UPIPE_HELPER_FLOW(upipe_sws_ladder_sub, "pic.")
+UPIPE_HELPER_UBUF_MGR(upipe_sws_ladder_sub, ubuf_mgr, flow_format,
+                      ubuf_mgr_request,
+                      upipe_sws_ladder_sub_check,
+                      upipe_sws_ladder_sub_register_output_request,
+                      upipe_sws_ladder_sub_unregister_output_request)
+
+UPIPE_HELPER_SUBPIPE(upipe_sws_ladder, upipe_sws_ladder_sub, output,
+                     sub_mgr, outputs, uchain)
+
+/** @internal @This converts Upipe color space to sws color space.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return sws color space, or -1
+ */
+static int upipe_sws_ladder_convert_color(struct upipe *upipe,
+                                          struct uref *flow_def)
+{
+    int colorspace = -1;
+    const char *matrix_coefficients;
+    if (ubase_check(uref_pic_flow_get_matrix_coefficients(flow_def,
+                    &matrix_coefficients))) {
+        if (!strcmp(matrix_coefficients, "bt709"))
+            colorspace = SWS_CS_ITU709;
+        else if (!strcmp(matrix_coefficients, "fcc"))
+            colorspace = SWS_CS_FCC;
+        else if (!strcmp(matrix_coefficients, "smpte170m"))
+            colorspace = SWS_CS_SMPTE170M;
+        else if (!strcmp(matrix_coefficients, "smpte240m"))
+            colorspace = SWS_CS_SMPTE240M;
+        else
+            upipe_warn_va(upipe, "unknown color space %s", matrix_coefficients);
+    }
+    return colorspace;
+}
+
+/** @internal @This allocates a rendition of a ladder pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_sws_ladder_sub_alloc(struct upipe_mgr *mgr,
+                                                struct uprobe *uprobe,
+                                                uint32_t signature,
+                                                va_list args)
+{
+    struct uref *flow_def;
+    struct upipe *upipe = upipe_sws_ladder_sub_alloc_flow(mgr,
+                            uprobe, signature, args, &flow_def);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_sws_ladder_sub *sub = upipe_sws_ladder_sub_from_upipe(upipe);
+    sub->flow_def_params = flow_def;
+    sub->output_pix_fmt = upipe_av_pixfmt_from_flow_def(flow_def, NULL,
+                                                     sub->output_chroma_map);
+    if (unlikely(sub->output_pix_fmt == AV_PIX_FMT_NONE ||
+                 !sws_isSupportedOutput(sub->output_pix_fmt) ||
+                 !ubase_check(uref_pic_flow_get_hsize(flow_def,
+                                                      &sub->hsize)) ||
+                 !ubase_check(uref_pic_flow_get_vsize(flow_def,
+                                                      &sub->vsize)))) {
+        uref_free(flow_def);
+        upipe_sws_ladder_sub_free_flow(upipe);
+        return NULL;
+    }
+
+    memset(sub->convert_ctx, 0, sizeof(sub->convert_ctx));
+    for (int i = 0; i < 3; i++) {
+        sub->convert_ctx[i] = sws_alloc_context();
+        if (unlikely(sub->convert_ctx[i] == NULL)) {
+            for (i = 0; i < 3; i++)
+                if (sub->convert_ctx[i] != NULL)
+                    sws_freeContext(sub->convert_ctx[i]);
+            uref_free(flow_def);
+            upipe_sws_ladder_sub_free_flow(upipe);
+            return NULL;
+        }
+    }
+
+    upipe_sws_ladder_sub_init_urefcount(upipe);
+    upipe_sws_ladder_sub_init_output(upipe);
+    upipe_sws_ladder_sub_init_ubuf_mgr(upipe);
+    upipe_sws_ladder_sub_init_sub(upipe);
+    sub->colorspace_invalid = false;
+    sub->output_colorspace = upipe_sws_ladder_convert_color(upipe, flow_def);
+    sub->output_color_range =
+        ubase_check(uref_pic_flow_get_full_range(flow_def)) ? 1 : 0;
+    sub->done = false;
+    sub->ubuf = NULL;
+    upipe_throw_ready(upipe);
+    upipe_sws_ladder_sub_build_flow_def(upipe);
+    return upipe;
+}
+
+/** @internal @This receives the result of ubuf manager requests.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_format amended flow format
+ * @return an error code
+ */
+static int upipe_sws_ladder_sub_check(struct upipe *upipe,
+                                      struct uref *flow_format)
+{
+    if (flow_format != NULL)
+        upipe_sws_ladder_sub_store_flow_def(upipe, flow_format);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This builds the flow definition of a rendition, from the
+ * input flow definition and the parameters of the rendition.
+ *
+ * @param upipe description structure of the subpipe
+ */
+static void upipe_sws_ladder_sub_build_flow_def(struct upipe *upipe)
+{
+    struct upipe_sws_ladder_sub *sub = upipe_sws_ladder_sub_from_upipe(upipe);
+    struct upipe_sws_ladder *ladder =
+        upipe_sws_ladder_from_sub_mgr(upipe->mgr);
+    if (ladder->flow_def == NULL)
+        return;
+
+    if (sub->ubuf_mgr) {
+        ubuf_mgr_release(sub->ubuf_mgr);
+        sub->ubuf_mgr = NULL;
+    }
+
+    struct uref *flow_def = uref_dup(ladder->flow_def);
+    if (unlikely(flow_def == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    uref_pic_flow_clear_format(flow_def);
+
+    uint64_t input_hsize, input_vsize;
+    if (ubase_check(uref_pic_flow_get_hsize(flow_def, &input_hsize)) &&
+        ubase_check(uref_pic_flow_get_vsize(flow_def, &input_vsize))) {
+        uint64_t hsize_visible;
+        if (input_hsize != sub->hsize &&
+            ubase_check(uref_pic_flow_get_hsize_visible(flow_def,
+                                                        &hsize_visible)))
+            UBASE_FATAL(upipe, uref_pic_flow_set_hsize_visible(flow_def,
+                        hsize_visible * sub->hsize / input_hsize))
+
+        uint64_t vsize_visible;
+        if (input_vsize != sub->vsize &&
+            ubase_check(uref_pic_flow_get_vsize_visible(flow_def,
+                                                        &vsize_visible)))
+            UBASE_FATAL(upipe, uref_pic_flow_set_vsize_visible(flow_def,
+                        vsize_visible * sub->vsize / input_vsize))
+
+        struct urational sar;
+        if (!ubase_check(uref_pic_flow_get_sar(sub->flow_def_params,
+                                               &sar)) &&
+            ubase_check(uref_pic_flow_get_sar(flow_def, &sar))) {
+            sar.num *= input_hsize * sub->vsize;
+            sar.den *= input_vsize * sub->hsize;
+            urational_simplify(&sar);
+            UBASE_FATAL(upipe, uref_pic_flow_set_sar(flow_def, sar))
+        }
+    }
+
+    UBASE_FATAL(upipe, uref_attr_import(flow_def, sub->flow_def_params))
+    uint64_t align;
+    if (!ubase_check(uref_pic_flow_get_align(flow_def, &align)) || !align)
+        align = 16;
+    if (align % 16)
+        align = align * 16 / ubase_gcd(align, 16);
+    UBASE_FATAL(upipe, uref_pic_flow_set_align(flow_def, align))
+
+    upipe_sws_ladder_sub_demand_ubuf_mgr(upipe, flow_def);
+}
+
+/** @internal @This sets up the conversion contexts of a rendition.
+ *
+ * @param upipe description structure of the subpipe
+ * @param src source picture
+ * @param dst destination picture
+ * @return an error code
+ */
+static int upipe_sws_ladder_sub_update_ctx(struct upipe *upipe,
+        const struct upipe_sws_ladder_pic *src,
+        const struct upipe_sws_ladder_pic *dst)
+{
+    struct upipe_sws_ladder_sub *sub = upipe_sws_ladder_sub_from_upipe(upipe);
+    static const int chr_pos[3] = { 128, 64, 192 };
+
+    for (int i = 0; i < 3; i++) {
+        /* only taken into account when the context is (re)initialized */
+        av_opt_set_int(sub->convert_ctx[i], "src_v_chr_pos",
+                       src->pix_fmt == AV_PIX_FMT_YUV420P ? chr_pos[i] : -513,
+                       0);
+        av_opt_set_int(sub->convert_ctx[i], "dst_v_chr_pos",
+                       dst->pix_fmt == AV_PIX_FMT_YUV420P ? chr_pos[i] : -513,
+                       0);
+
+        sub->convert_ctx[i] = sws_getCachedContext(sub->convert_ctx[i],
+                    src->hsize, src->vsize >> !!i, src->pix_fmt,
+                    dst->hsize, dst->vsize >> !!i, dst->pix_fmt,
+                    UPIPE_SWS_LADDER_FLAGS, NULL, NULL, NULL);
+        if (unlikely(sub->convert_ctx[i] == NULL)) {
+            upipe_err(upipe, "sws_getContext failed");
+            return UBASE_ERR_EXTERNAL;
+        }
+
+        if (sub->colorspace_invalid)
+            continue;
+
+        int in_full, out_full, brightness, contrast, saturation;
+        const int *inv_table, *table;
+        if (unlikely(sws_getColorspaceDetails(sub->convert_ctx[i],
+                        (int **)&inv_table, &in_full, (int **)&table,
+                        &out_full, &brightness, &contrast,
+                        &saturation) < 0)) {
+            upipe_warn(upipe, "unable to set color space data");
+            sub->colorspace_invalid = true;
+            continue;
+        }
+
+        if (src->colorspace != -1)
+            inv_table = sws_getCoefficients(src->colorspace);
+        if (src->color_range != -1)
+            in_full = src->color_range;
+        if (dst->colorspace != -1)
+            table = sws_getCoefficients(dst->colorspace);
+        if (dst->color_range != -1)
+            out_full = dst->color_range;
+
+        if (unlikely(sws_setColorspaceDetails(sub->convert_ctx[i],
+                        inv_table, in_full, table, out_full,
+                        brightness, contrast, saturation) < 0)) {
+            upipe_warn(upipe, "unable to set color space data");
+            sub->colorspace_invalid = true;
+        }
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This unmaps and releases the rendition of the current
+ * picture.
+ *
+ * @param upipe description structure of the subpipe
+ */
+static void upipe_sws_ladder_sub_unmap(struct upipe *upipe)
+{
+    struct upipe_sws_ladder_sub *sub = upipe_sws_ladder_sub_from_upipe(upipe);
+    if (sub->ubuf == NULL)
+        return;
+    for (int i = 0; i < UPIPE_AV_MAX_PLANES &&
+                    sub->output_chroma_map[i] != NULL; i++)
+        ubuf_pic_plane_unmap(sub->ubuf, sub->output_chroma_map[i],
+                             0, 0, -1, -1);
+}
+
+/** @internal @This scales a picture into a new rendition.
+ *
+ * @param upipe description structure of the subpipe
+ * @param src source picture
+ * @param progressive true if the picture is progressive
+ * @return an error code
+ */
+static int upipe_sws_ladder_sub_scale(struct upipe *upipe,
+                                      const struct upipe_sws_ladder_pic *src,
+                                      bool progressive)
+{
+    struct upipe_sws_ladder_sub *sub = upipe_sws_ladder_sub_from_upipe(upipe);
+    struct upipe_sws_ladder_pic *dst = &sub->pic;
+    dst->pix_fmt = sub->output_pix_fmt;
+    dst->hsize = sub->hsize;
+    dst->vsize = sub->vsize;
+    dst->colorspace = sub->output_colorspace != -1 ? sub->output_colorspace :
+                      src->colorspace;
+    dst->color_range = sub->output_color_range;
+    UBASE_RETURN(upipe_sws_ladder_sub_update_ctx(upipe, src, dst))
+
+    sub->ubuf = ubuf_pic_alloc(sub->ubuf_mgr, dst->hsize, dst->vsize);
+    UBASE_ALLOC_RETURN(sub->ubuf);
+
+    int i;
+    for (i = 0; i < UPIPE_AV_MAX_PLANES &&
+                sub->output_chroma_map[i] != NULL; i++) {
+        uint8_t *data;
+        size_t stride;
+        if (unlikely(!ubase_check(ubuf_pic_plane_write(sub->ubuf,
+                                          sub->output_chroma_map[i],
+                                          0, 0, -1, -1, &data)) ||
+                     !ubase_check(ubuf_pic_plane_size(sub->ubuf,
+                                          sub->output_chroma_map[i],
+                                          &stride, NULL, NULL, NULL)))) {
+            while (--i >= 0)
+                ubuf_pic_plane_unmap(sub->ubuf, sub->output_chroma_map[i],
+                                     0, 0, -1, -1);
+            ubuf_free(sub->ubuf);
+            sub->ubuf = NULL;
+            return UBASE_ERR_INVALID;
+        }
+        dst->planes[i] = data;
+        dst->strides[i] = stride * (1 + !progressive);
+    }
+    for ( ; i < UPIPE_AV_MAX_PLANES + 1; i++) {
+        dst->planes[i] = NULL;
+        dst->strides[i] = 0;
+    }
+
+    int ret, ret2 = 1;
+    if (progressive)
+        ret = sws_scale(sub->convert_ctx[0],
+                        (const uint8_t * const *)src->planes, src->strides,
+                        0, src->vsize, dst->planes, dst->strides);
+    else {
+        const uint8_t *src_planes[UPIPE_AV_MAX_PLANES + 1];
+        uint8_t *dst_planes[UPIPE_AV_MAX_PLANES + 1];
+        ret = sws_scale(sub->convert_ctx[1],
+                        (const uint8_t * const *)src->planes, src->strides,
+                        0, (src->vsize + 1) / 2, dst->planes, dst->strides);
+
+        for (i = 0; i < UPIPE_AV_MAX_PLANES + 1; i++) {
+            src_planes[i] = src->planes[i] == NULL ? NULL :
+                            src->planes[i] + (src->strides[i] >> 1);
+            dst_planes[i] = dst->planes[i] == NULL ? NULL :
+                            dst->planes[i] + (dst->strides[i] >> 1);
+        }
+        ret2 = sws_scale(sub->convert_ctx[2], src_planes, src->strides,
+                         0, src->vsize / 2, dst_planes, dst->strides);
+    }
+
+    if (unlikely(ret <= 0 || ret2 <= 0)) {
+        upipe_warn(upipe, "error during sws conversion");
+        upipe_sws_ladder_sub_unmap(upipe);
+        ubuf_free(sub->ubuf);
+        sub->ubuf = NULL;
+        return UBASE_ERR_EXTERNAL;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a rendition of a ladder
+ * pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_sws_ladder_sub_control(struct upipe *upipe,
+                                        int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR ||
+                request->type == UREQUEST_FLOW_FORMAT)
+                return upipe_throw_provide_request(upipe, request);
+            return upipe_sws_ladder_sub_alloc_output_proxy(upipe, request);
+        }
+        case UPIPE_UNREGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR ||
+                request->type == UREQUEST_FLOW_FORMAT)
+                return UBASE_ERR_NONE;
+            return upipe_sws_ladder_sub_free_output_proxy(upipe, request);
+        }
+        case UPIPE_GET_FLOW_DEF: {
+            struct uref **p = va_arg(args, struct uref **);
+            return upipe_sws_ladder_sub_get_flow_def(upipe, p);
+        }
+        case UPIPE_GET_OUTPUT: {
+            struct upipe **p = va_arg(args, struct upipe **);
+            return upipe_sws_ladder_sub_get_output(upipe, p);
+        }
+        case UPIPE_SET_OUTPUT: {
+            struct upipe *output = va_arg(args, struct upipe *);
+            return upipe_sws_ladder_sub_set_output(upipe, output);
+        }
+        case UPIPE_SUB_GET_SUPER: {
+            struct upipe **p = va_arg(args, struct upipe **);
+            return upipe_sws_ladder_sub_get_super(upipe, p);
+        }
+
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a rendition.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_sws_ladder_sub_free(struct upipe *upipe)
+{
+    struct upipe_sws_ladder_sub *sub = upipe_sws_ladder_sub_from_upipe(upipe);
+    upipe_throw_dead(upipe);
+
+    for (int i = 0; i < 3; i++)
+        sws_freeContext(sub->convert_ctx[i]);
+    uref_free(sub->flow_def_params);
+    upipe_sws_ladder_sub_clean_output(upipe);
+    upipe_sws_ladder_sub_clean_sub(upipe);
+    upipe_sws_ladder_sub_clean_ubuf_mgr(upipe);
+    upipe_sws_ladder_sub_clean_urefcount(upipe);
+    upipe_sws_ladder_sub_free_flow(upipe);
+}
+
+/** @internal @This initializes the output manager for a ladder pipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_sws_ladder_init_sub_mgr(struct upipe *upipe)
+{
+    struct upipe_sws_ladder *ladder = upipe_sws_ladder_from_upipe(upipe);
+    struct upipe_mgr *sub_mgr = &ladder->sub_mgr;
+    sub_mgr->refcount = upipe_sws_ladder_to_urefcount_real(ladder);
+    sub_mgr->signature = UPIPE_SWS_LADDER_OUTPUT_SIGNATURE;
+    sub_mgr->upipe_alloc = upipe_sws_ladder_sub_alloc;
+    sub_mgr->upipe_input = NULL;
+    sub_mgr->upipe_control = upipe_sws_ladder_sub_control;
+    sub_mgr->upipe_mgr_control = NULL;
+}
+
+/** @internal @This allocates a ladder pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_sws_ladder_alloc(struct upipe_mgr *mgr,
+                                            struct uprobe *uprobe,
+                                            uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_sws_ladder_alloc_void(mgr, uprobe, signature,
+                                                      args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_sws_ladder *ladder = upipe_sws_ladder_from_upipe(upipe);
+    upipe_sws_ladder_init_urefcount(upipe);
+    urefcount_init(upipe_sws_ladder_to_urefcount_real(ladder),
+                   upipe_sws_ladder_free);
+    upipe_sws_ladder_init_sub_mgr(upipe);
+    upipe_sws_ladder_init_sub_outputs(upipe);
+    ladder->flow_def = NULL;
+    ladder->input_pix_fmt = AV_PIX_FMT_NONE;
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This returns the next rendition to compute, which is the
+ * largest one not yet processed.
+ *
+ * @param upipe description structure of the pipe
+ * @return pointer to the rendition, or NULL if all are processed
+ */
+static struct upipe_sws_ladder_sub *
+    upipe_sws_ladder_next(struct upipe *upipe)
+{
+    struct upipe_sws_ladder *ladder = upipe_sws_ladder_from_upipe(upipe);
+    struct upipe_sws_ladder_sub *next = NULL;
+    struct uchain *uchain;
+    ulist_foreach (&ladder->outputs, uchain) {
+        struct upipe_sws_ladder_sub *sub =
+            upipe_sws_ladder_sub_from_uchain(uchain);
+        if (!sub->done && (next == NULL ||
+                           sub->hsize * sub->vsize > next->hsize * next->vsize))
+            next = sub;
+    }
+    return next;
+}
+
+/** @internal @This returns the picture a rendition should be scaled from:
+ * the smallest of the source and the renditions already computed which is
+ * at least as large as the rendition. Only renditions with the pixel
+ * format of the target or of the source are considered, so that precision
+ * is not lost and colors are not converted twice.
+ *
+ * @param upipe description structure of the pipe
+ * @param input mapped input picture
+ * @param target rendition to compute
+ * @return pointer to the source picture
+ */
+static const struct upipe_sws_ladder_pic *
+    upipe_sws_ladder_source(struct upipe *upipe,
+                            const struct upipe_sws_ladder_pic *input,
+                            struct upipe_sws_ladder_sub *target)
+{
+    struct upipe_sws_ladder *ladder = upipe_sws_ladder_from_upipe(upipe);
+    const struct upipe_sws_ladder_pic *source = input;
+    struct uchain *uchain;
+    ulist_foreach (&ladder->outputs, uchain) {
+        struct upipe_sws_ladder_sub *sub =
+            upipe_sws_ladder_sub_from_uchain(uchain);
+        if (!sub->done || sub->ubuf == NULL ||
+            sub->pic.hsize < target->hsize || sub->pic.vsize < target->vsize ||
+            sub->pic.hsize * sub->pic.vsize >= source->hsize * source->vsize ||
+            (sub->pic.pix_fmt != target->output_pix_fmt &&
+             sub->pic.pix_fmt != input->pix_fmt) ||
+            !sws_isSupportedInput(sub->pic.pix_fmt))
+            continue;
+        source = &sub->pic;
+    }
+    return source;
+}
+
+/** @internal @This receives data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_sws_ladder_input(struct upipe *upipe, struct uref *uref,
+                                   struct upump **upump_p)
+{
+    struct upipe_sws_ladder *ladder = upipe_sws_ladder_from_upipe(upipe);
+    if (unlikely(ladder->flow_def == NULL || ulist_empty(&ladder->outputs))) {
+        uref_free(uref);
+        return;
+    }
+
+    struct upipe_sws_ladder_pic input;
+    if (unlikely(!ubase_check(uref_pic_size(uref, &input.hsize,
+                                            &input.vsize, NULL)))) {
+        upipe_warn(upipe, "invalid buffer received");
+        uref_free(uref);
+        return;
+    }
+    bool progressive = ubase_check(uref_pic_get_progressive(uref));
+    input.pix_fmt = ladder->input_pix_fmt;
+    input.colorspace = ladder->input_colorspace;
+    input.color_range = ladder->input_color_range;
+
+    /* map input */
+    int i;
+    for (i = 0; i < UPIPE_AV_MAX_PLANES &&
+                ladder->input_chroma_map[i] != NULL; i++) {
+        const uint8_t *data;
+        size_t stride;
+        if (unlikely(!ubase_check(uref_pic_plane_read(uref,
+                                          ladder->input_chroma_map[i],
+                                          0, 0, -1, -1, &data)) ||
+                     !ubase_check(uref_pic_plane_size(uref,
+                                          ladder->input_chroma_map[i],
+                                          &stride, NULL, NULL, NULL)))) {
+            upipe_warn(upipe, "invalid buffer received");
+            while (--i >= 0)
+                uref_pic_plane_unmap(uref, ladder->input_chroma_map[i],
+                                     0, 0, -1, -1);
+            uref_free(uref);
+            return;
+        }
+        input.planes[i] = (uint8_t *)data;
+        input.strides[i] = stride * (1 + !progressive);
+    }
+    for ( ; i < UPIPE_AV_MAX_PLANES + 1; i++) {
+        input.planes[i] = NULL;
+        input.strides[i] = 0;
+    }
+
+    /* compute renditions from the largest to the smallest */
+    struct uchain *uchain;
+    ulist_foreach (&ladder->outputs, uchain) {
+        struct upipe_sws_ladder_sub *sub =
+            upipe_sws_ladder_sub_from_uchain(uchain);
+        sub->done = false;
+        sub->ubuf = NULL;
+    }
+
+    struct upipe_sws_ladder_sub *sub;
+    while ((sub = upipe_sws_ladder_next(upipe)) != NULL) {
+        sub->done = true;
+        if (sub->ubuf_mgr == NULL || sub->flow_def == NULL)
+            continue;
+        const struct upipe_sws_ladder_pic *source =
+            upipe_sws_ladder_source(upipe, &input, sub);
+        upipe_verbose_va(upipe_sws_ladder_sub_to_upipe(sub),
+                         "scaling from %zux%zu", source->hsize, source->vsize);
+        UBASE_ERROR(upipe_sws_ladder_sub_to_upipe(sub),
+                    upipe_sws_ladder_sub_scale(
+                        upipe_sws_ladder_sub_to_upipe(sub), source,
+                        progressive))
+    }
+
+    for (i = 0; i < UPIPE_AV_MAX_PLANES &&
+                ladder->input_chroma_map[i] != NULL; i++)
+        uref_pic_plane_unmap(uref, ladder->input_chroma_map[i],
+                             0, 0, -1, -1);
+
+    /* output in the order of the subpipes */
+    ulist_foreach (&ladder->outputs, uchain) {
+        sub = upipe_sws_ladder_sub_from_uchain(uchain);
+        struct upipe *sub_pipe = upipe_sws_ladder_sub_to_upipe(sub);
+        if (sub->ubuf == NULL)
+            continue;
+        upipe_sws_ladder_sub_unmap(sub_pipe);
+        struct ubuf *ubuf = sub->ubuf;
+        sub->ubuf = NULL;
+
+        struct uref *output = uref_dup(uref);
+        if (unlikely(output == NULL)) {
+            ubuf_free(ubuf);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            continue;
+        }
+        uref_attach_ubuf(output, ubuf);
+        upipe_sws_ladder_sub_output(sub_pipe, output, upump_p);
+    }
+    uref_free(uref);
+}
+
+/** @internal @This changes the flow definition on all renditions.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def new flow definition
+ * @return an error code
+ */
+static int upipe_sws_ladder_set_flow_def(struct upipe *upipe,
+                                         struct uref *flow_def)
+{
+    struct upipe_sws_ladder *ladder = upipe_sws_ladder_from_upipe(upipe);
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_flow_match_def(flow_def, "pic."))
+
+    enum AVPixelFormat pix_fmt = upipe_av_pixfmt_from_flow_def(flow_def,
+            NULL, ladder->input_chroma_map);
+    if (pix_fmt == AV_PIX_FMT_NONE || !sws_isSupportedInput(pix_fmt)) {
+        upipe_err(upipe, "incompatible flow def");
+        uref_dump(flow_def, upipe->uprobe);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    struct uref *flow_def_dup = uref_dup(flow_def);
+    UBASE_ALLOC_RETURN(flow_def_dup);
+    uref_free(ladder->flow_def);
+    ladder->flow_def = flow_def_dup;
+    ladder->input_pix_fmt = pix_fmt;
+    ladder->input_colorspace = upipe_sws_ladder_convert_color(upipe, flow_def);
+    ladder->input_color_range =
+        ubase_check(uref_pic_flow_get_full_range(flow_def)) ? 1 : 0;
+
+    /* rebuild output flow definitions */
+    struct uchain *uchain;
+    ulist_foreach (&ladder->outputs, uchain) {
+        struct upipe_sws_ladder_sub *sub =
+            upipe_sws_ladder_sub_from_uchain(uchain);
+        sub->colorspace_invalid = false;
+        upipe_sws_ladder_sub_build_flow_def(upipe_sws_ladder_sub_to_upipe(sub));
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a ladder pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_sws_ladder_control(struct upipe *upipe,
+                                    int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, request);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *uref = va_arg(args, struct uref *);
+            return upipe_sws_ladder_set_flow_def(upipe, uref);
+        }
+        case UPIPE_GET_SUB_MGR: {
+            struct upipe_mgr **p = va_arg(args, struct upipe_mgr **);
+            return upipe_sws_ladder_get_sub_mgr(upipe, p);
+        }
+        case UPIPE_ITERATE_SUB: {
+            struct upipe **p = va_arg(args, struct upipe **);
+            return upipe_sws_ladder_iterate_sub(upipe, p);
+        }
+
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a upipe.
+ *
+ * @param urefcount_real pointer to urefcount_real structure
+ */
+static void upipe_sws_ladder_free(struct urefcount *urefcount_real)
+{
+    struct upipe_sws_ladder *ladder =
+        upipe_sws_ladder_from_urefcount_real(urefcount_real);
+    struct upipe *upipe = upipe_sws_ladder_to_upipe(ladder);
+    upipe_throw_dead(upipe);
+    upipe_sws_ladder_clean_sub_outputs(upipe);
+    uref_free(ladder->flow_def);
+    urefcount_clean(urefcount_real);
+    upipe_sws_ladder_clean_urefcount(upipe);
+    upipe_sws_ladder_free_void(upipe);
+}
+
+/** @This is called when there is no external reference to the pipe anymore.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_sws_ladder_no_input(struct upipe *upipe)
+{
+    struct upipe_sws_ladder *ladder = upipe_sws_ladder_from_upipe(upipe);
+    upipe_sws_ladder_throw_sub_outputs(upipe, UPROBE_SOURCE_END);
+    urefcount_release(upipe_sws_ladder_to_urefcount_real(ladder));
+}
+
+/** sws ladder module manager static descriptor */
+static struct upipe_mgr upipe_sws_ladder_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_SWS_LADDER_SIGNATURE,
+
+    .upipe_alloc = upipe_sws_ladder_alloc,
+    .upipe_input = upipe_sws_ladder_input,
+    .upipe_control = upipe_sws_ladder_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for all sws ladder pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_sws_ladder_mgr_alloc(void)
+{
+    return &upipe_sws_ladder_mgr;
+}
@@ -66,6 +66,7 @@
 #include <upipe-modules/upipe_null.h>
 #include <upipe-modules/upipe_setrap.h>
 #include <upipe-modules/upipe_idem.h>
+#include <upipe-modules/upipe_worker_linear.h>
 #include <upipe-ts/uref_ts_flow.h>
 #include <upipe-ts/uref_ts_event.h>
 #include <upipe-ts/upipe_ts_demux.h>
@@ -164,6 +165,16 @@ struct upipe_ts_demux_mgr {
     /** pointer to autof manager */
     struct upipe_mgr *autof_mgr;
 
+    /* workers */
+    /** number of worker pipeline managers */
+    unsigned int nb_workers;
+    /** array of wlin managers, one per worker thread */
+    struct upipe_mgr **worker_mgrs;
+    /** probe for the pipes running in the worker threads */
+    struct uprobe *uprobe_worker;
+    /** length of the queues to and from the worker threads */
+    unsigned int worker_queue_length;
+
     /** public upipe_mgr structure */
     struct upipe_mgr mgr;
 };
@@ -249,6 +260,8 @@ struct upipe_ts_demux {
     bool auto_conformance;
     /** current conformance */
     enum upipe_ts_conformance conformance;
+    /** worker to assign to the next program */
+    unsigned int next_worker;
 
     /** probe to get new flow events from inner pipes created by psi_pid
      * objects */
@@ -354,6 +367,8 @@ struct upipe_ts_demux_program {
     uint64_t last_pcr;
     /** highest Upipe timestamp given to a frame */
     uint64_t timestamp_highest;
+    /** worker running the framers of this program */
+    unsigned int worker;
 
     /** probe to get events from ts_pmtd inner pipe */
     struct uprobe pmtd_probe;
@@ -756,6 +771,29 @@ static int upipe_ts_demux_output_plumber(struct upipe *upipe,
         return UBASE_ERR_NONE;
     }
 
+    if (ts_demux_mgr->autof_mgr != NULL && ts_demux_mgr->nb_workers) {
+        /* allocate autof inner in a worker thread */
+        struct upipe *autof = upipe_void_alloc(ts_demux_mgr->autof_mgr,
+                uprobe_pfx_alloc(uprobe_use(ts_demux_mgr->uprobe_worker),
+                                 UPROBE_LOG_VERBOSE, "autof"));
+        if (unlikely(autof == NULL))
+            return UBASE_ERR_ALLOC;
+
+        struct upipe *output = upipe_wlin_alloc(
+                ts_demux_mgr->worker_mgrs[program->worker],
+                uprobe_pfx_alloc(
+                    uprobe_use(&upipe_ts_demux_output->last_inner_probe),
+                    UPROBE_LOG_VERBOSE, "wlin"),
+                autof, uprobe_use(ts_demux_mgr->uprobe_worker),
+                ts_demux_mgr->worker_queue_length,
+                ts_demux_mgr->worker_queue_length);
+        if (unlikely(output == NULL))
+            return UBASE_ERR_ALLOC;
+        upipe_set_output(inner, output);
+        upipe_ts_demux_output_store_bin_output(upipe, output);
+        return UBASE_ERR_NONE;
+    }
+
     if (ts_demux_mgr->autof_mgr != NULL) {
         /* allocate autof inner */
         struct upipe *output =
@@ -1170,6 +1208,8 @@ static int upipe_ts_demux_configure_eit(struct upipe *upipe,
         return UBASE_ERR_ALLOC;
     }
     uref_free(flow_def);
+    upipe_ts_psi_split_output_set_cache(
+            upipe_ts_demux_program->psi_split_output_eit, true);
 
     /* allocate EIT decoder */
     upipe_ts_demux_program->eitd =
@@ -1257,6 +1297,8 @@ static int upipe_ts_demux_configure_eits(struct upipe *upipe,
         return UBASE_ERR_ALLOC;
     }
     uref_free(flow_def);
+    upipe_ts_psi_split_output_set_cache(
+            upipe_ts_demux_program->psi_split_output_eits[n], true);
 
     /* allocate EIT decoder */
     upipe_ts_demux_program->eitsd[n] =
@@ -1648,6 +1690,7 @@ static struct upipe *upipe_ts_demux_program_alloc(struct upipe_mgr *mgr,
     upipe_ts_demux_program->timestamp_offset = 0;
     upipe_ts_demux_program->timestamp_highest = TS_CLOCK_MAX;
     upipe_ts_demux_program->last_pcr = TS_CLOCK_MAX;
+    upipe_ts_demux_program->worker = 0;
     uprobe_init(&upipe_ts_demux_program->pmtd_probe,
                 upipe_ts_demux_program_pmtd_probe, NULL);
     upipe_ts_demux_program->pmtd_probe.refcount =
@@ -1711,6 +1754,10 @@ static struct upipe *upipe_ts_demux_program_alloc(struct upipe_mgr *mgr,
 
     struct upipe_ts_demux_mgr *ts_demux_mgr =
         upipe_ts_demux_mgr_from_upipe_mgr(upipe_ts_demux_to_upipe(demux)->mgr);
+    if (ts_demux_mgr->nb_workers)
+        upipe_ts_demux_program->worker =
+            demux->next_worker++ % ts_demux_mgr->nb_workers;
+
     upipe_ts_demux_program->pmtd =
         upipe_void_alloc_output(upipe_ts_demux_program->psi_split_output_pmt,
                 ts_demux_mgr->ts_pmtd_mgr,
@@ -2126,6 +2173,8 @@ static void upipe_ts_demux_update_nit(struct upipe *upipe)
         return;
     }
     uref_free(flow_def);
+    upipe_ts_psi_split_output_set_cache(
+            upipe_ts_demux->psi_split_output_nit, true);
 
     /* allocate NIT decoder */
     struct upipe_ts_demux_mgr *ts_demux_mgr =
@@ -2200,6 +2249,8 @@ static void upipe_ts_demux_update_sdt(struct upipe *upipe)
         return;
     }
     uref_free(flow_def);
+    upipe_ts_psi_split_output_set_cache(
+            upipe_ts_demux->psi_split_output_sdt, true);
 
     /* allocate SDT decoder */
     struct upipe_ts_demux_mgr *ts_demux_mgr =
@@ -2669,6 +2720,7 @@ static struct upipe *upipe_ts_demux_alloc(struct upipe_mgr *mgr,
     upipe_ts_demux->conformance = UPIPE_TS_CONFORMANCE_DVB_NO_TABLES;
     upipe_ts_demux->auto_conformance = true;
     upipe_ts_demux->nit_pid = 0;
+    upipe_ts_demux->next_worker = 0;
     upipe_ts_demux->flow_def_input = NULL;
 
     uprobe_init(&upipe_ts_demux->psi_pid_plumber,
@@ -3063,6 +3115,64 @@ static void upipe_ts_demux_no_input(struct upipe *upipe)
     urefcount_release(upipe_ts_demux_to_urefcount_real(upipe_ts_demux));
 }
 
+/** @internal @This releases the worker pool of a ts_demux manager.
+ *
+ * @param ts_demux_mgr private structure of the manager
+ */
+static void upipe_ts_demux_mgr_clean_workers(
+        struct upipe_ts_demux_mgr *ts_demux_mgr)
+{
+    for (unsigned int i = 0; i < ts_demux_mgr->nb_workers; i++)
+        upipe_mgr_release(ts_demux_mgr->worker_mgrs[i]);
+    free(ts_demux_mgr->worker_mgrs);
+    uprobe_release(ts_demux_mgr->uprobe_worker);
+    ts_demux_mgr->worker_mgrs = NULL;
+    ts_demux_mgr->uprobe_worker = NULL;
+    ts_demux_mgr->nb_workers = 0;
+}
+
+/** @internal @This sets the worker pool of a ts_demux manager.
+ *
+ * @param ts_demux_mgr private structure of the manager
+ * @param nb_workers number of worker pipeline managers
+ * @param worker_mgrs array of wlin managers
+ * @param uprobe_worker probe for the pipes running in the workers
+ * @param queue_length length of the queues to and from the workers
+ * @return an error code
+ */
+static int upipe_ts_demux_mgr_set_workers_internal(
+        struct upipe_ts_demux_mgr *ts_demux_mgr, unsigned int nb_workers,
+        struct upipe_mgr **worker_mgrs, struct uprobe *uprobe_worker,
+        unsigned int queue_length)
+{
+    if (nb_workers && (worker_mgrs == NULL || uprobe_worker == NULL ||
+                       !queue_length))
+        return UBASE_ERR_INVALID;
+
+    struct upipe_mgr **mgrs = NULL;
+    if (nb_workers) {
+        mgrs = malloc(nb_workers * sizeof(struct upipe_mgr *));
+        UBASE_ALLOC_RETURN(mgrs);
+        for (unsigned int i = 0; i < nb_workers; i++) {
+            if (unlikely(worker_mgrs[i] == NULL)) {
+                while (i--)
+                    upipe_mgr_release(mgrs[i]);
+                free(mgrs);
+                return UBASE_ERR_INVALID;
+            }
+            mgrs[i] = upipe_mgr_use(worker_mgrs[i]);
+        }
+        uprobe_use(uprobe_worker);
+    }
+
+    upipe_ts_demux_mgr_clean_workers(ts_demux_mgr);
+    ts_demux_mgr->nb_workers = nb_workers;
+    ts_demux_mgr->worker_mgrs = mgrs;
+    ts_demux_mgr->uprobe_worker = nb_workers ? uprobe_worker : NULL;
+    ts_demux_mgr->worker_queue_length = queue_length;
+    return UBASE_ERR_NONE;
+}
+
 /** @This frees a upipe manager.
  *
  * @param urefcount pointer to urefcount structure
@@ -3089,6 +3199,7 @@ static void upipe_ts_demux_mgr_free(struct urefcount *urefcount)
     upipe_mgr_release(ts_demux_mgr->ts_pesd_mgr);
     upipe_mgr_release(ts_demux_mgr->ts_scte35d_mgr);
     upipe_mgr_release(ts_demux_mgr->autof_mgr);
+    upipe_ts_demux_mgr_clean_workers(ts_demux_mgr);
 
     urefcount_clean(urefcount);
     free(ts_demux_mgr);
@@ -3147,6 +3258,25 @@ static int upipe_ts_demux_mgr_control(struct upipe_mgr *mgr,
         GET_SET_MGR(autof, AUTOF)
 #undef GET_SET_MGR
 
+        case UPIPE_TS_DEMUX_MGR_GET_WORKERS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_DEMUX_SIGNATURE)
+            unsigned int *p = va_arg(args, unsigned int *);
+            *p = ts_demux_mgr->nb_workers;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_TS_DEMUX_MGR_SET_WORKERS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_DEMUX_SIGNATURE)
+            if (!urefcount_single(&ts_demux_mgr->urefcount))
+                return UBASE_ERR_BUSY;
+            unsigned int nb_workers = va_arg(args, unsigned int);
+            struct upipe_mgr **worker_mgrs =
+                va_arg(args, struct upipe_mgr **);
+            struct uprobe *uprobe_worker = va_arg(args, struct uprobe *);
+            unsigned int queue_length = va_arg(args, unsigned int);
+            return upipe_ts_demux_mgr_set_workers_internal(ts_demux_mgr,
+                    nb_workers, worker_mgrs, uprobe_worker, queue_length);
+        }
+
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -3185,6 +3315,11 @@ struct upipe_mgr *upipe_ts_demux_mgr_alloc(void)
 
     ts_demux_mgr->autof_mgr = NULL;
 
+    ts_demux_mgr->nb_workers = 0;
+    ts_demux_mgr->worker_mgrs = NULL;
+    ts_demux_mgr->uprobe_worker = NULL;
+    ts_demux_mgr->worker_queue_length = 0;
+
     urefcount_init(upipe_ts_demux_mgr_to_urefcount(ts_demux_mgr),
                    upipe_ts_demux_mgr_free);
     ts_demux_mgr->mgr.refcount = upipe_ts_demux_mgr_to_urefcount(ts_demux_mgr);
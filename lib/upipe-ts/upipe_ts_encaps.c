@@ -1080,20 +1080,21 @@ static int upipe_ts_encaps_promote_au(struct upipe *upipe)
     return UBASE_ERR_NONE;
 }
 
-/** @internal @This builds a TS header.
+/** @internal @This writes a TS header.
  *
  * @param upipe description structure of the pipe
+ * @param buffer buffer to write to, at least header_size octets long
  * @param payload_size available size of the payload
  * @param start true if it's the first packet of the access unit
  * @param pcr_prog value of the PCR field, in 27 MHz units, or UINT64_MAX
  * @param random true if the packet is a random access point
  * @param discontinuity true if the packet must have the discontinuity flag
- * @return allocated TS header
+ * @return size of the written TS header
  */
-static struct ubuf *upipe_ts_encaps_build_ts(struct upipe *upipe,
-                                             size_t payload_size, bool start,
-                                             uint64_t pcr_prog, bool random,
-                                             bool discontinuity)
+static size_t upipe_ts_encaps_write_ts(struct upipe *upipe, uint8_t *buffer,
+                                       size_t payload_size, bool start,
+                                       uint64_t pcr_prog, bool random,
+                                       bool discontinuity)
 {
     struct upipe_ts_encaps *encaps = upipe_ts_encaps_from_upipe(upipe);
     size_t header_size;
@@ -1113,16 +1114,6 @@ static struct ubuf *upipe_ts_encaps_build_ts(struct upipe *upipe,
             discontinuity ? ", disc" : "",
             pcr_prog != UINT64_MAX ? ", pcr" : "");
 #endif
-    struct ubuf *ubuf = ubuf_block_alloc(encaps->ubuf_mgr, header_size);
-    uint8_t *buffer;
-    int size = -1;
-    if (unlikely(ubuf == NULL ||
-                 !ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer)))) {
-        ubuf_free(ubuf);
-        return NULL;
-    }
-    assert(size == header_size);
-
     ts_init(buffer);
     ts_set_pid(buffer, encaps->pid);
     if (payload_size) {
@@ -1146,62 +1137,115 @@ static struct ubuf *upipe_ts_encaps_build_ts(struct upipe *upipe,
             tsaf_set_pcrext(buffer, pcr_prog % SCALE_33);
         }
     }
+    return header_size;
+}
+
+/** @internal @This builds a TS header.
+ *
+ * @param upipe description structure of the pipe
+ * @param payload_size available size of the payload
+ * @param start true if it's the first packet of the access unit
+ * @param pcr_prog value of the PCR field, in 27 MHz units, or UINT64_MAX
+ * @param random true if the packet is a random access point
+ * @param discontinuity true if the packet must have the discontinuity flag
+ * @return allocated TS header
+ */
+static struct ubuf *upipe_ts_encaps_build_ts(struct upipe *upipe,
+                                             size_t payload_size, bool start,
+                                             uint64_t pcr_prog, bool random,
+                                             bool discontinuity)
+{
+    struct upipe_ts_encaps *encaps = upipe_ts_encaps_from_upipe(upipe);
+    uint8_t header[TS_SIZE];
+    size_t header_size = upipe_ts_encaps_write_ts(upipe, header, payload_size,
+                                                  start, pcr_prog, random,
+                                                  discontinuity);
 
+    struct ubuf *ubuf = ubuf_block_alloc(encaps->ubuf_mgr, header_size);
+    uint8_t *buffer;
+    int size = -1;
+    if (unlikely(ubuf == NULL ||
+                 !ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer)))) {
+        ubuf_free(ubuf);
+        return NULL;
+    }
+    assert(size == header_size);
+    memcpy(buffer, header, header_size);
     ubuf_block_unmap(ubuf, 0);
     return ubuf;
 }
 
 /** @internal @This splices the input uref and appends to the given ubuf to
  * build a complete TS packet. For PSI sections it may also append padding.
+ * If buffer is not NULL, the payload is copied into it after the header
+ * instead of being appended to a ubuf.
  *
  * @param upipe description structure of the pipe
  * @param ubuf_p appended with the payload of the packet
+ * @param buffer TS_SIZE octets buffer already containing the header, or NULL
+ * @param header_size size of the header in buffer
  * @param dts_sys_p filled in with the DTS, or UINT64_MAX
  * @return an error code
  */
 static int upipe_ts_encaps_complete(struct upipe *upipe, struct ubuf **ubuf_p,
+                                    uint8_t *buffer, size_t header_size,
                                     uint64_t *dts_sys_p)
 {
     struct upipe_ts_encaps *encaps = upipe_ts_encaps_from_upipe(upipe);
     encaps->need_status = true;
     *dts_sys_p = UINT64_MAX;
 
-    size_t ubuf_size;
-    UBASE_RETURN(ubuf_block_size(*ubuf_p, &ubuf_size));
+    size_t ubuf_size = header_size;
+    if (buffer == NULL)
+        UBASE_RETURN(ubuf_block_size(*ubuf_p, &ubuf_size));
     assert(ubuf_size < TS_SIZE);
 
     for ( ; ; ) {
         size_t uref_size = encaps->uref_size;
-        uint64_t header_size = 0;
-        uref_attr_get_priv(encaps->uref, &header_size);
+        uint64_t uref_header_size = 0;
+        uref_attr_get_priv(encaps->uref, &uref_header_size);
 
         uint64_t dts_sys = UINT64_MAX;
         uref_clock_get_dts_sys(encaps->uref, &dts_sys);
 
         if (dts_sys != UINT64_MAX && *dts_sys_p == UINT64_MAX)
             *dts_sys_p = dts_sys -
-                (uint64_t)(uref_size - header_size) * UCLOCK_FREQ /
+                (uint64_t)(uref_size - uref_header_size) * UCLOCK_FREQ /
                 encaps->tb_rate;
 
-        struct ubuf *payload = uref_detach_ubuf(encaps->uref);
+        struct ubuf *payload = NULL;
+        if (buffer != NULL) {
+            size_t payload_size = uref_size < TS_SIZE - ubuf_size ?
+                                  uref_size : TS_SIZE - ubuf_size;
+            if (unlikely(!ubase_check(uref_block_extract(encaps->uref, 0,
+                                payload_size, buffer + ubuf_size))))
+                return UBASE_ERR_INVALID;
+            if (uref_size > payload_size)
+                uref_block_resize(encaps->uref, payload_size, -1);
+        } else
+            payload = uref_detach_ubuf(encaps->uref);
+
         if (uref_size >= TS_SIZE - ubuf_size) {
             size_t payload_size = TS_SIZE - ubuf_size;
             assert(payload_size);
-            uref_attach_ubuf(encaps->uref,
-                             ubuf_block_split(payload, payload_size));
+            if (buffer == NULL)
+                uref_attach_ubuf(encaps->uref,
+                                 ubuf_block_split(payload, payload_size));
             encaps->uref_size -= payload_size;
             encaps->au_size -= payload_size;
-            if (payload_size >= header_size)
+            if (payload_size >= uref_header_size)
                 uref_attr_set_priv(encaps->uref, 0);
             else
-                uref_attr_set_priv(encaps->uref, header_size - payload_size);
+                uref_attr_set_priv(encaps->uref,
+                                   uref_header_size - payload_size);
             encaps->tb_buffer -= payload_size;
         } else {
             encaps->tb_buffer -= uref_size;
             encaps->au_size -= uref_size;
         }
 
-        if (unlikely(payload == NULL ||
+        if (buffer == NULL &&
+            unlikely(payload == NULL ||
                      !ubase_check(ubuf_block_append(*ubuf_p, payload)))) {
             ubuf_free(payload);
             ubuf_free(*ubuf_p);
@@ -1224,7 +1268,10 @@ static int upipe_ts_encaps_complete(struct upipe *upipe, struct ubuf **ubuf_p,
         }
     }
 
-    if (ubuf_size < TS_SIZE) {
+    if (ubuf_size < TS_SIZE && buffer != NULL) {
+        /* With PSI, pad with 0xff */
+        memset(buffer + ubuf_size, 0xff, TS_SIZE - ubuf_size);
+    } else if (ubuf_size < TS_SIZE) {
         /* With PSI, pad with 0xff */
         struct ubuf *padding = ubuf_dup(encaps->padding);
         if (unlikely(padding == NULL ||
@@ -1241,16 +1288,19 @@ static int upipe_ts_encaps_complete(struct upipe *upipe, struct ubuf **ubuf_p,
 }
 
 /** @This returns a ubuf containing a TS packet, and the dts_sys of the packet.
+ * Alternatively, if buffer is not NULL, the TS packet is written to it.
  *
  * @param upipe description structure of the pipe
  * @param cr_sys_min date at which the packet will be muxed
  * @param cr_sys_max maximum date allowed for muxing
  * @param ubuf_p filled in with a pointer to the ubuf (may be NULL)
+ * @param buffer TS_SIZE octets buffer to write the packet to, or NULL
  * @param dts_sys_p filled in with the dts_sys, or UINT64_MAX
  * @return an error code
  */
 static int _upipe_ts_encaps_splice(struct upipe *upipe, uint64_t cr_sys_min,
-        uint64_t cr_sys_max, struct ubuf **ubuf_p, uint64_t *dts_sys_p)
+        uint64_t cr_sys_max, struct ubuf **ubuf_p, uint8_t *buffer,
+        uint64_t *dts_sys_p)
 {
     struct upipe_ts_encaps *encaps = upipe_ts_encaps_from_upipe(upipe);
     if (encaps->ubuf_mgr == NULL)
@@ -1264,7 +1314,7 @@ static int _upipe_ts_encaps_splice(struct upipe *upipe, uint64_t cr_sys_min,
     }
     encaps->last_splice = cr_sys_min;
 
-    if (ubuf_p == NULL) {
+    if (ubuf_p == NULL && buffer == NULL) {
         /* Flush until cr_sys_min */
         while (encaps->uref != NULL) {
             if (encaps->uref_dts_sys != UINT64_MAX) {
@@ -1306,8 +1356,13 @@ static int _upipe_ts_encaps_splice(struct upipe *upipe, uint64_t cr_sys_min,
         if (unlikely(pcr_prog == UINT64_MAX))
             upipe_dbg(upipe, "adding unnecessary padding (internal error)");
 
-        *ubuf_p = upipe_ts_encaps_build_ts(upipe, 0, false, pcr_prog, false,
-                                           false);
+        if (buffer != NULL) {
+            size_t header_size = upipe_ts_encaps_write_ts(upipe, buffer, 0,
+                    false, pcr_prog, false, false);
+            memset(buffer + header_size, 0xff, TS_SIZE - header_size);
+        } else
+            *ubuf_p = upipe_ts_encaps_build_ts(upipe, 0, false, pcr_prog,
+                                               false, false);
         *dts_sys_p = pcr_prog != UINT64_MAX ? cr_sys_min : UINT64_MAX;
         encaps->need_status = true;
         upipe_ts_encaps_check_status(upipe);
@@ -1321,15 +1376,24 @@ static int _upipe_ts_encaps_splice(struct upipe *upipe, uint64_t cr_sys_min,
     assert(encaps->uref_size);
     assert(encaps->au_size);
 
-    *ubuf_p = upipe_ts_encaps_build_ts(upipe, encaps->au_size, start, pcr_prog,
-            ubase_check(uref_flow_get_random(encaps->uref)),
-            ubase_check(uref_flow_get_discontinuity(encaps->uref)));
-    UBASE_ALLOC_RETURN(*ubuf_p);
+    bool random = ubase_check(uref_flow_get_random(encaps->uref));
+    bool discontinuity =
+        ubase_check(uref_flow_get_discontinuity(encaps->uref));
+    size_t header_size = 0;
+    if (buffer != NULL)
+        header_size = upipe_ts_encaps_write_ts(upipe, buffer, encaps->au_size,
+                start, pcr_prog, random, discontinuity);
+    else {
+        *ubuf_p = upipe_ts_encaps_build_ts(upipe, encaps->au_size, start,
+                pcr_prog, random, discontinuity);
+        UBASE_ALLOC_RETURN(*ubuf_p);
+    }
     uref_block_delete_start(encaps->uref);
     uref_flow_delete_random(encaps->uref);
     uref_flow_delete_discontinuity(encaps->uref);
 
-    UBASE_RETURN(upipe_ts_encaps_complete(upipe, ubuf_p, dts_sys_p));
+    UBASE_RETURN(upipe_ts_encaps_complete(upipe, ubuf_p, buffer, header_size,
+                                          dts_sys_p));
     if (pcr_prog != UINT64_MAX)
         *dts_sys_p = encaps->last_splice;
 
@@ -1428,7 +1492,18 @@ static int upipe_ts_encaps_control(struct upipe *upipe,
             struct ubuf **ubuf_p = va_arg(args, struct ubuf **);
             uint64_t *dts_sys_p = va_arg(args, uint64_t *);
             return _upipe_ts_encaps_splice(upipe, cr_sys_min, cr_sys_max,
-                                           ubuf_p, dts_sys_p);
+                                           ubuf_p, NULL, dts_sys_p);
+        }
+        case UPIPE_TS_ENCAPS_SPLICE_CONTIGUOUS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_ENCAPS_SIGNATURE)
+            uint64_t cr_sys_min = va_arg(args, uint64_t);
+            uint64_t cr_sys_max = va_arg(args, uint64_t);
+            uint8_t *buffer = va_arg(args, uint8_t *);
+            uint64_t *dts_sys_p = va_arg(args, uint64_t *);
+            if (unlikely(buffer == NULL))
+                return UBASE_ERR_INVALID;
+            return _upipe_ts_encaps_splice(upipe, cr_sys_min, cr_sys_max,
+                                           NULL, buffer, dts_sys_p);
         }
         case UPIPE_TS_ENCAPS_EOS: {
             UBASE_SIGNATURE_CHECK(args, UPIPE_TS_ENCAPS_SIGNATURE)
@@ -1476,6 +1551,7 @@ static const char *upipe_ts_encaps_command_str(int cmd)
     switch (cmd) {
         UBASE_CASE_TO_STR(UPIPE_TS_ENCAPS_SET_TB_SIZE);
         UBASE_CASE_TO_STR(UPIPE_TS_ENCAPS_SPLICE);
+        UBASE_CASE_TO_STR(UPIPE_TS_ENCAPS_SPLICE_CONTIGUOUS);
         UBASE_CASE_TO_STR(UPIPE_TS_ENCAPS_EOS);
         default: break;
     }
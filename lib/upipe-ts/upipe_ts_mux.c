@@ -358,6 +358,10 @@ struct upipe_ts_mux {
     struct uref *uref;
     /** size of current aggregation */
     size_t uref_size;
+    /** true if the aggregation is built in a single contiguous buffer */
+    bool contiguous;
+    /** mapped buffer of the current aggregation (contiguous mode) */
+    uint8_t *buffer;
     /** true during the preroll period */
     bool preroll;
 
@@ -2508,6 +2512,8 @@ static struct upipe *upipe_ts_mux_alloc(struct upipe_mgr *mgr,
     upipe_ts_mux->cr_sys_remainder = 0;
     upipe_ts_mux->uref = NULL;
     upipe_ts_mux->uref_size = 0;
+    upipe_ts_mux->contiguous = false;
+    upipe_ts_mux->buffer = NULL;
     upipe_ts_mux->preroll = true;
 
     uprobe_init(&upipe_ts_mux->probe, upipe_ts_mux_probe, NULL);
@@ -2627,14 +2633,41 @@ static uint64_t upipe_ts_mux_show_increment(struct upipe *upipe)
         mux->total_octetrate;
 }
 
+/** @internal @This splices a packet from an encaps pipe, either as a ubuf
+ * or written to the given buffer.
+ *
+ * @param upipe description structure of the pipe
+ * @param encaps encaps inner pipe
+ * @param ubuf_p filled in with the ubuf to output
+ * @param buffer buffer to write the packet to, or NULL
+ * @param dts_sys_p filled with the dts_sys of the fragment
+ * @return an error code
+ */
+static int upipe_ts_mux_splice_encaps(struct upipe *upipe,
+                                      struct upipe *encaps,
+                                      struct ubuf **ubuf_p, uint8_t *buffer,
+                                      uint64_t *dts_sys_p)
+{
+    struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
+    uint64_t original_cr_sys = mux->cr_sys - mux->latency;
+    if (buffer != NULL)
+        return upipe_ts_encaps_splice_contiguous(encaps, original_cr_sys,
+                original_cr_sys + mux->interval, buffer, dts_sys_p);
+    return upipe_ts_encaps_splice(encaps, original_cr_sys,
+            original_cr_sys + mux->interval, ubuf_p, dts_sys_p);
+}
+
 /** @internal @This splices a ubuf to output.
  *
  * @param upipe description structure of the pipe
  * @param ubuf_p filled in with the ubuf to output, or NULL if none is available
+ * @param buffer buffer to write the packet to instead of allocating a ubuf,
+ * or NULL
  * @param dts_sys_p filled with the dts_sys of the fragment
+ * @return true if a packet was spliced
  */
-static void upipe_ts_mux_splice(struct upipe *upipe, struct ubuf **ubuf_p,
-                                uint64_t *dts_sys_p)
+static bool upipe_ts_mux_splice(struct upipe *upipe, struct ubuf **ubuf_p,
+                                uint8_t *buffer, uint64_t *dts_sys_p)
 {
     struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
     uint64_t original_cr_sys = mux->cr_sys - mux->latency;
@@ -2659,15 +2692,15 @@ static void upipe_ts_mux_splice(struct upipe *upipe, struct ubuf **ubuf_p,
         if (psi_pid->cr_sys > original_cr_sys)
             break; /* Too soon */
 
-        err = upipe_ts_encaps_splice(psi_pid->encaps, original_cr_sys,
-                                     original_cr_sys + mux->interval,
-                                     ubuf_p, dts_sys_p);
+        err = upipe_ts_mux_splice_encaps(upipe, psi_pid->encaps, ubuf_p,
+                                         buffer, dts_sys_p);
         if (!ubase_check(err)) {
             upipe_warn(upipe, "internal error in splice");
             upipe_throw_fatal(upipe, err);
+            return false;
         }
         /* No need to pop uchain as the probe does it for us. */
-        return;
+        return buffer != NULL || *ubuf_p != NULL;
     }
 
     /* 2. Inputs */
@@ -2712,12 +2745,11 @@ static void upipe_ts_mux_splice(struct upipe *upipe, struct ubuf **ubuf_p,
 
     if (selected_input == NULL ||
         selected_input->cr_sys > original_cr_sys)
-        return;
+        return false;
 
 upipe_ts_mux_splice_done:
-    err = upipe_ts_encaps_splice(selected_input->encaps, original_cr_sys,
-                                 original_cr_sys + mux->interval,
-                                 ubuf_p, dts_sys_p);
+    err = upipe_ts_mux_splice_encaps(upipe, selected_input->encaps, ubuf_p,
+                                     buffer, dts_sys_p);
     if (!ubase_check(err)) {
         upipe_warn(upipe, "internal error in splice");
         upipe_throw_fatal(upipe, err);
@@ -2727,6 +2759,7 @@ upipe_ts_mux_splice_done:
         /* This triggers the immediate deletion of the input. */
         upipe_release(selected_input->encaps);
     }
+    return ubase_check(err) && (buffer != NULL || *ubuf_p != NULL);
 }
 
 /** @internal @This appends a uref to our buffer.
@@ -2764,6 +2797,124 @@ static void upipe_ts_mux_append(struct upipe *upipe, struct ubuf *ubuf,
     mux->uref_size += TS_SIZE;
 }
 
+/** @internal @This returns the location of the next packet in the
+ * contiguous buffer, allocating it if needed (contiguous mode only).
+ *
+ * @param upipe description structure of the pipe
+ * @return pointer to the next packet, or NULL in case of error
+ */
+static uint8_t *upipe_ts_mux_get_buffer(struct upipe *upipe)
+{
+    struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
+    if (mux->uref == NULL) {
+        struct ubuf *ubuf = ubuf_block_alloc(mux->ubuf_mgr, mux->mtu);
+        mux->uref = uref_alloc(mux->uref_mgr);
+        int size = -1;
+        if (unlikely(ubuf == NULL || mux->uref == NULL ||
+                     !ubase_check(ubuf_block_write(ubuf, 0, &size,
+                                                   &mux->buffer)))) {
+            if (mux->uref != NULL)
+                uref_free(mux->uref);
+            mux->uref = NULL;
+            mux->buffer = NULL;
+            ubuf_free(ubuf);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return NULL;
+        }
+        assert(size == mux->mtu);
+        uref_clock_set_cr_sys(mux->uref, mux->cr_sys - mux->latency);
+        uref_attach_ubuf(mux->uref, ubuf);
+    }
+    return mux->buffer + mux->uref_size;
+}
+
+/** @internal @This accounts for a packet written in the contiguous buffer.
+ *
+ * @param upipe description structure of the pipe
+ * @param dts_sys dts_sys associated with the packet
+ */
+static void upipe_ts_mux_append_buffer(struct upipe *upipe, uint64_t dts_sys)
+{
+    struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
+    uint64_t current_dts_sys;
+    if (dts_sys != UINT64_MAX &&
+        (!ubase_check(uref_clock_get_dts_sys(mux->uref, &current_dts_sys)) ||
+         current_dts_sys > dts_sys))
+        uref_clock_set_cr_dts_delay(mux->uref,
+                dts_sys - (mux->cr_sys - mux->latency));
+    mux->uref_size += TS_SIZE;
+}
+
+/** @internal @This releases the contiguous buffer if no packet was written
+ * in it, so that no empty uref outlives a splice attempt.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_ts_mux_release_buffer(struct upipe *upipe)
+{
+    struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
+    if (mux->uref == NULL || mux->uref_size)
+        return;
+    uref_block_unmap(mux->uref, 0);
+    uref_free(mux->uref);
+    mux->uref = NULL;
+    mux->buffer = NULL;
+}
+
+/** @internal @This splices a packet and appends it to the current
+ * aggregation.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if no packet is available
+ */
+static bool upipe_ts_mux_splice_append(struct upipe *upipe)
+{
+    struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
+    struct ubuf *ubuf;
+    uint64_t dts_sys;
+    if (mux->contiguous) {
+        uint8_t *buffer = upipe_ts_mux_get_buffer(upipe);
+        if (unlikely(buffer == NULL))
+            return false;
+        if (!upipe_ts_mux_splice(upipe, &ubuf, buffer, &dts_sys)) {
+            upipe_ts_mux_release_buffer(upipe);
+            return false;
+        }
+        upipe_ts_mux_append_buffer(upipe, dts_sys);
+        return true;
+    }
+
+    if (!upipe_ts_mux_splice(upipe, &ubuf, NULL, &dts_sys))
+        return false;
+    upipe_ts_mux_append(upipe, ubuf, dts_sys);
+    return true;
+}
+
+/** @internal @This appends a padding packet to the current aggregation.
+ *
+ * @param upipe description structure of the pipe
+ * @return false in case of allocation error
+ */
+static bool upipe_ts_mux_append_padding(struct upipe *upipe)
+{
+    struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
+    if (mux->contiguous) {
+        uint8_t *buffer = upipe_ts_mux_get_buffer(upipe);
+        if (unlikely(buffer == NULL ||
+                     !ubase_check(ubuf_block_extract(mux->padding, 0, TS_SIZE,
+                                                     buffer))))
+            return false;
+        upipe_ts_mux_append_buffer(upipe, UINT64_MAX);
+        return true;
+    }
+
+    struct ubuf *ubuf = ubuf_dup(mux->padding);
+    if (ubuf == NULL)
+        return false;
+    upipe_ts_mux_append(upipe, ubuf, UINT64_MAX);
+    return true;
+}
+
 /** @internal @This completes a uref and outputs it.
  *
  * @param upipe description structure of the pipe
@@ -2773,6 +2924,12 @@ static void upipe_ts_mux_complete(struct upipe *upipe, struct upump **upump_p)
 {
     struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
     struct uref *uref = mux->uref;
+    if (mux->buffer != NULL) {
+        uref_block_unmap(uref, 0);
+        if (mux->uref_size < mux->mtu)
+            uref_block_resize(uref, 0, mux->uref_size);
+        mux->buffer = NULL;
+    }
     mux->uref = NULL;
     mux->uref_size = 0;
     upipe_ts_mux_output(upipe, uref, upump_p);
@@ -2796,12 +2953,8 @@ static void _upipe_ts_mux_watcher(struct upipe *upipe)
 
         while (mux->uref_size < mux->mtu) {
             nb_packets++;
-            struct ubuf *ubuf;
-            uint64_t dts_sys;
-            upipe_ts_mux_splice(upipe, &ubuf, &dts_sys);
-            if (ubuf == NULL)
+            if (!upipe_ts_mux_splice_append(upipe))
                 break;
-            upipe_ts_mux_append(upipe, ubuf, dts_sys);
         }
 
         uint64_t dts_sys;
@@ -2811,10 +2964,8 @@ static void _upipe_ts_mux_watcher(struct upipe *upipe)
              dts_sys + mux->latency < upipe_ts_mux_show_increment(upipe))) {
             while (mux->uref_size < mux->mtu) {
                 nb_packets++;
-                struct ubuf *ubuf = ubuf_dup(mux->padding);
-                if (ubuf == NULL)
+                if (!upipe_ts_mux_append_padding(upipe))
                     break;
-                upipe_ts_mux_append(upipe, ubuf, UINT64_MAX);
             }
         }
 
@@ -2923,11 +3074,8 @@ static void upipe_ts_mux_work_file(struct upipe *upipe, struct upump **upump_p)
             upipe_ts_mux_prepare_psi(upipe, min_cr_sys, 0);
         }
 
-        struct ubuf *ubuf;
         uint64_t dts_sys;
-        upipe_ts_mux_splice(upipe, &ubuf, &dts_sys);
-        if (ubuf != NULL) {
-            upipe_ts_mux_append(upipe, ubuf, dts_sys);
+        if (upipe_ts_mux_splice_append(upipe)) {
             if (mux->uref_size >= mux->mtu) {
                 upipe_ts_mux_complete(upipe, &mux->upump);
                 upipe_ts_mux_increment(upipe);
@@ -2944,10 +3092,8 @@ static void upipe_ts_mux_work_file(struct upipe *upipe, struct upump **upump_p)
         }
 
         while (mux->uref_size < mux->mtu) {
-            struct ubuf *ubuf = ubuf_dup(mux->padding);
-            if (ubuf == NULL)
+            if (!upipe_ts_mux_append_padding(upipe))
                 break;
-            upipe_ts_mux_append(upipe, ubuf, UINT64_MAX);
         }
 
         upipe_ts_mux_complete(upipe, upump_p);
@@ -3567,7 +3713,9 @@ static int upipe_ts_mux_get_output_size(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
-/** @internal @This sets the configured mtu.
+/** @internal @This sets the configured mtu. It cannot be changed while a
+ * contiguous uref, whose buffer was allocated for the current mtu, is
+ * pending.
  *
  * @param upipe description structure of the pipe
  * @param mtu configured mtu, in octets
@@ -3579,6 +3727,9 @@ static int upipe_ts_mux_set_output_size(struct upipe *upipe, unsigned int mtu)
     if (unlikely(mtu < TS_SIZE))
         return UBASE_ERR_INVALID;
     mtu -= mtu % TS_SIZE;
+    if (mtu != upipe_ts_mux->mtu && upipe_ts_mux->contiguous &&
+        upipe_ts_mux->uref != NULL)
+        return UBASE_ERR_BUSY;
     upipe_ts_mux->mtu = mtu;
     if (upipe_ts_mux->total_octetrate)
         upipe_ts_mux->interval = (upipe_ts_mux->mtu * UCLOCK_FREQ +
@@ -4138,6 +4289,38 @@ static int _upipe_ts_mux_set_mode(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This returns whether output packets are contiguous.
+ *
+ * @param upipe description structure of the pipe
+ * @param contiguous_p filled in with the contiguous mode
+ * @return an error code
+ */
+static int _upipe_ts_mux_get_contiguous(struct upipe *upipe,
+                                        bool *contiguous_p)
+{
+    struct upipe_ts_mux *upipe_ts_mux = upipe_ts_mux_from_upipe(upipe);
+    assert(contiguous_p != NULL);
+    *contiguous_p = upipe_ts_mux->contiguous;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets whether output packets are contiguous.
+ *
+ * @param upipe description structure of the pipe
+ * @param contiguous true to build each output uref in a single buffer
+ * @return an error code
+ */
+static int _upipe_ts_mux_set_contiguous(struct upipe *upipe, bool contiguous)
+{
+    struct upipe_ts_mux *upipe_ts_mux = upipe_ts_mux_from_upipe(upipe);
+    if (upipe_ts_mux->contiguous == contiguous)
+        return UBASE_ERR_NONE;
+    if (upipe_ts_mux->uref != NULL)
+        return UBASE_ERR_BUSY;
+    upipe_ts_mux->contiguous = contiguous;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This returns the current encapsulation for AAC streams.
  *
  * @param upipe description structure of the pipe
@@ -4418,6 +4601,16 @@ static int _upipe_ts_mux_control(struct upipe *upipe, int command, va_list args)
             enum upipe_ts_mux_mode mode = va_arg(args, enum upipe_ts_mux_mode);
             return _upipe_ts_mux_set_mode(upipe, mode);
         }
+        case UPIPE_TS_MUX_GET_CONTIGUOUS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_MUX_SIGNATURE)
+            bool *contiguous_p = va_arg(args, bool *);
+            return _upipe_ts_mux_get_contiguous(upipe, contiguous_p);
+        }
+        case UPIPE_TS_MUX_SET_CONTIGUOUS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_MUX_SIGNATURE)
+            int contiguous = va_arg(args, int);
+            return _upipe_ts_mux_set_contiguous(upipe, !!contiguous);
+        }
         case UPIPE_TS_MUX_GET_AAC_ENCAPS: {
             UBASE_SIGNATURE_CHECK(args, UPIPE_TS_MUX_SIGNATURE)
             int *encaps_p = va_arg(args, int *);
@@ -4487,13 +4680,9 @@ static void upipe_ts_mux_free(struct urefcount *urefcount_real)
     struct upipe *upipe = upipe_ts_mux_to_upipe(mux);
 
     if (mux->uref != NULL) {
-        size_t uref_size;
-        while ((ubase_check(uref_block_size(mux->uref, &uref_size)) &&
-                uref_size < mux->mtu)) {
-            struct ubuf *ubuf = ubuf_dup(mux->padding);
-            if (ubuf == NULL)
+        while (mux->uref_size < mux->mtu) {
+            if (!upipe_ts_mux_append_padding(upipe))
                 break;
-            upipe_ts_mux_append(upipe, ubuf, UINT64_MAX);
         }
 
         upipe_ts_mux_complete(upipe, NULL);
@@ -4651,6 +4840,8 @@ const char *upipe_ts_mux_command_str(int cmd)
         UBASE_CASE_TO_STR(UPIPE_TS_MUX_SET_ENCODING);
         UBASE_CASE_TO_STR(UPIPE_TS_MUX_FREEZE_PSI);
         UBASE_CASE_TO_STR(UPIPE_TS_MUX_PREPARE);
+        UBASE_CASE_TO_STR(UPIPE_TS_MUX_GET_CONTIGUOUS);
+        UBASE_CASE_TO_STR(UPIPE_TS_MUX_SET_CONTIGUOUS);
         default: break;
     }
     return NULL;
@@ -41,6 +41,7 @@
 #include <upipe/upipe_helper_flow_def.h>
 #include <upipe-ts/upipe_ts_pat_decoder.h>
 #include <upipe-ts/uref_ts_flow.h>
+#include <upipe-ts/upipe_ts_crc.h>
 #include "upipe_ts_psi_decoder.h"
 
 #include <stdlib.h>
@@ -204,7 +205,7 @@ static bool upipe_ts_patd_table_validate(struct upipe *upipe)
                                                   &section))))
             return false;
 
-        if (!pat_validate(section) || !psi_check_crc(section)) {
+        if (!pat_validate(section) || !upipe_ts_psi_check_crc(section)) {
             uref_block_unmap(section_uref, 0);
             return false;
         }
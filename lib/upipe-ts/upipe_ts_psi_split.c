@@ -37,6 +37,7 @@
 #include <upipe/upipe_helper_subpipe.h>
 #include <upipe-ts/uref_ts_flow.h>
 #include <upipe-ts/upipe_ts_psi_split.h>
+#include <upipe-ts/upipe_ts_crc.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -45,9 +46,17 @@
 #include <assert.h>
 
 #include <bitstream/mpeg/ts.h>
+#include <bitstream/mpeg/psi.h>
 
 /** we only accept blocks containing exactly one PSI section */
 #define EXPECTED_FLOW_DEF "block.mpegtspsi."
+/** initial log2 of the number of fingerprints of an output */
+#define FINGERPRINTS_MIN_BITS 4
+/** maximum log2 of the number of fingerprints of an output (16 EIT schedule
+ * tables of 256 sections) */
+#define FINGERPRINTS_MAX_BITS 12
+/** number of repetitions of a section after which it is forwarded again */
+#define FINGERPRINTS_MAX_REPEATS 8
 
 /** @internal @This is the private context of a ts_psi_split pipe. */
 struct upipe_ts_psi_split {
@@ -59,6 +68,11 @@ struct upipe_ts_psi_split {
     /** list of output subpipes */
     struct uchain subs;
 
+    /** number of received sections */
+    uint64_t sections;
+    /** number of repeated sections not forwarded to an output */
+    uint64_t unchanged;
+
     /** manager to create output subpipes */
     struct upipe_mgr sub_mgr;
 
@@ -76,6 +90,20 @@ UBASE_FROM_TO(upipe_ts_psi_split, urefcount, urefcount_real, urefcount_real)
 /** @hidden */
 static void upipe_ts_psi_split_free(struct urefcount *urefcount_real);
 
+/** @internal @This identifies a section forwarded to an output. */
+struct upipe_ts_psi_split_fingerprint {
+    /** table id, table id extension and section number */
+    uint32_t key;
+    /** CRC of the section */
+    uint32_t crc;
+    /** version of the section */
+    uint8_t version;
+    /** number of repetitions dropped since the section was forwarded */
+    uint8_t repeats;
+    /** true if the entry is in use */
+    bool valid;
+};
+
 /** @internal @This is the private context of an output of a ts_psi_split pipe. */
 struct upipe_ts_psi_split_sub {
     /** refcount management structure */
@@ -92,6 +120,13 @@ struct upipe_ts_psi_split_sub {
     /** list of output requests */
     struct uchain request_list;
 
+    /** true if repeated sections are dropped */
+    bool cache;
+    /** hash table of forwarded sections, or NULL */
+    struct upipe_ts_psi_split_fingerprint *fingerprints;
+    /** log2 of the size of the hash table */
+    unsigned int fingerprints_bits;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -129,11 +164,180 @@ static struct upipe *upipe_ts_psi_split_sub_alloc(struct upipe_mgr *mgr,
     upipe_ts_psi_split_sub_init_output(upipe);
     upipe_ts_psi_split_sub_init_sub(upipe);
     upipe_ts_psi_split_sub_store_flow_def(upipe, flow_def);
+    struct upipe_ts_psi_split_sub *sub =
+        upipe_ts_psi_split_sub_from_upipe(upipe);
+    sub->cache = false;
+    sub->fingerprints = NULL;
+    sub->fingerprints_bits = 0;
 
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This returns the entry of the hash table for a key.
+ *
+ * @param fingerprints hash table
+ * @param bits log2 of the size of the hash table
+ * @param key table id, table id extension and section number
+ * @return pointer to the entry
+ */
+static inline struct upipe_ts_psi_split_fingerprint *
+    upipe_ts_psi_split_sub_entry(
+            struct upipe_ts_psi_split_fingerprint *fingerprints,
+            unsigned int bits, uint32_t key)
+{
+    return &fingerprints[(key * UINT32_C(2654435761)) >> (32 - bits)];
+}
+
+/** @internal @This doubles the size of the hash table of an output.
+ *
+ * @param upipe description structure of the output subpipe
+ */
+static void upipe_ts_psi_split_sub_grow(struct upipe *upipe)
+{
+    struct upipe_ts_psi_split_sub *sub =
+        upipe_ts_psi_split_sub_from_upipe(upipe);
+    unsigned int bits = sub->fingerprints ? sub->fingerprints_bits + 1 :
+                        FINGERPRINTS_MIN_BITS;
+    struct upipe_ts_psi_split_fingerprint *fingerprints =
+        calloc(1 << bits, sizeof(struct upipe_ts_psi_split_fingerprint));
+    if (unlikely(fingerprints == NULL))
+        return;
+
+    if (sub->fingerprints != NULL) {
+        for (unsigned int i = 0; i < 1 << sub->fingerprints_bits; i++)
+            if (sub->fingerprints[i].valid)
+                *upipe_ts_psi_split_sub_entry(fingerprints, bits,
+                        sub->fingerprints[i].key) = sub->fingerprints[i];
+        free(sub->fingerprints);
+    }
+    sub->fingerprints = fingerprints;
+    sub->fingerprints_bits = bits;
+}
+
+/** @internal @This forgets all forwarded sections of an output.
+ *
+ * @param upipe description structure of the output subpipe
+ */
+static void upipe_ts_psi_split_sub_flush_cache(struct upipe *upipe)
+{
+    struct upipe_ts_psi_split_sub *sub =
+        upipe_ts_psi_split_sub_from_upipe(upipe);
+    free(sub->fingerprints);
+    sub->fingerprints = NULL;
+    sub->fingerprints_bits = 0;
+}
+
+/** @internal @This checks if a section was already forwarded to an output,
+ * and otherwise records it if its CRC is valid. Only the header and the CRC
+ * of repeated sections are read.
+ *
+ * A section is recorded before the decoder sees it, and the decoder may
+ * still reject its table (for instance if sections of different tables
+ * are mixed during a version change). Repetitions are thus forwarded again
+ * every @ref FINGERPRINTS_MAX_REPEATS times so that the decoder eventually
+ * gets a complete table.
+ *
+ * @param upipe description structure of the output subpipe
+ * @param uref PSI section
+ * @return true if the section is a repetition
+ */
+static bool upipe_ts_psi_split_sub_repeated(struct upipe *upipe,
+                                            struct uref *uref)
+{
+    struct upipe_ts_psi_split_sub *sub =
+        upipe_ts_psi_split_sub_from_upipe(upipe);
+    uint8_t buffer[PSI_HEADER_SIZE_SYNTAX1];
+    const uint8_t *header = uref_block_peek(uref, 0, PSI_HEADER_SIZE_SYNTAX1,
+                                            buffer);
+    if (unlikely(header == NULL))
+        return false;
+    bool syntax = psi_get_syntax(header);
+    uint16_t length = psi_get_length(header);
+    uint32_t key = (psi_get_tableid(header) << 24) |
+                   (psi_get_tableidext(header) << 8) |
+                   psi_get_section(header);
+    uint8_t version = psi_get_version(header);
+    uref_block_peek_unmap(uref, 0, buffer, header);
+
+    /* sections without syntax (TDT, TOT, SCTE-35) change every time */
+    if (!syntax ||
+        length < PSI_HEADER_SIZE_SYNTAX1 - PSI_HEADER_SIZE + PSI_CRC_SIZE)
+        return false;
+
+    int offset = PSI_HEADER_SIZE + length - PSI_CRC_SIZE;
+    uint8_t crc_buffer[PSI_CRC_SIZE];
+    const uint8_t *crc_p = uref_block_peek(uref, offset, PSI_CRC_SIZE,
+                                           crc_buffer);
+    if (unlikely(crc_p == NULL))
+        return false;
+    uint32_t crc = (crc_p[0] << 24) | (crc_p[1] << 16) | (crc_p[2] << 8) |
+                   crc_p[3];
+    uref_block_peek_unmap(uref, offset, crc_buffer, crc_p);
+
+    if (sub->fingerprints == NULL)
+        upipe_ts_psi_split_sub_grow(upipe);
+    if (unlikely(sub->fingerprints == NULL))
+        return false;
+
+    struct upipe_ts_psi_split_fingerprint *entry =
+        upipe_ts_psi_split_sub_entry(sub->fingerprints,
+                                     sub->fingerprints_bits, key);
+    if (entry->valid && entry->key == key) {
+        if (entry->version == version && entry->crc == crc) {
+            if (++entry->repeats < FINGERPRINTS_MAX_REPEATS)
+                return true;
+            entry->repeats = 0;
+            return false;
+        }
+
+        /* the table changed, forward all its sections again */
+        for (unsigned int i = 0; i < 1 << sub->fingerprints_bits; i++)
+            if ((sub->fingerprints[i].key & 0xffffff00) ==
+                    (key & 0xffffff00))
+                sub->fingerprints[i].valid = false;
+    } else if (entry->valid &&
+               sub->fingerprints_bits < FINGERPRINTS_MAX_BITS) {
+        upipe_ts_psi_split_sub_grow(upipe);
+        entry = upipe_ts_psi_split_sub_entry(sub->fingerprints,
+                                             sub->fingerprints_bits, key);
+    }
+
+    /* do not remember corrupt sections, as their header and CRC may be
+     * intact */
+    const uint8_t *section;
+    int size = -1;
+    if (unlikely(!ubase_check(uref_block_read(uref, 0, &size, &section))))
+        return false;
+    bool valid = size >= offset + PSI_CRC_SIZE &&
+                 upipe_ts_psi_check_crc(section);
+    uref_block_unmap(uref, 0);
+
+    entry->valid = valid;
+    if (valid) {
+        entry->key = key;
+        entry->crc = crc;
+        entry->version = version;
+        entry->repeats = 0;
+    }
+    return false;
+}
+
+/** @internal @This sets whether repeated sections are dropped.
+ *
+ * @param upipe description structure of the output subpipe
+ * @param cache true to drop repeated sections
+ * @return an error code
+ */
+static int _upipe_ts_psi_split_sub_set_cache(struct upipe *upipe, bool cache)
+{
+    struct upipe_ts_psi_split_sub *sub =
+        upipe_ts_psi_split_sub_from_upipe(upipe);
+    sub->cache = cache;
+    upipe_ts_psi_split_sub_flush_cache(upipe);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on an output subpipe of a
  * ts_psi_split pipe.
  *
@@ -156,12 +360,25 @@ static int upipe_ts_psi_split_sub_control(struct upipe *upipe,
         }
         case UPIPE_SET_OUTPUT: {
             struct upipe *output = va_arg(args, struct upipe *);
+            /* a new decoder needs all sections */
+            upipe_ts_psi_split_sub_flush_cache(upipe);
             return upipe_ts_psi_split_sub_set_output(upipe, output);
         }
         case UPIPE_SUB_GET_SUPER: {
             struct upipe **p = va_arg(args, struct upipe **);
             return upipe_ts_psi_split_sub_get_super(upipe, p);
         }
+        case UPIPE_TS_PSI_SPLIT_OUTPUT_GET_CACHE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_PSI_SPLIT_OUTPUT_SIGNATURE)
+            int *p = va_arg(args, int *);
+            *p = upipe_ts_psi_split_sub_from_upipe(upipe)->cache ? 1 : 0;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_TS_PSI_SPLIT_OUTPUT_SET_CACHE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_PSI_SPLIT_OUTPUT_SIGNATURE)
+            int cache = va_arg(args, int);
+            return _upipe_ts_psi_split_sub_set_cache(upipe, !!cache);
+        }
 
         default:
             return UBASE_ERR_UNHANDLED;
@@ -176,6 +393,7 @@ static void upipe_ts_psi_split_sub_free(struct upipe *upipe)
 {
     upipe_throw_dead(upipe);
 
+    upipe_ts_psi_split_sub_flush_cache(upipe);
     upipe_ts_psi_split_sub_clean_output(upipe);
     upipe_ts_psi_split_sub_clean_sub(upipe);
     upipe_ts_psi_split_sub_clean_urefcount(upipe);
@@ -223,6 +441,8 @@ static struct upipe *upipe_ts_psi_split_alloc(struct upipe_mgr *mgr,
                    upipe_ts_psi_split_free);
     upipe_ts_psi_split_init_sub_mgr(upipe);
     upipe_ts_psi_split_init_sub_subs(upipe);
+    upipe_ts_psi_split->sections = 0;
+    upipe_ts_psi_split->unchanged = 0;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -238,6 +458,7 @@ static void upipe_ts_psi_split_input(struct upipe *upipe, struct uref *uref,
 {
     struct upipe_ts_psi_split *upipe_ts_psi_split =
         upipe_ts_psi_split_from_upipe(upipe);
+    upipe_ts_psi_split->sections++;
     struct uchain *uchain;
     ulist_foreach (&upipe_ts_psi_split->subs, uchain) {
         struct upipe_ts_psi_split_sub *output =
@@ -247,6 +468,12 @@ static void upipe_ts_psi_split_input(struct upipe *upipe, struct uref *uref,
         if (ubase_check(uref_ts_flow_get_psi_filter(output->flow_def, &filter,
                         &mask, &size)) &&
             ubase_check(uref_block_match(uref, filter, mask, size))) {
+            if (output->cache &&
+                upipe_ts_psi_split_sub_repeated(
+                    upipe_ts_psi_split_sub_to_upipe(output), uref)) {
+                upipe_ts_psi_split->unchanged++;
+                continue;
+            }
             if (likely(uchain->next == NULL)) {
                 upipe_ts_psi_split_sub_output(
                         upipe_ts_psi_split_sub_to_upipe(output), uref,
@@ -315,6 +542,16 @@ static int upipe_ts_psi_split_control(struct upipe *upipe,
             struct upipe **p = va_arg(args, struct upipe **);
             return upipe_ts_psi_split_iterate_sub(upipe, p);
         }
+        case UPIPE_TS_PSI_SPLIT_GET_STATS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_PSI_SPLIT_SIGNATURE)
+            uint64_t *sections_p = va_arg(args, uint64_t *);
+            uint64_t *unchanged_p = va_arg(args, uint64_t *);
+            struct upipe_ts_psi_split *upipe_ts_psi_split =
+                upipe_ts_psi_split_from_upipe(upipe);
+            *sections_p = upipe_ts_psi_split->sections;
+            *unchanged_p = upipe_ts_psi_split->unchanged;
+            return UBASE_ERR_NONE;
+        }
 
         default:
             return UBASE_ERR_UNHANDLED;
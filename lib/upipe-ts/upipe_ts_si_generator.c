@@ -52,6 +52,7 @@
 #include <upipe-ts/upipe_ts_mux.h>
 #include <upipe-ts/uref_ts_flow.h>
 #include <upipe-ts/uref_ts_event.h>
+#include <upipe-ts/upipe_ts_crc.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -551,7 +552,7 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
 
         eit_set_segment_last_sec_number(buffer, nb_sections - 1);
         psi_set_lastsection(buffer, nb_sections - 1);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
@@ -663,7 +664,7 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
             psi_set_lastsection(buffer, nb_sections - 1);
         }
         eit_set_last_table_id(buffer, table_id);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
@@ -1304,7 +1305,7 @@ static void upipe_ts_sig_build_nit(struct upipe *upipe)
         }
 
         psi_set_lastsection(buffer, nb_sections - 1);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
@@ -1562,7 +1563,7 @@ static void upipe_ts_sig_build_sdt(struct upipe *upipe)
         }
 
         psi_set_lastsection(buffer, nb_sections - 1);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
@@ -46,7 +46,7 @@
 
 #include <bitstream/mpeg/ts.h>
 
-/** we only accept blocks containing exactly one TS packet */
+/** we only accept blocks containing TS packets */
 #define EXPECTED_FLOW_DEF "block.mpegts."
 /** maximum number of PIDs */
 #define MAX_PIDS 8192
@@ -57,6 +57,8 @@ struct upipe_ts_split_pid {
     struct uchain subs;
     /** true if we asked for this PID */
     bool set;
+    /** uref being aggregated for this PID in the current input block */
+    struct uref *pending;
 };
 
 /** @internal @This is the private context of a ts split pipe. */
@@ -69,6 +71,9 @@ struct upipe_ts_split {
     /** list of output subpipes */
     struct uchain subs;
 
+    /** true if packets of a multi-packet block are aggregated per PID */
+    bool aggregate;
+
     /** PIDs array */
     struct upipe_ts_split_pid pids[MAX_PIDS];
 
@@ -266,10 +271,12 @@ static struct upipe *upipe_ts_split_alloc(struct upipe_mgr *mgr,
     upipe_ts_split_init_sub_mgr(upipe);
     upipe_ts_split_init_sub_subs(upipe);
 
+    upipe_ts_split->aggregate = false;
     int i;
     for (i = 0; i < MAX_PIDS; i++) {
         ulist_init(&upipe_ts_split->pids[i].subs);
         upipe_ts_split->pids[i].set = false;
+        upipe_ts_split->pids[i].pending = NULL;
     }
     upipe_throw_ready(upipe);
     return upipe;
@@ -338,27 +345,18 @@ static void upipe_ts_split_pid_unset(struct upipe *upipe, uint16_t pid,
     upipe_ts_split_pid_check(upipe, pid);
 }
 
-/** @internal @This demuxes a TS packet to the appropriate output(s).
+/** @internal @This outputs a uref to all outputs of the given PID.
  *
  * @param upipe description structure of the pipe
+ * @param pid PID
  * @param uref uref structure
  * @param upump_p reference to pump that generated the buffer
  */
-static void upipe_ts_split_input(struct upipe *upipe, struct uref *uref,
-                                 struct upump **upump_p)
+static void upipe_ts_split_output_pid(struct upipe *upipe, uint16_t pid,
+                                      struct uref *uref,
+                                      struct upump **upump_p)
 {
     struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
-    uint8_t buffer[TS_HEADER_SIZE];
-    const uint8_t *ts_header = uref_block_peek(uref, 0, TS_HEADER_SIZE,
-                                               buffer);
-    if (unlikely(ts_header == NULL)) {
-        uref_free(uref);
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return;
-    }
-    uint16_t pid = ts_get_pid(ts_header);
-    UBASE_FATAL(upipe, uref_block_peek_unmap(uref, 0, buffer, ts_header))
-
     struct uchain *uchain;
     ulist_foreach (&upipe_ts_split->pids[pid].subs, uchain) {
         struct upipe_ts_split_sub *output =
@@ -384,6 +382,172 @@ static void upipe_ts_split_input(struct upipe *upipe, struct uref *uref,
         uref_free(uref);
 }
 
+/** @internal @This slices a run of consecutive packets of the same PID out
+ * of a multi-packet block, and either appends it to the uref being
+ * aggregated for this PID, or queues it as a new aggregated uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch list of urefs to output
+ * @param uref input multi-packet block
+ * @param pid PID of the packets
+ * @param offset offset of the first packet in the block
+ * @param size size of the run of packets
+ * @return an error code
+ */
+static int upipe_ts_split_slice(struct upipe *upipe, struct uchain *batch,
+                                struct uref *uref, uint16_t pid,
+                                int offset, int size)
+{
+    struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
+    struct upipe_ts_split_pid *split_pid = &upipe_ts_split->pids[pid];
+
+    if (split_pid->pending != NULL) {
+        struct ubuf *ubuf = ubuf_block_splice(uref->ubuf, offset, size);
+        UBASE_ALLOC_RETURN(ubuf)
+        int err = uref_block_append(split_pid->pending, ubuf);
+        if (unlikely(!ubase_check(err)))
+            ubuf_free(ubuf);
+        return err;
+    }
+
+    struct uref *output = uref_block_splice(uref, offset, size);
+    UBASE_ALLOC_RETURN(output)
+    output->priv = pid;
+    ulist_add(batch, uref_to_uchain(output));
+    split_pid->pending = output;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This demuxes a block containing several TS packets. Packets
+ * are sliced out of the block without copying and output in order; in
+ * aggregate mode, all packets of a PID are output in a single uref once the
+ * whole block has been sliced.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param size size of the block
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_split_input_multi(struct upipe *upipe, struct uref *uref,
+                                       size_t size, struct upump **upump_p)
+{
+    struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
+    int nb_packets = size / TS_SIZE;
+    if (unlikely(size % TS_SIZE))
+        upipe_warn_va(upipe, "dropping %zu trailing octets", size % TS_SIZE);
+
+    struct uchain batch;
+    ulist_init(&batch);
+    const uint8_t *segment = NULL;
+    int segment_offset = 0, segment_size = 0;
+    uint16_t run_pid = MAX_PIDS;
+    int run_start = 0;
+    int err = UBASE_ERR_NONE;
+    int i;
+    for (i = 0; i <= nb_packets && ubase_check(err); i++) {
+        int offset = i * TS_SIZE;
+        uint16_t pid = MAX_PIDS;
+        if (i < nb_packets) {
+            /* read the headers directly from the mapped segment */
+            if (offset + TS_HEADER_SIZE > segment_offset + segment_size) {
+                if (segment != NULL)
+                    uref_block_unmap(uref, segment_offset);
+                segment = NULL;
+                segment_offset = offset;
+                segment_size = -1;
+                err = uref_block_read(uref, offset, &segment_size, &segment);
+                if (unlikely(!ubase_check(err)))
+                    break;
+            }
+            if (likely(offset + TS_HEADER_SIZE <=
+                       segment_offset + segment_size))
+                pid = ts_get_pid(segment + offset - segment_offset);
+            else {
+                /* header spanning two segments */
+                uint8_t buffer[TS_HEADER_SIZE];
+                const uint8_t *ts_header = uref_block_peek(uref, offset,
+                        TS_HEADER_SIZE, buffer);
+                if (unlikely(ts_header == NULL)) {
+                    err = UBASE_ERR_ALLOC;
+                    break;
+                }
+                pid = ts_get_pid(ts_header);
+                uref_block_peek_unmap(uref, offset, buffer, ts_header);
+            }
+            if (upipe_ts_split->aggregate && pid == run_pid)
+                continue;
+        }
+
+        if (run_pid < MAX_PIDS &&
+            !ulist_empty(&upipe_ts_split->pids[run_pid].subs)) {
+            if (upipe_ts_split->aggregate)
+                err = upipe_ts_split_slice(upipe, &batch, uref, run_pid,
+                                           run_start * TS_SIZE,
+                                           (i - run_start) * TS_SIZE);
+            else {
+                /* output right away, as outputs may add PIDs (for
+                 * instance a PAT adding PMT PIDs) found later in the
+                 * same block */
+                struct uref *output = uref_block_splice(uref,
+                        run_start * TS_SIZE, TS_SIZE);
+                if (unlikely(output == NULL))
+                    err = UBASE_ERR_ALLOC;
+                else
+                    upipe_ts_split_output_pid(upipe, run_pid, output,
+                                              upump_p);
+            }
+        }
+        run_pid = pid;
+        run_start = i;
+    }
+    if (segment != NULL)
+        uref_block_unmap(uref, segment_offset);
+    uref_free(uref);
+
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&batch)) != NULL) {
+        struct uref *output = uref_from_uchain(uchain);
+        uint16_t pid = output->priv;
+        upipe_ts_split->pids[pid].pending = NULL;
+        if (likely(ubase_check(err)))
+            upipe_ts_split_output_pid(upipe, pid, output, upump_p);
+        else
+            uref_free(output);
+    }
+    if (unlikely(!ubase_check(err)))
+        upipe_throw_fatal(upipe, err);
+}
+
+/** @internal @This demuxes TS packets to the appropriate output(s).
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_split_input(struct upipe *upipe, struct uref *uref,
+                                 struct upump **upump_p)
+{
+    size_t size;
+    if (unlikely(ubase_check(uref_block_size(uref, &size)) &&
+                 size > TS_SIZE)) {
+        upipe_ts_split_input_multi(upipe, uref, size, upump_p);
+        return;
+    }
+
+    uint8_t buffer[TS_HEADER_SIZE];
+    const uint8_t *ts_header = uref_block_peek(uref, 0, TS_HEADER_SIZE,
+                                               buffer);
+    if (unlikely(ts_header == NULL)) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    uint16_t pid = ts_get_pid(ts_header);
+    UBASE_FATAL(upipe, uref_block_peek_unmap(uref, 0, buffer, ts_header))
+
+    upipe_ts_split_output_pid(upipe, pid, uref, upump_p);
+}
+
 /** @internal @This sets the input flow definition.
  *
  * @param upipe description structure of the pipe
@@ -430,6 +594,19 @@ static int upipe_ts_split_control(struct upipe *upipe,
             return upipe_ts_split_iterate_sub(upipe, p);
         }
 
+        case UPIPE_TS_SPLIT_GET_AGGREGATE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_SPLIT_SIGNATURE)
+            bool *aggregate_p = va_arg(args, bool *);
+            *aggregate_p = upipe_ts_split_from_upipe(upipe)->aggregate;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_TS_SPLIT_SET_AGGREGATE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_SPLIT_SIGNATURE)
+            bool aggregate = va_arg(args, int);
+            upipe_ts_split_from_upipe(upipe)->aggregate = aggregate;
+            return UBASE_ERR_NONE;
+        }
+
         default:
             return UBASE_ERR_UNHANDLED;
     }
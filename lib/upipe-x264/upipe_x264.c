@@ -31,12 +31,15 @@
 
 #include <upipe/uclock.h>
 #include <upipe/ulist.h>
+#include <upipe/ueventfd.h>
+#include <upipe/upump.h>
 #include <upipe/uprobe.h>
 #include <upipe/udict.h>
 #include <upipe/uref.h>
 #include <upipe/uref_flow.h>
 #include <upipe/uref_clock.h>
 #include <upipe/uref_dump.h>
+#include <upipe/uref_attr.h>
 #include <upipe/umem.h>
 #include <upipe/ubuf.h>
 #include <upipe/uref_pic.h>
@@ -50,6 +53,8 @@
 #include <upipe/upipe_helper_void.h>
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_uclock.h>
+#include <upipe/upipe_helper_upump_mgr.h>
+#include <upipe/upipe_helper_upump.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
 #include <upipe/upipe_helper_flow_format.h>
@@ -66,7 +71,9 @@
 #include <strings.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <limits.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #include <x264.h>
 #include <bitstream/mpeg/h264.h>
@@ -76,6 +83,9 @@
 #define OUT_FLOW "block.h264.pic."
 #define OUT_FLOW_MPEG2 "block.mpeg2video.pic."
 
+UREF_ATTR_UNSIGNED(x264, date, "x.x264_date", x264 input date)
+UREF_ATTR_UNSIGNED(x264, error, "x.x264_error", x264 encoding error)
+
 /** @internal upipe_x264 private structure */
 struct upipe_x264 {
     /** refcount management structure */
@@ -159,6 +169,36 @@ struct upipe_x264 {
     /** last input PTS (system time) */
     uint64_t input_pts_sys;
 
+    /** upump manager */
+    struct upump_mgr *upump_mgr;
+    /** watcher of the frames encoded by the thread */
+    struct upump *upump;
+
+    /** length of the queue of the encoding thread, or 0 */
+    unsigned int thread_queue_length;
+    /** true if the encoding thread is running */
+    bool thread_running;
+    /** encoding thread */
+    pthread_t thread;
+    /** ubuf manager used by the encoding thread */
+    struct ubuf_mgr *thread_ubuf_mgr;
+    /** wakes up the pipe when frames are encoded */
+    struct ueventfd thread_event;
+    /** protects the fields below */
+    pthread_mutex_t thread_mutex;
+    /** signals pictures to encode, or the end, to the encoding thread */
+    pthread_cond_t thread_cond;
+    /** true if the encoding thread must exit once its queue is empty */
+    bool thread_exit;
+    /** pictures waiting to be encoded */
+    struct uchain thread_in;
+    /** number of pictures in thread_in */
+    unsigned int nb_thread_in;
+    /** encoded frames waiting to be output */
+    struct uchain thread_out;
+    /** number of frames in thread_out */
+    unsigned int nb_thread_out;
+
     /** public structure */
     struct upipe upipe;
 };
@@ -172,6 +212,10 @@ static int upipe_x264_check_flow_format(struct upipe *upipe,
 /** @hidden */
 static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
                               struct upump **upump_p);
+/** @hidden */
+static void upipe_x264_stop_thread(struct upipe *upipe);
+/** @hidden */
+static void upipe_x264_build_flow_def(struct upipe *upipe);
 
 UPIPE_HELPER_UPIPE(upipe_x264, upipe, UPIPE_X264_SIGNATURE);
 UPIPE_HELPER_UREFCOUNT(upipe_x264, urefcount, upipe_x264_free)
@@ -189,6 +233,8 @@ UPIPE_HELPER_UBUF_MGR(upipe_x264, ubuf_mgr, flow_format, ubuf_mgr_request,
                       upipe_x264_register_output_request,
                       upipe_x264_unregister_output_request)
 UPIPE_HELPER_UCLOCK(upipe_x264, uclock, uclock_request, NULL, upipe_throw_provide_request, NULL)
+UPIPE_HELPER_UPUMP_MGR(upipe_x264, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_x264, upump, upump_mgr)
 
 /** @internal loglevel map from x264 to uprobe_log */
 static const enum uprobe_log_level loglevel_map[] = {
@@ -344,6 +390,10 @@ static int _upipe_x264_set_sc_latency(struct upipe *upipe, uint64_t sc_latency)
     return UBASE_ERR_EXTERNAL;
 #else
     struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    if (sc_latency && upipe_x264->thread_queue_length) {
+        upipe_err(upipe, "speedcontrol is not available in threaded mode");
+        return UBASE_ERR_INVALID;
+    }
     upipe_x264->sc_latency = sc_latency;
     upipe_dbg_va(upipe, "activating speed control with latency %"PRIu64" ms",
                  sc_latency * 1000 / UCLOCK_FREQ);
@@ -366,6 +416,115 @@ static int _upipe_x264_set_slice_type_enforce(struct upipe *upipe, bool enforce)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This applies a latency preset on top of the current
+ * parameters.
+ *
+ * @param upipe description structure of the pipe
+ * @param preset latency preset
+ * @return an error code
+ */
+static int _upipe_x264_set_latency_preset(struct upipe *upipe,
+                                          enum upipe_x264_latency_preset preset)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    x264_param_t *params = &upipe_x264->params;
+    switch (preset) {
+        case UPIPE_X264_LATENCY_PRESET_LOW:
+            /* same as the zerolatency tuning of x264 */
+            params->b_sliced_threads = 1;
+            params->i_sync_lookahead = 0;
+            params->rc.i_lookahead = 0;
+            params->rc.b_mb_tree = 0;
+            params->i_bframe = 0;
+            break;
+        case UPIPE_X264_LATENCY_PRESET_BALANCED:
+            params->b_sliced_threads = 1;
+            params->i_sync_lookahead = 0;
+            if (params->rc.i_lookahead > 10)
+                params->rc.i_lookahead = 10;
+            break;
+        case UPIPE_X264_LATENCY_PRESET_THROUGHPUT:
+            params->b_sliced_threads = 0;
+            params->i_sync_lookahead = X264_SYNC_LOOKAHEAD_AUTO;
+            break;
+        default:
+            return UBASE_ERR_INVALID;
+    }
+    upipe_dbg_va(upipe, "applying latency preset %d", preset);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the sliced threads mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param sliced true for sliced threads, false for frame threads
+ * @return an error code
+ */
+static int _upipe_x264_set_sliced_threads(struct upipe *upipe, bool sliced)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    upipe_x264->params.b_sliced_threads = sliced ? 1 : 0;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the number of frames of threaded lookahead.
+ *
+ * @param upipe description structure of the pipe
+ * @param frames number of frames, or -1 for automatic
+ * @return an error code
+ */
+static int _upipe_x264_set_sync_lookahead(struct upipe *upipe, int frames)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    if (frames < X264_SYNC_LOOKAHEAD_AUTO)
+        return UBASE_ERR_INVALID;
+    upipe_x264->params.i_sync_lookahead = frames;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the VBV parameters.
+ *
+ * @param upipe description structure of the pipe
+ * @param octetrate maximum octet rate, or 0 to disable VBV
+ * @param buffer_size size of the VBV buffer in octets
+ * @return an error code
+ */
+static int _upipe_x264_set_vbv(struct upipe *upipe, uint64_t octetrate,
+                               uint64_t buffer_size)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    /* x264 counts in kbit, that is 125 octets */
+    if (octetrate / 125 > INT_MAX || buffer_size / 125 > INT_MAX ||
+        (octetrate && (octetrate < 125 || buffer_size < 125)))
+        return UBASE_ERR_INVALID;
+    upipe_x264->params.rc.i_vbv_max_bitrate = octetrate / 125;
+    upipe_x264->params.rc.i_vbv_buffer_size = octetrate ? buffer_size / 125 : 0;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the length of the queue of the encoding thread.
+ *
+ * @param upipe description structure of the pipe
+ * @param queue_length length of the queue, or 0 to disable the thread
+ * @return an error code
+ */
+static int _upipe_x264_set_threaded(struct upipe *upipe,
+                                    unsigned int queue_length)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    if (queue_length && upipe_x264->sc_latency) {
+        upipe_err(upipe, "speedcontrol is not available in threaded mode");
+        return UBASE_ERR_INVALID;
+    }
+    upipe_x264_stop_thread(upipe);
+    upipe_x264->thread_queue_length = queue_length;
+    if (!queue_length)
+        upipe_x264_set_upump(upipe, NULL);
+    if (upipe_x264->encoder != NULL && upipe_x264->flow_def_requested != NULL)
+        upipe_x264_build_flow_def(upipe);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This allocates a filter pipe.
  *
  * @param mgr common management structure
@@ -413,6 +572,20 @@ static struct upipe *upipe_x264_alloc(struct upipe_mgr *mgr,
     upipe_x264->input_pts = UINT64_MAX;
     upipe_x264->input_pts_sys = UINT64_MAX;
 
+    upipe_x264_init_upump_mgr(upipe);
+    upipe_x264_init_upump(upipe);
+    upipe_x264->thread_queue_length = 0;
+    upipe_x264->thread_running = false;
+    upipe_x264->thread_ubuf_mgr = NULL;
+    ueventfd_init(&upipe_x264->thread_event, false);
+    pthread_mutex_init(&upipe_x264->thread_mutex, NULL);
+    pthread_cond_init(&upipe_x264->thread_cond, NULL);
+    upipe_x264->thread_exit = false;
+    ulist_init(&upipe_x264->thread_in);
+    upipe_x264->nb_thread_in = 0;
+    ulist_init(&upipe_x264->thread_out);
+    upipe_x264->nb_thread_out = 0;
+
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -648,6 +821,7 @@ static bool upipe_x264_open(struct upipe *upipe, int width, int height)
 static void upipe_x264_close(struct upipe *upipe)
 {
     struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    upipe_x264_stop_thread(upipe);
     if (upipe_x264->encoder) {
         while(x264_encoder_delayed_frames(upipe_x264->encoder)) {
             upipe_x264_handle(upipe, NULL, NULL);
@@ -666,6 +840,8 @@ static void upipe_x264_build_flow_def(struct upipe *upipe)
 {
     struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
     assert(upipe_x264->flow_def_requested != NULL);
+    /* the thread is stopped on every change of the flow definition */
+    assert(!upipe_x264->thread_running);
 
     struct uref *flow_def = uref_dup(upipe_x264->flow_def_requested);
     if (unlikely(flow_def == NULL)) {
@@ -683,6 +859,10 @@ static void upipe_x264_build_flow_def(struct upipe *upipe)
     /* add one frame for the time of encoding the current frame */
     latency += UCLOCK_FREQ * upipe_x264->params.i_fps_den /
                upipe_x264->params.i_fps_num;
+    /* and the frames waiting for the encoding thread */
+    latency += (uint64_t)upipe_x264->thread_queue_length * UCLOCK_FREQ
+                 * upipe_x264->params.i_fps_den
+                 / upipe_x264->params.i_fps_num;
     upipe_x264->initial_latency = latency;
 
     latency += upipe_x264->sc_latency;
@@ -734,70 +914,32 @@ static inline bool upipe_x264_need_update(struct upipe *upipe,
             params->vui.i_overscan != upipe_x264->overscan);
 }
 
-/** @internal @This processes pictures.
+/** @internal @This encodes a picture, or flushes a delayed frame. When the
+ * encoding thread is running, this is called from it and the encoder
+ * belongs to it, so errors are not thrown here but returned, to be thrown
+ * by @ref upipe_x264_output_encoded.
  *
  * @param upipe description structure of the pipe
- * @param uref uref structure
- * @param upump_p reference to upump structure
- * @return true if the packet was handled
+ * @param uref_p reference to the picture to encode, or to NULL to flush a
+ * delayed frame; written with the encoded frame, with a uref without ubuf if
+ * the picture could not be encoded, or with NULL if x264 returned nothing
+ * @param ubuf_mgr ubuf manager for the encoded frame
+ * @return an error code
  */
-static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
-                              struct upump **upump_p)
+static int upipe_x264_encode(struct upipe *upipe, struct uref **uref_p,
+                             struct ubuf_mgr *ubuf_mgr)
 {
     struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
-    const char *def;
-    if (unlikely(uref != NULL && ubase_check(uref_flow_get_def(uref, &def)))) {
-        upipe_x264->input_latency = 0;
-        uref_clock_get_latency(uref, &upipe_x264->input_latency);
-        upipe_x264_store_flow_def(upipe, NULL);
-        uref_free(upipe_x264->flow_def_requested);
-        upipe_x264->flow_def_requested = NULL;
-
-        if (upipe_x264_mpeg2_enabled(upipe)) {
-            struct urational dar;
-            dar.num = 4;
-            dar.den = 3;
-            uref_pic_flow_infer_dar(uref, &dar);
-            if (dar.num == 4 && dar.den == 3)
-                upipe_x264->mpeg2_ar = 2;
-            else if (dar.num == 16 && dar.den == 9)
-                upipe_x264->mpeg2_ar = 3;
-            else if (dar.num == 221 && dar.den == 100)
-                upipe_x264->mpeg2_ar = 4;
-            else {
-                upipe_warn_va(upipe,
-                        "unrecognized aspect ratio %"PRId64"/%"PRIu64", using square",
-                        dar.num, dar.den);
-                upipe_x264->mpeg2_ar = 1;
-            }
-        } else {
-            upipe_x264->sar.num = upipe_x264->sar.den = 1;
-            uref_pic_flow_get_sar(uref, &upipe_x264->sar);
-            bool overscan;
-            if (!ubase_check(uref_pic_flow_get_overscan(uref, &overscan)))
-                upipe_x264->overscan = 0; /* undef */
-            else
-                upipe_x264->overscan = overscan ? 2 : 1;
-        }
-
-        uref = upipe_x264_store_flow_def_input(upipe, uref);
-        if (uref != NULL) {
-            uref_pic_flow_clear_format(uref);
-            upipe_x264_require_flow_format(upipe, uref);
-        }
-        return true;
-    }
-
+    struct uref *uref = *uref_p;
     static const char *const chromas[] = {"y8", "u8", "v8"};
-    size_t width, height;
     x264_picture_t pic;
     x264_nal_t *nals;
     int i, nals_num, size = 0, header_size = 0;
     struct ubuf *ubuf_block;
     uint8_t *buf = NULL;
     x264_param_t curparams;
-    bool needopen = false;
     int ret = 0;
+    int err = UBASE_ERR_NONE;
 
     /* init x264 picture */
     x264_picture_init(&pic);
@@ -806,38 +948,9 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
         pic.opaque = uref;
         pic.img.i_csp = X264_CSP_I420;
 
-        uref_pic_size(uref, &width, &height, NULL);
-
-        /* open encoder if not already opened or if update needed */
-        if (unlikely(!upipe_x264->encoder)) {
-            needopen = true;
-        } else if (unlikely(upipe_x264_need_update(upipe, width, height))) {
-            x264_param_t *params = &upipe_x264_from_upipe(upipe)->params;
-            upipe_notice_va(upipe, "Flow parameters changed, reconfiguring encoder (%d:%zu, %d:%zu, %d:%"PRId64", %d:%"PRIu64", %d:%d)",
-                params->i_width, width, params->i_height, height,
-                params->vui.i_sar_width, upipe_x264->sar.num,
-                params->vui.i_sar_height, upipe_x264->sar.den,
-                params->vui.i_overscan, upipe_x264->overscan);
-            needopen = true;
-        }
-        if (unlikely(needopen)) {
-            if (unlikely(!upipe_x264_open(upipe, width, height))) {
-                upipe_err(upipe, "Could not open encoder");
-                uref_free(uref);
-                return true;
-            }
-        }
-        if (upipe_x264->flow_def_requested == NULL)
-            return false;
-
-        x264_encoder_parameters(upipe_x264->encoder, &curparams);
-
         /* set pts in x264 timebase */
         pic.i_pts = upipe_x264->x264_ts;
         upipe_x264->x264_ts++;
-        uref_clock_get_rate(uref, &upipe_x264->drift_rate);
-        uref_clock_get_pts_prog(uref, &upipe_x264->input_pts);
-        uref_clock_get_pts_sys(uref, &upipe_x264->input_pts_sys);
 
         pic.i_type = X264_TYPE_AUTO;
         if (upipe_x264->slice_type_enforce) {
@@ -884,10 +997,8 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
                                               NULL, NULL, NULL)) ||
                          !ubase_check(uref_pic_plane_read(uref, chromas[i], 0, 0, -1, -1,
                                               &plane)))) {
-                upipe_err_va(upipe, "Could not read origin chroma %s",
-                             chromas[i]);
-                uref_free(uref);
-                return true;
+                ubuf_free(uref_detach_ubuf(uref));
+                return UBASE_ERR_INVALID;
             }
             pic.img.i_stride[i] = stride;
             /* cast needed because of x264 API */
@@ -909,21 +1020,20 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
         /* NULL uref, flushing delayed frame */
         ret = x264_encoder_encode(upipe_x264->encoder,
                                   &nals, &nals_num, NULL, &pic);
-        x264_encoder_parameters(upipe_x264->encoder, &curparams);
     }
-    
-    if (unlikely(ret < 0)) {
-        upipe_warn(upipe, "Error encoding frame");
-        uref_free(uref);
-        return true;
-    } else if (unlikely(ret == 0)) {
-        upipe_verbose(upipe, "No nal units returned");
-        return true;
+    x264_encoder_parameters(upipe_x264->encoder, &curparams);
+
+    if (unlikely(ret < 0))
+        return UBASE_ERR_EXTERNAL;
+    else if (unlikely(ret == 0)) {
+        *uref_p = NULL;
+        return UBASE_ERR_NONE;
     }
 
     /* get uref back */
     uref = pic.opaque;
     assert(uref);
+    *uref_p = uref;
 
     for (i = 0; i < nals_num; i++) {
         size += nals[i].i_payload;
@@ -934,18 +1044,19 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
     }
 
     /* alloc ubuf, map, copy, unmap */
-    ubuf_block = ubuf_block_alloc(upipe_x264->ubuf_mgr, size);
-    if (unlikely(ubuf_block == NULL)) {
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return true;
-    }
+    ubuf_block = ubuf_block_alloc(ubuf_mgr, size);
+    if (unlikely(ubuf_block == NULL))
+        return UBASE_ERR_ALLOC;
     ubuf_block_write(ubuf_block, 0, &size, &buf);
     memcpy(buf, nals[0].p_payload, size);
     ubuf_block_unmap(ubuf_block, 0);
     uref_attach_ubuf(uref, ubuf_block);
     uref_block_set_header_size(uref, header_size);
 
-    if (!upipe_x264_mpeg2_enabled(upipe)) {
+#ifdef HAVE_X264_MPEG2
+    if (!curparams.b_mpeg2)
+#endif
+    {
         /* NAL offsets */
         uint64_t offset = 0;
         for (i = 0; i < nals_num - 1; i++) {
@@ -954,17 +1065,12 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
         }
 
         /* optionally convert NAL encapsulation */
-        enum uref_h26x_encaps encaps = upipe_x264->params.b_annexb ?
+        enum uref_h26x_encaps encaps = curparams.b_annexb ?
             UREF_H26X_ENCAPS_ANNEXB : UREF_H26X_ENCAPS_LENGTH4;
         /* no need for annex B header because if annexb is requested, there
          * will be no conversion */
-        int err = upipe_h26xf_convert_frame(uref,
-                encaps, upipe_x264->encaps_requested, upipe_x264->ubuf_mgr,
-                NULL);
-        if (!ubase_check(err)) {
-            upipe_warn(upipe, "invalid NAL encapsulation conversion");
-            upipe_throw_error(upipe, err);
-        }
+        err = upipe_h26xf_convert_frame(uref,
+                encaps, upipe_x264->encaps_requested, ubuf_mgr, NULL);
     }
 
     /* set dts */
@@ -974,6 +1080,23 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
     uref_clock_set_dts_pts_delay(uref, dts_pts_delay);
     uref_clock_delete_cr_dts_delay(uref);
 
+    if (pic.b_keyframe) {
+        uref_flow_set_random(uref);
+    }
+    return err;
+}
+
+/** @internal @This dates an encoded frame and outputs it.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref encoded frame
+ * @param upump_p reference to upump structure
+ */
+static void upipe_x264_output_frame(struct upipe *upipe, struct uref *uref,
+                                    struct upump **upump_p)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+
     /* rebase to dts as we're in encoded domain now */
     uint64_t dts = UINT64_MAX;
     if ((!ubase_check(uref_clock_get_dts_prog(uref, &dts)) ||
@@ -1026,14 +1149,336 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
     }
 #endif
 
-    if (pic.b_keyframe) {
-        uref_flow_set_random(uref);
+    /* measured latency, from the input of the picture */
+    uint64_t date;
+    if (ubase_check(uref_x264_get_date(uref, &date))) {
+        uref_x264_delete_date(uref);
+        if (upipe_x264->uclock != NULL)
+            upipe_throw(upipe, UPROBE_X264_LATENCY, UPIPE_X264_SIGNATURE,
+                        uclock_now(upipe_x264->uclock) - date);
     }
 
     if (upipe_x264->flow_def == NULL)
         upipe_x264_build_flow_def(upipe);
 
     upipe_x264_output(upipe, uref, upump_p);
+}
+
+/** @internal @This throws the error returned by @ref upipe_x264_encode and
+ * outputs the encoded frame, if any.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref encoded frame, uref without ubuf or NULL
+ * @param err error code returned by @ref upipe_x264_encode
+ * @param upump_p reference to upump structure
+ */
+static void upipe_x264_output_encoded(struct upipe *upipe, struct uref *uref,
+                                      int err, struct upump **upump_p)
+{
+    if (uref != NULL && uref->ubuf != NULL) {
+        if (unlikely(!ubase_check(err))) {
+            upipe_warn(upipe, "invalid NAL encapsulation conversion");
+            upipe_throw_error(upipe, err);
+        }
+        upipe_x264_output_frame(upipe, uref, upump_p);
+        return;
+    }
+
+    if (uref != NULL) {
+        /* the error of the encoding thread could not be stored */
+        if (ubase_check(err))
+            err = UBASE_ERR_ALLOC;
+        uref_free(uref);
+    }
+    switch (err) {
+        case UBASE_ERR_NONE:
+            upipe_verbose(upipe, "No nal units returned");
+            break;
+        case UBASE_ERR_ALLOC:
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            break;
+        case UBASE_ERR_EXTERNAL:
+            upipe_warn(upipe, "Error encoding frame");
+            break;
+        default:
+            upipe_err(upipe, "Could not read origin chroma planes");
+            break;
+    }
+}
+
+/** @internal @This is the main loop of the encoding thread.
+ *
+ * @param _upipe description structure of the pipe
+ * @return NULL
+ */
+static void *upipe_x264_thread(void *_upipe)
+{
+    struct upipe *upipe = _upipe;
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+
+    pthread_mutex_lock(&upipe_x264->thread_mutex);
+    for ( ; ; ) {
+        /* do not encode more than the pipe can take back, unless exiting */
+        while (!upipe_x264->thread_exit &&
+               (ulist_empty(&upipe_x264->thread_in) ||
+                upipe_x264->nb_thread_out >= upipe_x264->thread_queue_length))
+            pthread_cond_wait(&upipe_x264->thread_cond,
+                              &upipe_x264->thread_mutex);
+        struct uchain *uchain = ulist_pop(&upipe_x264->thread_in);
+        if (uchain == NULL)
+            break;
+        upipe_x264->nb_thread_in--;
+        pthread_mutex_unlock(&upipe_x264->thread_mutex);
+
+        struct uref *uref = uref_from_uchain(uchain);
+        int err = upipe_x264_encode(upipe, &uref,
+                                    upipe_x264->thread_ubuf_mgr);
+        /* errors are thrown by the pipe */
+        if (uref != NULL && !ubase_check(err))
+            uref_x264_set_error(uref, err);
+
+        pthread_mutex_lock(&upipe_x264->thread_mutex);
+        if (uref != NULL) {
+            ulist_add(&upipe_x264->thread_out, uref_to_uchain(uref));
+            upipe_x264->nb_thread_out++;
+        }
+        /* also wake up the pipe when only an input slot was freed */
+        ueventfd_write(&upipe_x264->thread_event);
+    }
+    pthread_mutex_unlock(&upipe_x264->thread_mutex);
+    return NULL;
+}
+
+/** @internal @This outputs the frames encoded by the thread.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to upump structure
+ */
+static void upipe_x264_output_thread(struct upipe *upipe,
+                                     struct upump **upump_p)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    for ( ; ; ) {
+        pthread_mutex_lock(&upipe_x264->thread_mutex);
+        struct uchain *uchain = ulist_pop(&upipe_x264->thread_out);
+        if (uchain != NULL) {
+            upipe_x264->nb_thread_out--;
+            pthread_cond_signal(&upipe_x264->thread_cond);
+        }
+        pthread_mutex_unlock(&upipe_x264->thread_mutex);
+        if (uchain == NULL)
+            break;
+
+        struct uref *uref = uref_from_uchain(uchain);
+        uint64_t err = UBASE_ERR_NONE;
+        if (ubase_check(uref_x264_get_error(uref, &err)))
+            uref_x264_delete_error(uref);
+        upipe_x264_output_encoded(upipe, uref, err, upump_p);
+    }
+}
+
+/** @internal @This waits for the encoding thread to encode all queued
+ * pictures, stops it and outputs the remaining frames. The delayed frames
+ * stay in the encoder.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_x264_stop_thread(struct upipe *upipe)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    if (!upipe_x264->thread_running)
+        return;
+
+    pthread_mutex_lock(&upipe_x264->thread_mutex);
+    upipe_x264->thread_exit = true;
+    pthread_cond_signal(&upipe_x264->thread_cond);
+    pthread_mutex_unlock(&upipe_x264->thread_mutex);
+    pthread_join(upipe_x264->thread, NULL);
+
+    upipe_x264->thread_running = false;
+    upipe_x264->thread_exit = false;
+    ubuf_mgr_release(upipe_x264->thread_ubuf_mgr);
+    upipe_x264->thread_ubuf_mgr = NULL;
+    upipe_x264_output_thread(upipe, NULL);
+}
+
+/** @internal @This is called when the encoding thread has encoded a
+ * picture.
+ *
+ * @param upump description structure of the watcher
+ */
+static void upipe_x264_thread_cb(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+
+    ueventfd_read(&upipe_x264->thread_event);
+    upipe_x264_output_thread(upipe, &upipe_x264->upump);
+
+    /* feed the pictures held while the queue was full */
+    bool was_buffered = !upipe_x264_check_input(upipe);
+    if (was_buffered && upipe_x264_output_input(upipe)) {
+        upipe_x264_unblock_input(upipe);
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_x264_input. */
+        upipe_release(upipe);
+    }
+}
+
+/** @internal @This starts the encoding thread if needed.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the thread could not be started
+ */
+static bool upipe_x264_start_thread(struct upipe *upipe)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    if (likely(upipe_x264->thread_running))
+        return true;
+
+    upipe_x264_check_upump_mgr(upipe);
+    if (unlikely(upipe_x264->upump_mgr == NULL))
+        return false;
+
+    if (upipe_x264->upump == NULL) {
+        struct upump *upump = ueventfd_upump_alloc(&upipe_x264->thread_event,
+                upipe_x264->upump_mgr, upipe_x264_thread_cb, upipe,
+                upipe->refcount);
+        if (unlikely(upump == NULL))
+            return false;
+        upump_start(upump);
+        upipe_x264_set_upump(upipe, upump);
+    }
+
+    upipe_x264->thread_ubuf_mgr = ubuf_mgr_use(upipe_x264->ubuf_mgr);
+    if (unlikely(pthread_create(&upipe_x264->thread, NULL, upipe_x264_thread,
+                                upipe) != 0)) {
+        ubuf_mgr_release(upipe_x264->thread_ubuf_mgr);
+        upipe_x264->thread_ubuf_mgr = NULL;
+        return false;
+    }
+    upipe_x264->thread_running = true;
+    upipe_dbg_va(upipe, "started encoding thread with a queue of %u",
+                 upipe_x264->thread_queue_length);
+    return true;
+}
+
+/** @internal @This processes pictures.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to upump structure
+ * @return true if the packet was handled
+ */
+static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
+                              struct upump **upump_p)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    const char *def;
+    if (unlikely(uref != NULL && ubase_check(uref_flow_get_def(uref, &def)))) {
+        /* frames of the previous flow are output first */
+        upipe_x264_stop_thread(upipe);
+
+        upipe_x264->input_latency = 0;
+        uref_clock_get_latency(uref, &upipe_x264->input_latency);
+        upipe_x264_store_flow_def(upipe, NULL);
+        uref_free(upipe_x264->flow_def_requested);
+        upipe_x264->flow_def_requested = NULL;
+
+        if (upipe_x264_mpeg2_enabled(upipe)) {
+            struct urational dar;
+            dar.num = 4;
+            dar.den = 3;
+            uref_pic_flow_infer_dar(uref, &dar);
+            if (dar.num == 4 && dar.den == 3)
+                upipe_x264->mpeg2_ar = 2;
+            else if (dar.num == 16 && dar.den == 9)
+                upipe_x264->mpeg2_ar = 3;
+            else if (dar.num == 221 && dar.den == 100)
+                upipe_x264->mpeg2_ar = 4;
+            else {
+                upipe_warn_va(upipe,
+                        "unrecognized aspect ratio %"PRId64"/%"PRIu64", using square",
+                        dar.num, dar.den);
+                upipe_x264->mpeg2_ar = 1;
+            }
+        } else {
+            upipe_x264->sar.num = upipe_x264->sar.den = 1;
+            uref_pic_flow_get_sar(uref, &upipe_x264->sar);
+            bool overscan;
+            if (!ubase_check(uref_pic_flow_get_overscan(uref, &overscan)))
+                upipe_x264->overscan = 0; /* undef */
+            else
+                upipe_x264->overscan = overscan ? 2 : 1;
+        }
+
+        uref = upipe_x264_store_flow_def_input(upipe, uref);
+        if (uref != NULL) {
+            uref_pic_flow_clear_format(uref);
+            upipe_x264_require_flow_format(upipe, uref);
+        }
+        return true;
+    }
+
+    if (likely(uref)) {
+        size_t width, height;
+        bool needopen = false;
+
+        uref_pic_size(uref, &width, &height, NULL);
+
+        /* open encoder if not already opened or if update needed */
+        if (unlikely(!upipe_x264->encoder)) {
+            needopen = true;
+        } else if (unlikely(upipe_x264_need_update(upipe, width, height))) {
+            x264_param_t *params = &upipe_x264_from_upipe(upipe)->params;
+            upipe_notice_va(upipe, "Flow parameters changed, reconfiguring encoder (%d:%zu, %d:%zu, %d:%"PRId64", %d:%"PRIu64", %d:%d)",
+                params->i_width, width, params->i_height, height,
+                params->vui.i_sar_width, upipe_x264->sar.num,
+                params->vui.i_sar_height, upipe_x264->sar.den,
+                params->vui.i_overscan, upipe_x264->overscan);
+            needopen = true;
+        }
+        if (unlikely(needopen)) {
+            upipe_x264_stop_thread(upipe);
+            if (unlikely(!upipe_x264_open(upipe, width, height))) {
+                upipe_err(upipe, "Could not open encoder");
+                uref_free(uref);
+                return true;
+            }
+        }
+        if (upipe_x264->flow_def_requested == NULL)
+            return false;
+
+        uint64_t date;
+        if (upipe_x264->uclock != NULL &&
+            !ubase_check(uref_x264_get_date(uref, &date)))
+            uref_x264_set_date(uref, uclock_now(upipe_x264->uclock));
+
+        uref_clock_get_rate(uref, &upipe_x264->drift_rate);
+        uref_clock_get_pts_prog(uref, &upipe_x264->input_pts);
+        uref_clock_get_pts_sys(uref, &upipe_x264->input_pts_sys);
+
+        if (upipe_x264->thread_queue_length) {
+            if (unlikely(!upipe_x264_start_thread(upipe))) {
+                upipe_warn(upipe, "unable to start the encoding thread");
+                upipe_x264->thread_queue_length = 0;
+            } else {
+                pthread_mutex_lock(&upipe_x264->thread_mutex);
+                bool full = upipe_x264->nb_thread_in >=
+                            upipe_x264->thread_queue_length;
+                if (!full) {
+                    ulist_add(&upipe_x264->thread_in, uref_to_uchain(uref));
+                    upipe_x264->nb_thread_in++;
+                    pthread_cond_signal(&upipe_x264->thread_cond);
+                }
+                pthread_mutex_unlock(&upipe_x264->thread_mutex);
+                return !full;
+            }
+        }
+    }
+
+    int err = upipe_x264_encode(upipe, &uref, upipe_x264->ubuf_mgr);
+    upipe_x264_output_encoded(upipe, uref, err, upump_p);
     return true;
 }
 
@@ -1071,6 +1516,7 @@ static int upipe_x264_check_flow_format(struct upipe *upipe,
     if (flow_format == NULL)
         return UBASE_ERR_INVALID;
 
+    upipe_x264_stop_thread(upipe);
     upipe_x264->headers_requested =
         ubase_check(uref_flow_get_global(flow_format));
     upipe_x264->encaps_requested = uref_h26x_flow_infer_encaps(flow_format);
@@ -1099,6 +1545,7 @@ static int upipe_x264_check_ubuf_mgr(struct upipe *upipe,
     if (flow_format == NULL)
         return UBASE_ERR_NONE; /* should not happen */
 
+    upipe_x264_stop_thread(upipe);
     uref_free(upipe_x264->flow_def_requested);
     upipe_x264->flow_def_requested = flow_format;
     upipe_x264_build_flow_def(upipe);
@@ -1235,6 +1682,10 @@ static int upipe_x264_control(struct upipe *upipe, int command, va_list args)
         case UPIPE_ATTACH_UCLOCK:
             upipe_x264_require_uclock(upipe);
             return UBASE_ERR_NONE;
+        case UPIPE_ATTACH_UPUMP_MGR:
+            upipe_x264_stop_thread(upipe);
+            upipe_x264_set_upump(upipe, NULL);
+            return upipe_x264_attach_upump_mgr(upipe);
         case UPIPE_REGISTER_REQUEST: {
             struct urequest *request = va_arg(args, struct urequest *);
             if (request->type == UREQUEST_UBUF_MGR)
@@ -1270,6 +1721,7 @@ static int upipe_x264_control(struct upipe *upipe, int command, va_list args)
 
         case UPIPE_X264_RECONFIG: {
             UBASE_SIGNATURE_CHECK(args, UPIPE_X264_SIGNATURE)
+            upipe_x264_stop_thread(upipe);
             return _upipe_x264_reconfigure(upipe);
         }
         case UPIPE_X264_SET_DEFAULT: {
@@ -1304,8 +1756,41 @@ static int upipe_x264_control(struct upipe *upipe, int command, va_list args)
         case UPIPE_X264_SET_SLICE_TYPE_ENFORCE: {
             UBASE_SIGNATURE_CHECK(args, UPIPE_X264_SIGNATURE)
             bool enforce = !(va_arg(args, int) == 0);
+            upipe_x264_stop_thread(upipe);
             return _upipe_x264_set_slice_type_enforce(upipe, enforce);
         }
+        case UPIPE_X264_SET_LATENCY_PRESET: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X264_SIGNATURE)
+            enum upipe_x264_latency_preset preset = va_arg(args, int);
+            return _upipe_x264_set_latency_preset(upipe, preset);
+        }
+        case UPIPE_X264_SET_SLICED_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X264_SIGNATURE)
+            bool sliced = !(va_arg(args, int) == 0);
+            return _upipe_x264_set_sliced_threads(upipe, sliced);
+        }
+        case UPIPE_X264_SET_SYNC_LOOKAHEAD: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X264_SIGNATURE)
+            int frames = va_arg(args, int);
+            return _upipe_x264_set_sync_lookahead(upipe, frames);
+        }
+        case UPIPE_X264_SET_VBV: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X264_SIGNATURE)
+            uint64_t octetrate = va_arg(args, uint64_t);
+            uint64_t buffer_size = va_arg(args, uint64_t);
+            return _upipe_x264_set_vbv(upipe, octetrate, buffer_size);
+        }
+        case UPIPE_X264_GET_THREADED: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X264_SIGNATURE)
+            unsigned int *queue_length_p = va_arg(args, unsigned int *);
+            *queue_length_p = upipe_x264_from_upipe(upipe)->thread_queue_length;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_X264_SET_THREADED: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X264_SIGNATURE)
+            unsigned int queue_length = va_arg(args, unsigned int);
+            return _upipe_x264_set_threaded(upipe, queue_length);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -1321,6 +1806,11 @@ static void upipe_x264_free(struct upipe *upipe)
     upipe_x264_close(upipe);
 
     upipe_throw_dead(upipe);
+    upipe_x264_clean_upump(upipe);
+    upipe_x264_clean_upump_mgr(upipe);
+    ueventfd_clean(&upipe_x264->thread_event);
+    pthread_cond_destroy(&upipe_x264->thread_cond);
+    pthread_mutex_destroy(&upipe_x264->thread_mutex);
     upipe_x264_clean_uclock(upipe);
     upipe_x264_clean_ubuf_mgr(upipe);
     upipe_x264_clean_input(upipe);
@@ -1337,6 +1827,7 @@ static void upipe_x264_free(struct upipe *upipe)
 static struct upipe_mgr upipe_x264_mgr = {
     .refcount = NULL,
     .signature = UPIPE_X264_SIGNATURE,
+    .upipe_event_str = upipe_x264_event_str,
     .upipe_alloc = upipe_x264_alloc,
     .upipe_input = upipe_x264_input,
     .upipe_control = upipe_x264_control,
@@ -0,0 +1,695 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe picture blitting with alpha blending
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/ubuf_pic.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/** @internal @This is the set of line kernels used by the blitter. All of
+ * them process w samples; in the keyed and alpha plane variants, the alpha
+ * of sample j is a[j * a_step] * alpha / 255. */
+struct ubuf_pic_blend {
+    /** blends two lines of octets with a constant alpha */
+    void (*const8)(uint8_t *d, const uint8_t *s, int w, uint8_t alpha);
+    /** blends two lines of octets with an alpha plane */
+    void (*blend8)(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                   int a_step, int w, uint8_t alpha);
+    /** copies the octets whose alpha is above the threshold */
+    void (*key8)(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                 int a_step, int w, uint8_t alpha, uint8_t threshold);
+    /** blends two lines of 16-bit samples with a constant alpha */
+    void (*const16)(uint16_t *d, const uint16_t *s, int w, uint8_t alpha);
+    /** blends two lines of 16-bit samples with an alpha plane */
+    void (*blend16)(uint16_t *d, const uint16_t *s, const uint8_t *a,
+                    int a_step, int w, uint8_t alpha);
+    /** copies the 16-bit samples whose alpha is above the threshold */
+    void (*key16)(uint16_t *d, const uint16_t *s, const uint8_t *a,
+                  int a_step, int w, uint8_t alpha, uint8_t threshold);
+};
+
+/** @internal @This returns the alpha of a sample. */
+static inline uint8_t blend_alpha(const uint8_t *a, int j, int a_step,
+                                  uint8_t alpha)
+{
+    return (uint16_t)a[j * a_step] * (uint16_t)alpha / 0xff;
+}
+
+static void blend_const8_c(uint8_t *d, const uint8_t *s, int w, uint8_t alpha)
+{
+    for (int j = 0; j < w; j++)
+        d[j] = (d[j] * (0xff - alpha) + s[j] * alpha) / 0xff;
+}
+
+static void blend_blend8_c(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                           int a_step, int w, uint8_t alpha)
+{
+    for (int j = 0; j < w; j++) {
+        const uint8_t k = blend_alpha(a, j, a_step, alpha);
+        d[j] = (d[j] * (0xff - k) + s[j] * k) / 0xff;
+    }
+}
+
+static void blend_key8_c(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                         int a_step, int w, uint8_t alpha, uint8_t threshold)
+{
+    for (int j = 0; j < w; j++)
+        if (blend_alpha(a, j, a_step, alpha) > threshold)
+            d[j] = s[j];
+}
+
+static void blend_const16_c(uint16_t *d, const uint16_t *s, int w,
+                            uint8_t alpha)
+{
+    for (int j = 0; j < w; j++)
+        d[j] = ((uint32_t)d[j] * (0xff - alpha) +
+                (uint32_t)s[j] * alpha) / 0xff;
+}
+
+static void blend_blend16_c(uint16_t *d, const uint16_t *s, const uint8_t *a,
+                            int a_step, int w, uint8_t alpha)
+{
+    for (int j = 0; j < w; j++) {
+        const uint8_t k = blend_alpha(a, j, a_step, alpha);
+        d[j] = ((uint32_t)d[j] * (0xff - k) + (uint32_t)s[j] * k) / 0xff;
+    }
+}
+
+static void blend_key16_c(uint16_t *d, const uint16_t *s, const uint8_t *a,
+                          int a_step, int w, uint8_t alpha, uint8_t threshold)
+{
+    for (int j = 0; j < w; j++)
+        if (blend_alpha(a, j, a_step, alpha) > threshold)
+            d[j] = s[j];
+}
+
+/** @internal @This is the portable C implementation. */
+static const struct ubuf_pic_blend blend_c = {
+    .const8 = blend_const8_c,
+    .blend8 = blend_blend8_c,
+    .key8 = blend_key8_c,
+    .const16 = blend_const16_c,
+    .blend16 = blend_blend16_c,
+    .key16 = blend_key16_c,
+};
+
+#if defined(__i386__) || defined(__x86_64__)
+/* The SIMD kernels compute exactly the same values as the C code:
+ * - x / 255 is (x + 1 + (x >> 8)) >> 8 for 0 <= x <= 255 * 255,
+ * - x / 255 is (y + (y >> 16)) >> 16 with y = (x + 1) * 257 for
+ *   0 <= x <= 32767 * 255, which covers samples of up to 15 bits blended
+ *   with _mm_madd_epi16. 16-bit planes of higher depths use the C code.
+ * Tails and unusual alpha subsamplings are left to the C code as well. */
+
+/** @internal @This divides 16-bit lanes by 255. */
+#define SSE_DIV255_16(x)                                                    \
+    _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)),      \
+                                 _mm_srli_epi16(x, 8)), 8)
+
+/** @internal @This divides 32-bit lanes by 255. */
+#define SSE_DIV255_32(x) __extension__ ({                                   \
+    __m128i y_ = _mm_add_epi32(x, _mm_set1_epi32(1));                       \
+    y_ = _mm_add_epi32(y_, _mm_slli_epi32(y_, 8));                          \
+    _mm_srli_epi32(_mm_add_epi32(y_, _mm_srli_epi32(y_, 16)), 16); })
+
+/** @internal @This loads 8 alpha values into 16-bit lanes, scaled by
+ * alpha unless it is 255. */
+__attribute__((target("sse2")))
+static inline __m128i sse2_alpha8x16(const uint8_t *a, int a_step,
+                                     __m128i alpha)
+{
+    __m128i k;
+    if (a_step == 1)
+        k = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)a),
+                              _mm_setzero_si128());
+    else
+        k = _mm_and_si128(_mm_loadu_si128((const __m128i *)a),
+                          _mm_set1_epi16(0xff));
+    return SSE_DIV255_16(_mm_mullo_epi16(k, alpha));
+}
+
+/** @internal @This loads 16 alpha values into 16-bit lanes (lo, hi),
+ * scaled by alpha. */
+__attribute__((target("sse2")))
+static inline void sse2_alpha16x16(const uint8_t *a, int a_step,
+                                   __m128i alpha, __m128i *lo, __m128i *hi)
+{
+    *lo = sse2_alpha8x16(a, a_step, alpha);
+    *hi = sse2_alpha8x16(a + 8 * a_step, a_step, alpha);
+}
+
+/** @internal @This blends 8 pairs of 16-bit lanes holding 8-bit values. */
+__attribute__((target("sse2")))
+static inline __m128i sse2_mix8(__m128i d, __m128i s, __m128i k)
+{
+    __m128i x = _mm_add_epi16(
+        _mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(0xff), k)),
+        _mm_mullo_epi16(s, k));
+    return SSE_DIV255_16(x);
+}
+
+/** @internal @This blends 8 samples of up to 15 bits. */
+__attribute__((target("sse2")))
+static inline __m128i sse2_mix16(__m128i d, __m128i s, __m128i k)
+{
+    __m128i ik = _mm_sub_epi16(_mm_set1_epi16(0xff), k);
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(d, s),
+                                _mm_unpacklo_epi16(ik, k));
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(d, s),
+                                _mm_unpackhi_epi16(ik, k));
+    return _mm_packs_epi32(SSE_DIV255_32(lo), SSE_DIV255_32(hi));
+}
+
+__attribute__((target("sse2")))
+static void blend_const8_sse2(uint8_t *d, const uint8_t *s, int w,
+                              uint8_t alpha)
+{
+    const __m128i k = _mm_set1_epi16(alpha);
+    const __m128i zero = _mm_setzero_si128();
+    int j = 0;
+    for ( ; j + 16 <= w; j += 16) {
+        __m128i vd = _mm_loadu_si128((const __m128i *)(d + j));
+        __m128i vs = _mm_loadu_si128((const __m128i *)(s + j));
+        __m128i lo = sse2_mix8(_mm_unpacklo_epi8(vd, zero),
+                               _mm_unpacklo_epi8(vs, zero), k);
+        __m128i hi = sse2_mix8(_mm_unpackhi_epi8(vd, zero),
+                               _mm_unpackhi_epi8(vs, zero), k);
+        _mm_storeu_si128((__m128i *)(d + j), _mm_packus_epi16(lo, hi));
+    }
+    blend_const8_c(d + j, s + j, w - j, alpha);
+}
+
+__attribute__((target("sse2")))
+static void blend_blend8_sse2(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                              int a_step, int w, uint8_t alpha)
+{
+    const __m128i va = _mm_set1_epi16(alpha);
+    const __m128i zero = _mm_setzero_si128();
+    int j = 0;
+    if (a_step <= 2)
+        for ( ; j + 16 <= w; j += 16) {
+            __m128i klo, khi;
+            sse2_alpha16x16(a + j * a_step, a_step, va, &klo, &khi);
+            __m128i vd = _mm_loadu_si128((const __m128i *)(d + j));
+            __m128i vs = _mm_loadu_si128((const __m128i *)(s + j));
+            __m128i lo = sse2_mix8(_mm_unpacklo_epi8(vd, zero),
+                                   _mm_unpacklo_epi8(vs, zero), klo);
+            __m128i hi = sse2_mix8(_mm_unpackhi_epi8(vd, zero),
+                                   _mm_unpackhi_epi8(vs, zero), khi);
+            _mm_storeu_si128((__m128i *)(d + j), _mm_packus_epi16(lo, hi));
+        }
+    blend_blend8_c(d + j, s + j, a + j * a_step, a_step, w - j, alpha);
+}
+
+__attribute__((target("sse2")))
+static void blend_key8_sse2(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                            int a_step, int w, uint8_t alpha,
+                            uint8_t threshold)
+{
+    const __m128i va = _mm_set1_epi16(alpha);
+    const __m128i t = _mm_set1_epi16(threshold);
+    int j = 0;
+    if (a_step <= 2)
+        for ( ; j + 16 <= w; j += 16) {
+            __m128i klo, khi;
+            sse2_alpha16x16(a + j * a_step, a_step, va, &klo, &khi);
+            __m128i mask = _mm_packs_epi16(_mm_cmpgt_epi16(klo, t),
+                                           _mm_cmpgt_epi16(khi, t));
+            __m128i vd = _mm_loadu_si128((const __m128i *)(d + j));
+            __m128i vs = _mm_loadu_si128((const __m128i *)(s + j));
+            _mm_storeu_si128((__m128i *)(d + j),
+                             _mm_or_si128(_mm_and_si128(mask, vs),
+                                          _mm_andnot_si128(mask, vd)));
+        }
+    blend_key8_c(d + j, s + j, a + j * a_step, a_step, w - j,
+                 alpha, threshold);
+}
+
+__attribute__((target("sse2")))
+static void blend_const16_sse2(uint16_t *d, const uint16_t *s, int w,
+                               uint8_t alpha)
+{
+    const __m128i k = _mm_set1_epi16(alpha);
+    int j = 0;
+    for ( ; j + 8 <= w; j += 8) {
+        __m128i vd = _mm_loadu_si128((const __m128i *)(d + j));
+        __m128i vs = _mm_loadu_si128((const __m128i *)(s + j));
+        _mm_storeu_si128((__m128i *)(d + j), sse2_mix16(vd, vs, k));
+    }
+    blend_const16_c(d + j, s + j, w - j, alpha);
+}
+
+__attribute__((target("sse2")))
+static void blend_blend16_sse2(uint16_t *d, const uint16_t *s,
+                               const uint8_t *a, int a_step, int w,
+                               uint8_t alpha)
+{
+    const __m128i va = _mm_set1_epi16(alpha);
+    int j = 0;
+    if (a_step <= 2)
+        for ( ; j + 8 <= w; j += 8) {
+            __m128i k = sse2_alpha8x16(a + j * a_step, a_step, va);
+            __m128i vd = _mm_loadu_si128((const __m128i *)(d + j));
+            __m128i vs = _mm_loadu_si128((const __m128i *)(s + j));
+            _mm_storeu_si128((__m128i *)(d + j), sse2_mix16(vd, vs, k));
+        }
+    blend_blend16_c(d + j, s + j, a + j * a_step, a_step, w - j, alpha);
+}
+
+__attribute__((target("sse2")))
+static void blend_key16_sse2(uint16_t *d, const uint16_t *s,
+                             const uint8_t *a, int a_step, int w,
+                             uint8_t alpha, uint8_t threshold)
+{
+    const __m128i va = _mm_set1_epi16(alpha);
+    const __m128i t = _mm_set1_epi16(threshold);
+    int j = 0;
+    if (a_step <= 2)
+        for ( ; j + 8 <= w; j += 8) {
+            __m128i mask = _mm_cmpgt_epi16(
+                    sse2_alpha8x16(a + j * a_step, a_step, va), t);
+            __m128i vd = _mm_loadu_si128((const __m128i *)(d + j));
+            __m128i vs = _mm_loadu_si128((const __m128i *)(s + j));
+            _mm_storeu_si128((__m128i *)(d + j),
+                             _mm_or_si128(_mm_and_si128(mask, vs),
+                                          _mm_andnot_si128(mask, vd)));
+        }
+    blend_key16_c(d + j, s + j, a + j * a_step, a_step, w - j,
+                  alpha, threshold);
+}
+
+/** @internal @This is the SSE2 implementation. */
+static const struct ubuf_pic_blend blend_sse2 = {
+    .const8 = blend_const8_sse2,
+    .blend8 = blend_blend8_sse2,
+    .key8 = blend_key8_sse2,
+    .const16 = blend_const16_sse2,
+    .blend16 = blend_blend16_sse2,
+    .key16 = blend_key16_sse2,
+};
+
+/** @internal @This divides 16-bit lanes by 255. */
+#define AVX2_DIV255_16(x)                                                   \
+    _mm256_srli_epi16(_mm256_add_epi16(                                     \
+            _mm256_add_epi16(x, _mm256_set1_epi16(1)),                      \
+            _mm256_srli_epi16(x, 8)), 8)
+
+/** @internal @This divides 32-bit lanes by 255. */
+#define AVX2_DIV255_32(x) __extension__ ({                                  \
+    __m256i y_ = _mm256_add_epi32(x, _mm256_set1_epi32(1));                 \
+    y_ = _mm256_add_epi32(y_, _mm256_slli_epi32(y_, 8));                    \
+    _mm256_srli_epi32(_mm256_add_epi32(y_, _mm256_srli_epi32(y_, 16)),      \
+                      16); })
+
+/** @internal @This loads 16 alpha values into 16-bit lanes, scaled by
+ * alpha. */
+__attribute__((target("avx2")))
+static inline __m256i avx2_alpha16x16(const uint8_t *a, int a_step,
+                                      __m256i alpha)
+{
+    __m256i k;
+    if (a_step == 1)
+        k = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)a));
+    else
+        k = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)a),
+                             _mm256_set1_epi16(0xff));
+    return AVX2_DIV255_16(_mm256_mullo_epi16(k, alpha));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_mix8(__m256i d, __m256i s, __m256i k)
+{
+    __m256i x = _mm256_add_epi16(
+        _mm256_mullo_epi16(d, _mm256_sub_epi16(_mm256_set1_epi16(0xff), k)),
+        _mm256_mullo_epi16(s, k));
+    return AVX2_DIV255_16(x);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_mix16(__m256i d, __m256i s, __m256i k)
+{
+    __m256i ik = _mm256_sub_epi16(_mm256_set1_epi16(0xff), k);
+    __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(d, s),
+                                   _mm256_unpacklo_epi16(ik, k));
+    __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(d, s),
+                                   _mm256_unpackhi_epi16(ik, k));
+    /* unpack and pack work within 128-bit lanes, so the order is kept */
+    return _mm256_packs_epi32(AVX2_DIV255_32(lo), AVX2_DIV255_32(hi));
+}
+
+/** @internal @This packs two vectors of 16-bit lanes into octets, in
+ * order. */
+__attribute__((target("avx2")))
+static inline __m256i avx2_pack8(__m256i lo, __m256i hi)
+{
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8);
+}
+
+__attribute__((target("avx2")))
+static void blend_const8_avx2(uint8_t *d, const uint8_t *s, int w,
+                              uint8_t alpha)
+{
+    const __m256i k = _mm256_set1_epi16(alpha);
+    int j = 0;
+    for ( ; j + 32 <= w; j += 32) {
+        __m256i lo = avx2_mix8(
+            _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(d + j))),
+            _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(s + j))),
+            k);
+        __m256i hi = avx2_mix8(
+            _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *)(d + j + 16))),
+            _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *)(s + j + 16))),
+            k);
+        _mm256_storeu_si256((__m256i *)(d + j), avx2_pack8(lo, hi));
+    }
+    blend_const8_sse2(d + j, s + j, w - j, alpha);
+}
+
+__attribute__((target("avx2")))
+static void blend_blend8_avx2(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                              int a_step, int w, uint8_t alpha)
+{
+    const __m256i va = _mm256_set1_epi16(alpha);
+    int j = 0;
+    if (a_step <= 2)
+        for ( ; j + 32 <= w; j += 32) {
+            __m256i klo = avx2_alpha16x16(a + j * a_step, a_step, va);
+            __m256i khi = avx2_alpha16x16(a + (j + 16) * a_step, a_step, va);
+            __m256i lo = avx2_mix8(
+                _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128((const __m128i *)(d + j))),
+                _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128((const __m128i *)(s + j))),
+                klo);
+            __m256i hi = avx2_mix8(
+                _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128((const __m128i *)(d + j + 16))),
+                _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128((const __m128i *)(s + j + 16))),
+                khi);
+            _mm256_storeu_si256((__m256i *)(d + j), avx2_pack8(lo, hi));
+        }
+    blend_blend8_sse2(d + j, s + j, a + j * a_step, a_step, w - j, alpha);
+}
+
+__attribute__((target("avx2")))
+static void blend_key8_avx2(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                            int a_step, int w, uint8_t alpha,
+                            uint8_t threshold)
+{
+    const __m256i va = _mm256_set1_epi16(alpha);
+    const __m256i t = _mm256_set1_epi16(threshold);
+    int j = 0;
+    if (a_step <= 2)
+        for ( ; j + 32 <= w; j += 32) {
+            __m256i klo = avx2_alpha16x16(a + j * a_step, a_step, va);
+            __m256i khi = avx2_alpha16x16(a + (j + 16) * a_step, a_step, va);
+            __m256i mask = _mm256_permute4x64_epi64(
+                _mm256_packs_epi16(_mm256_cmpgt_epi16(klo, t),
+                                   _mm256_cmpgt_epi16(khi, t)), 0xd8);
+            __m256i vd = _mm256_loadu_si256((const __m256i *)(d + j));
+            __m256i vs = _mm256_loadu_si256((const __m256i *)(s + j));
+            _mm256_storeu_si256((__m256i *)(d + j),
+                                _mm256_blendv_epi8(vd, vs, mask));
+        }
+    blend_key8_sse2(d + j, s + j, a + j * a_step, a_step, w - j,
+                    alpha, threshold);
+}
+
+__attribute__((target("avx2")))
+static void blend_const16_avx2(uint16_t *d, const uint16_t *s, int w,
+                               uint8_t alpha)
+{
+    const __m256i k = _mm256_set1_epi16(alpha);
+    int j = 0;
+    for ( ; j + 16 <= w; j += 16) {
+        __m256i vd = _mm256_loadu_si256((const __m256i *)(d + j));
+        __m256i vs = _mm256_loadu_si256((const __m256i *)(s + j));
+        _mm256_storeu_si256((__m256i *)(d + j), avx2_mix16(vd, vs, k));
+    }
+    blend_const16_sse2(d + j, s + j, w - j, alpha);
+}
+
+__attribute__((target("avx2")))
+static void blend_blend16_avx2(uint16_t *d, const uint16_t *s,
+                               const uint8_t *a, int a_step, int w,
+                               uint8_t alpha)
+{
+    const __m256i va = _mm256_set1_epi16(alpha);
+    int j = 0;
+    if (a_step <= 2)
+        for ( ; j + 16 <= w; j += 16) {
+            __m256i k = avx2_alpha16x16(a + j * a_step, a_step, va);
+            __m256i vd = _mm256_loadu_si256((const __m256i *)(d + j));
+            __m256i vs = _mm256_loadu_si256((const __m256i *)(s + j));
+            _mm256_storeu_si256((__m256i *)(d + j), avx2_mix16(vd, vs, k));
+        }
+    blend_blend16_sse2(d + j, s + j, a + j * a_step, a_step, w - j, alpha);
+}
+
+__attribute__((target("avx2")))
+static void blend_key16_avx2(uint16_t *d, const uint16_t *s,
+                             const uint8_t *a, int a_step, int w,
+                             uint8_t alpha, uint8_t threshold)
+{
+    const __m256i va = _mm256_set1_epi16(alpha);
+    const __m256i t = _mm256_set1_epi16(threshold);
+    int j = 0;
+    if (a_step <= 2)
+        for ( ; j + 16 <= w; j += 16) {
+            __m256i mask = _mm256_cmpgt_epi16(
+                    avx2_alpha16x16(a + j * a_step, a_step, va), t);
+            __m256i vd = _mm256_loadu_si256((const __m256i *)(d + j));
+            __m256i vs = _mm256_loadu_si256((const __m256i *)(s + j));
+            _mm256_storeu_si256((__m256i *)(d + j),
+                                _mm256_blendv_epi8(vd, vs, mask));
+        }
+    blend_key16_sse2(d + j, s + j, a + j * a_step, a_step, w - j,
+                     alpha, threshold);
+}
+
+/** @internal @This is the AVX2 implementation. */
+static const struct ubuf_pic_blend blend_avx2 = {
+    .const8 = blend_const8_avx2,
+    .blend8 = blend_blend8_avx2,
+    .key8 = blend_key8_avx2,
+    .const16 = blend_const16_avx2,
+    .blend16 = blend_blend16_avx2,
+    .key16 = blend_key16_avx2,
+};
+#endif
+
+/** @internal @This returns the best implementation for the running CPU.
+ *
+ * @return pointer to the line kernels
+ */
+static const struct ubuf_pic_blend *ubuf_pic_blend_get(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2"))
+        return &blend_avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return &blend_sse2;
+#endif
+    return &blend_c;
+}
+
+/** @internal @This returns whether a plane has 16-bit samples.
+ *
+ * @param chroma chroma type
+ * @param depth_p filled in with the depth of 16-bit samples
+ * @param swap_p filled in with true if the samples are not in native order
+ * @return true if the plane has 16-bit samples
+ */
+static bool ubuf_pic_blit_wide(const char *chroma, unsigned *depth_p,
+                               bool *swap_p)
+{
+    bool big_endian;
+    if (!ubase_check(ubuf_pic_chroma_depth(chroma, depth_p, &big_endian)) ||
+        *depth_p <= 8)
+        return false;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    *swap_p = !big_endian;
+#else
+    *swap_p = big_endian;
+#endif
+    return true;
+}
+
+/** @internal @This blends a line of 16-bit samples in non-native order, or
+ * of more than 15 bits.
+ */
+static void ubuf_pic_blit_line16(uint16_t *d, const uint16_t *s,
+                                 const uint8_t *a, int a_step, int w,
+                                 uint8_t alpha, uint8_t threshold, bool swap)
+{
+    for (int j = 0; j < w; j++) {
+        uint16_t vd = swap ? (uint16_t)(d[j] << 8 | d[j] >> 8) : d[j];
+        uint16_t vs = swap ? (uint16_t)(s[j] << 8 | s[j] >> 8) : s[j];
+        uint8_t k = a != NULL ? blend_alpha(a, j, a_step, alpha) : alpha;
+        if (a != NULL && threshold != 0xff) {
+            if (k <= threshold)
+                continue;
+            vd = vs;
+        } else
+            vd = ((uint32_t)vd * (0xff - k) + (uint32_t)vs * k) / 0xff;
+        d[j] = swap ? (uint16_t)(vd << 8 | vd >> 8) : vd;
+    }
+}
+
+/** @This blits a picture ubuf to another ubuf.
+ *
+ * @param dest destination ubuf
+ * @param src source ubuf
+ * @param dest_hoffset number of pixels to seek at the beginning of each line of
+ * dest
+ * @param dest_voffset number of lines to seek at the beginning of dest
+ * @param src_hoffset number of pixels to skip at the beginning of each line of
+ * src
+ * @param src_voffset number of lines to skip at the beginning of src
+ * @param extract_hsize horizontal size to copy
+ * @param extract_vsize vertical size to copy
+ * @param alpha_plane pointer to alpha plane buffer, if any
+ * @param alpha_stride horizontal stride of the alpha plane buffer
+ * @param alpha alpha multiplier
+ * @param threshold alpha blending method
+ * @return an error code
+ */
+int ubuf_pic_blit_alpha(struct ubuf *dest, struct ubuf *src,
+                        int dest_hoffset, int dest_voffset,
+                        int src_hoffset, int src_voffset,
+                        int extract_hsize, int extract_vsize,
+                        const uint8_t *alpha_plane, int alpha_stride,
+                        const uint8_t alpha, const uint8_t threshold)
+{
+    if (alpha_plane == NULL && alpha < threshold)
+        return UBASE_ERR_NONE; /* nothing to do */
+
+    uint8_t src_macropixel;
+    UBASE_RETURN(ubuf_pic_size(src, NULL, NULL, &src_macropixel))
+    uint8_t dest_macropixel;
+    UBASE_RETURN(ubuf_pic_size(dest, NULL, NULL, &dest_macropixel))
+    if (unlikely(dest_macropixel != src_macropixel))
+        return UBASE_ERR_INVALID;
+
+    const struct ubuf_pic_blend *blend = ubuf_pic_blend_get();
+    const bool copy = (!alpha_plane && alpha == 0xff) || threshold == 0;
+
+    const char *chroma = NULL;
+    while (ubase_check(ubuf_pic_plane_iterate(dest, &chroma)) &&
+           chroma != NULL) {
+        size_t src_stride;
+        uint8_t src_hsub, src_vsub, src_macropixel_size;
+        UBASE_RETURN(ubuf_pic_plane_size(src, chroma, &src_stride,
+                    &src_hsub, &src_vsub, &src_macropixel_size))
+
+        size_t dest_stride;
+        uint8_t dest_hsub, dest_vsub, dest_macropixel_size;
+        UBASE_RETURN(ubuf_pic_plane_size(dest, chroma,
+                     &dest_stride, &dest_hsub, &dest_vsub,
+                     &dest_macropixel_size))
+
+        if (unlikely(src_hsub != dest_hsub || src_vsub != dest_vsub ||
+                     src_macropixel_size != dest_macropixel_size))
+            return UBASE_ERR_INVALID;
+
+        uint8_t *dest_buffer;
+        const uint8_t *src_buffer;
+        UBASE_RETURN(ubuf_pic_plane_write(dest, chroma,
+                    dest_hoffset, dest_voffset,
+                    extract_hsize, extract_vsize, &dest_buffer))
+        int err = ubuf_pic_plane_read(src, chroma, src_hoffset, src_voffset,
+                                      extract_hsize, extract_vsize,
+                                      &src_buffer);
+        if (unlikely(!ubase_check(err))) {
+            ubuf_pic_plane_unmap(dest, chroma,
+                                 dest_hoffset, dest_voffset,
+                                 extract_hsize, extract_vsize);
+            return err;
+        }
+
+        int plane_hsize = extract_hsize / src_hsub / src_macropixel *
+                          src_macropixel_size;
+        int plane_vsize = extract_vsize / src_vsub;
+        unsigned depth = 8;
+        bool swap = false;
+        bool wide = ubuf_pic_blit_wide(chroma, &depth, &swap);
+
+        for (int i = 0; i < plane_vsize; i++) {
+            const uint8_t *a = alpha_plane ?
+                alpha_plane + alpha_stride * (i * src_vsub) : NULL;
+
+            if (copy) {
+                memcpy(dest_buffer, src_buffer, plane_hsize);
+            } else if (wide) {
+                uint16_t *d = (uint16_t *)dest_buffer;
+                const uint16_t *s = (const uint16_t *)src_buffer;
+                int w = plane_hsize / 2;
+                if (swap || depth > 15)
+                    ubuf_pic_blit_line16(d, s, a, src_hsub, w,
+                                         alpha, threshold, swap);
+                else if (!a)
+                    blend->const16(d, s, w, alpha);
+                else if (threshold != 0xff)
+                    /* on/off blending: if alpha is over the threshold,
+                     * we use the subpicture pixel */
+                    blend->key16(d, s, a, src_hsub, w, alpha, threshold);
+                else
+                    blend->blend16(d, s, a, src_hsub, w, alpha);
+            } else if (!a) {
+                blend->const8(dest_buffer, src_buffer, plane_hsize, alpha);
+            } else if (threshold != 0xff) {
+                blend->key8(dest_buffer, src_buffer, a, src_hsub,
+                            plane_hsize, alpha, threshold);
+            } else {
+                blend->blend8(dest_buffer, src_buffer, a, src_hsub,
+                              plane_hsize, alpha);
+            }
+            dest_buffer += dest_stride;
+            src_buffer += src_stride;
+        }
+
+        err = ubuf_pic_plane_unmap(dest, chroma,
+                                   dest_hoffset, dest_voffset,
+                                   extract_hsize, extract_vsize);
+        UBASE_RETURN(ubuf_pic_plane_unmap(src, chroma,
+                                          src_hoffset, src_voffset,
+                                          extract_hsize, extract_vsize))
+        UBASE_RETURN(err)
+    }
+    return UBASE_ERR_NONE;
+}
@@ -61,6 +61,24 @@ struct uclock_std {
 UBASE_FROM_TO(uclock_std, uclock, uclock, uclock)
 UBASE_FROM_TO(uclock_std, urefcount, urefcount, urefcount)
 
+#ifndef __MACH__
+/** @internal @This returns the POSIX clock to use for the given flags.
+ *
+ * @param flags type of clock
+ * @return clock identifier
+ */
+static clockid_t uclock_std_clockid(enum uclock_std_flags flags)
+{
+    if (flags & UCLOCK_FLAG_REALTIME)
+        return CLOCK_REALTIME;
+#ifdef CLOCK_MONOTONIC_RAW
+    if (flags & UCLOCK_FLAG_MONOTONIC_RAW)
+        return CLOCK_MONOTONIC_RAW;
+#endif
+    return CLOCK_MONOTONIC;
+}
+#endif
+
 /** @This returns the current time in the given clock.
  *
  * @param uclock utility structure passed to the module
@@ -77,8 +95,7 @@ static uint64_t uclock_std_now_inner(struct uclock *uclock,
 
 #else
     struct timespec ts;
-    if (unlikely(clock_gettime((flags & UCLOCK_FLAG_REALTIME) ?
-                               CLOCK_REALTIME : CLOCK_MONOTONIC, &ts) == -1))
+    if (unlikely(clock_gettime(uclock_std_clockid(flags), &ts) == -1))
         /* this should not happen as we have checked the clock existed
          * in alloc */
         return UINT64_MAX;
@@ -172,8 +189,7 @@ struct uclock *uclock_std_alloc(enum uclock_std_flags flags)
     }
 #else
     struct timespec ts;
-    if (unlikely(clock_gettime(unlikely(flags & UCLOCK_FLAG_REALTIME) ?
-                               CLOCK_REALTIME : CLOCK_MONOTONIC, &ts) == -1))
+    if (unlikely(clock_gettime(uclock_std_clockid(flags), &ts) == -1))
         return NULL;
 #endif
 
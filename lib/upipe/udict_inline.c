@@ -28,10 +28,16 @@
  * This manager stores all attributes inline inside a single umem block.
  * This is designed in order to minimize calls to memory allocators, and
  * to transmit dictionaries over streams.
+ *
+ * The umem block may be shared by several udicts (@ref udict_dup_shared).
+ * Its reference counter is then allocated on the side, so that udicts which
+ * are never shared do not pay for it. A udict copies the attributes to a
+ * block of its own before modifying them.
  */
 
 #include <upipe/ubase.h>
 #include <upipe/urefcount.h>
+#include <upipe/uatomic.h>
 #include <upipe/upool.h>
 #include <upipe/umem.h>
 #include <upipe/udict.h>
@@ -105,9 +111,38 @@ static const struct inline_shorthand inline_shorthands[] = {
     { "p.cea_708", UDICT_TYPE_OPAQUE }
 };
 
+/** number of shorthand attributes */
+#define UDICT_NB_SHORTHANDS \
+    (sizeof(inline_shorthands) / sizeof(struct inline_shorthand))
+/** number of slots of the hash table of named attributes (power of 2) */
+#define UDICT_INDEX_SLOTS 32
+/** maximum number of named attributes in the hash table */
+#define UDICT_INDEX_MAX (UDICT_INDEX_SLOTS * 3 / 4)
+
 /** @This stores the size of the value of basic attribute types. */
 static const size_t attr_sizes[] = { 0, 0, 0, 0, 1, 1, 1, 8, 8, 16, 8 };
 
+/** @internal @This is a slot of the hash table of named attributes. */
+struct udict_inline_slot {
+    /** hash of the name and type of the attribute */
+    uint32_t hash;
+    /** offset of the attribute plus one, or 0 if the slot is free */
+    uint32_t offset;
+};
+
+/** @internal @This is the index of the attributes of a udict, kept alongside
+ * the attribute buffer in indexed mode. */
+struct udict_inline_index {
+    /** offsets of shorthand attributes plus one, or 0 if absent */
+    uint32_t shorthands[UDICT_NB_SHORTHANDS];
+    /** number of named attributes in the hash table */
+    unsigned int nb_named;
+    /** true if some named attributes could not be added to the hash table */
+    bool overflow;
+    /** hash table of named attributes, with linear probing */
+    struct udict_inline_slot named[UDICT_INDEX_SLOTS];
+};
+
 /** super-set of the udict_mgr structure with additional local members */
 struct udict_inline_mgr {
     /** refcount management structure */
@@ -118,6 +153,9 @@ struct udict_inline_mgr {
     /** extra space added when the umem is expanded */
     size_t extra_size;
 
+    /** true if udicts are allocated with an index */
+    bool indexed;
+
     /** udict pool */
     struct upool udict_pool;
     /** umem allocator */
@@ -135,12 +173,25 @@ UBASE_FROM_TO(udict_inline_mgr, udict_mgr, udict_mgr, mgr)
 UBASE_FROM_TO(udict_inline_mgr, urefcount, urefcount, urefcount)
 UBASE_FROM_TO(udict_inline_mgr, upool, udict_pool, udict_pool)
 
+/** @internal @This is the reference counter of attributes shared by
+ * several udicts. */
+struct udict_inline_shared {
+    /** number of udicts sharing the attributes */
+    uatomic_uint32_t refcount;
+    /** umem structure pointing to the shared buffer */
+    struct umem umem;
+};
+
 /** super-set of the udict structure with additional local members */
 struct udict_inline {
     /** umem structure pointing to buffer */
     struct umem umem;
+    /** shared attributes, or NULL if the buffer belongs to this udict */
+    struct udict_inline_shared *shared;
     /** used size */
     size_t size;
+    /** index of the attributes, or NULL if not in indexed mode */
+    struct udict_inline_index *index;
 
     /** common structure */
     struct udict udict;
@@ -148,6 +199,62 @@ struct udict_inline {
 
 UBASE_FROM_TO(udict_inline, udict, udict, udict)
 
+/** @internal @This releases the attributes, and frees them if they are
+ * not shared anymore.
+ *
+ * @param inl pointer to the udict_inline
+ */
+static void udict_inline_umem_release(struct udict_inline *inl)
+{
+    struct udict_inline_shared *shared = inl->shared;
+    if (likely(shared == NULL)) {
+        umem_free(&inl->umem);
+        return;
+    }
+
+    inl->shared = NULL;
+    if (uatomic_fetch_sub(&shared->refcount, 1) == 1) {
+        uatomic_clean(&shared->refcount);
+        umem_free(&shared->umem);
+        free(shared);
+    }
+}
+
+/** @internal @This makes sure the attributes are not shared before they
+ * are modified, by copying them if needed.
+ *
+ * @param inl pointer to the udict_inline
+ * @return false in case of allocation error
+ */
+static bool udict_inline_unshare(struct udict_inline *inl)
+{
+    struct udict_inline_shared *shared = inl->shared;
+    if (likely(shared == NULL))
+        return true;
+
+    /* the last udict sharing the attributes takes them back */
+    if (uatomic_load(&shared->refcount) == 1) {
+        uatomic_clean(&shared->refcount);
+        free(shared);
+        inl->shared = NULL;
+        return true;
+    }
+
+    struct udict_inline_mgr *inline_mgr =
+        udict_inline_mgr_from_udict_mgr(inl->udict.mgr);
+    size_t size = inl->size + inline_mgr->extra_size;
+    if (size < inline_mgr->min_size)
+        size = inline_mgr->min_size;
+    struct umem umem;
+    if (unlikely(!umem_alloc(inline_mgr->umem_mgr, &umem, size)))
+        return false;
+    memcpy(umem_buffer(&umem), umem_buffer(&inl->umem), inl->size);
+    /* offsets in the index are still valid */
+    udict_inline_umem_release(inl);
+    inl->umem = umem;
+    return true;
+}
+
 /** @This allocates a udict with attributes space.
  *
  * @param mgr common management structure
@@ -167,10 +274,13 @@ static struct udict *udict_inline_alloc(struct udict_mgr *mgr, size_t size)
         upool_free(&inline_mgr->udict_pool, inl);
         return NULL;
     }
+    inl->shared = NULL;
 
     uint8_t *buffer = umem_buffer(&inl->umem);
     buffer[0] = UDICT_TYPE_END;
     inl->size = 1;
+    if (inl->index != NULL)
+        memset(inl->index, 0, sizeof(struct udict_inline_index));
 
     return udict;
 }
@@ -195,6 +305,48 @@ static int udict_inline_dup(struct udict *udict, struct udict **new_udict_p)
     struct udict_inline *new_inl = udict_inline_from_udict(new_udict);
     memcpy(umem_buffer(&new_inl->umem), umem_buffer(&inl->umem), inl->size);
     new_inl->size = inl->size;
+    if (new_inl->index != NULL)
+        memcpy(new_inl->index, inl->index, sizeof(struct udict_inline_index));
+    return UBASE_ERR_NONE;
+}
+
+/** @This duplicates a given udict, sharing its attributes.
+ *
+ * @param udict pointer to udict
+ * @param new_udict_p reference written with a pointer to the newly allocated
+ * udict
+ * @return an error code
+ */
+static int udict_inline_dup_shared(struct udict *udict,
+                                   struct udict **new_udict_p)
+{
+    assert(new_udict_p != NULL);
+    struct udict_inline_mgr *inline_mgr =
+        udict_inline_mgr_from_udict_mgr(udict->mgr);
+    struct udict_inline *inl = udict_inline_from_udict(udict);
+    struct udict_inline *new_inl = upool_alloc(&inline_mgr->udict_pool,
+                                               struct udict_inline *);
+    if (unlikely(new_inl == NULL))
+        return UBASE_ERR_ALLOC;
+
+    struct udict_inline_shared *shared = inl->shared;
+    if (shared == NULL) {
+        shared = malloc(sizeof(struct udict_inline_shared));
+        if (unlikely(shared == NULL)) {
+            upool_free(&inline_mgr->udict_pool, new_inl);
+            return UBASE_ERR_ALLOC;
+        }
+        uatomic_init(&shared->refcount, 1);
+        shared->umem = inl->umem;
+        inl->shared = shared;
+    }
+    uatomic_fetch_add(&shared->refcount, 1);
+    new_inl->shared = shared;
+    new_inl->umem = inl->umem;
+    new_inl->size = inl->size;
+    if (new_inl->index != NULL)
+        memcpy(new_inl->index, inl->index, sizeof(struct udict_inline_index));
+    *new_udict_p = udict_inline_to_udict(new_inl);
     return UBASE_ERR_NONE;
 }
 
@@ -236,6 +388,104 @@ static uint8_t *udict_inline_next(uint8_t *attr)
     return attr + 3 + size;
 }
 
+/** @internal @This hashes the name and type of a named attribute (FNV-1a).
+ *
+ * @param name name of the attribute
+ * @param type type of the attribute
+ * @return hash value
+ */
+static inline uint32_t udict_inline_hash(const char *name,
+                                         enum udict_type type)
+{
+    uint32_t hash = UINT32_C(2166136261) ^ type;
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= UINT32_C(16777619);
+    }
+    return hash;
+}
+
+/** @internal @This adds an attribute to the index.
+ *
+ * @param inl pointer to the udict_inline
+ * @param attr pointer to the attribute
+ */
+static void udict_inline_index_add(struct udict_inline *inl, uint8_t *attr)
+{
+    struct udict_inline_index *index = inl->index;
+    uint32_t offset = attr - umem_buffer(&inl->umem) + 1;
+
+    if (*attr > UDICT_TYPE_SHORTHAND) {
+        unsigned int i = *attr - UDICT_TYPE_SHORTHAND - 1;
+        if (likely(i < UDICT_NB_SHORTHANDS))
+            index->shorthands[i] = offset;
+        return;
+    }
+
+    if (unlikely(index->nb_named >= UDICT_INDEX_MAX)) {
+        index->overflow = true;
+        return;
+    }
+    uint32_t hash = udict_inline_hash((const char *)(attr + 3), *attr);
+    unsigned int i = hash & (UDICT_INDEX_SLOTS - 1);
+    while (index->named[i].offset)
+        i = (i + 1) & (UDICT_INDEX_SLOTS - 1);
+    index->named[i].hash = hash;
+    index->named[i].offset = offset;
+    index->nb_named++;
+}
+
+/** @internal @This rebuilds the index from the attributes.
+ *
+ * @param inl pointer to the udict_inline
+ */
+static void udict_inline_index_rebuild(struct udict_inline *inl)
+{
+    memset(inl->index, 0, sizeof(struct udict_inline_index));
+    uint8_t *attr = umem_buffer(&inl->umem);
+    while (attr != NULL && *attr != UDICT_TYPE_END) {
+        udict_inline_index_add(inl, attr);
+        attr = udict_inline_next(attr);
+    }
+}
+
+/** @internal @This finds an attribute (shorthand or not) in the index.
+ *
+ * @param inl pointer to the udict_inline
+ * @param name name of the attribute
+ * @param type type of the attribute (excluding UDICT_TYPE_END)
+ * @param found_p set to false if the attribute may not be indexed
+ * @return pointer to the attribute, or NULL
+ */
+static uint8_t *udict_inline_index_find(struct udict_inline *inl,
+                                        const char *name,
+                                        enum udict_type type, bool *found_p)
+{
+    struct udict_inline_index *index = inl->index;
+    uint8_t *buffer = umem_buffer(&inl->umem);
+    *found_p = true;
+
+    if (type > UDICT_TYPE_SHORTHAND) {
+        unsigned int i = type - UDICT_TYPE_SHORTHAND - 1;
+        if (unlikely(i >= UDICT_NB_SHORTHANDS) || !index->shorthands[i])
+            return NULL;
+        return buffer + index->shorthands[i] - 1;
+    }
+
+    uint32_t hash = udict_inline_hash(name, type);
+    unsigned int i = hash & (UDICT_INDEX_SLOTS - 1);
+    while (index->named[i].offset) {
+        if (index->named[i].hash == hash) {
+            uint8_t *attr = buffer + index->named[i].offset - 1;
+            if (*attr == type && !strcmp((const char *)(attr + 3), name))
+                return attr;
+        }
+        i = (i + 1) & (UDICT_INDEX_SLOTS - 1);
+    }
+    *found_p = !index->overflow;
+    return NULL;
+}
+
 /** @internal @This finds an attribute (shorthand or not) of the given name
  * and type and returns a pointer to its beginning.
  *
@@ -255,6 +505,13 @@ static uint8_t *udict_inline_find(struct udict *udict, const char *name,
         inline_mgr->stats[type - UDICT_TYPE_SHORTHAND - 1]++;
     }
 #endif
+    if (inl->index != NULL && type != UDICT_TYPE_END) {
+        bool found;
+        uint8_t *attr = udict_inline_index_find(inl, name, type, &found);
+        if (likely(found))
+            return attr;
+    }
+
     uint8_t *attr = umem_buffer(&inl->umem);
     while (attr != NULL) {
         if (*attr == type &&
@@ -377,6 +634,8 @@ static int udict_inline_delete(struct udict *udict, const char *name,
 {
     assert(type != UDICT_TYPE_END);
     struct udict_inline *inl = udict_inline_from_udict(udict);
+    if (unlikely(!udict_inline_unshare(inl)))
+        return UBASE_ERR_ALLOC;
     uint8_t *attr = udict_inline_find(udict, name, type);
     if (unlikely(attr == NULL))
         return UBASE_ERR_INVALID;
@@ -384,6 +643,8 @@ static int udict_inline_delete(struct udict *udict, const char *name,
     uint8_t *end = udict_inline_next(attr);
     memmove(attr, end, umem_buffer(&inl->umem) + inl->size - end);
     inl->size -= end - attr;
+    if (inl->index != NULL)
+        udict_inline_index_rebuild(inl);
     return UBASE_ERR_NONE;
 }
 
@@ -409,6 +670,8 @@ static int udict_inline_set(struct udict *udict, const char *name,
             return UBASE_ERR_INVALID;
         base_type = shorthand->base_type;
     }
+    if (unlikely(!udict_inline_unshare(inl)))
+        return UBASE_ERR_ALLOC;
 
     /* check if it already exists */
     size_t current_size;
@@ -457,6 +720,7 @@ static int udict_inline_set(struct udict *udict, const char *name,
         attr = umem_buffer(&inl->umem) + inl->size - 1;
     }
     assert(*attr == UDICT_TYPE_END);
+    uint8_t *header = attr;
 
     /* write attribute header */
     if (unlikely(shorthand == NULL)) {
@@ -481,6 +745,8 @@ static int udict_inline_set(struct udict *udict, const char *name,
     if (attr_p != NULL)
         *attr_p = attr;
     inl->size += header_size + attr_size;
+    if (inl->index != NULL)
+        udict_inline_index_add(inl, header);
     return UBASE_ERR_NONE;
 }
 
@@ -520,6 +786,10 @@ static int udict_inline_control(struct udict *udict, int command, va_list args)
             struct udict **udict_p = va_arg(args, struct udict **);
             return udict_inline_dup(udict, udict_p);
         }
+        case UDICT_DUP_SHARED: {
+            struct udict **udict_p = va_arg(args, struct udict **);
+            return udict_inline_dup_shared(udict, udict_p);
+        }
         case UDICT_ITERATE: {
             const char **name_p = va_arg(args, const char **);
             enum udict_type *type_p = va_arg(args, enum udict_type *);
@@ -566,7 +836,7 @@ static void udict_inline_free(struct udict *udict)
         udict_inline_mgr_from_udict_mgr(udict->mgr);
     struct udict_inline *inl = udict_inline_from_udict(udict);
 
-    umem_free(&inl->umem);
+    udict_inline_umem_release(inl);
     upool_free(&inline_mgr->udict_pool, inl);
 }
 
@@ -579,9 +849,11 @@ static void *udict_inline_alloc_inner(struct upool *upool)
 {
     struct udict_inline_mgr *inline_mgr =
         udict_inline_mgr_from_udict_pool(upool);
-    struct udict_inline *inl = malloc(sizeof(struct udict_inline));
+    struct udict_inline *inl = malloc(sizeof(struct udict_inline) +
+            (inline_mgr->indexed ? sizeof(struct udict_inline_index) : 0));
     if (unlikely(inl == NULL))
         return NULL;
+    inl->index = inline_mgr->indexed ? (void *)(inl + 1) : NULL;
     struct udict *udict = udict_inline_to_udict(inl);
     udict->mgr = udict_inline_mgr_to_udict_mgr(inline_mgr);
     return inl;
@@ -653,7 +925,7 @@ static void udict_inline_mgr_free(struct urefcount *urefcount)
     free(inline_mgr);
 }
 
-/** @This allocates a new instance of the inline udict manager.
+/** @internal @This allocates a new instance of the inline udict manager.
  *
  * @param udict_pool_depth maximum number of udict structures in the pool
  * @param umem_mgr memory allocator to use for buffers
@@ -661,11 +933,13 @@ static void udict_inline_mgr_free(struct urefcount *urefcount)
  * default sensible value is used)
  * @param extra_size extra space added when the udict needs to be resized
  * (if set to -1, a default sensible value is used)
+ * @param indexed true if udicts maintain an index of their attributes
  * @return pointer to manager, or NULL in case of error
  */
-struct udict_mgr *udict_inline_mgr_alloc(unsigned int udict_pool_depth,
-                                         struct umem_mgr *umem_mgr,
-                                         int min_size, int extra_size)
+static struct udict_mgr *_udict_inline_mgr_alloc(unsigned int udict_pool_depth,
+                                                 struct umem_mgr *umem_mgr,
+                                                 int min_size, int extra_size,
+                                                 bool indexed)
 {
     struct udict_inline_mgr *inline_mgr =
         malloc(sizeof(struct udict_inline_mgr) +
@@ -690,6 +964,7 @@ struct udict_mgr *udict_inline_mgr_alloc(unsigned int udict_pool_depth,
 
     inline_mgr->min_size = min_size > 0 ? min_size : UDICT_MIN_SIZE;
     inline_mgr->extra_size = extra_size > 0 ? extra_size : UDICT_EXTRA_SIZE;
+    inline_mgr->indexed = indexed;
 
 #ifdef STATS
     int i;
@@ -700,3 +975,43 @@ struct udict_mgr *udict_inline_mgr_alloc(unsigned int udict_pool_depth,
     
     return udict_inline_mgr_to_udict_mgr(inline_mgr);
 }
+
+/** @This allocates a new instance of the inline udict manager.
+ *
+ * @param udict_pool_depth maximum number of udict structures in the pool
+ * @param umem_mgr memory allocator to use for buffers
+ * @param min_size minimum allocated space for the udict (if set to -1, a
+ * default sensible value is used)
+ * @param extra_size extra space added when the udict needs to be resized
+ * (if set to -1, a default sensible value is used)
+ * @return pointer to manager, or NULL in case of error
+ */
+struct udict_mgr *udict_inline_mgr_alloc(unsigned int udict_pool_depth,
+                                         struct umem_mgr *umem_mgr,
+                                         int min_size, int extra_size)
+{
+    return _udict_inline_mgr_alloc(udict_pool_depth, umem_mgr,
+                                   min_size, extra_size, false);
+}
+
+/** @This allocates a new instance of the inline udict manager, whose udicts
+ * maintain an index of their attributes. Lookups of shorthand attributes are
+ * then done in constant time, and lookups of named attributes go through a
+ * small hash table, at the expense of a slightly more expensive allocation,
+ * duplication and deletion.
+ *
+ * @param udict_pool_depth maximum number of udict structures in the pool
+ * @param umem_mgr memory allocator to use for buffers
+ * @param min_size minimum allocated space for the udict (if set to -1, a
+ * default sensible value is used)
+ * @param extra_size extra space added when the udict needs to be resized
+ * (if set to -1, a default sensible value is used)
+ * @return pointer to manager, or NULL in case of error
+ */
+struct udict_mgr *udict_inline_mgr_alloc_indexed(unsigned int udict_pool_depth,
+                                                 struct umem_mgr *umem_mgr,
+                                                 int min_size, int extra_size)
+{
+    return _udict_inline_mgr_alloc(udict_pool_depth, umem_mgr,
+                                   min_size, extra_size, true);
+}
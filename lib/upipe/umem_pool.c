@@ -23,16 +23,41 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <upipe/config.h>
 #include <upipe/ubase.h>
 #include <upipe/urefcount.h>
 #include <upipe/ulifo.h>
+#include <upipe/ulist.h>
 #include <upipe/umem.h>
 #include <upipe/umem_pool.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
 
+#ifdef UPIPE_HAVE_PTHREAD
+#include <pthread.h>
+
+/** @This defines the per-thread cache of a umem pool manager. Each pool has
+ * a magazine of up to twice magazine_size buffers, which is refilled from or
+ * flushed to the shared pool by magazine_size buffers at once. */
+struct umem_pool_cache {
+    /** structure for double-linked lists */
+    struct uchain uchain;
+    /** pointer to the manager */
+    struct umem_pool_mgr *pool_mgr;
+    /** number of buffers in each magazine */
+    unsigned int *counts;
+    /** magazines of buffers, twice magazine_size per pool */
+    uint8_t **buffers;
+    /** statistics of each pool */
+    struct umem_pool_stats stats[];
+};
+
+UBASE_FROM_TO(umem_pool_cache, uchain, uchain, uchain)
+#endif
+
 /** @This defines the private data structures of the umem pool manager. */
 struct umem_pool_mgr {
     /** refcount management structure */
@@ -43,6 +68,19 @@ struct umem_pool_mgr {
 
     /** size (in octets) of buffers of pools[0] */
     size_t pool0_size;
+    /** number of buffers exchanged at once between the per-thread caches and
+     * the pools, or 0 if there is no per-thread cache */
+    unsigned int magazine_size;
+#ifdef UPIPE_HAVE_PTHREAD
+    /** thread-specific key for the per-thread caches */
+    pthread_key_t key;
+    /** mutex protecting the list of caches and the cumulated statistics */
+    pthread_mutex_t mutex;
+    /** list of per-thread caches */
+    struct uchain caches;
+    /** statistics of terminated threads */
+    struct umem_pool_stats *stats;
+#endif
     /** number of pools of buffers */
     size_t nb_pools;
     /** buffer pools */
@@ -75,6 +113,161 @@ static unsigned int umem_pool_find(struct umem_mgr *mgr, size_t wanted,
     return pool;
 }
 
+#ifdef UPIPE_HAVE_PTHREAD
+/** @internal @This releases all buffers of a per-thread cache, either to the
+ * shared pools, or to free() if they are full.
+ *
+ * @param cache per-thread cache
+ */
+static void umem_pool_cache_flush(struct umem_pool_cache *cache)
+{
+    struct umem_pool_mgr *pool_mgr = cache->pool_mgr;
+    for (unsigned int pool = 0; pool < pool_mgr->nb_pools; pool++) {
+        uint8_t **buffers = cache->buffers +
+                            pool * 2 * pool_mgr->magazine_size;
+        while (cache->counts[pool]) {
+            uint8_t *buffer = buffers[--cache->counts[pool]];
+            if (!ulifo_push(&pool_mgr->pools[pool], buffer))
+                free(buffer);
+        }
+    }
+}
+
+/** @internal @This adds the statistics of a per-thread cache.
+ *
+ * @param pool_mgr description structure of the pool manager
+ * @param stats array of statistics to increment
+ * @param cache per-thread cache
+ */
+static void umem_pool_cache_add_stats(struct umem_pool_mgr *pool_mgr,
+                                      struct umem_pool_stats *stats,
+                                      struct umem_pool_cache *cache)
+{
+    for (unsigned int pool = 0; pool < pool_mgr->nb_pools; pool++) {
+        stats[pool].cache_hits += cache->stats[pool].cache_hits;
+        stats[pool].pool_hits += cache->stats[pool].pool_hits;
+        stats[pool].misses += cache->stats[pool].misses;
+        stats[pool].overflows += cache->stats[pool].overflows;
+    }
+}
+
+/** @internal @This is called when a thread exits, and releases its cache.
+ *
+ * @param opaque per-thread cache
+ */
+static void umem_pool_cache_free(void *opaque)
+{
+    struct umem_pool_cache *cache = opaque;
+    struct umem_pool_mgr *pool_mgr = cache->pool_mgr;
+    umem_pool_cache_flush(cache);
+
+    pthread_mutex_lock(&pool_mgr->mutex);
+    ulist_delete(umem_pool_cache_to_uchain(cache));
+    umem_pool_cache_add_stats(pool_mgr, pool_mgr->stats, cache);
+    pthread_mutex_unlock(&pool_mgr->mutex);
+    free(cache);
+}
+
+/** @internal @This returns the cache of the current thread, and allocates it
+ * if needed.
+ *
+ * @param pool_mgr description structure of the pool manager
+ * @return pointer to the per-thread cache, or NULL in case of error
+ */
+static struct umem_pool_cache *umem_pool_cache_get(
+        struct umem_pool_mgr *pool_mgr)
+{
+    struct umem_pool_cache *cache = pthread_getspecific(pool_mgr->key);
+    if (likely(cache != NULL))
+        return cache;
+
+    size_t nb_pools = pool_mgr->nb_pools;
+    cache = malloc(sizeof(struct umem_pool_cache) +
+                   nb_pools * sizeof(struct umem_pool_stats) +
+                   nb_pools * 2 * pool_mgr->magazine_size * sizeof(uint8_t *) +
+                   nb_pools * sizeof(unsigned int));
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    cache->pool_mgr = pool_mgr;
+    memset(cache->stats, 0, nb_pools * sizeof(struct umem_pool_stats));
+    cache->buffers = (uint8_t **)(cache->stats + nb_pools);
+    cache->counts = (unsigned int *)(cache->buffers +
+                                     nb_pools * 2 * pool_mgr->magazine_size);
+    memset(cache->counts, 0, nb_pools * sizeof(unsigned int));
+
+    if (unlikely(pthread_setspecific(pool_mgr->key, cache) != 0)) {
+        free(cache);
+        return NULL;
+    }
+    pthread_mutex_lock(&pool_mgr->mutex);
+    ulist_add(&pool_mgr->caches, umem_pool_cache_to_uchain(cache));
+    pthread_mutex_unlock(&pool_mgr->mutex);
+    return cache;
+}
+
+/** @internal @This allocates a buffer from the per-thread cache, refilling
+ * the magazine from the shared pool if it is empty.
+ *
+ * @param pool_mgr description structure of the pool manager
+ * @param cache per-thread cache
+ * @param pool index of the pool
+ * @return pointer to a buffer, or NULL if the pool is empty
+ */
+static uint8_t *umem_pool_cache_pop(struct umem_pool_mgr *pool_mgr,
+                                    struct umem_pool_cache *cache,
+                                    unsigned int pool)
+{
+    uint8_t **buffers = cache->buffers + pool * 2 * pool_mgr->magazine_size;
+    if (likely(cache->counts[pool])) {
+        cache->stats[pool].cache_hits++;
+        return buffers[--cache->counts[pool]];
+    }
+
+    while (cache->counts[pool] < pool_mgr->magazine_size) {
+        uint8_t *buffer = ulifo_pop(&pool_mgr->pools[pool], uint8_t *);
+        if (buffer == NULL)
+            break;
+        buffers[cache->counts[pool]++] = buffer;
+    }
+    if (unlikely(!cache->counts[pool])) {
+        cache->stats[pool].misses++;
+        return NULL;
+    }
+    cache->stats[pool].pool_hits++;
+    return buffers[--cache->counts[pool]];
+}
+
+/** @internal @This releases a buffer to the per-thread cache, flushing half
+ * of the magazine to the shared pool if it is full.
+ *
+ * @param pool_mgr description structure of the pool manager
+ * @param cache per-thread cache
+ * @param pool index of the pool
+ * @param buffer buffer to release
+ */
+static void umem_pool_cache_push(struct umem_pool_mgr *pool_mgr,
+                                 struct umem_pool_cache *cache,
+                                 unsigned int pool, uint8_t *buffer)
+{
+    unsigned int magazine_size = pool_mgr->magazine_size;
+    uint8_t **buffers = cache->buffers + pool * 2 * magazine_size;
+    if (unlikely(cache->counts[pool] >= 2 * magazine_size)) {
+        /* release the oldest half */
+        for (unsigned int i = 0; i < magazine_size; i++) {
+            if (!ulifo_push(&pool_mgr->pools[pool], buffers[i])) {
+                cache->stats[pool].overflows++;
+                free(buffers[i]);
+            }
+        }
+        memmove(buffers, buffers + magazine_size,
+                magazine_size * sizeof(uint8_t *));
+        cache->counts[pool] -= magazine_size;
+    }
+    buffers[cache->counts[pool]++] = buffer;
+}
+#endif
+
 /** @This allocates a new umem buffer space.
  *
  * @param mgr management structure
@@ -91,6 +284,13 @@ static bool umem_pool_alloc(struct umem_mgr *mgr, struct umem *umem,
     unsigned int pool = umem_pool_find(mgr, size, &real_size);
     uint8_t *buffer = NULL;
 
+#ifdef UPIPE_HAVE_PTHREAD
+    struct umem_pool_cache *cache;
+    if (pool_mgr->magazine_size && likely(pool < pool_mgr->nb_pools) &&
+        likely((cache = umem_pool_cache_get(pool_mgr)) != NULL))
+        buffer = umem_pool_cache_pop(pool_mgr, cache, pool);
+    else
+#endif
     if (likely(pool < pool_mgr->nb_pools))
         buffer = ulifo_pop(&pool_mgr->pools[pool], uint8_t *);
     if (unlikely(buffer == NULL))
@@ -117,6 +317,13 @@ static void umem_pool_free(struct umem *umem)
     struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_umem_mgr(umem->mgr);
     unsigned int pool = umem_pool_find(umem->mgr, umem->real_size, NULL);
 
+#ifdef UPIPE_HAVE_PTHREAD
+    struct umem_pool_cache *cache;
+    if (pool_mgr->magazine_size && likely(pool < pool_mgr->nb_pools) &&
+        likely((cache = umem_pool_cache_get(pool_mgr)) != NULL))
+        umem_pool_cache_push(pool_mgr, cache, pool, umem->buffer);
+    else
+#endif
     if (unlikely(pool >= pool_mgr->nb_pools ||
                  !ulifo_push(&pool_mgr->pools[pool], umem->buffer)))
         free(umem->buffer);
@@ -158,6 +365,14 @@ static void umem_pool_mgr_vacuum(struct umem_mgr *mgr)
 {
     struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_umem_mgr(mgr);
 
+#ifdef UPIPE_HAVE_PTHREAD
+    /* caches of other threads can't be accessed safely */
+    struct umem_pool_cache *cache;
+    if (pool_mgr->magazine_size &&
+        (cache = pthread_getspecific(pool_mgr->key)) != NULL)
+        umem_pool_cache_flush(cache);
+#endif
+
     for (unsigned int i = 0; i < pool_mgr->nb_pools; i++) {
         uint8_t *buffer;
         while ((buffer = ulifo_pop(&pool_mgr->pools[i], uint8_t *)) != NULL)
@@ -172,6 +387,22 @@ static void umem_pool_mgr_vacuum(struct umem_mgr *mgr)
 static void umem_pool_mgr_free(struct urefcount *urefcount)
 {
     struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_urefcount(urefcount);
+#ifdef UPIPE_HAVE_PTHREAD
+    if (pool_mgr->magazine_size) {
+        /* all threads are supposed to have stopped using the manager */
+        pthread_key_delete(pool_mgr->key);
+        struct uchain *uchain, *uchain_tmp;
+        ulist_delete_foreach (&pool_mgr->caches, uchain, uchain_tmp) {
+            struct umem_pool_cache *cache =
+                umem_pool_cache_from_uchain(uchain);
+            umem_pool_cache_flush(cache);
+            ulist_delete(uchain);
+            free(cache);
+        }
+        pthread_mutex_destroy(&pool_mgr->mutex);
+        free(pool_mgr->stats);
+    }
+#endif
     umem_pool_mgr_vacuum(umem_pool_mgr_to_umem_mgr(pool_mgr));
 
     for (unsigned int i = 0; i < pool_mgr->nb_pools; i++)
@@ -181,30 +412,29 @@ static void umem_pool_mgr_free(struct urefcount *urefcount)
     free(pool_mgr);
 }
 
-/** @This allocates a new instance of the umem pool manager allocating buffers
- * from application memory, using pools in power of 2's.
+/** @internal @This allocates a new instance of the umem pool manager
+ * allocating buffers from application memory, using pools in power of 2's.
  *
  * @param pool0_size size (in octets) of the smallest allocatable buffer; it
  * must be a power of 2
- * @param nb_pools number of buffer pools to maintain, with sizes in power of
- * 2's increments, followed, for each pool, by the maximum number of buffers
- * to keep in the pool (unsigned int); larger buffers will be directly managed
- * with malloc() and free()
+ * @param magazine_size number of buffers exchanged at once between the
+ * per-thread caches and the pools, or 0 to disable per-thread caches
+ * @param nb_pools number of buffer pools to maintain
+ * @param args maximum number of buffers to keep in each pool (unsigned int)
  * @return pointer to manager, or NULL in case of error
  */
-struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...)
+static struct umem_mgr *umem_pool_mgr_alloc_va(size_t pool0_size,
+                                               unsigned int magazine_size,
+                                               size_t nb_pools, va_list args)
 {
     size_t alloc_size = sizeof(struct umem_pool_mgr) +
                         sizeof(struct ulifo) * nb_pools;
     unsigned int pools_depths[nb_pools];
-    va_list args;
-    va_start(args, nb_pools);
     for (unsigned int i = 0; i < nb_pools; i++) {
         pools_depths[i] = va_arg(args, unsigned int);
         assert(pools_depths[i] <= UINT16_MAX);
         alloc_size += ulifo_sizeof(pools_depths[i]);
     }
-    va_end(args);
 
     struct umem_pool_mgr *pool_mgr = malloc(alloc_size);
     if (unlikely(pool_mgr == NULL))
@@ -212,6 +442,25 @@ struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...)
 
     pool_mgr->pool0_size = pool0_size;
     pool_mgr->nb_pools = nb_pools;
+    pool_mgr->magazine_size = 0;
+#ifdef UPIPE_HAVE_PTHREAD
+    if (magazine_size) {
+        pool_mgr->stats = calloc(nb_pools, sizeof(struct umem_pool_stats));
+        if (unlikely(pool_mgr->stats == NULL)) {
+            free(pool_mgr);
+            return NULL;
+        }
+        if (unlikely(pthread_key_create(&pool_mgr->key,
+                                        umem_pool_cache_free) != 0)) {
+            free(pool_mgr->stats);
+            free(pool_mgr);
+            return NULL;
+        }
+        pthread_mutex_init(&pool_mgr->mutex, NULL);
+        ulist_init(&pool_mgr->caches);
+        pool_mgr->magazine_size = magazine_size;
+    }
+#endif
 
     void *extra = (void *)pool_mgr + sizeof(struct umem_pool_mgr) +
                   sizeof(struct ulifo) * nb_pools;
@@ -231,6 +480,97 @@ struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...)
     return umem_pool_mgr_to_umem_mgr(pool_mgr);
 }
 
+/** @This allocates a new instance of the umem pool manager allocating buffers
+ * from application memory, using pools in power of 2's.
+ *
+ * @param pool0_size size (in octets) of the smallest allocatable buffer; it
+ * must be a power of 2
+ * @param nb_pools number of buffer pools to maintain, with sizes in power of
+ * 2's increments, followed, for each pool, by the maximum number of buffers
+ * to keep in the pool (unsigned int); larger buffers will be directly managed
+ * with malloc() and free()
+ * @return pointer to manager, or NULL in case of error
+ */
+struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...)
+{
+    va_list args;
+    va_start(args, nb_pools);
+    struct umem_mgr *mgr = umem_pool_mgr_alloc_va(pool0_size, 0,
+                                                  nb_pools, args);
+    va_end(args);
+    return mgr;
+}
+
+/** @This allocates a new instance of the umem pool manager allocating buffers
+ * from application memory, using pools in power of 2's, and per-thread
+ * caches in front of the pools.
+ *
+ * Each thread keeps up to twice magazine_size buffers of each size, so that
+ * most allocations and releases do not touch the shared pools. The caches
+ * exchange magazine_size buffers at once with the shared pools when they
+ * run empty or full. When a thread exits, its cache is released to the
+ * shared pools. The manager must not be used concurrently with its release.
+ *
+ * If the platform does not support threads, this is identical to
+ * @ref umem_pool_mgr_alloc.
+ *
+ * @param pool0_size size (in octets) of the smallest allocatable buffer; it
+ * must be a power of 2
+ * @param magazine_size number of buffers exchanged at once between the
+ * per-thread caches and the pools
+ * @param nb_pools number of buffer pools to maintain, with sizes in power of
+ * 2's increments, followed, for each pool, by the maximum number of buffers
+ * to keep in the pool (unsigned int); larger buffers will be directly managed
+ * with malloc() and free()
+ * @return pointer to manager, or NULL in case of error
+ */
+struct umem_mgr *umem_pool_mgr_alloc_cached(size_t pool0_size,
+                                            unsigned int magazine_size,
+                                            size_t nb_pools, ...)
+{
+    va_list args;
+    va_start(args, nb_pools);
+    struct umem_mgr *mgr = umem_pool_mgr_alloc_va(pool0_size, magazine_size,
+                                                  nb_pools, args);
+    va_end(args);
+    return mgr;
+}
+
+/** @This returns the statistics of a pool of a manager allocated with
+ * @ref umem_pool_mgr_alloc_cached. Statistics of running threads are
+ * read without synchronization and may be slightly off.
+ *
+ * @param mgr pointer to umem manager
+ * @param pool index of the pool (0 for buffers of pool0_size)
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+int umem_pool_mgr_get_stats(struct umem_mgr *mgr, unsigned int pool,
+                            struct umem_pool_stats *stats)
+{
+    if (unlikely(mgr == NULL || mgr->umem_alloc != umem_pool_alloc))
+        return UBASE_ERR_INVALID;
+
+    struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_umem_mgr(mgr);
+    if (unlikely(pool >= pool_mgr->nb_pools))
+        return UBASE_ERR_INVALID;
+    if (!pool_mgr->magazine_size)
+        return UBASE_ERR_UNHANDLED;
+
+#ifdef UPIPE_HAVE_PTHREAD
+    struct umem_pool_stats all[pool_mgr->nb_pools];
+    pthread_mutex_lock(&pool_mgr->mutex);
+    memcpy(all, pool_mgr->stats, sizeof(all));
+    struct uchain *uchain;
+    ulist_foreach (&pool_mgr->caches, uchain)
+        umem_pool_cache_add_stats(pool_mgr, all,
+                                  umem_pool_cache_from_uchain(uchain));
+    pthread_mutex_unlock(&pool_mgr->mutex);
+    *stats = all[pool];
+#endif
+    return UBASE_ERR_NONE;
+}
+
 /** @This allocates a new instance of the umem pool manager allocating buffers
  * from application memory, using pools in power of 2's, with a simpler API.
  *
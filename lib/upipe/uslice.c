@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe pool of threads processing slices of a job in parallel
+ * Without POSIX threads, pools have no threads and all slices are processed
+ * in the calling thread.
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/uslice.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#ifdef UPIPE_HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+/** @This is the private structure of a pool of threads. */
+struct uslice_pool {
+    /** number of threads */
+    unsigned int nb_threads;
+
+#ifdef UPIPE_HAVE_PTHREAD
+    /** protects all fields below */
+    pthread_mutex_t mutex;
+    /** signals a new job or the end of the pool to the threads */
+    pthread_cond_t work_cond;
+    /** signals the completion of the last slice */
+    pthread_cond_t done_cond;
+
+    /** threads */
+    pthread_t *threads;
+    /** true if the threads must exit */
+    bool exit;
+
+    /** incremented for each job */
+    uint64_t generation;
+    /** function processing a slice */
+    uslice_cb cb;
+    /** opaque passed to cb */
+    void *opaque;
+    /** number of slices of the current job */
+    unsigned int nb_slices;
+    /** next slice to process */
+    unsigned int next;
+    /** number of completed slices */
+    unsigned int done;
+#endif
+};
+
+#ifdef UPIPE_HAVE_PTHREAD
+
+/** @internal @This processes slices until there are none left. It is
+ * called and returns with the mutex held.
+ *
+ * @param pool pointer to the pool
+ */
+static void uslice_pool_work(struct uslice_pool *pool)
+{
+    while (pool->next < pool->nb_slices) {
+        unsigned int slice = pool->next++;
+        uslice_cb cb = pool->cb;
+        void *opaque = pool->opaque;
+        unsigned int nb_slices = pool->nb_slices;
+
+        pthread_mutex_unlock(&pool->mutex);
+        cb(opaque, slice, nb_slices);
+        pthread_mutex_lock(&pool->mutex);
+
+        if (++pool->done == pool->nb_slices)
+            pthread_cond_signal(&pool->done_cond);
+    }
+}
+
+/** @internal @This is the main loop of the threads.
+ *
+ * @param _pool pointer to the pool
+ * @return NULL
+ */
+static void *uslice_pool_thread(void *_pool)
+{
+    struct uslice_pool *pool = _pool;
+    uint64_t generation = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    for ( ; ; ) {
+        while (!pool->exit && pool->generation == generation)
+            pthread_cond_wait(&pool->work_cond, &pool->mutex);
+        if (pool->exit)
+            break;
+        generation = pool->generation;
+        uslice_pool_work(pool);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+#endif
+
+/** @This allocates a pool of threads.
+ *
+ * @param nb_threads number of threads to run in addition to the calling
+ * thread
+ * @return pointer to the pool, or NULL in case of error
+ */
+struct uslice_pool *uslice_pool_alloc(unsigned int nb_threads)
+{
+    struct uslice_pool *pool = malloc(sizeof(struct uslice_pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+    pool->nb_threads = 0;
+
+#ifdef UPIPE_HAVE_PTHREAD
+    pool->threads = malloc(sizeof(pthread_t) * (nb_threads ? nb_threads : 1));
+    if (unlikely(pool->threads == NULL)) {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    pool->exit = false;
+    pool->generation = 0;
+    pool->cb = NULL;
+    pool->opaque = NULL;
+    pool->nb_slices = pool->next = pool->done = 0;
+
+    for ( ; pool->nb_threads < nb_threads; pool->nb_threads++)
+        if (unlikely(pthread_create(&pool->threads[pool->nb_threads], NULL,
+                                    uslice_pool_thread, pool) != 0)) {
+            uslice_pool_free(pool);
+            return NULL;
+        }
+#endif
+    return pool;
+}
+
+/** @This returns the number of threads of the pool, including the calling
+ * thread.
+ *
+ * @param pool pointer to the pool
+ * @return number of threads
+ */
+unsigned int uslice_pool_threads(struct uslice_pool *pool)
+{
+    return pool != NULL ? pool->nb_threads + 1 : 1;
+}
+
+/** @This processes nb_slices slices and returns when all of them are done.
+ *
+ * @param pool pointer to the pool, or NULL
+ * @param nb_slices number of slices
+ * @param cb function processing a slice
+ * @param opaque opaque passed to cb
+ */
+void uslice_pool_run(struct uslice_pool *pool, unsigned int nb_slices,
+                     uslice_cb cb, void *opaque)
+{
+    if (pool == NULL || !pool->nb_threads || nb_slices <= 1) {
+        for (unsigned int i = 0; i < nb_slices; i++)
+            cb(opaque, i, nb_slices);
+        return;
+    }
+
+#ifdef UPIPE_HAVE_PTHREAD
+    pthread_mutex_lock(&pool->mutex);
+    pool->cb = cb;
+    pool->opaque = opaque;
+    pool->nb_slices = nb_slices;
+    pool->next = pool->done = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_cond);
+
+    uslice_pool_work(pool);
+    while (pool->done < pool->nb_slices)
+        pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+#endif
+}
+
+/** @This stops the threads and frees the pool.
+ *
+ * @param pool pointer to the pool (may be NULL)
+ */
+void uslice_pool_free(struct uslice_pool *pool)
+{
+    if (pool == NULL)
+        return;
+
+#ifdef UPIPE_HAVE_PTHREAD
+    pthread_mutex_lock(&pool->mutex);
+    pool->exit = true;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+    for (unsigned int i = 0; i < pool->nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->threads);
+#endif
+    free(pool);
+}
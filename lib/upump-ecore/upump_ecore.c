@@ -178,7 +178,7 @@ static struct upump *upump_ecore_alloc(struct upump_mgr *mgr,
             break;
         }
         default:
-            free(upump_ecore);
+            upool_free(&ecore_mgr->common_mgr.upump_pool, upump_ecore);
             return NULL;
     }
     upump_ecore->event = event;
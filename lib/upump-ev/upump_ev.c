@@ -185,7 +185,7 @@ static struct upump *upump_ev_alloc(struct upump_mgr *mgr,
             break;
         }
         default:
-            free(upump_ev);
+            upool_free(&ev_mgr->common_mgr.upump_pool, upump_ev);
             return NULL;
     }
     upump_ev->event = event;
@@ -0,0 +1,1536 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short implementation of a Upipe event loop using Linux io_uring
+ *
+ * File descriptor watchers are implemented with one-shot poll requests,
+ * re-armed before each dispatch so that they stay level-triggered. Timers
+ * and idlers are handled in user space and only set the timeout of the
+ * io_uring_enter() call, which submits all requests queued during an
+ * iteration and waits for completions at once.
+ *
+ * Requests in flight carry the address of their pump as user data. A pump
+ * being stopped cancels its requests and waits for their completions, so
+ * that no completion ever refers to a stopped or freed pump.
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/urefcount.h>
+#include <upipe/uclock.h>
+#include <upipe/umutex.h>
+#include <upipe/umem.h>
+#include <upipe/ulist.h>
+#include <upipe/upump.h>
+#include <upipe/upump_common.h>
+#include <upump-uring/upump_uring.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <endian.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+
+#include <linux/io_uring.h>
+
+/** number of entries of the submission queue */
+#define URING_SQ_ENTRIES 256
+/** number of entries of the completion queue */
+#define URING_CQ_ENTRIES 4096
+/** space reserved for the source address of a datagram */
+#define URING_NAME_SIZE sizeof(struct sockaddr_storage)
+/** space reserved for the ancillary data of a datagram, such as timestamps */
+#define URING_CONTROL_SIZE 64
+/** maximum number of buffers of a recv pump (buffer ids are 16 bits) */
+#define URING_MAX_BUFFERS 32768
+/** number of buffer groups */
+#define URING_MAX_BGIDS 65536
+/** delay before retrying to allocate the buffers of a starving recv pump */
+#define URING_STARVING_DELAY (UCLOCK_FREQ / 1000)
+
+/** @This stores management parameters and local structures.
+ */
+struct upump_uring_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** io_uring file descriptor */
+    int fd;
+    /** mapping of the submission ring */
+    void *sq_map;
+    /** size of the mapping of the submission ring */
+    size_t sq_map_size;
+    /** mapping of the completion ring (may be the same as sq_map) */
+    void *cq_map;
+    /** size of the mapping of the completion ring */
+    size_t cq_map_size;
+    /** array of submission queue entries */
+    struct io_uring_sqe *sqes;
+    /** size of the array of submission queue entries */
+    size_t sqes_size;
+
+    /** head of the submission ring, written by the kernel */
+    unsigned int *sq_head;
+    /** tail of the submission ring */
+    unsigned int *sq_tail;
+    /** index array of the submission ring */
+    unsigned int *sq_array;
+    /** mask of the submission ring */
+    unsigned int sq_mask;
+    /** number of entries of the submission ring */
+    unsigned int sq_entries;
+    /** tail of the submission ring, not yet published to the kernel */
+    unsigned int sq_local_tail;
+
+    /** head of the completion ring */
+    unsigned int *cq_head;
+    /** tail of the completion ring, written by the kernel */
+    unsigned int *cq_tail;
+    /** mask of the completion ring */
+    unsigned int cq_mask;
+    /** array of completion queue entries */
+    struct io_uring_cqe *cqes;
+
+    /** completions reaped from the ring and not yet dispatched */
+    struct io_uring_cqe *events;
+    /** number of reaped completions */
+    unsigned int nb_events;
+    /** index of the next completion to dispatch */
+    unsigned int next_event;
+    /** allocated size of the events array */
+    unsigned int max_events;
+
+    /** list of started idlers */
+    struct uchain idlers;
+    /** list of started timers, sorted by deadline */
+    struct uchain timers;
+    /** list of started recv pumps waiting for buffers to be rearmed */
+    struct uchain starving;
+    /** number of started blocking pumps */
+    unsigned int blocking;
+
+    /** bitmap of buffer group ids in use */
+    uint64_t bgids[URING_MAX_BGIDS / 64];
+    /** buffer received by the pump being dispatched */
+    struct upump_recv recv;
+    /** opaque of the request completed by the pump being dispatched */
+    void *sent_opaque;
+    /** result of the request completed by the pump being dispatched */
+    ssize_t sent_result;
+
+    /** common structure */
+    struct upump_common_mgr common_mgr;
+
+    /** extra space for upool */
+    uint8_t upool_extra[];
+};
+
+UBASE_FROM_TO(upump_uring_mgr, upump_mgr, upump_mgr, common_mgr.mgr)
+UBASE_FROM_TO(upump_uring_mgr, urefcount, urefcount, urefcount)
+
+/** @This stores a request of a send pump. */
+struct upump_uring_send_req {
+    /** message header */
+    struct msghdr msg;
+    /** opaque returned on completion */
+    void *opaque;
+};
+
+/** @This stores local structures.
+ */
+struct upump_uring {
+    /** type of event to watch */
+    int event;
+    /** true if the pump is started in the event loop */
+    bool active;
+    /** number of requests in flight in the kernel */
+    unsigned int inflight;
+    /** file descriptor (signalfd for signals) */
+    int fd;
+    /** structure for the lists of idlers, timers and starving pumps */
+    struct uchain uchain;
+
+    union {
+        /** timers */
+        struct {
+            /** delay of the first occurrence */
+            uint64_t after;
+            /** delay of the next occurrences, or 0 */
+            uint64_t repeat;
+            /** date of the next occurrence */
+            uint64_t deadline;
+        } timer;
+        /** signals */
+        struct {
+            /** signal number */
+            int signal;
+        } sig;
+        /** recv pumps */
+        struct {
+            /** ring of buffers provided to the kernel */
+            struct io_uring_buf_ring *ring;
+            /** size of the mapping of the ring */
+            size_t ring_size;
+            /** number of entries of the ring */
+            unsigned int ring_entries;
+            /** local copy of the tail of the ring */
+            uint16_t tail;
+            /** buffer group id */
+            uint16_t bgid;
+            /** buffers, indexed by buffer id */
+            struct umem *umems;
+            /** ids of the buffers which could not be reallocated */
+            uint16_t *missing;
+            /** number of missing buffers */
+            unsigned int nb_missing;
+            /** number of buffers */
+            unsigned int nb_buffers;
+            /** allocated size of a buffer */
+            size_t size;
+            /** space before the data in a buffer */
+            size_t headroom;
+            /** memory allocator */
+            struct umem_mgr *umem_mgr;
+            /** true for sockets, which use multishot recvmsg */
+            bool socket;
+            /** true for streams, for which a 0 size means the end */
+            bool stream;
+            /** message header template of the multishot recvmsg */
+            struct msghdr msg;
+            /** unused name storage referenced by msg */
+            struct sockaddr_storage name;
+            /** unused ancillary data storage referenced by msg */
+            uint8_t control[URING_CONTROL_SIZE];
+        } recv;
+        /** send pumps */
+        struct {
+            /** circular array of requests */
+            struct upump_uring_send_req *reqs;
+            /** size of the array */
+            unsigned int depth;
+            /** index of the oldest request */
+            unsigned int head;
+            /** number of requests in the array */
+            unsigned int count;
+            /** number of requests submitted and not yet dispatched */
+            unsigned int submitted;
+            /** true for sockets, which use sendmsg */
+            bool socket;
+        } send;
+    };
+
+    /** common structure */
+    struct upump_common common;
+};
+
+UBASE_FROM_TO(upump_uring, upump, upump, common.upump)
+UBASE_FROM_TO(upump_uring, uchain, uchain, uchain)
+
+/** @internal @This returns the current date of the monotonic clock.
+ *
+ * @return date in 27 MHz ticks
+ */
+static uint64_t upump_uring_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * UCLOCK_FREQ +
+           (uint64_t)ts.tv_nsec * (UCLOCK_FREQ / 1000000) / 1000;
+}
+
+/** @internal @This submits the queued requests, and optionally waits for
+ * completions.
+ *
+ * @param uring_mgr description structure of the manager
+ * @param wait true to wait for at least one completion
+ * @param timeout maximum waiting time in 27 MHz ticks (0 to only process
+ * pending completions), or UINT64_MAX
+ * @return an error code
+ */
+static int upump_uring_mgr_enter(struct upump_uring_mgr *uring_mgr,
+                                 bool wait, uint64_t timeout)
+{
+    __atomic_store_n(uring_mgr->sq_tail, uring_mgr->sq_local_tail,
+                     __ATOMIC_RELEASE);
+    unsigned int to_submit = uring_mgr->sq_local_tail -
+        __atomic_load_n(uring_mgr->sq_head, __ATOMIC_ACQUIRE);
+    if (!wait && !to_submit)
+        return UBASE_ERR_NONE;
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    unsigned int flags = 0;
+    if (wait) {
+        flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        if (timeout != UINT64_MAX) {
+            ts.tv_sec = timeout / UCLOCK_FREQ;
+            ts.tv_nsec = (timeout % UCLOCK_FREQ) * 1000 /
+                         (UCLOCK_FREQ / 1000000);
+            arg.ts = (uintptr_t)&ts;
+        }
+    }
+
+    if (syscall(__NR_io_uring_enter, uring_mgr->fd, to_submit, wait ? 1 : 0,
+                flags, wait ? &arg : NULL, wait ? sizeof(arg) : 0) < 0) {
+        switch (errno) {
+            case EINTR:
+            case ETIME:
+            case EBUSY:
+            case EAGAIN:
+                break;
+            default:
+                return UBASE_ERR_EXTERNAL;
+        }
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This returns a free submission queue entry.
+ *
+ * @param uring_mgr description structure of the manager
+ * @return pointer to a zeroed submission queue entry
+ */
+static struct io_uring_sqe *upump_uring_mgr_get_sqe(
+        struct upump_uring_mgr *uring_mgr)
+{
+    while (uring_mgr->sq_local_tail -
+           __atomic_load_n(uring_mgr->sq_head, __ATOMIC_ACQUIRE) >=
+           uring_mgr->sq_entries)
+        upump_uring_mgr_enter(uring_mgr, false, 0);
+
+    unsigned int index = uring_mgr->sq_local_tail & uring_mgr->sq_mask;
+    struct io_uring_sqe *sqe = &uring_mgr->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    uring_mgr->sq_array[index] = index;
+    uring_mgr->sq_local_tail++;
+    return sqe;
+}
+
+/** @internal @This moves the available completions from the ring to the
+ * array of completions to dispatch.
+ *
+ * @param uring_mgr description structure of the manager
+ */
+static void upump_uring_mgr_reap(struct upump_uring_mgr *uring_mgr)
+{
+    unsigned int head = *uring_mgr->cq_head;
+    unsigned int tail = __atomic_load_n(uring_mgr->cq_tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        if (unlikely(uring_mgr->nb_events >= uring_mgr->max_events)) {
+            unsigned int max_events = uring_mgr->max_events * 2;
+            struct io_uring_cqe *events = realloc(uring_mgr->events,
+                    max_events * sizeof(struct io_uring_cqe));
+            if (unlikely(events == NULL))
+                break;
+            uring_mgr->events = events;
+            uring_mgr->max_events = max_events;
+        }
+
+        struct io_uring_cqe *cqe = &uring_mgr->cqes[head & uring_mgr->cq_mask];
+        uring_mgr->events[uring_mgr->nb_events++] = *cqe;
+        if (cqe->user_data && !(cqe->flags & IORING_CQE_F_MORE)) {
+            struct upump_uring *upump_uring =
+                (struct upump_uring *)(uintptr_t)cqe->user_data;
+            upump_uring->inflight--;
+        }
+        head++;
+    }
+    __atomic_store_n(uring_mgr->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/** @internal @This allocates a buffer group id.
+ *
+ * @param uring_mgr description structure of the manager
+ * @param bgid_p filled in with the buffer group id
+ * @return false if all ids are in use
+ */
+static bool upump_uring_mgr_get_bgid(struct upump_uring_mgr *uring_mgr,
+                                     uint16_t *bgid_p)
+{
+    for (unsigned int i = 0; i < URING_MAX_BGIDS / 64; i++) {
+        if (uring_mgr->bgids[i] == UINT64_MAX)
+            continue;
+        unsigned int bit = __builtin_ctzll(~uring_mgr->bgids[i]);
+        uring_mgr->bgids[i] |= UINT64_C(1) << bit;
+        *bgid_p = i * 64 + bit;
+        return true;
+    }
+    return false;
+}
+
+/** @internal @This releases a buffer group id.
+ *
+ * @param uring_mgr description structure of the manager
+ * @param bgid buffer group id
+ */
+static void upump_uring_mgr_put_bgid(struct upump_uring_mgr *uring_mgr,
+                                     uint16_t bgid)
+{
+    uring_mgr->bgids[bgid / 64] &= ~(UINT64_C(1) << (bgid % 64));
+}
+
+/** @internal @This queues a poll request for a file descriptor.
+ *
+ * @param upump_uring private structure of the pump
+ * @param events poll events to watch
+ */
+static void upump_uring_arm_poll(struct upump_uring *upump_uring,
+                                 uint32_t events)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump_uring_to_upump(upump_uring)->mgr);
+    struct io_uring_sqe *sqe = upump_uring_mgr_get_sqe(uring_mgr);
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = upump_uring->fd;
+#if __BYTE_ORDER == __BIG_ENDIAN
+    events = (events << 16) | (events >> 16);
+#endif
+    sqe->poll32_events = events;
+    sqe->user_data = (uintptr_t)upump_uring;
+    upump_uring->inflight++;
+}
+
+/** @internal @This provides a buffer to the kernel.
+ *
+ * @param upump_uring private structure of the pump
+ * @param bid buffer id
+ */
+static void upump_uring_recv_provide(struct upump_uring *upump_uring,
+                                     uint16_t bid)
+{
+    struct io_uring_buf *buf = &upump_uring->recv.ring->bufs[
+        upump_uring->recv.tail & (upump_uring->recv.ring_entries - 1)];
+    buf->addr = (uintptr_t)umem_buffer(&upump_uring->recv.umems[bid]);
+    buf->len = upump_uring->recv.size;
+    buf->bid = bid;
+    upump_uring->recv.tail++;
+    __atomic_store_n(&upump_uring->recv.ring->tail, upump_uring->recv.tail,
+                     __ATOMIC_RELEASE);
+}
+
+/** @internal @This reallocates the buffers handed over to the application,
+ * and provides them to the kernel.
+ *
+ * @param upump_uring private structure of the pump
+ */
+static void upump_uring_recv_refill(struct upump_uring *upump_uring)
+{
+    while (upump_uring->recv.nb_missing) {
+        uint16_t bid =
+            upump_uring->recv.missing[upump_uring->recv.nb_missing - 1];
+        if (unlikely(!umem_alloc(upump_uring->recv.umem_mgr,
+                                 &upump_uring->recv.umems[bid],
+                                 upump_uring->recv.size)))
+            break;
+        upump_uring->recv.nb_missing--;
+        upump_uring_recv_provide(upump_uring, bid);
+    }
+}
+
+/** @internal @This queues the receive request of a recv pump.
+ *
+ * @param upump_uring private structure of the pump
+ */
+static void upump_uring_arm_recv(struct upump_uring *upump_uring)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump_uring_to_upump(upump_uring)->mgr);
+    struct io_uring_sqe *sqe = upump_uring_mgr_get_sqe(uring_mgr);
+    sqe->fd = upump_uring->fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = upump_uring->recv.bgid;
+    sqe->user_data = (uintptr_t)upump_uring;
+    if (upump_uring->recv.socket) {
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->addr = (uintptr_t)&upump_uring->recv.msg;
+        sqe->len = 1;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+    } else {
+        sqe->opcode = IORING_OP_READ;
+        sqe->off = (uint64_t)-1;
+        sqe->len = upump_uring->recv.size;
+    }
+    upump_uring->inflight++;
+}
+
+/** @internal @This queues the pending requests of a send pump, as a chain of
+ * linked requests so that they are executed in order.
+ *
+ * @param upump_uring private structure of the pump
+ */
+static void upump_uring_arm_send(struct upump_uring *upump_uring)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump_uring_to_upump(upump_uring)->mgr);
+    struct io_uring_sqe *sqe = NULL;
+    while (upump_uring->send.submitted < upump_uring->send.count) {
+        if (sqe != NULL)
+            sqe->flags |= IOSQE_IO_LINK;
+        struct upump_uring_send_req *req = &upump_uring->send.reqs[
+            (upump_uring->send.head + upump_uring->send.submitted) %
+            upump_uring->send.depth];
+        sqe = upump_uring_mgr_get_sqe(uring_mgr);
+        sqe->fd = upump_uring->fd;
+        sqe->user_data = (uintptr_t)upump_uring;
+        if (upump_uring->send.socket) {
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->addr = (uintptr_t)&req->msg;
+            sqe->len = 1;
+            sqe->msg_flags = MSG_NOSIGNAL;
+        } else {
+            sqe->opcode = IORING_OP_WRITEV;
+            sqe->addr = (uintptr_t)req->msg.msg_iov;
+            sqe->len = req->msg.msg_iovlen;
+            sqe->off = (uint64_t)-1;
+        }
+        upump_uring->send.submitted++;
+        upump_uring->inflight++;
+    }
+}
+
+/** @internal @This cancels the requests in flight of a pump, waits for their
+ * completion, and forgets the completions not yet dispatched.
+ *
+ * @param upump_uring private structure of the pump
+ */
+static void upump_uring_cancel(struct upump_uring *upump_uring)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump_uring_to_upump(upump_uring)->mgr);
+
+    if (upump_uring->inflight) {
+        struct io_uring_sqe *sqe = upump_uring_mgr_get_sqe(uring_mgr);
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = (uintptr_t)upump_uring;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+        while (upump_uring->inflight) {
+            if (unlikely(!ubase_check(upump_uring_mgr_enter(uring_mgr, true,
+                                                            UINT64_MAX))))
+                break;
+            upump_uring_mgr_reap(uring_mgr);
+        }
+    }
+
+    for (unsigned int i = uring_mgr->next_event; i < uring_mgr->nb_events;
+         i++) {
+        struct io_uring_cqe *cqe = &uring_mgr->events[i];
+        if (cqe->user_data != (uintptr_t)upump_uring)
+            continue;
+        cqe->user_data = 0;
+        switch (upump_uring->event) {
+            case UPUMP_TYPE_FD_RECV:
+                if (cqe->flags & IORING_CQE_F_BUFFER)
+                    upump_uring_recv_provide(upump_uring,
+                            cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+                break;
+            case UPUMP_TYPE_FD_SEND:
+                upump_uring->send.head =
+                    (upump_uring->send.head + 1) % upump_uring->send.depth;
+                upump_uring->send.count--;
+                upump_uring->send.submitted--;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/** @internal @This inserts a timer in the sorted list of timers.
+ *
+ * @param uring_mgr description structure of the manager
+ * @param upump_uring private structure of the pump
+ */
+static void upump_uring_mgr_add_timer(struct upump_uring_mgr *uring_mgr,
+                                      struct upump_uring *upump_uring)
+{
+    struct uchain *uchain;
+    ulist_foreach (&uring_mgr->timers, uchain) {
+        struct upump_uring *timer = upump_uring_from_uchain(uchain);
+        if (timer->timer.deadline > upump_uring->timer.deadline) {
+            ulist_insert(uchain->prev, uchain,
+                         upump_uring_to_uchain(upump_uring));
+            return;
+        }
+    }
+    ulist_add(&uring_mgr->timers, upump_uring_to_uchain(upump_uring));
+}
+
+/** @internal @This dispatches the completion of a poll request.
+ *
+ * @param upump_uring private structure of the pump
+ * @param cqe completion
+ */
+static void upump_uring_dispatch_poll(struct upump_uring *upump_uring,
+                                      const struct io_uring_cqe *cqe)
+{
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+    if (upump_uring->event == UPUMP_TYPE_SIGNAL) {
+        struct signalfd_siginfo siginfo;
+        while (read(upump_uring->fd, &siginfo, sizeof(siginfo)) > 0);
+    }
+
+    /* the request is queued before the callback, which may free the pump,
+     * and only executed by the next io_uring_enter() */
+    if (cqe->res >= 0 && upump_uring->active && !upump_uring->inflight)
+        upump_uring_arm_poll(upump_uring,
+                upump_uring->event == UPUMP_TYPE_FD_WRITE ? POLLOUT : POLLIN);
+    upump_common_dispatch(upump);
+}
+
+/** @internal @This dispatches the completion of a receive request.
+ *
+ * @param upump_uring private structure of the pump
+ * @param cqe completion
+ */
+static void upump_uring_dispatch_recv(struct upump_uring *upump_uring,
+                                      const struct io_uring_cqe *cqe)
+{
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+    struct upump_recv *recv = &uring_mgr->recv;
+    memset(recv, 0, sizeof(struct upump_recv));
+    recv->size = cqe->res;
+
+    bool rearm = cqe->res == -ENOBUFS;
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        uint16_t bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        recv->umem = upump_uring->recv.umems[bid];
+        recv->offset = upump_uring->recv.headroom;
+        if (upump_uring->recv.socket) {
+            const struct io_uring_recvmsg_out *out =
+                (const struct io_uring_recvmsg_out *)umem_buffer(&recv->umem);
+            recv->size = cqe->res - upump_uring->recv.headroom;
+            if (out->namelen) {
+                recv->addr = (const struct sockaddr *)(out + 1);
+                recv->addrlen = out->namelen < URING_NAME_SIZE ?
+                                out->namelen : URING_NAME_SIZE;
+            }
+            if (out->controllen) {
+                recv->control = (const uint8_t *)(out + 1) + URING_NAME_SIZE;
+                recv->controllen = out->controllen < URING_CONTROL_SIZE ?
+                                   out->controllen : URING_CONTROL_SIZE;
+            }
+        }
+        upump_uring->recv.umems[bid].mgr = NULL;
+        upump_uring->recv.missing[upump_uring->recv.nb_missing++] = bid;
+        rearm = !upump_uring->recv.stream || recv->size;
+    }
+    upump_uring_recv_refill(upump_uring);
+
+    if (!(cqe->flags & IORING_CQE_F_MORE) && rearm && upump_uring->active &&
+        !upump_uring->inflight) {
+        if (upump_uring->recv.nb_missing < upump_uring->recv.nb_buffers)
+            upump_uring_arm_recv(upump_uring);
+        else
+            /* retried from the event loop until buffers can be allocated */
+            ulist_add(&uring_mgr->starving,
+                      upump_uring_to_uchain(upump_uring));
+        if (cqe->res == -ENOBUFS)
+            /* not an error as the pump is rearmed */
+            return;
+    }
+
+    upump_common_dispatch(upump);
+    if (uring_mgr->recv.umem.mgr != NULL)
+        umem_free(&uring_mgr->recv.umem);
+    memset(&uring_mgr->recv, 0, sizeof(struct upump_recv));
+}
+
+/** @internal @This dispatches the completion of a send request.
+ *
+ * @param upump_uring private structure of the pump
+ * @param cqe completion
+ */
+static void upump_uring_dispatch_send(struct upump_uring *upump_uring,
+                                      const struct io_uring_cqe *cqe)
+{
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+    struct upump_uring_send_req *req =
+        &upump_uring->send.reqs[upump_uring->send.head];
+    uring_mgr->sent_opaque = req->opaque;
+    uring_mgr->sent_result = cqe->res;
+    upump_uring->send.head =
+        (upump_uring->send.head + 1) % upump_uring->send.depth;
+    upump_uring->send.count--;
+    upump_uring->send.submitted--;
+
+    if (upump_uring->active && !upump_uring->inflight &&
+        !upump_uring->send.submitted)
+        upump_uring_arm_send(upump_uring);
+
+    upump_common_dispatch(upump);
+    uring_mgr->sent_opaque = NULL;
+    uring_mgr->sent_result = 0;
+}
+
+/** @internal @This dispatches the reaped completions.
+ *
+ * @param uring_mgr description structure of the manager
+ */
+static void upump_uring_mgr_dispatch(struct upump_uring_mgr *uring_mgr)
+{
+    while (uring_mgr->next_event < uring_mgr->nb_events) {
+        struct io_uring_cqe cqe = uring_mgr->events[uring_mgr->next_event++];
+        if (!cqe.user_data)
+            continue;
+
+        struct upump_uring *upump_uring =
+            (struct upump_uring *)(uintptr_t)cqe.user_data;
+        switch (upump_uring->event) {
+            case UPUMP_TYPE_FD_READ:
+            case UPUMP_TYPE_FD_WRITE:
+            case UPUMP_TYPE_SIGNAL:
+                upump_uring_dispatch_poll(upump_uring, &cqe);
+                break;
+            case UPUMP_TYPE_FD_RECV:
+                upump_uring_dispatch_recv(upump_uring, &cqe);
+                break;
+            case UPUMP_TYPE_FD_SEND:
+                upump_uring_dispatch_send(upump_uring, &cqe);
+                break;
+            default:
+                break;
+        }
+    }
+    uring_mgr->nb_events = uring_mgr->next_event = 0;
+}
+
+/** @internal @This dispatches the expired timers.
+ *
+ * @param uring_mgr description structure of the manager
+ * @return true if at least one timer was dispatched
+ */
+static bool upump_uring_mgr_dispatch_timers(struct upump_uring_mgr *uring_mgr)
+{
+    uint64_t now = upump_uring_now();
+    bool dispatched = false;
+    struct uchain *uchain;
+    while ((uchain = ulist_peek(&uring_mgr->timers)) != NULL) {
+        struct upump_uring *upump_uring = upump_uring_from_uchain(uchain);
+        if (upump_uring->timer.deadline > now)
+            break;
+
+        struct upump *upump = upump_uring_to_upump(upump_uring);
+        ulist_delete(uchain);
+        if (upump_uring->timer.repeat) {
+            upump_uring->timer.deadline += upump_uring->timer.repeat;
+            if (upump_uring->timer.deadline <= now)
+                upump_uring->timer.deadline = now + upump_uring->timer.repeat;
+            upump_uring_mgr_add_timer(uring_mgr, upump_uring);
+        } else {
+            /* the timer is automatically stopped */
+            uchain_init(uchain);
+            upump_uring->active = false;
+            struct upump_common *common = upump_common_from_upump(upump);
+            if (common->status)
+                uring_mgr->blocking--;
+        }
+        upump_common_dispatch(upump);
+        dispatched = true;
+    }
+    return dispatched;
+}
+
+/** @internal @This retries to allocate the buffers of the starving recv
+ * pumps, and rearms those which got at least one.
+ *
+ * @param uring_mgr description structure of the manager
+ */
+static void upump_uring_mgr_feed_starving(struct upump_uring_mgr *uring_mgr)
+{
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach (&uring_mgr->starving, uchain, uchain_tmp) {
+        struct upump_uring *upump_uring = upump_uring_from_uchain(uchain);
+        upump_uring_recv_refill(upump_uring);
+        if (upump_uring->recv.nb_missing == upump_uring->recv.nb_buffers)
+            continue;
+
+        ulist_delete(uchain);
+        uchain_init(uchain);
+        upump_uring_arm_recv(upump_uring);
+    }
+}
+
+/** @internal @This dispatches the idlers.
+ *
+ * @param uring_mgr description structure of the manager
+ */
+static void upump_uring_mgr_dispatch_idlers(struct upump_uring_mgr *uring_mgr)
+{
+    unsigned int nb = 0;
+    struct uchain *uchain;
+    ulist_foreach (&uring_mgr->idlers, uchain)
+        nb++;
+
+    /* rotate the list so that idlers stopped or started by a callback do
+     * not break the iteration */
+    while (nb-- && (uchain = ulist_pop(&uring_mgr->idlers)) != NULL) {
+        ulist_add(&uring_mgr->idlers, uchain);
+        upump_common_dispatch(
+            upump_uring_to_upump(upump_uring_from_uchain(uchain)));
+    }
+}
+
+/** @internal @This frees the buffers of a recv pump.
+ *
+ * @param upump_uring private structure of the pump
+ */
+static void upump_uring_recv_clean(struct upump_uring *upump_uring)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump_uring_to_upump(upump_uring)->mgr);
+
+    if (upump_uring->recv.ring != NULL) {
+        struct io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.bgid = upump_uring->recv.bgid;
+        syscall(__NR_io_uring_register, uring_mgr->fd,
+                IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        munmap(upump_uring->recv.ring, upump_uring->recv.ring_size);
+        upump_uring_mgr_put_bgid(uring_mgr, upump_uring->recv.bgid);
+    }
+    if (upump_uring->recv.umems != NULL) {
+        for (unsigned int i = 0; i < upump_uring->recv.nb_buffers; i++)
+            if (upump_uring->recv.umems[i].mgr != NULL)
+                umem_free(&upump_uring->recv.umems[i]);
+        free(upump_uring->recv.umems);
+    }
+    free(upump_uring->recv.missing);
+    umem_mgr_release(upump_uring->recv.umem_mgr);
+}
+
+/** @internal @This initializes a recv pump.
+ *
+ * @param upump_uring private structure of the pump
+ * @param fd file descriptor to receive from
+ * @param umem_mgr memory allocator for the buffers
+ * @param size maximum size of the data of a buffer
+ * @param nb_buffers number of buffers
+ * @return false in case of failure
+ */
+static bool upump_uring_recv_init(struct upump_uring *upump_uring, int fd,
+                                  struct umem_mgr *umem_mgr,
+                                  unsigned int size, unsigned int nb_buffers)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump_uring_to_upump(upump_uring)->mgr);
+    memset(&upump_uring->recv, 0, sizeof(upump_uring->recv));
+    if (unlikely(umem_mgr == NULL || !size || !nb_buffers ||
+                 nb_buffers > URING_MAX_BUFFERS))
+        return false;
+    upump_uring->recv.umem_mgr = umem_mgr_use(umem_mgr);
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        int type;
+        socklen_t len = sizeof(type);
+        upump_uring->recv.socket = true;
+        upump_uring->recv.stream =
+            getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) == 0 &&
+            type == SOCK_STREAM;
+        upump_uring->recv.headroom = sizeof(struct io_uring_recvmsg_out) +
+                                     URING_NAME_SIZE + URING_CONTROL_SIZE;
+        upump_uring->recv.msg.msg_name = &upump_uring->recv.name;
+        upump_uring->recv.msg.msg_namelen = URING_NAME_SIZE;
+        upump_uring->recv.msg.msg_control = upump_uring->recv.control;
+        upump_uring->recv.msg.msg_controllen = URING_CONTROL_SIZE;
+    } else
+        upump_uring->recv.stream = true;
+    upump_uring->recv.size = upump_uring->recv.headroom + size;
+
+    upump_uring->recv.ring_entries = 1;
+    while (upump_uring->recv.ring_entries < nb_buffers)
+        upump_uring->recv.ring_entries *= 2;
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    upump_uring->recv.ring_size =
+        (upump_uring->recv.ring_entries * sizeof(struct io_uring_buf) +
+         page_size - 1) & ~(page_size - 1);
+    void *ring = mmap(NULL, upump_uring->recv.ring_size,
+                      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1, 0);
+    if (unlikely(ring == MAP_FAILED))
+        return false;
+    if (unlikely(!upump_uring_mgr_get_bgid(uring_mgr,
+                                           &upump_uring->recv.bgid))) {
+        munmap(ring, upump_uring->recv.ring_size);
+        return false;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uintptr_t)ring;
+    reg.ring_entries = upump_uring->recv.ring_entries;
+    reg.bgid = upump_uring->recv.bgid;
+    if (unlikely(syscall(__NR_io_uring_register, uring_mgr->fd,
+                         IORING_REGISTER_PBUF_RING, &reg, 1) < 0)) {
+        upump_uring_mgr_put_bgid(uring_mgr, upump_uring->recv.bgid);
+        munmap(ring, upump_uring->recv.ring_size);
+        return false;
+    }
+    upump_uring->recv.ring = ring;
+
+    upump_uring->recv.umems = calloc(nb_buffers, sizeof(struct umem));
+    upump_uring->recv.missing = malloc(nb_buffers * sizeof(uint16_t));
+    if (unlikely(upump_uring->recv.umems == NULL ||
+                 upump_uring->recv.missing == NULL))
+        return false;
+    upump_uring->recv.nb_buffers = nb_buffers;
+    for (unsigned int i = 0; i < nb_buffers; i++)
+        upump_uring->recv.missing[upump_uring->recv.nb_missing++] =
+            nb_buffers - 1 - i;
+    upump_uring_recv_refill(upump_uring);
+    return !upump_uring->recv.nb_missing;
+}
+
+/** @internal @This initializes a send pump.
+ *
+ * @param upump_uring private structure of the pump
+ * @param fd file descriptor to send to
+ * @param depth maximum number of pending requests
+ * @return false in case of failure
+ */
+static bool upump_uring_send_init(struct upump_uring *upump_uring, int fd,
+                                  unsigned int depth)
+{
+    memset(&upump_uring->send, 0, sizeof(upump_uring->send));
+    if (unlikely(!depth))
+        return false;
+    struct stat st;
+    upump_uring->send.socket = fstat(fd, &st) == 0 && S_ISSOCK(st.st_mode);
+    upump_uring->send.depth = depth;
+    upump_uring->send.reqs = calloc(depth,
+                                    sizeof(struct upump_uring_send_req));
+    return upump_uring->send.reqs != NULL;
+}
+
+/** @This allocates a new upump_uring.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_uring_mgr structure
+ * @param event type of event to watch for
+ * @param args optional parameters depending on event type
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static struct upump *upump_uring_alloc(struct upump_mgr *mgr,
+                                       int event, va_list args)
+{
+    struct upump_uring_mgr *uring_mgr = upump_uring_mgr_from_upump_mgr(mgr);
+    struct upump_uring *upump_uring =
+        upool_alloc(&uring_mgr->common_mgr.upump_pool, struct upump_uring *);
+    if (unlikely(upump_uring == NULL))
+        return NULL;
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+    upump_uring->event = event;
+    upump_uring->active = false;
+    upump_uring->inflight = 0;
+    upump_uring->fd = -1;
+    uchain_init(upump_uring_to_uchain(upump_uring));
+
+    switch (event) {
+        case UPUMP_TYPE_IDLER:
+            break;
+        case UPUMP_TYPE_TIMER:
+            upump_uring->timer.after = va_arg(args, uint64_t);
+            upump_uring->timer.repeat = va_arg(args, uint64_t);
+            upump_uring->timer.deadline = 0;
+            break;
+        case UPUMP_TYPE_FD_READ:
+        case UPUMP_TYPE_FD_WRITE:
+            upump_uring->fd = va_arg(args, int);
+            break;
+        case UPUMP_TYPE_SIGNAL: {
+            upump_uring->sig.signal = va_arg(args, int);
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigaddset(&mask, upump_uring->sig.signal);
+            upump_uring->fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+            if (unlikely(upump_uring->fd == -1)) {
+                upool_free(&uring_mgr->common_mgr.upump_pool, upump_uring);
+                return NULL;
+            }
+            break;
+        }
+        case UPUMP_TYPE_FD_RECV: {
+            upump_uring->fd = va_arg(args, int);
+            struct umem_mgr *umem_mgr = va_arg(args, struct umem_mgr *);
+            unsigned int size = va_arg(args, unsigned int);
+            unsigned int nb_buffers = va_arg(args, unsigned int);
+            if (unlikely(!upump_uring_recv_init(upump_uring,
+                                                upump_uring->fd, umem_mgr,
+                                                size, nb_buffers))) {
+                upump_uring_recv_clean(upump_uring);
+                upool_free(&uring_mgr->common_mgr.upump_pool, upump_uring);
+                return NULL;
+            }
+            break;
+        }
+        case UPUMP_TYPE_FD_SEND: {
+            upump_uring->fd = va_arg(args, int);
+            unsigned int depth = va_arg(args, unsigned int);
+            if (unlikely(!upump_uring_send_init(upump_uring, upump_uring->fd,
+                                                depth))) {
+                free(upump_uring->send.reqs);
+                upool_free(&uring_mgr->common_mgr.upump_pool, upump_uring);
+                return NULL;
+            }
+            break;
+        }
+        default:
+            upool_free(&uring_mgr->common_mgr.upump_pool, upump_uring);
+            return NULL;
+    }
+
+    upump_common_init(upump);
+
+    return upump;
+}
+
+/** @This starts a pump.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_uring_real_start(struct upump *upump, bool status)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+    if (upump_uring->active)
+        return;
+    upump_uring->active = true;
+
+    switch (upump_uring->event) {
+        case UPUMP_TYPE_IDLER:
+            ulist_add(&uring_mgr->idlers, upump_uring_to_uchain(upump_uring));
+            break;
+        case UPUMP_TYPE_TIMER:
+            upump_uring->timer.deadline =
+                upump_uring_now() + upump_uring->timer.after;
+            upump_uring_mgr_add_timer(uring_mgr, upump_uring);
+            break;
+        case UPUMP_TYPE_FD_READ:
+            upump_uring_arm_poll(upump_uring, POLLIN);
+            break;
+        case UPUMP_TYPE_FD_WRITE:
+            upump_uring_arm_poll(upump_uring, POLLOUT);
+            break;
+        case UPUMP_TYPE_SIGNAL: {
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigaddset(&mask, upump_uring->sig.signal);
+            sigprocmask(SIG_BLOCK, &mask, NULL);
+            upump_uring_arm_poll(upump_uring, POLLIN);
+            break;
+        }
+        case UPUMP_TYPE_FD_RECV:
+            if (upump_uring->recv.nb_missing < upump_uring->recv.nb_buffers)
+                upump_uring_arm_recv(upump_uring);
+            else
+                ulist_add(&uring_mgr->starving,
+                          upump_uring_to_uchain(upump_uring));
+            break;
+        case UPUMP_TYPE_FD_SEND:
+            upump_uring_arm_send(upump_uring);
+            break;
+        default:
+            break;
+    }
+    if (status)
+        uring_mgr->blocking++;
+}
+
+/** @This stops a pump.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_uring_real_stop(struct upump *upump, bool status)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+    if (!upump_uring->active)
+        return;
+    upump_uring->active = false;
+    if (status)
+        uring_mgr->blocking--;
+
+    switch (upump_uring->event) {
+        case UPUMP_TYPE_IDLER:
+        case UPUMP_TYPE_TIMER:
+            ulist_delete(upump_uring_to_uchain(upump_uring));
+            uchain_init(upump_uring_to_uchain(upump_uring));
+            break;
+        case UPUMP_TYPE_SIGNAL: {
+            upump_uring_cancel(upump_uring);
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigaddset(&mask, upump_uring->sig.signal);
+            sigprocmask(SIG_UNBLOCK, &mask, NULL);
+            break;
+        }
+        case UPUMP_TYPE_FD_RECV:
+            if (ulist_is_in(upump_uring_to_uchain(upump_uring))) {
+                ulist_delete(upump_uring_to_uchain(upump_uring));
+                uchain_init(upump_uring_to_uchain(upump_uring));
+            }
+            upump_uring_cancel(upump_uring);
+            break;
+        default:
+            upump_uring_cancel(upump_uring);
+            break;
+    }
+}
+
+/** @This released the memory space previously used by a pump.
+ * Please note that the pump must be stopped before.
+ *
+ * @param upump description structure of the pump
+ */
+static void upump_uring_free(struct upump *upump)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+    upump_stop(upump);
+    upump_common_clean(upump);
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    switch (upump_uring->event) {
+        case UPUMP_TYPE_SIGNAL:
+            close(upump_uring->fd);
+            break;
+        case UPUMP_TYPE_FD_RECV:
+            upump_uring_recv_clean(upump_uring);
+            break;
+        case UPUMP_TYPE_FD_SEND:
+            free(upump_uring->send.reqs);
+            break;
+        default:
+            break;
+    }
+    upool_free(&uring_mgr->common_mgr.upump_pool, upump_uring);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to upump_uring or NULL in case of allocation error
+ */
+static void *upump_uring_alloc_inner(struct upool *upool)
+{
+    struct upump_common_mgr *common_mgr =
+        upump_common_mgr_from_upump_pool(upool);
+    struct upump_uring *upump_uring = malloc(sizeof(struct upump_uring));
+    if (unlikely(upump_uring == NULL))
+        return NULL;
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+    upump->mgr = upump_common_mgr_to_upump_mgr(common_mgr);
+    return upump_uring;
+}
+
+/** @internal @This frees a upump_uring.
+ *
+ * @param upool pointer to upool
+ * @param upump_uring pointer to a upump_uring structure to free
+ */
+static void upump_uring_free_inner(struct upool *upool, void *upump_uring)
+{
+    free(upump_uring);
+}
+
+/** @internal @This hands over the data received by a recv pump.
+ *
+ * @param upump description structure of the pump
+ * @param recv filled in with the description of the data
+ * @return an error code
+ */
+static int upump_uring_get_recv(struct upump *upump, struct upump_recv *recv)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+    if (unlikely(upump_uring->event != UPUMP_TYPE_FD_RECV))
+        return UBASE_ERR_UNHANDLED;
+    *recv = uring_mgr->recv;
+    uring_mgr->recv.umem.mgr = NULL;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This queues a request to a send pump.
+ *
+ * @param upump description structure of the pump
+ * @param iov array of buffers
+ * @param iovcnt number of items in the array
+ * @param opaque opaque returned on completion
+ * @return an error code
+ */
+static int upump_uring_send(struct upump *upump, const struct iovec *iov,
+                            int iovcnt, void *opaque)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    if (unlikely(upump_uring->event != UPUMP_TYPE_FD_SEND))
+        return UBASE_ERR_UNHANDLED;
+    if (unlikely(upump_uring->send.count >= upump_uring->send.depth))
+        return UBASE_ERR_BUSY;
+
+    struct upump_uring_send_req *req = &upump_uring->send.reqs[
+        (upump_uring->send.head + upump_uring->send.count) %
+        upump_uring->send.depth];
+    memset(&req->msg, 0, sizeof(struct msghdr));
+    req->msg.msg_iov = (struct iovec *)iov;
+    req->msg.msg_iovlen = iovcnt;
+    req->opaque = opaque;
+    upump_uring->send.count++;
+
+    /* a new chain is only started when the previous one is complete */
+    if (upump_uring->active && !upump_uring->send.submitted)
+        upump_uring_arm_send(upump_uring);
+    return UBASE_ERR_NONE;
+}
+
+/** @This processes control commands on a upump_uring.
+ *
+ * @param upump description structure of the pump
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_uring_control(struct upump *upump, int command, va_list args)
+{
+    switch (command) {
+        case UPUMP_START:
+            upump_common_start(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_STOP:
+            upump_common_stop(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_FREE:
+            upump_uring_free(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_GET_STATUS: {
+            int *status_p = va_arg(args, int *);
+            upump_common_get_status(upump, status_p);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_SET_STATUS: {
+            int status = va_arg(args, int);
+            upump_common_set_status(upump, status);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_ALLOC_BLOCKER: {
+            struct upump_blocker **p = va_arg(args, struct upump_blocker **);
+            *p = upump_common_blocker_alloc(upump);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_FREE_BLOCKER: {
+            struct upump_blocker *blocker =
+                va_arg(args, struct upump_blocker *);
+            upump_common_blocker_free(blocker);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_GET_RECV: {
+            struct upump_recv *recv = va_arg(args, struct upump_recv *);
+            return upump_uring_get_recv(upump, recv);
+        }
+        case UPUMP_SEND: {
+            const struct iovec *iov = va_arg(args, const struct iovec *);
+            int iovcnt = va_arg(args, int);
+            void *opaque = va_arg(args, void *);
+            return upump_uring_send(upump, iov, iovcnt, opaque);
+        }
+        case UPUMP_GET_SENT: {
+            void **opaque_p = va_arg(args, void **);
+            ssize_t *result_p = va_arg(args, ssize_t *);
+            struct upump_uring_mgr *uring_mgr =
+                upump_uring_mgr_from_upump_mgr(upump->mgr);
+            if (unlikely(upump_uring_from_upump(upump)->event !=
+                         UPUMP_TYPE_FD_SEND))
+                return UBASE_ERR_UNHANDLED;
+            *opaque_p = uring_mgr->sent_opaque;
+            *result_p = uring_mgr->sent_result;
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This runs an event loop.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param mutex mutual exclusion primitives to access the event loop
+ * @return an error code
+ */
+static int upump_uring_mgr_run(struct upump_mgr *mgr, struct umutex *mutex)
+{
+    struct upump_uring_mgr *uring_mgr = upump_uring_mgr_from_upump_mgr(mgr);
+    int err = UBASE_ERR_NONE;
+
+    if (mutex != NULL)
+        umutex_lock(mutex);
+
+    while (uring_mgr->blocking) {
+        /* with idlers, only poll for completions */
+        uint64_t timeout = 0;
+        if (ulist_empty(&uring_mgr->idlers)) {
+            timeout = UINT64_MAX;
+            struct uchain *uchain = ulist_peek(&uring_mgr->timers);
+            if (uchain != NULL) {
+                uint64_t deadline =
+                    upump_uring_from_uchain(uchain)->timer.deadline;
+                uint64_t now = upump_uring_now();
+                timeout = deadline > now ? deadline - now : 0;
+            }
+            if (!ulist_empty(&uring_mgr->starving) &&
+                timeout > URING_STARVING_DELAY)
+                timeout = URING_STARVING_DELAY;
+        }
+
+        if (mutex != NULL)
+            umutex_unlock(mutex);
+        err = upump_uring_mgr_enter(uring_mgr, true, timeout);
+        if (mutex != NULL)
+            umutex_lock(mutex);
+        if (unlikely(!ubase_check(err)))
+            break;
+
+        upump_uring_mgr_reap(uring_mgr);
+        bool idle = !uring_mgr->nb_events;
+        upump_uring_mgr_dispatch(uring_mgr);
+        upump_uring_mgr_feed_starving(uring_mgr);
+        if (upump_uring_mgr_dispatch_timers(uring_mgr))
+            idle = false;
+        /* like libev, idlers only run when there is nothing else to do */
+        if (idle)
+            upump_uring_mgr_dispatch_idlers(uring_mgr);
+    }
+
+    if (mutex != NULL)
+        umutex_unlock(mutex);
+
+    return err;
+}
+
+/** @This processes control commands on a upump_uring_mgr.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_uring_mgr_control(struct upump_mgr *mgr,
+                                   int command, va_list args)
+{
+    switch (command) {
+        case UPUMP_MGR_RUN: {
+            struct umutex *mutex = va_arg(args, struct umutex *);
+            return upump_uring_mgr_run(mgr, mutex);
+        }
+        case UPUMP_MGR_VACUUM:
+            upump_common_mgr_vacuum(mgr);
+            return UBASE_ERR_NONE;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This unmaps the rings and closes the io_uring instance.
+ *
+ * @param uring_mgr description structure of the manager
+ */
+static void upump_uring_mgr_close(struct upump_uring_mgr *uring_mgr)
+{
+    if (uring_mgr->sqes != NULL)
+        munmap(uring_mgr->sqes, uring_mgr->sqes_size);
+    if (uring_mgr->cq_map != NULL && uring_mgr->cq_map != uring_mgr->sq_map)
+        munmap(uring_mgr->cq_map, uring_mgr->cq_map_size);
+    if (uring_mgr->sq_map != NULL)
+        munmap(uring_mgr->sq_map, uring_mgr->sq_map_size);
+    if (uring_mgr->fd != -1)
+        close(uring_mgr->fd);
+    free(uring_mgr->events);
+}
+
+/** @internal @This creates the io_uring instance and maps its rings.
+ *
+ * @param uring_mgr description structure of the manager
+ * @return false in case of failure
+ */
+static bool upump_uring_mgr_open(struct upump_uring_mgr *uring_mgr)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL |
+                   IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = URING_CQ_ENTRIES;
+    uring_mgr->fd = syscall(__NR_io_uring_setup, URING_SQ_ENTRIES, &params);
+    if (uring_mgr->fd == -1 && errno == EINVAL) {
+        /* optional flags not supported before Linux 5.19 */
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = URING_CQ_ENTRIES;
+        uring_mgr->fd = syscall(__NR_io_uring_setup, URING_SQ_ENTRIES,
+                                &params);
+    }
+    if (unlikely(uring_mgr->fd == -1))
+        return false;
+    if (unlikely(!(params.features & IORING_FEAT_EXT_ARG) ||
+                 !(params.features & IORING_FEAT_NODROP)))
+        return false;
+
+    uring_mgr->sq_map_size = params.sq_off.array +
+                             params.sq_entries * sizeof(unsigned int);
+    uring_mgr->cq_map_size = params.cq_off.cqes +
+                             params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (uring_mgr->cq_map_size > uring_mgr->sq_map_size)
+            uring_mgr->sq_map_size = uring_mgr->cq_map_size;
+    }
+    void *map = mmap(NULL, uring_mgr->sq_map_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, uring_mgr->fd,
+                     IORING_OFF_SQ_RING);
+    if (unlikely(map == MAP_FAILED))
+        return false;
+    uring_mgr->sq_map = map;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        uring_mgr->cq_map = uring_mgr->sq_map;
+    else {
+        map = mmap(NULL, uring_mgr->cq_map_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, uring_mgr->fd,
+                   IORING_OFF_CQ_RING);
+        if (unlikely(map == MAP_FAILED))
+            return false;
+        uring_mgr->cq_map = map;
+    }
+
+    uring_mgr->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    map = mmap(NULL, uring_mgr->sqes_size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, uring_mgr->fd, IORING_OFF_SQES);
+    if (unlikely(map == MAP_FAILED))
+        return false;
+    uring_mgr->sqes = map;
+
+    uint8_t *sq = uring_mgr->sq_map;
+    uring_mgr->sq_head = (unsigned int *)(sq + params.sq_off.head);
+    uring_mgr->sq_tail = (unsigned int *)(sq + params.sq_off.tail);
+    uring_mgr->sq_array = (unsigned int *)(sq + params.sq_off.array);
+    uring_mgr->sq_mask = *(unsigned int *)(sq + params.sq_off.ring_mask);
+    uring_mgr->sq_entries = *(unsigned int *)(sq + params.sq_off.ring_entries);
+    uring_mgr->sq_local_tail = *uring_mgr->sq_tail;
+
+    uint8_t *cq = uring_mgr->cq_map;
+    uring_mgr->cq_head = (unsigned int *)(cq + params.cq_off.head);
+    uring_mgr->cq_tail = (unsigned int *)(cq + params.cq_off.tail);
+    uring_mgr->cq_mask = *(unsigned int *)(cq + params.cq_off.ring_mask);
+    uring_mgr->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    uring_mgr->max_events = params.cq_entries;
+    uring_mgr->events = malloc(uring_mgr->max_events *
+                               sizeof(struct io_uring_cqe));
+    return uring_mgr->events != NULL;
+}
+
+/** @This frees a upump manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upump_uring_mgr_free(struct urefcount *urefcount)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_urefcount(urefcount);
+    upump_common_mgr_clean(upump_uring_mgr_to_upump_mgr(uring_mgr));
+    upump_uring_mgr_close(uring_mgr);
+    free(uring_mgr);
+}
+
+/** @This allocates and initializes a upump_uring_mgr structure.
+ *
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @return pointer to the wrapped upump_mgr structure, or NULL in case of
+ * failure
+ */
+struct upump_mgr *upump_uring_mgr_alloc(uint16_t upump_pool_depth,
+                                        uint16_t upump_blocker_pool_depth)
+{
+    struct upump_uring_mgr *uring_mgr =
+        malloc(sizeof(struct upump_uring_mgr) +
+               upump_common_mgr_sizeof(upump_pool_depth,
+                                       upump_blocker_pool_depth));
+    if (unlikely(uring_mgr == NULL))
+        return NULL;
+
+    uring_mgr->fd = -1;
+    uring_mgr->sq_map = uring_mgr->cq_map = NULL;
+    uring_mgr->sqes = NULL;
+    uring_mgr->events = NULL;
+    uring_mgr->nb_events = uring_mgr->next_event = 0;
+    if (unlikely(!upump_uring_mgr_open(uring_mgr))) {
+        upump_uring_mgr_close(uring_mgr);
+        free(uring_mgr);
+        return NULL;
+    }
+    ulist_init(&uring_mgr->idlers);
+    ulist_init(&uring_mgr->timers);
+    ulist_init(&uring_mgr->starving);
+    uring_mgr->blocking = 0;
+    memset(uring_mgr->bgids, 0, sizeof(uring_mgr->bgids));
+    memset(&uring_mgr->recv, 0, sizeof(uring_mgr->recv));
+    uring_mgr->sent_opaque = NULL;
+    uring_mgr->sent_result = 0;
+
+    struct upump_mgr *mgr = upump_uring_mgr_to_upump_mgr(uring_mgr);
+    mgr->signature = UPUMP_URING_SIGNATURE;
+    urefcount_init(upump_uring_mgr_to_urefcount(uring_mgr),
+                   upump_uring_mgr_free);
+    uring_mgr->common_mgr.mgr.refcount =
+        upump_uring_mgr_to_urefcount(uring_mgr);
+    uring_mgr->common_mgr.mgr.upump_alloc = upump_uring_alloc;
+    uring_mgr->common_mgr.mgr.upump_control = upump_uring_control;
+    uring_mgr->common_mgr.mgr.upump_mgr_control = upump_uring_mgr_control;
+
+    upump_common_mgr_init(mgr, upump_pool_depth, upump_blocker_pool_depth,
+                          uring_mgr->upool_extra,
+                          upump_uring_real_start, upump_uring_real_stop,
+                          upump_uring_alloc_inner, upump_uring_free_inner);
+    return mgr;
+}
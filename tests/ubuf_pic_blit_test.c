@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for ubuf_pic_blit_alpha, checked against a plain C
+ * implementation of the blending rules
+ */
+
+#undef NDEBUG
+
+#include <upipe/ubase.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_pic.h>
+#include <upipe/ubuf_pic_mem.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#define UBUF_POOL_DEPTH     1
+#define UBUF_PREPEND        2
+#define UBUF_APPEND         2
+#define UBUF_ALIGN          16
+#define UBUF_ALIGN_HOFFSET  0
+
+#define SRC_HSIZE           200
+#define SRC_VSIZE           64
+#define DEST_HSIZE          256
+#define DEST_VSIZE          80
+#define MAX_PLANES          3
+
+struct plane {
+    const char *chroma;
+    uint8_t hsub, vsub, macropixel_size;
+    /** depth of 16-bit samples, or 8 */
+    unsigned depth;
+    bool big_endian;
+};
+
+static const struct plane formats[][MAX_PLANES] = {
+    { { "y8", 1, 1, 1, 8, false },
+      { "u8", 2, 2, 1, 8, false },
+      { "v8", 2, 2, 1, 8, false } },
+    { { "y10l", 1, 1, 2, 10, false },
+      { "u10l", 2, 1, 2, 10, false },
+      { "v10l", 2, 1, 2, 10, false } },
+    { { "y10b", 1, 1, 2, 10, true },
+      { "u16l", 2, 2, 2, 16, false },
+      { "v16l", 2, 2, 2, 16, false } },
+};
+
+static const struct {
+    int dest_hoffset, dest_voffset, src_hoffset, src_voffset;
+    int hsize, vsize;
+} areas[] = {
+    { 0, 0, 0, 0, SRC_HSIZE, SRC_VSIZE },
+    { 6, 4, 2, 2, 190, 58 },
+    { 50, 10, 0, 0, 62, 16 },
+};
+
+static const struct {
+    bool alpha_plane;
+    uint8_t alpha, threshold;
+} modes[] = {
+    { true, 0xff, 0xff },
+    { true, 0x80, 0xff },
+    { true, 0xff, 0x64 },
+    { true, 0x4d, 0x0a },
+    { true, 0xc8, 0x00 },
+    { false, 0x80, 0xff },
+    { false, 0xff, 0xff },
+    { false, 0x64, 0x32 },
+    { false, 0x0a, 0x32 },
+};
+
+static uint16_t get16(const uint8_t *p, bool big_endian)
+{
+    return big_endian ? (p[0] << 8) | p[1] : p[0] | (p[1] << 8);
+}
+
+static void set16(uint8_t *p, uint16_t v, bool big_endian)
+{
+    p[big_endian ? 0 : 1] = v >> 8;
+    p[big_endian ? 1 : 0] = v;
+}
+
+static void fill_in(struct ubuf *ubuf, const struct plane *planes)
+{
+    size_t hsize, vsize;
+    ubase_assert(ubuf_pic_size(ubuf, &hsize, &vsize, NULL));
+
+    for (int p = 0; p < MAX_PLANES + 1; p++) {
+        const struct plane alpha = { "a8", 1, 1, 1, 8, false };
+        const struct plane *plane = p < MAX_PLANES ? &planes[p] : &alpha;
+        size_t stride;
+        uint8_t *buffer;
+        if (!ubase_check(ubuf_pic_plane_write(ubuf, plane->chroma,
+                                              0, 0, -1, -1, &buffer)))
+            continue;
+        ubase_assert(ubuf_pic_plane_size(ubuf, plane->chroma, &stride,
+                                         NULL, NULL, NULL));
+        int samples = hsize / plane->hsub;
+        for (int y = 0; y < vsize / plane->vsub; y++) {
+            for (int x = 0; x < samples; x++) {
+                if (plane->depth == 8) {
+                    /* make sure fully opaque and transparent pixels
+                     * are represented */
+                    uint8_t v = rand();
+                    buffer[x] = v < 0x20 ? 0 : v > 0xe0 ? 0xff : v;
+                } else
+                    set16(buffer + 2 * x, rand() & ((1 << plane->depth) - 1),
+                          plane->big_endian);
+            }
+            buffer += stride;
+        }
+        ubase_assert(ubuf_pic_plane_unmap(ubuf, plane->chroma,
+                                          0, 0, -1, -1));
+    }
+}
+
+/* reference implementation, one sample at a time */
+static void blit_plane(uint8_t *dest, size_t dest_stride,
+                       const uint8_t *src, size_t src_stride,
+                       const struct plane *plane, int hsize, int vsize,
+                       const uint8_t *alpha_plane, size_t alpha_stride,
+                       uint8_t alpha, uint8_t threshold)
+{
+    int size = plane->depth == 8 ? 1 : 2;
+    int samples = hsize / plane->hsub;
+
+    for (int y = 0; y < vsize / plane->vsub; y++) {
+        for (int x = 0; x < samples; x++) {
+            unsigned d, s;
+            if (size == 1) {
+                d = dest[x];
+                s = src[x];
+            } else {
+                d = get16(dest + 2 * x, plane->big_endian);
+                s = get16(src + 2 * x, plane->big_endian);
+            }
+
+            unsigned k = alpha;
+            if (alpha_plane != NULL)
+                k = alpha_plane[alpha_stride * y * plane->vsub +
+                                x * plane->hsub] * alpha / 0xff;
+
+            if (threshold == 0 || (alpha_plane == NULL && alpha == 0xff))
+                d = s;
+            else if (alpha_plane == NULL || threshold == 0xff)
+                d = (d * (0xff - k) + s * k) / 0xff;
+            else if (k > threshold)
+                d = s;
+
+            if (size == 1)
+                dest[x] = d;
+            else
+                set16(dest + 2 * x, d, plane->big_endian);
+        }
+        dest += dest_stride;
+        src += src_stride;
+    }
+}
+
+static void check(struct ubuf_mgr *dest_mgr, struct ubuf_mgr *src_mgr,
+                  const struct plane *planes, int area, int mode)
+{
+    struct ubuf *dest = ubuf_pic_alloc(dest_mgr, DEST_HSIZE, DEST_VSIZE);
+    struct ubuf *src = ubuf_pic_alloc(src_mgr, SRC_HSIZE, SRC_VSIZE);
+    assert(dest != NULL);
+    assert(src != NULL);
+    fill_in(dest, planes);
+    fill_in(src, planes);
+
+    const uint8_t *alpha_plane = NULL;
+    size_t alpha_stride = 0;
+    if (modes[mode].alpha_plane) {
+        ubase_assert(ubuf_pic_plane_read(src, "a8", 0, 0, -1, -1,
+                                         &alpha_plane));
+        ubase_assert(ubuf_pic_plane_size(src, "a8", &alpha_stride,
+                                         NULL, NULL, NULL));
+    }
+
+    /* compute the expected result on a copy of the destination */
+    uint8_t *expected[MAX_PLANES];
+    size_t dest_stride[MAX_PLANES];
+    for (int p = 0; p < MAX_PLANES; p++) {
+        const struct plane *plane = &planes[p];
+        const uint8_t *r;
+        ubase_assert(ubuf_pic_plane_size(dest, plane->chroma,
+                                         &dest_stride[p], NULL, NULL, NULL));
+        ubase_assert(ubuf_pic_plane_read(dest, plane->chroma, 0, 0, -1, -1,
+                                         &r));
+        size_t size = dest_stride[p] * DEST_VSIZE / plane->vsub;
+        expected[p] = malloc(size);
+        assert(expected[p] != NULL);
+        memcpy(expected[p], r, size);
+        ubase_assert(ubuf_pic_plane_unmap(dest, plane->chroma,
+                                          0, 0, -1, -1));
+
+        size_t src_stride;
+        ubase_assert(ubuf_pic_plane_size(src, plane->chroma, &src_stride,
+                                         NULL, NULL, NULL));
+        ubase_assert(ubuf_pic_plane_read(src, plane->chroma,
+                                         areas[area].src_hoffset,
+                                         areas[area].src_voffset,
+                                         areas[area].hsize,
+                                         areas[area].vsize, &r));
+        if (modes[mode].alpha_plane ||
+            modes[mode].alpha >= modes[mode].threshold)
+            blit_plane(expected[p] +
+                    dest_stride[p] * areas[area].dest_voffset / plane->vsub +
+                    areas[area].dest_hoffset / plane->hsub *
+                    plane->macropixel_size,
+                    dest_stride[p], r, src_stride, plane,
+                    areas[area].hsize, areas[area].vsize,
+                    alpha_plane, alpha_stride,
+                    modes[mode].alpha, modes[mode].threshold);
+        ubase_assert(ubuf_pic_plane_unmap(src, plane->chroma,
+                                          areas[area].src_hoffset,
+                                          areas[area].src_voffset,
+                                          areas[area].hsize,
+                                          areas[area].vsize));
+    }
+
+    ubase_assert(ubuf_pic_blit_alpha(dest, src,
+                                     areas[area].dest_hoffset,
+                                     areas[area].dest_voffset,
+                                     areas[area].src_hoffset,
+                                     areas[area].src_voffset,
+                                     areas[area].hsize, areas[area].vsize,
+                                     alpha_plane, alpha_stride,
+                                     modes[mode].alpha,
+                                     modes[mode].threshold));
+    if (alpha_plane != NULL)
+        ubase_assert(ubuf_pic_plane_unmap(src, "a8", 0, 0, -1, -1));
+
+    for (int p = 0; p < MAX_PLANES; p++) {
+        const struct plane *plane = &planes[p];
+        const uint8_t *r;
+        ubase_assert(ubuf_pic_plane_read(dest, plane->chroma, 0, 0, -1, -1,
+                                         &r));
+        size_t octets = DEST_HSIZE / plane->hsub * plane->macropixel_size;
+        for (int y = 0; y < DEST_VSIZE / plane->vsub; y++)
+            if (memcmp(r + y * dest_stride[p],
+                       expected[p] + y * dest_stride[p], octets)) {
+                fprintf(stderr, "mismatch: plane %s line %d area %d "
+                        "mode %d\n", plane->chroma, y, area, mode);
+                abort();
+            }
+        ubase_assert(ubuf_pic_plane_unmap(dest, plane->chroma,
+                                          0, 0, -1, -1));
+        free(expected[p]);
+    }
+
+    ubuf_free(dest);
+    ubuf_free(src);
+}
+
+int main(int argc, char **argv)
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+
+    for (int f = 0; f < UBASE_ARRAY_SIZE(formats); f++) {
+        const struct plane *planes = formats[f];
+        struct ubuf_mgr *dest_mgr =
+            ubuf_pic_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                   umem_mgr, 1,
+                                   UBUF_PREPEND, UBUF_APPEND,
+                                   UBUF_PREPEND, UBUF_APPEND,
+                                   UBUF_ALIGN, UBUF_ALIGN_HOFFSET);
+        struct ubuf_mgr *src_mgr =
+            ubuf_pic_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                   umem_mgr, 1,
+                                   UBUF_PREPEND, UBUF_APPEND,
+                                   UBUF_PREPEND, UBUF_APPEND,
+                                   UBUF_ALIGN, UBUF_ALIGN_HOFFSET);
+        assert(dest_mgr != NULL);
+        assert(src_mgr != NULL);
+        for (int p = 0; p < MAX_PLANES; p++) {
+            ubase_assert(ubuf_pic_mem_mgr_add_plane(dest_mgr,
+                        planes[p].chroma, planes[p].hsub, planes[p].vsub,
+                        planes[p].macropixel_size));
+            ubase_assert(ubuf_pic_mem_mgr_add_plane(src_mgr,
+                        planes[p].chroma, planes[p].hsub, planes[p].vsub,
+                        planes[p].macropixel_size));
+        }
+        ubase_assert(ubuf_pic_mem_mgr_add_plane(src_mgr, "a8", 1, 1, 1));
+
+        for (int area = 0; area < UBASE_ARRAY_SIZE(areas); area++)
+            for (int mode = 0; mode < UBASE_ARRAY_SIZE(modes); mode++)
+                check(dest_mgr, src_mgr, planes, area, mode);
+
+        ubuf_mgr_release(dest_mgr);
+        ubuf_mgr_release(src_mgr);
+    }
+
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
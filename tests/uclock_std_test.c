@@ -49,6 +49,14 @@ int main(int argc, char **argv)
     now_cal = uclock_now(uclock_cal);
     assert(now);
     assert(now_cal);
+
+    struct uclock *uclock_raw = uclock_std_alloc(UCLOCK_FLAG_MONOTONIC_RAW);
+    assert(uclock_raw);
+    uint64_t now_raw = uclock_now(uclock_raw);
+    assert(now_raw);
+    assert(uclock_now(uclock_raw) >= now_raw);
+    uclock_release(uclock_raw);
+
     printf("Now: %"PRIu64"\n", now);
     printf("Cal: %"PRIu64"\n", now_cal);
     assert(uclock_to_real(uclock_cal, (uint64_t)TIME_SAMPLE * UCLOCK_FREQ) ==
@@ -47,15 +47,21 @@
 
 #define SALUTATION "Hello everyone, this is just some padding to make the structure bigger, if you don't mind."
 
-int main(int argc, char **argv)
+#define NB_NAMED 100
+
+/** umem manager recording the size of the last allocation */
+static struct umem_mgr *size_umem_mgr;
+static size_t last_size = 0;
+
+static bool size_umem_alloc(struct umem_mgr *mgr, struct umem *umem,
+                            size_t size)
 {
-    struct uprobe *uprobe = uprobe_stdio_alloc(NULL, stdout, UPROBE_LOG_DEBUG);
-    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
-    assert(umem_mgr != NULL);
-    struct udict_mgr *mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH, umem_mgr,
-                                                   -1, -1);
-    assert(mgr != NULL);
+    last_size = size;
+    return umem_alloc(size_umem_mgr, umem, size);
+}
 
+static void test_udict(struct udict_mgr *mgr, struct uprobe *uprobe)
+{
     struct udict *udict1 = udict_alloc(mgr, 0);
     assert(udict1 != NULL);
 
@@ -131,8 +137,158 @@ int main(int argc, char **argv)
     udict_free(udict2);
 
     udict_free(udict1);
+}
+
+static void test_many(struct udict_mgr *mgr)
+{
+    struct udict *udict1 = udict_alloc(mgr, 0);
+    assert(udict1 != NULL);
+    char name[16];
+    uint64_t u;
+    int64_t d;
+    int i;
+
+    for (i = 0; i < NB_NAMED; i++) {
+        snprintf(name, sizeof(name), "x.attr%d", i);
+        ubase_assert(udict_set_unsigned(udict1, i, UDICT_TYPE_UNSIGNED, name));
+    }
+    ubase_assert(udict_set_string(udict1, "pouet", UDICT_TYPE_FLOW_DEF, NULL));
+    ubase_assert(udict_set_unsigned(udict1, 42, UDICT_TYPE_CLOCK_DURATION,
+                                    NULL));
+
+    /* remove every other attribute */
+    for (i = 0; i < NB_NAMED; i += 2) {
+        snprintf(name, sizeof(name), "x.attr%d", i);
+        ubase_assert(udict_delete(udict1, UDICT_TYPE_UNSIGNED, name));
+    }
+
+    struct udict *udict2 = udict_dup(udict1);
+    assert(udict2 != NULL);
+    for (i = 0; i < NB_NAMED; i++) {
+        snprintf(name, sizeof(name), "x.attr%d", i);
+        if (i % 2) {
+            ubase_assert(udict_get_unsigned(udict2, &u, UDICT_TYPE_UNSIGNED,
+                                            name));
+            assert(u == i);
+        } else
+            ubase_nassert(udict_get_unsigned(udict2, &u, UDICT_TYPE_UNSIGNED,
+                                             name));
+        /* same name, different type */
+        ubase_nassert(udict_get_int(udict2, &d, UDICT_TYPE_INT, name));
+    }
+    const char *string;
+    ubase_assert(udict_get_string(udict2, &string, UDICT_TYPE_FLOW_DEF, NULL));
+    assert(!strcmp(string, "pouet"));
+    ubase_assert(udict_get_unsigned(udict2, &u, UDICT_TYPE_CLOCK_DURATION,
+                                    NULL));
+    assert(u == 42);
+    ubase_nassert(udict_get_unsigned(udict2, &u, UDICT_TYPE_CLOCK_LATENCY,
+                                     NULL));
+
+    udict_free(udict2);
+    udict_free(udict1);
+}
+
+static void test_shared(struct udict_mgr *mgr)
+{
+    struct udict *udict1 = udict_alloc(mgr, 0);
+    assert(udict1 != NULL);
+    ubase_assert(udict_set_string(udict1, "pouet", UDICT_TYPE_FLOW_DEF, NULL));
+    ubase_assert(udict_set_unsigned(udict1, 42, UDICT_TYPE_UNSIGNED, "x.u"));
+
+    struct udict *udict2 = udict_dup_shared(udict1);
+    assert(udict2 != NULL);
+    struct udict *udict3 = udict_dup_shared(udict2);
+    assert(udict3 != NULL);
+
+    /* writes only affect the modified udict */
+    uint64_t u;
+    ubase_assert(udict_set_unsigned(udict2, 43, UDICT_TYPE_UNSIGNED, "x.u"));
+    ubase_assert(udict_delete(udict3, UDICT_TYPE_FLOW_DEF, NULL));
+    ubase_assert(udict_get_unsigned(udict1, &u, UDICT_TYPE_UNSIGNED, "x.u"));
+    assert(u == 42);
+    ubase_assert(udict_get_unsigned(udict2, &u, UDICT_TYPE_UNSIGNED, "x.u"));
+    assert(u == 43);
+    ubase_assert(udict_get_unsigned(udict3, &u, UDICT_TYPE_UNSIGNED, "x.u"));
+    assert(u == 42);
+    const char *string;
+    ubase_assert(udict_get_string(udict1, &string, UDICT_TYPE_FLOW_DEF, NULL));
+    assert(!strcmp(string, "pouet"));
+    ubase_nassert(udict_get_string(udict3, &string, UDICT_TYPE_FLOW_DEF,
+                                   NULL));
+
+    /* the shared attributes outlive the udict that created them */
+    struct udict *udict4 = udict_dup_shared(udict1);
+    assert(udict4 != NULL);
+    udict_free(udict1);
+    ubase_assert(udict_get_string(udict4, &string, UDICT_TYPE_FLOW_DEF, NULL));
+    assert(!strcmp(string, "pouet"));
+    ubase_assert(udict_set_string(udict4, SALUTATION, UDICT_TYPE_STRING,
+                                  "x.salutation"));
+    ubase_assert(udict_get_string(udict4, &string, UDICT_TYPE_STRING,
+                                  "x.salutation"));
+    assert(!strcmp(string, SALUTATION));
+
+    udict_free(udict4);
+    udict_free(udict3);
+    udict_free(udict2);
+}
+
+static void test_size(struct umem_mgr *umem_mgr)
+{
+    struct umem_mgr mgr = {
+        .refcount = NULL,
+        .umem_alloc = size_umem_alloc,
+        .umem_realloc = NULL,
+        .umem_free = NULL,
+        .umem_mgr_vacuum = NULL
+    };
+    size_umem_mgr = umem_mgr;
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         &mgr, -1, -1);
+    assert(udict_mgr != NULL);
+
+    /* the default udict fits in the 128 octets pool */
+    struct udict *udict1 = udict_alloc(udict_mgr, 0);
+    assert(udict1 != NULL);
+    assert(last_size == 128);
+
+    /* sharing does not allocate attribute space */
+    last_size = 0;
+    struct udict *udict2 = udict_dup_shared(udict1);
+    assert(udict2 != NULL);
+    assert(last_size == 0);
+    ubase_assert(udict_set_unsigned(udict2, 42, UDICT_TYPE_UNSIGNED, "x.u"));
+    assert(last_size == 128);
+
+    udict_free(udict2);
+    udict_free(udict1);
+    udict_mgr_release(udict_mgr);
+}
+
+int main(int argc, char **argv)
+{
+    struct uprobe *uprobe = uprobe_stdio_alloc(NULL, stdout, UPROBE_LOG_DEBUG);
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+
+    struct udict_mgr *mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH, umem_mgr,
+                                                   -1, -1);
+    assert(mgr != NULL);
+    test_udict(mgr, uprobe);
+    test_many(mgr);
+    test_shared(mgr);
     udict_mgr_release(mgr);
 
+    mgr = udict_inline_mgr_alloc_indexed(UDICT_POOL_DEPTH, umem_mgr, -1, -1);
+    assert(mgr != NULL);
+    test_udict(mgr, uprobe);
+    test_many(mgr);
+    test_shared(mgr);
+    udict_mgr_release(mgr);
+
+    test_size(umem_mgr);
+
     umem_mgr_release(umem_mgr);
     uprobe_release(uprobe);
     return 0;
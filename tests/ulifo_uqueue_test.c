@@ -52,6 +52,7 @@
 #define UPUMP_POOL 1
 #define UPUMP_BLOCKER_POOL 1
 #define NB_LOOPS 1000
+#define POP_BATCH 3
 
 struct elem {
     struct uchain uchain;
@@ -74,7 +75,8 @@ static struct ulifo ulifo;
 static struct uqueue uqueue;
 struct elem elems[ULIFO_MAX_DEPTH];
 static unsigned int nb_loops = NB_LOOPS;
-static unsigned int loop[2] = {0, 0};
+static unsigned int next_loop[2] = {0, 0};
+static bool spsc = false;
 
 static void push_ready(struct upump *upump)
 {
@@ -136,18 +138,30 @@ static void *push_thread(void *_thread)
     return NULL;
 }
 
+static void pop_elem(struct uchain *uchain)
+{
+    struct elem *elem = container_of(uchain, struct elem, uchain);
+    assert(elem->loop == next_loop[elem->thread]);
+    next_loop[elem->thread] = elem->loop + 1;
+    if (likely(elem->timeout.tv_nsec))
+        assert(!nanosleep(&elem->timeout, NULL));
+    ulifo_push(&ulifo, uchain);
+}
+
 static void pop(struct upump *upump)
 {
-    struct uchain *uchain = uqueue_pop(&uqueue, struct uchain *);
-    if (likely(uchain != NULL)) {
-        struct elem *elem = container_of(uchain, struct elem, uchain);
-        assert(elem->loop == loop[elem->thread]);
-        loop[elem->thread] = elem->loop + 1;
-        if (likely(elem->timeout.tv_nsec))
-            assert(!nanosleep(&elem->timeout, NULL));
-        ulifo_push(&ulifo, uchain);
+    if (spsc) {
+        void *elements[POP_BATCH];
+        unsigned int nb = uqueue_pop_batch(&uqueue, elements, POP_BATCH);
+        assert(nb <= POP_BATCH);
+        for (unsigned int i = 0; i < nb; i++)
+            pop_elem(elements[i]);
+    } else {
+        struct uchain *uchain = uqueue_pop(&uqueue, struct uchain *);
+        if (likely(uchain != NULL))
+            pop_elem(uchain);
     }
-    if (unlikely(uatomic_load(&refcount) == 1))
+    if (unlikely(uatomic_load(&refcount) == 1 && !uqueue_length(&uqueue)))
         upump_stop(upump);
 }
 
@@ -176,6 +190,7 @@ int main(int argc, char **argv)
         ulifo_push(&ulifo, &elems[i].uchain);
     }
 
+    /* two producers on a multi-producer queue */
     assert(uqueue_init(&uqueue, UQUEUE_MAX_DEPTH, uqueue_buffer));
     struct upump *upump = uqueue_upump_alloc_pop(&uqueue, upump_mgr, pop, NULL,
                                                  NULL);
@@ -193,16 +208,37 @@ int main(int argc, char **argv)
     ev_loop(loop, 0);
 
     upump_free(upump);
+    assert(!pthread_join(threads[0].id, NULL));
+    assert(!pthread_join(threads[1].id, NULL));
+    assert(next_loop[0] == nb_loops);
+    assert(next_loop[1] == nb_loops);
+    assert(!uqueue_length(&uqueue));
+    uqueue_clean(&uqueue);
+
+    /* one producer on a single-producer single-consumer queue */
+    spsc = true;
+    next_loop[0] = 0;
+    assert(uqueue_init_spsc(&uqueue, UQUEUE_MAX_DEPTH, uqueue_buffer));
+    upump = uqueue_upump_alloc_pop(&uqueue, upump_mgr, pop, NULL, NULL);
+    assert(upump != NULL);
+
+    uatomic_fetch_add(&refcount, 1);
+    assert(pthread_create(&threads[0].id, NULL, push_thread, &threads[0]) == 0);
+
+    upump_start(upump);
+    ev_loop(loop, 0);
+
+    upump_free(upump);
+    assert(!pthread_join(threads[0].id, NULL));
+    assert(next_loop[0] == nb_loops);
+    assert(!uqueue_length(&uqueue));
+    uqueue_clean(&uqueue);
+
     upump_mgr_release(upump_mgr);
     ev_default_destroy();
 
     ulifo_clean(&ulifo);
-    uqueue_clean(&uqueue);
-
     uatomic_clean(&refcount);
 
-    assert(!pthread_join(threads[0].id, NULL));
-    assert(!pthread_join(threads[1].id, NULL));
-
     return 0;
 }
@@ -36,6 +36,26 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+
+#define MAGAZINE_SIZE 4
+#define NB_UMEMS 32
+
+static struct umem_mgr *cached_mgr;
+
+static void *thread(void *unused)
+{
+    struct umem umems[NB_UMEMS];
+    for (int i = 0; i < NB_UMEMS; i++)
+        assert(umem_alloc(cached_mgr, &umems[i], 32));
+    for (int i = 0; i < NB_UMEMS; i++)
+        umem_free(&umems[i]);
+    for (int i = 0; i < NB_UMEMS; i++)
+        assert(umem_alloc(cached_mgr, &umems[i], 32));
+    for (int i = 0; i < NB_UMEMS; i++)
+        umem_free(&umems[i]);
+    return NULL;
+}
 
 int main(int argc, char **argv)
 {
@@ -87,6 +107,35 @@ int main(int argc, char **argv)
     umem_free(&umem);
     printf("Passed 6\n");
 
+    struct umem_pool_stats stats;
+    ubase_nassert(umem_pool_mgr_get_stats(mgr, 0, &stats));
     umem_mgr_release(mgr);
+
+    cached_mgr = umem_pool_mgr_alloc_cached(32, MAGAZINE_SIZE, 2,
+                                            NB_UMEMS, NB_UMEMS);
+    assert(cached_mgr != NULL);
+    assert(umem_alloc(cached_mgr, &umem, 32));
+    p = umem_buffer(&umem);
+    umem_free(&umem);
+    assert(umem_alloc(cached_mgr, &umem, 32));
+    assert(umem_buffer(&umem) == p);
+    umem_free(&umem);
+    ubase_assert(umem_pool_mgr_get_stats(cached_mgr, 0, &stats));
+    assert(stats.misses == 1);
+    assert(stats.cache_hits == 1);
+    ubase_nassert(umem_pool_mgr_get_stats(cached_mgr, 2, &stats));
+    printf("Passed 7\n");
+
+    pthread_t id;
+    assert(pthread_create(&id, NULL, thread, NULL) == 0);
+    assert(pthread_join(id, NULL) == 0);
+    ubase_assert(umem_pool_mgr_get_stats(cached_mgr, 0, &stats));
+    assert(stats.cache_hits + stats.pool_hits + stats.misses ==
+           2 + 2 * NB_UMEMS);
+    assert(stats.misses == 1 + NB_UMEMS);
+    assert(stats.overflows == 0);
+    printf("Passed 8\n");
+
+    umem_mgr_release(cached_mgr);
     return 0;
 }
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for aes decryption pipe
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_ubuf_mem.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/uref.h>
+#include <upipe/uref_std.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_aes_decrypt.h>
+#include <upipe-modules/uref_aes_flow.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH    5
+#define UREF_POOL_DEPTH     5
+#define UBUF_POOL_DEPTH     5
+#define UPROBE_LOG_LEVEL    UPROBE_LOG_DEBUG
+#define LONG_SIZE           4096
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static struct uprobe *logger;
+
+/** output buffer of the test pipe */
+static uint8_t *output;
+/** number of octets received by the test pipe */
+static size_t output_size;
+
+/* FIPS-197 appendix C.1 */
+static const uint8_t fips_key[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t fips_iv[16] = { 0 };
+static const uint8_t fips_cipher[16] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+    0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+static const uint8_t fips_plain[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+    0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+
+/* NIST SP 800-38A F.2.2 CBC-AES128.Decrypt */
+static const uint8_t nist_key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const uint8_t nist_iv[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t nist_cipher[64] = {
+    0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46,
+    0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+    0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee,
+    0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+    0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b,
+    0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+    0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09,
+    0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7
+};
+static const uint8_t nist_plain[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+    0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+    0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+    0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+    0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+        default:
+            assert(0);
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr,
+                                struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(size % 16 == 0);
+    ubase_assert(uref_block_extract(uref, 0, size, output + output_size));
+    output_size += size;
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, request);
+        }
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** @This decrypts a buffer through an aes decryption pipe, feeding it in
+ * chunks of the given size.
+ *
+ * @param key AES-128 key
+ * @param iv initialization vector
+ * @param in encrypted buffer
+ * @param size size of the buffer
+ * @param chunk size of the input urefs
+ * @param out filled in with the decrypted buffer
+ */
+static void decrypt(const uint8_t *key, const uint8_t *iv,
+                    const uint8_t *in, size_t size, size_t chunk,
+                    uint8_t *out)
+{
+    struct upipe_mgr *upipe_aes_decrypt_mgr = upipe_aes_decrypt_mgr_alloc();
+    assert(upipe_aes_decrypt_mgr != NULL);
+    struct upipe *upipe_aes_decrypt = upipe_void_alloc(upipe_aes_decrypt_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "aes"));
+    assert(upipe_aes_decrypt != NULL);
+
+    struct upipe *upipe_sink = upipe_void_alloc(&test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "sink"));
+    assert(upipe_sink != NULL);
+    ubase_assert(upipe_set_output(upipe_aes_decrypt, upipe_sink));
+
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, "aes.");
+    assert(flow_def != NULL);
+    ubase_assert(uref_aes_set_method(flow_def, "AES-128"));
+    ubase_assert(uref_aes_set_key(flow_def, key, 16));
+    ubase_assert(uref_aes_set_iv(flow_def, iv, 16));
+    ubase_assert(upipe_set_flow_def(upipe_aes_decrypt, flow_def));
+    uref_free(flow_def);
+
+    output = out;
+    output_size = 0;
+    for (size_t offset = 0; offset < size; offset += chunk) {
+        size_t uref_size = size - offset < chunk ? size - offset : chunk;
+        struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, uref_size);
+        assert(uref != NULL);
+        int wsize = -1;
+        uint8_t *wbuf;
+        ubase_assert(uref_block_write(uref, 0, &wsize, &wbuf));
+        assert(wsize == uref_size);
+        memcpy(wbuf, in + offset, uref_size);
+        ubase_assert(uref_block_unmap(uref, 0));
+        upipe_input(upipe_aes_decrypt, uref, NULL);
+    }
+    assert(output_size == size);
+
+    upipe_release(upipe_aes_decrypt);
+    test_free(upipe_sink);
+    upipe_mgr_release(upipe_aes_decrypt_mgr); // nop
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    logger = uprobe_stdio_alloc(&uprobe, stdout, UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+
+    /* known answer tests */
+    uint8_t buffer[LONG_SIZE];
+    decrypt(fips_key, fips_iv, fips_cipher, sizeof (fips_cipher),
+            sizeof (fips_cipher), buffer);
+    assert(!memcmp(buffer, fips_plain, sizeof (fips_plain)));
+
+    static const size_t chunks[] = { 64, 16, 5, 1, 23 };
+    for (int i = 0; i < sizeof (chunks) / sizeof (chunks[0]); i++) {
+        memset(buffer, 0, sizeof (nist_plain));
+        decrypt(nist_key, nist_iv, nist_cipher, sizeof (nist_cipher),
+                chunks[i], buffer);
+        assert(!memcmp(buffer, nist_plain, sizeof (nist_plain)));
+    }
+
+    /* the output must not depend on the segmentation of the input */
+    uint8_t cipher[LONG_SIZE];
+    for (int i = 0; i < LONG_SIZE; i++)
+        cipher[i] = rand();
+    uint8_t reference[LONG_SIZE];
+    decrypt(nist_key, nist_iv, cipher, LONG_SIZE, LONG_SIZE, reference);
+    static const size_t long_chunks[] = { 16, 17, 100, 1000, 1337 };
+    for (int i = 0; i < sizeof (long_chunks) / sizeof (long_chunks[0]); i++) {
+        decrypt(nist_key, nist_iv, cipher, LONG_SIZE, long_chunks[i], buffer);
+        assert(!memcmp(buffer, reference, LONG_SIZE));
+    }
+
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+    ubuf_mgr_release(ubuf_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
@@ -70,9 +70,11 @@
 #define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
 
 static void usage(const char *argv0) {
-    fprintf(stdout, "Usage: %s [-d <delay>] [-a|-o] <source file> <sink file>\n", argv0);
+    fprintf(stdout, "Usage: %s [-d <delay>] [-m <window>] [-a|-o] "
+                    "<source file> <sink file>\n", argv0);
     fprintf(stdout, "-a : append\n");
     fprintf(stdout, "-o : overwrite\n");
+    fprintf(stdout, "-m : map windows of the source file\n");
     exit(EXIT_FAILURE);
 }
 
@@ -97,13 +99,17 @@ int main(int argc, char *argv[])
 {
     const char *src_file, *sink_file;
     int64_t delay = 0;
+    uint64_t window = 0;
     enum upipe_fsink_mode mode = UPIPE_FSINK_CREATE;
     int opt;
-    while ((opt = getopt(argc, argv, "d:ao")) != -1) {
+    while ((opt = getopt(argc, argv, "d:m:ao")) != -1) {
         switch (opt) {
             case 'd':
                 delay = atoi(optarg);
                 break;
+            case 'm':
+                window = atoi(optarg);
+                break;
             case 'a':
                 mode = UPIPE_FSINK_APPEND;
                 break;
@@ -156,6 +162,12 @@ int main(int argc, char *argv[])
                              UPROBE_LOG_LEVEL, "file source"));
     assert(upipe_fsrc != NULL);
     ubase_assert(upipe_set_output_size(upipe_fsrc, READ_SIZE));
+    if (window) {
+        ubase_assert(upipe_fsrc_set_mmap(upipe_fsrc, window));
+        uint64_t window_size;
+        ubase_assert(upipe_fsrc_get_mmap(upipe_fsrc, &window_size));
+        assert(window_size >= window);
+    }
     ubase_assert(upipe_set_uri(upipe_fsrc, src_file));
     uint64_t size;
     if (ubase_check(upipe_src_get_size(upipe_fsrc, &size)))
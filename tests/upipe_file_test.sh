@@ -10,3 +10,7 @@ trap cleanup EXIT
 
 "$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_file_test Makefile "$TMP"/test
 cmp --quiet "$TMP"/test Makefile
+
+# map windows smaller than the file
+"$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_file_test -m 65536 -o Makefile "$TMP"/test
+cmp --quiet "$TMP"/test Makefile
@@ -81,6 +81,133 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** last picture received by the test pipe */
+static struct uref *output = NULL;
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    uref_free(output);
+    output = uref;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/* checks the merged lines of a plane of 8 or 16-bit samples */
+static void check_merge(struct upipe_mgr *blend_mgr, struct uprobe *logger,
+                        struct umem_mgr *umem_mgr, const char *chroma,
+                        uint8_t size)
+{
+    struct ubuf_mgr *mgr =
+        ubuf_pic_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH, umem_mgr, 1,
+                               UBUF_PREPEND, UBUF_APPEND,
+                               UBUF_PREPEND, UBUF_APPEND,
+                               UBUF_ALIGN, UBUF_ALIGN_HOFFSET);
+    assert(mgr != NULL);
+    ubase_assert(ubuf_pic_mem_mgr_add_plane(mgr, chroma, 1, 1, size));
+
+    struct uref *flow_def = uref_pic_flow_alloc_def(uref_mgr, 1);
+    assert(flow_def != NULL);
+    ubase_assert(uref_pic_flow_add_plane(flow_def, 1, 1, size, chroma));
+    struct upipe *sink = upipe_void_alloc(&test_mgr, uprobe_use(logger));
+    assert(sink != NULL);
+    struct upipe *blend = upipe_void_alloc(blend_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "blend"));
+    assert(blend != NULL);
+    ubase_assert(upipe_set_flow_def(blend, flow_def));
+    ubase_assert(upipe_set_output(blend, sink));
+    uref_free(flow_def);
+
+    /* odd width to exercise the tails of the vector loops */
+    const int width = WIDTH - 3, height = 16;
+    struct uref *pic = uref_pic_alloc(uref_mgr, mgr, width, height);
+    assert(pic != NULL);
+    uint8_t *w;
+    size_t stride;
+    ubase_assert(uref_pic_plane_size(pic, chroma, &stride, NULL, NULL, NULL));
+    ubase_assert(uref_pic_plane_write(pic, chroma, 0, 0, -1, -1, &w));
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++) {
+            if (size == 1)
+                w[y * stride + x] = rand();
+            else
+                ((uint16_t *)(w + y * stride))[x] = rand() & 0x3ff;
+        }
+    ubase_assert(uref_pic_plane_unmap(pic, chroma, 0, 0, -1, -1));
+    upipe_input(blend, uref_dup(pic), NULL);
+    assert(output != NULL);
+
+    const uint8_t *in, *out;
+    size_t out_stride;
+    ubase_assert(uref_pic_plane_size(output, chroma, &out_stride,
+                                     NULL, NULL, NULL));
+    ubase_assert(uref_pic_plane_read(pic, chroma, 0, 0, -1, -1, &in));
+    ubase_assert(uref_pic_plane_read(output, chroma, 0, 0, -1, -1, &out));
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++) {
+            int prev = y ? y - 1 : 0;
+            if (size == 1)
+                assert(out[y * out_stride + x] ==
+                       ((in[prev * stride + x] + in[y * stride + x]) >> 1));
+            else
+                assert(((const uint16_t *)(out + y * out_stride))[x] ==
+                       ((((const uint16_t *)(in + prev * stride))[x] +
+                         ((const uint16_t *)(in + y * stride))[x]) >> 1));
+        }
+    ubase_assert(uref_pic_plane_unmap(pic, chroma, 0, 0, -1, -1));
+    ubase_assert(uref_pic_plane_unmap(output, chroma, 0, 0, -1, -1));
+
+    uref_free(pic);
+    uref_free(output);
+    output = NULL;
+    upipe_release(blend);
+    test_free(sink);
+    ubuf_mgr_release(mgr);
+}
+
 int main(int argc, char **argv)
 {
     printf("Compiled %s %s (%s)\n", __DATE__, __TIME__, __FILE__);
@@ -156,6 +283,10 @@ int main(int argc, char **argv)
     // Clean - release
     upipe_release(filter_blend);
 
+    // Check the merged values
+    check_merge(blend_mgr, logger, umem_mgr, "y8", 1);
+    check_merge(blend_mgr, logger, umem_mgr, "y10l", 2);
+
     upipe_mgr_release(blend_mgr); // noop
     upipe_mgr_release(null_mgr); // noop
     ubuf_mgr_release(ubuf_mgr);
@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for the yadif deinterlace filter
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_ubuf_mem.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_pic.h>
+#include <upipe/ubuf_pic_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/uref_pic.h>
+#include <upipe/uref_std.h>
+#include <upipe/upipe.h>
+#include <upipe-filters/upipe_filter_yadif.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH    5
+#define UREF_POOL_DEPTH     5
+#define UBUF_POOL_DEPTH     5
+#define UBUF_PREPEND        0
+#define UBUF_APPEND         0
+#define UBUF_ALIGN          32
+#define UBUF_ALIGN_HOFFSET  0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+
+#define WIDTH               96
+#define HEIGHT              64
+#define NB_FRAMES           6
+#define NB_PLANES           3
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static struct uref *outputs[NB_FRAMES];
+static unsigned int nb_outputs = 0;
+
+static const struct {
+    const char *chroma;
+    uint8_t hsub, vsub, macropixel_size;
+} planes8[NB_PLANES] = {
+    { "y8", 1, 1, 1 }, { "u8", 2, 2, 1 }, { "v8", 2, 2, 1 },
+}, planes10[NB_PLANES] = {
+    { "y10l", 1, 1, 2 }, { "u10l", 2, 1, 2 }, { "v10l", 2, 1, 2 },
+};
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    assert(nb_outputs < NB_FRAMES);
+    outputs[nb_outputs++] = uref;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            ubase_assert(uref_flow_match_def(flow_def, "pic."));
+            ubase_assert(uref_pic_get_progressive(flow_def));
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/* fills in a picture with a pattern, moving if motion is true */
+static struct uref *make_pic(int frame, bool wide, bool motion)
+{
+    struct uref *pic = uref_pic_alloc(uref_mgr, ubuf_mgr, WIDTH, HEIGHT);
+    assert(pic != NULL);
+    for (int p = 0; p < NB_PLANES; p++) {
+        const char *chroma = wide ? planes10[p].chroma : planes8[p].chroma;
+        uint8_t hsub, vsub;
+        size_t stride;
+        uint8_t *buf;
+        ubase_assert(uref_pic_plane_size(pic, chroma, &stride, &hsub, &vsub,
+                                         NULL));
+        ubase_assert(uref_pic_plane_write(pic, chroma, 0, 0, -1, -1, &buf));
+        for (int y = 0; y < HEIGHT / vsub; y++) {
+            for (int x = 0; x < WIDTH / hsub; x++) {
+                /* vertical gradient, so that the spatial prediction of
+                 * the missing lines of a static picture is exact */
+                int v = x + y * 2;
+                if (motion)
+                    v = rand() % 256;
+                if (wide)
+                    ((uint16_t *)buf)[x] = v * 4 + (y & 3);
+                else
+                    buf[x] = v;
+            }
+            buf += stride;
+        }
+        ubase_assert(uref_pic_plane_unmap(pic, chroma, 0, 0, -1, -1));
+    }
+    if (frame % 2)
+        uref_pic_set_tff(pic);
+    return pic;
+}
+
+/* compares the lines of two pictures, of the given parity or all if -1 */
+static bool compare(struct uref *uref1, struct uref *uref2, bool wide,
+                    int parity)
+{
+    bool ret = true;
+    for (int p = 0; p < NB_PLANES; p++) {
+        const char *chroma = wide ? planes10[p].chroma : planes8[p].chroma;
+        uint8_t hsub, vsub, macropixel_size;
+        size_t stride1, stride2;
+        const uint8_t *r1, *r2;
+        ubase_assert(uref_pic_plane_size(uref1, chroma, &stride1, &hsub,
+                                         &vsub, &macropixel_size));
+        ubase_assert(uref_pic_plane_size(uref2, chroma, &stride2, NULL,
+                                         NULL, NULL));
+        ubase_assert(uref_pic_plane_read(uref1, chroma, 0, 0, -1, -1, &r1));
+        ubase_assert(uref_pic_plane_read(uref2, chroma, 0, 0, -1, -1, &r2));
+        for (int y = 0; y < HEIGHT / vsub; y++)
+            if ((parity == -1 || (y & 1) == parity) &&
+                memcmp(r1 + y * stride1, r2 + y * stride2,
+                       WIDTH / hsub * macropixel_size))
+                ret = false;
+        ubase_assert(uref_pic_plane_unmap(uref1, chroma, 0, 0, -1, -1));
+        ubase_assert(uref_pic_plane_unmap(uref2, chroma, 0, 0, -1, -1));
+    }
+    return ret;
+}
+
+/* runs a sequence of pictures through a yadif pipe */
+static void run(struct upipe_mgr *yadif_mgr, struct uprobe *logger,
+                struct upipe *sink, bool wide, unsigned int threads,
+                struct uref **inputs)
+{
+    struct uref *flow_def = uref_pic_flow_alloc_def(uref_mgr, 1);
+    assert(flow_def != NULL);
+    for (int p = 0; p < NB_PLANES; p++) {
+        if (wide)
+            ubase_assert(uref_pic_flow_add_plane(flow_def,
+                        planes10[p].hsub, planes10[p].vsub,
+                        planes10[p].macropixel_size, planes10[p].chroma));
+        else
+            ubase_assert(uref_pic_flow_add_plane(flow_def,
+                        planes8[p].hsub, planes8[p].vsub,
+                        planes8[p].macropixel_size, planes8[p].chroma));
+    }
+
+    struct upipe *yadif = upipe_void_alloc(yadif_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "yadif"));
+    assert(yadif != NULL);
+    ubase_assert(upipe_filter_yadif_set_threads(yadif, threads));
+    unsigned int n;
+    ubase_assert(upipe_filter_yadif_get_threads(yadif, &n));
+    assert(n == threads);
+    ubase_assert(upipe_set_flow_def(yadif, flow_def));
+    ubase_assert(upipe_set_output(yadif, sink));
+    uref_free(flow_def);
+
+    nb_outputs = 0;
+    for (int i = 0; i < NB_FRAMES; i++) {
+        upipe_input(yadif, uref_dup(inputs[i]), NULL);
+        /* one picture of delay */
+        assert(nb_outputs == i);
+    }
+    upipe_release(yadif);
+    assert(nb_outputs == NB_FRAMES);
+}
+
+static void free_outputs(void)
+{
+    for (int i = 0; i < nb_outputs; i++)
+        uref_free(outputs[i]);
+    nb_outputs = 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+
+    struct upipe *sink = upipe_void_alloc(&test_mgr, uprobe_use(logger));
+    assert(sink != NULL);
+    struct upipe_mgr *yadif_mgr = upipe_filter_yadif_mgr_alloc();
+    assert(yadif_mgr != NULL);
+
+    for (int w = 0; w < 2; w++) {
+        bool wide = w;
+        ubuf_mgr = ubuf_pic_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                          umem_mgr, 1,
+                                          UBUF_PREPEND, UBUF_APPEND,
+                                          UBUF_PREPEND, UBUF_APPEND,
+                                          UBUF_ALIGN, UBUF_ALIGN_HOFFSET);
+        assert(ubuf_mgr != NULL);
+        for (int p = 0; p < NB_PLANES; p++) {
+            if (wide)
+                ubase_assert(ubuf_pic_mem_mgr_add_plane(ubuf_mgr,
+                            planes10[p].chroma, planes10[p].hsub,
+                            planes10[p].vsub, planes10[p].macropixel_size));
+            else
+                ubase_assert(ubuf_pic_mem_mgr_add_plane(ubuf_mgr,
+                            planes8[p].chroma, planes8[p].hsub,
+                            planes8[p].vsub, planes8[p].macropixel_size));
+        }
+
+        struct uref *inputs[NB_FRAMES];
+
+        /* static pictures are reconstructed exactly */
+        for (int i = 0; i < NB_FRAMES; i++)
+            inputs[i] = make_pic(i, wide, false);
+        run(yadif_mgr, logger, sink, wide, 1, inputs);
+        for (int i = 0; i < NB_FRAMES; i++) {
+            ubase_assert(uref_pic_get_progressive(outputs[i]));
+            assert(!ubase_check(uref_pic_get_tff(outputs[i])));
+            assert(compare(outputs[i], inputs[i], wide, -1));
+        }
+        free_outputs();
+        for (int i = 0; i < NB_FRAMES; i++)
+            uref_free(inputs[i]);
+
+        /* moving pictures: the first field is kept, and the result does not
+         * depend on the number of threads */
+        for (int i = 0; i < NB_FRAMES; i++)
+            inputs[i] = make_pic(i, wide, true);
+        run(yadif_mgr, logger, sink, wide, 1, inputs);
+        struct uref *single[NB_FRAMES];
+        for (int i = 0; i < NB_FRAMES; i++) {
+            single[i] = outputs[i];
+            int kept = ubase_check(uref_pic_get_tff(inputs[i])) ? 0 : 1;
+            assert(compare(single[i], inputs[i], wide, kept));
+            assert(!compare(single[i], inputs[i], wide, -1));
+        }
+        nb_outputs = 0;
+        run(yadif_mgr, logger, sink, wide, 4, inputs);
+        for (int i = 0; i < NB_FRAMES; i++) {
+            assert(compare(outputs[i], single[i], wide, -1));
+            uref_free(single[i]);
+        }
+        free_outputs();
+
+        /* progressive pictures are passed through */
+        for (int i = 0; i < NB_FRAMES; i++)
+            ubase_assert(uref_pic_set_progressive(inputs[i]));
+        run(yadif_mgr, logger, sink, wide, 2, inputs);
+        for (int i = 0; i < NB_FRAMES; i++)
+            assert(compare(outputs[i], inputs[i], wide, -1));
+        free_outputs();
+        for (int i = 0; i < NB_FRAMES; i++)
+            uref_free(inputs[i]);
+
+        ubuf_mgr_release(ubuf_mgr);
+    }
+
+    test_free(sink);
+    upipe_mgr_release(yadif_mgr); // noop
+    uref_mgr_release(uref_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for the start code scanners of the framers
+ */
+
+#undef NDEBUG
+
+#include <upipe-framers/upipe_framers_common.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#define BUFFER_SIZE 65536
+#define NB_ROUNDS 200
+#define MAX_CHUNK 300
+
+typedef const uint8_t *(*scan_func)(const uint8_t *restrict,
+                                    const uint8_t *, uint32_t *restrict);
+
+static uint8_t buffer[BUFFER_SIZE];
+static size_t chunks[BUFFER_SIZE];
+static size_t nb_chunks;
+
+/* fills the buffer with data having more or less frequent start codes */
+static void fill_buffer(int density)
+{
+    for (int i = 0; i < BUFFER_SIZE; i++) {
+        int r = rand() % 1000;
+        if (r < density)
+            buffer[i] = 0;
+        else if (r < density + density / 2)
+            buffer[i] = 1;
+        else
+            buffer[i] = rand() % 256;
+    }
+}
+
+/* splits the buffer into chunks, like ubuf block segments */
+static void split_buffer(void)
+{
+    size_t offset = 0;
+    nb_chunks = 0;
+    while (offset < BUFFER_SIZE) {
+        size_t size = 1 + rand() % MAX_CHUNK;
+        if (rand() % 10 == 0)
+            size = 1 + rand() % 4;
+        if (size > BUFFER_SIZE - offset)
+            size = BUFFER_SIZE - offset;
+        chunks[nb_chunks++] = size;
+        offset += size;
+    }
+}
+
+/* scans the buffer like the framers do, and compares with the reference */
+static void compare(scan_func ref, scan_func func)
+{
+    uint32_t ref_state = 0xffffffff, state = 0xffffffff;
+    const uint8_t *p = buffer;
+    unsigned int nb_found = 0;
+
+    for (size_t i = 0; i < nb_chunks; i++) {
+        const uint8_t *end = p + chunks[i];
+        while (p < end) {
+            const uint8_t *ref_p = ref(p, end, &ref_state);
+            p = func(p, end, &state);
+            assert(p == ref_p);
+            assert(state == ref_state);
+            if ((state & 0xffffff00) == 0x100)
+                nb_found++;
+        }
+    }
+    assert(p == buffer + BUFFER_SIZE);
+}
+
+static void test(const char *name, scan_func func)
+{
+    printf("testing %s\n", name);
+    for (int i = 0; i < NB_ROUNDS; i++) {
+        fill_buffer(i % 2 ? 1 : 300);
+        split_buffer();
+        compare(upipe_framers_mpeg_scan_c, func);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    srand(42);
+
+    /* start code split over buffers */
+    static const uint8_t split[] = { 0x12, 0, 0, 1, 0xb3, 0x34 };
+    for (int i = 1; i < sizeof(split); i++) {
+        uint32_t state = 0xffffffff;
+        const uint8_t *p = upipe_framers_mpeg_scan(split, split + i, &state);
+        if ((state & 0xffffff00) != 0x100)
+            p = upipe_framers_mpeg_scan(p, split + sizeof(split), &state);
+        assert(p == split + 5);
+        assert(state == 0x000001b3);
+    }
+
+    test("default", upipe_framers_mpeg_scan);
+#if defined(__i386__) || defined(__x86_64__)
+    if (__builtin_cpu_supports("sse2"))
+        test("sse2", upipe_framers_mpeg_scan_sse2);
+    if (__builtin_cpu_supports("avx2"))
+        test("avx2", upipe_framers_mpeg_scan_avx2);
+#endif
+#if defined(__aarch64__)
+    test("neon", upipe_framers_mpeg_scan_neon);
+#endif
+    return 0;
+}
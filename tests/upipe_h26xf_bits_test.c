@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for the NAL unit bit reader of the h26x framers
+ */
+
+#undef NDEBUG
+
+#include <upipe/ubase.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/ubuf_block_stream.h>
+#include <upipe-framers/upipe_h26x_common.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#define UBUF_POOL_DEPTH 1
+#define NB_ROUNDS 500
+#define MAX_SIZE 1000
+#define MAX_SEGMENT 100
+
+typedef size_t (*unescape_func)(uint8_t *restrict, const uint8_t *restrict,
+                                size_t, uint8_t *restrict);
+
+static uint8_t buffer[MAX_SIZE];
+static size_t size;
+
+/* fills the buffer with data having frequent escape words */
+static void fill_buffer(void)
+{
+    size = 1 + rand() % MAX_SIZE;
+    for (size_t i = 0; i < size; i++) {
+        int r = rand() % 10;
+        buffer[i] = r < 4 ? 0 : r < 6 ? 3 : rand() % 256;
+    }
+}
+
+/* removes escape words with the octet stream helper */
+static size_t unescape_ref(uint8_t *dst)
+{
+    struct upipe_h26xf_stream f;
+    upipe_h26xf_stream_init(&f);
+    ubuf_block_stream_init_from_opaque(&f.s, buffer, size);
+    size_t n = 0;
+    while (ubase_check(upipe_h26xf_stream_get(&f.s, &dst[n])))
+        n++;
+    ubuf_block_stream_clean(&f.s);
+    return n;
+}
+
+/* unescapes the buffer in segments, and compares with the reference */
+static void compare_unescape(unescape_func func)
+{
+    uint8_t ref[MAX_SIZE], dst[MAX_SIZE];
+    size_t ref_size = unescape_ref(ref);
+
+    size_t dst_size = 0;
+    uint8_t zeros = 0;
+    for (size_t i = 0; i < size; ) {
+        size_t segment = 1 + rand() % MAX_SEGMENT;
+        if (segment > size - i)
+            segment = size - i;
+        dst_size += func(dst + dst_size, buffer + i, segment, &zeros);
+        i += segment;
+    }
+    assert(dst_size == ref_size);
+    assert(!memcmp(dst, ref, ref_size));
+}
+
+/* builds a ubuf made of several segments */
+static struct ubuf *build_ubuf(struct ubuf_mgr *mgr)
+{
+    struct ubuf *ubuf = NULL;
+    for (size_t i = 0; i < size; ) {
+        size_t segment = 1 + rand() % MAX_SEGMENT;
+        if (segment > size - i)
+            segment = size - i;
+        struct ubuf *append = ubuf_block_alloc(mgr, segment);
+        assert(append != NULL);
+        int s = -1;
+        uint8_t *w;
+        ubase_assert(ubuf_block_write(append, 0, &s, &w));
+        memcpy(w, buffer + i, segment);
+        ubase_assert(ubuf_block_unmap(append, 0));
+        if (ubuf == NULL)
+            ubuf = append;
+        else
+            ubase_assert(ubuf_block_append(ubuf, append));
+        i += segment;
+    }
+    return ubuf;
+}
+
+/* reads the ubuf with the octet stream and the bit reader */
+static void compare_bits(struct ubuf *ubuf, size_t unescaped_size)
+{
+    struct upipe_h26xf_stream f;
+    upipe_h26xf_stream_init(&f);
+    struct ubuf_block_stream *s = &f.s;
+    ubase_assert(ubuf_block_stream_init(s, ubuf, 0));
+    struct upipe_h26xf_bits b;
+    ubase_assert(upipe_h26xf_bits_init(&b, ubuf, 0));
+
+    /* stay away from the end, where invalid codes are handled differently */
+    size_t position = 0;
+    while (position + 64 <= unescaped_size * 8) {
+        /* the octet stream cannot always fill more than 25 bits */
+        unsigned int nb = 1 + rand() % 24;
+        switch (rand() % 4) {
+            case 0: {
+                upipe_h26xf_stream_fill_bits(s, nb);
+                uint32_t v = ubuf_block_stream_show_bits(s, nb);
+                ubuf_block_stream_skip_bits(s, nb);
+                assert(upipe_h26xf_bits_read(&b, nb) == v);
+                position += nb;
+                break;
+            }
+            case 1:
+                upipe_h26xf_stream_fill_bits(s, nb);
+                assert(upipe_h26xf_bits_show(&b, nb) ==
+                       ubuf_block_stream_show_bits(s, nb));
+                break;
+            case 2:
+            case 3:
+                if (!upipe_h26xf_bits_show(&b, 32)) {
+                    upipe_h26xf_stream_fill_bits(s, 8);
+                    ubuf_block_stream_skip_bits(s, 8);
+                    upipe_h26xf_bits_skip(&b, 8);
+                    position += 8;
+                    break;
+                }
+                uint32_t lz = __builtin_clz(upipe_h26xf_bits_show(&b, 32));
+                if (rand() % 2)
+                    assert(upipe_h26xf_bits_ue(&b) ==
+                           upipe_h26xf_stream_ue(s));
+                else
+                    assert(upipe_h26xf_bits_se(&b) ==
+                           upipe_h26xf_stream_se(s));
+                position += 2 * lz + 1;
+                break;
+        }
+    }
+
+    /* past the end, zeros are returned */
+    while (position < unescaped_size * 8 + 64) {
+        upipe_h26xf_bits_skip(&b, 32);
+        position += 32;
+    }
+    assert(upipe_h26xf_bits_read(&b, 32) == 0);
+
+    ubase_assert(ubuf_block_stream_clean(s));
+    ubase_assert(upipe_h26xf_bits_clean(&b));
+}
+
+int main(int argc, char **argv)
+{
+    srand(42);
+
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct ubuf_mgr *mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH,
+                                                    UBUF_POOL_DEPTH, umem_mgr,
+                                                    0, 0, -1, 0);
+    assert(mgr != NULL);
+
+    /* escape words split over buffers */
+    static const uint8_t escaped[] = { 0x12, 0, 0, 3, 1, 0, 0, 3, 3, 0, 0 };
+    static const uint8_t unescaped[] = { 0x12, 0, 0, 1, 0, 0, 3, 0, 0 };
+    for (int i = 0; i <= sizeof(escaped); i++) {
+        uint8_t dst[sizeof(escaped)];
+        uint8_t zeros = 0;
+        size_t n = upipe_h26xf_unescape(dst, escaped, i, &zeros);
+        n += upipe_h26xf_unescape(dst + n, escaped + i,
+                                  sizeof(escaped) - i, &zeros);
+        assert(n == sizeof(unescaped));
+        assert(!memcmp(dst, unescaped, n));
+    }
+
+    for (int i = 0; i < NB_ROUNDS; i++) {
+        fill_buffer();
+        compare_unescape(upipe_h26xf_unescape);
+        compare_unescape(upipe_h26xf_unescape_c);
+#if defined(__i386__) || defined(__x86_64__)
+        if (__builtin_cpu_supports("sse2"))
+            compare_unescape(upipe_h26xf_unescape_sse2);
+#endif
+#if defined(__aarch64__)
+        compare_unescape(upipe_h26xf_unescape_neon);
+#endif
+
+        uint8_t dst[MAX_SIZE];
+        size_t unescaped_size = unescape_ref(dst);
+        struct ubuf *ubuf = build_ubuf(mgr);
+        compare_bits(ubuf, unescaped_size);
+        ubuf_free(ubuf);
+    }
+
+    ubuf_mgr_release(mgr);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
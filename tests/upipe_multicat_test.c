@@ -85,6 +85,8 @@ static struct upump *idler;
 static uint64_t rotate = 0;
 static uint64_t rotate_offset = 0;
 static uint64_t gen_systime = 0;
+static uint64_t read_systime = 0;
+static unsigned int nb_read = 0;
 
 static void sig_handler(int sig)
 {
@@ -155,7 +157,7 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     upipe_dbg(upipe, "===> received input uref");
     uref_dump(uref, upipe->uprobe);
 
-    static uint64_t systime = 0;
+    uint64_t systime = read_systime;
     uint64_t cr_sys;
     uref_clock_get_cr_sys(uref, &cr_sys);
     assert(cr_sys == systime);
@@ -168,7 +170,8 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     assert(cr_sys == systime);
     ubase_assert(uref_block_unmap(uref, 0));
     uref_free(uref);
-    systime += rotate/UREF_PER_SLICE;
+    read_systime += rotate/UREF_PER_SLICE;
+    nb_read++;
 }
 
 /** helper phony pipe */
@@ -289,6 +292,7 @@ int main(int argc, char *argv[])
     }
     ubase_assert(upipe_multicat_sink_set_mode(multicat_sink, UPIPE_FSINK_OVERWRITE));
     ubase_assert(upipe_multicat_sink_set_path(multicat_sink, dirpath, suffix));
+    ubase_assert(upipe_fsink_set_prealloc(multicat_sink, 4096));
 
     // idler - packet generator
     idler = upump_alloc_idler(upump_mgr, genpacket_idler, NULL, NULL);
@@ -319,6 +323,8 @@ int main(int argc, char *argv[])
             assert(val == systime);
             systime += rotate/UREF_PER_SLICE;
         }
+        /* preallocated space is not part of the file */
+        assert(lseek(fd, 0, SEEK_END) == UREF_PER_SLICE * sizeof(uint64_t));
         printf("Ok.\n");
         close(fd);
     }
@@ -337,6 +343,7 @@ int main(int argc, char *argv[])
     ubase_assert(uref_msrc_flow_set_aux(flow, suffix));
     ubase_assert(uref_msrc_flow_set_rotate(flow, rotate));
     ubase_assert(uref_msrc_flow_set_offset(flow, rotate_offset));
+    ubase_assert(uref_msrc_flow_set_batch(flow, 3));
     ubase_assert(upipe_set_flow_def(msrc, flow));
     uref_free(flow);
     ubase_assert(upipe_set_output_size(msrc, sizeof(uint64_t)));
@@ -346,8 +353,10 @@ int main(int argc, char *argv[])
     ubase_assert(upipe_set_output(msrc, test));
 
     // fire !
-    ubase_assert(upipe_src_set_position(msrc, 0));
+    read_systime = rotate_offset;
+    ubase_assert(upipe_src_set_position(msrc, rotate_offset));
     upump_mgr_run(upump_mgr, NULL);
+    assert(nb_read == SLICES_NUM * UREF_PER_SLICE);
 
     // release everything
     upipe_release(msrc);
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for pacer pipe
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_uclock.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/uclock.h>
+#include <upipe/uclock_std.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_std.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_pacer.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define NB_PACKETS 10
+#define LATENCY (UCLOCK_FREQ / 1000)
+
+static struct uclock *uclock;
+static unsigned int nb_packets = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    assert(uref != NULL);
+    uint64_t cr_sys;
+    ubase_assert(uref_clock_get_cr_sys(uref, &cr_sys));
+    assert(uclock_now(uclock) >= cr_sys + LATENCY);
+    uref_free(uref);
+    nb_packets++;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, request);
+        }
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+    uclock = uclock_std_alloc(UCLOCK_FLAG_MONOTONIC_RAW);
+    assert(uclock != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *uprobe_stdio = uprobe_stdio_alloc(&uprobe, stdout,
+                                                     UPROBE_LOG_LEVEL);
+    assert(uprobe_stdio != NULL);
+    struct uprobe *uprobe_main = uprobe_uclock_alloc(uprobe_stdio, uclock);
+    assert(uprobe_main != NULL);
+
+    struct upipe *upipe_sink = upipe_void_alloc(&test_mgr,
+                                                uprobe_use(uprobe_main));
+    assert(upipe_sink != NULL);
+
+    struct uref *uref;
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    ubase_assert(uref_flow_set_def(uref, "block.mpegts."));
+    ubase_assert(uref_clock_set_latency(uref, LATENCY));
+
+    struct upipe_mgr *upipe_pacer_mgr = upipe_pacer_mgr_alloc();
+    assert(upipe_pacer_mgr != NULL);
+    struct upipe *upipe_pacer = upipe_void_alloc(upipe_pacer_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_main), UPROBE_LOG_LEVEL,
+                             "pacer"));
+    assert(upipe_pacer != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_pacer, uref));
+    ubase_assert(upipe_set_output(upipe_pacer, upipe_sink));
+    ubase_assert(upipe_attach_uclock(upipe_pacer));
+    uref_free(uref);
+
+    uint64_t spin;
+    ubase_assert(upipe_pacer_get_spin(upipe_pacer, &spin));
+    ubase_assert(upipe_pacer_set_spin(upipe_pacer, UCLOCK_FREQ / 2000));
+
+    uint64_t now = uclock_now(uclock);
+    for (unsigned int i = 0; i < NB_PACKETS; i++) {
+        uref = uref_alloc(uref_mgr);
+        assert(uref != NULL);
+        uref_clock_set_cr_sys(uref, now + i * UCLOCK_FREQ / 1000);
+        upipe_input(upipe_pacer, uref, NULL);
+    }
+    assert(nb_packets == NB_PACKETS);
+
+    struct upipe_pacer_stats stats;
+    ubase_assert(upipe_pacer_get_stats(upipe_pacer, &stats));
+    assert(stats.packets == NB_PACKETS);
+    uint32_t total = 0;
+    for (unsigned int i = 0; i < UPIPE_PACER_HISTOGRAM_SIZE; i++) {
+        printf("jitter bin %u: %"PRIu32"\n", i, stats.histogram[i]);
+        total += stats.histogram[i];
+    }
+    assert(total == NB_PACKETS);
+    printf("late: %"PRIu32", max jitter: %"PRIu32" us\n", stats.late,
+           stats.max_jitter / (UCLOCK_FREQ / 1000000));
+
+    /* late buffer */
+    ubase_assert(upipe_pacer_reset_stats(upipe_pacer));
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_clock_set_cr_sys(uref, uclock_now(uclock) - UCLOCK_FREQ);
+    upipe_input(upipe_pacer, uref, NULL);
+    assert(nb_packets == NB_PACKETS + 1);
+    ubase_assert(upipe_pacer_get_stats(upipe_pacer, &stats));
+    assert(stats.packets == 1);
+    assert(stats.late == 1);
+    assert(stats.histogram[UPIPE_PACER_HISTOGRAM_SIZE - 1] == 1);
+
+    upipe_release(upipe_pacer);
+    upipe_mgr_release(upipe_pacer_mgr); // nop
+
+    test_free(upipe_sink);
+
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uclock_release(uclock);
+    uprobe_release(uprobe_main);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for rtp reorder pipe
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_upump_mgr.h>
+#include <upipe/uprobe_uclock.h>
+#include <upipe/uclock.h>
+#include <upipe/uclock_std.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_std.h>
+#include <upipe/upump.h>
+#include <upump-ev/upump_ev.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_rtp_reorder.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#include <bitstream/ietf/rtp.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define BASE_SEQNUM 65500
+#define NB_PACKETS 100
+#define GAP 5
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static struct uclock *uclock;
+static struct upipe *rtpr;
+static struct upipe *inputs[2];
+static uint16_t next_seqnum = BASE_SEQNUM;
+static unsigned int nb_packets = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+            break;
+        default:
+            assert(0);
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr,
+                                struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    uint8_t buffer[RTP_HEADER_SIZE];
+    const uint8_t *rtp = uref_block_peek(uref, 0, RTP_HEADER_SIZE, buffer);
+    assert(rtp != NULL);
+    uint16_t seqnum = rtp_get_seqnum(rtp);
+    ubase_assert(uref_block_peek_unmap(uref, 0, buffer, rtp));
+    upipe_dbg_va(upipe, "received seqnum %"PRIu16, seqnum);
+    assert(seqnum == next_seqnum);
+    if (nb_packets == NB_PACKETS - 1)
+        next_seqnum += GAP + 1;
+    else
+        next_seqnum++;
+    nb_packets++;
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, request);
+        }
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** sends an RTP packet to the given input of the rtpr pipe */
+static void send_packet(struct upipe *input, unsigned int seqnum)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr,
+                                         RTP_HEADER_SIZE);
+    assert(uref != NULL);
+    uint8_t *buffer;
+    int size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == RTP_HEADER_SIZE);
+    rtp_set_hdr(buffer);
+    rtp_set_seqnum(buffer, seqnum);
+    ubase_assert(uref_block_unmap(uref, 0));
+    uref_clock_set_cr_sys(uref, uclock_now(uclock));
+    upipe_input(input, uref, NULL);
+}
+
+/** checks the statistics once all packets have been output */
+static void test_timer(struct upump *upump)
+{
+    struct upipe_rtpr_stats stats;
+    ubase_assert(upipe_rtpr_get_stats(rtpr, &stats));
+    assert(stats.lost == GAP);
+    assert(stats.duplicates == 2 * NB_PACKETS - 3 - NB_PACKETS);
+    assert(stats.late == 0);
+    assert(stats.reordered == 1);
+    assert(stats.max_reorder == NB_PACKETS - 1 - 50);
+    assert(stats.overflows == 0);
+    assert(nb_packets == NB_PACKETS + 1);
+
+    /* a packet older than the last output one is late */
+    send_packet(inputs[0], BASE_SEQNUM + 3);
+    ubase_assert(upipe_rtpr_get_stats(rtpr, &stats));
+    assert(stats.late == 1);
+
+    ubase_assert(upipe_rtpr_reset_stats(rtpr));
+    ubase_assert(upipe_rtpr_get_stats(rtpr, &stats));
+    assert(stats.late == 0);
+
+    upipe_release(inputs[0]);
+    upipe_release(inputs[1]);
+    upipe_release(rtpr);
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
+            UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    uclock = uclock_std_alloc(0);
+    assert(uclock != NULL);
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+    logger = uprobe_uclock_alloc(logger, uclock);
+    assert(logger != NULL);
+
+    struct upipe_mgr *upipe_rtpr_mgr = upipe_rtpr_mgr_alloc();
+    assert(upipe_rtpr_mgr != NULL);
+    rtpr = upipe_void_alloc(upipe_rtpr_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "rtpr"));
+    assert(rtpr != NULL);
+    upipe_mgr_release(upipe_rtpr_mgr); // nop
+    ubase_assert(upipe_attach_uclock(rtpr));
+    ubase_assert(upipe_rtpr_set_delay(rtpr, 0));
+
+    unsigned int window;
+    ubase_assert(upipe_rtpr_get_window(rtpr, &window));
+    assert(window == UPIPE_RTPR_DEFAULT_WINDOW);
+    ubase_nassert(upipe_rtpr_set_window(rtpr, 1000));
+    ubase_assert(upipe_rtpr_set_window(rtpr, 1024));
+    ubase_assert(upipe_rtpr_get_window(rtpr, &window));
+    assert(window == 1024);
+
+    struct upipe *sink = upipe_void_alloc(&test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "sink"));
+    assert(sink != NULL);
+    ubase_assert(upipe_set_output(rtpr, sink));
+
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, "rtp.");
+    assert(flow_def != NULL);
+    for (int i = 0; i < 2; i++) {
+        inputs[i] = upipe_void_alloc_sub(rtpr,
+                uprobe_pfx_alloc_va(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                                    "input %d", i));
+        assert(inputs[i] != NULL);
+        ubase_assert(upipe_set_flow_def(inputs[i], flow_def));
+    }
+    uref_free(flow_def);
+
+    /* two paths missing different packets, wrapping around 65535 */
+    for (int i = 0; i < NB_PACKETS; i++)
+        if (i != 50)
+            send_packet(inputs[0], BASE_SEQNUM + i);
+    for (int i = 0; i < NB_PACKETS; i++)
+        if (i != 10 && i != 11)
+            send_packet(inputs[1], BASE_SEQNUM + i);
+    send_packet(inputs[0], BASE_SEQNUM + NB_PACKETS + GAP);
+
+    struct upump *upump = upump_alloc_timer(upump_mgr, test_timer, NULL,
+                                            NULL, UCLOCK_FREQ / 10, 0);
+    assert(upump != NULL);
+    upump_start(upump);
+
+    upump_mgr_run(upump_mgr, NULL);
+
+    assert(nb_packets == NB_PACKETS + 1);
+
+    upump_free(upump);
+    test_free(sink);
+    upump_mgr_release(upump_mgr);
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uclock_release(uclock);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for sws ladder pipes
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_ubuf_mem.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/uref.h>
+#include <upipe/uref_std.h>
+#include <upipe/uref_pic.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/ubuf_pic_mem.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe-swscale/upipe_sws_ladder.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH    0
+#define UREF_POOL_DEPTH     0
+#define UBUF_POOL_DEPTH     0
+#define UPROBE_LOG_LEVEL    UPROBE_LOG_VERBOSE
+#define SRCSIZE             64
+#define NB_RENDITIONS       3
+
+/** sizes of the renditions, not in decreasing order */
+static const size_t sizes[NB_RENDITIONS] = { 16, 48, 32 };
+/** values of the planes of the source picture */
+static const uint8_t values[3] = { 0x40, 0x80, 0xc0 };
+static const char *chromas[3] = { "y8", "u8", "v8" };
+static int counter[NB_RENDITIONS];
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+        case UPROBE_SOURCE_END:
+        case UPROBE_LOG:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+struct ladder_test {
+    unsigned int id;
+    struct upipe upipe;
+};
+
+/** helper phony pipe */
+UPIPE_HELPER_UPIPE(ladder_test, upipe, 0);
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct ladder_test *ladder_test = malloc(sizeof(struct ladder_test));
+    assert(ladder_test != NULL);
+    ladder_test->id = 0;
+    upipe_init(&ladder_test->upipe, mgr, uprobe);
+    return &ladder_test->upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    struct ladder_test *ladder_test = ladder_test_from_upipe(upipe);
+    unsigned int id = ladder_test->id;
+    assert(uref != NULL);
+
+    size_t hsize, vsize;
+    ubase_assert(uref_pic_size(uref, &hsize, &vsize, NULL));
+    assert(hsize == sizes[id]);
+    assert(vsize == sizes[id]);
+
+    for (int i = 0; i < 3; i++) {
+        const uint8_t *r;
+        size_t stride;
+        uint8_t hsub, vsub;
+        ubase_assert(uref_pic_plane_read(uref, chromas[i], 0, 0, -1, -1, &r));
+        ubase_assert(uref_pic_plane_size(uref, chromas[i], &stride,
+                                         &hsub, &vsub, NULL));
+        for (int y = 0; y < vsize / vsub; y++)
+            for (int x = 0; x < hsize / hsub; x++)
+                assert(abs(r[y * stride + x] - values[i]) <= 1);
+        ubase_assert(uref_pic_plane_unmap(uref, chromas[i], 0, 0, -1, -1));
+    }
+    counter[id]++;
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    struct ladder_test *ladder_test = ladder_test_from_upipe(upipe);
+    upipe_clean(upipe);
+    free(ladder_test);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr ladder_test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** allocates an I420 flow definition */
+static struct uref *alloc_flow_def(struct uref_mgr *uref_mgr, size_t size)
+{
+    struct uref *flow_def = uref_pic_flow_alloc_def(uref_mgr, 1);
+    assert(flow_def != NULL);
+    ubase_assert(uref_pic_flow_add_plane(flow_def, 1, 1, 1, "y8"));
+    ubase_assert(uref_pic_flow_add_plane(flow_def, 2, 2, 1, "u8"));
+    ubase_assert(uref_pic_flow_add_plane(flow_def, 2, 2, 1, "v8"));
+    ubase_assert(uref_pic_flow_set_hsize(flow_def, size));
+    ubase_assert(uref_pic_flow_set_vsize(flow_def, size));
+    return flow_def;
+}
+
+int main(int argc, char **argv)
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH,
+                                                   udict_mgr, 0);
+    assert(uref_mgr != NULL);
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+
+    struct ubuf_mgr *ubuf_mgr = ubuf_pic_mem_mgr_alloc(UBUF_POOL_DEPTH,
+            UBUF_POOL_DEPTH, umem_mgr, 1, 0, 0, 0, 0, 16, 0);
+    assert(ubuf_mgr != NULL);
+    ubase_assert(ubuf_pic_mem_mgr_add_plane(ubuf_mgr, "y8", 1, 1, 1));
+    ubase_assert(ubuf_pic_mem_mgr_add_plane(ubuf_mgr, "u8", 2, 2, 1));
+    ubase_assert(ubuf_pic_mem_mgr_add_plane(ubuf_mgr, "v8", 2, 2, 1));
+
+    struct upipe_mgr *upipe_sws_ladder_mgr = upipe_sws_ladder_mgr_alloc();
+    assert(upipe_sws_ladder_mgr != NULL);
+    struct upipe *ladder = upipe_void_alloc(upipe_sws_ladder_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "ladder"));
+    assert(ladder != NULL);
+    struct uref *flow_def = alloc_flow_def(uref_mgr, SRCSIZE);
+    ubase_assert(upipe_set_flow_def(ladder, flow_def));
+    uref_free(flow_def);
+
+    struct upipe *sinks[NB_RENDITIONS];
+    struct upipe *renditions[NB_RENDITIONS];
+    for (unsigned int i = 0; i < NB_RENDITIONS; i++) {
+        sinks[i] = upipe_void_alloc(&ladder_test_mgr, uprobe_use(logger));
+        assert(sinks[i] != NULL);
+        ladder_test_from_upipe(sinks[i])->id = i;
+
+        flow_def = alloc_flow_def(uref_mgr, sizes[i]);
+        renditions[i] = upipe_flow_alloc_sub(ladder,
+                uprobe_pfx_alloc_va(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                                    "rendition %u", i), flow_def);
+        assert(renditions[i] != NULL);
+        uref_free(flow_def);
+        ubase_assert(upipe_set_output(renditions[i], sinks[i]));
+    }
+
+    for (int j = 0; j < 2; j++) {
+        struct uref *pic = uref_pic_alloc(uref_mgr, ubuf_mgr,
+                                          SRCSIZE, SRCSIZE);
+        assert(pic != NULL);
+        ubase_assert(uref_pic_set_progressive(pic));
+        for (int i = 0; i < 3; i++) {
+            uint8_t *w;
+            size_t stride;
+            uint8_t hsub, vsub;
+            ubase_assert(uref_pic_plane_write(pic, chromas[i], 0, 0, -1, -1,
+                                              &w));
+            ubase_assert(uref_pic_plane_size(pic, chromas[i], &stride,
+                                             &hsub, &vsub, NULL));
+            for (int y = 0; y < SRCSIZE / vsub; y++)
+                memset(w + y * stride, values[i], SRCSIZE / hsub);
+            ubase_assert(uref_pic_plane_unmap(pic, chromas[i], 0, 0, -1, -1));
+        }
+        upipe_input(ladder, pic, NULL);
+
+        for (unsigned int i = 0; i < NB_RENDITIONS; i++)
+            assert(counter[i] == j + 1);
+    }
+
+    for (unsigned int i = 0; i < NB_RENDITIONS; i++) {
+        upipe_release(renditions[i]);
+        test_free(sinks[i]);
+    }
+    upipe_release(ladder);
+
+    ubuf_mgr_release(ubuf_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+    return 0;
+}
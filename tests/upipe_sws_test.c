@@ -422,6 +422,25 @@ int main(int argc, char **argv)
     assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "u8", 2, 2, 1, logger));
     assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "v8", 2, 2, 1, logger));
 
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+    /* a picture converted in slices must be identical */
+    unsigned int threads;
+    ubase_assert(upipe_sws_get_threads(sws, &threads));
+    assert(threads == 1);
+    ubase_assert(upipe_sws_set_threads(sws, 4));
+    ubase_assert(upipe_sws_get_threads(sws, &threads));
+    assert(threads == 4);
+
+    pic = uref_dup(uref1);
+    upipe_input(sws, pic, NULL);
+
+    assert(sws_test_from_upipe(sws_test)->pic);
+    struct uref *sliced[2] = { uref2, sws_test_from_upipe(sws_test)->pic };
+    assert(compare_chroma(sliced, "y8", 1, 1, 1, logger));
+    assert(compare_chroma(sliced, "u8", 2, 2, 1, logger));
+    assert(compare_chroma(sliced, "v8", 2, 2, 1, logger));
+#endif
+
     /* release urefs */
     uref_free(uref1);
     uref_free(uref2);
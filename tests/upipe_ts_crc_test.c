@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for the CRC32 of PSI sections
+ */
+
+#undef NDEBUG
+
+#include <upipe-ts/upipe_ts_crc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#define BUFFER_SIZE 4096
+#define NB_ROUNDS 2000
+
+typedef uint32_t (*crc_func)(uint32_t, const uint8_t *, size_t);
+
+static uint8_t buffer[BUFFER_SIZE + 16];
+
+/* bit by bit reference */
+static uint32_t crc_ref(uint32_t crc, const uint8_t *p, size_t size)
+{
+    while (size--) {
+        crc ^= (uint32_t)*p++ << 24;
+        for (int i = 0; i < 8; i++)
+            crc = crc & 0x80000000 ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+    return crc;
+}
+
+static void test(const char *name, crc_func func)
+{
+    printf("testing %s\n", name);
+    assert(func(UPIPE_TS_CRC_INIT, (const uint8_t *)"123456789", 9) ==
+           0x0376e6e7);
+    for (int i = 0; i < NB_ROUNDS; i++) {
+        size_t offset = rand() % 16;
+        size_t size = rand() % (i % 2 ? BUFFER_SIZE : 256);
+        uint32_t init = i % 4 ? UPIPE_TS_CRC_INIT : (uint32_t)rand();
+        uint32_t crc = func(init, buffer + offset, size);
+        assert(crc == crc_ref(init, buffer + offset, size));
+
+        /* incremental updates */
+        size_t split = size ? rand() % size : 0;
+        assert(func(func(init, buffer + offset, split),
+                    buffer + offset + split, size - split) == crc);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    srand(42);
+    for (int i = 0; i < sizeof(buffer); i++)
+        buffer[i] = rand();
+
+    test("default", upipe_ts_crc32);
+    test("c", upipe_ts_crc32_c);
+#if defined(__i386__) || defined(__x86_64__)
+    if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3"))
+        test("pclmul", upipe_ts_crc32_pclmul);
+#endif
+#if defined(__aarch64__)
+    test("pmull", upipe_ts_crc32_pmull);
+#endif
+
+    /* section of 1021 octets, the maximum for PSI */
+    uint8_t section[1024];
+    memcpy(section, buffer, sizeof(section));
+    section[1] = 0xb0 | ((sizeof(section) - 3) >> 8);
+    section[2] = (sizeof(section) - 3) & 0xff;
+    upipe_ts_psi_set_crc(section);
+    assert(upipe_ts_psi_check_crc(section));
+    assert(crc_ref(UPIPE_TS_CRC_INIT, section, sizeof(section)) == 0);
+    section[42] ^= 0x10;
+    assert(!upipe_ts_psi_check_crc(section));
+    return 0;
+}
@@ -0,0 +1,644 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for TS demux with framers running in worker threads
+ */
+
+#undef NDEBUG
+
+#include <upipe/ubase.h>
+#include <upipe/urefcount.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_uref_mgr.h>
+#include <upipe/uprobe_ubuf_mem.h>
+#include <upipe-pthread/uprobe_pthread_upump_mgr.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_std.h>
+#include <upipe/upump.h>
+#include <upump-ev/upump_ev.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_worker_linear.h>
+#include <upipe-modules/upipe_transfer.h>
+#include <upipe-ts/upipe_ts_demux.h>
+#include <upipe-ts/upipe_ts_split.h>
+#include <upipe-framers/upipe_auto_framer.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <assert.h>
+
+#include <bitstream/mpeg/ts.h>
+#include <bitstream/mpeg/psi.h>
+#include <bitstream/mpeg/pes.h>
+#include <bitstream/mpeg/mp2v.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define XFER_QUEUE 255
+#define XFER_POOL 20
+#define WORKER_QUEUE 64
+#define UPROBE_LOG_LEVEL UPROBE_LOG_WARNING
+#define MAX_WORKERS 4
+#define NB_PROGRAMS 8
+#ifndef NB_FRAMES
+#define NB_FRAMES 50
+#endif
+#define FRAME_SIZE 4000
+#define PMT_PID(program) (0x100 + (program))
+#define VIDEO_PID(program) (0x200 + (program))
+/* TS packets per input uref, as in a UDP datagram */
+#define CHUNK_SIZE (7 * TS_SIZE)
+
+static struct uprobe *logger;
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+
+/** synthetic transport stream */
+static uint8_t *stream;
+static size_t stream_size;
+static size_t stream_offset;
+/** number of octets of the stream to feed before releasing the demux */
+static size_t stream_stop;
+static uint8_t cc[8192];
+
+static struct upipe *upipe_ts_demux;
+/** pump feeding the stream, which the worker queues may block */
+static struct upump *feed_pump;
+static struct upipe *programs[NB_PROGRAMS];
+static struct upipe *videos[NB_PROGRAMS];
+
+/** frame received on an output */
+struct frame {
+    size_t size;
+    uint64_t dts;
+};
+
+/** frames received on each program, for the current run */
+static struct frame frames[NB_PROGRAMS][NB_FRAMES];
+static unsigned int nb_frames[NB_PROGRAMS];
+static unsigned int nb_frames_total;
+/** frames of the run without workers */
+static struct frame ref_frames[NB_PROGRAMS][NB_FRAMES];
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_SYNC_ACQUIRED:
+        case UPROBE_SYNC_LOST:
+        case UPROBE_CLOCK_REF:
+        case UPROBE_CLOCK_TS:
+        case UPROBE_TS_SPLIT_ADD_PID:
+        case UPROBE_TS_SPLIT_DEL_PID:
+        case UPROBE_NEW_FLOW_DEF:
+        case UPROBE_NEW_RAP:
+        case UPROBE_SOURCE_END:
+        case UPROBE_NEED_UPUMP_MGR:
+        case UPROBE_FREEZE_UPUMP_MGR:
+        case UPROBE_THAW_UPUMP_MGR:
+        case UPROBE_STALLED:
+        case UPROBE_NEED_OUTPUT:
+            break;
+        case UPROBE_SPLIT_UPDATE: {
+            struct uref *flow_def = NULL;
+            while (ubase_check(upipe_split_iterate(upipe, &flow_def)) &&
+                   flow_def != NULL) {
+                uint64_t flow_id;
+                ubase_assert(uref_flow_get_id(flow_def, &flow_id));
+                const char *def;
+                ubase_assert(uref_flow_get_def(flow_def, &def));
+                if (upipe == upipe_ts_demux) {
+                    assert(!ubase_ncmp(def, "void."));
+                    assert(flow_id >= 1 && flow_id <= NB_PROGRAMS);
+                    if (programs[flow_id - 1] != NULL)
+                        continue;
+                    programs[flow_id - 1] =
+                        upipe_flow_alloc_sub(upipe_ts_demux,
+                            uprobe_pfx_alloc_va(uprobe_use(logger),
+                                                UPROBE_LOG_LEVEL,
+                                                "program %"PRIu64, flow_id),
+                            flow_def);
+                    assert(programs[flow_id - 1] != NULL);
+                } else if (!ubase_ncmp(def, "block.mpeg2video.")) {
+                    unsigned int program = flow_id - VIDEO_PID(0);
+                    assert(program < NB_PROGRAMS);
+                    assert(upipe == programs[program]);
+                    if (videos[program] != NULL)
+                        continue;
+                    videos[program] = upipe_flow_alloc_sub(upipe,
+                            uprobe_pfx_alloc_va(uprobe_use(logger),
+                                                UPROBE_LOG_LEVEL,
+                                                "video %u", program),
+                            flow_def);
+                    assert(videos[program] != NULL);
+                }
+            }
+            break;
+        }
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe recording the frames of one program */
+struct test_pipe {
+    struct urefcount urefcount;
+    unsigned int program;
+    struct upipe upipe;
+};
+
+/** helper phony pipe */
+static void test_free(struct urefcount *urefcount)
+{
+    struct test_pipe *test_pipe =
+        container_of(urefcount, struct test_pipe, urefcount);
+    upipe_clean(&test_pipe->upipe);
+    urefcount_clean(urefcount);
+    free(test_pipe);
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct test_pipe *test_pipe = malloc(sizeof(struct test_pipe));
+    assert(test_pipe != NULL);
+    upipe_init(&test_pipe->upipe, mgr, uprobe);
+    urefcount_init(&test_pipe->urefcount, test_free);
+    test_pipe->upipe.refcount = &test_pipe->urefcount;
+    test_pipe->program = va_arg(args, unsigned int);
+    return &test_pipe->upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    struct test_pipe *test_pipe = container_of(upipe, struct test_pipe, upipe);
+    unsigned int program = test_pipe->program;
+    assert(nb_frames[program] < NB_FRAMES);
+    struct frame *frame = &frames[program][nb_frames[program]++];
+    ubase_assert(uref_block_size(uref, &frame->size));
+    frame->dts = UINT64_MAX;
+    uref_clock_get_dts_prog(uref, &frame->dts);
+    nb_frames_total++;
+    uref_free(uref);
+
+    /* wake up the feeder to release the demux */
+    if (nb_frames_total == NB_PROGRAMS * NB_FRAMES &&
+        stream_offset == stream_size)
+        upump_start(feed_pump);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return uref_flow_match_def(flow_def, "block.mpeg2video.pic.");
+        }
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, request);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** appends a TS packet to the stream and returns it */
+static uint8_t *stream_packet(uint16_t pid, bool unitstart)
+{
+    stream = realloc(stream, stream_size + TS_SIZE);
+    assert(stream != NULL);
+    uint8_t *ts = stream + stream_size;
+    stream_size += TS_SIZE;
+    ts_init(ts);
+    if (unitstart)
+        ts_set_unitstart(ts);
+    ts_set_pid(ts, pid);
+    ts_set_cc(ts, cc[pid]);
+    cc[pid] = (cc[pid] + 1) & 0xf;
+    ts_set_payload(ts);
+    return ts;
+}
+
+/** appends a one-packet PSI section to the stream and returns it */
+static uint8_t *stream_section(uint16_t pid)
+{
+    uint8_t *payload = ts_payload(stream_packet(pid, true));
+    *payload++ = 0; /* pointer_field */
+    memset(payload, 0xff, TS_SIZE - TS_HEADER_SIZE - 1);
+    return payload;
+}
+
+/** appends a video PES carrying one intra frame to the stream */
+static void stream_frame(unsigned int program, unsigned int n, bool last)
+{
+    size_t slice_size = FRAME_SIZE + (n * 37 + program * 101) % 1000;
+    size_t es_size = MP2VSEQ_HEADER_SIZE + MP2VSEQX_HEADER_SIZE +
+                     MP2VPIC_HEADER_SIZE + MP2VPICX_HEADER_SIZE +
+                     4 + slice_size + (last ? MP2VEND_HEADER_SIZE : 0);
+    size_t pes_size = PES_HEADER_SIZE_PTSDTS + es_size;
+    uint8_t pes[pes_size];
+    uint64_t dts = 27000000 / 300 + n * 3600;
+
+    pes_init(pes);
+    pes_set_streamid(pes, PES_STREAM_ID_VIDEO_MPEG);
+    pes_set_length(pes, pes_size - PES_HEADER_SIZE);
+    pes_set_headerlength(pes, 0);
+    pes_set_dataalignment(pes);
+    pes_set_pts(pes, dts);
+    pes_set_dts(pes, dts);
+    uint8_t *es = pes_payload(pes);
+
+    mp2vseq_init(es);
+    mp2vseq_set_horizontal(es, 720);
+    mp2vseq_set_vertical(es, 576);
+    mp2vseq_set_aspect(es, MP2VSEQ_ASPECT_16_9);
+    mp2vseq_set_framerate(es, MP2VSEQ_FRAMERATE_25);
+    mp2vseq_set_bitrate(es, 2000000/400);
+    mp2vseq_set_vbvbuffer(es, 1835008/16/1024);
+    es += MP2VSEQ_HEADER_SIZE;
+
+    mp2vseqx_init(es);
+    mp2vseqx_set_profilelevel(es, MP2VSEQX_PROFILE_MAIN | MP2VSEQX_LEVEL_MAIN);
+    mp2vseqx_set_chroma(es, MP2VSEQX_CHROMA_420);
+    mp2vseqx_set_horizontal(es, 0);
+    mp2vseqx_set_vertical(es, 0);
+    mp2vseqx_set_bitrate(es, 0);
+    mp2vseqx_set_vbvbuffer(es, 0);
+    es += MP2VSEQX_HEADER_SIZE;
+
+    mp2vpic_init(es);
+    mp2vpic_set_temporalreference(es, 0);
+    mp2vpic_set_codingtype(es, MP2VPIC_TYPE_I);
+    mp2vpic_set_vbvdelay(es, UINT16_MAX);
+    es += MP2VPIC_HEADER_SIZE;
+
+    mp2vpicx_init(es);
+    mp2vpicx_set_fcode00(es, 0);
+    mp2vpicx_set_fcode01(es, 0);
+    mp2vpicx_set_fcode10(es, 0);
+    mp2vpicx_set_fcode11(es, 0);
+    mp2vpicx_set_intradc(es, 0);
+    mp2vpicx_set_structure(es, MP2VPICX_FRAME_PICTURE);
+    mp2vpicx_set_tff(es);
+    es += MP2VPICX_HEADER_SIZE;
+
+    mp2vstart_init(es, 1);
+    es += 4;
+    /* slice data without start code emulation */
+    for (size_t i = 0; i < slice_size; i++)
+        *es++ = 1 + (i + n) % 255;
+
+    if (last)
+        mp2vend_init(es);
+
+    /* packetize, with a PCR in the first packet */
+    uint16_t pid = VIDEO_PID(program);
+    const uint8_t *p = pes;
+    bool first = true;
+    while (pes_size) {
+        uint8_t *ts = stream_packet(pid, first);
+        size_t af_size = first ? 8 : 0;
+        size_t room = TS_SIZE - TS_HEADER_SIZE - af_size;
+        if (pes_size < room)
+            af_size += room - pes_size;
+        if (af_size) {
+            ts_set_adaptation(ts, af_size - 1);
+            if (first) {
+                tsaf_set_pcr(ts, dts - 9000);
+                tsaf_set_pcrext(ts, 0);
+            }
+        }
+        size_t size = TS_SIZE - TS_HEADER_SIZE - af_size;
+        memcpy(ts_payload(ts), p, size);
+        p += size;
+        pes_size -= size;
+        first = false;
+    }
+}
+
+/** builds the synthetic stream: a PAT, one PMT per program, and the
+ * interleaved video frames of all programs */
+static void stream_build(void)
+{
+    uint8_t *payload = stream_section(0);
+    pat_init(payload);
+    pat_set_length(payload, NB_PROGRAMS * PAT_PROGRAM_SIZE);
+    pat_set_tsid(payload, 42);
+    psi_set_version(payload, 0);
+    psi_set_current(payload);
+    psi_set_section(payload, 0);
+    psi_set_lastsection(payload, 0);
+    for (unsigned int i = 0; i < NB_PROGRAMS; i++) {
+        uint8_t *pat_program = pat_get_program(payload, i);
+        patn_init(pat_program);
+        patn_set_program(pat_program, i + 1);
+        patn_set_pid(pat_program, PMT_PID(i));
+    }
+    psi_set_crc(payload);
+
+    for (unsigned int i = 0; i < NB_PROGRAMS; i++) {
+        payload = stream_section(PMT_PID(i));
+        pmt_init(payload);
+        pmt_set_length(payload, PMT_ES_SIZE);
+        pmt_set_program(payload, i + 1);
+        psi_set_version(payload, 0);
+        psi_set_current(payload);
+        pmt_set_pcrpid(payload, VIDEO_PID(i));
+        pmt_set_desclength(payload, 0);
+        uint8_t *pmt_es = pmt_get_es(payload, 0);
+        pmtn_init(pmt_es);
+        pmtn_set_pid(pmt_es, VIDEO_PID(i));
+        pmtn_set_streamtype(pmt_es, PMT_STREAMTYPE_VIDEO_MPEG2);
+        pmtn_set_desclength(pmt_es, 0);
+        psi_set_crc(payload);
+    }
+
+    for (unsigned int n = 0; n < NB_FRAMES; n++)
+        for (unsigned int i = 0; i < NB_PROGRAMS; i++)
+            stream_frame(i, n, n == NB_FRAMES - 1);
+}
+
+/** releases the demux and its outputs */
+static void demux_release(void)
+{
+    for (unsigned int i = 0; i < NB_PROGRAMS; i++) {
+        upipe_release(videos[i]);
+        upipe_release(programs[i]);
+        videos[i] = programs[i] = NULL;
+    }
+    upipe_release(upipe_ts_demux);
+    upipe_ts_demux = NULL;
+}
+
+/** connects the video outputs that were allocated to the sinks */
+static void demux_connect(void)
+{
+    for (unsigned int i = 0; i < NB_PROGRAMS; i++) {
+        struct upipe *output;
+        if (videos[i] == NULL ||
+            (ubase_check(upipe_get_output(videos[i], &output)) &&
+             output != NULL))
+            continue;
+        struct upipe *sink = upipe_alloc(&test_mgr,
+                uprobe_pfx_alloc_va(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                                    "sink %u", i), 0, i);
+        assert(sink != NULL);
+        ubase_assert(upipe_set_output(videos[i], sink));
+        upipe_release(sink);
+    }
+}
+
+/** feeds the stream to the demux, one chunk per call, then releases the
+ * demux at the cut or once all frames are out */
+static void feed_idler(struct upump *upump)
+{
+    if (stream_offset < stream_stop) {
+        size_t size = stream_stop - stream_offset;
+        if (size > CHUNK_SIZE)
+            size = CHUNK_SIZE;
+        struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, size);
+        assert(uref != NULL);
+        uint8_t *buffer;
+        int write_size = -1;
+        ubase_assert(uref_block_write(uref, 0, &write_size, &buffer));
+        assert(write_size == size);
+        memcpy(buffer, stream + stream_offset, size);
+        uref_block_unmap(uref, 0);
+        stream_offset += size;
+        upipe_input(upipe_ts_demux, uref, &feed_pump);
+        demux_connect();
+        return;
+    }
+
+    upump_stop(upump);
+    if (stream_stop < stream_size ||
+        nb_frames_total == NB_PROGRAMS * NB_FRAMES) {
+        demux_release();
+        upump_free(upump);
+        feed_pump = NULL;
+    }
+}
+
+/** runs a worker thread */
+static void *worker_thread(void *_upipe_xfer_mgr)
+{
+    struct upipe_mgr *upipe_xfer_mgr = (struct upipe_mgr *)_upipe_xfer_mgr;
+
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_loop(UPUMP_POOL,
+                                                          UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    uprobe_pthread_upump_mgr_set(logger, upump_mgr);
+
+    ubase_assert(upipe_xfer_mgr_attach(upipe_xfer_mgr, upump_mgr));
+    upipe_mgr_release(upipe_xfer_mgr);
+
+    upump_mgr_run(upump_mgr, NULL);
+
+    upump_mgr_release(upump_mgr);
+    return NULL;
+}
+
+/** demuxes the first stream_stop octets of the stream with the given number
+ * of workers */
+static void run(struct upump_mgr *upump_mgr, struct upipe_mgr *autof_mgr,
+                unsigned int nb_workers, size_t stop)
+{
+    pthread_t threads[MAX_WORKERS];
+    struct upipe_mgr *wlin_mgrs[MAX_WORKERS];
+
+    for (unsigned int i = 0; i < nb_workers; i++) {
+        struct upipe_mgr *xfer_mgr =
+            upipe_xfer_mgr_alloc(XFER_QUEUE, XFER_POOL, NULL);
+        assert(xfer_mgr != NULL);
+        upipe_mgr_use(xfer_mgr);
+        assert(!pthread_create(&threads[i], NULL, worker_thread, xfer_mgr));
+        wlin_mgrs[i] = upipe_wlin_mgr_alloc(xfer_mgr);
+        assert(wlin_mgrs[i] != NULL);
+        upipe_mgr_release(xfer_mgr);
+    }
+
+    struct upipe_mgr *upipe_ts_demux_mgr = upipe_ts_demux_mgr_alloc();
+    assert(upipe_ts_demux_mgr != NULL);
+    ubase_assert(upipe_ts_demux_mgr_set_autof_mgr(upipe_ts_demux_mgr,
+                                                  autof_mgr));
+    if (nb_workers) {
+        ubase_assert(upipe_ts_demux_mgr_set_workers(upipe_ts_demux_mgr,
+                    nb_workers, wlin_mgrs, logger, WORKER_QUEUE));
+        unsigned int workers;
+        ubase_assert(upipe_ts_demux_mgr_get_workers(upipe_ts_demux_mgr,
+                                                    &workers));
+        assert(workers == nb_workers);
+        for (unsigned int i = 0; i < nb_workers; i++)
+            upipe_mgr_release(wlin_mgrs[i]);
+    }
+
+    upipe_ts_demux = upipe_void_alloc(upipe_ts_demux_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "ts demux"));
+    assert(upipe_ts_demux != NULL);
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, "mpegts.");
+    assert(flow_def != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_ts_demux, flow_def));
+    uref_free(flow_def);
+
+    memset(nb_frames, 0, sizeof(nb_frames));
+    nb_frames_total = 0;
+    stream_offset = 0;
+    stream_stop = stop;
+
+    feed_pump = upump_alloc_idler(upump_mgr, feed_idler, NULL, NULL);
+    assert(feed_pump != NULL);
+    upump_start(feed_pump);
+    upump_mgr_run(upump_mgr, NULL);
+    assert(upipe_ts_demux == NULL);
+
+    /* the worker threads exit once their xfer managers are released */
+    upipe_mgr_release(upipe_ts_demux_mgr);
+    for (unsigned int i = 0; i < nb_workers; i++)
+        assert(!pthread_join(threads[i], NULL));
+}
+
+int main(int argc, char *argv[])
+{
+    struct upump_mgr *upump_mgr =
+        upump_ev_mgr_alloc_default(UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    logger = uprobe_stdio_alloc(&uprobe, stdout, UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_uref_mgr_alloc(logger, uref_mgr);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr,
+                                   UBUF_POOL_DEPTH, UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+    logger = uprobe_pthread_upump_mgr_alloc(logger);
+    assert(logger != NULL);
+    uprobe_pthread_upump_mgr_set(logger, upump_mgr);
+
+    struct upipe_mgr *upipe_autof_mgr = upipe_autof_mgr_alloc();
+    assert(upipe_autof_mgr != NULL);
+
+    stream_build();
+
+    /* reference run, with the framers in the demux thread */
+    run(upump_mgr, upipe_autof_mgr, 0, stream_size);
+    for (unsigned int i = 0; i < NB_PROGRAMS; i++) {
+        assert(nb_frames[i] == NB_FRAMES);
+        for (unsigned int n = 1; n < NB_FRAMES; n++)
+            assert(frames[i][n].dts > frames[i][n - 1].dts);
+    }
+    memcpy(ref_frames, frames, sizeof(frames));
+
+    /* each output must get the same frames, in the same order, from a
+     * worker thread */
+    for (unsigned int nb_workers = 1; nb_workers <= MAX_WORKERS;
+         nb_workers *= 2) {
+        run(upump_mgr, upipe_autof_mgr, nb_workers, stream_size);
+        for (unsigned int i = 0; i < NB_PROGRAMS; i++) {
+            assert(nb_frames[i] == NB_FRAMES);
+            assert(!memcmp(frames[i], ref_frames[i], sizeof(frames[i])));
+        }
+    }
+
+    /* release the demux while frames are still queued to and from the
+     * workers: whatever comes out must be a prefix of the reference, except
+     * for the last frame, which the framers flush truncated */
+    run(upump_mgr, upipe_autof_mgr, 2, stream_size / TS_SIZE / 2 * TS_SIZE);
+    assert(nb_frames_total < NB_PROGRAMS * NB_FRAMES);
+    for (unsigned int i = 0; i < NB_PROGRAMS; i++) {
+        unsigned int n = nb_frames[i];
+        if (!n)
+            continue;
+        assert(!memcmp(frames[i], ref_frames[i],
+                       (n - 1) * sizeof(struct frame)));
+        assert(frames[i][n - 1].dts == ref_frames[i][n - 1].dts);
+        assert(frames[i][n - 1].size <= ref_frames[i][n - 1].size);
+    }
+
+    free(stream);
+    upipe_mgr_release(upipe_autof_mgr);
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    upump_mgr_release(upump_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
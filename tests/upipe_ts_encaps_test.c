@@ -608,6 +608,28 @@ int main(int argc, char *argv[])
                              (uint64_t)total_size * UCLOCK_FREQ / 1024);
         }
 
+        if (i % 2) {
+            /* alternate with the contiguous mode */
+            uint8_t ts[TS_SIZE];
+            ubase_assert(upipe_ts_encaps_splice_contiguous(upipe_ts_encaps,
+                        mux_sys, mux_sys, ts, &dts_sys));
+            assert(ts_validate(ts));
+            assert(ts_get_pid(ts) == 68);
+            last_cc++;
+            last_cc &= 0xf;
+            assert(ts_get_cc(ts) == last_cc);
+            assert(!ts_get_unitstart(ts));
+            assert(!ts_has_adaptation(ts));
+            size_t ts_size = TS_SIZE - TS_HEADER_SIZE;
+            if (ts_size > total_size)
+                ts_size = total_size;
+            check_buffer(ts + TS_HEADER_SIZE, ts_size, &total_size);
+            int j;
+            for (j = TS_HEADER_SIZE + ts_size; j < TS_SIZE; j++)
+                assert(ts[j] == 0xff);
+            continue;
+        }
+
         ubase_assert(upipe_ts_encaps_splice(upipe_ts_encaps, mux_sys, mux_sys,
                                             &ubuf, &dts_sys));
 
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for TS mux module (contiguous output mode)
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_uref_mgr.h>
+#include <upipe/uprobe_ubuf_mem.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/uclock.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_std.h>
+#include <upipe/upipe.h>
+#include <upipe-ts/upipe_ts_mux.h>
+#include <upipe-ts/uref_ts_flow.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#include <bitstream/mpeg/ts.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define NB_FRAMES 50
+#define FRAME_SIZE 3000
+#define FRAME_DURATION (UCLOCK_FREQ / 25)
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+        case UPROBE_TS_MUX_LAST_CC:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** phony sink recording the multiplex */
+struct test {
+    bool contiguous;
+    unsigned int nb_urefs;
+    uint64_t *cr_sys;
+    uint8_t *buffer;
+    size_t size;
+    struct upipe upipe;
+};
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct test *test = malloc(sizeof(struct test));
+    assert(test != NULL);
+    upipe_init(&test->upipe, mgr, uprobe);
+    test->contiguous = false;
+    test->nb_urefs = 0;
+    test->cr_sys = NULL;
+    test->buffer = NULL;
+    test->size = 0;
+    return &test->upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    struct test *test = container_of(upipe, struct test, upipe);
+    assert(uref != NULL);
+    test->cr_sys = realloc(test->cr_sys,
+                           (test->nb_urefs + 1) * sizeof(uint64_t));
+    assert(test->cr_sys != NULL);
+    ubase_assert(uref_clock_get_cr_sys(uref, &test->cr_sys[test->nb_urefs]));
+    test->nb_urefs++;
+
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(size && !(size % TS_SIZE));
+    if (test->contiguous) {
+        const uint8_t *buffer;
+        int read_size = -1;
+        ubase_assert(uref_block_read(uref, 0, &read_size, &buffer));
+        assert(read_size == size);
+        uref_block_unmap(uref, 0);
+    }
+
+    test->buffer = realloc(test->buffer, test->size + size);
+    assert(test->buffer != NULL);
+    ubase_assert(uref_block_extract(uref, 0, size,
+                                    test->buffer + test->size));
+
+    /* capped VBR never outputs a uref made only of padding */
+    bool padding = true;
+    for (size_t offset = 0; offset < size; offset += TS_SIZE) {
+        const uint8_t *packet = test->buffer + test->size + offset;
+        assert(ts_validate(packet));
+        if (ts_get_pid(packet) != 8191)
+            padding = false;
+    }
+    assert(!padding);
+
+    test->size += size;
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    struct test *test = container_of(upipe, struct test, upipe);
+    upipe_clean(upipe);
+    free(test->cr_sys);
+    free(test->buffer);
+    free(test);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** muxes a video elementary stream and returns the sink */
+static struct upipe *run(struct uprobe *logger, struct uref_mgr *uref_mgr,
+                         struct ubuf_mgr *ubuf_mgr, unsigned int mtu,
+                         bool contiguous)
+{
+    struct upipe *upipe_sink = upipe_void_alloc(&test_mgr,
+                                                uprobe_use(logger));
+    assert(upipe_sink != NULL);
+    struct test *test = container_of(upipe_sink, struct test, upipe);
+    test->contiguous = contiguous;
+
+    struct upipe_mgr *upipe_ts_mux_mgr = upipe_ts_mux_mgr_alloc();
+    assert(upipe_ts_mux_mgr != NULL);
+    struct upipe *upipe_ts_mux = upipe_void_alloc(upipe_ts_mux_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "ts mux"));
+    assert(upipe_ts_mux != NULL);
+    upipe_mgr_release(upipe_ts_mux_mgr);
+
+    struct uref *flow_def = uref_alloc_control(uref_mgr);
+    assert(flow_def != NULL);
+    ubase_assert(uref_flow_set_def(flow_def, "void."));
+    ubase_assert(upipe_set_flow_def(upipe_ts_mux, flow_def));
+    ubase_assert(upipe_ts_mux_set_conformance(upipe_ts_mux,
+                                              UPIPE_TS_CONFORMANCE_ISO));
+    ubase_assert(upipe_ts_mux_set_mode(upipe_ts_mux,
+                                       UPIPE_TS_MUX_MODE_CAPPED));
+    ubase_assert(upipe_ts_mux_set_octetrate(upipe_ts_mux, 500000));
+    ubase_assert(upipe_set_output_size(upipe_ts_mux, mtu));
+    ubase_assert(upipe_ts_mux_set_cr_prog(upipe_ts_mux, 0));
+
+    bool contiguous_get;
+    ubase_assert(upipe_ts_mux_get_contiguous(upipe_ts_mux, &contiguous_get));
+    assert(!contiguous_get);
+    ubase_assert(upipe_ts_mux_set_contiguous(upipe_ts_mux, contiguous));
+    ubase_assert(upipe_ts_mux_get_contiguous(upipe_ts_mux, &contiguous_get));
+    assert(contiguous_get == contiguous);
+    ubase_assert(upipe_set_output(upipe_ts_mux, upipe_sink));
+
+    ubase_assert(uref_flow_set_id(flow_def, 1));
+    struct upipe *upipe_ts_mux_program = upipe_void_alloc_sub(upipe_ts_mux,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "ts mux program"));
+    assert(upipe_ts_mux_program != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_ts_mux_program, flow_def));
+    uref_free(flow_def);
+
+    flow_def = uref_block_flow_alloc_def(uref_mgr, "mpeg2video.pic.");
+    assert(flow_def != NULL);
+    ubase_assert(uref_block_flow_set_octetrate(flow_def,
+                FRAME_SIZE * UCLOCK_FREQ / FRAME_DURATION));
+    ubase_assert(uref_block_flow_set_buffer_size(flow_def, 229376));
+    struct urational fps = { .num = 25, .den = 1 };
+    ubase_assert(uref_pic_flow_set_fps(flow_def, fps));
+    struct upipe *upipe_ts_mux_input = upipe_void_alloc_sub(
+            upipe_ts_mux_program,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "ts mux input"));
+    assert(upipe_ts_mux_input != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_ts_mux_input, flow_def));
+    uref_free(flow_def);
+
+    for (int i = 0; i < NB_FRAMES; i++) {
+        struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, FRAME_SIZE);
+        assert(uref != NULL);
+        uint8_t *buffer;
+        int size = -1;
+        ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+        assert(size == FRAME_SIZE);
+        memset(buffer, i, size);
+        uref_block_unmap(uref, 0);
+
+        uint64_t date = 10 * UCLOCK_FREQ + i * FRAME_DURATION;
+        uref_clock_set_dts_prog(uref, date);
+        uref_clock_set_dts_sys(uref, date);
+        uref_clock_set_dts_pts_delay(uref, 0);
+        uref_clock_set_duration(uref, FRAME_DURATION);
+        if (!i)
+            uref_flow_set_random(uref);
+        upipe_input(upipe_ts_mux_input, uref, NULL);
+
+        /* the buffer of a pending contiguous uref is sized for the mtu */
+        if (contiguous && mtu > TS_SIZE && i == NB_FRAMES / 2) {
+            assert(upipe_ts_mux_set_contiguous(upipe_ts_mux, false) ==
+                   UBASE_ERR_BUSY);
+            assert(upipe_set_output_size(upipe_ts_mux, mtu + TS_SIZE) ==
+                   UBASE_ERR_BUSY);
+            ubase_assert(upipe_set_output_size(upipe_ts_mux, mtu));
+        }
+    }
+
+    /* single-packet urefs are output at once, so no aggregation is
+     * pending between two inputs */
+    if (mtu == TS_SIZE) {
+        ubase_assert(upipe_ts_mux_set_contiguous(upipe_ts_mux, !contiguous));
+        ubase_assert(upipe_ts_mux_set_contiguous(upipe_ts_mux, contiguous));
+    }
+
+    upipe_release(upipe_ts_mux_input);
+    upipe_release(upipe_ts_mux_program);
+    upipe_release(upipe_ts_mux);
+
+    assert(test->nb_urefs);
+    return upipe_sink;
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+    struct ubuf_mgr *ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH,
+                                                         UBUF_POOL_DEPTH,
+                                                         umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_uref_mgr_alloc(logger, uref_mgr);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+
+    /* the contiguous multiplex must match the segmented one packet for
+     * packet, and uref for uref */
+    for (unsigned int mtu = TS_SIZE; mtu <= 7 * TS_SIZE; mtu += 6 * TS_SIZE) {
+        struct upipe *upipe_sink = run(logger, uref_mgr, ubuf_mgr, mtu,
+                                       false);
+        struct upipe *upipe_sink_contiguous = run(logger, uref_mgr, ubuf_mgr,
+                                                  mtu, true);
+        struct test *test = container_of(upipe_sink, struct test, upipe);
+        struct test *test_contiguous = container_of(upipe_sink_contiguous,
+                                                    struct test, upipe);
+        assert(test_contiguous->nb_urefs == test->nb_urefs);
+        assert(test_contiguous->size == test->size);
+        assert(!memcmp(test_contiguous->buffer, test->buffer, test->size));
+        assert(!memcmp(test_contiguous->cr_sys, test->cr_sys,
+                       test->nb_urefs * sizeof(uint64_t)));
+
+        test_free(upipe_sink);
+        test_free(upipe_sink_contiguous);
+    }
+
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
@@ -47,6 +47,7 @@
 #include <upipe/upipe.h>
 #include <upipe-ts/uref_ts_flow.h>
 #include <upipe-ts/upipe_ts_psi_split.h>
+#include <upipe-ts/upipe_ts_crc.h>
 
 #include <stdbool.h>
 #include <stdlib.h>
@@ -143,11 +144,17 @@ static int test_control(struct upipe *upipe, int command, va_list args)
     }
 }
 
+/** helper phony pipe */
+static unsigned int test_get_packets(struct upipe *upipe)
+{
+    struct test *test = container_of(upipe, struct test, upipe);
+    return test->nb_packets;
+}
+
 /** helper phony pipe */
 static void test_free(struct upipe *upipe)
 {
     struct test *test = container_of(upipe, struct test, upipe);
-    assert(test->nb_packets == 1);
     upipe_clean(upipe);
     free(test);
 }
@@ -160,6 +167,31 @@ static struct upipe_mgr test_mgr = {
     .upipe_control = test_control
 };
 
+/** sends a section of a two-section table 68 */
+static void send_section(struct upipe *upipe, struct uref_mgr *uref_mgr,
+                         struct ubuf_mgr *ubuf_mgr, uint8_t section,
+                         uint8_t version, bool corrupt)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, PSI_MAX_SIZE);
+    assert(uref != NULL);
+    uint8_t *buffer;
+    int size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == PSI_MAX_SIZE);
+    psi_init(buffer, 1);
+    psi_set_length(buffer, PSI_MAX_SIZE - PSI_HEADER_SIZE);
+    psi_set_tableid(buffer, 68);
+    psi_set_tableidext(buffer, 12);
+    psi_set_version(buffer, version);
+    psi_set_section(buffer, section);
+    psi_set_lastsection(buffer, 1);
+    upipe_ts_psi_set_crc(buffer);
+    if (corrupt)
+        buffer[PSI_HEADER_SIZE_SYNTAX1] ^= 0xff;
+    uref_block_unmap(uref, 0);
+    upipe_input(upipe, uref, NULL);
+}
+
 int main(int argc, char *argv[])
 {
     struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
@@ -233,18 +265,22 @@ int main(int argc, char *argv[])
     ubase_assert(upipe_set_output(upipe_ts_psi_split_output69, upipe_sink69));
     uref_free(uref);
 
+    int cache;
+    ubase_assert(upipe_ts_psi_split_output_get_cache(
+                upipe_ts_psi_split_output68, &cache));
+    assert(!cache);
+    ubase_assert(upipe_ts_psi_split_output_set_cache(
+                upipe_ts_psi_split_output68, true));
+    ubase_assert(upipe_ts_psi_split_output_get_cache(
+                upipe_ts_psi_split_output68, &cache));
+    assert(cache);
+
     uint8_t *buffer;
     int size;
-    uref = uref_block_alloc(uref_mgr, ubuf_mgr, PSI_MAX_SIZE);
-    assert(uref != NULL);
-    size = -1;
-    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
-    assert(size == PSI_MAX_SIZE);
-    psi_init(buffer, 1);
-    psi_set_tableid(buffer, 68);
-    psi_set_tableidext(buffer, 12);
-    uref_block_unmap(uref, 0);
-    upipe_input(upipe_ts_psi_split, uref, NULL);
+    /* repetitions of the section are dropped by output 68 */
+    for (int i = 0; i < 3; i++)
+        send_section(upipe_ts_psi_split, uref_mgr, ubuf_mgr, 0, 0, false);
+    assert(test_get_packets(upipe_sink68) == 1);
 
     uref = uref_block_alloc(uref_mgr, ubuf_mgr, PSI_MAX_SIZE);
     assert(uref != NULL);
@@ -268,6 +304,50 @@ int main(int argc, char *argv[])
     uref_block_unmap(uref, 0);
     upipe_input(upipe_ts_psi_split, uref, NULL);
 
+    uint64_t sections, unchanged;
+    ubase_assert(upipe_ts_psi_split_get_stats(upipe_ts_psi_split, &sections,
+                                              &unchanged));
+    assert(sections == 5);
+    assert(unchanged == 2);
+    assert(test_get_packets(upipe_sink69) == 1);
+
+    /* corrupt sections are not remembered */
+    for (int i = 0; i < 2; i++)
+        send_section(upipe_ts_psi_split, uref_mgr, ubuf_mgr, 1, 0, true);
+    assert(test_get_packets(upipe_sink68) == 3);
+    for (int i = 0; i < 2; i++)
+        send_section(upipe_ts_psi_split, uref_mgr, ubuf_mgr, 1, 0, false);
+    assert(test_get_packets(upipe_sink68) == 4);
+
+    /* a new version forgets all the sections of the table */
+    send_section(upipe_ts_psi_split, uref_mgr, ubuf_mgr, 0, 1, false);
+    assert(test_get_packets(upipe_sink68) == 5);
+    send_section(upipe_ts_psi_split, uref_mgr, ubuf_mgr, 1, 0, false);
+    assert(test_get_packets(upipe_sink68) == 6);
+    send_section(upipe_ts_psi_split, uref_mgr, ubuf_mgr, 1, 1, false);
+    send_section(upipe_ts_psi_split, uref_mgr, ubuf_mgr, 0, 1, false);
+    assert(test_get_packets(upipe_sink68) == 8);
+    send_section(upipe_ts_psi_split, uref_mgr, ubuf_mgr, 0, 1, false);
+    send_section(upipe_ts_psi_split, uref_mgr, ubuf_mgr, 1, 1, false);
+    assert(test_get_packets(upipe_sink68) == 8);
+
+    ubase_assert(upipe_ts_psi_split_get_stats(upipe_ts_psi_split, &sections,
+                                              &unchanged));
+    assert(sections == 15);
+    assert(unchanged == 5);
+
+    /* repetitions are forwarded again now and then, in case the decoder
+     * rejected the table */
+    for (int i = 0; i < 100; i++)
+        send_section(upipe_ts_psi_split, uref_mgr, ubuf_mgr, 0, 1, false);
+    unsigned int forwarded = test_get_packets(upipe_sink68) - 8;
+    assert(forwarded > 1);
+    assert(forwarded < 50);
+    ubase_assert(upipe_ts_psi_split_get_stats(upipe_ts_psi_split, &sections,
+                                              &unchanged));
+    assert(sections == 115);
+    assert(unchanged == 5 + 100 - forwarded);
+
     upipe_release(upipe_ts_psi_split_output68);
     upipe_release(upipe_ts_psi_split_output69);
     upipe_release(upipe_ts_psi_split);
@@ -53,6 +53,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <inttypes.h>
+#include <string.h>
 #include <assert.h>
 
 #include <bitstream/mpeg/ts.h>
@@ -78,23 +79,32 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe,
             unsigned int signature = va_arg(args, unsigned int);
             unsigned int pid = va_arg(args, unsigned int);
             assert(signature == UPIPE_TS_SPLIT_SIGNATURE);
-            assert(pid == 68 || pid == 69);
+            assert(pid == 68 || pid == 69 || pid == 70);
             break;
         }
         case UPROBE_TS_SPLIT_DEL_PID: {
             unsigned int signature = va_arg(args, unsigned int);
             unsigned int pid = va_arg(args, unsigned int);
             assert(signature == UPIPE_TS_SPLIT_SIGNATURE);
-            assert(pid == 68 || pid == 69);
+            assert(pid == 68 || pid == 69 || pid == 70);
             break;
         }
     }
     return UBASE_ERR_NONE;
 }
 
+/* when set, the sink of PID 68 adds an output for PID 70, like a PAT
+ * adding a PMT */
+static struct upipe *add_pid70 = NULL;
+static struct upipe *upipe_sink70 = NULL;
+static struct upipe *upipe_ts_split_output70 = NULL;
+
+static struct upipe_mgr test_mgr;
+
 struct test {
     uint16_t pid;
-    bool got_packet;
+    unsigned int nb_urefs;
+    unsigned int nb_packets;
     struct upipe upipe;
 };
 
@@ -108,7 +118,8 @@ static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
     struct test *test = malloc(sizeof(struct test));
     assert(test != NULL);
     upipe_init(&test->upipe, mgr, uprobe);
-    test->got_packet = false;
+    test->nb_urefs = 0;
+    test->nb_packets = 0;
     test->pid = pid;
     return &test->upipe;
 }
@@ -119,14 +130,33 @@ static void test_input(struct upipe *upipe, struct uref *uref,
 {
     struct test *test = container_of(upipe, struct test, upipe);
     assert(uref != NULL);
-    test->got_packet = true;
-    const uint8_t *buffer;
-    int size = -1;
-    ubase_assert(uref_block_read(uref, 0, &size, &buffer));
-    assert(size == TS_SIZE); //because of the way we allocated it
-    assert(ts_validate(buffer));
-    assert(ts_get_pid(buffer) == test->pid);
-    uref_block_unmap(uref, 0);
+    test->nb_urefs++;
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(size && !(size % TS_SIZE));
+    for (int offset = 0; offset < size; offset += TS_SIZE) {
+        uint8_t buffer[TS_HEADER_SIZE];
+        ubase_assert(uref_block_extract(uref, offset, TS_HEADER_SIZE, buffer));
+        assert(ts_validate(buffer));
+        assert(ts_get_pid(buffer) == test->pid);
+        test->nb_packets++;
+    }
+
+    if (test->pid == 68 && add_pid70 != NULL) {
+        struct uref *flow_def = uref_block_flow_alloc_def(uref->mgr,
+                                                          "mpegts.");
+        assert(flow_def != NULL);
+        ubase_assert(uref_ts_flow_set_pid(flow_def, 70));
+        upipe_sink70 = upipe_flow_alloc(&test_mgr, uprobe_use(upipe->uprobe),
+                                        flow_def);
+        assert(upipe_sink70 != NULL);
+        upipe_ts_split_output70 = upipe_flow_alloc_sub(add_pid70,
+                uprobe_use(upipe->uprobe), flow_def);
+        assert(upipe_ts_split_output70 != NULL);
+        ubase_assert(upipe_set_output(upipe_ts_split_output70, upipe_sink70));
+        uref_free(flow_def);
+        add_pid70 = NULL;
+    }
     uref_free(uref);
 }
 
@@ -146,7 +176,6 @@ static int test_control(struct upipe *upipe, int command, va_list args)
 static void test_free(struct upipe *upipe)
 {
     struct test *test = container_of(upipe, struct test, upipe);
-    assert(test->got_packet);
     upipe_clean(upipe);
     free(test);
 }
@@ -159,6 +188,38 @@ static struct upipe_mgr test_mgr = {
     .upipe_control = test_control
 };
 
+/** allocates a block of TS packets, split into two segments */
+static struct uref *alloc_packets(struct uref_mgr *uref_mgr,
+                                  struct ubuf_mgr *ubuf_mgr,
+                                  const uint16_t *pids, int nb_pids,
+                                  int split)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, split);
+    assert(uref != NULL);
+    struct ubuf *ubuf = ubuf_block_alloc(ubuf_mgr, nb_pids * TS_SIZE - split);
+    assert(ubuf != NULL);
+    ubase_assert(uref_block_append(uref, ubuf));
+
+    uint8_t packet[TS_SIZE];
+    for (int i = 0; i < nb_pids; i++) {
+        ts_pad(packet);
+        ts_set_pid(packet, pids[i]);
+        int offset = i * TS_SIZE;
+        int size = TS_SIZE;
+        while (size) {
+            uint8_t *buffer;
+            int write_size = size;
+            ubase_assert(uref_block_write(uref, offset, &write_size,
+                                          &buffer));
+            memcpy(buffer, packet + TS_SIZE - size, write_size);
+            uref_block_unmap(uref, offset);
+            offset += write_size;
+            size -= write_size;
+        }
+    }
+    return uref;
+}
+
 int main(int argc, char *argv[])
 {
     struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
@@ -236,13 +297,48 @@ int main(int argc, char *argv[])
     uref_block_unmap(uref, 0);
     upipe_input(upipe_ts_split, uref, NULL);
 
+    /* multi-packet block, one packet per output uref */
+    static const uint16_t pids1[] = { 68, 69, 68, 100 };
+    uref = alloc_packets(uref_mgr, ubuf_mgr, pids1, 4, 2 * TS_SIZE);
+    upipe_input(upipe_ts_split, uref, NULL);
+
+    /* multi-packet block with a header spanning two segments, aggregated */
+    bool aggregate;
+    ubase_assert(upipe_ts_split_get_aggregate(upipe_ts_split, &aggregate));
+    assert(!aggregate);
+    ubase_assert(upipe_ts_split_set_aggregate(upipe_ts_split, true));
+    static const uint16_t pids2[] = { 68, 68, 69, 68 };
+    uref = alloc_packets(uref_mgr, ubuf_mgr, pids2, 4, TS_SIZE + 2);
+    upipe_input(upipe_ts_split, uref, NULL);
+
+    struct test *test68 = container_of(upipe_sink68, struct test, upipe);
+    struct test *test69 = container_of(upipe_sink69, struct test, upipe);
+    assert(test68->nb_urefs == 4);
+    assert(test68->nb_packets == 6);
+    assert(test69->nb_urefs == 3);
+    assert(test69->nb_packets == 3);
+
+    /* PID added by an output in the middle of a multi-packet block */
+    ubase_assert(upipe_ts_split_set_aggregate(upipe_ts_split, false));
+    add_pid70 = upipe_ts_split;
+    static const uint16_t pids3[] = { 70, 68, 70, 70 };
+    uref = alloc_packets(uref_mgr, ubuf_mgr, pids3, 4, 2 * TS_SIZE);
+    upipe_input(upipe_ts_split, uref, NULL);
+    assert(upipe_sink70 != NULL);
+    struct test *test70 = container_of(upipe_sink70, struct test, upipe);
+    assert(test68->nb_packets == 7);
+    assert(test70->nb_urefs == 2);
+    assert(test70->nb_packets == 2);
+
     upipe_release(upipe_ts_split_output68);
     upipe_release(upipe_ts_split_output69);
+    upipe_release(upipe_ts_split_output70);
     upipe_release(upipe_ts_split);
     upipe_mgr_release(upipe_ts_split_mgr); // nop
 
     test_free(upipe_sink68);
     test_free(upipe_sink69);
+    test_free(upipe_sink70);
 
     uref_mgr_release(uref_mgr);
     ubuf_mgr_release(ubuf_mgr);
@@ -49,6 +49,7 @@
 #include <upipe/ubuf_block_mem.h>
 #include <upipe/uref.h>
 #include <upipe/uref_block.h>
+#include <upipe/uref_clock.h>
 #include <upipe/uref_flow.h>
 #include <upipe/uref_block_flow.h>
 #include <upipe/uref_std.h>
@@ -80,6 +81,7 @@
 #define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
 #define BUF_SIZE 256
 #define FORMAT "This is packet number %d"
+#define BATCH 8
 
 /* FIXME: uncomment or remove */
 /*static void usage(const char *argv0) {
@@ -101,7 +103,16 @@ struct upump *write_pump;
 struct addrinfo hints, *servinfo, *p;
 struct upipe *upipe_udpsrc;
 struct upipe *upipe_udpsink;
+struct uclock *uclock;
 static int counter = 0;
+static int counter_max = 200;
+static bool mixed_sizes = false;
+
+/** size of the datagram with the given number in mixed sizes mode */
+static size_t packet_size(int n)
+{
+    return BUF_SIZE - (n % 5) * 40;
+}
 
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
@@ -153,6 +164,11 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     struct udpsrc_test *udpsrc_test = udpsrc_test_from_upipe(upipe);
     assert(uref != NULL);
 
+    if (mixed_sizes) {
+        size_t size;
+        ubase_assert(uref_block_size(uref, &size));
+        assert(size == packet_size(udpsrc_test->counter));
+    }
     if ((rbuf = uref_block_peek(uref, 0, -1, buf))) {
         upipe_dbg_va(upipe, "Received string: %s", rbuf);
         snprintf((char *)str, sizeof(str), FORMAT, udpsrc_test->counter);
@@ -160,7 +176,8 @@ static void test_input(struct upipe *upipe, struct uref *uref,
         udpsrc_test->counter++;
         uref_block_peek_unmap(uref, 0, buf, rbuf);
     }
-    if (udpsrc_test->counter == 110 || udpsrc_test->counter == 210) {
+    if (udpsrc_test->counter == 110 || udpsrc_test->counter == 210 ||
+        udpsrc_test->counter == 310 || udpsrc_test->counter == 410) {
         upipe_set_uri(upipe_udpsrc, NULL);
     }
 
@@ -232,7 +249,7 @@ static void genpackets2(struct upump *upump)
     int i, size = -1;
 
     printf("Counter: %d\n", counter);
-    if (counter > 200) {
+    if (counter > counter_max) {
         upump_stop(write_pump);
         return;
     }
@@ -249,6 +266,35 @@ static void genpackets2(struct upump *upump)
     }
 }
 
+/* packet generator sending datagrams of different sizes, dated so that they
+ * are held by the sink and sent together */
+static void genpackets3(struct upump *upump)
+{
+    struct uref *uref;
+    uint8_t *buf;
+    int i, size = -1;
+
+    printf("Counter: %d\n", counter);
+    if (counter > counter_max) {
+        upump_stop(write_pump);
+        return;
+    }
+
+    uint64_t cr_sys = uclock_now(uclock) + UCLOCK_FREQ / 100;
+    for (i=0; i < 10; i++) {
+        uref = uref_block_alloc(uref_mgr, ubuf_mgr, packet_size(counter));
+        size = -1;
+        uref_block_write(uref, 0, &size, &buf);
+        assert(size == packet_size(counter));
+        memset(buf, 0, size);
+        snprintf((char *)buf, size, FORMAT, counter);
+        uref_block_unmap(uref, 0);
+        uref_clock_set_cr_sys(uref, cr_sys);
+        counter++;
+        upipe_input(upipe_udpsink, uref, NULL);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     char udp_uri[512], port_str[8];
@@ -269,7 +315,7 @@ int main(int argc, char *argv[])
     struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
             UPUMP_BLOCKER_POOL);
     assert(upump_mgr != NULL);
-    struct uclock *uclock = uclock_std_alloc(0);
+    uclock = uclock_std_alloc(0);
     assert(uclock != NULL);
     struct uprobe uprobe;
     uprobe_init(&uprobe, catch, NULL);
@@ -372,8 +418,81 @@ int main(int argc, char *argv[])
     /* fire again */
     upump_mgr_run(upump_mgr, NULL);
 
-    /* release */
+    assert(udpsrc_test_from_upipe(udpsrc_test)->counter == 210);
+    upump_free(write_pump);
+
+    /* now test batched mode */
+    unsigned int batch;
+    ubase_assert(upipe_udpsrc_get_batch(upipe_udpsrc, &batch));
+    assert(batch == 1);
+    ubase_nassert(upipe_udpsrc_set_batch(upipe_udpsrc, 0));
+    ubase_assert(upipe_udpsrc_set_batch(upipe_udpsrc, BATCH));
+    ubase_assert(upipe_udpsrc_get_batch(upipe_udpsrc, &batch));
+    assert(batch == BATCH);
+
+    for (i=0; i < 10; i++) {
+        port = ((rand() % 40000) + 1024);
+        snprintf(udp_uri, sizeof(udp_uri), "@127.0.0.1:%d", port);
+        printf("Trying uri: %s ...\n", udp_uri);
+        if (( ret = ubase_check(upipe_set_uri(upipe_udpsrc, udp_uri)) )) {
+            break;
+        }
+    }
+    assert(ret);
+    ubase_assert(upipe_set_uri(upipe_udpsink, udp_uri+1));
+
+    uint64_t window;
+    ubase_assert(upipe_udpsink_get_window(upipe_udpsink, &window));
+    assert(window == 0);
+    ubase_assert(upipe_udpsink_set_window(upipe_udpsink, UCLOCK_FREQ / 1000));
+    ubase_assert(upipe_udpsink_get_window(upipe_udpsink, &window));
+    assert(window == UCLOCK_FREQ / 1000);
+
+    counter_max = 300;
+    write_pump = upump_alloc_idler(upump_mgr, genpackets2, NULL, NULL);
+    assert(write_pump);
+    upump_start(write_pump);
+
+    /* fire in batched mode */
+    upump_mgr_run(upump_mgr, NULL);
+
+    assert(udpsrc_test_from_upipe(udpsrc_test)->counter == 310);
     upump_free(write_pump);
+
+    /* now test batched mode on a raw socket, with datagrams of different
+     * sizes, if we are allowed to open one */
+    for (i=0; i < 10; i++) {
+        port = ((rand() % 40000) + 1024);
+        snprintf(udp_uri, sizeof(udp_uri), "@127.0.0.1:%d", port);
+        printf("Trying uri: %s ...\n", udp_uri);
+        if (( ret = ubase_check(upipe_set_uri(upipe_udpsrc, udp_uri)) )) {
+            break;
+        }
+    }
+    assert(ret);
+    char raw_uri[512];
+    snprintf(raw_uri, sizeof(raw_uri), "%s/srcaddr=127.0.0.1/srcport=%d",
+             udp_uri+1, port + 1);
+    ubase_assert(upipe_attach_uclock(upipe_udpsink));
+    if (ubase_check(upipe_set_uri(upipe_udpsink, raw_uri))) {
+        mixed_sizes = true;
+        counter_max = 400;
+        write_pump = upump_alloc_idler(upump_mgr, genpackets3, NULL, NULL);
+        assert(write_pump);
+        upump_start(write_pump);
+
+        /* fire in batched raw mode */
+        upump_mgr_run(upump_mgr, NULL);
+
+        assert(udpsrc_test_from_upipe(udpsrc_test)->counter == 410);
+    } else {
+        printf("cannot open a raw socket, skipping raw mode\n");
+        write_pump = NULL;
+    }
+
+    /* release */
+    if (write_pump != NULL)
+        upump_free(write_pump);
     upipe_release(upipe_udpsrc);
     upipe_release(upipe_udpsink);
     test_free(udpsrc_test);
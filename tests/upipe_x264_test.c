@@ -30,10 +30,14 @@
 #undef NDEBUG
 
 #include <upipe/uclock.h>
+#include <upipe/uclock_std.h>
 #include <upipe/uprobe.h>
 #include <upipe/uprobe_prefix.h>
 #include <upipe/uprobe_stdio.h>
 #include <upipe/uprobe_ubuf_mem.h>
+#include <upipe/uprobe_upump_mgr.h>
+#include <upipe/uprobe_uclock.h>
+#include <upipe/upump.h>
 #include <upipe/umem.h>
 #include <upipe/umem_alloc.h>
 #include <upipe/ubuf.h>
@@ -54,6 +58,7 @@
 #include <upipe/upipe_helper_upipe.h>
 
 #include <upipe-x264/upipe_x264.h>
+#include <upump-ev/upump_ev.h>
 
 #include <stdio.h>
 #include <string.h>
@@ -68,11 +73,16 @@
 #define UBUF_APPEND         0
 #define UBUF_ALIGN          16
 #define UBUF_ALIGN_OFFSET  0
+#define UPUMP_POOL          1
+#define UPUMP_BLOCKER_POOL  1
+#define QUEUE_LENGTH        4
 #define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
 #define WIDTH               96
 #define HEIGHT              64
 #define LIMIT               60
 
+/** number of latency events */
+static int nb_latencies = 0;
 
 /** phony pipe to test upipe_x264 */
 struct x264_test {
@@ -191,10 +201,33 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe,
         case UPROBE_DEAD:
         case UPROBE_NEW_FLOW_DEF:
             break;
+        case UPROBE_X264_LATENCY: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X264_SIGNATURE)
+            uint64_t latency = va_arg(args, uint64_t);
+            assert(latency < UCLOCK_FREQ * 10);
+            nb_latencies++;
+            break;
+        }
     }
     return UBASE_ERR_NONE;
 }
 
+/** stops the threaded encoder once all pictures are out */
+static void test_timer(struct upump *upump)
+{
+    static int ticks = 0;
+    struct upipe *x264 = upump_get_opaque(upump, struct upipe *);
+    struct upipe *x264_test;
+    ubase_assert(upipe_get_output(x264, &x264_test));
+    /* give up after 10 seconds, the counter is checked afterwards */
+    if (x264_test_from_upipe(x264_test)->counter < LIMIT && ++ticks < 1000)
+        return;
+
+    /* this also releases the watcher of the encoding thread */
+    ubase_assert(upipe_x264_set_threaded(x264, 0));
+    upump_stop(upump);
+}
+
 int main(int argc, char **argv)
 {
     printf("Compiled %s %s (%s)\n", __DATE__, __TIME__, __FILE__);
@@ -280,6 +313,82 @@ int main(int argc, char **argv)
     upipe_release(x264);
     test_free(x264_test);
 
+    /* threaded encoding test */
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
+            UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    struct uclock *uclock = uclock_std_alloc(0);
+    assert(uclock != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+    logger = uprobe_uclock_alloc(logger, uclock);
+    assert(logger != NULL);
+
+    flow_def = uref_pic_flow_alloc_def(uref_mgr, 1);
+    assert(flow_def);
+    ubase_assert(uref_pic_flow_add_plane(flow_def, 1, 1, 1, "y8"));
+    ubase_assert(uref_pic_flow_add_plane(flow_def, 2, 2, 1, "u8"));
+    ubase_assert(uref_pic_flow_add_plane(flow_def, 2, 2, 1, "v8"));
+    ubase_assert(uref_pic_flow_set_hsize(flow_def, WIDTH));
+    ubase_assert(uref_pic_flow_set_vsize(flow_def, HEIGHT));
+    ubase_assert(uref_pic_flow_set_fps(flow_def, fps));
+
+    x264 = upipe_void_alloc(upipe_x264_mgr,
+                    uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                                     "x264 threaded"));
+    assert(x264);
+    ubase_assert(upipe_attach_uclock(x264));
+    ubase_assert(upipe_set_flow_def(x264, flow_def));
+    uref_free(flow_def);
+
+    x264_test = upipe_void_alloc(&x264_test_mgr,
+                    uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                                     "x264_test threaded"));
+    ubase_assert(upipe_set_output(x264, x264_test));
+
+    ubase_assert(upipe_x264_set_default_preset(x264, "faster", NULL));
+    ubase_assert(upipe_x264_set_latency_preset(x264,
+                UPIPE_X264_LATENCY_PRESET_THROUGHPUT));
+    ubase_assert(upipe_x264_set_latency_preset(x264,
+                UPIPE_X264_LATENCY_PRESET_LOW));
+    ubase_assert(upipe_x264_set_sliced_threads(x264, true));
+    ubase_assert(upipe_x264_set_sync_lookahead(x264, 0));
+    ubase_assert(upipe_x264_set_vbv(x264, 0, 0));
+    unsigned int queue_length;
+    ubase_assert(upipe_x264_get_threaded(x264, &queue_length));
+    assert(queue_length == 0);
+    ubase_assert(upipe_x264_set_threaded(x264, QUEUE_LENGTH));
+    ubase_assert(upipe_x264_get_threaded(x264, &queue_length));
+    assert(queue_length == QUEUE_LENGTH);
+
+    /* pictures beyond the queue are held until the thread catches up */
+    for (counter = 0; counter < LIMIT; counter ++) {
+        pic = uref_pic_alloc(uref_mgr, pic_mgr, WIDTH, HEIGHT);
+        assert(pic);
+        fill_pic(pic, counter);
+        pts = counter + 42;
+        uref_clock_set_pts_orig(pic, pts);
+        uref_clock_set_pts_prog(pic, pts * UCLOCK_FREQ + UINT32_MAX);
+        upipe_input(x264, pic, NULL);
+    }
+
+    struct upump *timer = upump_alloc_timer(upump_mgr, test_timer, x264,
+                                            NULL, UCLOCK_FREQ / 100,
+                                            UCLOCK_FREQ / 100);
+    assert(timer != NULL);
+    upump_start(timer);
+    upump_mgr_run(upump_mgr, NULL);
+
+    /* the low latency preset has no delayed frames */
+    assert(x264_test_from_upipe(x264_test)->counter == LIMIT);
+    assert(nb_latencies == LIMIT);
+
+    upump_free(timer);
+    upipe_release(x264);
+    test_free(x264_test);
+    uclock_release(uclock);
+    upump_mgr_release(upump_mgr);
+
     /* clean everything */
     upipe_mgr_release(upipe_x264_mgr); // noop
     ubuf_mgr_release(pic_mgr);
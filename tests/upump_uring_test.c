@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for upump manager with io_uring
+ */
+
+#undef NDEBUG
+
+#include <upipe/upump.h>
+#include <upipe/upump_blocker.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upump-uring/upump_uring.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <assert.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define UPUMP_POOL 1
+#define UPUMP_BLOCKER_POOL 1
+#define DATAGRAMS 64
+#define DATAGRAM_SIZE 1316
+#define RECV_BUFFERS 8
+#define SEND_DEPTH 16
+
+static uint64_t timeout = UINT64_C(27000000); /* 1 s */
+static const char *padding =
+    "This is an initialized bit of space used to pad sufficiently !";
+/* This is an arbitrarily large number that is just supposed to be bigger than
+ * the buffer space of a pipe. */
+#define MIN_READ (128*1024)
+
+static int pipefd[2];
+static struct upump_mgr *mgr;
+static struct upump *write_idler;
+static struct upump *read_timer;
+static struct upump *write_watcher;
+static struct upump *read_watcher;
+static struct upump_blocker *blocker = NULL;
+static ssize_t bytes_written = 0, bytes_read = 0;
+
+static int sockets[2];
+static struct upump *send_idler;
+static struct upump *send_pump;
+static struct upump *recv_pump;
+static uint8_t datagrams[DATAGRAMS][DATAGRAM_SIZE];
+static struct iovec iovecs[DATAGRAMS];
+static struct umem received[DATAGRAMS];
+static unsigned int nb_submitted = 0, nb_sent = 0, nb_received = 0;
+static bool eof = false;
+
+/* allocator failing on demand, to starve the recv pump */
+static struct umem_mgr *real_umem_mgr;
+static bool starving = false;
+static struct upump *starve_timer;
+static struct upump *watchdog;
+
+static void blocker_cb(struct upump_blocker *blocker)
+{
+    upump_blocker_free(blocker);
+}
+
+static void write_idler_cb(struct upump *upump)
+{
+    ssize_t ret = write(pipefd[1], padding, strlen(padding) + 1);
+    if (ret == -1 && (errno == EWOULDBLOCK || errno == EAGAIN)) {
+        printf("write idler blocked\n");
+        blocker = upump_blocker_alloc(write_idler, blocker_cb, NULL, NULL);
+        assert(blocker != NULL);
+        upump_start(write_watcher);
+        upump_start(read_timer);
+    } else {
+        assert(ret != -1);
+        bytes_written += ret;
+    }
+}
+
+static void write_watcher_cb(struct upump *unused)
+{
+    printf("write watcher passed\n");
+    upump_blocker_free(blocker);
+    upump_stop(write_watcher);
+}
+
+static void read_timer_cb(struct upump *unused)
+{
+    printf("read timer passed\n");
+    upump_start(read_watcher);
+    /* The timer is automatically stopped */
+}
+
+static void read_watcher_cb(struct upump *unused)
+{
+    char buffer[strlen(padding) + 1];
+    ssize_t ret = read(pipefd[0], buffer, strlen(padding) + 1);
+    assert(ret != -1);
+    bytes_read += ret;
+    if (bytes_read > MIN_READ) {
+        printf("read watcher passed\n");
+        upump_stop(write_idler);
+        upump_stop(read_watcher);
+    }
+}
+
+static void send_idler_cb(struct upump *upump)
+{
+    while (nb_submitted < DATAGRAMS) {
+        int err = upump_send(send_pump, &iovecs[nb_submitted], 1,
+                             datagrams[nb_submitted]);
+        if (err == UBASE_ERR_BUSY)
+            return;
+        assert(err == UBASE_ERR_NONE);
+        nb_submitted++;
+    }
+    upump_stop(send_idler);
+}
+
+static void send_cb(struct upump *upump)
+{
+    void *opaque;
+    ssize_t result;
+    ubase_assert(upump_get_sent(upump, &opaque, &result));
+    /* requests complete in order */
+    assert(opaque == datagrams[nb_sent]);
+    assert(result == DATAGRAM_SIZE);
+    nb_sent++;
+    if (nb_sent == DATAGRAMS) {
+        printf("send pump passed\n");
+        upump_stop(send_pump);
+    }
+}
+
+static void recv_cb(struct upump *upump)
+{
+    struct upump_recv recv;
+    ubase_assert(upump_get_recv(upump, &recv));
+    assert(recv.size == DATAGRAM_SIZE);
+    assert(recv.umem.mgr != NULL);
+    assert(!memcmp(umem_buffer(&recv.umem) + recv.offset,
+                   datagrams[nb_received], DATAGRAM_SIZE));
+    /* the kernel timestamp is passed as ancillary data */
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = (void *)recv.control;
+    msg.msg_controllen = recv.controllen;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    assert(cmsg != NULL);
+    assert(cmsg->cmsg_level == SOL_SOCKET);
+    assert(cmsg->cmsg_type == SCM_TIMESTAMPNS);
+    /* keep the buffers so that the pump has to allocate new ones */
+    received[nb_received++] = recv.umem;
+    if (nb_received == DATAGRAMS) {
+        printf("recv pump passed\n");
+        upump_stop(recv_pump);
+        if (watchdog != NULL)
+            upump_stop(watchdog);
+    }
+}
+
+static bool starve_alloc(struct umem_mgr *mgr, struct umem *umem,
+                         size_t size)
+{
+    if (starving)
+        return false;
+    return umem_alloc(real_umem_mgr, umem, size);
+}
+
+static struct umem_mgr starve_umem_mgr = {
+    .refcount = NULL,
+    .umem_alloc = starve_alloc,
+    .umem_realloc = NULL,
+    .umem_free = NULL,
+    .umem_mgr_vacuum = NULL
+};
+
+static void starve_timer_cb(struct upump *upump)
+{
+    /* the pump must resume receiving on its own */
+    starving = false;
+}
+
+static void watchdog_cb(struct upump *upump)
+{
+    assert(nb_received == DATAGRAMS);
+}
+
+static void read_recv_cb(struct upump *upump)
+{
+    struct upump_recv recv;
+    ubase_assert(upump_get_recv(upump, &recv));
+    if (recv.size) {
+        assert(recv.size == strlen(padding) + 1);
+        assert(!memcmp(umem_buffer(&recv.umem) + recv.offset, padding,
+                       recv.size));
+    } else {
+        printf("read pump passed\n");
+        eof = true;
+        upump_stop(upump);
+    }
+    if (recv.umem.mgr != NULL)
+        umem_free(&recv.umem);
+}
+
+int main(int argc, char **argv)
+{
+    long flags;
+    mgr = upump_uring_mgr_alloc(UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    if (mgr == NULL) {
+        printf("io_uring is not available\n");
+        return 77;
+    }
+
+    /* Create a pipe with non-blocking write */
+    assert(pipe(pipefd) != -1);
+    flags = fcntl(pipefd[1], F_GETFL);
+    assert(flags != -1);
+    flags |= O_NONBLOCK;
+    assert(fcntl(pipefd[1], F_SETFL, flags) != -1);
+
+    /* Create watchers */
+    write_idler = upump_alloc_idler(mgr, write_idler_cb, NULL, NULL);
+    assert(write_idler != NULL);
+    write_watcher = upump_alloc_fd_write(mgr, write_watcher_cb, NULL, NULL,
+                                         pipefd[1]);
+    assert(write_watcher != NULL);
+    read_timer = upump_alloc_timer(mgr, read_timer_cb, NULL, NULL, timeout, 0);
+    assert(read_timer != NULL);
+    read_watcher = upump_alloc_fd_read(mgr, read_watcher_cb, NULL, NULL,
+                                       pipefd[0]);
+    assert(read_watcher != NULL);
+
+    /* Start tests */
+    upump_start(write_idler);
+    ubase_assert(upump_mgr_run(mgr, NULL));
+    assert(bytes_read);
+    assert(bytes_read == bytes_written);
+
+    /* Clean up */
+    upump_free(write_idler);
+    upump_free(write_watcher);
+    upump_free(read_timer);
+    upump_free(read_watcher);
+
+    /* Completion-based datagram pumps */
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    assert(socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets) != -1);
+    int on = 1;
+    assert(setsockopt(sockets[1], SOL_SOCKET, SO_TIMESTAMPNS,
+                      &on, sizeof(on)) != -1);
+    for (unsigned int i = 0; i < DATAGRAMS; i++) {
+        memset(datagrams[i], i, DATAGRAM_SIZE);
+        iovecs[i].iov_base = datagrams[i];
+        iovecs[i].iov_len = DATAGRAM_SIZE;
+    }
+
+    send_idler = upump_alloc_idler(mgr, send_idler_cb, NULL, NULL);
+    assert(send_idler != NULL);
+    send_pump = upump_alloc_fd_send(mgr, send_cb, NULL, NULL, sockets[0],
+                                    SEND_DEPTH);
+    assert(send_pump != NULL);
+    recv_pump = upump_alloc_fd_recv(mgr, recv_cb, NULL, NULL, sockets[1],
+                                    umem_mgr, DATAGRAM_SIZE, RECV_BUFFERS);
+    assert(recv_pump != NULL);
+
+    upump_start(recv_pump);
+    upump_start(send_pump);
+    upump_start(send_idler);
+    ubase_assert(upump_mgr_run(mgr, NULL));
+    assert(nb_sent == DATAGRAMS);
+    assert(nb_received == DATAGRAMS);
+
+    upump_free(recv_pump);
+    for (unsigned int i = 0; i < DATAGRAMS; i++)
+        umem_free(&received[i]);
+
+    /* Recv pump running out of buffers, which can no longer be allocated */
+    real_umem_mgr = umem_mgr;
+    nb_submitted = nb_sent = nb_received = 0;
+    recv_pump = upump_alloc_fd_recv(mgr, recv_cb, NULL, NULL, sockets[1],
+                                    &starve_umem_mgr, DATAGRAM_SIZE,
+                                    RECV_BUFFERS);
+    assert(recv_pump != NULL);
+    starving = true;
+    starve_timer = upump_alloc_timer(mgr, starve_timer_cb, NULL, NULL,
+                                     timeout / 100, 0);
+    assert(starve_timer != NULL);
+    watchdog = upump_alloc_timer(mgr, watchdog_cb, NULL, NULL, timeout, 0);
+    assert(watchdog != NULL);
+
+    upump_start(recv_pump);
+    upump_start(send_pump);
+    upump_start(send_idler);
+    upump_start(starve_timer);
+    upump_start(watchdog);
+    ubase_assert(upump_mgr_run(mgr, NULL));
+    assert(nb_sent == DATAGRAMS);
+    assert(nb_received == DATAGRAMS);
+
+    upump_free(starve_timer);
+    upump_free(watchdog);
+    upump_free(send_idler);
+    upump_free(send_pump);
+    upump_free(recv_pump);
+    for (unsigned int i = 0; i < DATAGRAMS; i++)
+        umem_free(&received[i]);
+    close(sockets[0]);
+    close(sockets[1]);
+
+    /* Completion-based read on a pipe, until the end of stream */
+    assert(write(pipefd[1], padding, strlen(padding) + 1) ==
+           strlen(padding) + 1);
+    close(pipefd[1]);
+    struct upump *read_pump = upump_alloc_fd_recv(mgr, read_recv_cb, NULL,
+                                                  NULL, pipefd[0], umem_mgr,
+                                                  4096, 2);
+    assert(read_pump != NULL);
+    upump_start(read_pump);
+    ubase_assert(upump_mgr_run(mgr, NULL));
+    assert(eof);
+    upump_free(read_pump);
+    close(pipefd[0]);
+
+    umem_mgr_release(umem_mgr);
+    upump_mgr_release(mgr);
+
+    return 0;
+}
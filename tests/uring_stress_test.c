@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short stress test of ulifos and ufifos deeper than 16-bit indexes
+ */
+
+#undef NDEBUG
+
+#include <upipe/ubase.h>
+#include <upipe/uatomic.h>
+#include <upipe/ulifo.h>
+#include <upipe/ufifo.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <assert.h>
+
+/* more elements than a 16-bit index can address */
+#define DEPTH 70000
+#define NB_THREADS 4
+#define NB_LOOPS 200000
+#define BATCH 64
+
+struct token {
+    uatomic_uint32_t owned;
+};
+
+static struct token tokens[DEPTH];
+static struct ulifo ulifo;
+static struct ufifo ufifo;
+static unsigned int nb_loops = NB_LOOPS;
+
+/* sequence numbers of the FIFO test */
+static uatomic_uint32_t seen[NB_THREADS / 2][NB_LOOPS];
+static uatomic_uint32_t producers;
+
+static void take(struct token *token)
+{
+    uint32_t expected = 0;
+    /* a token popped twice would be an ABA problem */
+    assert(uatomic_compare_exchange(&token->owned, &expected, 1));
+}
+
+static void give(struct token *token)
+{
+    uint32_t expected = 1;
+    assert(uatomic_compare_exchange(&token->owned, &expected, 0));
+}
+
+static void *lifo_thread(void *unused)
+{
+    struct token *batch[BATCH];
+    for (unsigned int i = 0; i < nb_loops / BATCH; i++) {
+        unsigned int nb = 1 + i % BATCH;
+        for (unsigned int j = 0; j < nb; j++) {
+            batch[j] = ulifo_pop(&ulifo, struct token *);
+            assert(batch[j] != NULL);
+            take(batch[j]);
+        }
+        for (unsigned int j = 0; j < nb; j++) {
+            give(batch[j]);
+            assert(ulifo_push(&ulifo, batch[j]));
+        }
+    }
+    return NULL;
+}
+
+/* opaques are (producer << 24 | sequence) + 1 */
+static void *fifo_producer(void *_id)
+{
+    uintptr_t id = (uintptr_t)_id;
+    for (unsigned int i = 0; i < nb_loops; i++) {
+        void *opaque = (void *)(((id << 24) | i) + 1);
+        while (!ufifo_push(&ufifo, opaque))
+            sched_yield();
+    }
+    uatomic_fetch_sub(&producers, 1);
+    return NULL;
+}
+
+static void *fifo_consumer(void *unused)
+{
+    unsigned int last[NB_THREADS / 2];
+    for (unsigned int i = 0; i < NB_THREADS / 2; i++)
+        last[i] = UINT32_MAX;
+
+    for ( ; ; ) {
+        void *opaque = ufifo_pop(&ufifo, void *);
+        if (opaque == NULL) {
+            if (!uatomic_load(&producers)) {
+                opaque = ufifo_pop(&ufifo, void *);
+                if (opaque == NULL)
+                    break;
+            } else {
+                sched_yield();
+                continue;
+            }
+        }
+        uintptr_t val = (uintptr_t)opaque - 1;
+        unsigned int id = val >> 24;
+        unsigned int seq = val & ((1 << 24) - 1);
+        assert(id < NB_THREADS / 2);
+        assert(seq < nb_loops);
+        /* per-producer order is kept for a given consumer */
+        assert(last[id] == UINT32_MAX || seq > last[id]);
+        last[id] = seq;
+        uint32_t expected = 0;
+        assert(uatomic_compare_exchange(&seen[id][seq], &expected, 1));
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+        nb_loops = atoi(argv[1]);
+    assert(nb_loops <= NB_LOOPS);
+
+    uint8_t *ulifo_buffer = malloc(ulifo_sizeof(DEPTH));
+    uint8_t *ufifo_buffer = malloc(ufifo_sizeof(DEPTH));
+    assert(ulifo_buffer != NULL);
+    assert(ufifo_buffer != NULL);
+    pthread_t threads[NB_THREADS];
+
+    /* LIFO: all threads concurrently pop and push back tokens */
+    ulifo_init(&ulifo, DEPTH, ulifo_buffer);
+    for (unsigned int i = 0; i < DEPTH; i++) {
+        uatomic_init(&tokens[i].owned, 0);
+        assert(ulifo_push(&ulifo, &tokens[i]));
+    }
+    assert(!ulifo_push(&ulifo, &tokens[0]));
+
+    for (unsigned int i = 0; i < NB_THREADS; i++)
+        assert(!pthread_create(&threads[i], NULL, lifo_thread, NULL));
+    for (unsigned int i = 0; i < NB_THREADS; i++)
+        assert(!pthread_join(threads[i], NULL));
+
+    unsigned int count = 0;
+    struct token *token;
+    while ((token = ulifo_pop(&ulifo, struct token *)) != NULL) {
+        take(token);
+        count++;
+    }
+    assert(count == DEPTH);
+    ulifo_clean(&ulifo);
+
+    /* FIFO: fill it beyond 16 bits, then run producers and consumers */
+    ufifo_init(&ufifo, DEPTH, ufifo_buffer);
+    for (unsigned int i = 0; i < DEPTH; i++)
+        assert(ufifo_push(&ufifo, &tokens[i]));
+    assert(!ufifo_push(&ufifo, &tokens[0]));
+    for (unsigned int i = 0; i < DEPTH; i++)
+        assert(ufifo_pop(&ufifo, struct token *) == &tokens[i]);
+    assert(ufifo_pop(&ufifo, struct token *) == NULL);
+
+    for (unsigned int i = 0; i < NB_THREADS / 2; i++)
+        for (unsigned int j = 0; j < nb_loops; j++)
+            uatomic_init(&seen[i][j], 0);
+    uatomic_init(&producers, NB_THREADS / 2);
+
+    for (unsigned int i = 0; i < NB_THREADS / 2; i++)
+        assert(!pthread_create(&threads[i], NULL, fifo_producer,
+                               (void *)(uintptr_t)i));
+    for (unsigned int i = NB_THREADS / 2; i < NB_THREADS; i++)
+        assert(!pthread_create(&threads[i], NULL, fifo_consumer, NULL));
+    for (unsigned int i = 0; i < NB_THREADS; i++)
+        assert(!pthread_join(threads[i], NULL));
+
+    for (unsigned int i = 0; i < NB_THREADS / 2; i++)
+        for (unsigned int j = 0; j < nb_loops; j++) {
+            assert(uatomic_load(&seen[i][j]) == 1);
+            uatomic_clean(&seen[i][j]);
+        }
+    assert(ufifo_pop(&ufifo, void *) == NULL);
+    ufifo_clean(&ufifo);
+
+    for (unsigned int i = 0; i < DEPTH; i++)
+        uatomic_clean(&tokens[i].owned);
+    uatomic_clean(&producers);
+    free(ulifo_buffer);
+    free(ufifo_buffer);
+    return 0;
+}